@@ -43,6 +43,7 @@
 #include <openssl/core_names.h>
 #include <openssl/async.h>
 #include <openssl/provider.h>
+#include <openssl/thread.h>
 #if !defined(OPENSSL_SYS_MSDOS)
 # include <unistd.h>
 #endif
@@ -237,8 +238,9 @@ static int opt_found(const char *name, unsigned int *result,
 typedef enum OPTION_choice {
     OPT_COMMON,
     OPT_ELAPSED, OPT_EVP, OPT_HMAC, OPT_DECRYPT, OPT_ENGINE, OPT_MULTI,
-    OPT_MR, OPT_MB, OPT_MISALIGN, OPT_ASYNCJOBS, OPT_R_ENUM, OPT_PROV_ENUM, OPT_CONFIG,
-    OPT_PRIMES, OPT_SECONDS, OPT_BYTES, OPT_AEAD, OPT_CMAC, OPT_MLOCK, OPT_KEM, OPT_SIG
+    OPT_MR, OPT_MB, OPT_BATCH, OPT_MISALIGN, OPT_ASYNCJOBS, OPT_R_ENUM, OPT_PROV_ENUM, OPT_CONFIG,
+    OPT_PRIMES, OPT_SECONDS, OPT_BYTES, OPT_AEAD, OPT_CMAC, OPT_MLOCK, OPT_KEM, OPT_SIG,
+    OPT_THREADS
 } OPTION_CHOICE;
 
 const OPTIONS speed_options[] = {
@@ -252,6 +254,8 @@ const OPTIONS speed_options[] = {
     {"help", OPT_HELP, '-', "Display this summary"},
     {"mb", OPT_MB, '-',
      "Enable (tls1>=1) multi-block mode on EVP-named cipher"},
+    {"batch", OPT_BATCH, 'p',
+     "Hash this many buffers, make this many RSA or ECDSA signatures or ECDH secrets, or verify this many EdDSA signatures, per call"},
     {"mr", OPT_MR, '-', "Produce machine readable output"},
 #ifndef NO_FORK
     {"multi", OPT_MULTI, 'p', "Run benchmarks in parallel"},
@@ -265,6 +269,8 @@ const OPTIONS speed_options[] = {
 #endif
     {"primes", OPT_PRIMES, 'p', "Specify number of primes (for RSA only)"},
     {"mlock", OPT_MLOCK, '-', "Lock memory for better result determinism"},
+    {"threads", OPT_THREADS, 'p',
+     "Let each EVP-named cipher update use up to this many threads"},
     OPT_CONFIG_OPTION,
 
     OPT_SECTION("Selection"),
@@ -531,6 +537,7 @@ typedef struct loopargs_st {
     EVP_PKEY_CTX *ecdsa_sign_ctx[ECDSA_NUM];
     EVP_PKEY_CTX *ecdsa_verify_ctx[ECDSA_NUM];
     EVP_PKEY_CTX *ecdh_ctx[EC_NUM];
+    EVP_PKEY *ecdh_peer[EC_NUM];
 #ifndef OPENSSL_NO_ECX
     EVP_MD_CTX *eddsa_ctx[EdDSA_NUM];
     EVP_MD_CTX *eddsa_ctx2[EdDSA_NUM];
@@ -573,6 +580,7 @@ static unsigned int testnum;
 static char *evp_mac_mdname = "md5";
 static char *evp_hmac_name = NULL;
 static const char *evp_md_name = NULL;
+static int evp_md_batch = 0;
 static char *evp_mac_ciphername = "aes-128-cbc";
 static char *evp_cmac_name = NULL;
 
@@ -635,6 +643,36 @@ static int EVP_Digest_md_loop(void *args)
     return EVP_Digest_loop(evp_md_name, D_EVP, args);
 }
 
+static int EVP_Digest_batch_loop(void *args)
+{
+    loopargs_t *tempargs = *(loopargs_t **) args;
+    unsigned char *buf = tempargs->buf;
+    EVP_DIGEST_BATCH_ITEM *items;
+    unsigned char *digests;
+    int count, i;
+    EVP_MD *md = NULL;
+
+    if (!opt_md_silent(evp_md_name, &md))
+        return -1;
+    items = app_malloc(sizeof(*items) * evp_md_batch, "digest batch");
+    digests = app_malloc(EVP_MAX_MD_SIZE * evp_md_batch, "batch digests");
+    for (i = 0; i < evp_md_batch; i++) {
+        items[i].data = buf;
+        items[i].datalen = (size_t)lengths[testnum];
+        items[i].md = digests + EVP_MAX_MD_SIZE * i;
+    }
+    for (count = 0; COND(c[D_EVP][testnum]); count += evp_md_batch) {
+        if (!EVP_DigestBatch(items, evp_md_batch, NULL, md, NULL)) {
+            count = -1;
+            break;
+        }
+    }
+    OPENSSL_free(digests);
+    OPENSSL_free(items);
+    EVP_MD_free(md);
+    return count;
+}
+
 static int EVP_Digest_MD2_loop(void *args)
 {
     return EVP_Digest_loop("md2", D_MD2, args);
@@ -926,6 +964,39 @@ static int RSA_sign_loop(void *args)
     return count;
 }
 
+/* Sign evp_md_batch copies of the input per call */
+static int RSA_sign_batch_loop(void *args)
+{
+    loopargs_t *tempargs = *(loopargs_t **) args;
+    EVP_PKEY_CTX **rsa_sign_ctx = tempargs->rsa_sign_ctx;
+    EVP_PKEY_SIGN_BATCH_ITEM *items;
+    unsigned char *sigs;
+    int count, i;
+
+    items = app_malloc(sizeof(*items) * evp_md_batch, "sign batch");
+    sigs = app_malloc(tempargs->buflen * evp_md_batch, "batch signatures");
+    for (i = 0; i < evp_md_batch; i++) {
+        items[i].pkey = NULL;
+        items[i].sig = sigs + i * tempargs->buflen;
+        items[i].tbs = tempargs->buf;
+        items[i].tbslen = 36;
+    }
+    for (count = 0; COND(rsa_c[testnum][0]); count += evp_md_batch) {
+        for (i = 0; i < evp_md_batch; i++)
+            items[i].siglen = tempargs->buflen;
+        if (EVP_PKEY_sign_batch(rsa_sign_ctx[testnum], items,
+                                evp_md_batch) <= 0) {
+            BIO_printf(bio_err, "RSA sign failure\n");
+            ERR_print_errors(bio_err);
+            count = -1;
+            break;
+        }
+    }
+    OPENSSL_free(sigs);
+    OPENSSL_free(items);
+    return count;
+}
+
 static int RSA_verify_loop(void *args)
 {
     loopargs_t *tempargs = *(loopargs_t **) args;
@@ -1075,6 +1146,39 @@ static int ECDSA_sign_loop(void *args)
     return count;
 }
 
+/* Sign evp_md_batch copies of the input per call */
+static int ECDSA_sign_batch_loop(void *args)
+{
+    loopargs_t *tempargs = *(loopargs_t **) args;
+    EVP_PKEY_CTX **ecdsa_sign_ctx = tempargs->ecdsa_sign_ctx;
+    EVP_PKEY_SIGN_BATCH_ITEM *items;
+    unsigned char *sigs;
+    int count, i;
+
+    items = app_malloc(sizeof(*items) * evp_md_batch, "sign batch");
+    sigs = app_malloc(tempargs->buflen * evp_md_batch, "batch signatures");
+    for (i = 0; i < evp_md_batch; i++) {
+        items[i].pkey = NULL;
+        items[i].sig = sigs + i * tempargs->buflen;
+        items[i].tbs = tempargs->buf;
+        items[i].tbslen = 20;
+    }
+    for (count = 0; COND(ecdsa_c[testnum][0]); count += evp_md_batch) {
+        for (i = 0; i < evp_md_batch; i++)
+            items[i].siglen = tempargs->buflen;
+        if (EVP_PKEY_sign_batch(ecdsa_sign_ctx[testnum], items,
+                                evp_md_batch) <= 0) {
+            BIO_printf(bio_err, "ECDSA sign failure\n");
+            ERR_print_errors(bio_err);
+            count = -1;
+            break;
+        }
+    }
+    OPENSSL_free(sigs);
+    OPENSSL_free(items);
+    return count;
+}
+
 static int ECDSA_verify_loop(void *args)
 {
     loopargs_t *tempargs = *(loopargs_t **) args;
@@ -1113,6 +1217,37 @@ static int ECDH_EVP_derive_key_loop(void *args)
     return count;
 }
 
+/* Derive evp_md_batch copies of the shared secret per call */
+static int ECDH_EVP_derive_key_batch_loop(void *args)
+{
+    loopargs_t *tempargs = *(loopargs_t **) args;
+    EVP_PKEY_CTX *ctx = tempargs->ecdh_ctx[testnum];
+    EVP_PKEY_DERIVE_BATCH_ITEM *items;
+    unsigned char *secrets;
+    int count, i;
+
+    items = app_malloc(sizeof(*items) * evp_md_batch, "derive batch");
+    secrets = app_malloc(MAX_ECDH_SIZE * evp_md_batch, "batch secrets");
+    for (i = 0; i < evp_md_batch; i++) {
+        items[i].pkey = NULL;
+        items[i].peer = tempargs->ecdh_peer[testnum];
+        items[i].key = secrets + i * MAX_ECDH_SIZE;
+    }
+    for (count = 0; COND(ecdh_c[testnum][0]); count += evp_md_batch) {
+        for (i = 0; i < evp_md_batch; i++)
+            items[i].keylen = tempargs->outlen[testnum];
+        if (EVP_PKEY_derive_batch(ctx, items, evp_md_batch) <= 0) {
+            BIO_printf(bio_err, "ECDH derive failure\n");
+            ERR_print_errors(bio_err);
+            count = -1;
+            break;
+        }
+    }
+    OPENSSL_free(secrets);
+    OPENSSL_free(items);
+    return count;
+}
+
 #ifndef OPENSSL_NO_ECX
 static int EdDSA_sign_loop(void *args)
 {
@@ -1169,6 +1304,46 @@ static int EdDSA_verify_loop(void *args)
     }
     return count;
 }
+
+/* Verify evp_md_batch copies of the signature per call */
+static int EdDSA_verify_batch_loop(void *args)
+{
+    loopargs_t *tempargs = *(loopargs_t **) args;
+    unsigned char *buf = tempargs->buf;
+    EVP_PKEY_CTX *pctx = EVP_MD_CTX_get_pkey_ctx(tempargs->eddsa_ctx2[testnum]);
+    EVP_PKEY_CTX *vctx;
+    EVP_PKEY_VERIFY_BATCH_ITEM *items;
+    int count, i;
+
+    vctx = EVP_PKEY_CTX_new_from_pkey(app_get0_libctx(),
+                                      EVP_PKEY_CTX_get0_pkey(pctx),
+                                      app_get0_propq());
+    if (vctx == NULL || EVP_PKEY_verify_init(vctx) <= 0) {
+        BIO_printf(bio_err, "EdDSA verify init failure\n");
+        ERR_print_errors(bio_err);
+        EVP_PKEY_CTX_free(vctx);
+        return -1;
+    }
+    items = app_malloc(sizeof(*items) * evp_md_batch, "verify batch");
+    for (i = 0; i < evp_md_batch; i++) {
+        items[i].pkey = NULL;
+        items[i].sig = tempargs->buf2;
+        items[i].siglen = tempargs->sigsize;
+        items[i].tbs = buf;
+        items[i].tbslen = 20;
+    }
+    for (count = 0; COND(eddsa_c[testnum][1]); count += evp_md_batch) {
+        if (EVP_PKEY_verify_batch(vctx, items, evp_md_batch) != 1) {
+            BIO_printf(bio_err, "EdDSA verify failure\n");
+            ERR_print_errors(bio_err);
+            count = -1;
+            break;
+        }
+    }
+    OPENSSL_free(items);
+    EVP_PKEY_CTX_free(vctx);
+    return count;
+}
 #endif /* OPENSSL_NO_ECX */
 
 #ifndef OPENSSL_NO_SM2
@@ -1708,6 +1883,7 @@ int speed_main(int argc, char **argv)
     long count = 0;
     unsigned int size_num = SIZE_NUM;
     unsigned int i, k, loopargs_len = 0, async_jobs = 0;
+    unsigned int cipher_threads = 0;
     unsigned int idx;
     int keylen;
     int buflen;
@@ -1950,6 +2126,9 @@ int speed_main(int argc, char **argv)
         case OPT_MR:
             mr = 1;
             break;
+        case OPT_BATCH:
+            evp_md_batch = opt_int_arg();
+            break;
         case OPT_MB:
             multiblock = 1;
 #ifdef OPENSSL_NO_MULTIBLOCK
@@ -1989,6 +2168,11 @@ int speed_main(int argc, char **argv)
         case OPT_AEAD:
             aead = 1;
             break;
+        case OPT_THREADS:
+            cipher_threads = opt_int_arg();
+            /* CPU time adds up over the threads, so use wall-clock time */
+            usertime = 0;
+            break;
         case OPT_KEM:
             do_kems = 1;
             break;
@@ -2736,6 +2920,14 @@ skip_hmac:
 
             names[D_EVP] = EVP_CIPHER_get0_name(evp_cipher);
 
+            if (cipher_threads > 1
+                    && !OSSL_set_max_threads(app_get0_libctx(),
+                                             cipher_threads - 1)) {
+                BIO_printf(bio_err, "%s: thread pool is not supported\n",
+                           prog);
+                goto end;
+            }
+
             if (EVP_CIPHER_get_mode(evp_cipher) == EVP_CIPH_CCM_MODE) {
                 loopfunc = EVP_Update_loop_ccm;
             } else if (aead && (EVP_CIPHER_get_flags(evp_cipher) &
@@ -2776,6 +2968,22 @@ skip_hmac:
                     }
                     OPENSSL_clear_free(loopargs[k].key, keylen);
 
+                    if (cipher_threads > 0) {
+                        OSSL_PARAM params[2];
+
+                        params[0] =
+                            OSSL_PARAM_construct_uint(OSSL_CIPHER_PARAM_THREADS,
+                                                      &cipher_threads);
+                        params[1] = OSSL_PARAM_construct_end();
+                        if (!EVP_CIPHER_CTX_set_params(loopargs[k].ctx,
+                                                       params)) {
+                            BIO_printf(bio_err,
+                                       "\nEVP_CIPHER_CTX_set_params failure\n");
+                            ERR_print_errors(bio_err);
+                            exit(1);
+                        }
+                    }
+
                     /* GCM-SIV/SIV mode only allows for a single Update operation */
                     if (EVP_CIPHER_get_mode(evp_cipher) == EVP_CIPH_SIV_MODE
                             || EVP_CIPHER_get_mode(evp_cipher) == EVP_CIPH_GCM_SIV_MODE)
@@ -2796,7 +3004,10 @@ skip_hmac:
             for (testnum = 0; testnum < size_num; testnum++) {
                 print_message(names[D_EVP], lengths[testnum], seconds.sym);
                 Time_F(START);
-                count = run_benchmark(async_jobs, EVP_Digest_md_loop, loopargs);
+                count = run_benchmark(async_jobs,
+                                      evp_md_batch > 0 ? EVP_Digest_batch_loop
+                                                       : EVP_Digest_md_loop,
+                                      loopargs);
                 d = Time_F(STOP);
                 print_result(D_EVP, testnum, count, d);
                 if (count < 0)
@@ -2909,7 +3120,10 @@ skip_hmac:
                                rsa_keys[testnum].bits, seconds.rsa);
             /* RSA_blinding_on(rsa_key[testnum],NULL); */
             Time_F(START);
-            count = run_benchmark(async_jobs, RSA_sign_loop, loopargs);
+            count = run_benchmark(async_jobs,
+                                  evp_md_batch > 0 ? RSA_sign_batch_loop
+                                                   : RSA_sign_loop,
+                                  loopargs);
             d = Time_F(STOP);
             BIO_printf(bio_err,
                        mr ? "+R1:%ld:%d:%.2f\n"
@@ -3126,7 +3340,10 @@ skip_hmac:
             pkey_print_message("sign", "ecdsa",
                                ec_curves[testnum].bits, seconds.ecdsa);
             Time_F(START);
-            count = run_benchmark(async_jobs, ECDSA_sign_loop, loopargs);
+            count = run_benchmark(async_jobs,
+                                  evp_md_batch > 0 ? ECDSA_sign_batch_loop
+                                                   : ECDSA_sign_loop,
+                                  loopargs);
             d = Time_F(STOP);
             BIO_printf(bio_err,
                        mr ? "+R7:%ld:%u:%.2f\n"
@@ -3231,10 +3448,10 @@ skip_hmac:
             }
 
             loopargs[i].ecdh_ctx[testnum] = ctx;
+            loopargs[i].ecdh_peer[testnum] = key_B;
             loopargs[i].outlen[testnum] = outlen;
 
             EVP_PKEY_free(key_A);
-            EVP_PKEY_free(key_B);
             EVP_PKEY_CTX_free(test_ctx);
             test_ctx = NULL;
         }
@@ -3243,7 +3460,10 @@ skip_hmac:
                                ec_curves[testnum].bits, seconds.ecdh);
             Time_F(START);
             count =
-                run_benchmark(async_jobs, ECDH_EVP_derive_key_loop, loopargs);
+                run_benchmark(async_jobs,
+                              evp_md_batch > 0 ? ECDH_EVP_derive_key_batch_loop
+                                               : ECDH_EVP_derive_key_loop,
+                              loopargs);
             d = Time_F(STOP);
             BIO_printf(bio_err,
                        mr ? "+R9:%ld:%d:%.2f\n" :
@@ -3356,7 +3576,10 @@ skip_hmac:
                 pkey_print_message("verify", ed_curves[testnum].name,
                                    ed_curves[testnum].bits, seconds.eddsa);
                 Time_F(START);
-                count = run_benchmark(async_jobs, EdDSA_verify_loop, loopargs);
+                count = run_benchmark(async_jobs,
+                                      evp_md_batch > 0 ? EdDSA_verify_batch_loop
+                                                       : EdDSA_verify_loop,
+                                      loopargs);
                 d = Time_F(STOP);
                 BIO_printf(bio_err,
                            mr ? "+R11:%ld:%u:%s:%.2f\n"
@@ -4310,8 +4533,10 @@ skip_hmac:
             EVP_PKEY_CTX_free(loopargs[i].ecdsa_sign_ctx[k]);
             EVP_PKEY_CTX_free(loopargs[i].ecdsa_verify_ctx[k]);
         }
-        for (k = 0; k < EC_NUM; k++)
+        for (k = 0; k < EC_NUM; k++) {
             EVP_PKEY_CTX_free(loopargs[i].ecdh_ctx[k]);
+            EVP_PKEY_free(loopargs[i].ecdh_peer[k]);
+        }
 #ifndef OPENSSL_NO_ECX
         for (k = 0; k < EdDSA_NUM; k++) {
             EVP_MD_CTX_free(loopargs[i].eddsa_ctx[k]);
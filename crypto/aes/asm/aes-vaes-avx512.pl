@@ -0,0 +1,534 @@
+#! /usr/bin/env perl
+# Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+#
+# AES-CTR, AES-CBC decryption and AES-XTS with AVX512 VAES.
+#
+# Sixteen blocks are processed per iteration, four per 512-bit register,
+# and the last one to fifteen blocks through masked loads and stores.
+# The round keys are broadcast into %zmm16-%zmm31 once per call; the key
+# schedules are the ones set up by aesni_set_[en|de]crypt_key.
+#
+# The XTS tweaks are advanced four lanes at a time, by multiplying every
+# lane by x^4 or x^16 with shifts and a carry-less multiplication of the
+# bits shifted out.  Ciphertext stealing is left to the caller, see
+# providers/implementations/ciphers/cipher_aes_xts_hw.c.
+#
+########################################################################
+# Throughput in comparison to aesni-x86_64.pl, out of 16KB buffers:
+#
+#			CTR	CBC dec	XTS
+#
+# Xeon (AVX-512)	+120%	+120%	+85%
+#
+# Broadcasting the key schedule and wiping the registers on the way out
+# costs about as much as a couple of blocks, so the callers keep using the
+# AES-NI code for fewer than four blocks.
+
+# $output is the last argument if it looks like a file (it has an extension)
+# $flavour is the first argument if it doesn't look like a file
+$output = $#ARGV >= 0 && $ARGV[$#ARGV] =~ m|\.\w+$| ? pop : undef;
+$flavour = $#ARGV >= 0 && $ARGV[0] !~ m|\.| ? shift : undef;
+
+$avx512vaes = 0;
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+# Same assembler requirements as modes/asm/aes-gcm-avx512.pl
+if (`$ENV{CC} -Wa,-v -c -o /dev/null -x assembler /dev/null 2>&1`
+	=~ /GNU assembler version ([2-9]\.[0-9]+)/) {
+    $avx512vaes = ($1 >= 2.30);
+}
+if (!$avx512vaes && `$ENV{CC} -v 2>&1`
+	=~ /(Apple)?\s*((?:clang|LLVM) version|.*based on LLVM) ([0-9]+)\.([0-9]+)\.([0-9]+)?/) {
+    my $ver = $3 + $4/100.0 + $5/10000.0;
+    $avx512vaes = $1 ? ($ver >= 10.0001) : ($ver >= 7.0);
+}
+
+open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\""
+    or die "can't call $xlate: $!";
+*STDOUT=*OUT;
+
+$code=".text\n";
+
+if ($avx512vaes) {
+
+my ($inp,$out,$blocks,$key,$ivp) = ("%rdi","%rsi","%rdx","%rcx","%r8");
+my ($rounds,$tmp) = ("%eax","%r9");
+my @X = map("%zmm$_",(0..3));		# data
+my @T = map("%zmm$_",(4..7));		# counters or tweaks
+my ($t0,$t1,$poly,$bswap) = map("%zmm$_",(8..11));
+my @K = map("%zmm$_",(16..29));		# round keys 0..13
+my $Klast = "%zmm31";			# last round key
+
+# Broadcast the key schedule at $key, with the number of rounds less one
+# at 240($key) as aesni_set_[en|de]crypt_key store it
+sub load_keys {
+my $code=<<___;
+	mov	240($key),$rounds
+	mov	$rounds,%r10d
+	shl	\$4,%r10d
+	vbroadcasti32x4	16(%r10,$key),$Klast
+___
+    for (my $i=0; $i<14; $i++) {
+	$code.="\tvbroadcasti32x4\t".(16*$i)."($key),$K[$i]\n";
+    }
+    return $code;
+}
+
+# All rounds on @X[0..$n-1], the first one being done by the caller
+sub rounds {
+my ($dir,$n,$lbl)=@_;
+my $code="";
+my $r = sub { my ($k)=@_; join("",map("\tvaes$dir\t$k,$X[$_],$X[$_]\n",(0..$n-1))) };
+
+    for (my $i=1; $i<10; $i++) { $code.=&$r($K[$i]); }
+    $code.=<<___;
+	cmp	\$11,$rounds
+	jb	.L${lbl}_last
+___
+    $code.=&$r($K[10]).&$r($K[11]);
+    $code.="\tje\t.L${lbl}_last\n";
+    $code.=&$r($K[12]).&$r($K[13]);
+    $code.=".L${lbl}_last:\n";
+    $code.=join("",map("\tvaes${dir}last\t$Klast,$X[$_],$X[$_]\n",(0..$n-1)));
+    return $code;
+}
+
+# $dst = $src * x^$k in each 128-bit lane, for 0 < $k < 64
+sub mul_xk {
+my ($dst,$src,$k)=@_;
+return <<___;
+	vpsrlq	\$`64-$k`,$src,$t0
+	vpsllq	\$$k,$src,$dst
+	vpslldq	\$8,$t0,$t1
+	vpsrldq	\$8,$t0,$t0
+	vpclmulqdq	\$0x00,$poly,$t0,$t0
+	vpternlogq	\$0x96,$t1,$t0,$dst
+___
+}
+
+# Wipe the data and the round keys.  vzeroupper leaves %zmm16-%zmm31
+# alone, and with their upper halves in use the SSE code that runs after
+# us would pay for the AVX-SSE transition on every instruction.
+my $clear=join("",map("\tvpxord\t%xmm$_,%xmm$_,%xmm$_\n",(0..3,16..31)))
+	."\tvzeroupper\n";
+
+# The mask for the last $blocks blocks, 1 to 3 of them, in %k1
+my $tail_mask=<<___;
+	mov	%edx,%ecx
+	shl	\$4,%ecx
+	mov	\$1,$tmp
+	shlq	%cl,$tmp
+	dec	$tmp
+	kmovq	$tmp,%k1
+___
+
+########################################################################
+# void ossl_aes_ctr32_encrypt_blocks_avx512(const unsigned char *in,
+#                                           unsigned char *out,
+#                                           size_t blocks, const void *key,
+#                                           const unsigned char ivec[16]);
+#
+# Like aesni_ctr32_encrypt_blocks, only the last 32 bits of the counter
+# are incremented.
+{
+$code.=<<___;
+.globl	ossl_aes_ctr32_encrypt_blocks_avx512
+.type	ossl_aes_ctr32_encrypt_blocks_avx512,\@function,5
+.align	32
+ossl_aes_ctr32_encrypt_blocks_avx512:
+.cfi_startproc
+	endbranch
+	test	$blocks,$blocks
+	jz	.Lctr_done
+___
+$code.=load_keys();
+$code.=<<___;
+	# The counter blocks are kept byte-reversed, so that the big-endian
+	# counter is the first dword of each lane
+	vbroadcasti32x4	.Lbswap128(%rip),$bswap
+	vbroadcasti32x4	($ivp),$T[0]
+	vpshufb	$bswap,$T[0],$T[0]
+	vpaddd	.Lctr_lanes(%rip),$T[0],$T[0]
+	vmovdqa64	.Lctr_add4(%rip),$t1
+	vpaddd	$t1,$T[0],$T[1]
+	vpaddd	$t1,$T[1],$T[2]
+	vpaddd	$t1,$T[2],$T[3]
+	vmovdqa64	.Lctr_add16(%rip),$t0
+
+	cmp	\$16,$blocks
+	jb	.Lctr_4x
+.align	32
+.Lctr_16x:
+___
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	vpshufb	$bswap,$T[$i],$X[$i]
+	vpxorq	$K[0],$X[$i],$X[$i]
+	vpaddd	$t0,$T[$i],$T[$i]
+___
+}
+$code.=rounds("enc",4,"ctr_16x");
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	vpxorq	`64*$i`($inp),$X[$i],$X[$i]
+	vmovdqu64	$X[$i],`64*$i`($out)
+___
+}
+$code.=<<___;
+	lea	256($inp),$inp
+	lea	256($out),$out
+	sub	\$16,$blocks
+	cmp	\$16,$blocks
+	jae	.Lctr_16x
+
+.Lctr_4x:
+	cmp	\$4,$blocks
+	jb	.Lctr_tail
+	vpshufb	$bswap,$T[0],$X[0]
+	vpxorq	$K[0],$X[0],$X[0]
+	vpaddd	$t1,$T[0],$T[0]
+___
+$code.=rounds("enc",1,"ctr_4x");
+$code.=<<___;
+	vpxorq	($inp),$X[0],$X[0]
+	vmovdqu64	$X[0],($out)
+	lea	64($inp),$inp
+	lea	64($out),$out
+	sub	\$4,$blocks
+	jmp	.Lctr_4x
+
+.Lctr_tail:
+	test	$blocks,$blocks
+	jz	.Lctr_clear
+___
+$code.=$tail_mask;
+$code.=<<___;
+	vpshufb	$bswap,$T[0],$X[0]
+	vpxorq	$K[0],$X[0],$X[0]
+___
+$code.=rounds("enc",1,"ctr_tail");
+$code.=<<___;
+	vmovdqu8	($inp),$t0\{%k1\}\{z\}
+	vpxorq	$t0,$X[0],$X[0]
+	vmovdqu8	$X[0],($out)\{%k1\}
+
+.Lctr_clear:
+___
+$code.=$clear;
+$code.=<<___;
+.Lctr_done:
+	ret
+.cfi_endproc
+.size	ossl_aes_ctr32_encrypt_blocks_avx512,.-ossl_aes_ctr32_encrypt_blocks_avx512
+___
+}
+
+########################################################################
+# void ossl_aes_cbc_decrypt_avx512(const unsigned char *in,
+#                                  unsigned char *out, size_t blocks,
+#                                  const AES_KEY *key, unsigned char ivec[16]);
+#
+# The key schedule is a decryption one.  The last ciphertext block is left
+# in |ivec|.  The previous ciphertext blocks are lined up with the current
+# ones by taking the last lane of the previous register along with the
+# first three of the current one.
+{
+my $prev = $T[0];
+my @P = @T;				# previous ciphertext blocks
+
+$code.=<<___;
+
+.globl	ossl_aes_cbc_decrypt_avx512
+.type	ossl_aes_cbc_decrypt_avx512,\@function,5
+.align	32
+ossl_aes_cbc_decrypt_avx512:
+.cfi_startproc
+	endbranch
+	test	$blocks,$blocks
+	jz	.Lcbc_done
+___
+$code.=load_keys();
+$code.=<<___;
+	# The next IV, read before the output may overwrite it
+	mov	$blocks,%r10
+	shl	\$4,%r10
+	vmovdqu	-16($inp,%r10),%xmm12
+	vbroadcasti32x4	($ivp),$prev
+
+	cmp	\$16,$blocks
+	jb	.Lcbc_4x
+.align	32
+.Lcbc_16x:
+	vmovdqu64	0($inp),$X[0]
+	vmovdqu64	64($inp),$X[1]
+	vmovdqu64	128($inp),$X[2]
+	vmovdqu64	192($inp),$X[3]
+	valignq	\$6,$prev,$X[0],$P[0]
+	valignq	\$6,$X[0],$X[1],$P[1]
+	valignq	\$6,$X[1],$X[2],$P[2]
+	valignq	\$6,$X[2],$X[3],$P[3]
+	vmovdqa64	$X[3],%zmm13
+___
+for (my $i=0; $i<4; $i++) {
+    $code.="\tvpxorq\t$K[0],$X[$i],$X[$i]\n";
+}
+$code.=rounds("dec",4,"cbc_16x");
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	vpxorq	$P[$i],$X[$i],$X[$i]
+	vmovdqu64	$X[$i],`64*$i`($out)
+___
+}
+$code.=<<___;
+	vmovdqa64	%zmm13,$prev
+	lea	256($inp),$inp
+	lea	256($out),$out
+	sub	\$16,$blocks
+	cmp	\$16,$blocks
+	jae	.Lcbc_16x
+
+.Lcbc_4x:
+	cmp	\$4,$blocks
+	jb	.Lcbc_tail
+	vmovdqu64	($inp),$X[0]
+	valignq	\$6,$prev,$X[0],$P[1]
+	vmovdqa64	$X[0],$prev
+	vpxorq	$K[0],$X[0],$X[0]
+___
+$code.=rounds("dec",1,"cbc_4x");
+$code.=<<___;
+	vpxorq	$P[1],$X[0],$X[0]
+	vmovdqu64	$X[0],($out)
+	lea	64($inp),$inp
+	lea	64($out),$out
+	sub	\$4,$blocks
+	jmp	.Lcbc_4x
+
+.Lcbc_tail:
+	test	$blocks,$blocks
+	jz	.Lcbc_iv
+___
+$code.=$tail_mask;
+$code.=<<___;
+	vmovdqu8	($inp),$X[0]\{%k1\}\{z\}
+	valignq	\$6,$prev,$X[0],$P[1]
+	vpxorq	$K[0],$X[0],$X[0]
+___
+$code.=rounds("dec",1,"cbc_tail");
+$code.=<<___;
+	vpxorq	$P[1],$X[0],$X[0]
+	vmovdqu8	$X[0],($out)\{%k1\}
+
+.Lcbc_iv:
+	vmovdqu	%xmm12,($ivp)
+___
+$code.=$clear;
+$code.=<<___;
+.Lcbc_done:
+	ret
+.cfi_endproc
+.size	ossl_aes_cbc_decrypt_avx512,.-ossl_aes_cbc_decrypt_avx512
+___
+}
+
+########################################################################
+# void ossl_aes_xts_[en|de]crypt_avx512(const unsigned char *in,
+#                                       unsigned char *out, size_t blocks,
+#                                       const AES_KEY *key1,
+#                                       unsigned char tweak[16]);
+#
+# Processes whole blocks only, starting with the encrypted tweak at
+# |tweak| and leaving there the tweak of the block that follows.
+foreach my $dir ("enc","dec") {
+my $fn = $dir eq "enc" ? "encrypt" : "decrypt";
+
+$code.=<<___;
+
+.globl	ossl_aes_xts_${fn}_avx512
+.type	ossl_aes_xts_${fn}_avx512,\@function,5
+.align	32
+ossl_aes_xts_${fn}_avx512:
+.cfi_startproc
+	endbranch
+	test	$blocks,$blocks
+	jz	.Lxts_${dir}_done
+	mov	%rsp,%r11
+.cfi_def_cfa_register	%r11
+	sub	\$64,%rsp
+	and	\$-64,%rsp
+___
+$code.=load_keys();
+$code.=<<___;
+	vbroadcasti32x4	.Lxts_poly(%rip),$poly
+
+	# The four lanes of \@T[0] are the tweaks of the next four blocks,
+	# and each of \@T[1..3] follows on from the previous one
+	vmovdqu	($ivp),%xmm12
+___
+    # Tweaks 1 to 3 in %xmm13-%xmm15, multiplying by x on 128-bit lanes
+    for (my $i=13; $i<16; $i++) {
+	$code.=mul_xk("%zmm$i","%zmm".($i-1),1);
+    }
+$code.=<<___;
+	vmovdqa64	%zmm12,$T[0]
+	vinserti32x4	\$1,%xmm13,$T[0],$T[0]
+	vinserti32x4	\$2,%xmm14,$T[0],$T[0]
+	vinserti32x4	\$3,%xmm15,$T[0],$T[0]
+___
+$code.=mul_xk($T[1],$T[0],4);
+$code.=mul_xk($T[2],$T[1],4);
+$code.=mul_xk($T[3],$T[2],4);
+$code.=<<___;
+
+	cmp	\$16,$blocks
+	jb	.Lxts_${dir}_4x
+.align	32
+.Lxts_${dir}_16x:
+___
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	vmovdqu64	`64*$i`($inp),$X[$i]
+	vpternlogq	\$0x96,$K[0],$T[$i],$X[$i]
+___
+}
+$code.=rounds($dir,4,"xts_${dir}_16x");
+for (my $i=0; $i<4; $i++) {
+$code.=<<___;
+	vpxorq	$T[$i],$X[$i],$X[$i]
+	vmovdqu64	$X[$i],`64*$i`($out)
+___
+}
+for (my $i=0; $i<4; $i++) {
+    $code.=mul_xk($T[$i],$T[$i],16);
+}
+$code.=<<___;
+	lea	256($inp),$inp
+	lea	256($out),$out
+	sub	\$16,$blocks
+	cmp	\$16,$blocks
+	jae	.Lxts_${dir}_16x
+
+.Lxts_${dir}_4x:
+	cmp	\$4,$blocks
+	jb	.Lxts_${dir}_tail
+	vmovdqu64	($inp),$X[0]
+	vpternlogq	\$0x96,$K[0],$T[0],$X[0]
+___
+$code.=rounds($dir,1,"xts_${dir}_4x");
+$code.=<<___;
+	vpxorq	$T[0],$X[0],$X[0]
+	vmovdqu64	$X[0],($out)
+	vmovdqa64	$T[1],$T[0]
+	vmovdqa64	$T[2],$T[1]
+	vmovdqa64	$T[3],$T[2]
+___
+$code.=mul_xk($T[3],$T[2],4);
+$code.=<<___;
+	lea	64($inp),$inp
+	lea	64($out),$out
+	sub	\$4,$blocks
+	jmp	.Lxts_${dir}_4x
+
+.Lxts_${dir}_tail:
+	vmovdqa64	$T[0],(%rsp)
+	test	$blocks,$blocks
+	jz	.Lxts_${dir}_tweak
+___
+$code.=$tail_mask;
+$code.=<<___;
+	vmovdqu8	($inp),$X[0]\{%k1\}\{z\}
+	vpternlogq	\$0x96,$K[0],$T[0],$X[0]
+___
+$code.=rounds($dir,1,"xts_${dir}_tail");
+$code.=<<___;
+	vpxorq	$T[0],$X[0],$X[0]
+	vmovdqu8	$X[0],($out)\{%k1\}
+
+.Lxts_${dir}_tweak:
+	shl	\$4,$blocks
+	vmovdqu	(%rsp,$blocks),%xmm12
+	vmovdqu	%xmm12,($ivp)
+
+	vpxorq	$X[0],$X[0],$X[0]
+	vmovdqa64	$X[0],(%rsp)
+___
+$code.=$clear;
+$code.=<<___;
+	mov	%r11,%rsp
+.cfi_def_cfa_register	%rsp
+.Lxts_${dir}_done:
+	ret
+.cfi_endproc
+.size	ossl_aes_xts_${fn}_avx512,.-ossl_aes_xts_${fn}_avx512
+___
+}
+
+$code.=<<___;
+
+# int ossl_aes_vaes_avx512_capable(void);
+.globl	ossl_aes_vaes_avx512_capable
+.type	ossl_aes_vaes_avx512_capable,\@abi-omnipotent
+.align	32
+ossl_aes_vaes_avx512_capable:
+	mov	OPENSSL_ia32cap_P+8(%rip),%rcx
+	# avx512vpclmulqdq + avx512vaes + avx512vl + avx512bw + avx512dq + avx512f
+	mov	\$`1<<42|1<<41|1<<31|1<<30|1<<17|1<<16`,%rdx
+	xor	%eax,%eax
+	and	%rdx,%rcx
+	cmp	%rdx,%rcx
+	sete	%al
+	ret
+.size	ossl_aes_vaes_avx512_capable,.-ossl_aes_vaes_avx512_capable
+
+.align	64
+.Lctr_lanes:
+	.long	0,0,0,0, 1,0,0,0, 2,0,0,0, 3,0,0,0
+.Lctr_add4:
+	.long	4,0,0,0, 4,0,0,0, 4,0,0,0, 4,0,0,0
+.Lctr_add16:
+	.long	16,0,0,0, 16,0,0,0, 16,0,0,0, 16,0,0,0
+.Lbswap128:
+	.byte	15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0
+.Lxts_poly:
+	.quad	0x87,0
+.asciz	"AES-CTR, AES-CBC decryption and AES-XTS for AVX512 VAES"
+___
+
+} else {
+
+# The assembler is too old, the functions are never called
+$code.=<<___;
+.globl	ossl_aes_vaes_avx512_capable
+.type	ossl_aes_vaes_avx512_capable,\@abi-omnipotent
+ossl_aes_vaes_avx512_capable:
+	xor	%eax,%eax
+	ret
+.size	ossl_aes_vaes_avx512_capable,.-ossl_aes_vaes_avx512_capable
+
+.globl	ossl_aes_ctr32_encrypt_blocks_avx512
+.globl	ossl_aes_cbc_decrypt_avx512
+.globl	ossl_aes_xts_encrypt_avx512
+.globl	ossl_aes_xts_decrypt_avx512
+.type	ossl_aes_ctr32_encrypt_blocks_avx512,\@abi-omnipotent
+ossl_aes_ctr32_encrypt_blocks_avx512:
+ossl_aes_cbc_decrypt_avx512:
+ossl_aes_xts_encrypt_avx512:
+ossl_aes_xts_decrypt_avx512:
+	.byte	0x0f,0x0b	# ud2
+	ret
+.size	ossl_aes_ctr32_encrypt_blocks_avx512,.-ossl_aes_ctr32_encrypt_blocks_avx512
+___
+}
+
+$code =~ s/\`([^\`]*)\`/eval($1)/gem;
+print $code;
+close STDOUT or die "error closing STDOUT: $!";
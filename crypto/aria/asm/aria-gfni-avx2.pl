@@ -0,0 +1,528 @@
+#! /usr/bin/env perl
+# Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+#
+# ARIA-ECB and ARIA-CTR with AVX2 and GFNI.
+#
+# Sixteen blocks are processed per iteration, as two groups of eight.
+# The blocks are transposed so that each 256-bit register holds the same
+# word of eight blocks.  The rounds then follow crypto/aria/aria.c: the
+# word-level diffusion is a few XORs of whole registers and the byte-level
+# one is a byte shuffle of three of them.
+#
+# The four S-boxes are computed without tables.  S1 is the one of AES, S2
+# is an affine transform of x^247, and X1 and X2 are their inverses, so
+# all of them are one vgf2p8affineinvqb, preceded by a vgf2p8affineqb for
+# X1 and X2.  The results are merged with byte blends, as every word has
+# one byte of each S-box.  The key schedules are the ones set up by
+# ossl_aria_set_[en|de]crypt_key.
+#
+########################################################################
+# Throughput in comparison to the table-based C code, out of 16KB
+# buffers:
+#
+#			ECB	CTR
+#
+# Xeon (GFNI)		x6.7	x7.6
+#
+# Fewer than sixteen blocks are run through the same code from a buffer
+# on the stack, so short inputs cost as much as sixteen blocks.
+
+# $output is the last argument if it looks like a file (it has an extension)
+# $flavour is the first argument if it doesn't look like a file
+$output = $#ARGV >= 0 && $ARGV[$#ARGV] =~ m|\.\w+$| ? pop : undef;
+$flavour = $#ARGV >= 0 && $ARGV[0] !~ m|\.| ? shift : undef;
+
+$gfni = 0;
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+# Same assembler requirements as crypto/sm4/asm/sm4-gfni-avx2.pl
+if (`$ENV{CC} -Wa,-v -c -o /dev/null -x assembler /dev/null 2>&1`
+	=~ /GNU assembler version ([2-9]\.[0-9]+)/) {
+    $gfni = ($1 >= 2.30);
+}
+if (!$gfni && `$ENV{CC} -v 2>&1`
+	=~ /(Apple)?\s*((?:clang|LLVM) version|.*based on LLVM) ([0-9]+)\.([0-9]+)\.([0-9]+)?/) {
+    my $ver = $3 + $4/100.0 + $5/10000.0;
+    $gfni = $1 ? ($ver >= 10.0001) : ($ver >= 6.0);
+}
+
+open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\""
+    or die "can't call $xlate: $!";
+*STDOUT=*OUT;
+
+$code=".text\n";
+
+if ($gfni) {
+
+my ($inp,$out,$len,$key,$ivp) = ("%rdi","%rsi","%rdx","%rcx","%r8");
+my ($rk,$ctr) = ("%r10","%r9d");
+my @X = map("%ymm$_",(0..7));		# two groups of four words
+my ($ta,$tb,$K) = map("%ymm$_",(8..10));
+my ($ODD,$HI,$R8,$R16) = map("%ymm$_",(11..14));
+
+# Transpose the 4x4 words in each 128-bit lane of four registers
+sub transpose {
+my ($x0,$x1,$x2,$x3,$t0,$t1)=@_;
+return <<___;
+	vpunpckldq	$x1,$x0,$t0
+	vpunpckhdq	$x1,$x0,$x0
+	vpunpckldq	$x3,$x2,$t1
+	vpunpckhdq	$x3,$x2,$x2
+	vpunpckhqdq	$t1,$t0,$x1
+	vpunpcklqdq	$t1,$t0,$t0
+	vpunpckhqdq	$x2,$x0,$x3
+	vpunpcklqdq	$x2,$x0,$x2
+	vmovdqa	$t0,$x0
+___
+}
+
+# Load sixteen blocks from $src, in the form _aria_gfni_avx2_16x takes
+sub load_16x {
+my ($src)=@_;
+my $code="\tvmovdqa\t.Lbswap32(%rip),$ta\n";
+    for (my $i=0; $i<8; $i++) {
+	$code.="\tvmovdqu\t".(32*$i)."($src),$X[$i]\n";
+	$code.="\tvpshufb\t$ta,$X[$i],$X[$i]\n";
+    }
+    $code.=transpose(@X[0..3],$ta,$tb);
+    $code.=transpose(@X[4..7],$ta,$tb);
+    return $code;
+}
+
+# XOR the round key at $rk into both groups
+sub add_round_key {
+my $code="";
+    for (my $i=0; $i<4; $i++) {
+	$code.=<<___;
+	vpbroadcastd	`4*$i`($rk),$K
+	vpxor	$K,$X[$i],$X[$i]
+	vpxor	$K,$X[4+$i],$X[4+$i]
+___
+    }
+    return $code;
+}
+
+# Substitution layer 1 or 2 on $z.  From the most significant byte of a
+# word down, layer 1 is S1, S2, X1, X2 and layer 2 is X1, X2, S1, S2.
+sub sbox_layer {
+my ($z,$layer)=@_;
+my $code=<<___;
+	vgf2p8affineqb	\$0x05,.Lx1_pre(%rip),$z,$ta
+	vgf2p8affineqb	\$0x2c,.Lx2_pre(%rip),$z,$tb
+	vpblendvb	$ODD,$ta,$tb,$tb
+	vgf2p8affineinvqb	\$0,.Lidentity(%rip),$tb,$tb
+	vgf2p8affineinvqb	\$0x63,.Ls1_post(%rip),$z,$ta
+	vgf2p8affineinvqb	\$0xe2,.Ls2_post(%rip),$z,$z
+	vpblendvb	$ODD,$ta,$z,$z
+___
+    $code.=$layer==1 ? "\tvpblendvb\t$HI,$z,$tb,$z\n"
+		     : "\tvpblendvb\t$HI,$tb,$z,$z\n";
+    return $code;
+}
+
+# The part of the diffusion the tables of aria.c do: every byte of $z
+# becomes the XOR of three bytes of its word.  It leaves out the byte
+# itself after layer 1, and the one two bytes away after layer 2.  With
+# t = z ^ (z <<< 16), that is z ^ t ^ (t <<< 8) and z ^ (t <<< 8).
+sub pre_diff {
+my ($z,$layer)=@_;
+my $code=<<___;
+	vpshufb	$R16,$z,$ta
+	vpxor	$z,$ta,$ta
+	vpshufb	$R8,$ta,$tb
+___
+    $code.="\tvpxor\t$ta,$z,$z\n" if ($layer==1);
+    $code.="\tvpxor\t$tb,$z,$z\n";
+    return $code;
+}
+
+sub diff_word {
+my ($t0,$t1,$t2,$t3)=@_;
+return <<___;
+	vpxor	$t2,$t1,$t1
+	vpxor	$t3,$t2,$t2
+	vpxor	$t1,$t0,$t0
+	vpxor	$t1,$t3,$t3
+	vpxor	$t0,$t2,$t2
+	vpxor	$t2,$t1,$t1
+___
+}
+
+sub diff_byte {
+my ($t0,$t1,$t2,$t3)=@_;
+return <<___;
+	vpshufb	.Lswap16(%rip),$t1,$t1
+	vpshufb	$R16,$t2,$t2
+	vpshufb	.Lbswap32(%rip),$t3,$t3
+___
+}
+
+# One odd or even round, without the round key
+sub subst_diff {
+my ($layer)=@_;
+my $code="";
+    for (my $i=0; $i<8; $i++) {
+	$code.=sbox_layer($X[$i],$layer).pre_diff($X[$i],$layer);
+    }
+    for (my $g=0; $g<8; $g+=4) {
+	my @t=@X[$g..$g+3];
+	$code.=diff_word(@t);
+	$code.=$layer==1 ? diff_byte(@t) : diff_byte(@t[2,3,0,1]);
+	$code.=diff_word(@t);
+    }
+    return $code;
+}
+
+########################################################################
+# All the rounds on the sixteen blocks in @X, with the key schedule at
+# %r11.  On entry @X[$j] holds word $j of blocks 0, 2, 4 and 6 in its
+# low lane and of blocks 1, 3, 5 and 7 in its high lane, as native
+# integers, and @X[4+$j] the same for blocks 8 to 15.  On return @X hold
+# the blocks in memory order.
+$code.=<<___;
+.type	_aria_gfni_avx2_16x,\@abi-omnipotent
+.align	32
+_aria_gfni_avx2_16x:
+.cfi_startproc
+	vmovdqa	.Lodd(%rip),$ODD
+	vmovdqa	.Lhi(%rip),$HI
+	vmovdqa	.Lrol8(%rip),$R8
+	vmovdqa	.Lrol16(%rip),$R16
+	mov	272(%r11),%eax		# rounds
+	mov	%r11,$rk
+___
+$code.=add_round_key();
+$code.="\tlea\t16($rk),$rk\n";
+$code.=subst_diff(1);
+$code.=add_round_key();
+$code.=<<___;
+	lea	16($rk),$rk
+	sub	\$2,%eax
+.align	16
+.Laria_rounds:
+___
+$code.=subst_diff(2);
+$code.=add_round_key();
+$code.="\tlea\t16($rk),$rk\n";
+$code.=subst_diff(1);
+$code.=add_round_key();
+$code.=<<___;
+	lea	16($rk),$rk
+	sub	\$2,%eax
+	jnz	.Laria_rounds
+
+	# The last round is the substitution layer 2 only
+___
+for (my $i=0; $i<8; $i++) {
+    $code.=sbox_layer($X[$i],2);
+}
+$code.=add_round_key();
+$code.=transpose(@X[0..3],$ta,$tb);
+$code.=transpose(@X[4..7],$ta,$tb);
+$code.="\tvmovdqa\t.Lbswap32(%rip),$ta\n";
+for (my $i=0; $i<8; $i++) {
+    $code.="\tvpshufb\t$ta,$X[$i],$X[$i]\n";
+}
+$code.=<<___;
+	ret
+.cfi_endproc
+.size	_aria_gfni_avx2_16x,.-_aria_gfni_avx2_16x
+___
+
+# Wipe the block buffer on the stack and all the vector registers
+my $wipe_stack = sub {
+my ($bytes)=@_;
+my $code="\tvpxor\t$ta,$ta,$ta\n";
+    for (my $i=0; $i<$bytes; $i+=32) {
+	$code.="\tvmovdqa\t$ta,$i(%rsp)\n";
+    }
+    return $code."\tvzeroall\n";
+};
+
+########################################################################
+# void ossl_aria_gfni_avx2_ecb_encrypt(const unsigned char *in,
+#                                      unsigned char *out, size_t len,
+#                                      const ARIA_KEY *key, const int enc);
+#
+# |len| is a multiple of the block size.  Like ossl_aria_encrypt, it
+# decrypts with a decryption key schedule, |enc| is ignored.
+{
+$code.=<<___;
+.globl	ossl_aria_gfni_avx2_ecb_encrypt
+.type	ossl_aria_gfni_avx2_ecb_encrypt,\@function,5
+.align	32
+ossl_aria_gfni_avx2_ecb_encrypt:
+.cfi_startproc
+	endbranch
+	shr	\$4,$len
+	jz	.Lecb_done
+	push	%rbp
+.cfi_push	%rbp
+	mov	%rsp,%rbp
+.cfi_def_cfa_register	%rbp
+	sub	\$256,%rsp
+	and	\$-32,%rsp
+	mov	$key,%r11
+	cmp	\$16,$len
+	jb	.Lecb_tail
+.align	16
+.Lecb_16x:
+___
+$code.=load_16x($inp);
+$code.="\tcall\t_aria_gfni_avx2_16x\n";
+for (my $i=0; $i<8; $i++) {
+    $code.="\tvmovdqu\t$X[$i],".(32*$i)."($out)\n";
+}
+$code.=<<___;
+	lea	256($inp),$inp
+	lea	256($out),$out
+	sub	\$16,$len
+	cmp	\$16,$len
+	jae	.Lecb_16x
+
+.Lecb_tail:
+	test	$len,$len
+	jz	.Lecb_wipe
+	# Run the last blocks from (%rsp)
+	shl	\$4,$len
+	xor	%eax,%eax
+	vpxor	$ta,$ta,$ta
+___
+for (my $i=0; $i<256; $i+=32) {
+    $code.="\tvmovdqa\t$ta,$i(%rsp)\n";
+}
+$code.=<<___;
+.Lecb_tail_in:
+	vmovdqu	($inp,%rax),%xmm0
+	vmovdqa	%xmm0,(%rsp,%rax)
+	add	\$16,%rax
+	cmp	$len,%rax
+	jb	.Lecb_tail_in
+___
+$code.=load_16x("%rsp");
+$code.="\tcall\t_aria_gfni_avx2_16x\n";
+for (my $i=0; $i<8; $i++) {
+    $code.="\tvmovdqa\t$X[$i],".(32*$i)."(%rsp)\n";
+}
+$code.=<<___;
+	xor	%eax,%eax
+.Lecb_tail_out:
+	vmovdqa	(%rsp,%rax),%xmm0
+	vmovdqu	%xmm0,($out,%rax)
+	add	\$16,%rax
+	cmp	$len,%rax
+	jb	.Lecb_tail_out
+
+.Lecb_wipe:
+___
+$code.=&$wipe_stack(256);
+$code.=<<___;
+	mov	%rbp,%rsp
+.cfi_def_cfa_register	%rsp
+	pop	%rbp
+.cfi_pop	%rbp
+.Lecb_done:
+	ret
+.cfi_endproc
+.size	ossl_aria_gfni_avx2_ecb_encrypt,.-ossl_aria_gfni_avx2_ecb_encrypt
+___
+}
+
+########################################################################
+# void ossl_aria_gfni_avx2_ctr32_encrypt_blocks(const unsigned char *in,
+#                                               unsigned char *out,
+#                                               size_t blocks,
+#                                               const void *key,
+#                                               const unsigned char ivec[16]);
+#
+# Like the other ctr32 functions, only the last 32 bits of the counter
+# are incremented.  The counter blocks are built transposed, so the
+# counter is the fourth word and the first three are the same in all of
+# them.
+{
+$code.=<<___;
+.globl	ossl_aria_gfni_avx2_ctr32_encrypt_blocks
+.type	ossl_aria_gfni_avx2_ctr32_encrypt_blocks,\@function,5
+.align	32
+ossl_aria_gfni_avx2_ctr32_encrypt_blocks:
+.cfi_startproc
+	endbranch
+	test	$len,$len
+	jz	.Lctr_done
+	push	%rbp
+.cfi_push	%rbp
+	mov	%rsp,%rbp
+.cfi_def_cfa_register	%rbp
+	sub	\$288,%rsp
+	and	\$-32,%rsp
+	mov	$key,%r11
+
+	# 256(%rsp): the first three words of the counter block
+	mov	0($ivp),%eax
+	bswap	%eax
+	mov	%eax,256(%rsp)
+	mov	4($ivp),%eax
+	bswap	%eax
+	mov	%eax,260(%rsp)
+	mov	8($ivp),%eax
+	bswap	%eax
+	mov	%eax,264(%rsp)
+	mov	12($ivp),$ctr
+	bswap	$ctr
+
+.align	16
+.Lctr_16x:
+	vpbroadcastd	256(%rsp),$X[0]
+	vpbroadcastd	260(%rsp),$X[1]
+	vpbroadcastd	264(%rsp),$X[2]
+	vmovd	$ctr,%xmm3
+	vpbroadcastd	%xmm3,$X[3]
+	vmovdqa	$X[0],$X[4]
+	vmovdqa	$X[1],$X[5]
+	vmovdqa	$X[2],$X[6]
+	vpaddd	.Lctr_lanes+32(%rip),$X[3],$X[7]
+	vpaddd	.Lctr_lanes(%rip),$X[3],$X[3]
+	add	\$16,$ctr
+	call	_aria_gfni_avx2_16x
+	cmp	\$16,$len
+	jb	.Lctr_tail
+___
+for (my $i=0; $i<8; $i++) {
+$code.=<<___;
+	vpxor	`32*$i`($inp),$X[$i],$X[$i]
+	vmovdqu	$X[$i],`32*$i`($out)
+___
+}
+$code.=<<___;
+	lea	256($inp),$inp
+	lea	256($out),$out
+	sub	\$16,$len
+	jnz	.Lctr_16x
+	jmp	.Lctr_wipe
+
+.Lctr_tail:
+___
+for (my $i=0; $i<8; $i++) {
+    $code.="\tvmovdqa\t$X[$i],".(32*$i)."(%rsp)\n";
+}
+$code.=<<___;
+	shl	\$4,$len
+	xor	%eax,%eax
+.Lctr_tail_xor:
+	vmovdqu	($inp,%rax),%xmm0
+	vpxor	(%rsp,%rax),%xmm0,%xmm0
+	vmovdqu	%xmm0,($out,%rax)
+	add	\$16,%rax
+	cmp	$len,%rax
+	jb	.Lctr_tail_xor
+
+.Lctr_wipe:
+___
+$code.=&$wipe_stack(288);
+$code.=<<___;
+	mov	%rbp,%rsp
+.cfi_def_cfa_register	%rsp
+	pop	%rbp
+.cfi_pop	%rbp
+.Lctr_done:
+	ret
+.cfi_endproc
+.size	ossl_aria_gfni_avx2_ctr32_encrypt_blocks,.-ossl_aria_gfni_avx2_ctr32_encrypt_blocks
+___
+}
+
+$code.=<<___;
+
+# int ossl_aria_gfni_avx2_capable(void);
+.globl	ossl_aria_gfni_avx2_capable
+.type	ossl_aria_gfni_avx2_capable,\@abi-omnipotent
+.align	32
+ossl_aria_gfni_avx2_capable:
+	mov	OPENSSL_ia32cap_P+8(%rip),%rcx
+	# gfni + avx2
+	mov	\$`1<<40|1<<5`,%rdx
+	xor	%eax,%eax
+	and	%rdx,%rcx
+	cmp	%rdx,%rcx
+	sete	%al
+	ret
+.size	ossl_aria_gfni_avx2_capable,.-ossl_aria_gfni_avx2_capable
+
+.align	64
+# S1 and S2 are vgf2p8affineinvqb(0x63, s1_post) and (0xe2, s2_post),
+# X1 and X2 are vgf2p8affineinvqb(0, identity) of vgf2p8affineqb(0x05,
+# x1_pre) and (0x2c, x2_pre)
+.Ls1_post:
+	.quad	0xf1e3c78f1f3e7cf8,0xf1e3c78f1f3e7cf8
+	.quad	0xf1e3c78f1f3e7cf8,0xf1e3c78f1f3e7cf8
+.Ls2_post:
+	.quad	0xeafcb7c3c273c66f,0xeafcb7c3c273c66f
+	.quad	0xeafcb7c3c273c66f,0xeafcb7c3c273c66f
+.Lx1_pre:
+	.quad	0xa44992254a942952,0xa44992254a942952
+	.quad	0xa44992254a942952,0xa44992254a942952
+.Lx2_pre:
+	.quad	0x186450c737d6bdc9,0x186450c737d6bdc9
+	.quad	0x186450c737d6bdc9,0x186450c737d6bdc9
+.Lidentity:
+	.quad	0x0102040810204080,0x0102040810204080
+	.quad	0x0102040810204080,0x0102040810204080
+.Lodd:
+	.long	0xff00ff00,0xff00ff00,0xff00ff00,0xff00ff00
+	.long	0xff00ff00,0xff00ff00,0xff00ff00,0xff00ff00
+.Lhi:
+	.long	0xffff0000,0xffff0000,0xffff0000,0xffff0000
+	.long	0xffff0000,0xffff0000,0xffff0000,0xffff0000
+.Lbswap32:
+	.byte	3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12
+	.byte	3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12
+.Lswap16:
+	.byte	1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14
+	.byte	1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14
+.Lrol8:
+	.byte	3,0,1,2,7,4,5,6,11,8,9,10,15,12,13,14
+	.byte	3,0,1,2,7,4,5,6,11,8,9,10,15,12,13,14
+.Lrol16:
+	.byte	2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13
+	.byte	2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13
+# Block number of each counter word, see _aria_gfni_avx2_16x
+.Lctr_lanes:
+	.long	0,2,4,6,1,3,5,7
+	.long	8,10,12,14,9,11,13,15
+.asciz	"ARIA-ECB and ARIA-CTR for AVX2 and GFNI"
+___
+
+} else {
+
+# The assembler is too old, the functions are never called
+$code.=<<___;
+.globl	ossl_aria_gfni_avx2_capable
+.type	ossl_aria_gfni_avx2_capable,\@abi-omnipotent
+ossl_aria_gfni_avx2_capable:
+	xor	%eax,%eax
+	ret
+.size	ossl_aria_gfni_avx2_capable,.-ossl_aria_gfni_avx2_capable
+
+.globl	ossl_aria_gfni_avx2_ecb_encrypt
+.globl	ossl_aria_gfni_avx2_ctr32_encrypt_blocks
+.type	ossl_aria_gfni_avx2_ecb_encrypt,\@abi-omnipotent
+ossl_aria_gfni_avx2_ecb_encrypt:
+ossl_aria_gfni_avx2_ctr32_encrypt_blocks:
+	.byte	0x0f,0x0b	# ud2
+	ret
+.size	ossl_aria_gfni_avx2_ecb_encrypt,.-ossl_aria_gfni_avx2_ecb_encrypt
+___
+}
+
+$code =~ s/\`([^\`]*)\`/eval($1)/gem;
+print $code;
+close STDOUT or die "error closing STDOUT: $!";
@@ -1,4 +1,4 @@
-# Copyright 2020-2022 The OpenSSL Project Authors. All Rights Reserved.
+# Copyright 2020-2023 The OpenSSL Project Authors. All Rights Reserved.
 # Copyright (c) 2020, Intel Corporation. All Rights Reserved.
 #
 # Licensed under the Apache License 2.0 (the "License").  You may not use
@@ -204,12 +204,17 @@ ___
 # 2^52 representation.
 #
 # Uses %r8-14,%e[bcd]x
+#
+# An empty |$_acc| means that the accumulator is already in the low qword
+# of R0.
 sub amm52x20_x1_norm {
 my ($_acc,$_R0,$_R0h,$_R1,$_R1h,$_R2) = @_;
-$code.=<<___;
+$code.=<<___ if ($_acc ne "");
     # Put accumulator to low qword in R0
     vpbroadcastq    $_acc, $T0
     vpblendd \$3, $T0, $_R0, $_R0
+___
+$code.=<<___;
 
     # Extract "carries" (12 high bits) from each QW of R0..R2
     # Save them to LSB of QWs in T0..T2
@@ -508,6 +513,159 @@ $code.=<<___;
 .cfi_endproc
 .size   ossl_rsaz_amm52x20_x2_ifma256, .-ossl_rsaz_amm52x20_x2_ifma256
 ___
+
+###############################################################################
+# Quad Almost Montgomery Multiplication for 20-digit number in radix 2^52
+#
+# See description of ossl_rsaz_amm52x20_x1_ifma256() above for details about Almost
+# Montgomery Multiplication algorithm and function input parameters description.
+#
+# This function does four AMMs for four independent inputs.  A single AMM is
+# bound by the latency of the IFMA instructions, interleaving four of them
+# keeps more multiplications in flight.
+#
+# void ossl_rsaz_amm52x20_x4_ifma256(BN_ULONG out[4][20],
+#                                    const BN_ULONG a[4][20],
+#                                    const BN_ULONG b[4][20],
+#                                    const BN_ULONG m[4][20],
+#                                    const BN_ULONG k0[4]);
+###############################################################################
+{
+my $acc0_2 = "%r14";
+my $acc0_2_low = "%r14d";
+my $acc0_3 = "%rbp";
+my $acc0_3_low = "%ebp";
+my ($R0_2,$R0_2h,$R1_2,$R1_2h,$R2_2) = map("%ymm$_",(5..9));
+my ($R0_3,$R0_3h,$R1_3,$R1_3h,$R2_3) = map("%ymm$_",(10..14));
+my @lanes = ([$acc0_0,$R0_0,$R0_0h,$R1_0,$R1_0h,$R2_0],
+             [$acc0_1,$R0_1,$R0_1h,$R1_1,$R1_1h,$R2_1],
+             [$acc0_2,$R0_2,$R0_2h,$R1_2,$R1_2h,$R2_2],
+             [$acc0_3,$R0_3,$R0_3h,$R1_3,$R1_3h,$R2_3]);
+
+$code.=<<___;
+.text
+
+.globl  ossl_rsaz_amm52x20_x4_ifma256
+.type   ossl_rsaz_amm52x20_x4_ifma256,\@function,5
+.align 32
+ossl_rsaz_amm52x20_x4_ifma256:
+.cfi_startproc
+    endbranch
+    push    %rbx
+.cfi_push   %rbx
+    push    %rbp
+.cfi_push   %rbp
+    push    %r12
+.cfi_push   %r12
+    push    %r13
+.cfi_push   %r13
+    push    %r14
+.cfi_push   %r14
+    push    %r15
+.cfi_push   %r15
+___
+$code.=<<___ if ($win64);
+    lea     -168(%rsp),%rsp                 # 16*10 + (8 bytes to get correct 16-byte SIMD alignment)
+    vmovdqa64   %xmm6, `0*16`(%rsp)         # save non-volatile registers
+    vmovdqa64   %xmm7, `1*16`(%rsp)
+    vmovdqa64   %xmm8, `2*16`(%rsp)
+    vmovdqa64   %xmm9, `3*16`(%rsp)
+    vmovdqa64   %xmm10,`4*16`(%rsp)
+    vmovdqa64   %xmm11,`5*16`(%rsp)
+    vmovdqa64   %xmm12,`6*16`(%rsp)
+    vmovdqa64   %xmm13,`7*16`(%rsp)
+    vmovdqa64   %xmm14,`8*16`(%rsp)
+    vmovdqa64   %xmm15,`9*16`(%rsp)
+___
+$code.=<<___;
+.Lossl_rsaz_amm52x20_x4_ifma256_body:
+
+    # Zeroing accumulators
+    vpxord   $zero, $zero, $zero
+___
+foreach my $l (@lanes) {
+    foreach (@$l[1..5]) {
+        $code.="    vmovdqa64   $zero, $_\n";
+    }
+}
+$code.=<<___;
+
+    xorl    $acc0_0_low, $acc0_0_low
+    xorl    $acc0_1_low, $acc0_1_low
+    xorl    $acc0_2_low, $acc0_2_low
+    xorl    $acc0_3_low, $acc0_3_low
+
+    movq    $b, $b_ptr                       # backup address of b
+    movq    \$0xfffffffffffff, $mask52       # 52-bit mask
+
+    mov    \$20, $iter
+
+.align 32
+.Lloop20_x4:
+___
+    # 20*8 = offset of the next dimension in two-dimension array
+    foreach my $i (0..3) {
+        &amm52x20_x1(20*8*$i,20*8*$i,@{$lanes[$i]},8*$i."($k0)");
+    }
+$code.=<<___;
+    lea    8($b_ptr), $b_ptr
+    dec    $iter
+    jne    .Lloop20_x4
+___
+    # The normalization clobbers the accumulators of the last lanes, so put
+    # all of them into place first
+    foreach my $l (@lanes) {
+$code.=<<___;
+    vpbroadcastq    $$l[0], $T0
+    vpblendd \$3, $T0, $$l[1], $$l[1]
+___
+    }
+    foreach my $i (0..3) {
+        &amm52x20_x1_norm("",@{$lanes[$i]}[1..5]);
+        foreach (0..4) {
+            $code.="    vmovdqu64   ${$lanes[$i]}[$_+1], `($i*5+$_)*32`($res)\n";
+        }
+    }
+$code.=<<___;
+
+    vzeroupper
+    lea     (%rsp),%rax
+.cfi_def_cfa_register   %rax
+___
+$code.=<<___ if ($win64);
+    vmovdqa64   `0*16`(%rax),%xmm6
+    vmovdqa64   `1*16`(%rax),%xmm7
+    vmovdqa64   `2*16`(%rax),%xmm8
+    vmovdqa64   `3*16`(%rax),%xmm9
+    vmovdqa64   `4*16`(%rax),%xmm10
+    vmovdqa64   `5*16`(%rax),%xmm11
+    vmovdqa64   `6*16`(%rax),%xmm12
+    vmovdqa64   `7*16`(%rax),%xmm13
+    vmovdqa64   `8*16`(%rax),%xmm14
+    vmovdqa64   `9*16`(%rax),%xmm15
+    lea  168(%rsp),%rax
+___
+$code.=<<___;
+    mov  0(%rax),%r15
+.cfi_restore    %r15
+    mov  8(%rax),%r14
+.cfi_restore    %r14
+    mov  16(%rax),%r13
+.cfi_restore    %r13
+    mov  24(%rax),%r12
+.cfi_restore    %r12
+    mov  32(%rax),%rbp
+.cfi_restore    %rbp
+    mov  40(%rax),%rbx
+.cfi_restore    %rbx
+    lea  48(%rax),%rsp       # restore rsp
+.cfi_def_cfa %rsp,8
+.Lossl_rsaz_amm52x20_x4_ifma256_epilogue:
+    ret
+.cfi_endproc
+.size   ossl_rsaz_amm52x20_x4_ifma256, .-ossl_rsaz_amm52x20_x4_ifma256
+___
+}
 }
 
 ###############################################################################
@@ -693,6 +851,61 @@ rsaz_def_handler:
     ret
 .size   rsaz_def_handler,.-rsaz_def_handler
 
+.type   rsaz_avx_handler,\@abi-omnipotent
+.align  16
+rsaz_avx_handler:
+    push    %rsi
+    push    %rdi
+    push    %rbx
+    push    %rbp
+    push    %r12
+    push    %r13
+    push    %r14
+    push    %r15
+    pushfq
+    sub     \$64,%rsp
+
+    mov     120($context),%rax # pull context->Rax
+    mov     248($context),%rbx # pull context->Rip
+
+    mov     8($disp),%rsi      # disp->ImageBase
+    mov     56($disp),%r11     # disp->HandlerData
+
+    mov     0(%r11),%r10d      # HandlerData[0]
+    lea     (%rsi,%r10),%r10   # prologue label
+    cmp     %r10,%rbx          # context->Rip<.Lprologue
+    jb  .Lcommon_seh_tail
+
+    mov     4(%r11),%r10d      # HandlerData[1]
+    lea     (%rsi,%r10),%r10   # epilogue label
+    cmp     %r10,%rbx          # context->Rip>=.Lepilogue
+    jae     .Lcommon_seh_tail
+
+    mov     152($context),%rax # pull context->Rsp
+
+    lea     (%rax),%rsi         # %xmm save area
+    lea     512($context),%rdi  # & context.Xmm6
+    mov     \$20,%ecx           # 10*sizeof(%xmm0)/sizeof(%rax)
+    .long   0xa548f3fc          # cld; rep movsq
+
+    lea     `48+168`(%rax),%rax
+
+    mov     -8(%rax),%rbx
+    mov     -16(%rax),%rbp
+    mov     -24(%rax),%r12
+    mov     -32(%rax),%r13
+    mov     -40(%rax),%r14
+    mov     -48(%rax),%r15
+    mov     %rbx,144($context) # restore context->Rbx
+    mov     %rbp,160($context) # restore context->Rbp
+    mov     %r12,216($context) # restore context->R12
+    mov     %r13,224($context) # restore context->R13
+    mov     %r14,232($context) # restore context->R14
+    mov     %r15,240($context) # restore context->R14
+
+    jmp     .Lcommon_seh_tail
+.size   rsaz_avx_handler,.-rsaz_avx_handler
+
 .section    .pdata
 .align  4
     .rva    .LSEH_begin_ossl_rsaz_amm52x20_x1_ifma256
@@ -703,6 +916,10 @@ rsaz_def_handler:
     .rva    .LSEH_end_ossl_rsaz_amm52x20_x2_ifma256
     .rva    .LSEH_info_ossl_rsaz_amm52x20_x2_ifma256
 
+    .rva    .LSEH_begin_ossl_rsaz_amm52x20_x4_ifma256
+    .rva    .LSEH_end_ossl_rsaz_amm52x20_x4_ifma256
+    .rva    .LSEH_info_ossl_rsaz_amm52x20_x4_ifma256
+
 .section    .xdata
 .align  8
 .LSEH_info_ossl_rsaz_amm52x20_x1_ifma256:
@@ -713,6 +930,10 @@ rsaz_def_handler:
     .byte   9,0,0,0
     .rva    rsaz_def_handler
     .rva    .Lossl_rsaz_amm52x20_x2_ifma256_body,.Lossl_rsaz_amm52x20_x2_ifma256_epilogue
+.LSEH_info_ossl_rsaz_amm52x20_x4_ifma256:
+    .byte   9,0,0,0
+    .rva    rsaz_avx_handler
+    .rva    .Lossl_rsaz_amm52x20_x4_ifma256_body,.Lossl_rsaz_amm52x20_x4_ifma256_epilogue
 ___
 }
 }}} else {{{                # fallback for old assembler
@@ -728,10 +949,12 @@ ossl_rsaz_avx512ifma_eligible:
 
 .globl  ossl_rsaz_amm52x20_x1_ifma256
 .globl  ossl_rsaz_amm52x20_x2_ifma256
+.globl  ossl_rsaz_amm52x20_x4_ifma256
 .globl  ossl_extract_multiplier_2x20_win5
 .type   ossl_rsaz_amm52x20_x1_ifma256,\@abi-omnipotent
 ossl_rsaz_amm52x20_x1_ifma256:
 ossl_rsaz_amm52x20_x2_ifma256:
+ossl_rsaz_amm52x20_x4_ifma256:
 ossl_extract_multiplier_2x20_win5:
     .byte   0x0f,0x0b    # ud2
     ret
@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2023 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -1508,3 +1508,60 @@ err:
 
     return ret;
 }
+
+/*
+ * Four exponentiations like BN_mod_exp_mont_consttime_x2(), as needed for
+ * the CRT steps of two RSA private key operations.  The Montgomery contexts
+ * in |mont| must be set up.  With AVX512_IFMA and 1024-bit moduli, the four
+ * of them are done together, which keeps more multiplications in flight
+ * than two dual exponentiations.  Otherwise they are done with two
+ * BN_mod_exp_mont_consttime_x2() calls.
+ */
+int ossl_bn_mod_exp_mont_consttime_x4(BIGNUM *const rr[4],
+                                      const BIGNUM *const a[4],
+                                      const BIGNUM *const p[4],
+                                      const BIGNUM *const m[4],
+                                      BN_MONT_CTX *const mont[4],
+                                      BN_CTX *ctx)
+{
+#ifdef RSAZ_ENABLED
+    int i, eligible = ossl_rsaz_avx512ifma_eligible();
+
+    for (i = 0; i < 4 && eligible; i++)
+        eligible = a[i]->top == 16 && p[i]->top == 16
+                   && BN_num_bits(m[i]) == 1024;
+
+    if (eligible) {
+        BN_ULONG *res[4], k0[4];
+        const BN_ULONG *base[4], *exp[4], *mod[4], *RR[4];
+        int ret;
+
+        for (i = 0; i < 4; i++) {
+            if (bn_wexpand(rr[i], 16) == NULL)
+                return 0;
+            res[i] = rr[i]->d;
+            base[i] = a[i]->d;
+            exp[i] = p[i]->d;
+            mod[i] = m[i]->d;
+            RR[i] = mont[i]->RR.d;
+            k0[i] = mont[i]->n0[0];
+        }
+
+        ret = ossl_rsaz_mod_exp_avx512_x4(res, base, exp, mod, RR, k0, 1024);
+
+        for (i = 0; i < 4; i++) {
+            rr[i]->top = 16;
+            rr[i]->neg = 0;
+            bn_correct_top(rr[i]);
+            bn_check_top(rr[i]);
+        }
+        return ret;
+    }
+#endif
+
+    return BN_mod_exp_mont_consttime_x2(rr[0], a[0], p[0], m[0], mont[0],
+                                        rr[1], a[1], p[1], m[1], mont[1], ctx)
+           && BN_mod_exp_mont_consttime_x2(rr[2], a[2], p[2], m[2], mont[2],
+                                           rr[3], a[3], p[3], m[3], mont[3],
+                                           ctx);
+}
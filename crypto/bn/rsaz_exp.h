@@ -1,5 +1,5 @@
 /*
- * Copyright 2013-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2013-2023 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2020, Intel Corporation. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
@@ -54,6 +54,14 @@ int ossl_rsaz_mod_exp_avx512_x2(BN_ULONG *res1,
                                 BN_ULONG k0_2,
                                 int factor_size);
 
+int ossl_rsaz_mod_exp_avx512_x4(BN_ULONG *const res[4],
+                                const BN_ULONG *const base[4],
+                                const BN_ULONG *const exponent[4],
+                                const BN_ULONG *const m[4],
+                                const BN_ULONG *const RR[4],
+                                const BN_ULONG k0[4],
+                                int factor_size);
+
 static ossl_inline void bn_select_words(BN_ULONG *r, BN_ULONG mask,
                                         const BN_ULONG *a,
                                         const BN_ULONG *b, size_t num)
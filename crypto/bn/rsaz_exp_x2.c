@@ -1,5 +1,5 @@
 /*
- * Copyright 2020-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2020-2023 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2020-2021, Intel Corporation. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
@@ -60,7 +60,7 @@ static ossl_inline int number_of_digits(int bitsize, int digit_size)
  *  amm = Almost Montgomery Multiplication
  *  ams = Almost Montgomery Squaring
  *  52xZZ - data represented as array of ZZ digits in 52-bit radix
- *  _x1_/_x2_ - 1 or 2 independent inputs/outputs
+ *  _x1_/_x2_/_x4_ - 1, 2 or 4 independent inputs/outputs
  *  _ifma256 - uses 256-bit wide IFMA ISA (AVX512_IFMA256)
  */
 
@@ -70,6 +70,9 @@ void ossl_rsaz_amm52x20_x1_ifma256(BN_ULONG *res, const BN_ULONG *a,
 void ossl_rsaz_amm52x20_x2_ifma256(BN_ULONG *out, const BN_ULONG *a,
                                    const BN_ULONG *b, const BN_ULONG *m,
                                    const BN_ULONG k0[2]);
+void ossl_rsaz_amm52x20_x4_ifma256(BN_ULONG *out, const BN_ULONG *a,
+                                   const BN_ULONG *b, const BN_ULONG *m,
+                                   const BN_ULONG k0[4]);
 void ossl_extract_multiplier_2x20_win5(BN_ULONG *red_Y,
                                        const BN_ULONG *red_table,
                                        int red_table_idx1, int red_table_idx2);
@@ -98,6 +101,10 @@ static int RSAZ_mod_exp_x2_ifma256(BN_ULONG *res, const BN_ULONG *base,
                                    const BN_ULONG *exp[2], const BN_ULONG *m,
                                    const BN_ULONG *rr, const BN_ULONG k0[2],
                                    int modulus_bitsize);
+static int RSAZ_mod_exp_x4_ifma256(BN_ULONG *res, const BN_ULONG *base,
+                                   const BN_ULONG *const exp[4],
+                                   const BN_ULONG *m, const BN_ULONG *rr,
+                                   const BN_ULONG k0[4]);
 
 /*
  * Dual Montgomery modular exponentiation using prime moduli of the
@@ -263,6 +270,91 @@ err:
     return ret;
 }
 
+/*
+ * Quad Montgomery modular exponentiation using 1024-bit prime moduli,
+ * optimized with AVX512 ISA.  That is the CRT exponentiations of two
+ * RSA-2048 private key operations.
+ *
+ * The parameters are those of ossl_rsaz_mod_exp_avx512_x2() for four
+ * independent exponentiations, given as arrays.  The only supported
+ * |factor_size| is 1024.
+ *
+ * \return 0 in case of failure,
+ *         1 in case of success.
+ */
+int ossl_rsaz_mod_exp_avx512_x4(BN_ULONG *const res[4],
+                                const BN_ULONG *const base[4],
+                                const BN_ULONG *const exp[4],
+                                const BN_ULONG *const m[4],
+                                const BN_ULONG *const rr[4],
+                                const BN_ULONG k0[4],
+                                int factor_size)
+{
+    int ret = 0;
+    int i;
+
+    /* 20 digits of 52 bits, in 5 YMM registers */
+    const int red_digits = 20;
+    int coeff_pow = 4 * (DIGIT_SIZE * red_digits - 1024);
+
+    BN_ULONG *base_red, *m_red, *rr_red;
+    BN_ULONG *coeff_red;
+    BN_ULONG *storage = NULL;
+    BN_ULONG *storage_aligned = NULL;
+    int storage_len_bytes = (3 * 4 + 1) * red_digits * sizeof(BN_ULONG)
+                            + 64 /* alignment */;
+
+    if (factor_size != 1024)
+        goto err;
+
+    storage = (BN_ULONG *)OPENSSL_malloc(storage_len_bytes);
+    if (storage == NULL)
+        goto err;
+    storage_aligned = (BN_ULONG *)ALIGN_OF(storage, 64);
+
+    /* Memory layout for red(undant) representations, [4][red_digits] each */
+    base_red  = storage_aligned;
+    m_red     = storage_aligned + 4 * red_digits;
+    rr_red    = storage_aligned + 8 * red_digits;
+    coeff_red = storage_aligned + 12 * red_digits;
+
+    memset(coeff_red, 0, red_digits * sizeof(BN_ULONG));
+    set_bit(coeff_red, 64 * (int)(coeff_pow / 52) + coeff_pow % 52);
+
+    for (i = 0; i < 4; i++) {
+        BN_ULONG *rr_i = rr_red + i * red_digits;
+        BN_ULONG *m_i = m_red + i * red_digits;
+
+        to_words52(base_red + i * red_digits, red_digits, base[i], factor_size);
+        to_words52(m_i, red_digits, m[i], factor_size);
+        to_words52(rr_i, red_digits, rr[i], factor_size);
+
+        /* RR -> RR', see ossl_rsaz_mod_exp_avx512_x2() */
+        ossl_rsaz_amm52x20_x1_ifma256(rr_i, rr_i, rr_i, m_i, k0[i]);
+        ossl_rsaz_amm52x20_x1_ifma256(rr_i, rr_i, coeff_red, m_i, k0[i]);
+    }
+
+    /* Quad (4-exps in parallel) exponentiation */
+    ret = RSAZ_mod_exp_x4_ifma256(rr_red, base_red, exp, m_red, rr_red, k0);
+    if (!ret)
+        goto err;
+
+    for (i = 0; i < 4; i++) {
+        /* Convert rr_i back to regular radix */
+        from_words52(res[i], factor_size, rr_red + i * red_digits);
+        /* bn_reduce_once_in_place expects number of BN_ULONG, not bit size */
+        bn_reduce_once_in_place(res[i], /*carry=*/0, m[i], storage,
+                                factor_size / (sizeof(BN_ULONG) * 8));
+    }
+
+err:
+    if (storage != NULL) {
+        OPENSSL_cleanse(storage, storage_len_bytes);
+        OPENSSL_free(storage);
+    }
+    return ret;
+}
+
 /*
  * Dual {1024,1536,2048}-bit w-ary modular exponentiation using prime moduli of
  * the same bit size using Almost Montgomery Multiplication, optimized with
@@ -518,6 +610,190 @@ err:
     return ret;
 }
 
+/* Window of |exp_win_size| bits at bit |exp_bit_no| of the expanded |expz| */
+static ossl_inline int exp_window(const BN_ULONG *expz, int exp_bit_no,
+                                  int exp_win_size)
+{
+    int exp_chunk_no = exp_bit_no / 64;
+    int exp_chunk_shift = exp_bit_no % 64;
+    BN_ULONG idx = expz[exp_chunk_no] >> exp_chunk_shift;
+
+    /* Get additional bits from the next quadword */
+    if (exp_chunk_shift > 64 - exp_win_size)
+        idx ^= expz[exp_chunk_no + 1] << (64 - exp_chunk_shift);
+    return (int)(idx & ((1U << exp_win_size) - 1));
+}
+
+/*
+ * Quad 1024-bit w-ary modular exponentiation using Almost Montgomery
+ * Multiplication, optimized with AVX512_IFMA256 ISA.  This is
+ * RSAZ_mod_exp_x2_ifma256() for four inputs.
+ *
+ * The powers of the bases are kept in two tables of two lanes each, so
+ * that they can be read in constant time with the extraction function of
+ * the dual exponentiation.
+ *
+ *  [out] res      - result of modular exponentiation: 4x20 qword values in
+ *                   2^52 radix.
+ *  [in]  base     - base (4x20 qword values in 2^52 radix)
+ *  [in]  exp      - array of 4 pointers to 16 qword values in 2^64 radix.
+ *  [in]  m        - moduli (4x20 qword values in 2^52 radix)
+ *  [in]  rr       - Montgomery parameter for 4 moduli: RR = 2^2080 mod m.
+ *                   (4x20 qword values in 2^52 radix)
+ *  [in]  k0       - Montgomery parameter for 4 moduli: k0 = -1/m mod 2^64
+ *
+ * \return 0 in case of failure,
+ *         1 in case of success.
+ */
+static int RSAZ_mod_exp_x4_ifma256(BN_ULONG *out,
+                                   const BN_ULONG *base,
+                                   const BN_ULONG *const exp[4],
+                                   const BN_ULONG *m,
+                                   const BN_ULONG *rr,
+                                   const BN_ULONG k0[4])
+{
+    const int red_digits = 20;
+    const int exp_digits = 16;
+    const int modulus_bitsize = 1024;
+    /* Size of one lane and of one entry of a two lanes table */
+    const int lane = red_digits;
+    const int entry = 2 * red_digits;
+
+    int ret = 0;
+    int idx, i;
+
+    /* Exponent window size */
+    int exp_win_size = 5;
+
+    BN_ULONG *storage = NULL;
+    BN_ULONG *storage_aligned = NULL;
+    int storage_len_bytes = 0;
+
+    /* Red(undant) result Y and multiplier X */
+    BN_ULONG *red_Y = NULL;     /* [4][red_digits] */
+    BN_ULONG *red_X = NULL;     /* [4][red_digits] */
+    /* Pre-computed tables of base powers, lanes 0-1 and lanes 2-3 */
+    BN_ULONG *red_table[2];     /* [1U << exp_win_size][2][red_digits] */
+    /* Expanded exponent */
+    BN_ULONG *expz = NULL;      /* [4][exp_digits + 1] */
+
+# define QAMM(r,a,b) ossl_rsaz_amm52x20_x4_ifma256((r),(a),(b),m,k0)
+# define QAMS(r,a) QAMM((r),(a),(a))
+/* Entry |i| of the tables to and from the four lanes of |x| */
+# define TABLE_PUT(i,x)                                                  \
+    do {                                                                 \
+        memcpy(&red_table[0][(i) * entry], (x), entry * sizeof(BN_ULONG)); \
+        memcpy(&red_table[1][(i) * entry], (x) + entry,                  \
+               entry * sizeof(BN_ULONG));                                \
+    } while (0)
+# define TABLE_GET(x,i)                                                  \
+    do {                                                                 \
+        memcpy((x), &red_table[0][(i) * entry], entry * sizeof(BN_ULONG)); \
+        memcpy((x) + entry, &red_table[1][(i) * entry],                  \
+               entry * sizeof(BN_ULONG));                                \
+    } while (0)
+
+    storage_len_bytes = (4 * red_digits                         /* red_Y     */
+                       + 4 * red_digits                         /* red_X     */
+                       + 4 * red_digits * (1U << exp_win_size)  /* red_table */
+                       + 4 * (exp_digits + 1))                  /* expz      */
+                       * sizeof(BN_ULONG)
+                       + 64;                                    /* alignment */
+
+    storage = (BN_ULONG *)OPENSSL_zalloc(storage_len_bytes);
+    if (storage == NULL)
+        goto err;
+    storage_aligned = (BN_ULONG *)ALIGN_OF(storage, 64);
+
+    red_Y        = storage_aligned;
+    red_X        = red_Y + 4 * red_digits;
+    red_table[0] = red_X + 4 * red_digits;
+    red_table[1] = red_table[0] + 2 * red_digits * (1U << exp_win_size);
+    expz         = red_table[1] + 2 * red_digits * (1U << exp_win_size);
+
+    /*
+     * Compute table of powers base^i, i = 0, ..., (2^EXP_WIN_SIZE) - 1
+     *   table[0] = mont(x^0) = mont(1)
+     *   table[1] = mont(x^1) = mont(x)
+     * red_Y holds table[i] and red_X table[1] while the table is filled.
+     */
+    for (i = 0; i < 4; i++)
+        red_X[i * lane] = 1;
+    QAMM(red_Y, red_X, rr);
+    TABLE_PUT(0, red_Y);
+    QAMM(red_X, base, rr);
+    TABLE_PUT(1, red_X);
+
+    for (idx = 1; idx < (int)((1U << exp_win_size) / 2); idx++) {
+        TABLE_GET(red_Y, idx);
+        QAMS(red_Y, red_Y);
+        TABLE_PUT(2 * idx, red_Y);
+        QAMM(red_Y, red_Y, red_X);
+        TABLE_PUT(2 * idx + 1, red_Y);
+    }
+
+    /* Copy and expand exponents */
+    for (i = 0; i < 4; i++) {
+        memcpy(&expz[i * (exp_digits + 1)], exp[i],
+               exp_digits * sizeof(BN_ULONG));
+        expz[(i + 1) * (exp_digits + 1) - 1] = 0;
+    }
+
+    /* Exponentiation */
+    {
+        /* 1024 % 5 != 0, so the first window is short and needs no mask */
+        int exp_bit_no = modulus_bitsize - modulus_bitsize % exp_win_size;
+        int w[4];
+
+        for (i = 0; i < 4; i++)
+            w[i] = exp_window(&expz[i * (exp_digits + 1)], exp_bit_no,
+                              exp_win_size);
+        ossl_extract_multiplier_2x20_win5(red_Y, red_table[0], w[0], w[1]);
+        ossl_extract_multiplier_2x20_win5(red_Y + entry, red_table[1],
+                                          w[2], w[3]);
+
+        for (exp_bit_no -= exp_win_size; exp_bit_no >= 0;
+             exp_bit_no -= exp_win_size) {
+            for (i = 0; i < 4; i++)
+                w[i] = exp_window(&expz[i * (exp_digits + 1)], exp_bit_no,
+                                  exp_win_size);
+            ossl_extract_multiplier_2x20_win5(red_X, red_table[0], w[0], w[1]);
+            ossl_extract_multiplier_2x20_win5(red_X + entry, red_table[1],
+                                              w[2], w[3]);
+
+            /* Series of squaring */
+            QAMS(red_Y, red_Y);
+            QAMS(red_Y, red_Y);
+            QAMS(red_Y, red_Y);
+            QAMS(red_Y, red_Y);
+            QAMS(red_Y, red_Y);
+
+            QAMM(red_Y, red_Y, red_X);
+        }
+    }
+
+    /* Convert result back in regular 2^52 domain, see above */
+    memset(red_X, 0, 4 * red_digits * sizeof(BN_ULONG));
+    for (i = 0; i < 4; i++)
+        red_X[i * lane] = 1;
+    QAMM(out, red_Y, red_X);
+
+    ret = 1;
+
+err:
+    if (storage != NULL) {
+        /* Clear whole storage */
+        OPENSSL_cleanse(storage, storage_len_bytes);
+        OPENSSL_free(storage);
+    }
+
+# undef QAMM
+# undef QAMS
+# undef TABLE_PUT
+# undef TABLE_GET
+    return ret;
+}
+
 static ossl_inline uint64_t get_digit(const uint8_t *in, int in_len)
 {
     uint64_t digit = 0;
@@ -15,7 +15,13 @@
 #include "internal/bio.h"
 #include "internal/provider.h"
 #include "internal/decoder.h"
+#include "internal/namemap.h"
 #include "crypto/context.h"
+#ifndef FIPS_MODULE
+# include <openssl/evp.h>
+# include <openssl/kdf.h>
+# include "crypto/evp.h"
+#endif
 
 struct ossl_lib_ctx_st {
     CRYPTO_RWLOCK *lock, *rand_crngt_lock;
@@ -467,6 +473,44 @@ int OSSL_LIB_CTX_load_config(OSSL_LIB_CTX *ctx, const char *config_file)
 {
     return CONF_modules_load_file_ex(ctx, config_file, NULL, 0) > 0;
 }
+
+# define IMPLEMENT_freeze_construct(type, do_all)                            \
+    static void freeze_##type(type *method, void *arg)                      \
+    {                                                                       \
+    }                                                                       \
+    static void freeze_construct_##type(OSSL_LIB_CTX *ctx)                  \
+    {                                                                       \
+        do_all(ctx, &freeze_##type, NULL);                                  \
+    }
+
+IMPLEMENT_freeze_construct(EVP_MD, EVP_MD_do_all_provided)
+IMPLEMENT_freeze_construct(EVP_CIPHER, EVP_CIPHER_do_all_provided)
+IMPLEMENT_freeze_construct(EVP_MAC, EVP_MAC_do_all_provided)
+IMPLEMENT_freeze_construct(EVP_KDF, EVP_KDF_do_all_provided)
+IMPLEMENT_freeze_construct(EVP_RAND, EVP_RAND_do_all_provided)
+IMPLEMENT_freeze_construct(EVP_KEYMGMT, EVP_KEYMGMT_do_all_provided)
+IMPLEMENT_freeze_construct(EVP_KEYEXCH, EVP_KEYEXCH_do_all_provided)
+IMPLEMENT_freeze_construct(EVP_SIGNATURE, EVP_SIGNATURE_do_all_provided)
+IMPLEMENT_freeze_construct(EVP_ASYM_CIPHER, EVP_ASYM_CIPHER_do_all_provided)
+IMPLEMENT_freeze_construct(EVP_KEM, EVP_KEM_do_all_provided)
+
+int OSSL_LIB_CTX_freeze(OSSL_LIB_CTX *ctx, const char *propq)
+{
+    /* Make sure that every EVP method has been constructed */
+    freeze_construct_EVP_MD(ctx);
+    freeze_construct_EVP_CIPHER(ctx);
+    freeze_construct_EVP_MAC(ctx);
+    freeze_construct_EVP_KDF(ctx);
+    freeze_construct_EVP_RAND(ctx);
+    freeze_construct_EVP_KEYMGMT(ctx);
+    freeze_construct_EVP_KEYEXCH(ctx);
+    freeze_construct_EVP_SIGNATURE(ctx);
+    freeze_construct_EVP_ASYM_CIPHER(ctx);
+    freeze_construct_EVP_KEM(ctx);
+
+    return ossl_namemap_freeze(ossl_namemap_stored(ctx))
+           && evp_method_store_freeze(ctx, propq);
+}
 #endif
 
 void OSSL_LIB_CTX_free(OSSL_LIB_CTX *ctx)
@@ -8,7 +8,8 @@
  */
 
 #include "internal/namemap.h"
-#include <openssl/lhash.h>
+#include "internal/hashtable.h"
+#include "internal/rcu.h"
 #include "crypto/lhash.h"      /* ossl_lh_strcasehash */
 #include "internal/tsan_assist.h"
 #include "internal/sizes.h"
@@ -23,7 +24,61 @@ typedef struct {
     int number;
 } NAMENUM_ENTRY;
 
-DEFINE_LHASH_OF_EX(NAMENUM_ENTRY);
+DEFINE_HASHTABLE_OF(NAMENUM_ENTRY);
+
+/*-
+ * The number index
+ * ================
+ *
+ * The names for each number, in the order they were added, are kept in an
+ * array indexed by number.  Both the index and the lists of names in it are
+ * immutable once published: adding a name publishes a new list, and a new
+ * index when the index is too small.  Readers can therefore use them
+ * without any locking.
+ *
+ * Rather than waiting for readers to let go of replaced lists and indexes,
+ * they are kept until the namemap is freed.  Their total size is bounded
+ * by that of the final index and lists.
+ *
+ * Names are only ever removed when ossl_namemap_add_names() fails half way
+ * and takes back the names it added.  Readers may have picked those up
+ * already, so their hash table entries and strings are retired the same
+ * way instead of being freed.
+ */
+typedef struct {
+    int num_names;
+    const char *names[1];
+} NUMNAMES;
+
+typedef struct {
+    size_t size;
+    NUMNAMES *nums[1];
+} NUMINDEX;
+
+/*-
+ * The frozen name index
+ * =====================
+ *
+ * A snapshot of the names taken by ossl_namemap_freeze(), matched
+ * exactly rather than case insensitively, which makes lookups of names
+ * spelled the way they were added considerably cheaper.  Names that
+ * aren't found in it are looked up the usual way.  Names never change
+ * number, and the only names that are ever removed are taken back by the
+ * ossl_namemap_add_names() call that added them, before it lets go of the
+ * lock that ossl_namemap_freeze() needs too.  A snapshot can therefore be
+ * incomplete but never wrong, so it is used without any locking and
+ * retired like the number index.
+ */
+typedef struct {
+    const char *name;
+    uint32_t hash;
+    int number;
+} FROZEN_NAME;
+
+typedef struct {
+    size_t mask;
+    FROZEN_NAME names[1];
+} FROZEN_NAMES;
 
 /*-
  * The namemap itself
@@ -34,13 +89,21 @@ struct ossl_namemap_st {
     /* Flags */
     unsigned int stored:1; /* If 1, it's stored in a library context */
 
+    /* Serialises writers, readers don't need it */
     CRYPTO_RWLOCK *lock;
-    LHASH_OF(NAMENUM_ENTRY) *namenum;  /* Name->number mapping */
+    HASHTABLE_OF(NAMENUM_ENTRY) *namenum;  /* Name->number mapping */
+    NUMINDEX *numindex;                    /* Number->names mapping */
+    FROZEN_NAMES *frozen;                  /* Exact name->number snapshot */
+
+    /* Replaced indexes and lists of names, see above */
+    void **retired;
+    size_t num_retired;
+    size_t max_retired;
 
     TSAN_QUALIFIER int max_number;     /* Current max number */
 };
 
-/* LHASH callbacks */
+/* Hashtable callbacks */
 
 static unsigned long namenum_hash(const NAMENUM_ENTRY *n)
 {
@@ -107,19 +170,15 @@ int ossl_namemap_empty(OSSL_NAMEMAP *namemap)
 #endif
 }
 
-typedef struct doall_names_data_st {
-    int number;
-    const char **names;
-    int found;
-} DOALL_NAMES_DATA;
-
-static void do_name(const NAMENUM_ENTRY *namenum, DOALL_NAMES_DATA *data)
+static const NUMNAMES *namemap_num2names(const OSSL_NAMEMAP *namemap,
+                                         int number)
 {
-    if (namenum->number == data->number)
-        data->names[data->found++] = namenum->name;
-}
+    const NUMINDEX *index = ossl_rcu_deref(&namemap->numindex);
 
-IMPLEMENT_LHASH_DOALL_ARG_CONST(NAMENUM_ENTRY, DOALL_NAMES_DATA);
+    if (index == NULL || number <= 0 || (size_t)number >= index->size)
+        return NULL;
+    return ossl_rcu_deref(&index->nums[number]);
+}
 
 /*
  * Call the callback for all names in the namemap with the given number.
@@ -130,46 +189,52 @@ int ossl_namemap_doall_names(const OSSL_NAMEMAP *namemap, int number,
                              void (*fn)(const char *name, void *data),
                              void *data)
 {
-    DOALL_NAMES_DATA cbdata;
-    size_t num_names;
+    const NUMNAMES *names;
     int i;
 
-    cbdata.number = number;
-    cbdata.found = 0;
-
     if (namemap == NULL)
         return 0;
 
+    if (ossl_namemap_empty((OSSL_NAMEMAP *)namemap))
+        return 0;
+
     /*
-     * We collect all the names first under a read lock. Subsequently we call
-     * the user function, so that we're not holding the read lock when in user
-     * code. This could lead to deadlocks.
+     * The list is immutable and the names in it live as long as the
+     * namemap, so the callback can be called without holding anything.
      */
-    if (!CRYPTO_THREAD_read_lock(namemap->lock))
-        return 0;
+    if ((names = namemap_num2names(namemap, number)) != NULL)
+        for (i = 0; i < names->num_names; i++)
+            fn(names->names[i], data);
+    return 1;
+}
 
-    num_names = lh_NAMENUM_ENTRY_num_items(namemap->namenum);
-    if (num_names == 0) {
-        CRYPTO_THREAD_unlock(namemap->lock);
-        return 0;
-    }
-    cbdata.names = OPENSSL_malloc(sizeof(*cbdata.names) * num_names);
-    if (cbdata.names == NULL) {
-        CRYPTO_THREAD_unlock(namemap->lock);
-        return 0;
-    }
-    lh_NAMENUM_ENTRY_doall_DOALL_NAMES_DATA(namemap->namenum, do_name,
-                                            &cbdata);
-    CRYPTO_THREAD_unlock(namemap->lock);
+/* FNV-1a */
+static uint32_t frozen_hash(const char *name)
+{
+    uint32_t h = 0x811c9dc5;
 
-    for (i = 0; i < cbdata.found; i++)
-        fn(cbdata.names[i], data);
+    for (; *name != '\0'; name++)
+        h = (h ^ (unsigned char)*name) * 0x01000193;
+    return h;
+}
 
-    OPENSSL_free(cbdata.names);
-    return 1;
+static int frozen_name2num(const FROZEN_NAMES *frozen, const char *name)
+{
+    uint32_t h = frozen_hash(name);
+    const FROZEN_NAME *n;
+    size_t i;
+
+    for (i = h & frozen->mask; (n = &frozen->names[i])->name != NULL;
+         i = (i + 1) & frozen->mask)
+        if (n->hash == h && strcmp(n->name, name) == 0)
+            return n->number;
+    return 0;
 }
 
-/* This function is not thread safe, the namemap must be locked */
+/*
+ * Readers may call this without the namemap lock, writers must hold it
+ * when using this to check for names they're about to add.
+ */
 static int namemap_name2num(const OSSL_NAMEMAP *namemap,
                             const char *name)
 {
@@ -178,12 +243,14 @@ static int namemap_name2num(const OSSL_NAMEMAP *namemap,
     namenum_tmpl.name = (char *)name;
     namenum_tmpl.number = 0;
     namenum_entry =
-        lh_NAMENUM_ENTRY_retrieve(namemap->namenum, &namenum_tmpl);
+        ossl_ht_NAMENUM_ENTRY_retrieve(namemap->namenum, &namenum_tmpl);
     return namenum_entry != NULL ? namenum_entry->number : 0;
 }
 
 int ossl_namemap_name2num(const OSSL_NAMEMAP *namemap, const char *name)
 {
+    const FROZEN_NAMES *frozen;
+    unsigned int token;
     int number;
 
 #ifndef FIPS_MODULE
@@ -194,10 +261,13 @@ int ossl_namemap_name2num(const OSSL_NAMEMAP *namemap, const char *name)
     if (namemap == NULL)
         return 0;
 
-    if (!CRYPTO_THREAD_read_lock(namemap->lock))
-        return 0;
+    if ((frozen = ossl_rcu_deref(&namemap->frozen)) != NULL
+            && (number = frozen_name2num(frozen, name)) != 0)
+        return number;
+
+    token = ossl_ht_NAMENUM_ENTRY_read_lock(namemap->namenum);
     number = namemap_name2num(namemap, name);
-    CRYPTO_THREAD_unlock(namemap->lock);
+    ossl_ht_NAMENUM_ENTRY_read_unlock(namemap->namenum, token);
 
     return number;
 }
@@ -216,31 +286,153 @@ int ossl_namemap_name2num_n(const OSSL_NAMEMAP *namemap,
     return ret;
 }
 
-struct num2name_data_st {
-    size_t idx;                  /* Countdown */
-    const char *name;            /* Result */
-};
+const char *ossl_namemap_num2name(const OSSL_NAMEMAP *namemap, int number,
+                                  size_t idx)
+{
+    const NUMNAMES *names;
 
-static void do_num2name(const char *name, void *vdata)
+    if (namemap == NULL
+            || (names = namemap_num2names(namemap, number)) == NULL
+            || idx >= (size_t)names->num_names)
+        return NULL;
+    return names->names[idx];
+}
+
+/*
+ * The most pointers that adding a name and taking it back again can retire:
+ * an index and a list of names, and the hash table entry and its string
+ */
+#define NAMEMAP_RETIRE_PER_NAME     4
+
+/*
+ * Make sure that |n| more pointers can be retired without allocating.
+ * This function is not thread safe, the namemap must be locked.
+ */
+static int namemap_reserve_retired(OSSL_NAMEMAP *namemap, size_t n)
 {
-    struct num2name_data_st *data = vdata;
+    void **tmp;
+    size_t max = namemap->max_retired;
 
-    if (data->idx > 0)
-        data->idx--;
-    else if (data->name == NULL)
-        data->name = name;
+    if (namemap->num_retired + n <= max)
+        return 1;
+    if (max == 0)
+        max = 64;
+    while (max < namemap->num_retired + n)
+        max *= 2;
+    tmp = OPENSSL_realloc(namemap->retired, max * sizeof(*tmp));
+    if (tmp == NULL)
+        return 0;
+    namemap->retired = tmp;
+    namemap->max_retired = max;
+    return 1;
 }
 
-const char *ossl_namemap_num2name(const OSSL_NAMEMAP *namemap, int number,
-                                  size_t idx)
+/* This function is not thread safe, the namemap must be locked */
+static int namemap_retire(OSSL_NAMEMAP *namemap, void *p)
+{
+    if (p == NULL)
+        return 1;
+    if (!namemap_reserve_retired(namemap, 1))
+        return 0;
+    namemap->retired[namemap->num_retired++] = p;
+    return 1;
+}
+
+/*
+ * Publish |orig| again as the list of names for |number|, undoing any
+ * names added since.  |orig| is among the retired lists unless it is NULL,
+ * so the current list takes its place there.  When |orig| is NULL there
+ * must be room to retire one more pointer, see namemap_reserve_retired().
+ * This function is not thread safe, the namemap must be locked.
+ */
+static void namemap_restore_num(OSSL_NAMEMAP *namemap, int number,
+                                NUMNAMES *orig)
 {
-    struct num2name_data_st data;
+    NUMINDEX *index = namemap->numindex;
+    NUMNAMES *cur;
+    size_t i;
 
-    data.idx = idx;
-    data.name = NULL;
-    if (!ossl_namemap_doall_names(namemap, number, do_num2name, &data))
-        return NULL;
-    return data.name;
+    if (index == NULL || number <= 0 || (size_t)number >= index->size
+            || (cur = index->nums[number]) == orig)
+        return;
+    if (orig == NULL) {
+        namemap->retired[namemap->num_retired++] = cur;
+    } else {
+        for (i = namemap->num_retired; i-- > 0;)
+            if (namemap->retired[i] == orig) {
+                namemap->retired[i] = cur;
+                break;
+            }
+    }
+    ossl_rcu_assign_ptr(&index->nums[number], &orig);
+}
+
+/*
+ * Take |name| out of the hash table again.  Readers may still be using its
+ * entry and string, so both are retired, for which there must be room, see
+ * namemap_reserve_retired().
+ * This function is not thread safe, the namemap must be locked.
+ */
+static void namemap_remove_name(OSSL_NAMEMAP *namemap, const char *name)
+{
+    NAMENUM_ENTRY *namenum, namenum_tmpl;
+
+    namenum_tmpl.name = (char *)name;
+    namenum_tmpl.number = 0;
+    namenum = ossl_ht_NAMENUM_ENTRY_remove(namemap->namenum, &namenum_tmpl);
+    if (namenum != NULL) {
+        namemap->retired[namemap->num_retired++] = namenum->name;
+        namemap->retired[namemap->num_retired++] = namenum;
+    }
+}
+
+/*
+ * Publish a new list of names for |number| with |name| added to it.
+ * This function is not thread safe, the namemap must be locked.
+ */
+static int namemap_add_num(OSSL_NAMEMAP *namemap, int number,
+                           const char *name)
+{
+    NUMINDEX *index = namemap->numindex, *newindex;
+    NUMNAMES *names, *newnames;
+    size_t size;
+    int n;
+
+    if (index == NULL || (size_t)number >= index->size) {
+        for (size = index == NULL ? 256 : index->size;
+             size <= (size_t)number; size *= 2)
+            continue;
+        newindex = OPENSSL_zalloc(sizeof(*newindex)
+                                  + (size - 1) * sizeof(newindex->nums[0]));
+        if (newindex == NULL)
+            return 0;
+        newindex->size = size;
+        if (index != NULL)
+            memcpy(newindex->nums, index->nums,
+                   index->size * sizeof(index->nums[0]));
+        if (!namemap_retire(namemap, index)) {
+            OPENSSL_free(newindex);
+            return 0;
+        }
+        ossl_rcu_assign_ptr(&namemap->numindex, &newindex);
+        index = newindex;
+    }
+
+    names = index->nums[number];
+    n = names == NULL ? 0 : names->num_names;
+    newnames = OPENSSL_malloc(sizeof(*newnames) + n * sizeof(newnames->names[0]));
+    if (newnames == NULL)
+        return 0;
+    if (n > 0)
+        memcpy(newnames->names, names->names, n * sizeof(names->names[0]));
+    newnames->names[n] = name;
+    newnames->num_names = n + 1;
+    if (!namemap_retire(namemap, names)) {
+        OPENSSL_free(newnames);
+        return 0;
+    }
+    ossl_rcu_assign_ptr(&index->nums[number], &newnames);
+    return 1;
 }
 
 /* This function is not thread safe, the namemap must be locked */
@@ -254,6 +446,13 @@ static int namemap_add_name(OSSL_NAMEMAP *namemap, int number,
     if ((tmp_number = namemap_name2num(namemap, name)) != 0)
         return tmp_number;
 
+    /*
+     * Make room for retiring an index and a list of names, and for taking
+     * the name back out again if need be.
+     */
+    if (!namemap_reserve_retired(namemap, NAMEMAP_RETIRE_PER_NAME))
+        return 0;
+
     if ((namenum = OPENSSL_zalloc(sizeof(*namenum))) == NULL)
         return 0;
 
@@ -263,10 +462,19 @@ static int namemap_add_name(OSSL_NAMEMAP *namemap, int number,
     /* The tsan_counter use here is safe since we're under lock */
     namenum->number =
         number != 0 ? number : 1 + tsan_counter(&namemap->max_number);
-    (void)lh_NAMENUM_ENTRY_insert(namemap->namenum, namenum);
-
-    if (lh_NAMENUM_ENTRY_error(namemap->namenum))
+    /*
+     * The name only shows up in the number index once it is in the hash
+     * table, which owns it from then on.  If it can't be added to the
+     * index, take it out of the hash table again, so that it is either
+     * found both ways or not at all.  The name is then freed with the
+     * retired data, a reader may have found it in the hash table already.
+     */
+    if (!ossl_ht_NAMENUM_ENTRY_insert(namemap->namenum, namenum))
         goto err;
+    if (!namemap_add_num(namemap, namenum->number, namenum->name)) {
+        namemap_remove_name(namemap, name);
+        return 0;
+    }
     return namenum->number;
 
  err:
@@ -294,10 +502,36 @@ int ossl_namemap_add_name(OSSL_NAMEMAP *namemap, int number,
     return tmp_number;
 }
 
+/*
+ * Publish |orig| as the list of names for |number| again, and take the
+ * names in |names| up to |endp| that aren't in |orig| out of the namemap.
+ * The names are retired rather than freed, readers may still be using
+ * lists that hold them.
+ * This function is not thread safe, the namemap must be locked.
+ */
+static void namemap_undo_names(OSSL_NAMEMAP *namemap, int number,
+                               NUMNAMES *orig, const char *names,
+                               const char *endp)
+{
+    const char *p;
+    int i, found;
+
+    namemap_restore_num(namemap, number, orig);
+    for (p = names; p < endp; p += strlen(p) + 1) {
+        found = 0;
+        for (i = 0; orig != NULL && !found && i < orig->num_names; i++)
+            found = OPENSSL_strcasecmp(orig->names[i], p) == 0;
+        if (!found)
+            namemap_remove_name(namemap, p);
+    }
+}
+
 int ossl_namemap_add_names(OSSL_NAMEMAP *namemap, int number,
                            const char *names, const char separator)
 {
     char *tmp, *p, *q, *endp;
+    NUMNAMES *orig = NULL;
+    size_t count = 0;
 
     /* Check that we have a namemap */
     if (!ossl_assert(namemap != NULL)) {
@@ -333,6 +567,7 @@ int ossl_namemap_add_names(OSSL_NAMEMAP *namemap, int number,
             number = 0;
             goto end;
         }
+        count++;
 
         this_number = namemap_name2num(namemap, p);
 
@@ -348,7 +583,20 @@ int ossl_namemap_add_names(OSSL_NAMEMAP *namemap, int number,
     }
     endp = p;
 
-    /* Now that we have checked, register all names */
+    /*
+     * Now that we have checked, register all names.  Readers see each name
+     * as soon as it is added, so if adding one fails, those added before it
+     * are removed again.  That must not fail for lack of memory, so room is
+     * made up front for everything that could be retired, for each name
+     * added and taken back, and one more list for undoing it all.
+     */
+    if (number != 0)
+        orig = (NUMNAMES *)namemap_num2names(namemap, number);
+    if (!namemap_reserve_retired(namemap,
+                                 NAMEMAP_RETIRE_PER_NAME * count + 1)) {
+        number = 0;
+        goto end;
+    }
     for (p = tmp; p < endp; p = q) {
         int this_number;
 
@@ -357,10 +605,14 @@ int ossl_namemap_add_names(OSSL_NAMEMAP *namemap, int number,
         this_number = namemap_add_name(namemap, number, p);
         if (number == 0) {
             number = this_number;
+            if (number == 0)
+                goto end;
         } else if (this_number != number) {
-            ERR_raise_data(ERR_LIB_CRYPTO, ERR_R_INTERNAL_ERROR,
-                           "Got number %d when expecting %d",
-                           this_number, number);
+            if (this_number != 0)
+                ERR_raise_data(ERR_LIB_CRYPTO, ERR_R_INTERNAL_ERROR,
+                               "Got number %d when expecting %d",
+                               this_number, number);
+            namemap_undo_names(namemap, number, orig, tmp, p);
             number = 0;
             goto end;
         }
@@ -372,6 +624,47 @@ int ossl_namemap_add_names(OSSL_NAMEMAP *namemap, int number,
     return number;
 }
 
+static void do_freeze(NAMENUM_ENTRY *namenum, void *vfrozen)
+{
+    FROZEN_NAMES *frozen = vfrozen;
+    uint32_t h = frozen_hash(namenum->name);
+    size_t i;
+
+    for (i = h & frozen->mask; frozen->names[i].name != NULL;
+         i = (i + 1) & frozen->mask)
+        continue;
+    frozen->names[i].name = namenum->name;
+    frozen->names[i].hash = h;
+    frozen->names[i].number = namenum->number;
+}
+
+int ossl_namemap_freeze(OSSL_NAMEMAP *namemap)
+{
+    FROZEN_NAMES *frozen;
+    size_t n, size = 16;
+
+    if (namemap == NULL)
+        return 0;
+
+    if (!CRYPTO_THREAD_write_lock(namemap->lock))
+        return 0;
+    /* Keep the load factor at or below one half */
+    for (n = ossl_ht_NAMENUM_ENTRY_num(namemap->namenum); size < 2 * n;)
+        size <<= 1;
+    frozen = OPENSSL_zalloc(sizeof(*frozen)
+                            + (size - 1) * sizeof(frozen->names[0]));
+    if (frozen == NULL || !namemap_retire(namemap, namemap->frozen)) {
+        CRYPTO_THREAD_unlock(namemap->lock);
+        OPENSSL_free(frozen);
+        return 0;
+    }
+    frozen->mask = size - 1;
+    ossl_ht_NAMENUM_ENTRY_doall_arg(namemap->namenum, do_freeze, frozen);
+    ossl_rcu_assign_ptr(&namemap->frozen, &frozen);
+    CRYPTO_THREAD_unlock(namemap->lock);
+    return 1;
+}
+
 /*-
  * Pre-population
  * ==============
@@ -515,7 +808,9 @@ OSSL_NAMEMAP *ossl_namemap_new(void)
     if ((namemap = OPENSSL_zalloc(sizeof(*namemap))) != NULL
         && (namemap->lock = CRYPTO_THREAD_lock_new()) != NULL
         && (namemap->namenum =
-            lh_NAMENUM_ENTRY_new(namenum_hash, namenum_cmp)) != NULL)
+            ossl_ht_NAMENUM_ENTRY_new(namenum_hash, namenum_cmp,
+                                      namenum_free,
+                                      OSSL_HT_LOCKLESS_READS)) != NULL)
         return namemap;
 
     ossl_namemap_free(namemap);
@@ -524,11 +819,21 @@ OSSL_NAMEMAP *ossl_namemap_new(void)
 
 void ossl_namemap_free(OSSL_NAMEMAP *namemap)
 {
+    size_t i;
+
     if (namemap == NULL || namemap->stored)
         return;
 
-    lh_NAMENUM_ENTRY_doall(namemap->namenum, namenum_free);
-    lh_NAMENUM_ENTRY_free(namemap->namenum);
+    ossl_ht_NAMENUM_ENTRY_free(namemap->namenum);
+    if (namemap->numindex != NULL) {
+        for (i = 0; i < namemap->numindex->size; i++)
+            OPENSSL_free(namemap->numindex->nums[i]);
+        OPENSSL_free(namemap->numindex);
+    }
+    OPENSSL_free(namemap->frozen);
+    for (i = 0; i < namemap->num_retired; i++)
+        OPENSSL_free(namemap->retired[i]);
+    OPENSSL_free(namemap->retired);
 
     CRYPTO_THREAD_lock_free(namemap->lock);
     OPENSSL_free(namemap);
@@ -1,5 +1,5 @@
 /*
- * Copyright 2016-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2016-2023 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -17,6 +17,7 @@
 #include "crypto/ecx.h"
 #include "ec_local.h"
 #include <openssl/evp.h>
+#include <openssl/rand.h>
 #include <openssl/sha.h>
 
 #include "internal/numbers.h"
@@ -4528,26 +4529,12 @@ static const ge_precomp Bi[8] = {
     },
 };
 
-/*
- * r = a * A + b * B
- *
- * where a = a[0]+256*a[1]+...+256^31 a[31].
- * and b = b[0]+256*b[1]+...+256^31 b[31].
- * B is the Ed25519 base point (x,4/5) with x positive.
- */
-static void ge_double_scalarmult_vartime(ge_p2 *r, const uint8_t *a,
-                                         const ge_p3 *A, const uint8_t *b)
+/* Ai = A,3A,5A,7A,9A,11A,13A,15A */
+static void ge_odd_multiples(ge_cached Ai[8], const ge_p3 *A)
 {
-    signed char aslide[256];
-    signed char bslide[256];
-    ge_cached Ai[8]; /* A,3A,5A,7A,9A,11A,13A,15A */
     ge_p1p1 t;
     ge_p3 u;
     ge_p3 A2;
-    int i;
-
-    slide(aslide, a);
-    slide(bslide, b);
 
     ge_p3_to_cached(&Ai[0], A);
     ge_p3_dbl(&t, A);
@@ -4573,6 +4560,28 @@ static void ge_double_scalarmult_vartime(ge_p2 *r, const uint8_t *a,
     ge_add(&t, &A2, &Ai[6]);
     ge_p1p1_to_p3(&u, &t);
     ge_p3_to_cached(&Ai[7], &u);
+}
+
+/*
+ * r = a * A + b * B
+ *
+ * where a = a[0]+256*a[1]+...+256^31 a[31].
+ * and b = b[0]+256*b[1]+...+256^31 b[31].
+ * B is the Ed25519 base point (x,4/5) with x positive.
+ */
+static void ge_double_scalarmult_vartime(ge_p2 *r, const uint8_t *a,
+                                         const ge_p3 *A, const uint8_t *b)
+{
+    signed char aslide[256];
+    signed char bslide[256];
+    ge_cached Ai[8]; /* A,3A,5A,7A,9A,11A,13A,15A */
+    ge_p1p1 t;
+    ge_p3 u;
+    int i;
+
+    slide(aslide, a);
+    slide(bslide, b);
+    ge_odd_multiples(Ai, A);
 
     ge_p2_0(r);
 
@@ -5540,6 +5549,43 @@ err:
 
 static const char allzeroes[15];
 
+/*
+ * Check 0 <= s < L where L = 2^252 + 27742317777372353535851937790883648493
+ *
+ * If not the signature is publicly invalid. Since it's public we can do the
+ * check in variable time.
+ */
+static int ed25519_s_is_canonical(const uint8_t s[32])
+{
+    /* 27742317777372353535851937790883648493 in little endian format */
+    static const uint8_t l_low[16] = {
+        0xED, 0xD3, 0xF5, 0x5C, 0x1A, 0x63, 0x12, 0x58, 0xD6, 0x9C, 0xF7, 0xA2,
+        0xDE, 0xF9, 0xDE, 0x14
+    };
+    int i;
+
+    /* First check the most significant byte */
+    if (s[31] > 0x10)
+        return 0;
+    if (s[31] == 0x10) {
+        /*
+         * Most significant byte indicates a value close to 2^252 so check the
+         * rest
+         */
+        if (memcmp(s + 16, allzeroes, sizeof(allzeroes)) != 0)
+            return 0;
+        for (i = 15; i >= 0; i--) {
+            if (s[i] < l_low[i])
+                break;
+            if (s[i] > l_low[i])
+                return 0;
+        }
+        if (i < 0)
+            return 0;
+    }
+    return 1;
+}
+
 int
 ossl_ed25519_verify(const uint8_t *tbs, size_t tbs_len,
                     const uint8_t signature[64], const uint8_t public_key[32],
@@ -5547,7 +5593,6 @@ ossl_ed25519_verify(const uint8_t *tbs, size_t tbs_len,
                     const uint8_t *context, size_t context_len,
                     OSSL_LIB_CTX *libctx, const char *propq)
 {
-    int i;
     ge_p3 A;
     const uint8_t *r, *s;
     EVP_MD *sha512;
@@ -5557,11 +5602,6 @@ ossl_ed25519_verify(const uint8_t *tbs, size_t tbs_len,
     ge_p2 R;
     uint8_t rcheck[32];
     uint8_t h[SHA512_DIGEST_LENGTH];
-    /* 27742317777372353535851937790883648493 in little endian format */
-    const uint8_t l_low[16] = {
-        0xED, 0xD3, 0xF5, 0x5C, 0x1A, 0x63, 0x12, 0x58, 0xD6, 0x9C, 0xF7, 0xA2,
-        0xDE, 0xF9, 0xDE, 0x14
-    };
 
     if (context == NULL)
         context_len = 0;
@@ -5577,32 +5617,8 @@ ossl_ed25519_verify(const uint8_t *tbs, size_t tbs_len,
     r = signature;
     s = signature + 32;
 
-    /*
-     * Check 0 <= s < L where L = 2^252 + 27742317777372353535851937790883648493
-     *
-     * If not the signature is publicly invalid. Since it's public we can do the
-     * check in variable time.
-     *
-     * First check the most significant byte
-     */
-    if (s[31] > 0x10)
+    if (!ed25519_s_is_canonical(s))
         return 0;
-    if (s[31] == 0x10) {
-        /*
-         * Most significant byte indicates a value close to 2^252 so check the
-         * rest
-         */
-        if (memcmp(s + 16, allzeroes, sizeof(allzeroes)) != 0)
-            return 0;
-        for (i = 15; i >= 0; i--) {
-            if (s[i] < l_low[i])
-                break;
-            if (s[i] > l_low[i])
-                return 0;
-        }
-        if (i < 0)
-            return 0;
-    }
 
     if (ge_frombytes_vartime(&A, public_key) != 0) {
         return 0;
@@ -5646,6 +5662,252 @@ err:
     return res;
 }
 
+/*
+ * Batch verification.
+ *
+ * A batch of n signatures (R_i, s_i) of messages M_i under keys A_i, with
+ * h_i = SHA512(dom2(x, y) || R_i || A_i || M_i), is accepted if
+ *
+ *   [8](sum(z_i * R_i) + sum((z_i * h_i) * A_i) - (sum(z_i * s_i)) * B) == 0
+ *
+ * for random 128-bit z_i.  That is one multi-scalar multiplication sharing
+ * its doublings between all 2n + 1 points, instead of n double scalar
+ * multiplications.  A batch that contains an invalid signature is accepted
+ * with a probability of about 2^-128.
+ *
+ * Unlike ossl_ed25519_verify(), which checks that the encoding of
+ * [s]B - [h]A is R, this is the cofactored verification equation, which
+ * can't tell apart points that differ by a point of small order.  R and A
+ * must therefore be canonically encoded and must not be of small order,
+ * which rules out the keys and signatures that pass the cofactored
+ * equation for any message.  That is stricter than ossl_ed25519_verify(),
+ * but doesn't affect honestly generated keys and signatures.  A signer
+ * that adds a point of small order to R or to its public key can still
+ * make a signature that only passes here.
+ */
+
+/* The number of signatures per multi-scalar multiplication */
+#define ED25519_BATCH_MAX   64
+
+typedef struct {
+    ge_p3 P;
+    uint8_t a[32];
+    ge_cached Pi[8];
+    signed char slide[256];
+} ge_msm_point;
+
+/*
+ * Decode a point, requiring the encoding that ge_tobytes() would give:
+ * y < p and no sign bit for x = 0.
+ */
+static int ge_frombytes_canonical_vartime(ge_p3 *h, const uint8_t *s)
+{
+    int i;
+
+    if ((s[31] & 0x7f) == 0x7f && s[0] >= 0xed) {
+        for (i = 1; i < 31 && s[i] == 0xff; i++)
+            continue;
+        if (i == 31)
+            return -1;
+    }
+    if (ge_frombytes_vartime(h, s) != 0)
+        return -1;
+    if ((s[31] >> 7) != 0 && !fe_isnonzero(h->X))
+        return -1;
+    return 0;
+}
+
+/* Whether [8]h is the neutral element */
+static int ge_has_small_order(const ge_p3 *h)
+{
+    ge_p1p1 t;
+    ge_p2 r;
+
+    ge_p3_dbl(&t, h);
+    ge_p1p1_to_p2(&r, &t);
+    ge_p2_dbl(&t, &r);
+    ge_p1p1_to_p2(&r, &t);
+    ge_p2_dbl(&t, &r);
+    ge_p1p1_to_p2(&r, &t);
+    /* The only point of order 2 is (0, -1), so X = 0 means (0, 1) */
+    return !fe_isnonzero(r.X);
+}
+
+/*
+ * r = p[0].a * p[0].P + ... + p[n-1].a * p[n-1].P - b * B
+ *
+ * B is the Ed25519 base point.  The tables and the slides in |p| are
+ * filled in here.
+ */
+static void ge_multi_scalarmult_vartime(ge_p2 *r, const uint8_t *b,
+                                        ge_msm_point *p, size_t n)
+{
+    signed char bslide[256];
+    ge_p1p1 t;
+    ge_p3 u;
+    size_t j;
+    int i, top;
+
+    slide(bslide, b);
+    for (top = 255; top >= 0 && bslide[top] == 0; top--)
+        continue;
+    for (j = 0; j < n; j++) {
+        slide(p[j].slide, p[j].a);
+        ge_odd_multiples(p[j].Pi, &p[j].P);
+        for (i = 255; i > top; i--) {
+            if (p[j].slide[i] != 0) {
+                top = i;
+                break;
+            }
+        }
+    }
+
+    ge_p2_0(r);
+    for (i = top; i >= 0; --i) {
+        ge_p2_dbl(&t, r);
+
+        for (j = 0; j < n; j++) {
+            if (p[j].slide[i] > 0) {
+                ge_p1p1_to_p3(&u, &t);
+                ge_add(&t, &u, &p[j].Pi[p[j].slide[i] / 2]);
+            } else if (p[j].slide[i] < 0) {
+                ge_p1p1_to_p3(&u, &t);
+                ge_sub(&t, &u, &p[j].Pi[(-p[j].slide[i]) / 2]);
+            }
+        }
+
+        if (bslide[i] > 0) {
+            ge_p1p1_to_p3(&u, &t);
+            ge_msub(&t, &u, &Bi[bslide[i] / 2]);
+        } else if (bslide[i] < 0) {
+            ge_p1p1_to_p3(&u, &t);
+            ge_madd(&t, &u, &Bi[(-bslide[i]) / 2]);
+        }
+
+        ge_p1p1_to_p2(r, &t);
+    }
+}
+
+/* Verify |num| signatures, no more than ED25519_BATCH_MAX */
+static int ed25519_verify_batch_chunk(ge_msm_point *p, EVP_MD_CTX *hash_ctx,
+                                      EVP_MD *sha512,
+                                      const uint8_t *const tbs[],
+                                      const size_t tbs_len[],
+                                      const uint8_t *const sig[],
+                                      const uint8_t *const public_key[],
+                                      size_t num, const uint8_t dom2flag,
+                                      const uint8_t phflag,
+                                      const uint8_t *context,
+                                      size_t context_len,
+                                      OSSL_LIB_CTX *libctx)
+{
+    static const uint8_t zero[32] = { 0 };
+    uint8_t z[ED25519_BATCH_MAX][16];
+    uint8_t h[SHA512_DIGEST_LENGTH];
+    uint8_t b[32];
+    unsigned int sz;
+    ge_p1p1 t;
+    ge_p2 r;
+    fe check;
+    size_t i;
+
+    if (RAND_bytes_ex(libctx, (unsigned char *)z, 16 * num, 0) <= 0)
+        return 0;
+
+    memset(b, 0, sizeof(b));
+    for (i = 0; i < num; i++) {
+        if (!ed25519_s_is_canonical(sig[i] + 32)
+                || ge_frombytes_canonical_vartime(&p[2 * i].P,
+                                                  public_key[i]) != 0
+                || ge_frombytes_canonical_vartime(&p[2 * i + 1].P, sig[i]) != 0
+                || ge_has_small_order(&p[2 * i].P)
+                || ge_has_small_order(&p[2 * i + 1].P))
+            return 0;
+
+        if (!hash_init_with_dom(hash_ctx, sha512, dom2flag, phflag, context,
+                                context_len)
+                || !EVP_DigestUpdate(hash_ctx, sig[i], 32)
+                || !EVP_DigestUpdate(hash_ctx, public_key[i], 32)
+                || !EVP_DigestUpdate(hash_ctx, tbs[i], tbs_len[i])
+                || !EVP_DigestFinal_ex(hash_ctx, h, &sz))
+            return 0;
+        x25519_sc_reduce(h);
+
+        /* z_i * A_i, z_i * R_i and z_i * s_i */
+        memset(p[2 * i + 1].a, 0, 32);
+        memcpy(p[2 * i + 1].a, z[i], 16);
+        sc_muladd(p[2 * i].a, p[2 * i + 1].a, h, zero);
+        sc_muladd(b, p[2 * i + 1].a, sig[i] + 32, b);
+    }
+
+    ge_multi_scalarmult_vartime(&r, b, p, 2 * num);
+
+    /* Clear the cofactor and check for the neutral element (0, 1) */
+    for (i = 0; i < 3; i++) {
+        ge_p2_dbl(&t, &r);
+        ge_p1p1_to_p2(&r, &t);
+    }
+    fe_sub(check, r.Y, r.Z);
+    return !fe_isnonzero(r.X) && !fe_isnonzero(check);
+}
+
+int
+ossl_ed25519_verify_batch(const uint8_t *const tbs[], const size_t tbs_len[],
+                          const uint8_t *const signature[],
+                          const uint8_t *const public_key[], size_t num,
+                          const uint8_t dom2flag, const uint8_t phflag,
+                          const uint8_t csflag, const uint8_t *context,
+                          size_t context_len, OSSL_LIB_CTX *libctx,
+                          const char *propq)
+{
+    ge_msm_point *p = NULL;
+    EVP_MD *sha512 = NULL;
+    EVP_MD_CTX *hash_ctx = NULL;
+    size_t i, n;
+    int res = 0;
+
+    if (num == 1)
+        return ossl_ed25519_verify(tbs[0], tbs_len[0], signature[0],
+                                   public_key[0], dom2flag, phflag, csflag,
+                                   context, context_len, libctx, propq);
+
+    if (context == NULL)
+        context_len = 0;
+
+    /* if csflag is set, then a non-empty context-string is required */
+    if (csflag && context_len == 0)
+        return 0;
+
+    /* if dom2flag is not set, then an empty context-string is required */
+    if (!dom2flag && context_len > 0)
+        return 0;
+
+    if (num == 0)
+        return 1;
+
+    n = num < ED25519_BATCH_MAX ? num : ED25519_BATCH_MAX;
+    sha512 = EVP_MD_fetch(libctx, SN_sha512, propq);
+    hash_ctx = EVP_MD_CTX_new();
+    p = OPENSSL_malloc(2 * n * sizeof(*p));
+    if (sha512 == NULL || hash_ctx == NULL || p == NULL)
+        goto err;
+
+    for (i = 0; i < num; i += n) {
+        n = num - i < ED25519_BATCH_MAX ? num - i : ED25519_BATCH_MAX;
+        if (!ed25519_verify_batch_chunk(p, hash_ctx, sha512, tbs + i,
+                                        tbs_len + i, signature + i,
+                                        public_key + i, n, dom2flag, phflag,
+                                        context, context_len, libctx))
+            goto err;
+    }
+    res = 1;
+err:
+    OPENSSL_free(p);
+    EVP_MD_free(sha512);
+    EVP_MD_CTX_free(hash_ctx);
+    return res;
+}
+
 int
 ossl_ed25519_public_from_private(OSSL_LIB_CTX *ctx, uint8_t out_public_key[32],
                                  const uint8_t private_key[32],
@@ -1,5 +1,5 @@
 /*
- * Copyright 2002-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2002-2023 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2002, Oracle and/or its affiliates. All rights reserved
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
@@ -145,3 +145,149 @@ int ossl_ecdh_simple_compute_key(unsigned char **pout, size_t *poutlen,
     OPENSSL_free(buf);
     return ret;
 }
+
+/*
+ * Batch version of ossl_ecdh_simple_compute_key() for |num| keys of the
+ * same group: the points are made affine together, which shares the field
+ * inversion among them.  As with ECDH_compute_key() without a KDF, up to
+ * |outlen[i]| bytes of each shared secret are written to |out[i]|, and
+ * |outlen[i]| is updated to the number of bytes written.
+ */
+static int ecdh_simple_compute_key_batch(unsigned char *const out[],
+                                         size_t outlen[],
+                                         const EC_POINT *const pub_key[],
+                                         EC_KEY *const ecdh[], size_t num)
+{
+    const EC_GROUP *group = EC_KEY_get0_group(ecdh[0]);
+    BN_CTX *ctx;
+    EC_POINT **tmp = NULL;
+    BIGNUM *x, *k;
+    const BIGNUM *priv_key;
+    unsigned char *buf = NULL;
+    size_t i, buflen = 0, len;
+    int ret = 0;
+
+    if ((ctx = BN_CTX_new_ex(ecdh[0]->libctx)) == NULL)
+        return 0;
+    BN_CTX_start(ctx);
+    x = BN_CTX_get(ctx);
+    k = BN_CTX_get(ctx);
+    if (k == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+        goto err;
+    }
+
+    buflen = (EC_GROUP_get_degree(group) + 7) / 8;
+    if ((buf = OPENSSL_malloc(buflen)) == NULL
+        || (tmp = OPENSSL_zalloc(num * sizeof(*tmp))) == NULL)
+        goto err;
+
+    /* Step(1), as in ossl_ecdh_simple_compute_key() */
+    for (i = 0; i < num; i++) {
+        priv_key = EC_KEY_get0_private_key(ecdh[i]);
+        if (priv_key == NULL) {
+            ERR_raise(ERR_LIB_EC, EC_R_MISSING_PRIVATE_KEY);
+            goto err;
+        }
+        if (EC_KEY_get_flags(ecdh[i]) & EC_FLAG_COFACTOR_ECDH) {
+            if (!EC_GROUP_get_cofactor(group, k, NULL)) {
+                ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+                goto err;
+            }
+            if (!BN_mul(k, k, priv_key, ctx)) {
+                ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+                goto err;
+            }
+            priv_key = k;
+        }
+        if ((tmp[i] = EC_POINT_new(group)) == NULL) {
+            ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+            goto err;
+        }
+        if (!EC_POINT_mul(group, tmp[i], NULL, pub_key[i], priv_key, ctx)) {
+            ERR_raise(ERR_LIB_EC, EC_R_POINT_ARITHMETIC_FAILURE);
+            goto err;
+        }
+    }
+
+    if (!EC_POINTs_make_affine(group, num, tmp, ctx)) {
+        ERR_raise(ERR_LIB_EC, EC_R_POINT_ARITHMETIC_FAILURE);
+        goto err;
+    }
+
+    /* Step(2) and Step(3) */
+    for (i = 0; i < num; i++) {
+        if (!EC_POINT_get_affine_coordinates(group, tmp[i], x, NULL, ctx)) {
+            ERR_raise(ERR_LIB_EC, EC_R_POINT_ARITHMETIC_FAILURE);
+            goto err;
+        }
+        len = BN_num_bytes(x);
+        if (len > buflen) {
+            ERR_raise(ERR_LIB_EC, ERR_R_INTERNAL_ERROR);
+            goto err;
+        }
+        memset(buf, 0, buflen - len);
+        if (len != (size_t)BN_bn2bin(x, buf + buflen - len)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+            goto err;
+        }
+        if (outlen[i] > buflen)
+            outlen[i] = buflen;
+        memcpy(out[i], buf, outlen[i]);
+    }
+
+    ret = 1;
+
+ err:
+    /* Step(4) */
+    BN_clear(x);
+    BN_clear(k);
+    if (tmp != NULL)
+        for (i = 0; i < num; i++)
+            EC_POINT_clear_free(tmp[i]);
+    OPENSSL_free(tmp);
+    OPENSSL_clear_free(buf, buflen);
+    BN_CTX_end(ctx);
+    BN_CTX_free(ctx);
+    return ret;
+}
+
+int ossl_ecdh_compute_key_batch(unsigned char *const out[], size_t outlen[],
+                                const EC_POINT *const pub_key[],
+                                EC_KEY *const ecdh[], size_t num)
+{
+    const EC_GROUP *group;
+    size_t i;
+    int batch = num > 1;
+
+    for (i = 0; i < num; i++) {
+        if (ecdh[i] == NULL || pub_key[i] == NULL
+            || (group = EC_KEY_get0_group(ecdh[i])) == NULL) {
+            ERR_raise(ERR_LIB_EC, ERR_R_PASSED_NULL_PARAMETER);
+            return 0;
+        }
+        if (i > 0
+            && EC_GROUP_cmp(group, EC_KEY_get0_group(ecdh[0]), NULL) != 0) {
+            ERR_raise(ERR_LIB_EC, EC_R_INCOMPATIBLE_OBJECTS);
+            return 0;
+        }
+        /* Keys with a method of their own are done one by one */
+        if (ecdh[i]->meth->compute_key != ossl_ecdh_compute_key
+            || group->meth->ecdh_compute_key != ossl_ecdh_simple_compute_key
+            || group->meth->points_make_affine == NULL)
+            batch = 0;
+    }
+
+    if (batch)
+        return ecdh_simple_compute_key_batch(out, outlen, pub_key, ecdh, num);
+
+    for (i = 0; i < num; i++) {
+        int len = ECDH_compute_key(out[i], outlen[i], pub_key[i], ecdh[i],
+                                   NULL);
+
+        if (len <= 0)
+            return 0;
+        outlen[i] = (size_t)len;
+    }
+    return 1;
+}
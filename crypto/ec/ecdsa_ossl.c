@@ -1,5 +1,5 @@
 /*
- * Copyright 2002-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2002-2023 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -249,6 +249,223 @@ int ossl_ecdsa_simple_sign_setup(EC_KEY *eckey, BN_CTX *ctx_in, BIGNUM **kinvp,
                             0, NULL, NULL, NULL);
 }
 
+/*
+ * Batch version of ecdsa_sign_setup() for |num| keys of the same group, with
+ * the nonces generated as ECDSA_do_sign() does from each key and digest.
+ * The points k*G are made affine together with EC_POINTs_make_affine() and
+ * the nonces are inverted together with Montgomery's trick, so the whole
+ * batch takes one field inversion and one inversion modulo the order.
+ * The pairs returned in |kinv| and |r| are to be freed by the caller.
+ */
+static int ecdsa_simple_sign_setup_batch(EC_KEY *const eckey[],
+                                         const unsigned char *const dgst[],
+                                         const int dlen[], BIGNUM *kinv[],
+                                         BIGNUM *r[], size_t num)
+{
+    const EC_GROUP *group = EC_KEY_get0_group(eckey[0]);
+    const BIGNUM *order = EC_GROUP_get0_order(group);
+    BN_MONT_CTX *mont = group->mont_data;
+    BN_CTX *ctx = NULL;
+    BIGNUM **k = NULL, **prod = NULL, *X;
+    EC_POINT **points = NULL;
+    int order_bits = BN_num_bits(order), len;
+    size_t i;
+    int ret = 0;
+
+    if (mont == NULL || order_bits < MIN_ECDSA_SIGN_ORDERBITS)
+        return 0;
+
+    if ((ctx = BN_CTX_new_ex(eckey[0]->libctx)) == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+        return 0;
+    }
+    BN_CTX_start(ctx);
+    if ((X = BN_CTX_get(ctx)) == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+        goto err;
+    }
+
+    k = OPENSSL_zalloc(num * sizeof(*k));
+    prod = OPENSSL_zalloc(num * sizeof(*prod));
+    points = OPENSSL_zalloc(num * sizeof(*points));
+    if (k == NULL || prod == NULL || points == NULL)
+        goto err;
+
+    for (i = 0; i < num; i++) {
+        k[i] = BN_secure_new();
+        prod[i] = BN_secure_new();
+        r[i] = BN_new();
+        points[i] = EC_POINT_new(group);
+        if (k[i] == NULL || prod[i] == NULL || r[i] == NULL) {
+            ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+            goto err;
+        }
+        if (points[i] == NULL) {
+            ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+            goto err;
+        }
+        if (!BN_set_bit(k[i], order_bits)
+            || !BN_set_bit(r[i], order_bits))
+            goto err;
+
+        /* Truncate the digest to whole bytes as ossl_ecdsa_simple_sign_sig() */
+        len = dlen[i];
+        if (8 * len > order_bits)
+            len = (order_bits + 7) / 8;
+        do {
+            if (!BN_generate_dsa_nonce(k[i], order,
+                                       EC_KEY_get0_private_key(eckey[i]),
+                                       dgst[i], len, ctx)) {
+                ERR_raise(ERR_LIB_EC, EC_R_RANDOM_NUMBER_GENERATION_FAILED);
+                goto err;
+            }
+        } while (BN_is_zero(k[i]));
+
+        if (!EC_POINT_mul(group, points[i], k[i], NULL, NULL, ctx)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+            goto err;
+        }
+    }
+
+    if (!EC_POINTs_make_affine(group, num, points, ctx)) {
+        ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+        goto err;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (!EC_POINT_get_affine_coordinates(group, points[i], X, NULL, ctx)
+            || !BN_nnmod(r[i], X, order, ctx)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+            goto err;
+        }
+        /* Practically impossible, but pick another nonce if it happens */
+        while (BN_is_zero(r[i])) {
+            do {
+                if (!BN_priv_rand_range_ex(k[i], order, 0, ctx)) {
+                    ERR_raise(ERR_LIB_EC, EC_R_RANDOM_NUMBER_GENERATION_FAILED);
+                    goto err;
+                }
+            } while (BN_is_zero(k[i]));
+            if (!EC_POINT_mul(group, points[i], k[i], NULL, NULL, ctx)
+                || !EC_POINT_get_affine_coordinates(group, points[i], X, NULL,
+                                                    ctx)
+                || !BN_nnmod(r[i], X, order, ctx)) {
+                ERR_raise(ERR_LIB_EC, ERR_R_EC_LIB);
+                goto err;
+            }
+        }
+    }
+
+    /*
+     * Montgomery's trick, in the Montgomery domain of the order: prod[i] is
+     * the product of k[0] .. k[i], which is inverted once, and the inverse
+     * of each k[i] is then peeled off from the last one down.
+     */
+    if (!bn_to_mont_fixed_top(prod[0], k[0], mont, ctx))
+        goto err;
+    for (i = 1; i < num; i++) {
+        if (!bn_to_mont_fixed_top(X, k[i], mont, ctx)
+            || !bn_mul_mont_fixed_top(prod[i], prod[i - 1], X, mont, ctx))
+            goto err;
+    }
+    if (!BN_from_montgomery(X, prod[num - 1], mont, ctx)
+        || !ossl_ec_group_do_inverse_ord(group, X, X, ctx)
+        || !bn_to_mont_fixed_top(X, X, mont, ctx))
+        goto err;
+    for (i = num - 1; i > 0; i--) {
+        /* X is the inverse of the product of k[0] .. k[i] */
+        if ((kinv[i] = BN_secure_new()) == NULL
+            || !bn_mul_mont_fixed_top(prod[i], prod[i - 1], X, mont, ctx)
+            || !BN_from_montgomery(kinv[i], prod[i], mont, ctx)
+            || !bn_to_mont_fixed_top(prod[i], k[i], mont, ctx)
+            || !bn_mul_mont_fixed_top(X, X, prod[i], mont, ctx))
+            goto err;
+    }
+    if ((kinv[0] = BN_secure_new()) == NULL
+        || !BN_from_montgomery(kinv[0], X, mont, ctx))
+        goto err;
+
+    ret = 1;
+ err:
+    if (!ret) {
+        for (i = 0; i < num; i++) {
+            BN_clear_free(kinv[i]);
+            BN_clear_free(r[i]);
+            kinv[i] = r[i] = NULL;
+        }
+    }
+    for (i = 0; i < num; i++) {
+        if (k != NULL)
+            BN_clear_free(k[i]);
+        if (prod != NULL)
+            BN_clear_free(prod[i]);
+        if (points != NULL)
+            EC_POINT_clear_free(points[i]);
+    }
+    OPENSSL_free(k);
+    OPENSSL_free(prod);
+    OPENSSL_free(points);
+    BN_CTX_end(ctx);
+    BN_CTX_free(ctx);
+    return ret;
+}
+
+int ossl_ecdsa_sign_setup_batch(EC_KEY *const eckey[],
+                                const unsigned char *const dgst[],
+                                const int dlen[], BIGNUM *kinv[], BIGNUM *r[],
+                                size_t num)
+{
+    const EC_GROUP *group;
+    size_t i;
+
+    if (num == 0)
+        return 1;
+
+    for (i = 0; i < num; i++) {
+        kinv[i] = r[i] = NULL;
+        if (eckey[i] == NULL
+            || (group = EC_KEY_get0_group(eckey[i])) == NULL) {
+            ERR_raise(ERR_LIB_EC, ERR_R_PASSED_NULL_PARAMETER);
+            return 0;
+        }
+        if (EC_KEY_get0_private_key(eckey[i]) == NULL) {
+            ERR_raise(ERR_LIB_EC, EC_R_MISSING_PRIVATE_KEY);
+            return 0;
+        }
+        if (!EC_KEY_can_sign(eckey[i])) {
+            ERR_raise(ERR_LIB_EC, EC_R_CURVE_DOES_NOT_SUPPORT_SIGNING);
+            return 0;
+        }
+        if (group->meth->ecdsa_sign_setup == NULL) {
+            ERR_raise(ERR_LIB_EC, EC_R_CURVE_DOES_NOT_SUPPORT_ECDSA);
+            return 0;
+        }
+        if (i > 0
+            && EC_GROUP_cmp(group, EC_KEY_get0_group(eckey[0]), NULL) != 0) {
+            ERR_raise(ERR_LIB_EC, EC_R_INCOMPATIBLE_OBJECTS);
+            return 0;
+        }
+    }
+
+    group = EC_KEY_get0_group(eckey[0]);
+    if (num > 1 && group->meth->ecdsa_sign_setup == ossl_ecdsa_simple_sign_setup
+        && group->meth->points_make_affine != NULL)
+        return ecdsa_simple_sign_setup_batch(eckey, dgst, dlen, kinv, r, num);
+
+    /* Methods with a sign_setup of their own do it one key at a time */
+    for (i = 0; i < num; i++) {
+        if (!ossl_ecdsa_sign_setup(eckey[i], NULL, &kinv[i], &r[i])) {
+            while (i-- > 0) {
+                BN_clear_free(kinv[i]);
+                BN_clear_free(r[i]);
+                kinv[i] = r[i] = NULL;
+            }
+            return 0;
+        }
+    }
+    return 1;
+}
+
 ECDSA_SIG *ossl_ecdsa_simple_sign_sig(const unsigned char *dgst, int dgst_len,
                                       const BIGNUM *in_kinv, const BIGNUM *in_r,
                                       EC_KEY *eckey)
@@ -1,5 +1,5 @@
 /*
- * Copyright 2014-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2014-2023 The OpenSSL Project Authors. All Rights Reserved.
  * Copyright (c) 2014, Intel Corporation. All Rights Reserved.
  * Copyright (c) 2015, CloudFlare, Inc.
  *
@@ -1208,6 +1208,83 @@ __owur static int ecp_nistz256_get_affine(const EC_GROUP *group,
     return 1;
 }
 
+/*
+ * Make |num| points affine with a single ecp_nistz256_mod_inverse() of the
+ * product of their Z coordinates.  Points at infinity are left alone.
+ */
+__owur static int ecp_nistz256_points_make_affine(const EC_GROUP *group,
+                                                  size_t num,
+                                                  EC_POINT *points[],
+                                                  BN_CTX *ctx)
+{
+    BN_ULONG (*z)[P256_LIMBS] = NULL, (*prod)[P256_LIMBS] = NULL;
+    BN_ULONG inv[P256_LIMBS], z_inv2[P256_LIMBS], z_inv3[P256_LIMBS];
+    BN_ULONG t[P256_LIMBS];
+    size_t i;
+    int ret = 0;
+
+    if (num == 0)
+        return 1;
+
+    z = OPENSSL_malloc(num * sizeof(*z));
+    prod = OPENSSL_malloc(num * sizeof(*prod));
+    if (z == NULL || prod == NULL)
+        goto err;
+
+    for (i = 0; i < num; i++) {
+        if (BN_is_zero(points[i]->Z)) {
+            memcpy(z[i], ONE, sizeof(ONE));
+        } else if (!ecp_nistz256_bignum_to_field_elem(z[i], points[i]->Z)) {
+            ERR_raise(ERR_LIB_EC, EC_R_COORDINATES_OUT_OF_RANGE);
+            goto err;
+        }
+        if (i == 0)
+            memcpy(prod[0], z[0], sizeof(z[0]));
+        else
+            ecp_nistz256_mul_mont(prod[i], prod[i - 1], z[i]);
+    }
+
+    ecp_nistz256_mod_inverse(inv, prod[num - 1]);
+
+    for (i = num; i-- > 0;) {
+        /* |inv| is the inverse of the product of z[0] .. z[i] */
+        if (i > 0) {
+            ecp_nistz256_mul_mont(z_inv3, inv, prod[i - 1]);
+            ecp_nistz256_mul_mont(inv, inv, z[i]);
+        } else {
+            memcpy(z_inv3, inv, sizeof(inv));
+        }
+        if (BN_is_zero(points[i]->Z))
+            continue;
+
+        ecp_nistz256_sqr_mont(z_inv2, z_inv3);
+        ecp_nistz256_mul_mont(z_inv3, z_inv3, z_inv2);
+        if (!ecp_nistz256_bignum_to_field_elem(t, points[i]->X)) {
+            ERR_raise(ERR_LIB_EC, EC_R_COORDINATES_OUT_OF_RANGE);
+            goto err;
+        }
+        ecp_nistz256_mul_mont(t, t, z_inv2);
+        if (!bn_set_words(points[i]->X, t, P256_LIMBS))
+            goto err;
+        if (!ecp_nistz256_bignum_to_field_elem(t, points[i]->Y)) {
+            ERR_raise(ERR_LIB_EC, EC_R_COORDINATES_OUT_OF_RANGE);
+            goto err;
+        }
+        ecp_nistz256_mul_mont(t, t, z_inv3);
+        if (!bn_set_words(points[i]->Y, t, P256_LIMBS)
+            || !bn_set_words(points[i]->Z, ONE, P256_LIMBS))
+            goto err;
+        points[i]->Z_is_one = 1;
+    }
+    ret = 1;
+
+ err:
+    OPENSSL_cleanse(inv, sizeof(inv));
+    OPENSSL_clear_free(z, num * sizeof(*z));
+    OPENSSL_clear_free(prod, num * sizeof(*prod));
+    return ret;
+}
+
 static NISTZ256_PRE_COMP *ecp_nistz256_pre_comp_new(const EC_GROUP *group)
 {
     NISTZ256_PRE_COMP *ret = NULL;
@@ -1482,7 +1559,7 @@ const EC_METHOD *EC_GFp_nistz256_method(void)
         ossl_ec_GFp_simple_is_on_curve,
         ossl_ec_GFp_simple_cmp,
         ossl_ec_GFp_simple_make_affine,
-        ossl_ec_GFp_simple_points_make_affine,
+        ecp_nistz256_points_make_affine,
         ecp_nistz256_points_mul,                    /* mul */
         ecp_nistz256_mult_precompute,               /* precompute_mult */
         ecp_nistz256_window_have_precompute_mult,   /* have_precompute_mult */
@@ -23,6 +23,7 @@
 #include "internal/namemap.h"
 #include "internal/sizes.h"
 #include "internal/decoder.h"
+#include "internal/hashtable.h"
 
 int OSSL_DECODER_CTX_set_passphrase(OSSL_DECODER_CTX *ctx,
                                     const unsigned char *kstr,
@@ -594,11 +595,11 @@ typedef struct {
     OSSL_DECODER_CTX *template;
 } DECODER_CACHE_ENTRY;
 
-DEFINE_LHASH_OF_EX(DECODER_CACHE_ENTRY);
+DEFINE_HASHTABLE_OF(DECODER_CACHE_ENTRY);
 
 typedef struct {
     CRYPTO_RWLOCK *lock;
-    LHASH_OF(DECODER_CACHE_ENTRY) *hashtable;
+    HASHTABLE_OF(DECODER_CACHE_ENTRY) *hashtable;
 } DECODER_CACHE;
 
 static void decoder_cache_entry_free(DECODER_CACHE_ENTRY *entry)
@@ -691,8 +692,10 @@ void *ossl_decoder_cache_new(OSSL_LIB_CTX *ctx)
         OPENSSL_free(cache);
         return NULL;
     }
-    cache->hashtable = lh_DECODER_CACHE_ENTRY_new(decoder_cache_entry_hash,
-                                                  decoder_cache_entry_cmp);
+    cache->hashtable = ossl_ht_DECODER_CACHE_ENTRY_new(decoder_cache_entry_hash,
+                                                       decoder_cache_entry_cmp,
+                                                       decoder_cache_entry_free,
+                                                       0);
     if (cache->hashtable == NULL) {
         CRYPTO_THREAD_lock_free(cache->lock);
         OPENSSL_free(cache);
@@ -706,8 +709,7 @@ void ossl_decoder_cache_free(void *vcache)
 {
     DECODER_CACHE *cache = (DECODER_CACHE *)vcache;
 
-    lh_DECODER_CACHE_ENTRY_doall(cache->hashtable, decoder_cache_entry_free);
-    lh_DECODER_CACHE_ENTRY_free(cache->hashtable);
+    ossl_ht_DECODER_CACHE_ENTRY_free(cache->hashtable);
     CRYPTO_THREAD_lock_free(cache->lock);
     OPENSSL_free(cache);
 }
@@ -731,8 +733,7 @@ int ossl_decoder_cache_flush(OSSL_LIB_CTX *libctx)
         return 0;
     }
 
-    lh_DECODER_CACHE_ENTRY_doall(cache->hashtable, decoder_cache_entry_free);
-    lh_DECODER_CACHE_ENTRY_flush(cache->hashtable);
+    ossl_ht_DECODER_CACHE_ENTRY_flush(cache->hashtable);
 
     CRYPTO_THREAD_unlock(cache->lock);
     return 1;
@@ -768,7 +769,7 @@ OSSL_DECODER_CTX_new_for_pkey(EVP_PKEY **pkey,
     }
 
     /* First see if we have a template OSSL_DECODER_CTX */
-    res = lh_DECODER_CACHE_ENTRY_retrieve(cache->hashtable, &cacheent);
+    res = ossl_ht_DECODER_CACHE_ENTRY_retrieve(cache->hashtable, &cacheent);
 
     if (res == NULL) {
         /*
@@ -839,9 +840,15 @@ OSSL_DECODER_CTX_new_for_pkey(EVP_PKEY **pkey,
             ERR_raise(ERR_LIB_OSSL_DECODER, ERR_R_CRYPTO_LIB);
             return NULL;
         }
-        res = lh_DECODER_CACHE_ENTRY_retrieve(cache->hashtable, &cacheent);
+        res = ossl_ht_DECODER_CACHE_ENTRY_retrieve(cache->hashtable, &cacheent);
         if (res == NULL) {
-            lh_DECODER_CACHE_ENTRY_insert(cache->hashtable, newcache);
+            if (!ossl_ht_DECODER_CACHE_ENTRY_insert(cache->hashtable,
+                                                    newcache)) {
+                CRYPTO_THREAD_unlock(cache->lock);
+                /* The template is freed along with the entry */
+                ctx = NULL;
+                goto err;
+            }
         } else {
             /*
              * We raced with another thread to construct this and lost. Free
@@ -200,14 +200,16 @@ static ERR_STRING_DATA *int_err_get_item(const ERR_STRING_DATA *d)
 
 void OSSL_ERR_STATE_free(ERR_STATE *state)
 {
+    ERR_QUEUE *es = (ERR_QUEUE *)state;
     int i;
 
-    if (state == NULL)
+    if (es == NULL)
         return;
     for (i = 0; i < ERR_NUM_ERRORS; i++) {
-        err_clear(state, i, 1);
+        err_clear(es, i, 1);
     }
-    CRYPTO_free(state, OPENSSL_FILE, OPENSSL_LINE);
+    CRYPTO_free(es->legacy, OPENSSL_FILE, OPENSSL_LINE);
+    CRYPTO_free(es, OPENSSL_FILE, OPENSSL_LINE);
 }
 
 DEFINE_RUN_ONCE_STATIC(do_err_strings_init)
@@ -333,16 +335,13 @@ void err_free_strings_int(void)
 
 void ERR_clear_error(void)
 {
-    int i;
-    ERR_STATE *es;
+    ERR_QUEUE *es;
 
     es = ossl_err_get_state_int();
     if (es == NULL)
         return;
 
-    for (i = 0; i < ERR_NUM_ERRORS; i++) {
-        err_clear(es, i, 0);
-    }
+    /* The entries are cleared as they get reused */
     es->top = es->bottom = 0;
 }
 
@@ -447,7 +446,8 @@ static unsigned long get_error_values(ERR_GET_ACTION g,
                                       const char **data, int *flags)
 {
     int i = 0;
-    ERR_STATE *es;
+    ERR_QUEUE *es;
+    ERR_ENTRY *e;
     unsigned long ret;
 
     es = ossl_err_get_state_int();
@@ -459,15 +459,13 @@ static unsigned long get_error_values(ERR_GET_ACTION g,
      * here because this doesn't have constant-time issues.
      */
     while (es->bottom != es->top) {
-        if (es->err_flags[es->top] & ERR_FLAG_CLEAR) {
-            err_clear(es, es->top, 0);
-            es->top = es->top > 0 ? es->top - 1 : ERR_NUM_ERRORS - 1;
+        if (es->entries[es->top].flags & ERR_FLAG_CLEAR) {
+            es->top = err_prev_slot(es->top);
             continue;
         }
         i = (es->bottom + 1) % ERR_NUM_ERRORS;
-        if (es->err_flags[i] & ERR_FLAG_CLEAR) {
+        if (es->entries[i].flags & ERR_FLAG_CLEAR) {
             es->bottom = i;
-            err_clear(es, es->bottom, 0);
             continue;
         }
         break;
@@ -483,32 +481,40 @@ static unsigned long get_error_values(ERR_GET_ACTION g,
     else
         i = (es->bottom + 1) % ERR_NUM_ERRORS;
 
-    ret = es->err_buffer[i];
+    e = &es->entries[i];
+    ret = e->buffer;
     if (g == EV_POP) {
         es->bottom = i;
-        es->err_buffer[i] = 0;
+        e->buffer = 0;
     }
 
     if (file != NULL) {
-        *file = es->err_file[i];
+        *file = e->file;
         if (*file == NULL)
             *file = "";
     }
     if (line != NULL)
-        *line = es->err_line[i];
+        *line = e->line;
     if (func != NULL) {
-        *func = es->err_func[i];
+        *func = e->func;
         if (*func == NULL)
             *func = "";
     }
-    if (flags != NULL)
-        *flags = es->err_data_flags[i];
+    if (flags != NULL) {
+        *flags = e->data_flags;
+        /*
+         * Data held inline is owned by the error queue just like a heap
+         * buffer, so report it the way it always has been.
+         */
+        if (e->data == e->inline_data)
+            *flags |= ERR_TXT_MALLOCED;
+    }
     if (data == NULL) {
         if (g == EV_POP) {
             err_clear_data(es, i, 0);
         }
     } else {
-        *data = es->err_data[i];
+        *data = e->data;
         if (*data == NULL) {
             *data = "";
             if (flags != NULL)
@@ -643,12 +649,12 @@ const char *ERR_reason_error_string(unsigned long e)
 
 static void err_delete_thread_state(void *unused)
 {
-    ERR_STATE *state = CRYPTO_THREAD_get_local(&err_thread_local);
+    ERR_QUEUE *state = CRYPTO_THREAD_get_local(&err_thread_local);
     if (state == NULL)
         return;
 
     CRYPTO_THREAD_set_local(&err_thread_local, NULL);
-    OSSL_ERR_STATE_free(state);
+    OSSL_ERR_STATE_free((ERR_STATE *)state);
 }
 
 #ifndef OPENSSL_NO_DEPRECATED_1_1_0
@@ -669,9 +675,9 @@ DEFINE_RUN_ONCE_STATIC(err_do_init)
     return CRYPTO_THREAD_init_local(&err_thread_local, NULL);
 }
 
-ERR_STATE *ossl_err_get_state_int(void)
+ERR_QUEUE *ossl_err_get_state_int(void)
 {
-    ERR_STATE *state;
+    ERR_QUEUE *state;
     int saveerrno = get_last_sys_error();
 
     if (!OPENSSL_init_crypto(OPENSSL_INIT_BASE_ONLY, NULL))
@@ -681,14 +687,14 @@ ERR_STATE *ossl_err_get_state_int(void)
         return NULL;
 
     state = CRYPTO_THREAD_get_local(&err_thread_local);
-    if (state == (ERR_STATE*)-1)
+    if (state == (ERR_QUEUE*)-1)
         return NULL;
 
     if (state == NULL) {
-        if (!CRYPTO_THREAD_set_local(&err_thread_local, (ERR_STATE*)-1))
+        if (!CRYPTO_THREAD_set_local(&err_thread_local, (ERR_QUEUE*)-1))
             return NULL;
 
-        state = OSSL_ERR_STATE_new();
+        state = (ERR_QUEUE *)OSSL_ERR_STATE_new();
         if (state == NULL) {
             CRYPTO_THREAD_set_local(&err_thread_local, NULL);
             return NULL;
@@ -696,7 +702,7 @@ ERR_STATE *ossl_err_get_state_int(void)
 
         if (!ossl_init_thread_start(NULL, NULL, err_delete_thread_state)
                 || !CRYPTO_THREAD_set_local(&err_thread_local, state)) {
-            OSSL_ERR_STATE_free(state);
+            OSSL_ERR_STATE_free((ERR_STATE *)state);
             CRYPTO_THREAD_set_local(&err_thread_local, NULL);
             return NULL;
         }
@@ -710,9 +716,43 @@ ERR_STATE *ossl_err_get_state_int(void)
 }
 
 #ifndef OPENSSL_NO_DEPRECATED_3_0
+/*
+ * The queue no longer has the layout of the public struct err_state_st, so
+ * fill in a copy of the live entries in that layout.  It is refreshed on
+ * every call and changes made through it don't reach the queue.
+ */
 ERR_STATE *ERR_get_state(void)
 {
-    return ossl_err_get_state_int();
+    ERR_QUEUE *es = ossl_err_get_state_int();
+    struct err_state_st *st;
+    int i;
+
+    if (es == NULL)
+        return NULL;
+    if (es->legacy == NULL
+            && (es->legacy = OPENSSL_malloc(sizeof(*es->legacy))) == NULL)
+        return NULL;
+
+    st = es->legacy;
+    memset(st, 0, sizeof(*st));
+    for (i = es->bottom; i != es->top;) {
+        const ERR_ENTRY *e;
+
+        i = (i + 1) % ERR_NUM_ERRORS;
+        e = &es->entries[i];
+        st->err_flags[i] = e->flags;
+        st->err_marks[i] = e->marks;
+        st->err_buffer[i] = e->buffer;
+        st->err_data[i] = e->data;
+        st->err_data_size[i] = e->data_size;
+        st->err_data_flags[i] = e->data_flags;
+        st->err_file[i] = (char *)e->file;
+        st->err_line[i] = e->line;
+        st->err_func[i] = (char *)e->func;
+    }
+    st->top = es->top;
+    st->bottom = es->bottom;
+    return st;
 }
 #endif
 
@@ -744,7 +784,7 @@ int err_shelve_state(void **state)
         return 0;
 
     *state = CRYPTO_THREAD_get_local(&err_thread_local);
-    if (!CRYPTO_THREAD_set_local(&err_thread_local, (ERR_STATE*)-1))
+    if (!CRYPTO_THREAD_set_local(&err_thread_local, (ERR_QUEUE*)-1))
         return 0;
 
     set_sys_error(saveerrno);
@@ -758,7 +798,7 @@ int err_shelve_state(void **state)
 void err_unshelve_state(void* state)
 {
     if (state != (void*)-1)
-        CRYPTO_THREAD_set_local(&err_thread_local, (ERR_STATE*)state);
+        CRYPTO_THREAD_set_local(&err_thread_local, (ERR_QUEUE*)state);
 }
 
 int ERR_get_next_error_library(void)
@@ -778,7 +818,7 @@ int ERR_get_next_error_library(void)
 static int err_set_error_data_int(char *data, size_t size, int flags,
                                   int deallocate)
 {
-    ERR_STATE *es;
+    ERR_QUEUE *es;
 
     es = ossl_err_get_state_int();
     if (es == NULL)
@@ -819,24 +859,27 @@ void ERR_add_error_data(int num, ...)
 
 void ERR_add_error_vdata(int num, va_list args)
 {
-    int i, len, size;
+    int len, size;
     int flags = ERR_TXT_MALLOCED | ERR_TXT_STRING;
     char *str, *arg;
-    ERR_STATE *es;
+    ERR_QUEUE *es;
+    ERR_ENTRY *e;
 
     /* Get the current error data; if an allocated string get it. */
     es = ossl_err_get_state_int();
     if (es == NULL)
         return;
-    i = es->top;
+    e = &es->entries[es->top];
 
     /*
-     * If err_data is allocated already, re-use the space.
-     * Otherwise, allocate a small new buffer.
+     * If err_data is allocated or held inline already, re-use the space.
+     * Otherwise, start with the inline buffer.
      */
-    if ((es->err_data_flags[i] & flags) == flags) {
-        str = es->err_data[i];
-        size = es->err_data_size[i];
+    if ((e->data_flags & flags) == flags
+            || ((e->data_flags & ERR_TXT_STRING) != 0
+                && e->data == e->inline_data)) {
+        str = e->data;
+        size = e->data_size;
 
         /*
          * To protect the string we just grabbed from tampering by other
@@ -845,11 +888,11 @@ void ERR_add_error_vdata(int num, va_list args)
          * data pointer and the flags.  We will set them again at the end
          * of this function.
          */
-        es->err_data[i] = NULL;
-        es->err_data_flags[i] = 0;
-    } else if ((str = OPENSSL_malloc(size = 81)) == NULL) {
-        return;
+        e->data = NULL;
+        e->data_flags = 0;
     } else {
+        str = e->inline_data;
+        size = sizeof(e->inline_data);
         str[0] = '\0';
     }
     len = strlen(str);
@@ -863,22 +906,30 @@ void ERR_add_error_vdata(int num, va_list args)
             char *p;
 
             size = len + 20;
-            p = OPENSSL_realloc(str, size);
+            if (str == e->inline_data) {
+                if ((p = OPENSSL_malloc(size)) != NULL)
+                    strcpy(p, str);
+            } else {
+                p = OPENSSL_realloc(str, size);
+            }
             if (p == NULL) {
-                OPENSSL_free(str);
+                if (str != e->inline_data)
+                    OPENSSL_free(str);
                 return;
             }
             str = p;
         }
         OPENSSL_strlcat(str, arg, (size_t)size);
     }
-    if (!err_set_error_data_int(str, size, flags, 0))
+    if (str == e->inline_data)
+        flags = ERR_TXT_STRING;
+    if (!err_set_error_data_int(str, size, flags, 0) && str != e->inline_data)
         OPENSSL_free(str);
 }
 
 void err_clear_last_constant_time(int clear)
 {
-    ERR_STATE *es;
+    ERR_QUEUE *es;
     int top;
 
     es = ossl_err_get_state_int();
@@ -893,5 +944,5 @@ void err_clear_last_constant_time(int clear)
      */
     clear = constant_time_select_int(constant_time_eq_int(clear, 0),
                                      0, ERR_FLAG_CLEAR);
-    es->err_flags[top] |= clear;
+    es->entries[top].flags |= clear;
 }
@@ -15,7 +15,7 @@
 
 void ERR_new(void)
 {
-    ERR_STATE *es;
+    ERR_QUEUE *es;
 
     es = ossl_err_get_state_int();
     if (es == NULL)
@@ -28,7 +28,7 @@ void ERR_new(void)
 
 void ERR_set_debug(const char *file, int line, const char *func)
 {
-    ERR_STATE *es;
+    ERR_QUEUE *es;
 
     es = ossl_err_get_state_int();
     if (es == NULL)
@@ -48,70 +48,28 @@ void ERR_set_error(int lib, int reason, const char *fmt, ...)
 
 void ERR_vset_error(int lib, int reason, const char *fmt, va_list args)
 {
-    ERR_STATE *es;
-    char *buf = NULL;
-    size_t buf_size = 0;
-    unsigned long flags = 0;
-    size_t i;
+    ERR_QUEUE *es;
+    char buf[ERR_MAX_DATA_SIZE];
+    int printed_len = 0;
 
     es = ossl_err_get_state_int();
     if (es == NULL)
         return;
-    i = es->top;
 
+    /*
+     * Format into a local buffer first, so short messages can be stored
+     * inline and a reused heap buffer never has to be resized up front.
+     */
     if (fmt != NULL) {
-        int printed_len = 0;
-        char *rbuf = NULL;
-
-        buf = es->err_data[i];
-        buf_size = es->err_data_size[i];
-
-        /*
-         * To protect the string we just grabbed from tampering by other
-         * functions we may call, or to protect them from freeing a pointer
-         * that may no longer be valid at that point, we clear away the
-         * data pointer and the flags.  We will set them again at the end
-         * of this function.
-         */
-        es->err_data[i] = NULL;
-        es->err_data_flags[i] = 0;
-
-        /*
-         * Try to maximize the space available.  If that fails, we use what
-         * we have.
-         */
-        if (buf_size < ERR_MAX_DATA_SIZE
-            && (rbuf = OPENSSL_realloc(buf, ERR_MAX_DATA_SIZE)) != NULL) {
-            buf = rbuf;
-            buf_size = ERR_MAX_DATA_SIZE;
-        }
-
-        if (buf != NULL) {
-            printed_len = BIO_vsnprintf(buf, buf_size, fmt, args);
-        }
+        printed_len = BIO_vsnprintf(buf, sizeof(buf), fmt, args);
         if (printed_len < 0)
             printed_len = 0;
-        if (buf != NULL)
-            buf[printed_len] = '\0';
-
-        /*
-         * Try to reduce the size, but only if we maximized above.  If that
-         * fails, we keep what we have.
-         * (According to documentation, realloc leaves the old buffer untouched
-         * if it fails)
-         */
-        if ((rbuf = OPENSSL_realloc(buf, printed_len + 1)) != NULL) {
-            buf = rbuf;
-            buf_size = printed_len + 1;
-            buf[printed_len] = '\0';
-        }
-
-        if (buf != NULL)
-            flags = ERR_TXT_MALLOCED | ERR_TXT_STRING;
+        else if ((size_t)printed_len >= sizeof(buf))
+            printed_len = sizeof(buf) - 1;
     }
 
     err_clear_data(es, es->top, 0);
     err_set_error(es, es->top, lib, reason);
     if (fmt != NULL)
-        err_set_data(es, es->top, buf, buf_size, flags);
+        err_set_data_copy(es, es->top, buf, printed_len);
 }
@@ -11,89 +11,201 @@
 #include <openssl/err.h>
 #include <openssl/e_os2.h>
 
-static ossl_inline void err_get_slot(ERR_STATE *es)
+/*
+ * Error data strings shorter than this are kept inside the error entry, so
+ * raising an error with a short message doesn't have to allocate.
+ */
+# define ERR_INLINE_DATA_SIZE    64
+
+typedef struct err_entry_st {
+    unsigned long buffer;
+    int flags;
+    int marks;
+    /*
+     * The file and function names are copied into |debug_buf|, since they
+     * may be owned by a provider or engine that gets unloaded before the
+     * error is looked at.  The buffer is kept when the entry is cleared so
+     * that it can be reused.
+     */
+    const char *file;
+    const char *func;
+    int line;
+    char *debug_buf;
+    size_t debug_buf_size;
+    /*
+     * |data| is either caller supplied, a heap buffer owned by the entry if
+     * ERR_TXT_MALLOCED is set, or |inline_data|.  The entry's own buffer is
+     * kept when the entry is cleared so that it can be reused.
+     */
+    char *data;
+    size_t data_size;
+    int data_flags;
+    char inline_data[ERR_INLINE_DATA_SIZE];
+} ERR_ENTRY;
+
+/*
+ * The error queue is a ring of entries.  Live entries are those after
+ * |bottom| up to and including |top|, the others are stale and only get
+ * cleared when they are reused.  This makes emptying the queue or popping
+ * entries off it a matter of moving |top| or |bottom|.
+ *
+ * This is what ERR_STATE pointers from OSSL_ERR_STATE_new() point at.  The
+ * deprecated public definition of ERR_STATE doesn't describe it any more, so
+ * ERR_get_state() hands out a copy in that layout, kept in |legacy|.
+ */
+typedef struct err_queue_st {
+    ERR_ENTRY entries[ERR_NUM_ERRORS];
+    int top, bottom;
+    struct err_state_st *legacy;
+} ERR_QUEUE;
+
+static ossl_inline int err_prev_slot(int i)
+{
+    return i > 0 ? i - 1 : ERR_NUM_ERRORS - 1;
+}
+
+static ossl_inline void err_get_slot(ERR_QUEUE *es)
 {
     es->top = (es->top + 1) % ERR_NUM_ERRORS;
     if (es->top == es->bottom)
         es->bottom = (es->bottom + 1) % ERR_NUM_ERRORS;
 }
 
-static ossl_inline void err_clear_data(ERR_STATE *es, size_t i, int deall)
+static ossl_inline void err_clear_data(ERR_QUEUE *es, size_t i, int deall)
 {
-    if (es->err_data_flags[i] & ERR_TXT_MALLOCED) {
+    ERR_ENTRY *e = &es->entries[i];
+
+    if (e->data_flags & ERR_TXT_MALLOCED) {
         if (deall) {
-            OPENSSL_free(es->err_data[i]);
-            es->err_data[i] = NULL;
-            es->err_data_size[i] = 0;
-            es->err_data_flags[i] = 0;
-        } else if (es->err_data[i] != NULL) {
-            es->err_data[i][0] = '\0';
-            es->err_data_flags[i] = ERR_TXT_MALLOCED;
+            OPENSSL_free(e->data);
+            e->data = NULL;
+            e->data_size = 0;
+            e->data_flags = 0;
+        } else if (e->data != NULL) {
+            e->data[0] = '\0';
+            e->data_flags = ERR_TXT_MALLOCED;
         }
+    } else if (e->data == e->inline_data && !deall) {
+        e->inline_data[0] = '\0';
+        e->data_flags = 0;
     } else {
-        es->err_data[i] = NULL;
-        es->err_data_size[i] = 0;
-        es->err_data_flags[i] = 0;
+        e->data = NULL;
+        e->data_size = 0;
+        e->data_flags = 0;
     }
 }
 
-static ossl_inline void err_set_error(ERR_STATE *es, size_t i,
+static ossl_inline void err_set_error(ERR_QUEUE *es, size_t i,
                                       int lib, int reason)
 {
-    es->err_buffer[i] =
+    es->entries[i].buffer =
         lib == ERR_LIB_SYS
         ? (unsigned int)(ERR_SYSTEM_FLAG |  reason)
         : ERR_PACK(lib, 0, reason);
 }
 
-static ossl_inline void err_set_debug(ERR_STATE *es, size_t i,
+static ossl_inline void err_set_debug(ERR_QUEUE *es, size_t i,
                                       const char *file, int line,
                                       const char *fn)
 {
-    /*
-     * We dup the file and fn strings because they may be provider owned. If the
-     * provider gets unloaded, they may not be valid anymore.
-     */
-    OPENSSL_free(es->err_file[i]);
-    if (file == NULL || file[0] == '\0')
-        es->err_file[i] = NULL;
-    else if ((es->err_file[i] = CRYPTO_malloc(strlen(file) + 1,
-                                              NULL, 0)) != NULL)
-        /* We cannot use OPENSSL_strdup due to possible recursion */
-        strcpy(es->err_file[i], file);
-
-    es->err_line[i] = line;
-    OPENSSL_free(es->err_func[i]);
-    if (fn == NULL || fn[0] == '\0')
-        es->err_func[i] = NULL;
-    else if ((es->err_func[i] = CRYPTO_malloc(strlen(fn) + 1,
-                                              NULL, 0)) != NULL)
-        strcpy(es->err_func[i], fn);
+    ERR_ENTRY *e = &es->entries[i];
+    size_t flen, fnlen, need;
+    char *p;
+
+    e->line = line;
+    /* Setting the names an entry already has, they're in |debug_buf| */
+    if (e->file == file && e->func == fn)
+        return;
+
+    flen = file == NULL ? 0 : strlen(file);
+    fnlen = fn == NULL ? 0 : strlen(fn);
+    need = flen + fnlen + 2;
+    e->file = e->func = NULL;
+    if (flen == 0 && fnlen == 0)
+        return;
+
+    if (need > e->debug_buf_size) {
+        /* We cannot use OPENSSL_realloc due to possible recursion */
+        if ((p = CRYPTO_realloc(e->debug_buf, need, NULL, 0)) == NULL)
+            return;
+        e->debug_buf = p;
+        e->debug_buf_size = need;
+    }
+    p = e->debug_buf;
+    if (flen != 0) {
+        memcpy(p, file, flen + 1);
+        e->file = p;
+        p += flen + 1;
+    }
+    if (fnlen != 0) {
+        memcpy(p, fn, fnlen + 1);
+        e->func = p;
+    }
 }
 
-static ossl_inline void err_set_data(ERR_STATE *es, size_t i,
+static ossl_inline void err_set_data(ERR_QUEUE *es, size_t i,
                                      void *data, size_t datasz, int flags)
 {
-    if ((es->err_data_flags[i] & ERR_TXT_MALLOCED) != 0)
-        OPENSSL_free(es->err_data[i]);
-    es->err_data[i] = data;
-    es->err_data_size[i] = datasz;
-    es->err_data_flags[i] = flags;
+    ERR_ENTRY *e = &es->entries[i];
+
+    if ((e->data_flags & ERR_TXT_MALLOCED) != 0 && e->data != data)
+        OPENSSL_free(e->data);
+    e->data = data;
+    e->data_size = datasz;
+    e->data_flags = flags;
+}
+
+/*
+ * Store a copy of the |len| bytes long string |str| as the error data,
+ * reusing the entry's heap buffer or its inline buffer when possible.
+ */
+static ossl_inline void err_set_data_copy(ERR_QUEUE *es, size_t i,
+                                          const char *str, size_t len)
+{
+    ERR_ENTRY *e = &es->entries[i];
+    char *buf;
+
+    if ((e->data_flags & ERR_TXT_MALLOCED) != 0 && e->data != NULL
+            && e->data_size > len) {
+        buf = e->data;
+        e->data_flags = ERR_TXT_MALLOCED | ERR_TXT_STRING;
+    } else if (len < sizeof(e->inline_data)) {
+        err_set_data(es, i, e->inline_data, sizeof(e->inline_data),
+                     ERR_TXT_STRING);
+        buf = e->inline_data;
+    } else {
+        if ((e->data_flags & ERR_TXT_MALLOCED) == 0)
+            e->data = NULL;
+        if ((buf = OPENSSL_realloc(e->data, len + 1)) == NULL) {
+            err_clear_data(es, i, 1);
+            return;
+        }
+        e->data = buf;
+        e->data_size = len + 1;
+        e->data_flags = ERR_TXT_MALLOCED | ERR_TXT_STRING;
+    }
+    memcpy(buf, str, len);
+    buf[len] = '\0';
 }
 
-static ossl_inline void err_clear(ERR_STATE *es, size_t i, int deall)
+static ossl_inline void err_clear(ERR_QUEUE *es, size_t i, int deall)
 {
+    ERR_ENTRY *e = &es->entries[i];
+
     err_clear_data(es, i, (deall));
-    es->err_marks[i] = 0;
-    es->err_flags[i] = 0;
-    es->err_buffer[i] = 0;
-    es->err_line[i] = -1;
-    OPENSSL_free(es->err_file[i]);
-    es->err_file[i] = NULL;
-    OPENSSL_free(es->err_func[i]);
-    es->err_func[i] = NULL;
+    e->marks = 0;
+    e->flags = 0;
+    e->buffer = 0;
+    e->line = -1;
+    e->file = NULL;
+    e->func = NULL;
+    if (deall) {
+        OPENSSL_free(e->debug_buf);
+        e->debug_buf = NULL;
+        e->debug_buf_size = 0;
+    }
 }
 
-ERR_STATE *ossl_err_get_state_int(void);
+ERR_QUEUE *ossl_err_get_state_int(void);
 void ossl_err_string_int(unsigned long e, const char *func,
                          char *buf, size_t len);
@@ -14,7 +14,7 @@
 
 int ERR_set_mark(void)
 {
-    ERR_STATE *es;
+    ERR_QUEUE *es;
 
     es = ossl_err_get_state_int();
     if (es == NULL)
@@ -22,33 +22,32 @@ int ERR_set_mark(void)
 
     if (es->bottom == es->top)
         return 0;
-    es->err_marks[es->top]++;
+    es->entries[es->top].marks++;
     return 1;
 }
 
 int ERR_pop_to_mark(void)
 {
-    ERR_STATE *es;
+    ERR_QUEUE *es;
 
     es = ossl_err_get_state_int();
     if (es == NULL)
         return 0;
 
+    /* Popped entries are cleared as they get reused */
     while (es->bottom != es->top
-           && es->err_marks[es->top] == 0) {
-        err_clear(es, es->top, 0);
-        es->top = es->top > 0 ? es->top - 1 : ERR_NUM_ERRORS - 1;
-    }
+           && es->entries[es->top].marks == 0)
+        es->top = err_prev_slot(es->top);
 
     if (es->bottom == es->top)
         return 0;
-    es->err_marks[es->top]--;
+    es->entries[es->top].marks--;
     return 1;
 }
 
 int ERR_clear_last_mark(void)
 {
-    ERR_STATE *es;
+    ERR_QUEUE *es;
     int top;
 
     es = ossl_err_get_state_int();
@@ -57,13 +56,12 @@ int ERR_clear_last_mark(void)
 
     top = es->top;
     while (es->bottom != top
-           && es->err_marks[top] == 0) {
-        top = top > 0 ? top - 1 : ERR_NUM_ERRORS - 1;
-    }
+           && es->entries[top].marks == 0)
+        top = err_prev_slot(top);
 
     if (es->bottom == top)
         return 0;
-    es->err_marks[top]--;
+    es->entries[top].marks--;
     return 1;
 }
 
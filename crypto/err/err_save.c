@@ -20,13 +20,15 @@
 
 ERR_STATE *OSSL_ERR_STATE_new(void)
 {
-    return CRYPTO_zalloc(sizeof(ERR_STATE), NULL, 0);
+    return CRYPTO_zalloc(sizeof(ERR_QUEUE), NULL, 0);
 }
 
-void OSSL_ERR_STATE_save(ERR_STATE *es)
+void OSSL_ERR_STATE_save(ERR_STATE *state)
 {
     size_t i;
-    ERR_STATE *thread_es;
+    ERR_QUEUE *es = (ERR_QUEUE *)state;
+    ERR_QUEUE *thread_es;
+    struct err_state_st *legacy;
 
     if (es == NULL)
         return;
@@ -38,15 +40,25 @@ void OSSL_ERR_STATE_save(ERR_STATE *es)
     if (thread_es == NULL)
         return;
 
+    legacy = es->legacy;
     memcpy(es, thread_es, sizeof(*es));
+    /* Data held inline has to point at the copy */
+    for (i = 0; i < ERR_NUM_ERRORS; i++)
+        if (thread_es->entries[i].data == thread_es->entries[i].inline_data)
+            es->entries[i].data = es->entries[i].inline_data;
+    /* ERR_get_state() copies stay with the queue they were made for */
+    es->legacy = legacy;
+    legacy = thread_es->legacy;
     /* Taking over the pointers, just clear the thread state. */
     memset(thread_es, 0, sizeof(*thread_es));
+    thread_es->legacy = legacy;
 }
 
-void OSSL_ERR_STATE_restore(const ERR_STATE *es)
+void OSSL_ERR_STATE_restore(const ERR_STATE *state)
 {
     size_t i;
-    ERR_STATE *thread_es;
+    const ERR_QUEUE *es = (const ERR_QUEUE *)state;
+    ERR_QUEUE *thread_es;
 
     if (es == NULL || es->bottom == es->top)
         return;
@@ -56,31 +68,36 @@ void OSSL_ERR_STATE_restore(const ERR_STATE *es)
         return;
 
     for (i = (size_t)es->bottom; i != (size_t)es->top;) {
+        const ERR_ENTRY *e;
         size_t top;
 
         i = (i + 1) % ERR_NUM_ERRORS;
-        if ((es->err_flags[i] & ERR_FLAG_CLEAR) != 0)
+        e = &es->entries[i];
+        if ((e->flags & ERR_FLAG_CLEAR) != 0)
             continue;
 
         err_get_slot(thread_es);
         top = thread_es->top;
         err_clear(thread_es, top, 0);
 
-        thread_es->err_flags[top] = es->err_flags[i];
-        thread_es->err_buffer[top] = es->err_buffer[i];
+        thread_es->entries[top].flags = e->flags;
+        thread_es->entries[top].buffer = e->buffer;
 
-        err_set_debug(thread_es, top, es->err_file[i], es->err_line[i],
-                      es->err_func[i]);
+        err_set_debug(thread_es, top, e->file, e->line, e->func);
 
-        if (es->err_data[i] != NULL && es->err_data_size[i] != 0) {
-            void *data;
-            size_t data_sz = es->err_data_size[i];
+        if (e->data != NULL && e->data_size != 0) {
+            if ((e->data_flags & ERR_TXT_STRING) != 0) {
+                err_set_data_copy(thread_es, top, e->data, strlen(e->data));
+            } else {
+                void *data;
+                size_t data_sz = e->data_size;
 
-            data = CRYPTO_malloc(data_sz, NULL, 0);
-            if (data != NULL) {
-                memcpy(data, es->err_data[i], data_sz);
-                err_set_data(thread_es, top, data, data_sz,
-                             es->err_data_flags[i] | ERR_TXT_MALLOCED);
+                data = CRYPTO_malloc(data_sz, NULL, 0);
+                if (data != NULL) {
+                    memcpy(data, e->data, data_sz);
+                    err_set_data(thread_es, top, data, data_sz,
+                                 e->data_flags | ERR_TXT_MALLOCED);
+                }
             }
         } else {
             err_clear_data(thread_es, top, 0);
@@ -700,6 +700,100 @@ int EVP_Digest(const void *data, size_t count,
     return ret;
 }
 
+/* The number of messages passed to the provider at a time */
+#define DIGEST_BATCH_CHUNK  64
+
+/*
+ * Find the provided implementation that EVP_DigestInit_ex() would end up
+ * using for |type|, with a reference on it, or NULL if the messages have to
+ * be hashed the legacy way.
+ */
+static EVP_MD *digest_batch_md(const EVP_MD *type, ENGINE *impl)
+{
+#if !defined(OPENSSL_NO_ENGINE) && !defined(FIPS_MODULE)
+    ENGINE *tmpimpl;
+#endif
+
+    if (impl != NULL || type->origin == EVP_ORIG_METH)
+        return NULL;
+#if !defined(OPENSSL_NO_ENGINE) && !defined(FIPS_MODULE)
+    if ((tmpimpl = ENGINE_get_digest_engine(type->type)) != NULL) {
+        ENGINE_finish(tmpimpl);
+        return NULL;
+    }
+#endif
+    if (type->prov != NULL)
+        return EVP_MD_up_ref((EVP_MD *)type) ? (EVP_MD *)type : NULL;
+#ifdef FIPS_MODULE
+    return NULL;
+#else
+    return EVP_MD_fetch(NULL, type->type != NID_undef ? OBJ_nid2sn(type->type)
+                                                      : "NULL", "");
+#endif
+}
+
+int EVP_DigestBatch(const EVP_DIGEST_BATCH_ITEM *items, size_t num,
+                    unsigned int *size, const EVP_MD *type, ENGINE *impl)
+{
+    const unsigned char *in[DIGEST_BATCH_CHUNK];
+    size_t inl[DIGEST_BATCH_CHUNK];
+    unsigned char *out[DIGEST_BATCH_CHUNK];
+    EVP_MD *md = NULL;
+    EVP_MD_CTX *ctx = NULL;
+    size_t i, j, n, outl = 0;
+    int mdsize, ret = 0;
+
+    if (type == NULL || (items == NULL && num > 0)) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_PASSED_NULL_PARAMETER);
+        return 0;
+    }
+
+    md = digest_batch_md(type, impl);
+    if (md != NULL && md->batch != NULL) {
+        if ((mdsize = EVP_MD_get_size(md)) <= 0) {
+            ERR_raise(ERR_LIB_EVP, EVP_R_INVALID_DIGEST);
+            goto err;
+        }
+        for (i = 0; i < num; i += n) {
+            n = num - i < DIGEST_BATCH_CHUNK ? num - i : DIGEST_BATCH_CHUNK;
+            for (j = 0; j < n; j++) {
+                in[j] = items[i + j].data;
+                inl[j] = items[i + j].datalen;
+                out[j] = items[i + j].md;
+            }
+            if (!md->batch(ossl_provider_ctx(md->prov), in, inl, out, n,
+                           &outl, (size_t)mdsize)) {
+                ERR_raise(ERR_LIB_EVP, EVP_R_FINAL_ERROR);
+                goto err;
+            }
+        }
+        if (size != NULL)
+            *size = (unsigned int)mdsize;
+        ret = 1;
+        goto err;
+    }
+
+    /* One message after the other, reusing the same context */
+    if ((ctx = EVP_MD_CTX_new()) == NULL)
+        goto err;
+    EVP_MD_CTX_set_flags(ctx, EVP_MD_CTX_FLAG_ONESHOT);
+    for (i = 0; i < num; i++)
+        if (!EVP_DigestInit_ex(ctx, type, impl)
+                || !EVP_DigestUpdate(ctx, items[i].data, items[i].datalen)
+                || !EVP_DigestFinal_ex(ctx, items[i].md, size))
+            goto err;
+    if (num == 0 && size != NULL) {
+        if ((mdsize = EVP_MD_get_size(type)) < 0)
+            goto err;
+        *size = (unsigned int)mdsize;
+    }
+    ret = 1;
+ err:
+    EVP_MD_CTX_free(ctx);
+    EVP_MD_free(md);
+    return ret;
+}
+
 int EVP_Q_digest(OSSL_LIB_CTX *libctx, const char *name, const char *propq,
                  const void *data, size_t datalen,
                  unsigned char *md, size_t *mdlen)
@@ -1028,6 +1122,11 @@ static void *evp_md_from_algorithm(int name_id,
                 md->digest = OSSL_FUNC_digest_digest(fns);
             /* We don't increment fnct for this as it is stand alone */
             break;
+        case OSSL_FUNC_DIGEST_BATCH:
+            if (md->batch == NULL)
+                md->batch = OSSL_FUNC_digest_batch(fns);
+            /* Stand alone too */
+            break;
         case OSSL_FUNC_DIGEST_FREECTX:
             if (md->freectx == NULL) {
                 md->freectx = OSSL_FUNC_digest_freectx(fns);
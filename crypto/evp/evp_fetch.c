@@ -404,6 +404,13 @@ int evp_method_store_cache_flush(OSSL_LIB_CTX *libctx)
     return 1;
 }
 
+int evp_method_store_freeze(OSSL_LIB_CTX *libctx, const char *propq)
+{
+    OSSL_METHOD_STORE *store = get_evp_method_store(libctx);
+
+    return store != NULL && ossl_method_store_freeze(store, propq);
+}
+
 int evp_method_store_remove_all_provided(const OSSL_PROVIDER *prov)
 {
     OSSL_LIB_CTX *libctx = ossl_provider_libctx(prov);
@@ -151,6 +151,7 @@ struct evp_keyexch_st {
     OSSL_FUNC_keyexch_settable_ctx_params_fn *settable_ctx_params;
     OSSL_FUNC_keyexch_get_ctx_params_fn *get_ctx_params;
     OSSL_FUNC_keyexch_gettable_ctx_params_fn *gettable_ctx_params;
+    OSSL_FUNC_keyexch_derive_batch_fn *derive_batch;
 } /* EVP_KEYEXCH */;
 
 struct evp_signature_st {
@@ -185,6 +186,8 @@ struct evp_signature_st {
     OSSL_FUNC_signature_gettable_ctx_md_params_fn *gettable_ctx_md_params;
     OSSL_FUNC_signature_set_ctx_md_params_fn *set_ctx_md_params;
     OSSL_FUNC_signature_settable_ctx_md_params_fn *settable_ctx_md_params;
+    OSSL_FUNC_signature_verify_batch_fn *verify_batch;
+    OSSL_FUNC_signature_sign_batch_fn *sign_batch;
 } /* EVP_SIGNATURE */;
 
 struct evp_asym_cipher_st {
@@ -368,3 +371,9 @@ int evp_names_do_all(OSSL_PROVIDER *prov, int number,
                      void (*fn)(const char *name, void *data),
                      void *data);
 int evp_cipher_cache_constants(EVP_CIPHER *cipher);
+
+/* The number of items of a batch passed to the provider at a time */
+#define PKEY_BATCH_CHUNK    64
+
+void *evp_pkey_batch_provkey(EVP_PKEY_CTX *ctx, EVP_KEYMGMT *keymgmt,
+                             EVP_PKEY *pkey);
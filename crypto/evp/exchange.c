@@ -78,6 +78,11 @@ static void *evp_keyexch_from_algorithm(int name_id,
             exchange->derive = OSSL_FUNC_keyexch_derive(fns);
             fncnt++;
             break;
+        case OSSL_FUNC_KEYEXCH_DERIVE_BATCH:
+            if (exchange->derive_batch != NULL)
+                break;
+            exchange->derive_batch = OSSL_FUNC_keyexch_derive_batch(fns);
+            break;
         case OSSL_FUNC_KEYEXCH_FREECTX:
             if (exchange->freectx != NULL)
                 break;
@@ -126,7 +131,7 @@ static void *evp_keyexch_from_algorithm(int name_id,
          * and freectx. The set_ctx_params and settable_ctx_params functions are
          * optional, but if one of them is present then the other one must also
          * be present. Same goes for get_ctx_params and gettable_ctx_params.
-         * The dupctx and set_peer functions are optional.
+         * The dupctx, set_peer and derive_batch functions are optional.
          */
         ERR_raise(ERR_LIB_EVP, EVP_R_INVALID_PROVIDER_FUNCTIONS);
         goto err;
@@ -534,6 +539,92 @@ int EVP_PKEY_derive(EVP_PKEY_CTX *ctx, unsigned char *key, size_t *pkeylen)
         return ctx->pmeth->derive(ctx, key, pkeylen);
 }
 
+int EVP_PKEY_derive_batch(EVP_PKEY_CTX *ctx,
+                          EVP_PKEY_DERIVE_BATCH_ITEM *items, size_t num)
+{
+    void *keys[PKEY_BATCH_CHUNK], *peers[PKEY_BATCH_CHUNK];
+    unsigned char *secret[PKEY_BATCH_CHUNK];
+    size_t secretlen[PKEY_BATCH_CHUNK], outlen[PKEY_BATCH_CHUNK];
+    EVP_KEYEXCH *exchange;
+    EVP_KEYMGMT *keymgmt = NULL;
+    size_t i, j, n;
+    int ret;
+
+    if (ctx == NULL) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_PASSED_NULL_PARAMETER);
+        return -1;
+    }
+
+    if (!EVP_PKEY_CTX_IS_DERIVE_OP(ctx)) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_OPERATION_NOT_INITIALIZED);
+        return -1;
+    }
+
+    if (items == NULL && num != 0) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_PASSED_NULL_PARAMETER);
+        return -1;
+    }
+    for (i = 0; i < num; i++) {
+        if (items[i].peer == NULL || items[i].key == NULL) {
+            ERR_raise(ERR_LIB_EVP, ERR_R_PASSED_NULL_PARAMETER);
+            return -1;
+        }
+    }
+
+    if (ctx->op.kex.algctx == NULL
+            || ctx->op.kex.exchange->derive_batch == NULL) {
+        /* One by one, which can only be done with the key of |ctx| */
+        for (i = 0; i < num; i++) {
+            if (items[i].pkey != NULL && items[i].pkey != ctx->pkey) {
+                ERR_raise(ERR_LIB_EVP,
+                          EVP_R_OPERATION_NOT_SUPPORTED_FOR_THIS_KEYTYPE);
+                return -2;
+            }
+        }
+        for (i = 0; i < num; i++) {
+            ret = EVP_PKEY_derive_set_peer_ex(ctx, items[i].peer, 0);
+            if (ret <= 0)
+                return ret;
+            ret = EVP_PKEY_derive(ctx, items[i].key, &items[i].keylen);
+            if (ret <= 0)
+                return ret;
+        }
+        return 1;
+    }
+
+    exchange = ctx->op.kex.exchange;
+    keymgmt = evp_keymgmt_fetch_from_prov(exchange->prov,
+                                          EVP_KEYMGMT_get0_name(ctx->keymgmt),
+                                          ctx->propquery);
+    if (keymgmt == NULL) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_INITIALIZATION_ERROR);
+        return -1;
+    }
+
+    ret = 1;
+    for (i = 0; i < num && ret > 0; i += n) {
+        n = num - i < PKEY_BATCH_CHUNK ? num - i : PKEY_BATCH_CHUNK;
+        for (j = 0; j < n; j++) {
+            keys[j] = evp_pkey_batch_provkey(ctx, keymgmt, items[i + j].pkey);
+            peers[j] = evp_pkey_batch_provkey(ctx, keymgmt, items[i + j].peer);
+            if (keys[j] == NULL || peers[j] == NULL) {
+                ret = -1;
+                goto end;
+            }
+            secret[j] = items[i + j].key;
+            outlen[j] = items[i + j].keylen;
+        }
+        ret = exchange->derive_batch(ctx->op.kex.algctx, keys, peers, secret,
+                                     secretlen, outlen, n);
+        if (ret > 0)
+            for (j = 0; j < n; j++)
+                items[i + j].keylen = secretlen[j];
+    }
+ end:
+    EVP_KEYMGMT_free(keymgmt);
+    return ret;
+}
+
 int evp_keyexch_get_number(const EVP_KEYEXCH *keyexch)
 {
     return keyexch->name_id;
@@ -492,6 +492,12 @@ EVP_PKEY_CTX *EVP_PKEY_CTX_dup(const EVP_PKEY_CTX *pctx)
     }
     rctx->legacy_keytype = pctx->legacy_keytype;
 
+    if (pctx->keymgmt != NULL) {
+        if (!EVP_KEYMGMT_up_ref(pctx->keymgmt))
+            goto err;
+        rctx->keymgmt = pctx->keymgmt;
+    }
+
     if (EVP_PKEY_CTX_IS_DERIVE_OP(pctx)) {
         if (pctx->op.kex.exchange != NULL) {
             rctx->op.kex.exchange = pctx->op.kex.exchange;
@@ -1989,3 +1995,26 @@ void EVP_PKEY_meth_get_digest_custom(const EVP_PKEY_METHOD *pmeth,
 }
 
 #endif /* FIPS_MODULE */
+
+/*
+ * Get the provider side key of one item of a batch, exported to |keymgmt|
+ * if need be.  Items without a key of their own use the key of |ctx|.
+ */
+void *evp_pkey_batch_provkey(EVP_PKEY_CTX *ctx, EVP_KEYMGMT *keymgmt,
+                             EVP_PKEY *pkey)
+{
+    EVP_KEYMGMT *tmp_keymgmt = keymgmt;
+    void *provkey;
+
+    if (pkey == NULL) {
+        pkey = ctx->pkey;
+    } else if (!EVP_PKEY_is_a(pkey, EVP_KEYMGMT_get0_name(ctx->keymgmt))) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_DIFFERENT_KEY_TYPES);
+        return NULL;
+    }
+    provkey = evp_pkey_export_to_provider(pkey, ctx->libctx, &tmp_keymgmt,
+                                          ctx->propquery);
+    if (provkey == NULL)
+        ERR_raise(ERR_LIB_EVP, EVP_R_INITIALIZATION_ERROR);
+    return provkey;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright 2006-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2006-2023 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -221,6 +221,16 @@ static void *evp_signature_from_algorithm(int name_id,
                 = OSSL_FUNC_signature_settable_ctx_md_params(fns);
             smdparamfncnt++;
             break;
+        case OSSL_FUNC_SIGNATURE_VERIFY_BATCH:
+            if (signature->verify_batch != NULL)
+                break;
+            signature->verify_batch = OSSL_FUNC_signature_verify_batch(fns);
+            break;
+        case OSSL_FUNC_SIGNATURE_SIGN_BATCH:
+            if (signature->sign_batch != NULL)
+                break;
+            signature->sign_batch = OSSL_FUNC_signature_sign_batch(fns);
+            break;
         }
     }
     if (ctxfncnt != 2
@@ -657,6 +667,93 @@ int EVP_PKEY_sign(EVP_PKEY_CTX *ctx,
         return ctx->pmeth->sign(ctx, sig, siglen, tbs, tbslen);
 }
 
+int EVP_PKEY_sign_batch(EVP_PKEY_CTX *ctx,
+                        EVP_PKEY_SIGN_BATCH_ITEM *items, size_t num)
+{
+    void *keys[PKEY_BATCH_CHUNK];
+    unsigned char *sig[PKEY_BATCH_CHUNK];
+    const unsigned char *tbs[PKEY_BATCH_CHUNK];
+    size_t siglen[PKEY_BATCH_CHUNK], sigsize[PKEY_BATCH_CHUNK];
+    size_t tbslen[PKEY_BATCH_CHUNK];
+    EVP_SIGNATURE *signature;
+    EVP_KEYMGMT *keymgmt = NULL;
+    size_t i, j, n;
+    int ret;
+
+    if (ctx == NULL) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_OPERATION_NOT_SUPPORTED_FOR_THIS_KEYTYPE);
+        return -2;
+    }
+
+    if (ctx->operation != EVP_PKEY_OP_SIGN) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_OPERATION_NOT_INITIALIZED);
+        return -1;
+    }
+
+    if (items == NULL && num != 0) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_PASSED_NULL_PARAMETER);
+        return -1;
+    }
+    for (i = 0; i < num; i++) {
+        if (items[i].sig == NULL) {
+            ERR_raise(ERR_LIB_EVP, ERR_R_PASSED_NULL_PARAMETER);
+            return -1;
+        }
+    }
+
+    if (ctx->op.sig.algctx == NULL
+            || ctx->op.sig.signature->sign_batch == NULL) {
+        /* One by one, which can only be done with the key of |ctx| */
+        for (i = 0; i < num; i++) {
+            if (items[i].pkey != NULL && items[i].pkey != ctx->pkey) {
+                ERR_raise(ERR_LIB_EVP,
+                          EVP_R_OPERATION_NOT_SUPPORTED_FOR_THIS_KEYTYPE);
+                return -2;
+            }
+        }
+        for (i = 0; i < num; i++) {
+            ret = EVP_PKEY_sign(ctx, items[i].sig, &items[i].siglen,
+                                items[i].tbs, items[i].tbslen);
+            if (ret <= 0)
+                return ret;
+        }
+        return 1;
+    }
+
+    signature = ctx->op.sig.signature;
+    keymgmt = evp_keymgmt_fetch_from_prov(signature->prov,
+                                          EVP_KEYMGMT_get0_name(ctx->keymgmt),
+                                          ctx->propquery);
+    if (keymgmt == NULL) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_INITIALIZATION_ERROR);
+        return -1;
+    }
+
+    ret = 1;
+    for (i = 0; i < num && ret > 0; i += n) {
+        n = num - i < PKEY_BATCH_CHUNK ? num - i : PKEY_BATCH_CHUNK;
+        for (j = 0; j < n; j++) {
+            keys[j] = evp_pkey_batch_provkey(ctx, keymgmt, items[i + j].pkey);
+            if (keys[j] == NULL) {
+                ret = -1;
+                goto end;
+            }
+            sig[j] = items[i + j].sig;
+            sigsize[j] = items[i + j].siglen;
+            tbs[j] = items[i + j].tbs;
+            tbslen[j] = items[i + j].tbslen;
+        }
+        ret = signature->sign_batch(ctx->op.sig.algctx, keys, sig, siglen,
+                                    sigsize, tbs, tbslen, n);
+        if (ret > 0)
+            for (j = 0; j < n; j++)
+                items[i + j].siglen = siglen[j];
+    }
+ end:
+    EVP_KEYMGMT_free(keymgmt);
+    return ret;
+}
+
 int EVP_PKEY_verify_init(EVP_PKEY_CTX *ctx)
 {
     return evp_pkey_signature_init(ctx, EVP_PKEY_OP_VERIFY, NULL);
@@ -699,6 +796,82 @@ int EVP_PKEY_verify(EVP_PKEY_CTX *ctx,
     return ctx->pmeth->verify(ctx, sig, siglen, tbs, tbslen);
 }
 
+int EVP_PKEY_verify_batch(EVP_PKEY_CTX *ctx,
+                          const EVP_PKEY_VERIFY_BATCH_ITEM *items, size_t num)
+{
+    void *keys[PKEY_BATCH_CHUNK];
+    const unsigned char *sig[PKEY_BATCH_CHUNK], *tbs[PKEY_BATCH_CHUNK];
+    size_t siglen[PKEY_BATCH_CHUNK], tbslen[PKEY_BATCH_CHUNK];
+    EVP_SIGNATURE *signature;
+    EVP_KEYMGMT *keymgmt = NULL;
+    size_t i, j, n;
+    int ret;
+
+    if (ctx == NULL) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_OPERATION_NOT_SUPPORTED_FOR_THIS_KEYTYPE);
+        return -2;
+    }
+
+    if (ctx->operation != EVP_PKEY_OP_VERIFY) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_OPERATION_NOT_INITIALIZED);
+        return -1;
+    }
+
+    if (items == NULL && num != 0) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_PASSED_NULL_PARAMETER);
+        return -1;
+    }
+
+    if (ctx->op.sig.algctx == NULL
+            || ctx->op.sig.signature->verify_batch == NULL) {
+        /* One by one, which can only be done with the key of |ctx| */
+        for (i = 0; i < num; i++) {
+            if (items[i].pkey != NULL && items[i].pkey != ctx->pkey) {
+                ERR_raise(ERR_LIB_EVP,
+                          EVP_R_OPERATION_NOT_SUPPORTED_FOR_THIS_KEYTYPE);
+                return -2;
+            }
+        }
+        for (i = 0; i < num; i++) {
+            ret = EVP_PKEY_verify(ctx, items[i].sig, items[i].siglen,
+                                  items[i].tbs, items[i].tbslen);
+            if (ret <= 0)
+                return ret;
+        }
+        return 1;
+    }
+
+    signature = ctx->op.sig.signature;
+    keymgmt = evp_keymgmt_fetch_from_prov(signature->prov,
+                                          EVP_KEYMGMT_get0_name(ctx->keymgmt),
+                                          ctx->propquery);
+    if (keymgmt == NULL) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_INITIALIZATION_ERROR);
+        return -1;
+    }
+
+    ret = 1;
+    for (i = 0; i < num && ret > 0; i += n) {
+        n = num - i < PKEY_BATCH_CHUNK ? num - i : PKEY_BATCH_CHUNK;
+        for (j = 0; j < n; j++) {
+            keys[j] = evp_pkey_batch_provkey(ctx, keymgmt, items[i + j].pkey);
+            if (keys[j] == NULL) {
+                ret = -1;
+                goto end;
+            }
+            sig[j] = items[i + j].sig;
+            siglen[j] = items[i + j].siglen;
+            tbs[j] = items[i + j].tbs;
+            tbslen[j] = items[i + j].tbslen;
+        }
+        ret = signature->verify_batch(ctx->op.sig.algctx, keys, sig, siglen,
+                                      tbs, tbslen, n);
+    }
+ end:
+    EVP_KEYMGMT_free(keymgmt);
+    return ret;
+}
+
 int EVP_PKEY_verify_recover_init(EVP_PKEY_CTX *ctx)
 {
     return evp_pkey_signature_init(ctx, EVP_PKEY_OP_VERIFYRECOVER, NULL);
@@ -0,0 +1,380 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <openssl/crypto.h>
+#include "internal/hashtable.h"
+#include "internal/rcu.h"
+
+/*
+ * The table is an array of slots holding an item pointer and its hash.
+ * A slot is empty (NULL), live, or dead.  A dead slot is left behind when
+ * an item is removed, so that probe sequences running across it aren't cut
+ * short.  Dead slots are only ever reclaimed by rebuilding the table.
+ *
+ * With lockless reads enabled, slots are only ever changed by atomically
+ * replacing the item pointer, and a slot's hash is written once, before
+ * the slot becomes live.  The table itself is replaced on a rebuild, the
+ * old one is freed after an RCU grace period.  Items that are deleted or
+ * replaced one at a time are queued with ossl_rcu_call() and released in
+ * batches, so that a single change doesn't wait for a whole grace period.
+ * ossl_ht_filter() instead marks the items it removes by setting the lowest
+ * bit of their pointers until the grace period is over, after which they
+ * are released and the slots are plain dead.
+ */
+
+#define HT_MIN_SIZE         16
+/* The number of queued items that are released together */
+#define HT_FREE_BATCH       64
+
+#define HT_DEAD             ((void *)1)
+#define HT_IS_DEAD(p)       (((uintptr_t)(p) & 1) != 0)
+#define HT_MARK_DEAD(p)     ((void *)((uintptr_t)(p) | 1))
+#define HT_UNMARK(p)        ((void *)((uintptr_t)(p) & ~(uintptr_t)1))
+
+typedef struct {
+    unsigned long hash;
+    void *item;
+} HT_SLOT;
+
+typedef struct {
+    size_t mask;
+    unsigned int shift;
+    HT_SLOT slots[1];
+} HT_TABLE;
+
+struct ossl_ht_st {
+    HT_TABLE *table;
+    OSSL_HT_HASH_FN hash;
+    OSSL_HT_CMP_FN cmp;
+    OSSL_HT_FREE_FN free_fn;
+    uint32_t flags;
+    size_t num_items;
+    size_t num_dead;
+    size_t num_queued;
+    CRYPTO_RCU_LOCK *lock;
+};
+
+#define HT_LOCKLESS(ht)     (((ht)->flags & OSSL_HT_LOCKLESS_READS) != 0)
+
+static ossl_inline void *ht_load(const OSSL_HT *ht, void **p)
+{
+    return HT_LOCKLESS(ht) ? ossl_rcu_uptr_deref(p) : *p;
+}
+
+static ossl_inline void ht_store(OSSL_HT *ht, void **p, void *v)
+{
+    if (HT_LOCKLESS(ht))
+        ossl_rcu_assign_uptr(p, &v);
+    else
+        *p = v;
+}
+
+/* This also releases all queued items */
+static ossl_inline void ht_synchronize(OSSL_HT *ht)
+{
+    if (HT_LOCKLESS(ht)) {
+        ossl_synchronize_rcu(ht->lock);
+        ht->num_queued = 0;
+    }
+}
+
+static ossl_inline void ht_free_item(OSSL_HT *ht, void *item)
+{
+    if (ht->free_fn != NULL)
+        ht->free_fn(item);
+}
+
+/*
+ * Release an item that has been taken out of the table, once no reader can
+ * see it any more.  If it can't be queued, wait for the readers right away.
+ */
+static void ht_retire_item(OSSL_HT *ht, void *item)
+{
+    if (!HT_LOCKLESS(ht) || ht->free_fn == NULL) {
+        ht_free_item(ht, item);
+        return;
+    }
+    if (!ossl_rcu_call(ht->lock, ht->free_fn, item)) {
+        ht_synchronize(ht);
+        ht_free_item(ht, item);
+        return;
+    }
+    if (++ht->num_queued >= HT_FREE_BATCH)
+        ht_synchronize(ht);
+}
+
+/*
+ * Fibonacci hashing: the top bits of the product are well mixed even when
+ * the hash function only produces good low bits, or the other way around.
+ */
+static ossl_inline size_t ht_index(const HT_TABLE *t, unsigned long hash)
+{
+    return (size_t)(((uint64_t)hash * 0x9E3779B97F4A7C15ULL) >> t->shift);
+}
+
+static HT_TABLE *ht_table_new(size_t nelem)
+{
+    HT_TABLE *t;
+    size_t size = HT_MIN_SIZE;
+    unsigned int bits = 4;
+
+    /* Start off with a load factor of at most one half */
+    while (size < 2 * nelem) {
+        size <<= 1;
+        bits++;
+    }
+    t = OPENSSL_zalloc(sizeof(*t) + (size - 1) * sizeof(t->slots[0]));
+    if (t != NULL) {
+        t->mask = size - 1;
+        t->shift = 64 - bits;
+    }
+    return t;
+}
+
+/* Move the live items to a fresh table sized for |nelem| items */
+static int ht_rebuild(OSSL_HT *ht, size_t nelem)
+{
+    HT_TABLE *old = ht->table, *new;
+    size_t i, j;
+
+    if ((new = ht_table_new(nelem)) == NULL)
+        return 0;
+    for (i = 0; i <= old->mask; i++) {
+        void *item = old->slots[i].item;
+
+        if (item == NULL || HT_IS_DEAD(item))
+            continue;
+        for (j = ht_index(new, old->slots[i].hash); new->slots[j].item != NULL;
+             j = (j + 1) & new->mask)
+            continue;
+        new->slots[j] = old->slots[i];
+    }
+    ht_store(ht, (void **)&ht->table, new);
+    ht->num_dead = 0;
+    ht_synchronize(ht);
+    OPENSSL_free(old);
+    return 1;
+}
+
+/* Rebuild when dead slots make up more than a quarter of the table */
+static void ht_maybe_compact(OSSL_HT *ht)
+{
+    if (ht->num_dead * 4 > ht->table->mask + 1)
+        (void)ht_rebuild(ht, ht->num_items);
+}
+
+OSSL_HT *ossl_ht_new(OSSL_HT_HASH_FN hash, OSSL_HT_CMP_FN cmp,
+                     OSSL_HT_FREE_FN free_fn, uint32_t flags)
+{
+    OSSL_HT *ht;
+
+    if ((ht = OPENSSL_zalloc(sizeof(*ht))) == NULL)
+        return NULL;
+    ht->hash = hash;
+    ht->cmp = cmp;
+    ht->free_fn = free_fn;
+    ht->flags = flags;
+    if ((ht->table = ht_table_new(0)) == NULL)
+        goto err;
+    if (HT_LOCKLESS(ht) && (ht->lock = ossl_rcu_lock_new()) == NULL)
+        goto err;
+    return ht;
+
+ err:
+    OPENSSL_free(ht->table);
+    OPENSSL_free(ht);
+    return NULL;
+}
+
+void ossl_ht_free(OSSL_HT *ht)
+{
+    size_t i;
+
+    if (ht == NULL)
+        return;
+
+    for (i = 0; i <= ht->table->mask; i++) {
+        void *item = ht->table->slots[i].item;
+
+        if (item != NULL && !HT_IS_DEAD(item))
+            ht_free_item(ht, item);
+    }
+    OPENSSL_free(ht->table);
+    ossl_rcu_lock_free(ht->lock);
+    OPENSSL_free(ht);
+}
+
+int ossl_ht_insert(OSSL_HT *ht, void *item)
+{
+    unsigned long hash = ht->hash(item);
+    HT_TABLE *t;
+    void *old;
+    size_t i;
+
+    /* Keep the load at or below three quarters, counting dead slots */
+    if ((ht->num_items + ht->num_dead + 1) * 4 > (ht->table->mask + 1) * 3
+            && !ht_rebuild(ht, ht->num_items + 1))
+        return 0;
+
+    t = ht->table;
+    for (i = ht_index(t, hash); (old = t->slots[i].item) != NULL;
+         i = (i + 1) & t->mask) {
+        if (HT_IS_DEAD(old)
+                || t->slots[i].hash != hash
+                || ht->cmp(old, item) != 0)
+            continue;
+
+        /* Replace the existing item in place */
+        ht_store(ht, &t->slots[i].item, item);
+        ht_retire_item(ht, old);
+        return 1;
+    }
+    t->slots[i].hash = hash;
+    ht_store(ht, &t->slots[i].item, item);
+    ht->num_items++;
+    return 1;
+}
+
+void *ossl_ht_retrieve(const OSSL_HT *ht, const void *key)
+{
+    unsigned long hash = ht->hash(key);
+    HT_TABLE *t = ht_load(ht, (void **)&ht->table);
+    void *item;
+    size_t i;
+
+    for (i = ht_index(t, hash); (item = ht_load(ht, &t->slots[i].item)) != NULL;
+         i = (i + 1) & t->mask)
+        if (!HT_IS_DEAD(item)
+                && t->slots[i].hash == hash
+                && ht->cmp(item, key) == 0)
+            return item;
+    return NULL;
+}
+
+/* Take the item matching |key| out of the table, leaving a dead slot */
+static void *ht_unlink(OSSL_HT *ht, const void *key)
+{
+    unsigned long hash = ht->hash(key);
+    HT_TABLE *t = ht->table;
+    void *item;
+    size_t i;
+
+    for (i = ht_index(t, hash); (item = t->slots[i].item) != NULL;
+         i = (i + 1) & t->mask) {
+        if (HT_IS_DEAD(item)
+                || t->slots[i].hash != hash
+                || ht->cmp(item, key) != 0)
+            continue;
+
+        ht_store(ht, &t->slots[i].item, HT_DEAD);
+        ht->num_items--;
+        ht->num_dead++;
+        return item;
+    }
+    return NULL;
+}
+
+int ossl_ht_delete(OSSL_HT *ht, const void *key)
+{
+    void *item = ht_unlink(ht, key);
+
+    if (item == NULL)
+        return 0;
+    ht_retire_item(ht, item);
+    ht_maybe_compact(ht);
+    return 1;
+}
+
+void *ossl_ht_remove(OSSL_HT *ht, const void *key)
+{
+    void *item = ht_unlink(ht, key);
+
+    if (item != NULL)
+        ht_maybe_compact(ht);
+    return item;
+}
+
+size_t ossl_ht_filter(OSSL_HT *ht, int (*keep)(void *item, void *arg),
+                      void *arg)
+{
+    HT_TABLE *t = ht->table;
+    size_t i, n = 0;
+    void *item;
+
+    for (i = 0; i <= t->mask; i++) {
+        item = t->slots[i].item;
+        if (item == NULL || HT_IS_DEAD(item) || keep(item, arg))
+            continue;
+        if (HT_LOCKLESS(ht)) {
+            ht_store(ht, &t->slots[i].item, HT_MARK_DEAD(item));
+        } else {
+            t->slots[i].item = HT_DEAD;
+            ht_free_item(ht, item);
+        }
+        n++;
+    }
+    if (n == 0)
+        return 0;
+    ht->num_items -= n;
+    ht->num_dead += n;
+
+    if (HT_LOCKLESS(ht)) {
+        /* Release the marked items once nobody can be looking at them */
+        ht_synchronize(ht);
+        for (i = 0; i <= t->mask; i++) {
+            item = t->slots[i].item;
+            if (item == HT_DEAD || !HT_IS_DEAD(item))
+                continue;
+            ht_store(ht, &t->slots[i].item, HT_DEAD);
+            ht_free_item(ht, HT_UNMARK(item));
+        }
+    }
+    ht_maybe_compact(ht);
+    return n;
+}
+
+static int ht_keep_none(void *item, void *arg)
+{
+    return 0;
+}
+
+void ossl_ht_flush(OSSL_HT *ht)
+{
+    (void)ossl_ht_filter(ht, &ht_keep_none, NULL);
+}
+
+size_t ossl_ht_num_items(const OSSL_HT *ht)
+{
+    return ht->num_items;
+}
+
+void ossl_ht_doall_arg(const OSSL_HT *ht, void (*fn)(void *item, void *arg),
+                       void *arg)
+{
+    HT_TABLE *t = ht_load(ht, (void **)&ht->table);
+    void *item;
+    size_t i;
+
+    for (i = 0; i <= t->mask; i++) {
+        item = ht_load(ht, &t->slots[i].item);
+        if (item != NULL && !HT_IS_DEAD(item))
+            fn(item, arg);
+    }
+}
+
+unsigned int ossl_ht_read_lock(const OSSL_HT *ht)
+{
+    return HT_LOCKLESS(ht) ? ossl_rcu_read_lock(ht->lock) : 0;
+}
+
+void ossl_ht_read_unlock(const OSSL_HT *ht, unsigned int token)
+{
+    if (HT_LOCKLESS(ht))
+        ossl_rcu_read_unlock(ht->lock, token);
+}
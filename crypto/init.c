@@ -455,6 +455,9 @@ void OPENSSL_cleanup(void)
     OSSL_TRACE(INIT, "OPENSSL_cleanup: ossl_trace_cleanup()\n");
     ossl_trace_cleanup();
 
+    /* This must be last, everything above may free slab blocks */
+    ossl_slab_cleanup();
+
     base_inited = 0;
 }
 
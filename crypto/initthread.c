@@ -236,6 +236,8 @@ void OPENSSL_thread_stop(void)
         init_thread_remove_handlers(hands);
         OPENSSL_free(hands);
     }
+    /* After the handlers above, they may have freed slab blocks */
+    ossl_slab_thread_stop();
 }
 
 void ossl_ctx_thread_stop(OSSL_LIB_CTX *ctx)
@@ -9,6 +9,7 @@
 
 #include "internal/e_os.h"
 #include "internal/cryptlib.h"
+#include "internal/thread_once.h"
 #include "crypto/cryptlib.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,6 +23,7 @@ static int allow_customize = 1;
 static CRYPTO_malloc_fn malloc_impl = CRYPTO_malloc;
 static CRYPTO_realloc_fn realloc_impl = CRYPTO_realloc;
 static CRYPTO_free_fn free_impl = CRYPTO_free;
+static CRYPTO_ONCE malloc_impl_once = CRYPTO_ONCE_STATIC_INIT;
 
 #if !defined(OPENSSL_NO_CRYPTO_MDEBUG) && !defined(FIPS_MODULE)
 # include "internal/tsan_assist.h"
@@ -168,11 +170,31 @@ void ossl_malloc_setup_failures(void)
 }
 #endif
 
+/*
+ * The slab allocator can be switched on from the environment.  This has to
+ * be decided before the first allocation, and only once, so that no thread
+ * can see a half switched set of functions.
+ */
+DEFINE_RUN_ONCE_STATIC(malloc_impl_select)
+{
+    if (malloc_impl == CRYPTO_malloc && realloc_impl == CRYPTO_realloc
+            && free_impl == CRYPTO_free
+            && getenv("OPENSSL_MALLOC_SLAB") != NULL) {
+        allow_customize = 0;
+        malloc_impl = CRYPTO_slab_malloc;
+        realloc_impl = CRYPTO_slab_realloc;
+        free_impl = CRYPTO_slab_free;
+    }
+    return 1;
+}
+
 void *CRYPTO_malloc(size_t num, const char *file, int line)
 {
     void *ptr;
 
     INCREMENT(malloc_count);
+    if (allow_customize)
+        (void)RUN_ONCE(&malloc_impl_once, malloc_impl_select);
     if (malloc_impl != CRYPTO_malloc) {
         ptr = malloc_impl(num, file, line);
         if (ptr != NULL || num == 0)
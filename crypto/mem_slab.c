@@ -0,0 +1,519 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include "internal/nelem.h"
+#include "internal/thread_once.h"
+#include "crypto/cryptlib.h"
+
+/*
+ * A size class slab allocator with per-thread magazines.
+ *
+ * Small blocks are carved out of large slabs obtained from the system
+ * allocator, one slab per size class at a time.  Each thread caches a
+ * "magazine" of free blocks per size class, so most allocations and frees
+ * don't touch any shared state.  When a magazine runs empty or full, half
+ * a magazine's worth of blocks is exchanged with the shared depot for the
+ * size class under its lock.  Slabs are never returned to the system.
+ *
+ * Every block is preceded by a small header recording its size class, so
+ * that blocks can be freed from any thread and big blocks can be passed
+ * straight to the system allocator.
+ *
+ * Magazines are returned to the depot when their thread stops.  On
+ * OPENSSL_cleanup() all remaining magazines, the slabs of size classes with
+ * no blocks in use, the locks and the thread local key are freed.  Anything
+ * allocated after that comes from the system allocator.
+ */
+
+#define SLAB_BYTES          (64 * 1024)
+#define SLAB_MAG_SIZE       32
+#define SLAB_NUM_CLASSES    OSSL_NELEM(slab_class_size)
+#define SLAB_LARGE          SLAB_NUM_CLASSES
+#define SLAB_MAX_SIZE       1024
+
+/* Frequency of statistics updates for blocks not served from slabs */
+#define SLAB_LARGE_FLUSH    64
+
+static const size_t slab_class_size[] = {
+    16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, SLAB_MAX_SIZE
+};
+
+typedef union {
+    struct {
+        size_t size;
+        unsigned int cls;
+    } h;
+    /* Keep the block that follows suitably aligned */
+    long double align_ld;
+    void *align_p;
+    uint64_t align_u64;
+} SLAB_HDR;
+
+typedef struct slab_st {
+    struct slab_st *next;
+} SLAB;
+
+typedef struct slab_free_st {
+    struct slab_free_st *next;
+} SLAB_FREE;
+
+typedef struct {
+    CRYPTO_RWLOCK *lock;
+    SLAB_FREE *free;
+    SLAB *slabs;
+    uint64_t nslabs;
+    uint64_t allocs;
+    uint64_t frees;
+} SLAB_DEPOT;
+
+typedef struct slab_magazine_st {
+    struct slab_magazine_st *next, *prev;
+    void *rounds[OSSL_NELEM(slab_class_size)][SLAB_MAG_SIZE];
+    unsigned int count[OSSL_NELEM(slab_class_size)];
+    uint64_t allocs[OSSL_NELEM(slab_class_size) + 1];
+    uint64_t frees[OSSL_NELEM(slab_class_size) + 1];
+} SLAB_MAGAZINE;
+
+/* The magazine pointer of a thread that is busy setting up its magazine */
+#define SLAB_MAG_BUSY       ((SLAB_MAGAZINE *)-1)
+
+static CRYPTO_ONCE slab_key_once = CRYPTO_ONCE_STATIC_INIT;
+static CRYPTO_ONCE slab_depot_once = CRYPTO_ONCE_STATIC_INIT;
+static CRYPTO_THREAD_LOCAL slab_key;
+static int slab_key_inited = 0;
+static int slab_depot_inited = 0;
+static int slab_stopped = 0;
+static SLAB_DEPOT slab_depot[OSSL_NELEM(slab_class_size) + 1];
+static unsigned char slab_class_of[SLAB_MAX_SIZE / 16 + 1];
+/* All live magazines, so that they can be freed on cleanup */
+static CRYPTO_RWLOCK *slab_mags_lock;
+static SLAB_MAGAZINE *slab_mags;
+
+static void slab_thread_stop(void *arg);
+
+DEFINE_RUN_ONCE_STATIC(slab_key_init)
+{
+    if (!CRYPTO_THREAD_init_local(&slab_key, slab_thread_stop))
+        return 0;
+    slab_key_inited = 1;
+    return 1;
+}
+
+/*
+ * This runs with the calling thread's magazine marked busy, so that the
+ * allocations made to create the locks are served by the system allocator
+ * rather than recursing into here.
+ */
+DEFINE_RUN_ONCE_STATIC(slab_depot_init)
+{
+    size_t i, c;
+
+    for (i = 0, c = 0; i < OSSL_NELEM(slab_class_of); i++) {
+        while (i * 16 > slab_class_size[c])
+            c++;
+        slab_class_of[i] = (unsigned char)c;
+    }
+    if ((slab_mags_lock = CRYPTO_THREAD_lock_new()) == NULL)
+        return 0;
+    for (i = 0; i < OSSL_NELEM(slab_depot); i++)
+        if ((slab_depot[i].lock = CRYPTO_THREAD_lock_new()) == NULL)
+            return 0;
+    slab_depot_inited = 1;
+    return 1;
+}
+
+static ossl_inline unsigned int slab_class(size_t num)
+{
+    return num > SLAB_MAX_SIZE ? SLAB_LARGE : slab_class_of[(num + 15) / 16];
+}
+
+static ossl_inline void *slab_hdr_to_ptr(SLAB_HDR *hdr)
+{
+    return hdr + 1;
+}
+
+static ossl_inline SLAB_HDR *slab_ptr_to_hdr(void *ptr)
+{
+    return (SLAB_HDR *)ptr - 1;
+}
+
+/*
+ * Get the calling thread's magazine, creating it if necessary and |create|
+ * is set.  Returns NULL if there is none and one can't be created right now.
+ *
+ * Frees don't create magazines, so that memory freed by thread local
+ * destructors running after ours doesn't bring the magazine back to life.
+ */
+static SLAB_MAGAZINE *slab_get_magazine(int create)
+{
+    SLAB_MAGAZINE *mag;
+
+    if (slab_stopped || !RUN_ONCE(&slab_key_once, slab_key_init))
+        return NULL;
+    mag = CRYPTO_THREAD_get_local(&slab_key);
+    if (mag == SLAB_MAG_BUSY)
+        return NULL;
+    if (mag != NULL || !create)
+        return mag;
+
+    if (!CRYPTO_THREAD_set_local(&slab_key, SLAB_MAG_BUSY))
+        return NULL;
+    if (!RUN_ONCE(&slab_depot_once, slab_depot_init)
+            || (mag = calloc(1, sizeof(*mag))) == NULL) {
+        CRYPTO_THREAD_set_local(&slab_key, NULL);
+        return NULL;
+    }
+    if (!CRYPTO_THREAD_write_lock(slab_mags_lock)) {
+        free(mag);
+        CRYPTO_THREAD_set_local(&slab_key, NULL);
+        return NULL;
+    }
+    mag->next = slab_mags;
+    if (slab_mags != NULL)
+        slab_mags->prev = mag;
+    slab_mags = mag;
+    CRYPTO_THREAD_unlock(slab_mags_lock);
+    CRYPTO_THREAD_set_local(&slab_key, mag);
+    return mag;
+}
+
+/* Add a fresh slab of |cls| blocks to the depot.  Called with the lock held */
+static int slab_grow(SLAB_DEPOT *depot, unsigned int cls)
+{
+    size_t stride = sizeof(SLAB_HDR) + slab_class_size[cls];
+    unsigned char *p, *end;
+    SLAB *slab;
+
+    if ((slab = malloc(SLAB_BYTES)) == NULL)
+        return 0;
+    slab->next = depot->slabs;
+    depot->slabs = slab;
+    depot->nslabs++;
+
+    p = (unsigned char *)slab + sizeof(SLAB_HDR);
+    end = (unsigned char *)slab + SLAB_BYTES;
+    for (; p + stride <= end; p += stride) {
+        SLAB_HDR *hdr = (SLAB_HDR *)p;
+        SLAB_FREE *f = slab_hdr_to_ptr(hdr);
+
+        hdr->h.size = slab_class_size[cls];
+        hdr->h.cls = cls;
+        f->next = depot->free;
+        depot->free = f;
+    }
+    return 1;
+}
+
+/* Move the pending statistics for |cls| from |mag| into the depot */
+static ossl_inline void slab_flush_stats(SLAB_DEPOT *depot, SLAB_MAGAZINE *mag,
+                                         unsigned int cls)
+{
+    depot->allocs += mag->allocs[cls];
+    depot->frees += mag->frees[cls];
+    mag->allocs[cls] = mag->frees[cls] = 0;
+}
+
+/* Refill an empty magazine with half a magazine's worth of blocks */
+static int slab_refill(SLAB_MAGAZINE *mag, unsigned int cls)
+{
+    SLAB_DEPOT *depot = &slab_depot[cls];
+    unsigned int n = 0;
+
+    if (!CRYPTO_THREAD_write_lock(depot->lock))
+        return 0;
+    slab_flush_stats(depot, mag, cls);
+    while (n < SLAB_MAG_SIZE / 2) {
+        if (depot->free == NULL && !slab_grow(depot, cls))
+            break;
+        mag->rounds[cls][n++] = depot->free;
+        depot->free = depot->free->next;
+    }
+    CRYPTO_THREAD_unlock(depot->lock);
+    mag->count[cls] = n;
+    return n > 0;
+}
+
+/* Return the oldest |n| blocks in the magazine to the depot */
+static void slab_spill(SLAB_MAGAZINE *mag, unsigned int cls, unsigned int n)
+{
+    SLAB_DEPOT *depot = &slab_depot[cls];
+    unsigned int i;
+
+    if (!CRYPTO_THREAD_write_lock(depot->lock))
+        return;
+    slab_flush_stats(depot, mag, cls);
+    for (i = 0; i < n; i++) {
+        SLAB_FREE *f = mag->rounds[cls][i];
+
+        f->next = depot->free;
+        depot->free = f;
+    }
+    CRYPTO_THREAD_unlock(depot->lock);
+    memmove(mag->rounds[cls], mag->rounds[cls] + n,
+            (mag->count[cls] - n) * sizeof(mag->rounds[cls][0]));
+    mag->count[cls] -= n;
+}
+
+/*
+ * Put the single block |ptr| of |cls| straight back on the depot, waiting
+ * for the lock.  This only fails once the depot is gone after cleanup, in
+ * which case the block's slab is kept but no longer used.
+ */
+static void slab_depot_put(unsigned int cls, void *ptr)
+{
+    SLAB_DEPOT *depot = &slab_depot[cls];
+    SLAB_FREE *f = ptr;
+
+    if (slab_stopped || !CRYPTO_THREAD_write_lock(depot->lock))
+        return;
+    f->next = depot->free;
+    depot->free = f;
+    depot->frees++;
+    CRYPTO_THREAD_unlock(depot->lock);
+}
+
+/* Return all blocks and statistics of |mag| to the depot and free it */
+static void slab_magazine_free(SLAB_MAGAZINE *mag)
+{
+    unsigned int cls;
+
+    for (cls = 0; cls < SLAB_NUM_CLASSES; cls++)
+        slab_spill(mag, cls, mag->count[cls]);
+    if (CRYPTO_THREAD_write_lock(slab_depot[SLAB_LARGE].lock)) {
+        slab_flush_stats(&slab_depot[SLAB_LARGE], mag, SLAB_LARGE);
+        CRYPTO_THREAD_unlock(slab_depot[SLAB_LARGE].lock);
+    }
+    if (CRYPTO_THREAD_write_lock(slab_mags_lock)) {
+        if (mag->prev != NULL)
+            mag->prev->next = mag->next;
+        else
+            slab_mags = mag->next;
+        if (mag->next != NULL)
+            mag->next->prev = mag->prev;
+        CRYPTO_THREAD_unlock(slab_mags_lock);
+    }
+    free(mag);
+}
+
+static void slab_thread_stop(void *arg)
+{
+    SLAB_MAGAZINE *mag = arg;
+
+    if (mag == NULL || mag == SLAB_MAG_BUSY || slab_stopped)
+        return;
+    slab_magazine_free(mag);
+}
+
+/* Called by OPENSSL_thread_stop() for the calling thread */
+void ossl_slab_thread_stop(void)
+{
+    SLAB_MAGAZINE *mag;
+
+    if (!slab_key_inited || slab_stopped)
+        return;
+    mag = CRYPTO_THREAD_get_local(&slab_key);
+    if (mag == NULL || mag == SLAB_MAG_BUSY)
+        return;
+    CRYPTO_THREAD_set_local(&slab_key, NULL);
+    slab_magazine_free(mag);
+}
+
+/*
+ * Called last by OPENSSL_cleanup(), when no other thread uses the library
+ * any more.  The slabs of a size class with blocks still in use are kept,
+ * so that those blocks stay valid.
+ */
+void ossl_slab_cleanup(void)
+{
+    SLAB *slab;
+    size_t i;
+
+    if (slab_stopped)
+        return;
+    if (slab_key_inited)
+        CRYPTO_THREAD_set_local(&slab_key, NULL);
+    if (slab_depot_inited)
+        while (slab_mags != NULL)
+            slab_magazine_free(slab_mags);
+
+    /* Freeing the locks below must not come back here */
+    slab_stopped = 1;
+    if (slab_depot_inited) {
+        for (i = 0; i < OSSL_NELEM(slab_depot); i++) {
+            SLAB_DEPOT *depot = &slab_depot[i];
+
+            if (i != SLAB_LARGE && depot->allocs == depot->frees) {
+                while ((slab = depot->slabs) != NULL) {
+                    depot->slabs = slab->next;
+                    free(slab);
+                }
+                depot->free = NULL;
+                depot->nslabs = 0;
+            }
+            CRYPTO_THREAD_lock_free(depot->lock);
+            depot->lock = NULL;
+        }
+        CRYPTO_THREAD_lock_free(slab_mags_lock);
+        slab_mags_lock = NULL;
+    }
+    if (slab_key_inited)
+        CRYPTO_THREAD_cleanup_local(&slab_key);
+}
+
+static void slab_count_large(SLAB_MAGAZINE *mag, int alloc)
+{
+    SLAB_DEPOT *depot = &slab_depot[SLAB_LARGE];
+
+    if (slab_stopped)
+        return;
+    if (mag == NULL) {
+        /* Blocks allocated while setting up a magazine aren't counted */
+        if (!alloc && CRYPTO_THREAD_write_lock(depot->lock)) {
+            depot->frees++;
+            CRYPTO_THREAD_unlock(depot->lock);
+        }
+        return;
+    }
+    if (alloc)
+        mag->allocs[SLAB_LARGE]++;
+    else
+        mag->frees[SLAB_LARGE]++;
+    if (mag->allocs[SLAB_LARGE] + mag->frees[SLAB_LARGE] >= SLAB_LARGE_FLUSH
+            && CRYPTO_THREAD_write_lock(depot->lock)) {
+        slab_flush_stats(depot, mag, SLAB_LARGE);
+        CRYPTO_THREAD_unlock(depot->lock);
+    }
+}
+
+void *CRYPTO_slab_malloc(size_t num, const char *file, int line)
+{
+    SLAB_MAGAZINE *mag;
+    SLAB_HDR *hdr;
+    unsigned int cls;
+
+    if (num == 0)
+        return NULL;
+
+    mag = slab_get_magazine(1);
+    cls = mag == NULL ? SLAB_LARGE : slab_class(num);
+    if (cls != SLAB_LARGE) {
+        if (mag->count[cls] == 0 && !slab_refill(mag, cls))
+            return NULL;
+        mag->allocs[cls]++;
+        return mag->rounds[cls][--mag->count[cls]];
+    }
+
+    if (num > SIZE_MAX - sizeof(*hdr)
+            || (hdr = malloc(sizeof(*hdr) + num)) == NULL)
+        return NULL;
+    hdr->h.size = num;
+    hdr->h.cls = SLAB_LARGE;
+    slab_count_large(mag, 1);
+    return slab_hdr_to_ptr(hdr);
+}
+
+void CRYPTO_slab_free(void *ptr, const char *file, int line)
+{
+    SLAB_MAGAZINE *mag;
+    SLAB_HDR *hdr;
+    unsigned int cls;
+
+    if (ptr == NULL)
+        return;
+
+    hdr = slab_ptr_to_hdr(ptr);
+    cls = hdr->h.cls;
+    mag = slab_get_magazine(0);
+    if (cls == SLAB_LARGE) {
+        slab_count_large(mag, 0);
+        free(hdr);
+        return;
+    }
+
+    if (mag == NULL) {
+        /* No magazine to put it in, hand it straight back to the depot */
+        slab_depot_put(cls, ptr);
+        return;
+    }
+
+    if (mag->count[cls] == SLAB_MAG_SIZE) {
+        slab_spill(mag, cls, SLAB_MAG_SIZE / 2);
+        if (mag->count[cls] == SLAB_MAG_SIZE) {
+            /* The spill didn't get through, so don't keep the block either */
+            slab_depot_put(cls, ptr);
+            return;
+        }
+    }
+    mag->frees[cls]++;
+    mag->rounds[cls][mag->count[cls]++] = ptr;
+}
+
+void *CRYPTO_slab_realloc(void *ptr, size_t num, const char *file, int line)
+{
+    size_t old_size;
+    void *ret;
+
+    if (ptr == NULL)
+        return CRYPTO_slab_malloc(num, file, line);
+    if (num == 0) {
+        CRYPTO_slab_free(ptr, file, line);
+        return NULL;
+    }
+
+    old_size = slab_ptr_to_hdr(ptr)->h.size;
+    /* Stay put if the block is of the right size class already */
+    if (slab_ptr_to_hdr(ptr)->h.cls != SLAB_LARGE
+            && slab_class(num) == slab_ptr_to_hdr(ptr)->h.cls)
+        return ptr;
+
+    if ((ret = CRYPTO_slab_malloc(num, file, line)) == NULL)
+        return NULL;
+    memcpy(ret, ptr, old_size < num ? old_size : num);
+    CRYPTO_slab_free(ptr, file, line);
+    return ret;
+}
+
+int CRYPTO_slab_get_stats(unsigned int size_class, size_t *obj_size,
+                          uint64_t *allocs, uint64_t *frees, uint64_t *slabs)
+{
+    SLAB_MAGAZINE *mag;
+    SLAB_DEPOT *depot;
+
+    if (size_class > SLAB_LARGE)
+        return 0;
+    if (obj_size != NULL)
+        *obj_size = size_class == SLAB_LARGE ? 0 : slab_class_size[size_class];
+    if (allocs != NULL)
+        *allocs = 0;
+    if (frees != NULL)
+        *frees = 0;
+    if (slabs != NULL)
+        *slabs = 0;
+
+    /* This also makes sure that the depot has been set up */
+    if ((mag = slab_get_magazine(1)) == NULL)
+        return 1;
+
+    depot = &slab_depot[size_class];
+    if (!CRYPTO_THREAD_write_lock(depot->lock))
+        return 0;
+    /* Include the calling thread's own pending counts */
+    slab_flush_stats(depot, mag, size_class);
+    if (allocs != NULL)
+        *allocs = depot->allocs;
+    if (frees != NULL)
+        *frees = depot->frees;
+    if (slabs != NULL)
+        *slabs = depot->nslabs;
+    CRYPTO_THREAD_unlock(depot->lock);
+    return 1;
+}
@@ -1601,3 +1601,108 @@ void CRYPTO_gcm128_release(GCM128_CONTEXT *ctx)
 {
     OPENSSL_clear_free(ctx, sizeof(*ctx));
 }
+
+/*
+ * Z = X * Y in GF(2^128), one bit at a time.  The halves are in the same
+ * order as in ctx->H, with the most significant bit of X[0] being the
+ * coefficient of x^0.
+ */
+static void gcm_mul_1bit(u64 Z[2], const u64 X[2], const u64 Y[2])
+{
+    u64 z0 = 0, z1 = 0, v0 = Y[0], v1 = Y[1], m;
+    int i;
+
+    for (i = 0; i < 128; i++) {
+        m = 0 - ((X[i / 64] >> (63 - i % 64)) & 1);
+        z0 ^= v0 & m;
+        z1 ^= v1 & m;
+        m = 0 - (v1 & 1);
+        v1 = (v1 >> 1) | (v0 << 63);
+        v0 = (v0 >> 1) ^ (m & U64(0xe100000000000000));
+    }
+    Z[0] = z0;
+    Z[1] = z1;
+}
+
+/* X = X * H^n */
+void ossl_gcm128_mul_hpow(u64 X[2], const u64 H[2], u64 n)
+{
+    u64 P[2], T[2];
+
+    P[0] = H[0];
+    P[1] = H[1];
+    while (n != 0) {
+        if ((n & 1) != 0) {
+            gcm_mul_1bit(T, X, P);
+            X[0] = T[0];
+            X[1] = T[1];
+        }
+        n >>= 1;
+        if (n != 0) {
+            gcm_mul_1bit(T, P, P);
+            P[0] = T[0];
+            P[1] = T[1];
+        }
+    }
+}
+
+/* Fold any deferred hashing into Xi, at a block boundary */
+static void gcm_flush(GCM128_CONTEXT *ctx)
+{
+#if defined(GHASH) && !defined(OPENSSL_SMALL_FOOTPRINT)
+    if (ctx->mres != 0)
+        GHASH(ctx, ctx->Xn, ctx->mres);
+#endif
+    if (ctx->ares)
+        GCM_MUL(ctx);
+    ctx->ares = 0;
+    ctx->mres = 0;
+}
+
+/*
+ * A large message can be processed in pieces on copies of a context that is
+ * at a block boundary.  ossl_gcm128_split() turns a copy into one that
+ * processes the data |offset| bytes further on, starting from an empty hash.
+ * Once it has processed |len| bytes, a multiple of 16, ossl_gcm128_join()
+ * folds it back into |ctx|: the hash of |ctx| is multiplied by H^(len/16)
+ * and the hash of the piece is added.  Pieces must be joined in order.
+ */
+void ossl_gcm128_split(GCM128_CONTEXT *part, size_t offset)
+{
+    u32 ctr = GETU32(part->Yi.c + 12);
+
+    ctr += (u32)(offset / 16);
+    PUTU32(part->Yi.c + 12, ctr);
+    part->Xi.u[0] = 0;
+    part->Xi.u[1] = 0;
+    part->len.u[1] = 0;
+    part->ares = 0;
+    part->mres = 0;
+}
+
+int ossl_gcm128_join(GCM128_CONTEXT *ctx, GCM128_CONTEXT *part, size_t len)
+{
+    u64 mlen = ctx->len.u[1] + len, X[2];
+    u32 ctr;
+
+    if (mlen > ((U64(1) << 36) - 32) || (sizeof(len) == 8 && mlen < len))
+        return -1;
+    ctx->len.u[1] = mlen;
+
+    gcm_flush(ctx);
+    gcm_flush(part);
+
+    X[0] = (u64)GETU32(ctx->Xi.c) << 32 | GETU32(ctx->Xi.c + 4);
+    X[1] = (u64)GETU32(ctx->Xi.c + 8) << 32 | GETU32(ctx->Xi.c + 12);
+    ossl_gcm128_mul_hpow(X, ctx->H.u, len / 16);
+    PUTU32(ctx->Xi.c, (u32)(X[0] >> 32));
+    PUTU32(ctx->Xi.c + 4, (u32)X[0]);
+    PUTU32(ctx->Xi.c + 8, (u32)(X[1] >> 32));
+    PUTU32(ctx->Xi.c + 12, (u32)X[1]);
+    ctx->Xi.u[0] ^= part->Xi.u[0];
+    ctx->Xi.u[1] ^= part->Xi.u[1];
+
+    ctr = GETU32(ctx->Yi.c + 12) + (u32)(len / 16);
+    PUTU32(ctx->Yi.c + 12, ctr);
+    return 0;
+}
@@ -20,6 +20,8 @@
 #include <openssl/lhash.h>
 #include <openssl/rand.h>
 #include "internal/thread_once.h"
+#include "internal/hashtable.h"
+#include "internal/rcu.h"
 #include "crypto/lhash.h"
 #include "crypto/sparse_array.h"
 #include "property_local.h"
@@ -50,15 +52,35 @@ typedef struct {
     const OSSL_PROVIDER *provider;
     const char *query;
     METHOD method;
+    int nid;
     char body[1];
 } QUERY;
 
-DEFINE_LHASH_OF_EX(QUERY);
+DEFINE_HASHTABLE_OF(QUERY);
+
+/*
+ * The frozen table holds the implementation chosen for each algorithm for
+ * a single property query, see ossl_method_store_freeze().  It is an open
+ * addressing table keyed by nid, so that a lookup involves no strings.
+ * The table is never modified once published, it is replaced as a whole.
+ */
+typedef struct {
+    int nid;
+    METHOD method;
+} FROZEN_SLOT;
+
+typedef struct {
+    char *query;
+    size_t mask;
+    unsigned int shift;
+    FROZEN_SLOT slots[1];
+} FROZEN;
 
 typedef struct {
     int nid;
     STACK_OF(IMPLEMENTATION) *impls;
-    LHASH_OF(QUERY) *cache;
+    /* Flag: 1 if the query cache entries for this alg need flushing */
+    int cache_flush;
 } ALGORITHM;
 
 struct ossl_method_store_st {
@@ -80,16 +102,25 @@ struct ossl_method_store_st {
 
     /* query cache specific values */
 
-    /* Count of the query cache entries for all algs */
-    size_t cache_nelem;
+    /*
+     * The query cache for all algs.  It is only ever modified with |lock|
+     * held for writing but it is read without taking |lock| at all, see
+     * ossl_method_store_cache_get().
+     */
+    HASHTABLE_OF(QUERY) *cache;
 
     /* Flag: 1 if query cache entries for all algs need flushing */
     int cache_need_flush;
+
+    /*
+     * The frozen table, if any.  It is replaced with |lock| held for
+     * writing and read under |frozen_lock| only.
+     */
+    FROZEN *frozen;
+    CRYPTO_RCU_LOCK *frozen_lock;
 };
 
 typedef struct {
-    LHASH_OF(QUERY) *cache;
-    size_t nelem;
     uint32_t seed;
     unsigned char using_global_seed;
 } IMPL_CACHE_FLUSH;
@@ -103,9 +134,9 @@ typedef struct ossl_global_properties_st {
 #endif
 } OSSL_GLOBAL_PROPERTIES;
 
-static void ossl_method_cache_flush_alg(OSSL_METHOD_STORE *store,
-                                        ALGORITHM *alg);
 static void ossl_method_cache_flush(OSSL_METHOD_STORE *store, int nid);
+static ALGORITHM *ossl_method_store_retrieve(OSSL_METHOD_STORE *store, int nid);
+static void ossl_method_store_unfreeze(OSSL_METHOD_STORE *store);
 
 /* Global properties are stored per library context */
 void ossl_ctx_global_properties_free(void *vglobp)
@@ -181,20 +212,23 @@ static int ossl_property_unlock(OSSL_METHOD_STORE *p)
     return p != 0 ? CRYPTO_THREAD_unlock(p->lock) : 0;
 }
 
+/*
+ * The provider isn't part of the hash, a lookup with a NULL provider matches
+ * an entry from any provider.
+ */
 static unsigned long query_hash(const QUERY *a)
 {
-    return OPENSSL_LH_strhash(a->query);
+    return OPENSSL_LH_strhash(a->query) ^ ((unsigned long)a->nid << 5);
 }
 
 static int query_cmp(const QUERY *a, const QUERY *b)
 {
-    int res = strcmp(a->query, b->query);
-
-    if (res == 0 && a->provider != NULL && b->provider != NULL)
-        res = b->provider > a->provider ? 1
-            : b->provider < a->provider ? -1
-            : 0;
-    return res;
+    if (a->nid != b->nid)
+        return 1;
+    if (a->provider != NULL && b->provider != NULL
+            && a->provider != b->provider)
+        return 1;
+    return strcmp(a->query, b->query);
 }
 
 static void impl_free(IMPLEMENTATION *impl)
@@ -213,10 +247,16 @@ static void impl_cache_free(QUERY *elem)
     }
 }
 
-static void impl_cache_flush_alg(ossl_uintmax_t idx, ALGORITHM *alg)
+static int query_keep_other_nid(QUERY *q, void *arg)
+{
+    return q->nid != *(int *)arg;
+}
+
+static int query_keep_unflushed_alg(QUERY *q, void *arg)
 {
-    lh_QUERY_doall(alg->cache, &impl_cache_free);
-    lh_QUERY_flush(alg->cache);
+    ALGORITHM *alg = ossl_method_store_retrieve(arg, q->nid);
+
+    return alg == NULL || !alg->cache_flush;
 }
 
 static void alg_cleanup(ossl_uintmax_t idx, ALGORITHM *a, void *arg)
@@ -225,8 +265,6 @@ static void alg_cleanup(ossl_uintmax_t idx, ALGORITHM *a, void *arg)
 
     if (a != NULL) {
         sk_IMPLEMENTATION_pop_free(a->impls, &impl_free);
-        lh_QUERY_doall(a->cache, &impl_cache_free);
-        lh_QUERY_free(a->cache);
         OPENSSL_free(a);
     }
     if (store != NULL)
@@ -246,7 +284,12 @@ OSSL_METHOD_STORE *ossl_method_store_new(OSSL_LIB_CTX *ctx)
         res->ctx = ctx;
         if ((res->algs = ossl_sa_ALGORITHM_new()) == NULL
             || (res->lock = CRYPTO_THREAD_lock_new()) == NULL
-            || (res->biglock = CRYPTO_THREAD_lock_new()) == NULL) {
+            || (res->biglock = CRYPTO_THREAD_lock_new()) == NULL
+            || (res->cache = ossl_ht_QUERY_new(&query_hash, &query_cmp,
+                                               &impl_cache_free,
+                                               OSSL_HT_LOCKLESS_READS))
+               == NULL
+            || (res->frozen_lock = ossl_rcu_lock_new()) == NULL) {
             ossl_method_store_free(res);
             return NULL;
         }
@@ -260,6 +303,10 @@ void ossl_method_store_free(OSSL_METHOD_STORE *store)
         if (store->algs != NULL)
             ossl_sa_ALGORITHM_doall_arg(store->algs, &alg_cleanup, store);
         ossl_sa_ALGORITHM_free(store->algs);
+        ossl_ht_QUERY_free(store->cache);
+        if (store->frozen_lock != NULL)
+            ossl_method_store_unfreeze(store);
+        ossl_rcu_lock_free(store->frozen_lock);
         CRYPTO_THREAD_lock_free(store->lock);
         CRYPTO_THREAD_lock_free(store->biglock);
         OPENSSL_free(store);
@@ -337,8 +384,7 @@ int ossl_method_store_add(OSSL_METHOD_STORE *store, const OSSL_PROVIDER *prov,
     alg = ossl_method_store_retrieve(store, nid);
     if (alg == NULL) {
         if ((alg = OPENSSL_zalloc(sizeof(*alg))) == NULL
-                || (alg->impls = sk_IMPLEMENTATION_new_null()) == NULL
-                || (alg->cache = lh_QUERY_new(&query_hash, &query_cmp)) == NULL)
+                || (alg->impls = sk_IMPLEMENTATION_new_null()) == NULL)
             goto err;
         alg->nid = nid;
         if (!ossl_method_store_insert(store, alg))
@@ -354,8 +400,10 @@ int ossl_method_store_add(OSSL_METHOD_STORE *store, const OSSL_PROVIDER *prov,
             break;
     }
     if (i == sk_IMPLEMENTATION_num(alg->impls)
-        && sk_IMPLEMENTATION_push(alg->impls, impl))
+        && sk_IMPLEMENTATION_push(alg->impls, impl)) {
+        ossl_method_store_unfreeze(store);
         ret = 1;
+    }
     ossl_property_unlock(store);
     if (ret == 0)
         impl_free(impl);
@@ -397,6 +445,7 @@ int ossl_method_store_remove(OSSL_METHOD_STORE *store, int nid,
         if (impl->method.method == method) {
             impl_free(impl);
             (void)sk_IMPLEMENTATION_delete(alg->impls, i);
+            ossl_method_store_unfreeze(store);
             ossl_property_unlock(store);
             return 1;
         }
@@ -408,6 +457,7 @@ int ossl_method_store_remove(OSSL_METHOD_STORE *store, int nid,
 struct alg_cleanup_by_provider_data_st {
     OSSL_METHOD_STORE *store;
     const OSSL_PROVIDER *prov;
+    int flush;
 };
 
 static void
@@ -436,8 +486,15 @@ alg_cleanup_by_provider(ossl_uintmax_t idx, ALGORITHM *alg, void *arg)
      * There's no point flushing the cache entries where we didn't remove
      * any implementation, though.
      */
-    if (count > 0)
-        ossl_method_cache_flush_alg(data->store, alg);
+    if (count > 0) {
+        alg->cache_flush = 1;
+        data->flush = 1;
+    }
+}
+
+static void alg_clear_cache_flush(ossl_uintmax_t idx, ALGORITHM *alg)
+{
+    alg->cache_flush = 0;
 }
 
 int ossl_method_store_remove_all_provided(OSSL_METHOD_STORE *store,
@@ -449,7 +506,14 @@ int ossl_method_store_remove_all_provided(OSSL_METHOD_STORE *store,
         return 0;
     data.prov = prov;
     data.store = store;
+    data.flush = 0;
     ossl_sa_ALGORITHM_doall_arg(store->algs, &alg_cleanup_by_provider, &data);
+    if (data.flush) {
+        /* Flush all the affected algs in one go */
+        ossl_ht_QUERY_filter(store->cache, &query_keep_unflushed_alg, store);
+        ossl_sa_ALGORITHM_doall(store->algs, &alg_clear_cache_flush);
+        ossl_method_store_unfreeze(store);
+    }
     ossl_property_unlock(store);
     return 1;
 }
@@ -490,17 +554,78 @@ void ossl_method_store_do_all(OSSL_METHOD_STORE *store,
         ossl_sa_ALGORITHM_doall_arg(store->algs, alg_do_each, &data);
 }
 
+/*
+ * Parse |prop_query| and merge the global properties into it.  The result
+ * is returned in |*pq|, and whatever needs freeing afterwards in |*tofree|.
+ * Returns 0 on failure.
+ */
+static int store_parse_query(OSSL_METHOD_STORE *store, const char *prop_query,
+                             OSSL_PROPERTY_LIST **pq,
+                             OSSL_PROPERTY_LIST **tofree)
+{
+    OSSL_PROPERTY_LIST **plp, *p2 = NULL, *q = NULL;
+
+    if (prop_query != NULL)
+        p2 = q = ossl_parse_query(store->ctx, prop_query, 0);
+    plp = ossl_ctx_global_properties(store->ctx, 0);
+    if (plp != NULL && *plp != NULL) {
+        if (q == NULL) {
+            q = *plp;
+        } else {
+            p2 = ossl_property_merge(q, *plp);
+            ossl_property_free(q);
+            if (p2 == NULL) {
+                *tofree = NULL;
+                return 0;
+            }
+            q = p2;
+        }
+    }
+    *pq = q;
+    *tofree = p2;
+    return 1;
+}
+
+/* Select the implementation of |alg| that best matches |pq| */
+static IMPLEMENTATION *alg_select(ALGORITHM *alg, OSSL_PROPERTY_LIST *pq,
+                                  const OSSL_PROVIDER *prov)
+{
+    IMPLEMENTATION *impl, *best_impl = NULL;
+    int j, best = -1, score, optional;
+
+    if (pq == NULL) {
+        for (j = 0; j < sk_IMPLEMENTATION_num(alg->impls); j++) {
+            if ((impl = sk_IMPLEMENTATION_value(alg->impls, j)) != NULL
+                && (prov == NULL || impl->provider == prov))
+                return impl;
+        }
+        return NULL;
+    }
+    optional = ossl_property_has_optional(pq);
+    for (j = 0; j < sk_IMPLEMENTATION_num(alg->impls); j++) {
+        if ((impl = sk_IMPLEMENTATION_value(alg->impls, j)) != NULL
+            && (prov == NULL || impl->provider == prov)) {
+            score = ossl_property_match_count(pq, impl->properties);
+            if (score > best) {
+                best_impl = impl;
+                best = score;
+                if (!optional)
+                    break;
+            }
+        }
+    }
+    return best_impl;
+}
+
 int ossl_method_store_fetch(OSSL_METHOD_STORE *store,
                             int nid, const char *prop_query,
                             const OSSL_PROVIDER **prov_rw, void **method)
 {
-    OSSL_PROPERTY_LIST **plp;
     ALGORITHM *alg;
-    IMPLEMENTATION *impl, *best_impl = NULL;
+    IMPLEMENTATION *best_impl = NULL;
     OSSL_PROPERTY_LIST *pq = NULL, *p2 = NULL;
     const OSSL_PROVIDER *prov = prov_rw != NULL ? *prov_rw : NULL;
     int ret = 0;
-    int j, best = -1, score, optional;
 
     if (nid <= 0 || method == NULL || store == NULL)
         return 0;
@@ -520,86 +645,34 @@ int ossl_method_store_fetch(OSSL_METHOD_STORE *store,
         return 0;
     }
 
-    if (prop_query != NULL)
-        p2 = pq = ossl_parse_query(store->ctx, prop_query, 0);
-    plp = ossl_ctx_global_properties(store->ctx, 0);
-    if (plp != NULL && *plp != NULL) {
-        if (pq == NULL) {
-            pq = *plp;
-        } else {
-            p2 = ossl_property_merge(pq, *plp);
-            ossl_property_free(pq);
-            if (p2 == NULL)
-                goto fin;
-            pq = p2;
-        }
-    }
-
-    if (pq == NULL) {
-        for (j = 0; j < sk_IMPLEMENTATION_num(alg->impls); j++) {
-            if ((impl = sk_IMPLEMENTATION_value(alg->impls, j)) != NULL
-                && (prov == NULL || impl->provider == prov)) {
-                best_impl = impl;
-                ret = 1;
-                break;
-            }
-        }
-        goto fin;
-    }
-    optional = ossl_property_has_optional(pq);
-    for (j = 0; j < sk_IMPLEMENTATION_num(alg->impls); j++) {
-        if ((impl = sk_IMPLEMENTATION_value(alg->impls, j)) != NULL
-            && (prov == NULL || impl->provider == prov)) {
-            score = ossl_property_match_count(pq, impl->properties);
-            if (score > best) {
-                best_impl = impl;
-                best = score;
-                ret = 1;
-                if (!optional)
-                    goto fin;
-            }
-        }
-    }
-fin:
-    if (ret && ossl_method_up_ref(&best_impl->method)) {
+    if (store_parse_query(store, prop_query, &pq, &p2)
+            && (best_impl = alg_select(alg, pq, prov)) != NULL
+            && ossl_method_up_ref(&best_impl->method)) {
         *method = best_impl->method.method;
         if (prov_rw != NULL)
             *prov_rw = best_impl->provider;
-    } else {
-        ret = 0;
+        ret = 1;
     }
     ossl_property_unlock(store);
     ossl_property_free(p2);
     return ret;
 }
 
-static void ossl_method_cache_flush_alg(OSSL_METHOD_STORE *store,
-                                        ALGORITHM *alg)
-{
-    store->cache_nelem -= lh_QUERY_num_items(alg->cache);
-    impl_cache_flush_alg(0, alg);
-}
-
 static void ossl_method_cache_flush(OSSL_METHOD_STORE *store, int nid)
 {
-    ALGORITHM *alg = ossl_method_store_retrieve(store, nid);
-
-    if (alg != NULL)
-        ossl_method_cache_flush_alg(store, alg);
+    ossl_ht_QUERY_filter(store->cache, &query_keep_other_nid, &nid);
 }
 
 int ossl_method_store_cache_flush_all(OSSL_METHOD_STORE *store)
 {
     if (!ossl_property_write_lock(store))
         return 0;
-    ossl_sa_ALGORITHM_doall(store->algs, &impl_cache_flush_alg);
-    store->cache_nelem = 0;
+    ossl_ht_QUERY_flush(store->cache);
+    ossl_method_store_unfreeze(store);
     ossl_property_unlock(store);
     return 1;
 }
 
-IMPLEMENT_LHASH_DOALL_ARG(QUERY, IMPL_CACHE_FLUSH);
-
 /*
  * Flush an element from the query cache (perhaps).
  *
@@ -616,8 +689,9 @@ IMPLEMENT_LHASH_DOALL_ARG(QUERY, IMPL_CACHE_FLUSH);
  * preferable to a more refined approach that imposes a performance
  * impact.
  */
-static void impl_cache_flush_cache(QUERY *c, IMPL_CACHE_FLUSH *state)
+static int impl_cache_flush_cache(QUERY *c, void *v)
 {
+    IMPL_CACHE_FLUSH *state = v;
     uint32_t n;
 
     /*
@@ -633,20 +707,7 @@ static void impl_cache_flush_cache(QUERY *c, IMPL_CACHE_FLUSH *state)
     n ^= n << 5;
     state->seed = n;
 
-    if ((n & 1) != 0)
-        impl_cache_free(lh_QUERY_delete(state->cache, c));
-    else
-        state->nelem++;
-}
-
-static void impl_cache_flush_one_alg(ossl_uintmax_t idx, ALGORITHM *alg,
-                                     void *v)
-{
-    IMPL_CACHE_FLUSH *state = (IMPL_CACHE_FLUSH *)v;
-
-    state->cache = alg->cache;
-    lh_QUERY_doall_IMPL_CACHE_FLUSH(state->cache, &impl_cache_flush_cache,
-                                    state);
+    return (n & 1) == 0;
 }
 
 static void ossl_method_cache_flush_some(OSSL_METHOD_STORE *store)
@@ -654,7 +715,6 @@ static void ossl_method_cache_flush_some(OSSL_METHOD_STORE *store)
     IMPL_CACHE_FLUSH state;
     static TSAN_QUALIFIER uint32_t global_seed = 1;
 
-    state.nelem = 0;
     state.using_global_seed = 0;
     if ((state.seed = OPENSSL_rdtsc()) == 0) {
         /* If there is no timer available, seed another way */
@@ -662,40 +722,172 @@ static void ossl_method_cache_flush_some(OSSL_METHOD_STORE *store)
         state.seed = tsan_load(&global_seed);
     }
     store->cache_need_flush = 0;
-    ossl_sa_ALGORITHM_doall_arg(store->algs, &impl_cache_flush_one_alg, &state);
-    store->cache_nelem = state.nelem;
+    ossl_ht_QUERY_filter(store->cache, &impl_cache_flush_cache, &state);
     /* Without a timer, update the global seed */
     if (state.using_global_seed)
         tsan_add(&global_seed, state.seed);
 }
 
+/*-
+ * The frozen table
+ * ================
+ */
+
+/* See ht_index() in crypto/hashtable/hashtable.c */
+static ossl_inline size_t frozen_index(const FROZEN *f, int nid)
+{
+    return (size_t)(((uint64_t)(unsigned int)nid * 0x9E3779B97F4A7C15ULL)
+                    >> f->shift);
+}
+
+static void frozen_free(FROZEN *f)
+{
+    size_t i;
+
+    if (f == NULL)
+        return;
+    for (i = 0; i <= f->mask; i++)
+        if (f->slots[i].nid != 0)
+            ossl_method_free(&f->slots[i].method);
+    OPENSSL_free(f->query);
+    OPENSSL_free(f);
+}
+
+/* Drop the frozen table.  The store must be locked for writing. */
+static void ossl_method_store_unfreeze(OSSL_METHOD_STORE *store)
+{
+    FROZEN *old = store->frozen, *none = NULL;
+
+    if (old == NULL)
+        return;
+    ossl_rcu_assign_ptr(&store->frozen, &none);
+    ossl_synchronize_rcu(store->frozen_lock);
+    frozen_free(old);
+}
+
+struct frozen_fill_data_st {
+    FROZEN *f;
+    OSSL_PROPERTY_LIST *pq;
+};
+
+static void frozen_fill(ossl_uintmax_t idx, ALGORITHM *alg, void *arg)
+{
+    struct frozen_fill_data_st *data = arg;
+    FROZEN *f = data->f;
+    IMPLEMENTATION *impl;
+    size_t i;
+
+    if ((impl = alg_select(alg, data->pq, NULL)) == NULL
+            || !ossl_method_up_ref(&impl->method))
+        return;
+    for (i = frozen_index(f, alg->nid); f->slots[i].nid != 0;
+         i = (i + 1) & f->mask)
+        continue;
+    f->slots[i].nid = alg->nid;
+    f->slots[i].method = impl->method;
+}
+
+/*
+ * Resolve every algorithm in the store for |prop_query| once and for all.
+ * Until the store changes, ossl_method_store_cache_get() answers queries
+ * for exactly |prop_query| from the result without any string handling.
+ */
+int ossl_method_store_freeze(OSSL_METHOD_STORE *store, const char *prop_query)
+{
+    struct frozen_fill_data_st data;
+    OSSL_PROPERTY_LIST *p2 = NULL;
+    FROZEN *f = NULL;
+    size_t n, size = 16;
+    unsigned int bits = 4;
+    int ret = 0;
+
+    if (store == NULL)
+        return 0;
+    if (prop_query == NULL)
+        prop_query = "";
+
+    if (!ossl_property_write_lock(store))
+        return 0;
+    if (!store_parse_query(store, prop_query, &data.pq, &p2))
+        goto err;
+
+    /* Keep the load factor at or below one half */
+    for (n = ossl_sa_ALGORITHM_num(store->algs); size < 2 * n; size <<= 1)
+        bits++;
+    f = OPENSSL_zalloc(sizeof(*f) + (size - 1) * sizeof(f->slots[0]));
+    if (f == NULL || (f->query = OPENSSL_strdup(prop_query)) == NULL)
+        goto err;
+    f->mask = size - 1;
+    f->shift = 64 - bits;
+    data.f = f;
+    ossl_sa_ALGORITHM_doall_arg(store->algs, &frozen_fill, &data);
+
+    ossl_method_store_unfreeze(store);
+    ossl_rcu_assign_ptr(&store->frozen, &f);
+    f = NULL;
+    ret = 1;
+ err:
+    ossl_property_unlock(store);
+    ossl_property_free(p2);
+    frozen_free(f);
+    return ret;
+}
+
+static int frozen_get(OSSL_METHOD_STORE *store, int nid,
+                      const char *prop_query, void **method)
+{
+    FROZEN *f;
+    size_t i;
+    unsigned int token;
+    int res = 0;
+
+    token = ossl_rcu_read_lock(store->frozen_lock);
+    f = ossl_rcu_deref(&store->frozen);
+    if (f != NULL && strcmp(f->query, prop_query) == 0) {
+        for (i = frozen_index(f, nid); f->slots[i].nid != 0;
+             i = (i + 1) & f->mask) {
+            if (f->slots[i].nid == nid) {
+                if (ossl_method_up_ref(&f->slots[i].method)) {
+                    *method = f->slots[i].method.method;
+                    res = 1;
+                }
+                break;
+            }
+        }
+    }
+    ossl_rcu_read_unlock(store->frozen_lock, token);
+    return res;
+}
+
+/*
+ * This is the hot path of every fetch.  It doesn't take the store's lock,
+ * the frozen table and the query cache support lookups concurrent with
+ * modifications, so concurrent callers never contend with each other.
+ */
 int ossl_method_store_cache_get(OSSL_METHOD_STORE *store, OSSL_PROVIDER *prov,
                                 int nid, const char *prop_query, void **method)
 {
-    ALGORITHM *alg;
     QUERY elem, *r;
+    unsigned int token;
     int res = 0;
 
     if (nid <= 0 || store == NULL || prop_query == NULL)
         return 0;
 
-    if (!ossl_property_read_lock(store))
-        return 0;
-    alg = ossl_method_store_retrieve(store, nid);
-    if (alg == NULL)
-        goto err;
+    if (prov == NULL && ossl_rcu_deref(&store->frozen) != NULL
+            && frozen_get(store, nid, prop_query, method))
+        return 1;
 
     elem.query = prop_query;
     elem.provider = prov;
-    r = lh_QUERY_retrieve(alg->cache, &elem);
-    if (r == NULL)
-        goto err;
-    if (ossl_method_up_ref(&r->method)) {
+    elem.nid = nid;
+    token = ossl_ht_QUERY_read_lock(store->cache);
+    r = ossl_ht_QUERY_retrieve(store->cache, &elem);
+    if (r != NULL && ossl_method_up_ref(&r->method)) {
         *method = r->method.method;
         res = 1;
     }
-err:
-    ossl_property_unlock(store);
+    ossl_ht_QUERY_read_unlock(store->cache, token);
     return res;
 }
 
@@ -704,7 +896,7 @@ int ossl_method_store_cache_set(OSSL_METHOD_STORE *store, OSSL_PROVIDER *prov,
                                 int (*method_up_ref)(void *),
                                 void (*method_destruct)(void *))
 {
-    QUERY elem, *old, *p = NULL;
+    QUERY elem, *p = NULL;
     ALGORITHM *alg;
     size_t len;
     int res = 1;
@@ -723,31 +915,26 @@ int ossl_method_store_cache_set(OSSL_METHOD_STORE *store, OSSL_PROVIDER *prov,
     if (alg == NULL)
         goto err;
 
+    elem.query = prop_query;
+    elem.provider = prov;
+    elem.nid = nid;
     if (method == NULL) {
-        elem.query = prop_query;
-        elem.provider = prov;
-        if ((old = lh_QUERY_delete(alg->cache, &elem)) != NULL) {
-            impl_cache_free(old);
-            store->cache_nelem--;
-        }
+        ossl_ht_QUERY_delete(store->cache, &elem);
         goto end;
     }
     p = OPENSSL_malloc(sizeof(*p) + (len = strlen(prop_query)));
     if (p != NULL) {
         p->query = p->body;
         p->provider = prov;
+        p->nid = nid;
         p->method.method = method;
         p->method.up_ref = method_up_ref;
         p->method.free = method_destruct;
         if (!ossl_method_up_ref(&p->method))
             goto err;
         memcpy((char *)p->query, prop_query, len + 1);
-        if ((old = lh_QUERY_insert(alg->cache, p)) != NULL) {
-            impl_cache_free(old);
-            goto end;
-        }
-        if (!lh_QUERY_error(alg->cache)) {
-            if (++store->cache_nelem >= IMPL_CACHE_FLUSH_THRESHOLD)
+        if (ossl_ht_QUERY_insert(store->cache, p)) {
+            if (ossl_ht_QUERY_num(store->cache) >= IMPL_CACHE_FLUSH_THRESHOLD)
                 store->cache_need_flush = 1;
             goto end;
         }
@@ -1,5 +1,5 @@
 /*
- * Copyright 1995-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 1995-2023 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -275,134 +275,183 @@ static int rsa_blinding_invert(BN_BLINDING *b, BIGNUM *f, BIGNUM *unblind,
     return BN_BLINDING_invert_ex(f, unblind, b, ctx);
 }
 
-/* signing */
-static int rsa_ossl_private_encrypt(int flen, const unsigned char *from,
-                                   unsigned char *to, RSA *rsa, int padding)
-{
-    BIGNUM *f, *ret, *res;
-    int i, num = 0, r = -1;
-    unsigned char *buf = NULL;
-    BN_CTX *ctx = NULL;
-    int local_blinding = 0;
+/*
+ * The state of a private key operation between the blinding of its input
+ * and the unblinding of its result, so that the exponentiations of several
+ * operations can be done together by ossl_rsa_private_encrypt_batch().
+ */
+typedef struct {
+    RSA *rsa;
+    BN_CTX *ctx;
+    BIGNUM *f, *ret;
+    unsigned char *buf;
+    int num;
+    int padding;
     /*
-     * Used only if the blinding structure is shared. A non-NULL unblind
+     * Used only if the blinding structure is shared, or if several
+     * operations with the same key are in flight. A non-NULL unblind
      * instructs rsa_blinding_convert() and rsa_blinding_invert() to store
      * the unblinding factor outside the blinding structure.
      */
-    BIGNUM *unblind = NULL;
-    BN_BLINDING *blinding = NULL;
+    BIGNUM *unblind;
+    BN_BLINDING *blinding;
+} RSA_PRIV_OP;
 
-    if ((ctx = BN_CTX_new_ex(rsa->libctx)) == NULL)
-        goto err;
-    BN_CTX_start(ctx);
-    f = BN_CTX_get(ctx);
-    ret = BN_CTX_get(ctx);
-    num = BN_num_bytes(rsa->n);
-    buf = OPENSSL_malloc(num);
-    if (ret == NULL || buf == NULL)
-        goto err;
+/*
+ * Pad |from| into |op->f| and blind it.  |op| must be released with
+ * rsa_priv_op_cleanup() whatever the outcome.
+ */
+static int rsa_priv_op_begin(RSA_PRIV_OP *op, int flen,
+                             const unsigned char *from, RSA *rsa, int padding,
+                             int shared_unblind)
+{
+    int i, local_blinding = 0;
+
+    memset(op, 0, sizeof(*op));
+    op->rsa = rsa;
+    op->padding = padding;
+    if ((op->ctx = BN_CTX_new_ex(rsa->libctx)) == NULL)
+        return 0;
+    BN_CTX_start(op->ctx);
+    op->f = BN_CTX_get(op->ctx);
+    op->ret = BN_CTX_get(op->ctx);
+    op->num = BN_num_bytes(rsa->n);
+    op->buf = OPENSSL_malloc(op->num);
+    if (op->ret == NULL || op->buf == NULL)
+        return 0;
 
     switch (padding) {
     case RSA_PKCS1_PADDING:
-        i = RSA_padding_add_PKCS1_type_1(buf, num, from, flen);
+        i = RSA_padding_add_PKCS1_type_1(op->buf, op->num, from, flen);
         break;
     case RSA_X931_PADDING:
-        i = RSA_padding_add_X931(buf, num, from, flen);
+        i = RSA_padding_add_X931(op->buf, op->num, from, flen);
         break;
     case RSA_NO_PADDING:
-        i = RSA_padding_add_none(buf, num, from, flen);
+        i = RSA_padding_add_none(op->buf, op->num, from, flen);
         break;
     default:
         ERR_raise(ERR_LIB_RSA, RSA_R_UNKNOWN_PADDING_TYPE);
-        goto err;
+        return 0;
     }
     if (i <= 0)
-        goto err;
+        return 0;
 
-    if (BN_bin2bn(buf, num, f) == NULL)
-        goto err;
+    if (BN_bin2bn(op->buf, op->num, op->f) == NULL)
+        return 0;
 
-    if (BN_ucmp(f, rsa->n) >= 0) {
+    if (BN_ucmp(op->f, rsa->n) >= 0) {
         /* usually the padding functions would catch this */
         ERR_raise(ERR_LIB_RSA, RSA_R_DATA_TOO_LARGE_FOR_MODULUS);
-        goto err;
+        return 0;
     }
 
     if (rsa->flags & RSA_FLAG_CACHE_PUBLIC)
         if (!BN_MONT_CTX_set_locked(&rsa->_method_mod_n, rsa->lock,
-                                    rsa->n, ctx))
-            goto err;
+                                    rsa->n, op->ctx))
+            return 0;
 
     if (!(rsa->flags & RSA_FLAG_NO_BLINDING)) {
-        blinding = rsa_get_blinding(rsa, &local_blinding, ctx);
-        if (blinding == NULL) {
+        op->blinding = rsa_get_blinding(rsa, &local_blinding, op->ctx);
+        if (op->blinding == NULL) {
             ERR_raise(ERR_LIB_RSA, ERR_R_INTERNAL_ERROR);
-            goto err;
+            return 0;
         }
     }
 
-    if (blinding != NULL) {
-        if (!local_blinding && ((unblind = BN_CTX_get(ctx)) == NULL)) {
+    if (op->blinding != NULL) {
+        if ((!local_blinding || shared_unblind)
+                && ((op->unblind = BN_CTX_get(op->ctx)) == NULL)) {
             ERR_raise(ERR_LIB_RSA, ERR_R_BN_LIB);
-            goto err;
+            return 0;
         }
-        if (!rsa_blinding_convert(blinding, f, unblind, ctx))
-            goto err;
+        if (!rsa_blinding_convert(op->blinding, op->f, op->unblind, op->ctx))
+            return 0;
     }
+    return 1;
+}
+
+/* The exponentiation of a private key operation on its own */
+static int rsa_priv_op_exp(RSA_PRIV_OP *op)
+{
+    RSA *rsa = op->rsa;
 
     if ((rsa->flags & RSA_FLAG_EXT_PKEY) ||
         (rsa->version == RSA_ASN1_VERSION_MULTI) ||
         ((rsa->p != NULL) &&
          (rsa->q != NULL) &&
          (rsa->dmp1 != NULL) && (rsa->dmq1 != NULL) && (rsa->iqmp != NULL))) {
-        if (!rsa->meth->rsa_mod_exp(ret, f, rsa, ctx))
-            goto err;
+        if (!rsa->meth->rsa_mod_exp(op->ret, op->f, rsa, op->ctx))
+            return 0;
     } else {
         BIGNUM *d = BN_new();
         if (d == NULL) {
             ERR_raise(ERR_LIB_RSA, ERR_R_BN_LIB);
-            goto err;
+            return 0;
         }
         if (rsa->d == NULL) {
             ERR_raise(ERR_LIB_RSA, RSA_R_MISSING_PRIVATE_KEY);
             BN_free(d);
-            goto err;
+            return 0;
         }
         BN_with_flags(d, rsa->d, BN_FLG_CONSTTIME);
 
-        if (!rsa->meth->bn_mod_exp(ret, f, d, rsa->n, ctx,
+        if (!rsa->meth->bn_mod_exp(op->ret, op->f, d, rsa->n, op->ctx,
                                    rsa->_method_mod_n)) {
             BN_free(d);
-            goto err;
+            return 0;
         }
         /* We MUST free d before any further use of rsa->d */
         BN_free(d);
     }
+    return 1;
+}
 
-    if (blinding)
-        if (!rsa_blinding_invert(blinding, ret, unblind, ctx))
-            goto err;
+/* Unblind the result and write it to |to|, returning its length or -1 */
+static int rsa_priv_op_end(RSA_PRIV_OP *op, unsigned char *to)
+{
+    BIGNUM *res;
 
-    if (padding == RSA_X931_PADDING) {
-        if (!BN_sub(f, rsa->n, ret))
-            goto err;
-        if (BN_cmp(ret, f) > 0)
-            res = f;
+    if (op->blinding)
+        if (!rsa_blinding_invert(op->blinding, op->ret, op->unblind, op->ctx))
+            return -1;
+
+    if (op->padding == RSA_X931_PADDING) {
+        if (!BN_sub(op->f, op->rsa->n, op->ret))
+            return -1;
+        if (BN_cmp(op->ret, op->f) > 0)
+            res = op->f;
         else
-            res = ret;
+            res = op->ret;
     } else {
-        res = ret;
+        res = op->ret;
     }
 
     /*
      * BN_bn2binpad puts in leading 0 bytes if the number is less than
      * the length of the modulus.
      */
-    r = BN_bn2binpad(res, to, num);
- err:
-    BN_CTX_end(ctx);
-    BN_CTX_free(ctx);
-    OPENSSL_clear_free(buf, num);
+    return BN_bn2binpad(res, to, op->num);
+}
+
+static void rsa_priv_op_cleanup(RSA_PRIV_OP *op)
+{
+    BN_CTX_end(op->ctx);
+    BN_CTX_free(op->ctx);
+    OPENSSL_clear_free(op->buf, op->num);
+}
+
+/* signing */
+static int rsa_ossl_private_encrypt(int flen, const unsigned char *from,
+                                   unsigned char *to, RSA *rsa, int padding)
+{
+    RSA_PRIV_OP op;
+    int r = -1;
+
+    if (rsa_priv_op_begin(&op, flen, from, rsa, padding, 0)
+            && rsa_priv_op_exp(&op))
+        r = rsa_priv_op_end(&op, to);
+    rsa_priv_op_cleanup(&op);
     return r;
 }
 
@@ -752,9 +801,164 @@ static int rsa_ossl_public_decrypt(int flen, const unsigned char *from,
     return r;
 }
 
+/* Set up the Montgomery contexts of the prime factors p and q */
+static int rsa_ossl_set_crt_mont(RSA *rsa, BN_CTX *ctx)
+{
+    BIGNUM *factor = BN_new();
+    int ret;
+
+    if (factor == NULL)
+        return 0;
+
+    /*
+     * Make sure BN_mod_inverse in Montgomery initialization uses the
+     * BN_FLG_CONSTTIME flag
+     */
+    ret = (BN_with_flags(factor, rsa->p, BN_FLG_CONSTTIME),
+           BN_MONT_CTX_set_locked(&rsa->_method_mod_p, rsa->lock,
+                                  factor, ctx))
+          && (BN_with_flags(factor, rsa->q, BN_FLG_CONSTTIME),
+              BN_MONT_CTX_set_locked(&rsa->_method_mod_q, rsa->lock,
+                                     factor, ctx));
+
+    /*
+     * We MUST free |factor| before any further use of the prime factors
+     */
+    BN_free(factor);
+    return ret;
+}
+
+/*
+ * The CRT steps before the exponentiations when p and q have the same
+ * size: m1 = I mod q and r1 = I mod p, both in Montgomery form.
+ */
+static int rsa_ossl_crt_reduce(BIGNUM *m1, BIGNUM *r1, const BIGNUM *I,
+                               RSA *rsa, BN_CTX *ctx)
+{
+    /*
+     * Conversion from Montgomery domain, a.k.a. Montgomery reduction,
+     * accepts values in [0-m*2^w) range. w is m's bit width rounded up
+     * to limb width. So that at the very least if |I| is fully reduced,
+     * i.e. less than p*q, we can count on from-to round to perform
+     * below modulo operations on |I|. Unlike BN_mod it's constant time.
+     */
+    return /* m1 = I moq q */
+           bn_from_mont_fixed_top(m1, I, rsa->_method_mod_q, ctx)
+           && bn_to_mont_fixed_top(m1, m1, rsa->_method_mod_q, ctx)
+           /* r1 = I mod p */
+           && bn_from_mont_fixed_top(r1, I, rsa->_method_mod_p, ctx)
+           && bn_to_mont_fixed_top(r1, r1, rsa->_method_mod_p, ctx);
+}
+
+/*
+ * The CRT steps after the exponentiations m1 = m1^dmq1 mod q and
+ * r1 = r1^dmp1 mod p, which leave the result in |r0|.
+ */
+static int rsa_ossl_crt_combine(BIGNUM *r0, BIGNUM *r1, const BIGNUM *m1,
+                                RSA *rsa, BN_CTX *ctx)
+{
+    return /* r1 = (r1 - m1) mod p */
+           /*
+            * bn_mod_sub_fixed_top is not regular modular subtraction,
+            * it can tolerate subtrahend to be larger than modulus, but
+            * not bit-wise wider. This makes up for uncommon q>p case,
+            * when |m1| can be larger than |rsa->p|.
+            */
+           bn_mod_sub_fixed_top(r1, r1, m1, rsa->p)
+
+           /* r1 = r1 * iqmp mod p */
+           && bn_to_mont_fixed_top(r1, r1, rsa->_method_mod_p, ctx)
+           && bn_mul_mont_fixed_top(r1, r1, rsa->iqmp, rsa->_method_mod_p,
+                                    ctx)
+           /* r0 = r1 * q + m1 */
+           && bn_mul_fixed_top(r0, r1, rsa->q, ctx)
+           && bn_mod_add_fixed_top(r0, r0, m1, rsa->n);
+}
+
+/*
+ * Check the CRT result |r0| against the input |I| with the public exponent
+ * and replace it with the result of a plain exponentiation if they don't
+ * match.
+ */
+static int rsa_ossl_crt_check(BIGNUM *r0, const BIGNUM *I, RSA *rsa,
+                              BN_CTX *ctx)
+{
+    BIGNUM *vrfy;
+    int ret = 0;
+
+    BN_CTX_start(ctx);
+    vrfy = BN_CTX_get(ctx);
+    if (vrfy == NULL)
+        goto err;
+
+    if (rsa->e && rsa->n) {
+        if (rsa->meth->bn_mod_exp == BN_mod_exp_mont) {
+            if (!BN_mod_exp_mont(vrfy, r0, rsa->e, rsa->n, ctx,
+                                 rsa->_method_mod_n))
+                goto err;
+        } else {
+            bn_correct_top(r0);
+            if (!rsa->meth->bn_mod_exp(vrfy, r0, rsa->e, rsa->n, ctx,
+                                       rsa->_method_mod_n))
+                goto err;
+        }
+        /*
+         * If 'I' was greater than (or equal to) rsa->n, the operation will
+         * be equivalent to using 'I mod n'. However, the result of the
+         * verify will *always* be less than 'n' so we don't check for
+         * absolute equality, just congruency.
+         */
+        if (!BN_sub(vrfy, vrfy, I))
+            goto err;
+        if (BN_is_zero(vrfy)) {
+            bn_correct_top(r0);
+            ret = 1;
+            goto err;   /* not actually error */
+        }
+        if (!BN_mod(vrfy, vrfy, rsa->n, ctx))
+            goto err;
+        if (BN_is_negative(vrfy))
+            if (!BN_add(vrfy, vrfy, rsa->n))
+                goto err;
+        if (!BN_is_zero(vrfy)) {
+            /*
+             * 'I' and 'vrfy' aren't congruent mod n. Don't leak
+             * miscalculated CRT output, just do a raw (slower) mod_exp and
+             * return that instead.
+             */
+
+            BIGNUM *d = BN_new();
+            if (d == NULL)
+                goto err;
+            BN_with_flags(d, rsa->d, BN_FLG_CONSTTIME);
+
+            if (!rsa->meth->bn_mod_exp(r0, I, d, rsa->n, ctx,
+                                       rsa->_method_mod_n)) {
+                BN_free(d);
+                goto err;
+            }
+            /* We MUST free d before any further use of rsa->d */
+            BN_free(d);
+        }
+    }
+    /*
+     * It's unfortunate that we have to bn_correct_top(r0). What hopefully
+     * saves the day is that correction is highly unlike, and private key
+     * operations are customarily performed on blinded message. Which means
+     * that attacker won't observe correlation with chosen plaintext.
+     * Secondly, remaining code would still handle it in same computational
+     * time and even conceal memory access pattern around corrected top.
+     */
+    bn_correct_top(r0);
+    ret = 1;
+ err:
+    BN_CTX_end(ctx);
+    return ret;
+}
+
 static int rsa_ossl_mod_exp(BIGNUM *r0, const BIGNUM *I, RSA *rsa, BN_CTX *ctx)
 {
-    BIGNUM *r1, *m1, *vrfy;
+    BIGNUM *r1, *m1;
     int ret = 0, smooth = 0;
 #ifndef FIPS_MODULE
     BIGNUM *r2, *m[RSA_MAX_PRIME_NUM - 2];
@@ -769,8 +973,7 @@ static int rsa_ossl_mod_exp(BIGNUM *r0, const BIGNUM *I, RSA *rsa, BN_CTX *ctx)
     r2 = BN_CTX_get(ctx);
 #endif
     m1 = BN_CTX_get(ctx);
-    vrfy = BN_CTX_get(ctx);
-    if (vrfy == NULL)
+    if (m1 == NULL)
         goto err;
 
 #ifndef FIPS_MODULE
@@ -781,38 +984,30 @@ static int rsa_ossl_mod_exp(BIGNUM *r0, const BIGNUM *I, RSA *rsa, BN_CTX *ctx)
 #endif
 
     if (rsa->flags & RSA_FLAG_CACHE_PRIVATE) {
-        BIGNUM *factor = BN_new();
-
-        if (factor == NULL)
-            goto err;
-
-        /*
-         * Make sure BN_mod_inverse in Montgomery initialization uses the
-         * BN_FLG_CONSTTIME flag
-         */
-        if (!(BN_with_flags(factor, rsa->p, BN_FLG_CONSTTIME),
-              BN_MONT_CTX_set_locked(&rsa->_method_mod_p, rsa->lock,
-                                     factor, ctx))
-            || !(BN_with_flags(factor, rsa->q, BN_FLG_CONSTTIME),
-                 BN_MONT_CTX_set_locked(&rsa->_method_mod_q, rsa->lock,
-                                        factor, ctx))) {
-            BN_free(factor);
+        if (!rsa_ossl_set_crt_mont(rsa, ctx))
             goto err;
-        }
 #ifndef FIPS_MODULE
-        for (i = 0; i < ex_primes; i++) {
-            pinfo = sk_RSA_PRIME_INFO_value(rsa->prime_infos, i);
-            BN_with_flags(factor, pinfo->r, BN_FLG_CONSTTIME);
-            if (!BN_MONT_CTX_set_locked(&pinfo->m, rsa->lock, factor, ctx)) {
-                BN_free(factor);
+        if (ex_primes > 0) {
+            BIGNUM *factor = BN_new();
+
+            if (factor == NULL)
                 goto err;
+            for (i = 0; i < ex_primes; i++) {
+                pinfo = sk_RSA_PRIME_INFO_value(rsa->prime_infos, i);
+                BN_with_flags(factor, pinfo->r, BN_FLG_CONSTTIME);
+                if (!BN_MONT_CTX_set_locked(&pinfo->m, rsa->lock, factor,
+                                            ctx)) {
+                    BN_free(factor);
+                    goto err;
+                }
             }
+            /*
+             * We MUST free |factor| before any further use of the prime
+             * factors
+             */
+            BN_free(factor);
         }
 #endif
-        /*
-         * We MUST free |factor| before any further use of the prime factors
-         */
-        BN_free(factor);
 
         smooth = (rsa->meth->bn_mod_exp == BN_mod_exp_mont)
 #ifndef FIPS_MODULE
@@ -827,19 +1022,7 @@ static int rsa_ossl_mod_exp(BIGNUM *r0, const BIGNUM *I, RSA *rsa, BN_CTX *ctx)
             goto err;
 
     if (smooth) {
-        /*
-         * Conversion from Montgomery domain, a.k.a. Montgomery reduction,
-         * accepts values in [0-m*2^w) range. w is m's bit width rounded up
-         * to limb width. So that at the very least if |I| is fully reduced,
-         * i.e. less than p*q, we can count on from-to round to perform
-         * below modulo operations on |I|. Unlike BN_mod it's constant time.
-         */
-        if (/* m1 = I moq q */
-            !bn_from_mont_fixed_top(m1, I, rsa->_method_mod_q, ctx)
-            || !bn_to_mont_fixed_top(m1, m1, rsa->_method_mod_q, ctx)
-            /* r1 = I mod p */
-            || !bn_from_mont_fixed_top(r1, I, rsa->_method_mod_p, ctx)
-            || !bn_to_mont_fixed_top(r1, r1, rsa->_method_mod_p, ctx)
+        if (!rsa_ossl_crt_reduce(m1, r1, I, rsa, ctx)
             /*
              * Use parallel exponentiations optimization if possible,
              * otherwise fallback to two sequential exponentiations:
@@ -851,22 +1034,7 @@ static int rsa_ossl_mod_exp(BIGNUM *r0, const BIGNUM *I, RSA *rsa, BN_CTX *ctx)
                                              r1, r1, rsa->dmp1, rsa->p,
                                              rsa->_method_mod_p,
                                              ctx)
-            /* r1 = (r1 - m1) mod p */
-            /*
-             * bn_mod_sub_fixed_top is not regular modular subtraction,
-             * it can tolerate subtrahend to be larger than modulus, but
-             * not bit-wise wider. This makes up for uncommon q>p case,
-             * when |m1| can be larger than |rsa->p|.
-             */
-            || !bn_mod_sub_fixed_top(r1, r1, m1, rsa->p)
-
-            /* r1 = r1 * iqmp mod p */
-            || !bn_to_mont_fixed_top(r1, r1, rsa->_method_mod_p, ctx)
-            || !bn_mul_mont_fixed_top(r1, r1, rsa->iqmp, rsa->_method_mod_p,
-                                      ctx)
-            /* r0 = r1 * q + m1 */
-            || !bn_mul_fixed_top(r0, r1, rsa->q, ctx)
-            || !bn_mod_add_fixed_top(r0, r0, m1, rsa->n))
+            || !rsa_ossl_crt_combine(r0, r1, m1, rsa, ctx))
             goto err;
 
         goto tail;
@@ -1058,69 +1226,137 @@ static int rsa_ossl_mod_exp(BIGNUM *r0, const BIGNUM *I, RSA *rsa, BN_CTX *ctx)
 #endif
 
  tail:
-    if (rsa->e && rsa->n) {
-        if (rsa->meth->bn_mod_exp == BN_mod_exp_mont) {
-            if (!BN_mod_exp_mont(vrfy, r0, rsa->e, rsa->n, ctx,
-                                 rsa->_method_mod_n))
-                goto err;
-        } else {
-            bn_correct_top(r0);
-            if (!rsa->meth->bn_mod_exp(vrfy, r0, rsa->e, rsa->n, ctx,
-                                       rsa->_method_mod_n))
-                goto err;
-        }
-        /*
-         * If 'I' was greater than (or equal to) rsa->n, the operation will
-         * be equivalent to using 'I mod n'. However, the result of the
-         * verify will *always* be less than 'n' so we don't check for
-         * absolute equality, just congruency.
-         */
-        if (!BN_sub(vrfy, vrfy, I))
-            goto err;
-        if (BN_is_zero(vrfy)) {
-            bn_correct_top(r0);
-            ret = 1;
-            goto err;   /* not actually error */
+    if (!rsa_ossl_crt_check(r0, I, rsa, ctx))
+        goto err;
+    ret = 1;
+ err:
+    BN_CTX_end(ctx);
+    return ret;
+}
+
+/*
+ * Whether the private key operations of |rsa| do the CRT with p and q of
+ * the same size in rsa_ossl_mod_exp(), so that the exponentiations of two
+ * of them can be done together.
+ */
+static int rsa_ossl_can_pair(const RSA *rsa)
+{
+    return rsa->meth->rsa_priv_enc == rsa_ossl_private_encrypt
+           && rsa->meth->rsa_mod_exp == rsa_ossl_mod_exp
+           && rsa->meth->bn_mod_exp == BN_mod_exp_mont
+           && (rsa->flags & (RSA_FLAG_CACHE_PRIVATE | RSA_FLAG_EXT_PKEY))
+              == RSA_FLAG_CACHE_PRIVATE
+           && rsa->version != RSA_ASN1_VERSION_MULTI
+           && rsa->p != NULL && rsa->q != NULL && rsa->dmp1 != NULL
+           && rsa->dmq1 != NULL && rsa->iqmp != NULL
+           && BN_num_bits(rsa->p) == BN_num_bits(rsa->q);
+}
+
+/*
+ * Two private key operations with the four CRT exponentiations done by
+ * ossl_bn_mod_exp_mont_consttime_x4().  If the input of one of them is
+ * rejected, the other one is done on its own.
+ */
+static void rsa_ossl_private_encrypt_x2(const int flen[2],
+                                        const unsigned char *const from[2],
+                                        unsigned char *const to[2],
+                                        RSA *const rsa[2], int padding,
+                                        int ret[2])
+{
+    RSA_PRIV_OP op[2];
+    BIGNUM *m1[2], *r1[2], *rr[4];
+    const BIGNUM *a[4], *e[4], *m[4];
+    BN_MONT_CTX *mont[4];
+    int i, ok[2];
+
+    for (i = 0; i < 2; i++)
+        ok[i] = rsa_priv_op_begin(&op[i], flen[i], from[i], rsa[i], padding, 1);
+
+    if (ok[0] && ok[1]) {
+        for (i = 0; i < 2; i++) {
+            BN_CTX *ctx = op[i].ctx;
+
+            m1[i] = BN_CTX_get(ctx);
+            r1[i] = BN_CTX_get(ctx);
+            if (r1[i] == NULL
+                    || !rsa_ossl_set_crt_mont(rsa[i], ctx)
+                    || !rsa_ossl_crt_reduce(m1[i], r1[i], op[i].f, rsa[i], ctx))
+                ok[0] = ok[1] = 0;
+
+            /* m1 = m1^dmq1 mod q and r1 = r1^dmp1 mod p */
+            rr[2 * i] = m1[i];
+            a[2 * i] = m1[i];
+            e[2 * i] = rsa[i]->dmq1;
+            m[2 * i] = rsa[i]->q;
+            mont[2 * i] = rsa[i]->_method_mod_q;
+            rr[2 * i + 1] = r1[i];
+            a[2 * i + 1] = r1[i];
+            e[2 * i + 1] = rsa[i]->dmp1;
+            m[2 * i + 1] = rsa[i]->p;
+            mont[2 * i + 1] = rsa[i]->_method_mod_p;
         }
-        if (!BN_mod(vrfy, vrfy, rsa->n, ctx))
-            goto err;
-        if (BN_is_negative(vrfy))
-            if (!BN_add(vrfy, vrfy, rsa->n))
-                goto err;
-        if (!BN_is_zero(vrfy)) {
-            /*
-             * 'I' and 'vrfy' aren't congruent mod n. Don't leak
-             * miscalculated CRT output, just do a raw (slower) mod_exp and
-             * return that instead.
-             */
+        if (ok[0]
+                && !ossl_bn_mod_exp_mont_consttime_x4(rr, a, e, m, mont,
+                                                      op[0].ctx))
+            ok[0] = ok[1] = 0;
+        for (i = 0; i < 2; i++)
+            ok[i] = ok[i]
+                    && rsa_ossl_crt_combine(op[i].ret, r1[i], m1[i], rsa[i],
+                                            op[i].ctx)
+                    && rsa_ossl_crt_check(op[i].ret, op[i].f, rsa[i],
+                                          op[i].ctx);
+    } else {
+        for (i = 0; i < 2; i++)
+            ok[i] = ok[i] && rsa_priv_op_exp(&op[i]);
+    }
 
-            BIGNUM *d = BN_new();
-            if (d == NULL)
-                goto err;
-            BN_with_flags(d, rsa->d, BN_FLG_CONSTTIME);
+    for (i = 0; i < 2; i++) {
+        ret[i] = ok[i] ? rsa_priv_op_end(&op[i], to[i]) : -1;
+        rsa_priv_op_cleanup(&op[i]);
+    }
+}
 
-            if (!rsa->meth->bn_mod_exp(r0, I, d, rsa->n, ctx,
-                                       rsa->_method_mod_n)) {
-                BN_free(d);
-                goto err;
-            }
-            /* We MUST free d before any further use of rsa->d */
-            BN_free(d);
+int ossl_rsa_private_encrypt_batch(size_t num, const int flen[],
+                                   const unsigned char *const from[],
+                                   unsigned char *const to[],
+                                   RSA *const rsa[], int padding, int ret[])
+{
+    size_t i, j, pair[2];
+    int flen2[2], ret2[2], ok = 1;
+    const unsigned char *from2[2];
+    unsigned char *to2[2];
+    RSA *rsa2[2];
+
+    for (i = 0, j = 0; i < num; i++) {
+        if (!rsa_ossl_can_pair(rsa[i])) {
+            ret[i] = RSA_private_encrypt(flen[i], from[i], to[i], rsa[i],
+                                         padding);
+            ok &= ret[i] > 0;
+            continue;
+        }
+        pair[j++] = i;
+        if (j < 2)
+            continue;
+        for (j = 0; j < 2; j++) {
+            flen2[j] = flen[pair[j]];
+            from2[j] = from[pair[j]];
+            to2[j] = to[pair[j]];
+            rsa2[j] = rsa[pair[j]];
+        }
+        rsa_ossl_private_encrypt_x2(flen2, from2, to2, rsa2, padding, ret2);
+        for (j = 0; j < 2; j++) {
+            ret[pair[j]] = ret2[j];
+            ok &= ret2[j] > 0;
         }
+        j = 0;
     }
-    /*
-     * It's unfortunate that we have to bn_correct_top(r0). What hopefully
-     * saves the day is that correction is highly unlike, and private key
-     * operations are customarily performed on blinded message. Which means
-     * that attacker won't observe correlation with chosen plaintext.
-     * Secondly, remaining code would still handle it in same computational
-     * time and even conceal memory access pattern around corrected top.
-     */
-    bn_correct_top(r0);
-    ret = 1;
- err:
-    BN_CTX_end(ctx);
-    return ret;
+    /* The odd one out */
+    if (j == 1) {
+        i = pair[0];
+        ret[i] = RSA_private_encrypt(flen[i], from[i], to[i], rsa[i], padding);
+        ok &= ret[i] > 0;
+    }
+    return ok;
 }
 
 static int rsa_ossl_init(RSA *rsa)
@@ -280,10 +280,11 @@ my ($A_flat,$inp,$len,$bsz) = ("%rdi","%rsi","%rdx","%rcx");
 my  $out = $inp;	# in squeeze
 
 $code.=<<___;
-.globl	SHA3_absorb
-.type	SHA3_absorb,\@function
+.globl	SHA3_absorb_avx512
+.type	SHA3_absorb_avx512,\@function
 .align	32
-SHA3_absorb:
+SHA3_absorb_avx512:
+	endbranch
 	mov	%rsp,%r11
 
 	lea	-320(%rsp),%rsp
@@ -384,12 +385,13 @@ $code.=<<___;
 	lea	(%r11),%rsp
 	lea	($len,$bsz),%rax		# return value
 	ret
-.size	SHA3_absorb,.-SHA3_absorb
+.size	SHA3_absorb_avx512,.-SHA3_absorb_avx512
 
-.globl	SHA3_squeeze
-.type	SHA3_squeeze,\@function
+.globl	SHA3_squeeze_avx512
+.type	SHA3_squeeze_avx512,\@function
 .align	32
-SHA3_squeeze:
+SHA3_squeeze_avx512:
+	endbranch
 	mov	%rsp,%r11
 
 	lea	96($A_flat),$A_flat
@@ -484,7 +486,7 @@ SHA3_squeeze:
 
 	lea	(%r11),%rsp
 	ret
-.size	SHA3_squeeze,.-SHA3_squeeze
+.size	SHA3_squeeze_avx512,.-SHA3_squeeze_avx512
 
 .section .rodata
 .align	64
@@ -546,6 +548,19 @@ iotas:
 .asciz	"Keccak-1600 absorb and squeeze for AVX-512F, CRYPTOGAMS by <appro\@openssl.org>"
 ___
 
-$output=pop and open STDOUT,">$output";
+# $output is the last argument if it looks like a file (it has an extension)
+# $flavour is the first argument if it doesn't look like a file
+$output = $#ARGV >= 0 && $ARGV[$#ARGV] =~ m|\.\w+$| ? pop : undef;
+$flavour = $#ARGV >= 0 && $ARGV[0] !~ m|\.| ? shift : undef;
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\""
+    or die "can't call $xlate: $!";
+*STDOUT=*OUT;
+
 print $code;
 close STDOUT or die "error closing STDOUT: $!";
@@ -412,10 +412,10 @@ ___
 { my ($A_flat,$inp,$len,$bsz) = ("%rdi","%rsi","%rdx","%rcx");
      ($A_flat,$inp) = ("%r8","%r9");
 $code.=<<___;
-.globl	SHA3_absorb
-.type	SHA3_absorb,\@function,4
+.globl	SHA3_absorb_x86_64
+.type	SHA3_absorb_x86_64,\@function,4
 .align	32
-SHA3_absorb:
+SHA3_absorb_x86_64:
 .cfi_startproc
 	push	%rbx
 .cfi_push	%rbx
@@ -500,17 +500,17 @@ SHA3_absorb:
 .cfi_pop	%rbx
 	ret
 .cfi_endproc
-.size	SHA3_absorb,.-SHA3_absorb
+.size	SHA3_absorb_x86_64,.-SHA3_absorb_x86_64
 ___
 }
 { my ($A_flat,$out,$len,$bsz) = ("%rdi","%rsi","%rdx","%rcx");
      ($out,$len,$bsz) = ("%r12","%r13","%r14");
 
 $code.=<<___;
-.globl	SHA3_squeeze
-.type	SHA3_squeeze,\@function,4
+.globl	SHA3_squeeze_x86_64
+.type	SHA3_squeeze_x86_64,\@function,4
 .align	32
-SHA3_squeeze:
+SHA3_squeeze_x86_64:
 .cfi_startproc
 	push	%r12
 .cfi_push	%r12
@@ -561,7 +561,7 @@ SHA3_squeeze:
 .cfi_pop	%r13
 	ret
 .cfi_endproc
-.size	SHA3_squeeze,.-SHA3_squeeze
+.size	SHA3_squeeze_x86_64,.-SHA3_squeeze_x86_64
 ___
 }
 $code.=<<___;
@@ -0,0 +1,405 @@
+#! /usr/bin/env perl
+# Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+#
+# Multi-buffer SHA512 procedure processes 4 buffers in parallel by
+# placing buffer data to designated lane of 256-bit register, the same
+# way as sha256-mb-x86_64.pl does it with 32-bit lanes. Buffers may be
+# of different length, lanes that run out of blocks are masked out of
+# the state update. The AVX512VL flavour differs only in that it uses
+# vprorq for rotations and vpternlogq for Ch, Maj and three-way xor.
+#
+# Padding is left to the caller, see sha/sha_batch.c.
+#
+########################################################################
+# Throughput of four buffers at once in comparison to four consecutive
+# runs of scalar sha512-x86_64.pl, out of large messages:
+#
+#			AVX2	AVX512VL
+#
+# Xeon (AVX-512)	+70%	+215%
+
+# $output is the last argument if it looks like a file (it has an extension)
+# $flavour is the first argument if it doesn't look like a file
+$output = $#ARGV >= 0 && $ARGV[$#ARGV] =~ m|\.\w+$| ? pop : undef;
+$flavour = $#ARGV >= 0 && $ARGV[0] !~ m|\.| ? shift : undef;
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\""
+    or die "can't call $xlate: $!";
+*STDOUT=*OUT;
+
+# void sha512_multi_block_{avx2,avx512vl} (
+#     struct {	unsigned long A[4];
+#		unsigned long B[4];
+#		unsigned long C[4];
+#		unsigned long D[4];
+#		unsigned long E[4];
+#		unsigned long F[4];
+#		unsigned long G[4];
+#		unsigned long H[4];	} *ctx,
+#     struct {	void *ptr; int blocks;	} inp[4]);
+#
+$ctx="%rdi";	# 1st arg
+$inp="%rsi";	# 2nd arg
+$num="%edx";
+@ptr=map("%r$_",(8..11));
+$Tbl="%rbp";
+
+@V=($A,$B,$C,$D,$E,$F,$G,$H)=map("%ymm$_",(8..15));
+($t1,$t2,$t3,$axb,$bxc,$Xi,$Xn,$sigma)=map("%ymm$_",(0..7));
+
+# Stack frame: 16 message words of 4 lanes, then the block counters
+$REG_SZ=32;
+$cnt=$REG_SZ*16;
+
+sub xmm { my $r=shift; $r =~ s/ymm/xmm/; $r; }
+
+sub Xi_off {
+my $off = shift;
+
+    $off %= 16; $off *= $REG_SZ;
+    $off<256 ? "$off-128(%rax)" : "$off-256-128(%rbx)";
+}
+
+sub ROUND_00_15 {
+my ($i,$avx512,$a,$b,$c,$d,$e,$f,$g,$h)=@_;
+
+if ($i<16) {
+    my ($xi,$xt)=(&xmm($Xi),&xmm($t1));
+
+    $code.=<<___;
+	vmovq		`8*$i`(@ptr[0]),$xi
+	vmovq		`8*$i`(@ptr[2]),$xt
+	vpinsrq		\$1,`8*$i`(@ptr[1]),$xi,$xi
+	vpinsrq		\$1,`8*$i`(@ptr[3]),$xt,$xt
+	vinserti128	\$1,$xt,$Xi,$Xi
+	vpshufb		$Xn,$Xi,$Xi
+___
+    $code.=<<___ if ($i==15);
+	lea		`16*8`(@ptr[0]),@ptr[0]
+	lea		`16*8`(@ptr[1]),@ptr[1]
+	lea		`16*8`(@ptr[2]),@ptr[2]
+	lea		`16*8`(@ptr[3]),@ptr[3]
+___
+}
+if ($avx512) {
+$code.=<<___;
+	vmovdqu		$Xi,`&Xi_off($i)`
+	vpaddq		$h,$Xi,$Xi			# Xi+=h
+	vpaddq		`32*($i%8)-128`($Tbl),$Xi,$Xi	# Xi+=K[round]
+
+	vprorq		\$14,$e,$sigma
+	vprorq		\$18,$e,$t2
+	vprorq		\$41,$e,$t3
+	vpternlogq	\$0x96,$t3,$t2,$sigma		# Sigma1(e)
+	vmovdqa		$e,$t1
+	vpternlogq	\$0xca,$g,$f,$t1		# Ch(e,f,g)
+	vpaddq		$sigma,$Xi,$Xi			# Xi+=Sigma1(e)
+	vpaddq		$t1,$Xi,$Xi			# Xi+=Ch(e,f,g)
+
+	vprorq		\$28,$a,$sigma
+	vprorq		\$34,$a,$t2
+	vprorq		\$39,$a,$t3
+	vpternlogq	\$0x96,$t3,$t2,$sigma		# Sigma0(a)
+	vmovdqa		$a,$h
+	vpternlogq	\$0xe8,$c,$b,$h			# h=Maj(a,b,c)
+	vpaddq		$Xi,$d,$d			# d+=Xi
+	vpaddq		$Xi,$h,$h			# h+=Xi
+	vpaddq		$sigma,$h,$h			# h+=Sigma0(a)
+___
+} else {
+$code.=<<___;
+	vpsrlq	\$14,$e,$sigma
+	vpsllq	\$50,$e,$t3
+	vmovdqu	$Xi,`&Xi_off($i)`
+	 vpaddq	$h,$Xi,$Xi			# Xi+=h
+
+	vpsrlq	\$18,$e,$t2
+	vpxor	$t3,$sigma,$sigma
+	vpsllq	\$46,$e,$t3
+	 vpaddq	`32*($i%8)-128`($Tbl),$Xi,$Xi	# Xi+=K[round]
+	vpxor	$t2,$sigma,$sigma
+
+	vpsrlq	\$41,$e,$t2
+	vpxor	$t3,$sigma,$sigma
+	vpsllq	\$23,$e,$t3
+	 vpandn	$g,$e,$t1
+	 vpand	$f,$e,$axb			# borrow $axb
+	vpxor	$t2,$sigma,$sigma
+
+	vpsrlq	\$28,$a,$h			# borrow $h
+	vpxor	$t3,$sigma,$sigma		# Sigma1(e)
+	vpsllq	\$36,$a,$t2
+	 vpxor	$axb,$t1,$t1			# Ch(e,f,g)
+	 vpxor	$a,$b,$axb			# a^b, b^c in next round
+	vpxor	$t2,$h,$h
+	vpaddq	$sigma,$Xi,$Xi			# Xi+=Sigma1(e)
+
+	vpsrlq	\$34,$a,$t2
+	vpsllq	\$30,$a,$t3
+	 vpaddq	$t1,$Xi,$Xi			# Xi+=Ch(e,f,g)
+	 vpand	$axb,$bxc,$bxc
+	vpxor	$t2,$h,$sigma
+
+	vpsrlq	\$39,$a,$t2
+	vpxor	$t3,$sigma,$sigma
+	vpsllq	\$25,$a,$t3
+	 vpxor	$bxc,$b,$h			# h=Maj(a,b,c)=Ch(a^b,c,b)
+	 vpaddq	$Xi,$d,$d			# d+=Xi
+	vpxor	$t2,$sigma,$sigma
+	vpxor	$t3,$sigma,$sigma		# Sigma0(a)
+
+	vpaddq	$Xi,$h,$h			# h+=Xi
+	vpaddq	$sigma,$h,$h			# h+=Sigma0(a)
+___
+	($axb,$bxc)=($bxc,$axb);
+}
+$code.=<<___ if (($i%8)==7);
+	add	\$`32*8`,$Tbl
+___
+}
+
+sub ROUND_16_XX {
+my ($i,$avx512)=(shift,shift);
+
+$code.=<<___;
+	vmovdqu	`&Xi_off($i+1)`,$Xn
+	vpaddq	`&Xi_off($i+9)`,$Xi,$Xi		# Xi+=X[i+9]
+	vmovdqu	`&Xi_off($i+14)`,$t1
+___
+if ($avx512) {
+$code.=<<___;
+	vprorq		\$1,$Xn,$sigma
+	vprorq		\$8,$Xn,$t2
+	vpsrlq		\$7,$Xn,$t3
+	vpternlogq	\$0x96,$t3,$t2,$sigma		# sigma0(X[i+1])
+	vpaddq		$sigma,$Xi,$Xi
+	vprorq		\$19,$t1,$sigma
+	vprorq		\$61,$t1,$t2
+	vpsrlq		\$6,$t1,$t3
+	vpternlogq	\$0x96,$t3,$t2,$sigma		# sigma1(X[i+14])
+	vpaddq		$sigma,$Xi,$Xi
+___
+} else {
+$code.=<<___;
+	vpsrlq	\$7,$Xn,$sigma
+	vpsrlq	\$1,$Xn,$t2
+	vpsllq	\$63,$Xn,$t3
+	vpxor	$t2,$sigma,$sigma
+	vpsrlq	\$8,$Xn,$t2
+	vpxor	$t3,$sigma,$sigma
+	vpsllq	\$56,$Xn,$t3
+	vpsrlq	\$6,$t1,$axb			# borrow $axb
+
+	vpxor	$t2,$sigma,$sigma
+	vpsrlq	\$19,$t1,$t2
+	vpxor	$t3,$sigma,$sigma		# sigma0(X[i+1])
+	vpsllq	\$45,$t1,$t3
+	 vpaddq	$sigma,$Xi,$Xi			# Xi+=sigma0(X[i+1])
+	vpxor	$t2,$axb,$sigma
+	vpsrlq	\$61,$t1,$t2
+	vpxor	$t3,$sigma,$sigma
+	vpsllq	\$3,$t1,$t3
+	vpxor	$t2,$sigma,$sigma
+	vpxor	$t3,$sigma,$sigma		# sigma1(X[i+14])
+	vpaddq	$sigma,$Xi,$Xi			# Xi+=sigma1(X[i+14])
+___
+}
+	&ROUND_00_15($i,$avx512,@_);
+	($Xi,$Xn)=($Xn,$Xi);
+}
+
+$code.=<<___;
+.text
+___
+
+foreach my $avx512 (0, 1) {
+my $sfx = $avx512 ? "avx512vl" : "avx2";
+my $i;
+
+$code.=<<___;
+
+.globl	sha512_multi_block_$sfx
+.type	sha512_multi_block_$sfx,\@function,2
+.align	32
+sha512_multi_block_$sfx:
+.cfi_startproc
+	endbranch
+	mov	%rsp,%rax
+.cfi_def_cfa_register	%rax
+	push	%rbx
+.cfi_push	%rbx
+	push	%rbp
+.cfi_push	%rbp
+	sub	\$`$REG_SZ*18`,%rsp
+	and	\$-256,%rsp
+	mov	%rax,`$REG_SZ*17`(%rsp)		# original %rsp
+.cfi_cfa_expression	%rsp+`$REG_SZ*17`,deref,+8
+	lea	K512_x4+128(%rip),$Tbl
+	xor	$num,$num
+___
+for($i=0;$i<4;$i++) {
+    $code.=<<___;
+	# input pointer
+	mov	`16*$i+0`($inp),@ptr[$i]
+	# number of blocks
+	mov	`16*$i+8`($inp),%ecx
+	cmp	$num,%ecx
+	cmovg	%ecx,$num			# find maximum
+	test	%ecx,%ecx
+	mov	%rcx,`8*$i+$cnt`(%rsp)		# initialize counters
+	cmovle	$Tbl,@ptr[$i]			# cancel input
+___
+}
+$code.=<<___;
+	test	$num,$num
+	jz	.Ldone_$sfx
+
+	vmovdqu	0x00($ctx),$A			# load context
+	 lea	128(%rsp),%rax
+	vmovdqu	0x20($ctx),$B
+	 lea	256+128(%rsp),%rbx
+	vmovdqu	0x40($ctx),$C
+	vmovdqu	0x60($ctx),$D
+	vmovdqu	0x80($ctx),$E
+	vmovdqu	0xa0($ctx),$F
+	vmovdqu	0xc0($ctx),$G
+	vmovdqu	0xe0($ctx),$H
+	vmovdqu	.Lpbswap_x4(%rip),$Xn
+	jmp	.Loop_$sfx
+
+.align	32
+.Loop_$sfx:
+___
+$code.=<<___ if (!$avx512);
+	vpxor	$B,$C,$bxc			# magic seed
+___
+for($i=0;$i<16;$i++)	{ &ROUND_00_15($i,$avx512,@V); unshift(@V,pop(@V)); }
+$code.=<<___;
+	vmovdqu	`&Xi_off($i)`,$Xi
+	mov	\$4,%ecx
+	jmp	.Loop_16_xx_$sfx
+.align	32
+.Loop_16_xx_$sfx:
+___
+for(;$i<32;$i++)	{ &ROUND_16_XX($i,$avx512,@V); unshift(@V,pop(@V)); }
+$code.=<<___;
+	dec	%ecx
+	jnz	.Loop_16_xx_$sfx
+
+	mov	\$1,%ecx
+	lea	K512_x4+128(%rip),$Tbl
+___
+for($i=0;$i<4;$i++) {
+    $code.=<<___;
+	cmp	`8*$i+$cnt`(%rsp),%rcx		# examine counters
+	cmovge	$Tbl,@ptr[$i]			# cancel input
+___
+}
+$code.=<<___;
+	vmovdqa	$cnt(%rsp),$sigma		# pull counters
+	vpxor	$t1,$t1,$t1
+	vmovdqa	$sigma,$Xn
+	vpcmpgtq $t1,$Xn,$Xn			# mask value
+	vpaddq	$Xn,$sigma,$sigma		# counters--
+
+	vmovdqu	0x00($ctx),$t1
+	vpand	$Xn,$A,$A
+	vmovdqu	0x20($ctx),$t2
+	vpand	$Xn,$B,$B
+	vmovdqu	0x40($ctx),$t3
+	vpand	$Xn,$C,$C
+	vmovdqu	0x60($ctx),$Xi
+	vpand	$Xn,$D,$D
+	vpaddq	$t1,$A,$A
+	vmovdqu	0x80($ctx),$t1
+	vpand	$Xn,$E,$E
+	vpaddq	$t2,$B,$B
+	vmovdqu	0xa0($ctx),$t2
+	vpand	$Xn,$F,$F
+	vpaddq	$t3,$C,$C
+	vmovdqu	0xc0($ctx),$t3
+	vpand	$Xn,$G,$G
+	vpaddq	$Xi,$D,$D
+	vmovdqu	0xe0($ctx),$Xi
+	vpand	$Xn,$H,$H
+	vpaddq	$t1,$E,$E
+	vpaddq	$t2,$F,$F
+	vmovdqu	$A,0x00($ctx)
+	vpaddq	$t3,$G,$G
+	vmovdqu	$B,0x20($ctx)
+	vpaddq	$Xi,$H,$H
+	vmovdqu	$C,0x40($ctx)
+	vmovdqu	$D,0x60($ctx)
+	vmovdqu	$E,0x80($ctx)
+	vmovdqu	$F,0xa0($ctx)
+	vmovdqu	$G,0xc0($ctx)
+	vmovdqu	$H,0xe0($ctx)
+
+	vmovdqu	$sigma,$cnt(%rsp)		# save counters
+	vmovdqu	.Lpbswap_x4(%rip),$Xn
+	dec	$num
+	jnz	.Loop_$sfx
+
+.Ldone_$sfx:
+	mov	`$REG_SZ*17`(%rsp),%rax		# original %rsp
+.cfi_def_cfa	%rax,8
+	vzeroupper
+	mov	-16(%rax),%rbp
+.cfi_restore	%rbp
+	mov	-8(%rax),%rbx
+.cfi_restore	%rbx
+	lea	(%rax),%rsp
+.cfi_def_cfa_register	%rsp
+	ret
+.cfi_endproc
+.size	sha512_multi_block_$sfx,.-sha512_multi_block_$sfx
+___
+}
+
+$code.=<<___;
+
+.align	256
+K512_x4:
+___
+foreach (qw(0x428a2f98d728ae22 0x7137449123ef65cd 0xb5c0fbcfec4d3b2f 0xe9b5dba58189dbbc
+	    0x3956c25bf348b538 0x59f111f1b605d019 0x923f82a4af194f9b 0xab1c5ed5da6d8118
+	    0xd807aa98a3030242 0x12835b0145706fbe 0x243185be4ee4b28c 0x550c7dc3d5ffb4e2
+	    0x72be5d74f27b896f 0x80deb1fe3b1696b1 0x9bdc06a725c71235 0xc19bf174cf692694
+	    0xe49b69c19ef14ad2 0xefbe4786384f25e3 0x0fc19dc68b8cd5b5 0x240ca1cc77ac9c65
+	    0x2de92c6f592b0275 0x4a7484aa6ea6e483 0x5cb0a9dcbd41fbd4 0x76f988da831153b5
+	    0x983e5152ee66dfab 0xa831c66d2db43210 0xb00327c898fb213f 0xbf597fc7beef0ee4
+	    0xc6e00bf33da88fc2 0xd5a79147930aa725 0x06ca6351e003826f 0x142929670a0e6e70
+	    0x27b70a8546d22ffc 0x2e1b21385c26c926 0x4d2c6dfc5ac42aed 0x53380d139d95b3df
+	    0x650a73548baf63de 0x766a0abb3c77b2a8 0x81c2c92e47edaee6 0x92722c851482353b
+	    0xa2bfe8a14cf10364 0xa81a664bbc423001 0xc24b8b70d0f89791 0xc76c51a30654be30
+	    0xd192e819d6ef5218 0xd69906245565a910 0xf40e35855771202a 0x106aa07032bbd1b8
+	    0x19a4c116b8d2d0c8 0x1e376c085141ab53 0x2748774cdf8eeb99 0x34b0bcb5e19b48a8
+	    0x391c0cb3c5c95a63 0x4ed8aa4ae3418acb 0x5b9cca4f7763e373 0x682e6ff3d6b2b8a3
+	    0x748f82ee5defb2fc 0x78a5636f43172f60 0x84c87814a1f0ab72 0x8cc702081a6439ec
+	    0x90befffa23631e28 0xa4506cebde82bde9 0xbef9a3f7b2c67915 0xc67178f2e372532b
+	    0xca273eceea26619c 0xd186b8c721c0c207 0xeada7dd6cde0eb1e 0xf57d4f7fee6ed178
+	    0x06f067aa72176fba 0x0a637dc5a2c898a6 0x113f9804bef90dae 0x1b710b35131c471b
+	    0x28db77f523047d84 0x32caab7b40c72493 0x3c9ebe0a15c9bebc 0x431d67c49c100d4c
+	    0x4cc5d4becb3e42b6 0x597f299cfc657e2a 0x5fcb6fab3ad6faec 0x6c44198c4a475817)) {
+	$code.="\t.quad\t$_,$_,$_,$_\n";
+}
+$code.=<<___;
+.Lpbswap_x4:
+	.quad	0x0001020304050607,0x08090a0b0c0d0e0f	# pbswap
+	.quad	0x0001020304050607,0x08090a0b0c0d0e0f
+.asciz	"SHA512 multi-block transform for AVX2 and AVX512VL"
+___
+
+$code =~ s/\`([^\`]*)\`/eval($1)/gem;
+print $code;
+close STDOUT or die "error closing STDOUT: $!";
@@ -8,10 +8,9 @@
  */
 
 #include <string.h>
+#include <openssl/crypto.h>
 #include "internal/sha3.h"
 
-void SHA3_squeeze(uint64_t A[5][5], unsigned char *out, size_t len, size_t r);
-
 void ossl_sha3_reset(KECCAK1600_CTX *ctx)
 {
     memset(ctx->A, 0, sizeof(ctx->A));
@@ -107,3 +106,182 @@ int ossl_sha3_final(unsigned char *md, KECCAK1600_CTX *ctx)
 
     return 1;
 }
+
+/*
+ * The x4 functions process four states of the same rate, all fed the same
+ * amount of data.  Where the platform can't permute several states at once
+ * they are simply processed one after the other.
+ */
+#ifndef KECCAK1600_AVX_ASM
+size_t SHA3_absorb_x4(uint64_t (*A[4])[5], const unsigned char *inp[4],
+                      size_t len, size_t r)
+{
+    size_t i, rem = len;
+
+    for (i = 0; i < 4; i++)
+        rem = SHA3_absorb(A[i], inp[i], len, r);
+    return rem;
+}
+
+void SHA3_squeeze_x4(uint64_t (*A[4])[5], unsigned char *out[4], size_t len,
+                     size_t r)
+{
+    size_t i;
+
+    for (i = 0; i < 4; i++)
+        SHA3_squeeze(A[i], out[i], len, r);
+}
+#endif
+
+/* Whether |ctx| are all at the same point of the same kind of computation */
+static int sha3_same_x4(KECCAK1600_CTX *ctx[4])
+{
+    size_t i;
+
+    for (i = 1; i < 4; i++)
+        if (ctx[i]->block_size != ctx[0]->block_size
+                || ctx[i]->bufsz != ctx[0]->bufsz
+                || ctx[i]->md_size != ctx[0]->md_size)
+            return 0;
+    return 1;
+}
+
+int ossl_sha3_update_x4(KECCAK1600_CTX *ctx[4], const unsigned char *inp[4],
+                        size_t len)
+{
+    uint64_t (*A[4])[5];
+    const unsigned char *p[4];
+    size_t bsz = ctx[0]->block_size;
+    size_t num = ctx[0]->bufsz;
+    size_t i, rem;
+
+    if (!sha3_same_x4(ctx)) {
+        for (i = 0; i < 4; i++)
+            if (!ossl_sha3_update(ctx[i], inp[i], len))
+                return 0;
+        return 1;
+    }
+
+    if (len == 0)
+        return 1;
+
+    for (i = 0; i < 4; i++) {
+        A[i] = ctx[i]->A;
+        p[i] = inp[i];
+    }
+
+    if (num != 0) {                     /* process intermediate buffers? */
+        rem = bsz - num;
+
+        if (len < rem) {
+            for (i = 0; i < 4; i++) {
+                memcpy(ctx[i]->buf + num, inp[i], len);
+                ctx[i]->bufsz += len;
+            }
+            return 1;
+        }
+        for (i = 0; i < 4; i++) {
+            memcpy(ctx[i]->buf + num, inp[i], rem);
+            p[i] = ctx[i]->buf;
+        }
+        (void)SHA3_absorb_x4(A, p, bsz, bsz);
+        for (i = 0; i < 4; i++) {
+            ctx[i]->bufsz = 0;
+            p[i] = inp[i] + rem;
+        }
+        len -= rem;
+    }
+
+    if (len >= bsz)
+        rem = SHA3_absorb_x4(A, p, len, bsz);
+    else
+        rem = len;
+
+    if (rem) {
+        for (i = 0; i < 4; i++) {
+            memcpy(ctx[i]->buf, p[i] + len - rem, rem);
+            ctx[i]->bufsz = rem;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Unlike updates, the final padding doesn't need the states to have buffered
+ * the same amount of data.
+ */
+int ossl_sha3_final_x4(unsigned char *md[4], KECCAK1600_CTX *ctx[4])
+{
+    uint64_t (*A[4])[5];
+    const unsigned char *p[4];
+    size_t bsz = ctx[0]->block_size;
+    size_t i, num;
+
+    for (i = 1; i < 4; i++)
+        if (ctx[i]->block_size != bsz || ctx[i]->md_size != ctx[0]->md_size)
+            break;
+    if (i < 4) {
+        for (i = 0; i < 4; i++)
+            if (!ossl_sha3_final(md[i], ctx[i]))
+                return 0;
+        return 1;
+    }
+
+    if (ctx[0]->md_size == 0)
+        return 1;
+
+    for (i = 0; i < 4; i++) {
+        num = ctx[i]->bufsz;
+        memset(ctx[i]->buf + num, 0, bsz - num);
+        ctx[i]->buf[num] = ctx[i]->pad;
+        ctx[i]->buf[bsz - 1] |= 0x80;
+        A[i] = ctx[i]->A;
+        p[i] = ctx[i]->buf;
+    }
+
+    (void)SHA3_absorb_x4(A, p, bsz, bsz);
+
+    SHA3_squeeze_x4(A, md, ctx[0]->md_size, bsz);
+
+    return 1;
+}
+
+/*
+ * Digest |num| messages, each from a copy of |init|.  They are taken four at
+ * a time: the length they have in common goes through the x4 functions and
+ * only what each one has beyond that is absorbed on its own.
+ */
+int ossl_sha3_batch(const KECCAK1600_CTX *init,
+                    const unsigned char *const in[], const size_t inl[],
+                    unsigned char *const md[], size_t num)
+{
+    KECCAK1600_CTX ctx[4], *pctx[4];
+    const unsigned char *p[4];
+    unsigned char *pmd[4];
+    size_t i, j, len;
+    int ret = 1;
+
+    for (i = 0; i + 4 <= num && ret; i += 4) {
+        len = inl[i];
+        for (j = 0; j < 4; j++) {
+            ctx[j] = *init;
+            pctx[j] = &ctx[j];
+            p[j] = in[i + j];
+            pmd[j] = md[i + j];
+            if (inl[i + j] < len)
+                len = inl[i + j];
+        }
+        ret = ossl_sha3_update_x4(pctx, p, len);
+        for (j = 0; j < 4 && ret; j++)
+            ret = ossl_sha3_update(&ctx[j], in[i + j] + len, inl[i + j] - len);
+        ret = ret && ossl_sha3_final_x4(pmd, pctx);
+    }
+    for (; i < num && ret; i++) {
+        ctx[0] = *init;
+        ret = ossl_sha3_update(&ctx[0], in[i], inl[i])
+              && ossl_sha3_final(md[i], &ctx[0]);
+    }
+    OPENSSL_cleanse(ctx, sizeof(ctx));
+    return ret;
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include "internal/cryptlib.h"
+#include "internal/sha3.h"
+
+/*
+ * Run-time selection among the x86_64 Keccak-1600 implementations.
+ *
+ * The AVX-512F module keeps the state in the same linear layout as the
+ * scalar one.  The AVX2 and AVX512VL modules keep it in a permuted order
+ * suited to their register layout, see keccak1600-avx2.pl, so the state is
+ * converted on the way in and out.  That costs a few dozen loads and stores
+ * per call, which is why they are only used when at least one permutation
+ * is to be performed.
+ */
+
+#define AVX2_CAPABLE        (OPENSSL_ia32cap_P[2] & (1 << 5))
+#define AVX512F_CAPABLE     (OPENSSL_ia32cap_P[2] & (1 << 16))
+#define AVX512VL_CAPABLE    (OPENSSL_ia32cap_P[2] & (1U << 31))
+/* The AVX2 module is slower than the scalar one on early AMD processors */
+#define INTEL_CPU           (OPENSSL_ia32cap_P[0] & (1 << 30))
+
+size_t SHA3_absorb_x86_64(uint64_t A[5][5], const unsigned char *inp,
+                          size_t len, size_t r);
+void SHA3_squeeze_x86_64(uint64_t A[5][5], unsigned char *out, size_t len,
+                         size_t r);
+
+#ifdef KECCAK1600_AVX_ASM
+
+typedef size_t (keccak_absorb_fn)(uint64_t *A, const unsigned char *inp,
+                                  size_t len, size_t r);
+typedef void (keccak_squeeze_fn)(uint64_t *A, unsigned char *out, size_t len,
+                                 size_t r);
+
+size_t SHA3_absorb_avx512(uint64_t A[5][5], const unsigned char *inp,
+                          size_t len, size_t r);
+void SHA3_squeeze_avx512(uint64_t A[5][5], unsigned char *out, size_t len,
+                         size_t r);
+keccak_absorb_fn SHA3_absorb_avx2, SHA3_absorb_avx512vl;
+keccak_squeeze_fn SHA3_squeeze_avx2, SHA3_squeeze_avx512vl;
+
+void KeccakF1600_x4_avx2(uint64_t A[25][4]);
+void KeccakF1600_x4_avx512vl(uint64_t A[25][4]);
+
+/* Where lane i of the linear layout goes in the AVX2 and AVX512VL layout */
+static const unsigned char jagged[25] = {
+     0,  1,  2,  3,  4,
+     7, 21, 10, 15, 20,
+     5, 13, 22, 19, 12,
+     8,  9, 18, 23, 16,
+     6, 17, 14, 11, 24
+};
+
+static void to_jagged(uint64_t J[25], uint64_t A[5][5])
+{
+    const uint64_t *A_flat = &A[0][0];
+    size_t i;
+
+    for (i = 0; i < 25; i++)
+        J[jagged[i]] = A_flat[i];
+}
+
+static void from_jagged(uint64_t A[5][5], const uint64_t J[25])
+{
+    uint64_t *A_flat = &A[0][0];
+    size_t i;
+
+    for (i = 0; i < 25; i++)
+        A_flat[i] = J[jagged[i]];
+}
+
+static int jagged_module(keccak_absorb_fn **absorb,
+                         keccak_squeeze_fn **squeeze)
+{
+    if (AVX512VL_CAPABLE) {
+        *absorb = SHA3_absorb_avx512vl;
+        *squeeze = SHA3_squeeze_avx512vl;
+        return 1;
+    }
+    if (AVX2_CAPABLE && INTEL_CPU) {
+        *absorb = SHA3_absorb_avx2;
+        *squeeze = SHA3_squeeze_avx2;
+        return 1;
+    }
+    return 0;
+}
+
+#endif
+
+size_t SHA3_absorb(uint64_t A[5][5], const unsigned char *inp, size_t len,
+                   size_t r)
+{
+#ifdef KECCAK1600_AVX_ASM
+    keccak_absorb_fn *absorb;
+    keccak_squeeze_fn *squeeze;
+    uint64_t J[25];
+
+    if (AVX512F_CAPABLE)
+        return SHA3_absorb_avx512(A, inp, len, r);
+    if (len >= r && jagged_module(&absorb, &squeeze)) {
+        to_jagged(J, A);
+        len = absorb(J, inp, len, r);
+        from_jagged(A, J);
+        return len;
+    }
+#endif
+    return SHA3_absorb_x86_64(A, inp, len, r);
+}
+
+void SHA3_squeeze(uint64_t A[5][5], unsigned char *out, size_t len, size_t r)
+{
+#ifdef KECCAK1600_AVX_ASM
+    keccak_absorb_fn *absorb;
+    keccak_squeeze_fn *squeeze;
+    uint64_t J[25];
+
+    /* Nothing but a copy unless the output is longer than a block */
+    if (len > r) {
+        if (AVX512F_CAPABLE) {
+            SHA3_squeeze_avx512(A, out, len, r);
+            return;
+        }
+        if (jagged_module(&absorb, &squeeze)) {
+            to_jagged(J, A);
+            squeeze(J, out, len, r);
+            from_jagged(A, J);
+            return;
+        }
+    }
+#endif
+    SHA3_squeeze_x86_64(A, out, len, r);
+}
+
+#ifdef KECCAK1600_AVX_ASM
+
+/*
+ * Four states interleaved lane by lane for the x4 modules, with lane i of
+ * state j in X[i][j].
+ */
+typedef void (keccak_x4_fn)(uint64_t X[25][4]);
+
+static keccak_x4_fn *keccak_x4(void)
+{
+    if (AVX512VL_CAPABLE)
+        return KeccakF1600_x4_avx512vl;
+    if (AVX2_CAPABLE)
+        return KeccakF1600_x4_avx2;
+    return NULL;
+}
+
+static void x4_load(uint64_t X[25][4], uint64_t (*A[4])[5])
+{
+    size_t i, j;
+
+    for (j = 0; j < 4; j++)
+        for (i = 0; i < 25; i++)
+            X[i][j] = A[j][i / 5][i % 5];
+}
+
+static void x4_store(uint64_t (*A[4])[5], uint64_t X[25][4])
+{
+    size_t i, j;
+
+    for (j = 0; j < 4; j++)
+        for (i = 0; i < 25; i++)
+            A[j][i / 5][i % 5] = X[i][j];
+}
+
+size_t SHA3_absorb_x4(uint64_t (*A[4])[5], const unsigned char *inp[4],
+                      size_t len, size_t r)
+{
+    keccak_x4_fn *permute = keccak_x4();
+    uint64_t X[25][4], w;
+    size_t i, j, off, rem = len;
+
+    if (permute == NULL || len < r) {
+        for (j = 0; j < 4; j++)
+            rem = SHA3_absorb(A[j], inp[j], len, r);
+        return rem;
+    }
+
+    x4_load(X, A);
+    for (off = 0; len - off >= r; off += r) {
+        for (j = 0; j < 4; j++) {
+            for (i = 0; i < r / 8; i++) {
+                memcpy(&w, inp[j] + off + 8 * i, sizeof(w));
+                X[i][j] ^= w;
+            }
+        }
+        permute(X);
+    }
+    x4_store(A, X);
+    return len - off;
+}
+
+void SHA3_squeeze_x4(uint64_t (*A[4])[5], unsigned char *out[4], size_t len,
+                     size_t r)
+{
+    keccak_x4_fn *permute = keccak_x4();
+    uint64_t X[25][4];
+    size_t i, j, n, off;
+
+    if (permute == NULL || len <= r) {
+        for (j = 0; j < 4; j++)
+            SHA3_squeeze(A[j], out[j], len, r);
+        return;
+    }
+
+    x4_load(X, A);
+    for (off = 0; ; off += r) {
+        n = len - off < r ? len - off : r;
+        for (j = 0; j < 4; j++) {
+            for (i = 0; i < n / 8; i++)
+                memcpy(out[j] + off + 8 * i, &X[i][j], 8);
+            /* Lanes are stored little-endian, so the tail is a plain copy */
+            if (n % 8 != 0)
+                memcpy(out[j] + off + 8 * i, &X[i][j], n % 8);
+        }
+        if (off + n == len)
+            break;
+        permute(X);
+    }
+    x4_store(A, X);
+}
+
+#endif
@@ -0,0 +1,279 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * SHA1 and SHA2 low level APIs are deprecated for public use, but still ok for
+ * internal use.
+ */
+#include "internal/deprecated.h"
+
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/sha.h>
+#include "internal/cryptlib.h"
+#include "crypto/sha.h"
+
+/*
+ * Digests of many independent messages.  Where multi-buffer transforms are
+ * available, the messages are hashed several at a time, one per SIMD lane,
+ * and only the final padded blocks are assembled here.  Elsewhere, and for
+ * groups too small to fill enough lanes, the messages are hashed one after
+ * the other.
+ */
+
+#if defined(SHA_MB_ASM)
+
+typedef struct {
+    const unsigned char *ptr;
+    int blocks;
+} HASH_DESC;
+
+typedef void (sha_mb_fn)(void *ctx, const HASH_DESC *inp, int num);
+
+void sha1_multi_block(void *ctx, const HASH_DESC *inp, int num);
+void sha256_multi_block(void *ctx, const HASH_DESC *inp, int num);
+
+# define SHA_MB_MAX_LANES   8
+# define SHA_MB_MAX_WORDS   8
+# define SHA_MB_MAX_BLOCK   SHA512_CBLOCK
+/* Keeps the block counts in range of an int */
+# define SHA_MB_MAX_CHUNK   (1 << 20)
+
+typedef struct {
+    size_t lanes;               /* messages per call */
+    size_t min_lanes;           /* fewer than that are hashed one by one */
+    size_t words;               /* state words */
+    size_t word_size;           /* 4 or 8 bytes */
+    size_t block_size;
+    sha_mb_fn *transform;
+    int num;                    /* last argument of |transform| */
+} SHA_MB_METHOD;
+
+/* The message length goes into the last 8 or 16 bytes of the last block */
+# define SHA_MB_LENGTH_SIZE(m) ((m)->block_size / 8)
+
+/* The transforms need at least SSSE3 */
+# define SHA_MB_CAPABLE     (OPENSSL_ia32cap_P[1] & (1 << (41 - 32)))
+
+static const SHA_MB_METHOD sha1_mb = {
+    8, 4, 5, 4, SHA_CBLOCK, sha1_multi_block, 2
+};
+
+static const SHA_MB_METHOD sha256_mb = {
+    8, 4, 8, 4, SHA256_CBLOCK, sha256_multi_block, 2
+};
+
+# if defined(SHA512_MB_ASM)
+void sha512_multi_block_avx2(void *ctx, const HASH_DESC *inp);
+void sha512_multi_block_avx512vl(void *ctx, const HASH_DESC *inp);
+
+#  define AVX2_CAPABLE      (OPENSSL_ia32cap_P[2] & (1 << 5))
+#  define AVX512VL_CAPABLE  (OPENSSL_ia32cap_P[2] & (1U << 31))
+
+static void sha512_mb_avx2(void *ctx, const HASH_DESC *inp,
+                           ossl_unused int num)
+{
+    sha512_multi_block_avx2(ctx, inp);
+}
+
+static void sha512_mb_avx512vl(void *ctx, const HASH_DESC *inp,
+                               ossl_unused int num)
+{
+    sha512_multi_block_avx512vl(ctx, inp);
+}
+
+static const SHA_MB_METHOD sha512_mb_avx2_method = {
+    4, 2, 8, 8, SHA512_CBLOCK, sha512_mb_avx2, 1
+};
+
+static const SHA_MB_METHOD sha512_mb_avx512vl_method = {
+    4, 2, 8, 8, SHA512_CBLOCK, sha512_mb_avx512vl, 1
+};
+# endif
+
+static uint64_t sha_mb_word(const SHA_MB_METHOD *m, const void *state,
+                            size_t word, size_t lane)
+{
+    if (m->word_size == 4)
+        return ((const uint32_t *)state)[word * m->lanes + lane];
+    return ((const uint64_t *)state)[word * m->lanes + lane];
+}
+
+/*
+ * Hash |num| messages, no more than |m->lanes|, starting from the state
+ * |h|, and write the first |mdlen| bytes of the results.
+ */
+static void sha_mb_group(const SHA_MB_METHOD *m, const uint64_t h[],
+                         size_t mdlen, const unsigned char *const in[],
+                         const size_t inl[], unsigned char *const md[],
+                         size_t num)
+{
+    uint64_t state[SHA_MB_MAX_WORDS * SHA_MB_MAX_LANES];
+    unsigned char tail[SHA_MB_MAX_LANES][2 * SHA_MB_MAX_BLOCK];
+    HASH_DESC desc[SHA_MB_MAX_LANES];
+    size_t left[SHA_MB_MAX_LANES];
+    size_t bs = m->block_size, lsz = SHA_MB_LENGTH_SIZE(m);
+    size_t i, j, rem, nblocks, more;
+    uint64_t bits;
+
+    for (j = 0; j < m->words; j++) {
+        for (i = 0; i < m->lanes; i++) {
+            if (m->word_size == 4)
+                ((uint32_t *)state)[j * m->lanes + i] = (uint32_t)h[j];
+            else
+                state[j * m->lanes + i] = h[j];
+        }
+    }
+
+    memset(desc, 0, sizeof(desc));
+    more = 0;
+    for (i = 0; i < num; i++) {
+        desc[i].ptr = in[i];
+        left[i] = inl[i] / bs;
+        more |= left[i];
+    }
+    while (more != 0) {
+        more = 0;
+        for (i = 0; i < num; i++) {
+            nblocks = left[i] < SHA_MB_MAX_CHUNK ? left[i] : SHA_MB_MAX_CHUNK;
+            desc[i].blocks = (int)nblocks;
+            left[i] -= nblocks;
+            more |= left[i];
+        }
+        m->transform(state, desc, m->num);
+        for (i = 0; i < num; i++)
+            desc[i].ptr += (size_t)desc[i].blocks * bs;
+    }
+
+    /* The last one or two blocks, with the padding and the length */
+    for (i = 0; i < num; i++) {
+        rem = inl[i] % bs;
+        nblocks = rem + 1 + lsz <= bs ? 1 : 2;
+        memset(tail[i], 0, nblocks * bs);
+        memcpy(tail[i], in[i] + inl[i] - rem, rem);
+        tail[i][rem] = 0x80;
+        bits = (uint64_t)inl[i] << 3;
+        for (j = 0; j < 8; j++)
+            tail[i][nblocks * bs - 1 - j] = (unsigned char)(bits >> (8 * j));
+        if (lsz > 8)
+            tail[i][nblocks * bs - 9] = (unsigned char)((uint64_t)inl[i] >> 61);
+        desc[i].ptr = tail[i];
+        desc[i].blocks = (int)nblocks;
+    }
+    m->transform(state, desc, m->num);
+
+    for (i = 0; i < num; i++)
+        for (j = 0; j < mdlen; j++)
+            md[i][j] = (unsigned char)(sha_mb_word(m, state, j / m->word_size, i)
+                                       >> (8 * (m->word_size - 1
+                                                - j % m->word_size)));
+
+    OPENSSL_cleanse(state, sizeof(state));
+    OPENSSL_cleanse(tail, sizeof(tail));
+}
+
+/*
+ * Hash the messages in groups of |m->lanes|, returning the number of them
+ * that are left for the caller to hash one by one.
+ */
+static size_t sha_mb(const SHA_MB_METHOD *m, const uint64_t h[], size_t mdlen,
+                     const unsigned char *const in[], const size_t inl[],
+                     unsigned char *const md[], size_t num)
+{
+    size_t i, n;
+
+    for (i = 0; i < num; i += n) {
+        n = num - i < m->lanes ? num - i : m->lanes;
+        if (n < m->min_lanes)
+            break;
+        sha_mb_group(m, h, mdlen, in + i, inl + i, md + i, n);
+    }
+    return num - i;
+}
+
+#endif /* SHA_MB_ASM */
+
+int ossl_sha1_batch(const SHA_CTX *init, const unsigned char *const in[],
+                    const size_t inl[], unsigned char *const md[], size_t num)
+{
+    SHA_CTX c;
+    size_t i = 0;
+    int ret = 1;
+
+#if defined(SHA_MB_ASM)
+    if (SHA_MB_CAPABLE) {
+        uint64_t h[5];
+
+        h[0] = init->h0;
+        h[1] = init->h1;
+        h[2] = init->h2;
+        h[3] = init->h3;
+        h[4] = init->h4;
+        i = num - sha_mb(&sha1_mb, h, SHA_DIGEST_LENGTH, in, inl, md, num);
+    }
+#endif
+    for (; i < num && ret; i++) {
+        c = *init;
+        ret = SHA1_Update(&c, in[i], inl[i]) && SHA1_Final(md[i], &c);
+    }
+    OPENSSL_cleanse(&c, sizeof(c));
+    return ret;
+}
+
+int ossl_sha256_batch(const SHA256_CTX *init, const unsigned char *const in[],
+                      const size_t inl[], unsigned char *const md[],
+                      size_t num)
+{
+    SHA256_CTX c;
+    size_t i = 0;
+    int ret = 1;
+
+#if defined(SHA_MB_ASM)
+    if (SHA_MB_CAPABLE) {
+        uint64_t h[8];
+
+        for (i = 0; i < 8; i++)
+            h[i] = init->h[i];
+        i = num - sha_mb(&sha256_mb, h, init->md_len, in, inl, md, num);
+    }
+#endif
+    for (; i < num && ret; i++) {
+        c = *init;
+        ret = SHA256_Update(&c, in[i], inl[i]) && SHA256_Final(md[i], &c);
+    }
+    OPENSSL_cleanse(&c, sizeof(c));
+    return ret;
+}
+
+int ossl_sha512_batch(const SHA512_CTX *init, const unsigned char *const in[],
+                      const size_t inl[], unsigned char *const md[],
+                      size_t num)
+{
+    SHA512_CTX c;
+    size_t i = 0;
+    int ret = 1;
+
+#if defined(SHA512_MB_ASM)
+    if (AVX2_CAPABLE) {
+        const SHA_MB_METHOD *m = AVX512VL_CAPABLE ? &sha512_mb_avx512vl_method
+                                                  : &sha512_mb_avx2_method;
+        uint64_t h[8];
+
+        for (i = 0; i < 8; i++)
+            h[i] = init->h[i];
+        i = num - sha_mb(m, h, init->md_len, in, inl, md, num);
+    }
+#endif
+    for (; i < num && ret; i++) {
+        c = *init;
+        ret = SHA512_Update(&c, in[i], inl[i]) && SHA512_Final(md[i], &c);
+    }
+    OPENSSL_cleanse(&c, sizeof(c));
+    return ret;
+}
@@ -0,0 +1,469 @@
+#! /usr/bin/env perl
+# Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+#
+# SM4-ECB and SM4-CTR with AVX2 and GFNI.
+#
+# Sixteen blocks are processed per iteration, as two groups of eight.
+# The blocks are transposed so that each 256-bit register holds the same
+# word of eight blocks, and the rounds are then done on whole words.
+#
+# The S-box is computed without tables.  It is the inversion in GF(2^8)
+# surrounded by two affine transforms, and the field SM4 uses is
+# isomorphic to the one of AES, so the isomorphism folds into the
+# transforms: vgf2p8affineqb maps the input into the AES field and
+# vgf2p8affineinvqb inverts it there and maps the result back.  The round
+# keys are the ones set up by ossl_sm4_set_key.
+#
+########################################################################
+# Throughput in comparison to the table-based C code, out of 16KB
+# buffers:
+#
+#			ECB	CTR
+#
+# Xeon (GFNI)		x10	x11
+#
+# Fewer than sixteen blocks are run through the same code from a buffer
+# on the stack, so short inputs cost as much as sixteen blocks.
+
+# $output is the last argument if it looks like a file (it has an extension)
+# $flavour is the first argument if it doesn't look like a file
+$output = $#ARGV >= 0 && $ARGV[$#ARGV] =~ m|\.\w+$| ? pop : undef;
+$flavour = $#ARGV >= 0 && $ARGV[0] !~ m|\.| ? shift : undef;
+
+$gfni = 0;
+
+$0 =~ m/(.*[\/\\])[^\/\\]+$/; $dir=$1;
+( $xlate="${dir}x86_64-xlate.pl" and -f $xlate ) or
+( $xlate="${dir}../../perlasm/x86_64-xlate.pl" and -f $xlate) or
+die "can't locate x86_64-xlate.pl";
+
+# GFNI support came with binutils 2.30 and clang 6
+if (`$ENV{CC} -Wa,-v -c -o /dev/null -x assembler /dev/null 2>&1`
+	=~ /GNU assembler version ([2-9]\.[0-9]+)/) {
+    $gfni = ($1 >= 2.30);
+}
+if (!$gfni && `$ENV{CC} -v 2>&1`
+	=~ /(Apple)?\s*((?:clang|LLVM) version|.*based on LLVM) ([0-9]+)\.([0-9]+)\.([0-9]+)?/) {
+    my $ver = $3 + $4/100.0 + $5/10000.0;
+    $gfni = $1 ? ($ver >= 10.0001) : ($ver >= 6.0);
+}
+
+open OUT,"| \"$^X\" \"$xlate\" $flavour \"$output\""
+    or die "can't call $xlate: $!";
+*STDOUT=*OUT;
+
+$code=".text\n";
+
+if ($gfni) {
+
+my ($inp,$out,$len,$key,$arg5) = ("%rdi","%rsi","%rdx","%rcx","%r8");
+my ($rk,$ctr) = ("%r10","%r9d");
+my @X = map("%ymm$_",(0..7));		# two groups of four words
+my ($ta,$ua,$tb,$ub) = map("%ymm$_",(8..11));
+my ($K,$R8,$R16,$R24) = map("%ymm$_",(12..15));
+# The registers holding the blocks at 0, 32, ... 224 bytes from the
+# start, after _sm4_gfni_avx2_16x
+my @O = @X[3,2,1,0,7,6,5,4];
+
+# Transpose the 4x4 words in each 128-bit lane of four registers
+sub transpose {
+my ($x0,$x1,$x2,$x3,$t0,$t1)=@_;
+return <<___;
+	vpunpckldq	$x1,$x0,$t0
+	vpunpckhdq	$x1,$x0,$x0
+	vpunpckldq	$x3,$x2,$t1
+	vpunpckhdq	$x3,$x2,$x2
+	vpunpckhqdq	$t1,$t0,$x1
+	vpunpcklqdq	$t1,$t0,$t0
+	vpunpckhqdq	$x2,$x0,$x3
+	vpunpcklqdq	$x2,$x0,$x2
+	vmovdqa	$t0,$x0
+___
+}
+
+# Load sixteen blocks from $src, in the form _sm4_gfni_avx2_16x takes
+sub load_16x {
+my ($src)=@_;
+my $code="\tvmovdqa\t.Lbswap32(%rip),$ta\n";
+    for (my $i=0; $i<8; $i++) {
+	$code.="\tvmovdqu\t".(32*$i)."($src),$X[$i]\n";
+	$code.="\tvpshufb\t$ta,$X[$i],$X[$i]\n";
+    }
+    $code.=transpose(@X[0..3],$ta,$tb);
+    $code.=transpose(@X[4..7],$ta,$tb);
+    return $code;
+}
+
+# One round on both groups: X[$i] ^= L(S(X[$i+1] ^ X[$i+2] ^ X[$i+3] ^ rk))
+sub round {
+my ($i)=@_;
+my @a = map($X[($i+$_)%4],(0..3));
+my @b = map($X[4+($i+$_)%4],(0..3));
+return <<___;
+	vpbroadcastd	`4*$i`($rk),$K
+	vpxor	$a[2],$a[1],$ta
+	vpxor	$b[2],$b[1],$tb
+	vpxor	$a[3],$ta,$ta
+	vpxor	$b[3],$tb,$tb
+	vpxor	$K,$ta,$ta
+	vpxor	$K,$tb,$tb
+	vgf2p8affineqb	\$0xdd,.Lsm4_pre(%rip),$ta,$ta
+	vgf2p8affineqb	\$0xdd,.Lsm4_pre(%rip),$tb,$tb
+	vgf2p8affineinvqb	\$0xd3,.Lsm4_post(%rip),$ta,$ta
+	vgf2p8affineinvqb	\$0xd3,.Lsm4_post(%rip),$tb,$tb
+	vpshufb	$R24,$ta,$ua
+	vpshufb	$R24,$tb,$ub
+	vpxor	$ta,$a[0],$a[0]
+	vpxor	$tb,$b[0],$b[0]
+	vpxor	$ua,$a[0],$a[0]
+	vpxor	$ub,$b[0],$b[0]
+	vpshufb	$R8,$ta,$ua
+	vpshufb	$R8,$tb,$ub
+	vpxor	$ta,$ua,$ua
+	vpxor	$tb,$ub,$ub
+	vpshufb	$R16,$ta,$ta
+	vpshufb	$R16,$tb,$tb
+	vpxor	$ta,$ua,$ua
+	vpxor	$tb,$ub,$ub
+	vpslld	\$2,$ua,$ta
+	vpslld	\$2,$ub,$tb
+	vpsrld	\$30,$ua,$ua
+	vpsrld	\$30,$ub,$ub
+	vpxor	$ta,$a[0],$a[0]
+	vpxor	$tb,$b[0],$b[0]
+	vpxor	$ua,$a[0],$a[0]
+	vpxor	$ub,$b[0],$b[0]
+___
+}
+
+########################################################################
+# The 32 rounds on the sixteen blocks in @X, with the round keys at %r11.
+# On entry @X[$j] holds word $j of blocks 0, 2, 4 and 6 in its low lane
+# and of blocks 1, 3, 5 and 7 in its high lane, as native integers, and
+# @X[4+$j] the same for blocks 8 to 15.  On return the blocks are back
+# in memory order in @O.
+$code.=<<___;
+.type	_sm4_gfni_avx2_16x,\@abi-omnipotent
+.align	32
+_sm4_gfni_avx2_16x:
+.cfi_startproc
+	vmovdqa	.Lrol8(%rip),$R8
+	vmovdqa	.Lrol16(%rip),$R16
+	vmovdqa	.Lrol24(%rip),$R24
+	mov	%r11,$rk
+	mov	\$8,%eax
+.align	16
+.Lsm4_rounds:
+___
+for (my $i=0; $i<4; $i++) { $code.=round($i); }
+$code.=<<___;
+	lea	16($rk),$rk
+	dec	%eax
+	jnz	.Lsm4_rounds
+
+	# The output is the last four words in reverse order
+___
+$code.=transpose(@X[3,2,1,0],$ta,$tb);
+$code.=transpose(@X[7,6,5,4],$ta,$tb);
+$code.="\tvmovdqa\t.Lbswap32(%rip),$ta\n";
+for (my $i=0; $i<8; $i++) {
+    $code.="\tvpshufb\t$ta,$X[$i],$X[$i]\n";
+}
+$code.=<<___;
+	ret
+.cfi_endproc
+.size	_sm4_gfni_avx2_16x,.-_sm4_gfni_avx2_16x
+___
+
+# Wipe the block buffer and the reversed key schedule on the stack, and
+# all the vector registers
+my $wipe_stack = sub {
+my ($bytes)=@_;
+my $code="\tvpxor\t$ta,$ta,$ta\n";
+    for (my $i=0; $i<$bytes; $i+=32) {
+	$code.="\tvmovdqa\t$ta,$i(%rsp)\n";
+    }
+    return $code."\tvzeroall\n";
+};
+
+########################################################################
+# void ossl_sm4_gfni_avx2_ecb_encrypt(const unsigned char *in,
+#                                     unsigned char *out, size_t len,
+#                                     const SM4_KEY *key, const int enc);
+#
+# |len| is a multiple of the block size.  Decryption runs the same rounds
+# with the round keys in reverse order, copied to the stack.
+{
+$code.=<<___;
+.globl	ossl_sm4_gfni_avx2_ecb_encrypt
+.type	ossl_sm4_gfni_avx2_ecb_encrypt,\@function,5
+.align	32
+ossl_sm4_gfni_avx2_ecb_encrypt:
+.cfi_startproc
+	endbranch
+	shr	\$4,$len
+	jz	.Lecb_done
+	push	%rbp
+.cfi_push	%rbp
+	mov	%rsp,%rbp
+.cfi_def_cfa_register	%rbp
+	sub	\$384,%rsp
+	and	\$-32,%rsp
+	mov	$key,%r11
+	test	${arg5}d,${arg5}d
+	jnz	.Lecb_16x_check
+
+	# 256(%rsp): the round keys in reverse order
+	xor	%eax,%eax
+.Lecb_reverse_keys:
+	mov	124($key),%r9d
+	mov	%r9d,256(%rsp,%rax,4)
+	sub	\$4,$key
+	inc	%eax
+	cmp	\$32,%eax
+	jb	.Lecb_reverse_keys
+	lea	256(%rsp),%r11
+
+.Lecb_16x_check:
+	cmp	\$16,$len
+	jb	.Lecb_tail
+.align	16
+.Lecb_16x:
+___
+$code.=load_16x($inp);
+$code.="\tcall\t_sm4_gfni_avx2_16x\n";
+for (my $i=0; $i<8; $i++) {
+    $code.="\tvmovdqu\t$O[$i],".(32*$i)."($out)\n";
+}
+$code.=<<___;
+	lea	256($inp),$inp
+	lea	256($out),$out
+	sub	\$16,$len
+	cmp	\$16,$len
+	jae	.Lecb_16x
+
+.Lecb_tail:
+	test	$len,$len
+	jz	.Lecb_wipe
+	# Run the last blocks from (%rsp)
+	shl	\$4,$len
+	xor	%eax,%eax
+	vpxor	$ta,$ta,$ta
+___
+for (my $i=0; $i<256; $i+=32) {
+    $code.="\tvmovdqa\t$ta,$i(%rsp)\n";
+}
+$code.=<<___;
+.Lecb_tail_in:
+	vmovdqu	($inp,%rax),%xmm0
+	vmovdqa	%xmm0,(%rsp,%rax)
+	add	\$16,%rax
+	cmp	$len,%rax
+	jb	.Lecb_tail_in
+___
+$code.=load_16x("%rsp");
+$code.="\tcall\t_sm4_gfni_avx2_16x\n";
+for (my $i=0; $i<8; $i++) {
+    $code.="\tvmovdqa\t$O[$i],".(32*$i)."(%rsp)\n";
+}
+$code.=<<___;
+	xor	%eax,%eax
+.Lecb_tail_out:
+	vmovdqa	(%rsp,%rax),%xmm0
+	vmovdqu	%xmm0,($out,%rax)
+	add	\$16,%rax
+	cmp	$len,%rax
+	jb	.Lecb_tail_out
+
+.Lecb_wipe:
+___
+$code.=&$wipe_stack(384);
+$code.=<<___;
+	mov	%rbp,%rsp
+.cfi_def_cfa_register	%rsp
+	pop	%rbp
+.cfi_pop	%rbp
+.Lecb_done:
+	ret
+.cfi_endproc
+.size	ossl_sm4_gfni_avx2_ecb_encrypt,.-ossl_sm4_gfni_avx2_ecb_encrypt
+___
+}
+
+########################################################################
+# void ossl_sm4_gfni_avx2_ctr32_encrypt_blocks(const unsigned char *in,
+#                                              unsigned char *out,
+#                                              size_t blocks,
+#                                              const void *key,
+#                                              const unsigned char ivec[16]);
+#
+# Like the other ctr32 functions, only the last 32 bits of the counter
+# are incremented.  The counter blocks are built transposed, so the
+# counter is the fourth word and the first three are the same in all of
+# them.
+{
+$code.=<<___;
+.globl	ossl_sm4_gfni_avx2_ctr32_encrypt_blocks
+.type	ossl_sm4_gfni_avx2_ctr32_encrypt_blocks,\@function,5
+.align	32
+ossl_sm4_gfni_avx2_ctr32_encrypt_blocks:
+.cfi_startproc
+	endbranch
+	test	$len,$len
+	jz	.Lctr_done
+	push	%rbp
+.cfi_push	%rbp
+	mov	%rsp,%rbp
+.cfi_def_cfa_register	%rbp
+	sub	\$288,%rsp
+	and	\$-32,%rsp
+	mov	$key,%r11
+
+	# 256(%rsp): the first three words of the counter block
+	mov	0($arg5),%eax
+	bswap	%eax
+	mov	%eax,256(%rsp)
+	mov	4($arg5),%eax
+	bswap	%eax
+	mov	%eax,260(%rsp)
+	mov	8($arg5),%eax
+	bswap	%eax
+	mov	%eax,264(%rsp)
+	mov	12($arg5),$ctr
+	bswap	$ctr
+
+.align	16
+.Lctr_16x:
+	vpbroadcastd	256(%rsp),$X[0]
+	vpbroadcastd	260(%rsp),$X[1]
+	vpbroadcastd	264(%rsp),$X[2]
+	vmovd	$ctr,%xmm3
+	vpbroadcastd	%xmm3,$X[3]
+	vmovdqa	$X[0],$X[4]
+	vmovdqa	$X[1],$X[5]
+	vmovdqa	$X[2],$X[6]
+	vpaddd	.Lctr_lanes+32(%rip),$X[3],$X[7]
+	vpaddd	.Lctr_lanes(%rip),$X[3],$X[3]
+	add	\$16,$ctr
+	call	_sm4_gfni_avx2_16x
+	cmp	\$16,$len
+	jb	.Lctr_tail
+___
+for (my $i=0; $i<8; $i++) {
+$code.=<<___;
+	vpxor	`32*$i`($inp),$O[$i],$O[$i]
+	vmovdqu	$O[$i],`32*$i`($out)
+___
+}
+$code.=<<___;
+	lea	256($inp),$inp
+	lea	256($out),$out
+	sub	\$16,$len
+	jnz	.Lctr_16x
+	jmp	.Lctr_wipe
+
+.Lctr_tail:
+___
+for (my $i=0; $i<8; $i++) {
+    $code.="\tvmovdqa\t$O[$i],".(32*$i)."(%rsp)\n";
+}
+$code.=<<___;
+	shl	\$4,$len
+	xor	%eax,%eax
+.Lctr_tail_xor:
+	vmovdqu	($inp,%rax),%xmm0
+	vpxor	(%rsp,%rax),%xmm0,%xmm0
+	vmovdqu	%xmm0,($out,%rax)
+	add	\$16,%rax
+	cmp	$len,%rax
+	jb	.Lctr_tail_xor
+
+.Lctr_wipe:
+___
+$code.=&$wipe_stack(288);
+$code.=<<___;
+	mov	%rbp,%rsp
+.cfi_def_cfa_register	%rsp
+	pop	%rbp
+.cfi_pop	%rbp
+.Lctr_done:
+	ret
+.cfi_endproc
+.size	ossl_sm4_gfni_avx2_ctr32_encrypt_blocks,.-ossl_sm4_gfni_avx2_ctr32_encrypt_blocks
+___
+}
+
+$code.=<<___;
+
+# int ossl_sm4_gfni_avx2_capable(void);
+.globl	ossl_sm4_gfni_avx2_capable
+.type	ossl_sm4_gfni_avx2_capable,\@abi-omnipotent
+.align	32
+ossl_sm4_gfni_avx2_capable:
+	mov	OPENSSL_ia32cap_P+8(%rip),%rcx
+	# gfni + avx2
+	mov	\$`1<<40|1<<5`,%rdx
+	xor	%eax,%eax
+	and	%rdx,%rcx
+	cmp	%rdx,%rcx
+	sete	%al
+	ret
+.size	ossl_sm4_gfni_avx2_capable,.-ossl_sm4_gfni_avx2_capable
+
+.align	64
+# The S-box is vgf2p8affineinvqb(0xd3, post) of vgf2p8affineqb(0xdd, pre)
+.Lsm4_pre:
+	.quad	0x954c648ca0ba98c8,0x954c648ca0ba98c8
+	.quad	0x954c648ca0ba98c8,0x954c648ca0ba98c8
+.Lsm4_post:
+	.quad	0xae6613672c629378,0xae6613672c629378
+	.quad	0xae6613672c629378,0xae6613672c629378
+.Lbswap32:
+	.byte	3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12
+	.byte	3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12
+.Lrol8:
+	.byte	3,0,1,2,7,4,5,6,11,8,9,10,15,12,13,14
+	.byte	3,0,1,2,7,4,5,6,11,8,9,10,15,12,13,14
+.Lrol16:
+	.byte	2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13
+	.byte	2,3,0,1,6,7,4,5,10,11,8,9,14,15,12,13
+.Lrol24:
+	.byte	1,2,3,0,5,6,7,4,9,10,11,8,13,14,15,12
+	.byte	1,2,3,0,5,6,7,4,9,10,11,8,13,14,15,12
+# Block number of each counter word, see _sm4_gfni_avx2_16x
+.Lctr_lanes:
+	.long	0,2,4,6,1,3,5,7
+	.long	8,10,12,14,9,11,13,15
+.asciz	"SM4-ECB and SM4-CTR for AVX2 and GFNI"
+___
+
+} else {
+
+# The assembler is too old, the functions are never called
+$code.=<<___;
+.globl	ossl_sm4_gfni_avx2_capable
+.type	ossl_sm4_gfni_avx2_capable,\@abi-omnipotent
+ossl_sm4_gfni_avx2_capable:
+	xor	%eax,%eax
+	ret
+.size	ossl_sm4_gfni_avx2_capable,.-ossl_sm4_gfni_avx2_capable
+
+.globl	ossl_sm4_gfni_avx2_ecb_encrypt
+.globl	ossl_sm4_gfni_avx2_ctr32_encrypt_blocks
+.type	ossl_sm4_gfni_avx2_ecb_encrypt,\@abi-omnipotent
+ossl_sm4_gfni_avx2_ecb_encrypt:
+ossl_sm4_gfni_avx2_ctr32_encrypt_blocks:
+	.byte	0x0f,0x0b	# ud2
+	ret
+.size	ossl_sm4_gfni_avx2_ecb_encrypt,.-ossl_sm4_gfni_avx2_ecb_encrypt
+___
+}
+
+$code =~ s/\`([^\`]*)\`/eval($1)/gem;
+print $code;
+close STDOUT or die "error closing STDOUT: $!";
@@ -9,6 +9,7 @@
 
 #include <openssl/crypto.h>
 #include "internal/cryptlib.h"
+#include "internal/rcu.h"
 
 #if !defined(OPENSSL_THREADS) || defined(CRYPTO_TDEBUG)
 
@@ -155,6 +156,82 @@ int CRYPTO_atomic_load_int(int *val, int *ret, CRYPTO_RWLOCK *lock)
     return 1;
 }
 
+struct rcu_cb_item {
+    rcu_cb_fn fn;
+    void *data;
+    struct rcu_cb_item *next;
+};
+
+struct rcu_lock_st {
+    struct rcu_cb_item *cb_items;
+};
+
+CRYPTO_RCU_LOCK *ossl_rcu_lock_new(void)
+{
+    return CRYPTO_zalloc(sizeof(CRYPTO_RCU_LOCK), NULL, 0);
+}
+
+void ossl_rcu_lock_free(CRYPTO_RCU_LOCK *lock)
+{
+    if (lock == NULL)
+        return;
+
+    ossl_synchronize_rcu(lock);
+    OPENSSL_free(lock);
+}
+
+unsigned int ossl_rcu_read_lock(CRYPTO_RCU_LOCK *lock)
+{
+    return 0;
+}
+
+void ossl_rcu_read_unlock(CRYPTO_RCU_LOCK *lock, unsigned int token)
+{
+}
+
+void ossl_rcu_write_lock(CRYPTO_RCU_LOCK *lock)
+{
+}
+
+void ossl_rcu_write_unlock(CRYPTO_RCU_LOCK *lock)
+{
+}
+
+int ossl_rcu_call(CRYPTO_RCU_LOCK *lock, rcu_cb_fn cb, void *data)
+{
+    struct rcu_cb_item *item;
+
+    if ((item = OPENSSL_malloc(sizeof(*item))) == NULL)
+        return 0;
+    item->fn = cb;
+    item->data = data;
+    item->next = lock->cb_items;
+    lock->cb_items = item;
+    return 1;
+}
+
+void ossl_synchronize_rcu(CRYPTO_RCU_LOCK *lock)
+{
+    struct rcu_cb_item *items = lock->cb_items, *next;
+
+    lock->cb_items = NULL;
+    for (; items != NULL; items = next) {
+        next = items->next;
+        items->fn(items->data);
+        OPENSSL_free(items);
+    }
+}
+
+void *ossl_rcu_uptr_deref(void **p)
+{
+    return *p;
+}
+
+void ossl_rcu_assign_uptr(void **p, void **v)
+{
+    *p = *v;
+}
+
 int openssl_init_fork_handlers(void)
 {
     return 0;
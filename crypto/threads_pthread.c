@@ -12,6 +12,7 @@
 
 #include <openssl/crypto.h>
 #include "internal/cryptlib.h"
+#include "internal/rcu.h"
 
 #if defined(__sun)
 # include <atomic.h>
@@ -34,9 +35,11 @@
 # if defined(OPENSSL_SYS_UNIX)
 #  include <sys/types.h>
 #  include <unistd.h>
+#  include <sched.h>
 #endif
 
 # include <assert.h>
+# include <string.h>
 
 # ifdef PTHREAD_RWLOCK_INITIALIZER
 #  define USE_RWLOCK
@@ -294,6 +297,228 @@ int CRYPTO_atomic_load_int(int *val, int *ret, CRYPTO_RWLOCK *lock)
     return 1;
 }
 
+/*
+ * Read-copy-update
+ *
+ * Readers announce themselves by incrementing a counter that belongs to the
+ * current grace period phase.  The counters are striped over several cache
+ * lines, indexed by a hash of the thread id, so that readers running on
+ * different cores rarely touch the same line.  A writer waiting for a grace
+ * period flips the phase and then waits for the counters of the old phase
+ * to drain.  A reader which raced with the flip, and so incremented a
+ * counter of the old phase, notices the phase change, backs out and retries.
+ *
+ * Without lockless atomics we fall back to a plain reader/writer lock, held
+ * by readers for their whole critical section and by writers while they
+ * are publishing.  Grace periods are then implicit.
+ */
+# if defined(__GNUC__) && defined(__ATOMIC_ACQ_REL) && !defined(BROKEN_CLANG_ATOMICS)
+#  define USE_RCU_ATOMICS
+# endif
+
+# define RCU_STRIPES        32
+# define RCU_CACHE_LINE     64
+
+struct rcu_stripe_st {
+    uint32_t readers[2];
+    unsigned char pad[RCU_CACHE_LINE - 2 * sizeof(uint32_t)];
+};
+
+struct rcu_cb_item {
+    rcu_cb_fn fn;
+    void *data;
+    struct rcu_cb_item *next;
+};
+
+struct rcu_lock_st {
+# ifdef USE_RCU_ATOMICS
+    struct rcu_stripe_st stripes[RCU_STRIPES];
+    uint32_t phase;
+# else
+    CRYPTO_RWLOCK *rw_lock;
+# endif
+    pthread_mutex_t write_lock;
+    /* Serialises grace periods and protects |cb_items| */
+    pthread_mutex_t sync_lock;
+    struct rcu_cb_item *cb_items;
+};
+
+CRYPTO_RCU_LOCK *ossl_rcu_lock_new(void)
+{
+    CRYPTO_RCU_LOCK *lock;
+
+    if ((lock = CRYPTO_zalloc(sizeof(*lock), NULL, 0)) == NULL)
+        return NULL;
+
+# ifndef USE_RCU_ATOMICS
+    if ((lock->rw_lock = CRYPTO_THREAD_lock_new()) == NULL) {
+        OPENSSL_free(lock);
+        return NULL;
+    }
+# endif
+    if (pthread_mutex_init(&lock->write_lock, NULL) != 0)
+        goto err;
+    if (pthread_mutex_init(&lock->sync_lock, NULL) != 0) {
+        pthread_mutex_destroy(&lock->write_lock);
+        goto err;
+    }
+    return lock;
+
+ err:
+# ifndef USE_RCU_ATOMICS
+    CRYPTO_THREAD_lock_free(lock->rw_lock);
+# endif
+    OPENSSL_free(lock);
+    return NULL;
+}
+
+void ossl_rcu_lock_free(CRYPTO_RCU_LOCK *lock)
+{
+    if (lock == NULL)
+        return;
+
+    /* Run any outstanding callbacks, nobody can be reading any more */
+    ossl_synchronize_rcu(lock);
+    pthread_mutex_destroy(&lock->sync_lock);
+    pthread_mutex_destroy(&lock->write_lock);
+# ifndef USE_RCU_ATOMICS
+    CRYPTO_THREAD_lock_free(lock->rw_lock);
+# endif
+    OPENSSL_free(lock);
+}
+
+# ifdef USE_RCU_ATOMICS
+static ossl_inline unsigned int rcu_stripe(void)
+{
+    pthread_t self = pthread_self();
+    uint64_t h = 0;
+
+    memcpy(&h, &self, sizeof(h) < sizeof(self) ? sizeof(h) : sizeof(self));
+    /* Fibonacci hashing, the low bits of a thread id are rarely random */
+    return (unsigned int)((h * 0x9E3779B97F4A7C15ULL) >> 59) % RCU_STRIPES;
+}
+# endif
+
+unsigned int ossl_rcu_read_lock(CRYPTO_RCU_LOCK *lock)
+{
+# ifdef USE_RCU_ATOMICS
+    unsigned int stripe = rcu_stripe();
+    uint32_t *readers = lock->stripes[stripe].readers;
+    uint32_t phase;
+
+    for (;;) {
+        phase = __atomic_load_n(&lock->phase, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&readers[phase], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&lock->phase, __ATOMIC_SEQ_CST) == phase)
+            break;
+        /* A writer flipped the phase under our feet, retry */
+        __atomic_sub_fetch(&readers[phase], 1, __ATOMIC_RELEASE);
+    }
+    return (stripe << 1) | phase;
+# else
+    if (!CRYPTO_THREAD_read_lock(lock->rw_lock))
+        assert(0);
+    return 0;
+# endif
+}
+
+void ossl_rcu_read_unlock(CRYPTO_RCU_LOCK *lock, unsigned int token)
+{
+# ifdef USE_RCU_ATOMICS
+    __atomic_sub_fetch(&lock->stripes[token >> 1].readers[token & 1], 1,
+                       __ATOMIC_RELEASE);
+# else
+    CRYPTO_THREAD_unlock(lock->rw_lock);
+# endif
+}
+
+void ossl_rcu_write_lock(CRYPTO_RCU_LOCK *lock)
+{
+    pthread_mutex_lock(&lock->write_lock);
+# ifndef USE_RCU_ATOMICS
+    if (!CRYPTO_THREAD_write_lock(lock->rw_lock))
+        assert(0);
+# endif
+}
+
+void ossl_rcu_write_unlock(CRYPTO_RCU_LOCK *lock)
+{
+# ifndef USE_RCU_ATOMICS
+    CRYPTO_THREAD_unlock(lock->rw_lock);
+# endif
+    pthread_mutex_unlock(&lock->write_lock);
+}
+
+int ossl_rcu_call(CRYPTO_RCU_LOCK *lock, rcu_cb_fn cb, void *data)
+{
+    struct rcu_cb_item *item;
+
+    if ((item = OPENSSL_malloc(sizeof(*item))) == NULL)
+        return 0;
+    item->fn = cb;
+    item->data = data;
+
+    if (pthread_mutex_lock(&lock->sync_lock) != 0) {
+        OPENSSL_free(item);
+        return 0;
+    }
+    item->next = lock->cb_items;
+    lock->cb_items = item;
+    pthread_mutex_unlock(&lock->sync_lock);
+    return 1;
+}
+
+void ossl_synchronize_rcu(CRYPTO_RCU_LOCK *lock)
+{
+    struct rcu_cb_item *items, *next;
+# ifdef USE_RCU_ATOMICS
+    uint32_t old;
+    size_t i;
+# endif
+
+    if (pthread_mutex_lock(&lock->sync_lock) != 0)
+        return;
+    items = lock->cb_items;
+    lock->cb_items = NULL;
+
+# ifdef USE_RCU_ATOMICS
+    old = __atomic_load_n(&lock->phase, __ATOMIC_RELAXED);
+    __atomic_store_n(&lock->phase, old ^ 1, __ATOMIC_SEQ_CST);
+    for (i = 0; i < RCU_STRIPES; i++)
+        while (__atomic_load_n(&lock->stripes[i].readers[old],
+                               __ATOMIC_ACQUIRE) != 0) {
+#  if defined(OPENSSL_SYS_UNIX)
+            sched_yield();
+#  endif
+        }
+# endif
+    pthread_mutex_unlock(&lock->sync_lock);
+
+    for (; items != NULL; items = next) {
+        next = items->next;
+        items->fn(items->data);
+        OPENSSL_free(items);
+    }
+}
+
+void *ossl_rcu_uptr_deref(void **p)
+{
+# ifdef USE_RCU_ATOMICS
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+# else
+    return *p;
+# endif
+}
+
+void ossl_rcu_assign_uptr(void **p, void **v)
+{
+# ifdef USE_RCU_ATOMICS
+    __atomic_store(p, v, __ATOMIC_RELEASE);
+# else
+    *p = *v;
+# endif
+}
+
 # ifndef FIPS_MODULE
 int openssl_init_fork_handlers(void)
 {
@@ -27,6 +27,7 @@
 #endif
 
 #include <openssl/crypto.h>
+#include "internal/rcu.h"
 
 #if defined(OPENSSL_THREADS) && !defined(CRYPTO_TDEBUG) && defined(OPENSSL_SYS_WINDOWS)
 
@@ -268,6 +269,138 @@ int CRYPTO_atomic_load_int(int *val, int *ret, CRYPTO_RWLOCK *lock)
 #endif
 }
 
+/*
+ * Read-copy-update, see threads_pthread.c for a description of the scheme.
+ * The Interlocked family of functions imply a full memory barrier.
+ */
+# define RCU_STRIPES        32
+# define RCU_CACHE_LINE     64
+
+struct rcu_stripe_st {
+    LONG readers[2];
+    unsigned char pad[RCU_CACHE_LINE - 2 * sizeof(LONG)];
+};
+
+struct rcu_cb_item {
+    rcu_cb_fn fn;
+    void *data;
+    struct rcu_cb_item *next;
+};
+
+struct rcu_lock_st {
+    struct rcu_stripe_st stripes[RCU_STRIPES];
+    LONG phase;
+    CRITICAL_SECTION write_lock;
+    /* Serialises grace periods and protects |cb_items| */
+    CRITICAL_SECTION sync_lock;
+    struct rcu_cb_item *cb_items;
+};
+
+CRYPTO_RCU_LOCK *ossl_rcu_lock_new(void)
+{
+    CRYPTO_RCU_LOCK *lock;
+
+    if ((lock = CRYPTO_zalloc(sizeof(*lock), NULL, 0)) == NULL)
+        return NULL;
+    InitializeCriticalSection(&lock->write_lock);
+    InitializeCriticalSection(&lock->sync_lock);
+    return lock;
+}
+
+void ossl_rcu_lock_free(CRYPTO_RCU_LOCK *lock)
+{
+    if (lock == NULL)
+        return;
+
+    ossl_synchronize_rcu(lock);
+    DeleteCriticalSection(&lock->sync_lock);
+    DeleteCriticalSection(&lock->write_lock);
+    OPENSSL_free(lock);
+}
+
+unsigned int ossl_rcu_read_lock(CRYPTO_RCU_LOCK *lock)
+{
+    unsigned int stripe = (unsigned int)(GetCurrentThreadId() * 2654435761U)
+                          >> 27;
+    LONG volatile *readers = lock->stripes[stripe].readers;
+    LONG phase;
+
+    for (;;) {
+        phase = InterlockedOr(&lock->phase, 0);
+        InterlockedIncrement(&readers[phase]);
+        if (InterlockedOr(&lock->phase, 0) == phase)
+            break;
+        /* A writer flipped the phase under our feet, retry */
+        InterlockedDecrement(&readers[phase]);
+    }
+    return (stripe << 1) | (unsigned int)phase;
+}
+
+void ossl_rcu_read_unlock(CRYPTO_RCU_LOCK *lock, unsigned int token)
+{
+    InterlockedDecrement(&lock->stripes[token >> 1].readers[token & 1]);
+}
+
+void ossl_rcu_write_lock(CRYPTO_RCU_LOCK *lock)
+{
+    EnterCriticalSection(&lock->write_lock);
+}
+
+void ossl_rcu_write_unlock(CRYPTO_RCU_LOCK *lock)
+{
+    LeaveCriticalSection(&lock->write_lock);
+}
+
+int ossl_rcu_call(CRYPTO_RCU_LOCK *lock, rcu_cb_fn cb, void *data)
+{
+    struct rcu_cb_item *item;
+
+    if ((item = OPENSSL_malloc(sizeof(*item))) == NULL)
+        return 0;
+    item->fn = cb;
+    item->data = data;
+
+    EnterCriticalSection(&lock->sync_lock);
+    item->next = lock->cb_items;
+    lock->cb_items = item;
+    LeaveCriticalSection(&lock->sync_lock);
+    return 1;
+}
+
+void ossl_synchronize_rcu(CRYPTO_RCU_LOCK *lock)
+{
+    struct rcu_cb_item *items, *next;
+    LONG old;
+    size_t i;
+
+    EnterCriticalSection(&lock->sync_lock);
+    items = lock->cb_items;
+    lock->cb_items = NULL;
+
+    old = InterlockedOr(&lock->phase, 0);
+    InterlockedExchange(&lock->phase, old ^ 1);
+    for (i = 0; i < RCU_STRIPES; i++)
+        while (InterlockedOr(&lock->stripes[i].readers[old], 0) != 0)
+            SwitchToThread();
+    LeaveCriticalSection(&lock->sync_lock);
+
+    for (; items != NULL; items = next) {
+        next = items->next;
+        items->fn(items->data);
+        OPENSSL_free(items);
+    }
+}
+
+void *ossl_rcu_uptr_deref(void **p)
+{
+    return InterlockedCompareExchangePointer(p, NULL, NULL);
+}
+
+void ossl_rcu_assign_uptr(void **p, void **v)
+{
+    InterlockedExchangePointer(p, *v);
+}
+
 int openssl_init_fork_handlers(void)
 {
     return 0;
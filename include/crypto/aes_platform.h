@@ -264,6 +264,33 @@ void gcm_ghash_avx(u64 Xi[2], const u128 Htable[16], const u8 *in, size_t len);
                                 ctx->gcm.funcs.ghash == gcm_ghash_avx)
 #  endif
 
+#  ifdef AES_VAES_ASM
+/*
+ * AVX512 VAES versions of the bulk functions.  Loading the key schedule
+ * into registers makes them slower than the AES-NI ones for fewer than
+ * AES_VAES_MIN_BLOCKS blocks.  The XTS functions take the encrypted tweak
+ * and leave the next one in |tweak|, ciphertext stealing is up to the
+ * caller.
+ */
+#   define AES_VAES_CAPABLE        ossl_aes_vaes_avx512_capable()
+#   define AES_VAES_MIN_BLOCKS     4
+
+int ossl_aes_vaes_avx512_capable(void);
+void ossl_aes_ctr32_encrypt_blocks_avx512(const unsigned char *in,
+                                          unsigned char *out,
+                                          size_t blocks, const void *key,
+                                          const unsigned char ivec[16]);
+void ossl_aes_cbc_decrypt_avx512(const unsigned char *in, unsigned char *out,
+                                 size_t blocks, const AES_KEY *key,
+                                 unsigned char ivec[16]);
+void ossl_aes_xts_encrypt_avx512(const unsigned char *in, unsigned char *out,
+                                 size_t blocks, const AES_KEY *key1,
+                                 unsigned char tweak[16]);
+void ossl_aes_xts_decrypt_avx512(const unsigned char *in, unsigned char *out,
+                                 size_t blocks, const AES_KEY *key1,
+                                 unsigned char tweak[16]);
+#  endif
+
 
 # elif defined(AES_ASM) && (defined(__sparc) || defined(__sparc__))
 
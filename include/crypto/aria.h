@@ -14,6 +14,7 @@
 # define OSSL_CRYPTO_ARIA_H
 # pragma once
 
+# include <stddef.h>
 # include <openssl/opensslconf.h>
 
 # ifdef OPENSSL_NO_ARIA
@@ -48,4 +49,24 @@ int ossl_aria_set_decrypt_key(const unsigned char *userKey, const int bits,
 void ossl_aria_encrypt(const unsigned char *in, unsigned char *out,
                        const ARIA_KEY *key);
 
+# if defined(ARIA_GFNI_ASM) && defined(OPENSSL_CPUID_OBJ)
+/*
+ * AVX2 and GFNI versions of the bulk functions.  The ECB one takes the
+ * encryption or the decryption key schedule and ignores |enc|.  They
+ * process sixteen blocks at a time, so they are slower than the C code for
+ * fewer than ARIA_GFNI_MIN_BLOCKS blocks.
+ */
+#  define ARIA_GFNI_AVX2_CAPABLE ossl_aria_gfni_avx2_capable()
+#  define ARIA_GFNI_MIN_BLOCKS 4
+
+int ossl_aria_gfni_avx2_capable(void);
+void ossl_aria_gfni_avx2_ecb_encrypt(const unsigned char *in,
+                                     unsigned char *out, size_t length,
+                                     const ARIA_KEY *key, const int enc);
+void ossl_aria_gfni_avx2_ctr32_encrypt_blocks(const unsigned char *in,
+                                              unsigned char *out, size_t len,
+                                              const void *key,
+                                              const unsigned char ivec[16]);
+# endif
+
 #endif
@@ -114,6 +114,13 @@ int ossl_bn_rsa_fips186_4_derive_prime(BIGNUM *Y, BIGNUM *X, const BIGNUM *Xin,
 
 OSSL_LIB_CTX *ossl_bn_get_libctx(BN_CTX *ctx);
 
+int ossl_bn_mod_exp_mont_consttime_x4(BIGNUM *const rr[4],
+                                      const BIGNUM *const a[4],
+                                      const BIGNUM *const p[4],
+                                      const BIGNUM *const m[4],
+                                      BN_MONT_CTX *const mont[4],
+                                      BN_CTX *ctx);
+
 extern const BIGNUM ossl_bn_inv_sqrt_2;
 
 #if defined(OPENSSL_SYS_LINUX) && !defined(FIPS_MODULE) && defined (__s390x__)
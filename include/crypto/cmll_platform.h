@@ -46,6 +46,29 @@ void cmll256_t4_ctr32_encrypt(const unsigned char *in, unsigned char *out,
                               unsigned char *ivec);
 #  endif /* OPENSSL_NO_CAMELLIA */
 
-# endif /* CMLL_ASM && sparc */
+# elif defined(CMLL_GFNI_ASM) && defined(OPENSSL_CPUID_OBJ)
+
+#  ifndef OPENSSL_NO_CAMELLIA
+/*
+ * AVX2 and GFNI versions of the bulk functions, on the key schedule of
+ * Camellia_set_key.  They process sixteen blocks at a time, so they are
+ * slower than cmll-x86_64 for fewer than CMLL_GFNI_MIN_BLOCKS blocks.
+ */
+#   define CMLL_GFNI_AVX2_CAPABLE  ossl_cmll_gfni_avx2_capable()
+#   define CMLL_GFNI_MIN_BLOCKS    4
+#   include <openssl/camellia.h>
+
+int ossl_cmll_gfni_avx2_capable(void);
+void ossl_cmll_gfni_avx2_ecb_encrypt(const unsigned char *in,
+                                     unsigned char *out, size_t length,
+                                     const CAMELLIA_KEY *key, const int enc);
+void ossl_cmll_gfni_avx2_ctr32_encrypt_blocks(const unsigned char *in,
+                                              unsigned char *out,
+                                              size_t blocks,
+                                              const void *key,
+                                              const unsigned char ivec[16]);
+#  endif /* OPENSSL_NO_CAMELLIA */
+
+# endif /* CMLL_ASM && sparc, CMLL_GFNI_ASM */
 
 #endif /* OSSL_CRYPTO_CIPHERMODE_PLATFORM_H */
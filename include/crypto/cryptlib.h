@@ -32,6 +32,8 @@ void ossl_ctx_thread_stop(OSSL_LIB_CTX *ctx);
 
 void ossl_trace_cleanup(void);
 void ossl_malloc_setup_failures(void);
+void ossl_slab_thread_stop(void);
+void ossl_slab_cleanup(void);
 
 int ossl_crypto_alloc_ex_data_intern(int class_index, void *obj,
                                      CRYPTO_EX_DATA *ad, int idx);
@@ -1,5 +1,5 @@
 /*
- * Copyright 2018-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2018-2023 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -102,5 +102,12 @@ int ossl_ecdsa_deterministic_sign(const unsigned char *dgst, int dlen,
                                   EC_KEY *eckey, unsigned int nonce_type,
                                   const char *digestname,
                                   OSSL_LIB_CTX *libctx, const char *propq);
+int ossl_ecdsa_sign_setup_batch(EC_KEY *const eckey[],
+                                const unsigned char *const dgst[],
+                                const int dlen[], BIGNUM *kinv[], BIGNUM *r[],
+                                size_t num);
+int ossl_ecdh_compute_key_batch(unsigned char *const out[], size_t outlen[],
+                                const EC_POINT *const pub_key[],
+                                EC_KEY *const ecdh[], size_t num);
 # endif /* OPENSSL_NO_EC */
 #endif
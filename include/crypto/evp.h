@@ -274,6 +274,7 @@ struct evp_md_st {
     OSSL_FUNC_digest_update_fn *dupdate;
     OSSL_FUNC_digest_final_fn *dfinal;
     OSSL_FUNC_digest_digest_fn *digest;
+    OSSL_FUNC_digest_batch_fn *batch;
     OSSL_FUNC_digest_freectx_fn *freectx;
     OSSL_FUNC_digest_dupctx_fn *dupctx;
     OSSL_FUNC_digest_get_params_fn *get_params;
@@ -895,6 +896,7 @@ int evp_pkey_ctx_use_cached_data(EVP_PKEY_CTX *ctx);
 # endif /* !defined(FIPS_MODULE) */
 
 int evp_method_store_cache_flush(OSSL_LIB_CTX *libctx);
+int evp_method_store_freeze(OSSL_LIB_CTX *libctx, const char *propq);
 int evp_method_store_remove_all_provided(const OSSL_PROVIDER *prov);
 
 int evp_default_properties_enable_fips_int(OSSL_LIB_CTX *libctx, int enable,
@@ -144,6 +144,11 @@ void ossl_gcm_ghash_4bit(u64 Xi[2], const u128 Htable[16],
                          const u8 *inp, size_t len);
 void ossl_gcm_gmult_4bit(u64 Xi[2], const u128 Htable[16]);
 
+/* Processing a message in pieces on copies of a GCM128_CONTEXT */
+void ossl_gcm128_mul_hpow(u64 X[2], const u64 H[2], u64 n);
+void ossl_gcm128_split(GCM128_CONTEXT *part, size_t offset);
+int ossl_gcm128_join(GCM128_CONTEXT *ctx, GCM128_CONTEXT *part, size_t len);
+
 /*
  * The maximum permitted number of cipher blocks per data unit in XTS mode.
  * Reference IEEE Std 1619-2018.
@@ -1,5 +1,5 @@
 /*
- * Copyright 2019-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2019-2023 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -108,6 +108,11 @@ int ossl_rsa_verify(int dtype, const unsigned char *m,
 
 const unsigned char *ossl_rsa_digestinfo_encoding(int md_nid, size_t *len);
 
+int ossl_rsa_private_encrypt_batch(size_t num, const int flen[],
+                                   const unsigned char *const from[],
+                                   unsigned char *const to[],
+                                   RSA *const rsa[], int padding, int ret[]);
+
 extern const char *ossl_rsa_mp_factor_names[];
 extern const char *ossl_rsa_mp_exp_names[];
 extern const char *ossl_rsa_mp_coeff_names[];
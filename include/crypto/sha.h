@@ -20,4 +20,13 @@ int sha512_256_init(SHA512_CTX *);
 int ossl_sha1_ctrl(SHA_CTX *ctx, int cmd, int mslen, void *ms);
 unsigned char *ossl_sha1(const unsigned char *d, size_t n, unsigned char *md);
 
+int ossl_sha1_batch(const SHA_CTX *init, const unsigned char *const in[],
+                    const size_t inl[], unsigned char *const md[], size_t num);
+int ossl_sha256_batch(const SHA256_CTX *init, const unsigned char *const in[],
+                      const size_t inl[], unsigned char *const md[],
+                      size_t num);
+int ossl_sha512_batch(const SHA512_CTX *init, const unsigned char *const in[],
+                      const size_t inl[], unsigned char *const md[],
+                      size_t num);
+
 #endif
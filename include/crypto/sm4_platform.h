@@ -38,6 +38,14 @@ static inline int vpsm4_ex_capable(void)
 #   define HWSM4_cbc_encrypt sm4_v8_cbc_encrypt
 #   define HWSM4_ecb_encrypt sm4_v8_ecb_encrypt
 #   define HWSM4_ctr32_encrypt_blocks sm4_v8_ctr32_encrypt_blocks
+#  elif defined(SM4_GFNI_ASM)
+/*
+ * AVX2 and GFNI versions of the bulk functions, on the key schedule of
+ * ossl_sm4_set_key.  They process sixteen blocks at a time, so they are
+ * slower than the C code for fewer than SM4_GFNI_MIN_BLOCKS blocks.
+ */
+#   define SM4_GFNI_AVX2_CAPABLE ossl_sm4_gfni_avx2_capable()
+#   define SM4_GFNI_MIN_BLOCKS 4
 #  endif
 # endif /* OPENSSL_CPUID_OBJ */
 
@@ -108,4 +116,15 @@ void vpsm4_ex_xts_encrypt_gb(const unsigned char *in, unsigned char *out,
                              const int enc);
 # endif /* VPSM4_EX_CAPABLE */
 
+# ifdef SM4_GFNI_AVX2_CAPABLE
+int ossl_sm4_gfni_avx2_capable(void);
+void ossl_sm4_gfni_avx2_ecb_encrypt(const unsigned char *in,
+                                    unsigned char *out, size_t length,
+                                    const SM4_KEY *key, const int enc);
+void ossl_sm4_gfni_avx2_ctr32_encrypt_blocks(const unsigned char *in,
+                                             unsigned char *out, size_t len,
+                                             const void *key,
+                                             const unsigned char ivec[16]);
+# endif /* SM4_GFNI_AVX2_CAPABLE */
+
 #endif /* OSSL_SM4_PLATFORM_H */
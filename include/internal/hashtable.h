@@ -0,0 +1,142 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#ifndef OSSL_INTERNAL_HASHTABLE_H
+# define OSSL_INTERNAL_HASHTABLE_H
+# pragma once
+
+# include <stddef.h>
+# include <openssl/e_os2.h>
+
+/*
+ * An open addressing hash table using linear probing.
+ *
+ * The table stores pointers to items along with their hash values in one
+ * flat array, so a lookup touches a single cache line in the common case
+ * and never allocates.  It owns the items stored in it: removed or replaced
+ * items are released with the free function passed to ossl_ht_new().  The
+ * exception is ossl_ht_remove(), which hands the item back to the caller.
+ *
+ * Items must be at least two byte aligned, which is always the case for
+ * heap allocated structures.
+ *
+ * Tables created with OSSL_HT_LOCKLESS_READS can be searched while another
+ * thread modifies them.  Readers bracket their lookups, and their use of
+ * the items found, with ossl_ht_read_lock() and ossl_ht_read_unlock().
+ * Modifications must still be serialised by the caller, and freeing of
+ * removed items is deferred until no reader can see them any more.  A
+ * thread must not modify a table while it holds a read lock on it.  Items
+ * taken out with ossl_ht_remove() may still be in use by readers, so the
+ * caller has to keep them until that can no longer be the case.
+ */
+
+# define HASHTABLE_OF(type) OSSL_HASHTABLE_ ## type
+
+# define OSSL_HT_LOCKLESS_READS     0x01
+
+typedef struct ossl_ht_st OSSL_HT;
+
+typedef unsigned long (*OSSL_HT_HASH_FN)(const void *item);
+typedef int (*OSSL_HT_CMP_FN)(const void *a, const void *b);
+typedef void (*OSSL_HT_FREE_FN)(void *item);
+
+OSSL_HT *ossl_ht_new(OSSL_HT_HASH_FN hash, OSSL_HT_CMP_FN cmp,
+                     OSSL_HT_FREE_FN free_fn, uint32_t flags);
+void ossl_ht_free(OSSL_HT *ht);
+int ossl_ht_insert(OSSL_HT *ht, void *item);
+void *ossl_ht_retrieve(const OSSL_HT *ht, const void *key);
+int ossl_ht_delete(OSSL_HT *ht, const void *key);
+void *ossl_ht_remove(OSSL_HT *ht, const void *key);
+size_t ossl_ht_filter(OSSL_HT *ht, int (*keep)(void *item, void *arg),
+                      void *arg);
+void ossl_ht_flush(OSSL_HT *ht);
+size_t ossl_ht_num_items(const OSSL_HT *ht);
+void ossl_ht_doall_arg(const OSSL_HT *ht, void (*fn)(void *item, void *arg),
+                       void *arg);
+unsigned int ossl_ht_read_lock(const OSSL_HT *ht);
+void ossl_ht_read_unlock(const OSSL_HT *ht, unsigned int token);
+
+# define DEFINE_HASHTABLE_OF_INTERNAL(type, ctype)                           \
+    typedef struct ossl_hashtable_st_ ## type HASHTABLE_OF(type);           \
+    static ossl_unused ossl_inline HASHTABLE_OF(type) *                     \
+    ossl_ht_##type##_new(unsigned long (*hash)(const ctype *),              \
+                         int (*cmp)(const ctype *, const ctype *),          \
+                         void (*free_fn)(ctype *), uint32_t flags)          \
+    {                                                                       \
+        return (HASHTABLE_OF(type) *)ossl_ht_new((OSSL_HT_HASH_FN)hash,     \
+                                                 (OSSL_HT_CMP_FN)cmp,       \
+                                                 (OSSL_HT_FREE_FN)free_fn,  \
+                                                 flags);                    \
+    }                                                                       \
+    static ossl_unused ossl_inline void                                     \
+    ossl_ht_##type##_free(HASHTABLE_OF(type) *ht)                           \
+    {                                                                       \
+        ossl_ht_free((OSSL_HT *)ht);                                        \
+    }                                                                       \
+    static ossl_unused ossl_inline int                                      \
+    ossl_ht_##type##_insert(HASHTABLE_OF(type) *ht, ctype *item)            \
+    {                                                                       \
+        return ossl_ht_insert((OSSL_HT *)ht, (void *)item);                 \
+    }                                                                       \
+    static ossl_unused ossl_inline ctype *                                  \
+    ossl_ht_##type##_retrieve(const HASHTABLE_OF(type) *ht,                 \
+                              const ctype *key)                             \
+    {                                                                       \
+        return (ctype *)ossl_ht_retrieve((const OSSL_HT *)ht, key);         \
+    }                                                                       \
+    static ossl_unused ossl_inline int                                      \
+    ossl_ht_##type##_delete(HASHTABLE_OF(type) *ht, const ctype *key)       \
+    {                                                                       \
+        return ossl_ht_delete((OSSL_HT *)ht, key);                          \
+    }                                                                       \
+    static ossl_unused ossl_inline ctype *                                  \
+    ossl_ht_##type##_remove(HASHTABLE_OF(type) *ht, const ctype *key)       \
+    {                                                                       \
+        return (ctype *)ossl_ht_remove((OSSL_HT *)ht, key);                 \
+    }                                                                       \
+    static ossl_unused ossl_inline size_t                                   \
+    ossl_ht_##type##_filter(HASHTABLE_OF(type) *ht,                         \
+                            int (*keep)(ctype *, void *), void *arg)        \
+    {                                                                       \
+        return ossl_ht_filter((OSSL_HT *)ht,                                \
+                              (int (*)(void *, void *))keep, arg);          \
+    }                                                                       \
+    static ossl_unused ossl_inline void                                     \
+    ossl_ht_##type##_flush(HASHTABLE_OF(type) *ht)                          \
+    {                                                                       \
+        ossl_ht_flush((OSSL_HT *)ht);                                       \
+    }                                                                       \
+    static ossl_unused ossl_inline size_t                                   \
+    ossl_ht_##type##_num(const HASHTABLE_OF(type) *ht)                      \
+    {                                                                       \
+        return ossl_ht_num_items((const OSSL_HT *)ht);                      \
+    }                                                                       \
+    static ossl_unused ossl_inline void                                     \
+    ossl_ht_##type##_doall_arg(const HASHTABLE_OF(type) *ht,                \
+                               void (*fn)(ctype *, void *), void *arg)      \
+    {                                                                       \
+        ossl_ht_doall_arg((const OSSL_HT *)ht,                              \
+                          (void (*)(void *, void *))fn, arg);               \
+    }                                                                       \
+    static ossl_unused ossl_inline unsigned int                             \
+    ossl_ht_##type##_read_lock(const HASHTABLE_OF(type) *ht)                \
+    {                                                                       \
+        return ossl_ht_read_lock((const OSSL_HT *)ht);                      \
+    }                                                                       \
+    static ossl_unused ossl_inline void                                     \
+    ossl_ht_##type##_read_unlock(const HASHTABLE_OF(type) *ht,              \
+                                 unsigned int token)                        \
+    {                                                                       \
+        ossl_ht_read_unlock((const OSSL_HT *)ht, token);                    \
+    }                                                                       \
+    struct ossl_hashtable_st_ ## type
+
+# define DEFINE_HASHTABLE_OF(type) DEFINE_HASHTABLE_OF_INTERNAL(type, type)
+
+#endif
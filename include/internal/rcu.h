@@ -0,0 +1,60 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#ifndef OSSL_INTERNAL_RCU_H
+# define OSSL_INTERNAL_RCU_H
+# pragma once
+
+/*
+ * A read-copy-update lock.
+ *
+ * Readers never block and never write to memory shared with other
+ * readers beyond a per-stripe counter.  They bracket their accesses to
+ * RCU protected pointers with ossl_rcu_read_lock() / ossl_rcu_read_unlock()
+ * and dereference those pointers with ossl_rcu_deref().
+ *
+ * Writers serialise among themselves with ossl_rcu_write_lock(), build
+ * a new version of the data, publish it with ossl_rcu_assign_ptr() and
+ * hand the old version to ossl_rcu_call().  After ossl_rcu_write_unlock()
+ * they call ossl_synchronize_rcu() which waits until every reader that
+ * could still see the old version has left its read side critical section
+ * and then runs the queued callbacks.
+ *
+ * A thread must not call ossl_synchronize_rcu() while it holds a read lock
+ * or the write lock on the same RCU lock.
+ */
+
+typedef void (*rcu_cb_fn)(void *data);
+
+typedef struct rcu_lock_st CRYPTO_RCU_LOCK;
+
+CRYPTO_RCU_LOCK *ossl_rcu_lock_new(void);
+void ossl_rcu_lock_free(CRYPTO_RCU_LOCK *lock);
+
+/*
+ * ossl_rcu_read_lock() returns a token that must be handed back to the
+ * matching ossl_rcu_read_unlock().
+ */
+unsigned int ossl_rcu_read_lock(CRYPTO_RCU_LOCK *lock);
+void ossl_rcu_read_unlock(CRYPTO_RCU_LOCK *lock, unsigned int token);
+
+void ossl_rcu_write_lock(CRYPTO_RCU_LOCK *lock);
+void ossl_rcu_write_unlock(CRYPTO_RCU_LOCK *lock);
+
+int ossl_rcu_call(CRYPTO_RCU_LOCK *lock, rcu_cb_fn cb, void *data);
+void ossl_synchronize_rcu(CRYPTO_RCU_LOCK *lock);
+
+void *ossl_rcu_uptr_deref(void **p);
+void ossl_rcu_assign_uptr(void **p, void **v);
+
+# define ossl_rcu_deref(p) ossl_rcu_uptr_deref((void **)(p))
+# define ossl_rcu_assign_ptr(p, v) ossl_rcu_assign_uptr((void **)(p), \
+                                                        (void **)(v))
+
+#endif
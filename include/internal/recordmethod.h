@@ -57,6 +57,9 @@ typedef struct ossl_record_layer_st OSSL_RECORD_LAYER;
 # define OSSL_RECORD_RETURN_FATAL            -2
 # define OSSL_RECORD_RETURN_EOF              -3
 
+/* The most records that may be passed to write_records_iov() at once */
+# define OSSL_RECORD_IOV_MAX_RECORDS          8
+
 /*
  * Template for creating a record. A record consists of the |type| of data it
  * will contain (e.g. alert, handshake, application data, etc) along with a
@@ -216,6 +219,26 @@ struct ossl_record_method_st {
      */
     int (*retry_write_records)(OSSL_RECORD_LAYER *rl);
 
+    /*
+     * Write |len| bytes of data of type |type|, starting |off| bytes into the
+     * data described by the |iovcnt| buffers in |iov|, as records of up to
+     * |fraglen| bytes each. A record may be filled from several buffers, and
+     * all the records are written out together. The caller makes sure that
+     * |len| is no more than OSSL_RECORD_IOV_MAX_RECORDS records. Retries and the
+     * lifetime of the buffers are handled as for write_records().
+     * May be NULL if the record layer does not support this.
+     * Returns:
+     *  1 on success
+     *  0 on retry
+     * -1 if the record layer can't write these records this way, in which
+     *    case nothing was written and write_records() should be used
+     * -2 on fatal failure
+     */
+    int (*write_records_iov)(OSSL_RECORD_LAYER *rl, int type,
+                             unsigned int version, const SSL_IOVEC *iov,
+                             size_t iovcnt, size_t off, size_t len,
+                             size_t fraglen);
+
     /*
      * Read a record and return the record layer version and record type in
      * the |rversion| and |type| parameters. |*data| is set to point to a
@@ -48,7 +48,19 @@ int ossl_keccak_kmac_init(KECCAK1600_CTX *ctx, unsigned char pad,
 int ossl_sha3_update(KECCAK1600_CTX *ctx, const void *_inp, size_t len);
 int ossl_sha3_final(unsigned char *md, KECCAK1600_CTX *ctx);
 
+int ossl_sha3_update_x4(KECCAK1600_CTX *ctx[4], const unsigned char *inp[4],
+                        size_t len);
+int ossl_sha3_final_x4(unsigned char *md[4], KECCAK1600_CTX *ctx[4]);
+int ossl_sha3_batch(const KECCAK1600_CTX *init,
+                    const unsigned char *const in[], const size_t inl[],
+                    unsigned char *const md[], size_t num);
+
 size_t SHA3_absorb(uint64_t A[5][5], const unsigned char *inp, size_t len,
                    size_t r);
+void SHA3_squeeze(uint64_t A[5][5], unsigned char *out, size_t len, size_t r);
+size_t SHA3_absorb_x4(uint64_t (*A[4])[5], const unsigned char *inp[4],
+                      size_t len, size_t r);
+void SHA3_squeeze_x4(uint64_t (*A[4])[5], unsigned char *out[4], size_t len,
+                     size_t r);
 
 #endif /* OSSL_INTERNAL_SHA3_H */
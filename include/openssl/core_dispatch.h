@@ -283,6 +283,7 @@ OSSL_CORE_MAKE_FUNC(int, provider_self_test, (void *provctx))
 # define OSSL_FUNC_DIGEST_GETTABLE_PARAMS           11
 # define OSSL_FUNC_DIGEST_SETTABLE_CTX_PARAMS       12
 # define OSSL_FUNC_DIGEST_GETTABLE_CTX_PARAMS       13
+# define OSSL_FUNC_DIGEST_BATCH                     14
 
 OSSL_CORE_MAKE_FUNC(void *, digest_newctx, (void *provctx))
 OSSL_CORE_MAKE_FUNC(int, digest_init, (void *dctx, const OSSL_PARAM params[]))
@@ -294,6 +295,10 @@ OSSL_CORE_MAKE_FUNC(int, digest_final,
 OSSL_CORE_MAKE_FUNC(int, digest_digest,
                     (void *provctx, const unsigned char *in, size_t inl,
                      unsigned char *out, size_t *outl, size_t outsz))
+OSSL_CORE_MAKE_FUNC(int, digest_batch,
+                    (void *provctx, const unsigned char *const in[],
+                     const size_t inl[], unsigned char *const out[],
+                     size_t num, size_t *outl, size_t outsz))
 
 OSSL_CORE_MAKE_FUNC(void, digest_freectx, (void *dctx))
 OSSL_CORE_MAKE_FUNC(void *, digest_dupctx, (void *dctx))
@@ -664,6 +669,7 @@ OSSL_CORE_MAKE_FUNC(const OSSL_PARAM *, keymgmt_export_types_ex,
 # define OSSL_FUNC_KEYEXCH_SETTABLE_CTX_PARAMS         8
 # define OSSL_FUNC_KEYEXCH_GET_CTX_PARAMS              9
 # define OSSL_FUNC_KEYEXCH_GETTABLE_CTX_PARAMS        10
+# define OSSL_FUNC_KEYEXCH_DERIVE_BATCH               11
 
 OSSL_CORE_MAKE_FUNC(void *, keyexch_newctx, (void *provctx))
 OSSL_CORE_MAKE_FUNC(int, keyexch_init, (void *ctx, void *provkey,
@@ -681,6 +687,10 @@ OSSL_CORE_MAKE_FUNC(int, keyexch_get_ctx_params, (void *ctx,
                                                      OSSL_PARAM params[]))
 OSSL_CORE_MAKE_FUNC(const OSSL_PARAM *, keyexch_gettable_ctx_params,
                     (void *ctx, void *provctx))
+OSSL_CORE_MAKE_FUNC(int, keyexch_derive_batch,
+                    (void *ctx, void *const provkeys[],
+                     void *const provpeers[], unsigned char *const secret[],
+                     size_t secretlen[], const size_t outlen[], size_t num))
 
 /* Signature */
 
@@ -709,6 +719,8 @@ OSSL_CORE_MAKE_FUNC(const OSSL_PARAM *, keyexch_gettable_ctx_params,
 # define OSSL_FUNC_SIGNATURE_GETTABLE_CTX_MD_PARAMS 23
 # define OSSL_FUNC_SIGNATURE_SET_CTX_MD_PARAMS      24
 # define OSSL_FUNC_SIGNATURE_SETTABLE_CTX_MD_PARAMS 25
+# define OSSL_FUNC_SIGNATURE_VERIFY_BATCH           26
+# define OSSL_FUNC_SIGNATURE_SIGN_BATCH             27
 
 OSSL_CORE_MAKE_FUNC(void *, signature_newctx, (void *provctx,
                                                   const char *propq))
@@ -769,6 +781,17 @@ OSSL_CORE_MAKE_FUNC(int, signature_set_ctx_md_params,
                     (void *ctx, const OSSL_PARAM params[]))
 OSSL_CORE_MAKE_FUNC(const OSSL_PARAM *, signature_settable_ctx_md_params,
                     (void *ctx))
+OSSL_CORE_MAKE_FUNC(int, signature_verify_batch,
+                    (void *ctx, void *const provkeys[],
+                     const unsigned char *const sig[], const size_t siglen[],
+                     const unsigned char *const tbs[], const size_t tbslen[],
+                     size_t num))
+OSSL_CORE_MAKE_FUNC(int, signature_sign_batch,
+                    (void *ctx, void *const provkeys[],
+                     unsigned char *const sig[], size_t siglen[],
+                     const size_t sigsize[],
+                     const unsigned char *const tbs[], const size_t tbslen[],
+                     size_t num))
 
 
 /* Asymmetric Ciphers */
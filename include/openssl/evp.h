@@ -353,6 +353,8 @@ OSSL_DEPRECATEDIN_3_0 int
 /* For supplementary wrap cipher support */
 # define         EVP_CIPH_FLAG_GET_WRAP_CIPHER   0x4000000
 # define         EVP_CIPH_FLAG_INVERSE_CIPHER    0x8000000
+/* Cipher can seal several TLS 1.3 records in one operation */
+# define         EVP_CIPH_FLAG_TLS13_MULTIREC    0x10000000
 
 /*
  * Cipher context flag to indicate we can handle wrap mode: if allowed in
@@ -722,6 +724,17 @@ __owur int EVP_Q_digest(OSSL_LIB_CTX *libctx, const char *name,
                         const char *propq, const void *data, size_t datalen,
                         unsigned char *md, size_t *mdlen);
 
+/* One message of EVP_DigestBatch() and where its digest goes */
+typedef struct evp_digest_batch_item_st {
+    const void *data;
+    size_t datalen;
+    unsigned char *md;
+} EVP_DIGEST_BATCH_ITEM;
+
+__owur int EVP_DigestBatch(const EVP_DIGEST_BATCH_ITEM *items, size_t num,
+                           unsigned int *size, const EVP_MD *type,
+                           ENGINE *impl);
+
 __owur int EVP_MD_CTX_copy(EVP_MD_CTX *out, const EVP_MD_CTX *in);
 __owur int EVP_DigestInit(EVP_MD_CTX *ctx, const EVP_MD *type);
 __owur int EVP_DigestFinal(EVP_MD_CTX *ctx, unsigned char *md,
@@ -1897,11 +1910,44 @@ int EVP_PKEY_sign_init_ex(EVP_PKEY_CTX *ctx, const OSSL_PARAM params[]);
 int EVP_PKEY_sign(EVP_PKEY_CTX *ctx,
                   unsigned char *sig, size_t *siglen,
                   const unsigned char *tbs, size_t tbslen);
+
+/*
+ * One signature made by EVP_PKEY_sign_batch() with |pkey| or, if that is
+ * NULL, the key of the context.  |siglen| is the size of the |sig| buffer
+ * on input and the length of the signature on output.
+ */
+typedef struct evp_pkey_sign_batch_item_st {
+    EVP_PKEY *pkey;
+    unsigned char *sig;
+    size_t siglen;
+    const unsigned char *tbs;
+    size_t tbslen;
+} EVP_PKEY_SIGN_BATCH_ITEM;
+
+int EVP_PKEY_sign_batch(EVP_PKEY_CTX *ctx,
+                        EVP_PKEY_SIGN_BATCH_ITEM *items, size_t num);
+
 int EVP_PKEY_verify_init(EVP_PKEY_CTX *ctx);
 int EVP_PKEY_verify_init_ex(EVP_PKEY_CTX *ctx, const OSSL_PARAM params[]);
 int EVP_PKEY_verify(EVP_PKEY_CTX *ctx,
                     const unsigned char *sig, size_t siglen,
                     const unsigned char *tbs, size_t tbslen);
+
+/*
+ * One signature checked by EVP_PKEY_verify_batch(), against |pkey| or, if
+ * that is NULL, the key of the context
+ */
+typedef struct evp_pkey_verify_batch_item_st {
+    EVP_PKEY *pkey;
+    const unsigned char *sig;
+    size_t siglen;
+    const unsigned char *tbs;
+    size_t tbslen;
+} EVP_PKEY_VERIFY_BATCH_ITEM;
+
+int EVP_PKEY_verify_batch(EVP_PKEY_CTX *ctx,
+                          const EVP_PKEY_VERIFY_BATCH_ITEM *items, size_t num);
+
 int EVP_PKEY_verify_recover_init(EVP_PKEY_CTX *ctx);
 int EVP_PKEY_verify_recover_init_ex(EVP_PKEY_CTX *ctx,
                                     const OSSL_PARAM params[]);
@@ -1926,6 +1972,21 @@ int EVP_PKEY_derive_set_peer_ex(EVP_PKEY_CTX *ctx, EVP_PKEY *peer,
 int EVP_PKEY_derive_set_peer(EVP_PKEY_CTX *ctx, EVP_PKEY *peer);
 int EVP_PKEY_derive(EVP_PKEY_CTX *ctx, unsigned char *key, size_t *keylen);
 
+/*
+ * One shared secret derived by EVP_PKEY_derive_batch() from |pkey| or, if
+ * that is NULL, the key of the context, and |peer|.  |keylen| is the size of
+ * the |key| buffer on input and the length of the secret on output.
+ */
+typedef struct evp_pkey_derive_batch_item_st {
+    EVP_PKEY *pkey;
+    EVP_PKEY *peer;
+    unsigned char *key;
+    size_t keylen;
+} EVP_PKEY_DERIVE_BATCH_ITEM;
+
+int EVP_PKEY_derive_batch(EVP_PKEY_CTX *ctx,
+                          EVP_PKEY_DERIVE_BATCH_ITEM *items, size_t num);
+
 int EVP_PKEY_encapsulate_init(EVP_PKEY_CTX *ctx, const OSSL_PARAM params[]);
 int EVP_PKEY_auth_encapsulate_init(EVP_PKEY_CTX *ctx, EVP_PKEY *authpriv,
                                    const OSSL_PARAM params[]);
@@ -84,10 +84,10 @@ IMPLEMENT_generic_cipher(aes, AES, cfb8, CFB, 0, 192, 8, 128, stream)
 /* ossl_aes128cfb8_functions */
 IMPLEMENT_generic_cipher(aes, AES, cfb8, CFB, 0, 128, 8, 128, stream)
 /* ossl_aes256ctr_functions */
-IMPLEMENT_generic_cipher(aes, AES, ctr, CTR, 0, 256, 8, 128, stream)
+IMPLEMENT_generic_cipher(aes, AES, ctr, CTR, 0, 256, 8, 128, ctr)
 /* ossl_aes192ctr_functions */
-IMPLEMENT_generic_cipher(aes, AES, ctr, CTR, 0, 192, 8, 128, stream)
+IMPLEMENT_generic_cipher(aes, AES, ctr, CTR, 0, 192, 8, 128, ctr)
 /* ossl_aes128ctr_functions */
-IMPLEMENT_generic_cipher(aes, AES, ctr, CTR, 0, 128, 8, 128, stream)
+IMPLEMENT_generic_cipher(aes, AES, ctr, CTR, 0, 128, 8, 128, ctr)
 
 #include "cipher_aes_cts.inc"
@@ -20,6 +20,8 @@
 #include "prov/implementations.h"
 #include "prov/providercommon.h"
 
+#define AES_GCM_FLAGS (AEAD_FLAGS | PROV_CIPHER_FLAG_TLS13_MULTIREC)
+
 static void *aes_gcm_newctx(void *provctx, size_t keybits)
 {
     PROV_AES_GCM_CTX *ctx;
@@ -43,8 +45,8 @@ static void aes_gcm_freectx(void *vctx)
 }
 
 /* ossl_aes128gcm_functions */
-IMPLEMENT_aead_cipher(aes, gcm, GCM, AEAD_FLAGS, 128, 8, 96);
+IMPLEMENT_aead_cipher(aes, gcm, GCM, AES_GCM_FLAGS, 128, 8, 96);
 /* ossl_aes192gcm_functions */
-IMPLEMENT_aead_cipher(aes, gcm, GCM, AEAD_FLAGS, 192, 8, 96);
+IMPLEMENT_aead_cipher(aes, gcm, GCM, AES_GCM_FLAGS, 192, 8, 96);
 /* ossl_aes256gcm_functions */
-IMPLEMENT_aead_cipher(aes, gcm, GCM, AEAD_FLAGS, 256, 8, 96);
+IMPLEMENT_aead_cipher(aes, gcm, GCM, AES_GCM_FLAGS, 256, 8, 96);
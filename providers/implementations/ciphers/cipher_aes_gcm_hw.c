@@ -129,7 +129,9 @@ static const PROV_GCM_HW aes_gcm = {
     ossl_gcm_aad_update,
     generic_aes_gcm_cipher_update,
     ossl_gcm_cipher_final,
-    ossl_gcm_one_shot
+    ossl_gcm_one_shot,
+    ossl_gcm_split,
+    ossl_gcm_join
 };
 
 #if defined(S390X_aes_128_CAPABLE)
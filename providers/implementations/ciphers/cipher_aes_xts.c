@@ -116,7 +116,7 @@ static void *aes_xts_newctx(void *provctx, unsigned int mode, uint64_t flags,
     if (ctx != NULL) {
         ossl_cipher_generic_initkey(&ctx->base, kbits, blkbits, ivbits, mode,
                                     flags, ossl_prov_cipher_hw_aes_xts(kbits),
-                                    NULL);
+                                    provctx);
     }
     return ctx;
 }
@@ -152,10 +152,129 @@ static void *aes_xts_dupctx(void *vctx)
     return ret;
 }
 
+typedef struct {
+    PROV_AES_XTS_CTX *ctx;
+    unsigned char iv[AES_BLOCK_SIZE];
+    unsigned char *out;
+    const unsigned char *in;
+    size_t len;
+} AES_XTS_JOB;
+
+static uint32_t aes_xts_job(void *vjob)
+{
+    AES_XTS_JOB *job = vjob;
+    PROV_AES_XTS_CTX *ctx = job->ctx;
+
+    if (ctx->stream != NULL) {
+        (*ctx->stream)(job->in, job->out, job->len, ctx->xts.key1,
+                       ctx->xts.key2, job->iv);
+        return 1;
+    }
+    return CRYPTO_xts128_encrypt(&ctx->xts, job->iv, job->in, job->out,
+                                 job->len, ctx->base.enc) == 0;
+}
+
+/* r = a * b in GF(2^128) with the bit order used for XTS tweaks */
+static void aes_xts_gfmul(uint64_t r[2], const uint64_t a[2],
+                          const uint64_t b[2])
+{
+    uint64_t v0 = a[0], v1 = a[1], r0 = 0, r1 = 0, m;
+    int i;
+
+    for (i = 0; i < 128; i++) {
+        m = 0 - ((b[i / 64] >> (i % 64)) & 1);
+        r0 ^= v0 & m;
+        r1 ^= v1 & m;
+        m = 0 - (v1 >> 63);
+        v1 = (v1 << 1) | (v0 >> 63);
+        v0 = (v0 << 1) ^ (m & 0x87);
+    }
+    r[0] = r0;
+    r[1] = r1;
+}
+
+static void aes_xts_load(uint64_t v[2], const unsigned char b[AES_BLOCK_SIZE])
+{
+    int i;
+
+    v[0] = v[1] = 0;
+    for (i = AES_BLOCK_SIZE - 1; i >= 0; i--)
+        v[i / 8] = (v[i / 8] << 8) | b[i];
+}
+
+static void aes_xts_store(unsigned char b[AES_BLOCK_SIZE], const uint64_t v[2])
+{
+    int i;
+
+    for (i = 0; i < AES_BLOCK_SIZE; i++)
+        b[i] = (unsigned char)(v[i / 8] >> (8 * (i % 8)));
+}
+
+/*
+ * Encrypt or decrypt one data unit in |parts| pieces on pool threads.  Every
+ * piece but the last is the same number of whole blocks.  A piece starting at
+ * block |j| needs the tweak E(K2, iv) * x^j, which the stream functions derive
+ * from an IV of D(K2, E(K2, iv) * x^j).
+ */
+static int aes_xts_parallel(PROV_AES_XTS_CTX *ctx, unsigned char *out,
+                            const unsigned char *in, size_t len, size_t parts)
+{
+    AES_XTS_JOB *jobs;
+    unsigned char t[AES_BLOCK_SIZE];
+    uint64_t tweak[2], step[2] = { 1, 0 }, e[2] = { 2, 0 }, tmp[2];
+    size_t i, plen, n;
+    int ret;
+
+    jobs = OPENSSL_malloc(parts * sizeof(*jobs));
+    if (jobs == NULL)
+        return 0;
+
+    plen = (len / parts) & ~(size_t)(AES_BLOCK_SIZE - 1);
+
+    /* step = x^(plen / 16) */
+    for (n = plen / AES_BLOCK_SIZE; n > 0; n >>= 1) {
+        if ((n & 1) != 0) {
+            aes_xts_gfmul(tmp, step, e);
+            step[0] = tmp[0];
+            step[1] = tmp[1];
+        }
+        aes_xts_gfmul(tmp, e, e);
+        e[0] = tmp[0];
+        e[1] = tmp[1];
+    }
+
+    (*ctx->xts.block2)(ctx->base.iv, t, ctx->xts.key2);
+    aes_xts_load(tweak, t);
+    for (i = 0; i < parts; i++) {
+        jobs[i].ctx = ctx;
+        jobs[i].out = out + i * plen;
+        jobs[i].in = in + i * plen;
+        jobs[i].len = i + 1 < parts ? plen : len - i * plen;
+        if (i == 0) {
+            memcpy(jobs[i].iv, ctx->base.iv, AES_BLOCK_SIZE);
+            continue;
+        }
+        aes_xts_gfmul(tmp, tweak, step);
+        tweak[0] = tmp[0];
+        tweak[1] = tmp[1];
+        aes_xts_store(t, tweak);
+        (*ctx->block2_dec)(t, jobs[i].iv, &ctx->ks2_dec.ks);
+    }
+
+    ret = ossl_cipher_thread_run(ctx->base.libctx, aes_xts_job, jobs,
+                                 sizeof(*jobs), parts);
+    OPENSSL_cleanse(t, sizeof(t));
+    OPENSSL_cleanse(tweak, sizeof(tweak));
+    OPENSSL_cleanse(tmp, sizeof(tmp));
+    OPENSSL_clear_free(jobs, parts * sizeof(*jobs));
+    return ret;
+}
+
 static int aes_xts_cipher(void *vctx, unsigned char *out, size_t *outl,
                           size_t outsize, const unsigned char *in, size_t inl)
 {
     PROV_AES_XTS_CTX *ctx = (PROV_AES_XTS_CTX *)vctx;
+    size_t parts = 1;
 
     if (!ossl_prov_is_running()
             || ctx->xts.key1 == NULL
@@ -177,11 +296,18 @@ static int aes_xts_cipher(void *vctx, unsigned char *out, size_t *outl,
         return 0;
     }
 
-    if (ctx->stream != NULL)
+    if (ctx->block2_dec != NULL)
+        parts = ossl_cipher_thread_parts(ctx->base.libctx, ctx->base.threads,
+                                         ctx->base.thread_threshold, inl);
+    if (parts > 1) {
+        if (!aes_xts_parallel(ctx, out, in, inl, parts))
+            return 0;
+    } else if (ctx->stream != NULL) {
         (*ctx->stream)(in, out, inl, ctx->xts.key1, ctx->xts.key2, ctx->base.iv);
-    else if (CRYPTO_xts128_encrypt(&ctx->xts, ctx->base.iv, in, out, inl,
-                                   ctx->base.enc))
+    } else if (CRYPTO_xts128_encrypt(&ctx->xts, ctx->base.iv, in, out, inl,
+                                     ctx->base.enc)) {
         return 0;
+    }
 
     *outl = inl;
     return 1;
@@ -217,6 +343,8 @@ static int aes_xts_stream_final(void *vctx, unsigned char *out, size_t *outl,
 
 static const OSSL_PARAM aes_xts_known_settable_ctx_params[] = {
     OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_KEYLEN, NULL),
+    OSSL_PARAM_uint(OSSL_CIPHER_PARAM_THREADS, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_THREAD_THRESHOLD, NULL),
     OSSL_PARAM_END
 };
 
@@ -246,6 +374,20 @@ static int aes_xts_set_ctx_params(void *vctx, const OSSL_PARAM params[])
         if (keylen != ctx->keylen)
             return 0;
     }
+    p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_THREADS);
+    if (p != NULL) {
+        if (!OSSL_PARAM_get_uint(p, &ctx->threads)) {
+            ERR_raise(ERR_LIB_PROV, PROV_R_FAILED_TO_GET_PARAMETER);
+            return 0;
+        }
+    }
+    p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_THREAD_THRESHOLD);
+    if (p != NULL) {
+        if (!OSSL_PARAM_get_size_t(p, &ctx->thread_threshold)) {
+            ERR_raise(ERR_LIB_PROV, PROV_R_FAILED_TO_GET_PARAMETER);
+            return 0;
+        }
+    }
 
     return 1;
 }
@@ -27,9 +27,11 @@ typedef struct prov_aes_xts_ctx_st {
     union {
         OSSL_UNION_ALIGN;
         AES_KEY ks;
-    } ks1, ks2;                /* AES key schedules to use */
+    } ks1, ks2,                /* AES key schedules to use */
+      ks2_dec;                 /* Inverse of ks2 */
     XTS128_CONTEXT xts;
     OSSL_xts_stream_fn stream;
+    block128_f block2_dec;     /* Decrypts with ks2_dec */
 } PROV_AES_XTS_CTX;
 
 const PROV_CIPHER_HW *ossl_prov_cipher_hw_aes_xts(size_t keybits);
@@ -1,5 +1,5 @@
 /*
- * Copyright 2019-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2019-2023 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -30,6 +30,8 @@
     }                                                                          \
     fn_set_enc_key(key + bytes, bits, &xctx->ks2.ks);                          \
     xctx->xts.block2 = (block128_f)fn_block_enc;                               \
+    fn_set_dec_key(key + bytes, bits, &xctx->ks2_dec.ks);                      \
+    xctx->block2_dec = (block128_f)fn_block_dec;                               \
     xctx->xts.key1 = &xctx->ks1;                                               \
     xctx->xts.key2 = &xctx->ks2;                                               \
     xctx->stream = ctx->enc ? fn_stream_enc : fn_stream_dec;                   \
@@ -99,11 +101,124 @@ static void cipher_hw_aes_xts_copyctx(PROV_CIPHER_CTX *dst,
 
 #if defined(AESNI_CAPABLE)
 
+# ifdef AES_VAES_ASM
+/* Multiply the tweak by x in GF(2^128) */
+static void aes_xts_mulx(unsigned char tweak[AES_BLOCK_SIZE])
+{
+    unsigned int carry = 0, msb;
+    size_t i;
+
+    for (i = 0; i < AES_BLOCK_SIZE; i++) {
+        msb = tweak[i] >> 7;
+        tweak[i] = (unsigned char)((tweak[i] << 1) | carry);
+        carry = msb;
+    }
+    if (carry)
+        tweak[0] ^= 0x87;
+}
+
+/* One block in place with tweak |tweak| */
+static void aes_xts_block(unsigned char blk[AES_BLOCK_SIZE],
+                          const unsigned char tweak[AES_BLOCK_SIZE],
+                          const AES_KEY *key, block128_f block)
+{
+    size_t i;
+
+    for (i = 0; i < AES_BLOCK_SIZE; i++)
+        blk[i] ^= tweak[i];
+    block(blk, blk, key);
+    for (i = 0; i < AES_BLOCK_SIZE; i++)
+        blk[i] ^= tweak[i];
+}
+
+/*
+ * The VAES functions only process whole blocks, the ciphertext stealing
+ * for a trailing partial block is done here as in CRYPTO_xts128_encrypt.
+ * Short inputs go to the AES-NI functions.
+ */
+static void aes_vaes_xts_encrypt(const unsigned char *in, unsigned char *out,
+                                 size_t len, const AES_KEY *key1,
+                                 const AES_KEY *key2,
+                                 const unsigned char iv[16])
+{
+    unsigned char tweak[AES_BLOCK_SIZE], blk[AES_BLOCK_SIZE], c;
+    size_t blocks = len / AES_BLOCK_SIZE, rem = len % AES_BLOCK_SIZE, i;
+
+    if (blocks < AES_VAES_MIN_BLOCKS) {
+        aesni_xts_encrypt(in, out, len, key1, key2, iv);
+        return;
+    }
+    aesni_encrypt(iv, tweak, key2);
+    ossl_aes_xts_encrypt_avx512(in, out, blocks, key1, tweak);
+    if (rem != 0) {
+        in += blocks * AES_BLOCK_SIZE;
+        out += blocks * AES_BLOCK_SIZE;
+        memcpy(blk, out - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+        /* |in| and |out| may be the same */
+        for (i = 0; i < rem; i++) {
+            c = in[i];
+            out[i] = blk[i];
+            blk[i] = c;
+        }
+        aes_xts_block(blk, tweak, key1, (block128_f)aesni_encrypt);
+        memcpy(out - AES_BLOCK_SIZE, blk, AES_BLOCK_SIZE);
+        OPENSSL_cleanse(blk, sizeof(blk));
+    }
+    OPENSSL_cleanse(tweak, sizeof(tweak));
+}
+
+static void aes_vaes_xts_decrypt(const unsigned char *in, unsigned char *out,
+                                 size_t len, const AES_KEY *key1,
+                                 const AES_KEY *key2,
+                                 const unsigned char iv[16])
+{
+    unsigned char tweak[AES_BLOCK_SIZE], next[AES_BLOCK_SIZE];
+    unsigned char blk[AES_BLOCK_SIZE], c;
+    size_t blocks = len / AES_BLOCK_SIZE, rem = len % AES_BLOCK_SIZE, i;
+
+    if (blocks < AES_VAES_MIN_BLOCKS) {
+        aesni_xts_decrypt(in, out, len, key1, key2, iv);
+        return;
+    }
+    aesni_encrypt(iv, tweak, key2);
+    if (rem == 0) {
+        ossl_aes_xts_decrypt_avx512(in, out, blocks, key1, tweak);
+    } else {
+        /* The last whole block goes with the tweak after the partial one's */
+        ossl_aes_xts_decrypt_avx512(in, out, blocks - 1, key1, tweak);
+        in += (blocks - 1) * AES_BLOCK_SIZE;
+        out += (blocks - 1) * AES_BLOCK_SIZE;
+        memcpy(next, tweak, AES_BLOCK_SIZE);
+        aes_xts_mulx(next);
+        memcpy(blk, in, AES_BLOCK_SIZE);
+        aes_xts_block(blk, next, key1, (block128_f)aesni_decrypt);
+        for (i = 0; i < rem; i++) {
+            c = in[AES_BLOCK_SIZE + i];
+            out[AES_BLOCK_SIZE + i] = blk[i];
+            blk[i] = c;
+        }
+        aes_xts_block(blk, tweak, key1, (block128_f)aesni_decrypt);
+        memcpy(out, blk, AES_BLOCK_SIZE);
+        OPENSSL_cleanse(blk, sizeof(blk));
+        OPENSSL_cleanse(next, sizeof(next));
+    }
+    OPENSSL_cleanse(tweak, sizeof(tweak));
+}
+# endif /* AES_VAES_ASM */
+
 static int cipher_hw_aesni_xts_initkey(PROV_CIPHER_CTX *ctx,
                                        const unsigned char *key, size_t keylen)
 {
     PROV_AES_XTS_CTX *xctx = (PROV_AES_XTS_CTX *)ctx;
 
+# ifdef AES_VAES_ASM
+    if (AES_VAES_CAPABLE) {
+        XTS_SET_KEY_FN(aesni_set_encrypt_key, aesni_set_decrypt_key,
+                       aesni_encrypt, aesni_decrypt,
+                       aes_vaes_xts_encrypt, aes_vaes_xts_decrypt);
+        return 1;
+    }
+# endif
     XTS_SET_KEY_FN(aesni_set_encrypt_key, aesni_set_decrypt_key,
                    aesni_encrypt, aesni_decrypt,
                    aesni_xts_encrypt, aesni_xts_decrypt);
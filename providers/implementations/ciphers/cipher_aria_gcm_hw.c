@@ -19,6 +19,13 @@ static int aria_gcm_initkey(PROV_GCM_CTX *ctx, const unsigned char *key,
     PROV_ARIA_GCM_CTX *actx = (PROV_ARIA_GCM_CTX *)ctx;
     ARIA_KEY *ks = &actx->ks.ks;
 
+#ifdef ARIA_GFNI_AVX2_CAPABLE
+    if (ARIA_GFNI_AVX2_CAPABLE) {
+        GCM_HW_SET_KEY_CTR_FN(ks, ossl_aria_set_encrypt_key, ossl_aria_encrypt,
+                              ossl_aria_gfni_avx2_ctr32_encrypt_blocks);
+        return 1;
+    }
+#endif
     GCM_HW_SET_KEY_CTR_FN(ks, ossl_aria_set_encrypt_key, ossl_aria_encrypt, NULL);
     return 1;
 }
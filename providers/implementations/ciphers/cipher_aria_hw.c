@@ -32,14 +32,24 @@ static int cipher_hw_aria_initkey(PROV_CIPHER_CTX *dat,
 
 IMPLEMENT_CIPHER_HW_COPYCTX(cipher_hw_aria_copyctx, PROV_ARIA_CTX)
 
+#if defined(ARIA_GFNI_AVX2_CAPABLE)
+# include "cipher_aria_hw_gfni.inc"
+#else
+/* The generic case */
+# define PROV_CIPHER_HW_declare(mode)
+# define PROV_CIPHER_HW_select(mode)
+#endif /* ARIA_GFNI_AVX2_CAPABLE */
+
 # define PROV_CIPHER_HW_aria_mode(mode)                                        \
 static const PROV_CIPHER_HW aria_##mode = {                                    \
     cipher_hw_aria_initkey,                                                    \
     ossl_cipher_hw_chunked_##mode,                                             \
     cipher_hw_aria_copyctx                                                     \
 };                                                                             \
+PROV_CIPHER_HW_declare(mode)                                                   \
 const PROV_CIPHER_HW *ossl_prov_cipher_hw_aria_##mode(size_t keybits)          \
 {                                                                              \
+    PROV_CIPHER_HW_select(mode)                                                \
     return &aria_##mode;                                                       \
 }
 
@@ -46,6 +46,8 @@ IMPLEMENT_CIPHER_HW_COPYCTX(cipher_hw_camellia_copyctx, PROV_CAMELLIA_CTX)
 
 # if defined(SPARC_CMLL_CAPABLE)
 #  include "cipher_camellia_hw_t4.inc"
+# elif defined(CMLL_GFNI_AVX2_CAPABLE)
+#  include "cipher_camellia_hw_gfni.inc"
 # else
 /* The generic case */
 #  define PROV_CIPHER_HW_declare(mode)
@@ -19,7 +19,8 @@
 #define CHACHA20_POLY1305_MAX_IVLEN 12
 #define CHACHA20_POLY1305_MODE 0
 #define CHACHA20_POLY1305_FLAGS (PROV_CIPHER_FLAG_AEAD                         \
-                                 | PROV_CIPHER_FLAG_CUSTOM_IV)
+                                 | PROV_CIPHER_FLAG_CUSTOM_IV                  \
+                                 | PROV_CIPHER_FLAG_TLS13_MULTIREC)
 
 static OSSL_FUNC_cipher_newctx_fn chacha20_poly1305_newctx;
 static OSSL_FUNC_cipher_freectx_fn chacha20_poly1305_freectx;
@@ -138,6 +139,29 @@ static const OSSL_PARAM *chacha20_poly1305_gettable_ctx_params
     return chacha20_poly1305_known_gettable_ctx_params;
 }
 
+static int chacha20_poly1305_tls13_seal(void *vctx,
+                                        const unsigned char *nonce,
+                                        const unsigned char *hdr,
+                                        const unsigned char *in, size_t len,
+                                        unsigned char type, unsigned char *out)
+{
+    PROV_CHACHA20_POLY1305_CTX *ctx = (PROV_CHACHA20_POLY1305_CTX *)vctx;
+    PROV_CIPHER_HW_CHACHA20_POLY1305 *hw =
+        (PROV_CIPHER_HW_CHACHA20_POLY1305 *)ctx->base.hw;
+    size_t outl;
+
+    memcpy(ctx->base.oiv, nonce, CHACHA20_POLY1305_IVLEN);
+    if (!hw->initiv(&ctx->base)
+        || !hw->aead_cipher(&ctx->base, NULL, &outl, hdr,
+                            TLS13_RECORD_HEADER_LEN)
+        || !hw->aead_cipher(&ctx->base, out, &outl, in, len)
+        || !hw->aead_cipher(&ctx->base, out + len, &outl, &type, 1)
+        || !hw->aead_cipher(&ctx->base, NULL, &outl, NULL, 0))
+        return 0;
+    memcpy(out + len + 1, ctx->tag, POLY1305_BLOCK_SIZE);
+    return 1;
+}
+
 static int chacha20_poly1305_set_ctx_params(void *vctx,
                                             const OSSL_PARAM params[])
 {
@@ -218,6 +242,17 @@ static int chacha20_poly1305_set_ctx_params(void *vctx,
             return 0;
         }
     }
+
+    p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_TLS13_MULTIREC_ENC);
+    if (p != NULL) {
+        if (!ctx->base.enc || !ossl_prov_is_running()) {
+            ERR_raise(ERR_LIB_PROV, PROV_R_CIPHER_OPERATION_FAILED);
+            return 0;
+        }
+        if (!ossl_cipher_tls13_multirec(ctx, params, POLY1305_BLOCK_SIZE,
+                                        chacha20_poly1305_tls13_seal))
+            return 0;
+    }
     /* ignore OSSL_CIPHER_PARAM_AEAD_MAC_KEY */
     return 1;
 }
@@ -51,6 +51,13 @@ static int sm4_gcm_initkey(PROV_GCM_CTX *ctx, const unsigned char *key,
                                   vpsm4_ctr32_encrypt_blocks);
     } else
 # endif /* VPSM4_CAPABLE */
+
+# ifdef SM4_GFNI_AVX2_CAPABLE
+    if (SM4_GFNI_AVX2_CAPABLE) {
+        SM4_GCM_HW_SET_KEY_CTR_FN(ks, ossl_sm4_set_key, ossl_sm4_encrypt,
+                                  ossl_sm4_gfni_avx2_ctr32_encrypt_blocks);
+    } else
+# endif /* SM4_GFNI_AVX2_CAPABLE */
     {
         SM4_GCM_HW_SET_KEY_CTR_FN(ks, ossl_sm4_set_key, ossl_sm4_encrypt, NULL);
     }
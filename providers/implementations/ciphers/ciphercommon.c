@@ -30,6 +30,7 @@ static const OSSL_PARAM cipher_known_gettable_params[] = {
     OSSL_PARAM_int(OSSL_CIPHER_PARAM_CUSTOM_IV, NULL),
     OSSL_PARAM_int(OSSL_CIPHER_PARAM_CTS, NULL),
     OSSL_PARAM_int(OSSL_CIPHER_PARAM_TLS1_MULTIBLOCK, NULL),
+    OSSL_PARAM_int(OSSL_CIPHER_PARAM_TLS13_MULTIREC, NULL),
     OSSL_PARAM_int(OSSL_CIPHER_PARAM_HAS_RAND_KEY, NULL),
     OSSL_PARAM_END
 };
@@ -73,6 +74,12 @@ int ossl_cipher_generic_get_params(OSSL_PARAM params[], unsigned int md,
         ERR_raise(ERR_LIB_PROV, PROV_R_FAILED_TO_SET_PARAMETER);
         return 0;
     }
+    p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_TLS13_MULTIREC);
+    if (p != NULL
+        && !OSSL_PARAM_set_int(p, (flags & PROV_CIPHER_FLAG_TLS13_MULTIREC) != 0)) {
+        ERR_raise(ERR_LIB_PROV, PROV_R_FAILED_TO_SET_PARAMETER);
+        return 0;
+    }
     p = OSSL_PARAM_locate(params, OSSL_CIPHER_PARAM_HAS_RAND_KEY);
     if (p != NULL
         && !OSSL_PARAM_set_int(p, (flags & PROV_CIPHER_FLAG_RAND_KEY) != 0)) {
@@ -105,6 +112,8 @@ CIPHER_DEFAULT_SETTABLE_CTX_PARAMS_START(ossl_cipher_generic)
 OSSL_PARAM_uint(OSSL_CIPHER_PARAM_USE_BITS, NULL),
 OSSL_PARAM_uint(OSSL_CIPHER_PARAM_TLS_VERSION, NULL),
 OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_TLS_MAC_SIZE, NULL),
+OSSL_PARAM_uint(OSSL_CIPHER_PARAM_THREADS, NULL),
+OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_THREAD_THRESHOLD, NULL),
 CIPHER_DEFAULT_SETTABLE_CTX_PARAMS_END(ossl_cipher_generic)
 
 /*
@@ -164,6 +173,14 @@ static const OSSL_PARAM cipher_aead_known_settable_ctx_params[] = {
     OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TLS1_AAD, NULL, 0),
     OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TLS1_IV_FIXED, NULL, 0),
     OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_AEAD_TLS1_SET_IV_INV, NULL, 0),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_TLS13_MULTIREC_IV, NULL, 0),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_TLS13_MULTIREC_SEQ, NULL, 0),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_TLS13_MULTIREC_FRAGLEN, NULL),
+    OSSL_PARAM_uint(OSSL_CIPHER_PARAM_TLS13_MULTIREC_TYPE, NULL),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_TLS13_MULTIREC_ENC, NULL, 0),
+    OSSL_PARAM_octet_string(OSSL_CIPHER_PARAM_TLS13_MULTIREC_ENC_IN, NULL, 0),
+    OSSL_PARAM_uint(OSSL_CIPHER_PARAM_THREADS, NULL),
+    OSSL_PARAM_size_t(OSSL_CIPHER_PARAM_THREAD_THRESHOLD, NULL),
     OSSL_PARAM_END
 };
 const OSSL_PARAM *ossl_cipher_aead_settable_ctx_params(
@@ -640,6 +657,20 @@ int ossl_cipher_generic_set_ctx_params(void *vctx, const OSSL_PARAM params[])
         }
         ctx->num = num;
     }
+    p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_THREADS);
+    if (p != NULL) {
+        if (!OSSL_PARAM_get_uint(p, &ctx->threads)) {
+            ERR_raise(ERR_LIB_PROV, PROV_R_FAILED_TO_GET_PARAMETER);
+            return 0;
+        }
+    }
+    p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_THREAD_THRESHOLD);
+    if (p != NULL) {
+        if (!OSSL_PARAM_get_size_t(p, &ctx->thread_threshold)) {
+            ERR_raise(ERR_LIB_PROV, PROV_R_FAILED_TO_GET_PARAMETER);
+            return 0;
+        }
+    }
     return 1;
 }
 
@@ -678,3 +709,105 @@ void ossl_cipher_generic_initkey(void *vctx, size_t kbits, size_t blkbits,
     if (provctx != NULL)
         ctx->libctx = PROV_LIBCTX_OF(provctx); /* used for rand */
 }
+
+/*-
+ * TLS 1.3 multi-record encryption.  The "tls13multi_encin" data is cut into
+ * fragments of "tls13multi_fraglen" bytes, the last one possibly shorter, and
+ * each is written to the "tls13multi_enc" buffer as a complete application
+ * data record: the record header, then the fragment and the inner content
+ * type sealed by |seal|, then the tag.  The nonce of each record is the
+ * static "tls13multi_iv" XORed with its sequence number, counting up from
+ * "tls13multi_seq" (RFC 8446 section 5.3).
+ */
+int ossl_cipher_tls13_multirec(void *vctx, const OSSL_PARAM params[],
+                               size_t taglen, OSSL_tls13_seal_fn seal)
+{
+    const OSSL_PARAM *p;
+    const unsigned char *in;
+    unsigned char *out;
+    unsigned char iv[TLS13_NONCE_LEN], seq[TLS13_SEQ_LEN];
+    unsigned char nonce[TLS13_NONCE_LEN], hdr[TLS13_RECORD_HEADER_LEN];
+    void *vp;
+    size_t fraglen, inl, outsize, nrecs, len, reclen, i, j;
+    unsigned int type;
+
+    vp = iv;
+    if ((p = OSSL_PARAM_locate_const(params,
+                                     OSSL_CIPHER_PARAM_TLS13_MULTIREC_IV)) == NULL
+        || !OSSL_PARAM_get_octet_string(p, &vp, sizeof(iv), &len)
+        || len != sizeof(iv)) {
+        ERR_raise(ERR_LIB_PROV, PROV_R_INVALID_IV_LENGTH);
+        return 0;
+    }
+    vp = seq;
+    if ((p = OSSL_PARAM_locate_const(params,
+                                     OSSL_CIPHER_PARAM_TLS13_MULTIREC_SEQ)) == NULL
+        || !OSSL_PARAM_get_octet_string(p, &vp, sizeof(seq), &len)
+        || len != sizeof(seq)
+        || (p = OSSL_PARAM_locate_const(params,
+                    OSSL_CIPHER_PARAM_TLS13_MULTIREC_FRAGLEN)) == NULL
+        || !OSSL_PARAM_get_size_t(p, &fraglen)
+        || (p = OSSL_PARAM_locate_const(params,
+                    OSSL_CIPHER_PARAM_TLS13_MULTIREC_TYPE)) == NULL
+        || !OSSL_PARAM_get_uint(p, &type)
+        || (p = OSSL_PARAM_locate_const(params,
+                    OSSL_CIPHER_PARAM_TLS13_MULTIREC_ENC_IN)) == NULL
+        || p->data_type != OSSL_PARAM_OCTET_STRING) {
+        ERR_raise(ERR_LIB_PROV, PROV_R_FAILED_TO_GET_PARAMETER);
+        return 0;
+    }
+    in = p->data;
+    inl = p->data_size;
+    p = OSSL_PARAM_locate_const(params, OSSL_CIPHER_PARAM_TLS13_MULTIREC_ENC);
+    if (p == NULL || p->data_type != OSSL_PARAM_OCTET_STRING) {
+        ERR_raise(ERR_LIB_PROV, PROV_R_FAILED_TO_GET_PARAMETER);
+        return 0;
+    }
+    out = p->data;
+    outsize = p->data_size;
+
+    /* A record must fit the 16 bit length field with its type byte and tag */
+    if (in == NULL || inl == 0 || fraglen == 0 || type > 0xff
+        || fraglen > 0xffff - 1 - taglen) {
+        ERR_raise(ERR_LIB_PROV, PROV_R_INVALID_DATA);
+        return 0;
+    }
+    nrecs = (inl - 1) / fraglen + 1;
+    if (outsize < inl
+        || outsize - inl < nrecs * (TLS13_RECORD_HEADER_LEN + 1 + taglen)) {
+        ERR_raise(ERR_LIB_PROV, PROV_R_OUTPUT_BUFFER_TOO_SMALL);
+        return 0;
+    }
+
+    for (i = 0; i < nrecs; i++) {
+        len = inl < fraglen ? inl : fraglen;
+        reclen = len + 1 + taglen;
+
+        /* application_data, legacy_record_version 0x0303 */
+        hdr[0] = 23;
+        hdr[1] = 3;
+        hdr[2] = 3;
+        hdr[3] = (unsigned char)(reclen >> 8);
+        hdr[4] = (unsigned char)reclen;
+
+        memcpy(nonce, iv, TLS13_NONCE_LEN - TLS13_SEQ_LEN);
+        for (j = 0; j < TLS13_SEQ_LEN; j++)
+            nonce[TLS13_NONCE_LEN - TLS13_SEQ_LEN + j] =
+                iv[TLS13_NONCE_LEN - TLS13_SEQ_LEN + j] ^ seq[j];
+
+        memcpy(out, hdr, TLS13_RECORD_HEADER_LEN);
+        out += TLS13_RECORD_HEADER_LEN;
+        if (!seal(vctx, nonce, hdr, in, len, (unsigned char)type, out)) {
+            ERR_raise(ERR_LIB_PROV, PROV_R_CIPHER_OPERATION_FAILED);
+            return 0;
+        }
+        in += len;
+        inl -= len;
+        out += reclen;
+
+        /* The caller guarantees that the sequence number does not wrap */
+        for (j = TLS13_SEQ_LEN; j > 0 && ++seq[j - 1] == 0; j--)
+            continue;
+    }
+    return 1;
+}
@@ -25,6 +25,7 @@ static int gcm_tls_cipher(PROV_GCM_CTX *ctx, unsigned char *out, size_t *padlen,
 static int gcm_cipher_internal(PROV_GCM_CTX *ctx, unsigned char *out,
                                size_t *padlen, const unsigned char *in,
                                size_t len);
+static int gcm_tls13_multirec(PROV_GCM_CTX *ctx, const OSSL_PARAM params[]);
 
 /*
  * Called from EVP_CipherInit when there is currently no context via
@@ -247,7 +248,7 @@ int ossl_gcm_set_ctx_params(void *vctx, const OSSL_PARAM params[])
     const OSSL_PARAM *p;
     size_t sz;
     void *vp;
-    int type;
+    int type, multirec = 0;
 
     if (params == NULL)
         return 1;
@@ -313,9 +314,30 @@ int ossl_gcm_set_ctx_params(void *vctx, const OSSL_PARAM params[])
                 || !setivinv(ctx, p->data, p->data_size))
                 return 0;
             break;
+
+        case PIDX_CIPHER_PARAM_TLS13_MULTIREC_ENC:
+            multirec = 1;
+            break;
+
+        case PIDX_CIPHER_PARAM_THREADS:
+            if (!OSSL_PARAM_get_uint(p, &ctx->threads)) {
+                ERR_raise(ERR_LIB_PROV, PROV_R_FAILED_TO_GET_PARAMETER);
+                return 0;
+            }
+            break;
+
+        case PIDX_CIPHER_PARAM_THREAD_THRESHOLD:
+            if (!OSSL_PARAM_get_size_t(p, &ctx->thread_threshold)) {
+                ERR_raise(ERR_LIB_PROV, PROV_R_FAILED_TO_GET_PARAMETER);
+                return 0;
+            }
+            break;
         }
     }
 
+    /* The other multi-record parameters come in the same array */
+    if (multirec)
+        return gcm_tls13_multirec(ctx, params);
     return 1;
 }
 
@@ -403,11 +425,79 @@ static int gcm_iv_generate(PROV_GCM_CTX *ctx, int offset)
     return 1;
 }
 
+typedef struct {
+    PROV_GCM_CTX part;
+    unsigned char *out;
+    const unsigned char *in;
+    size_t len;
+} GCM_JOB;
+
+static uint32_t gcm_job(void *vjob)
+{
+    GCM_JOB *job = vjob;
+
+    return job->part.hw->cipherupdate(&job->part, job->in, job->len, job->out);
+}
+
+/*
+ * Process the whole blocks of a large update in |parts| pieces on pool
+ * threads.  Each piece runs on a copy of the context that starts at its
+ * offset with an empty hash, and the copies are joined back in order.
+ */
+static int gcm_cipher_parallel(PROV_GCM_CTX *ctx, const unsigned char *in,
+                               size_t len, unsigned char *out, size_t parts)
+{
+    const PROV_GCM_HW *hw = ctx->hw;
+    GCM_JOB *jobs;
+    size_t i, pre, plen, blen;
+    int ret = 0;
+
+    /* Complete a partial block left by the previous call first */
+    pre = (AES_BLOCK_SIZE - ctx->gcm.mres % AES_BLOCK_SIZE) % AES_BLOCK_SIZE;
+    if (pre > 0) {
+        if (!hw->cipherupdate(ctx, in, pre, out))
+            return 0;
+        in += pre;
+        out += pre;
+        len -= pre;
+    }
+
+    jobs = OPENSSL_malloc(parts * sizeof(*jobs));
+    if (jobs == NULL)
+        return hw->cipherupdate(ctx, in, len, out);
+
+    blen = len & ~(size_t)(AES_BLOCK_SIZE - 1);
+    plen = (blen / parts) & ~(size_t)(AES_BLOCK_SIZE - 1);
+    for (i = 0; i < parts; i++) {
+        jobs[i].part = *ctx;
+        jobs[i].out = out + i * plen;
+        jobs[i].in = in + i * plen;
+        jobs[i].len = i + 1 < parts ? plen : blen - i * plen;
+        if (!hw->split(&jobs[i].part, i * plen))
+            goto err;
+    }
+
+    if (!ossl_cipher_thread_run(ctx->libctx, gcm_job, jobs, sizeof(*jobs),
+                                parts))
+        goto err;
+    for (i = 0; i < parts; i++)
+        if (!hw->join(ctx, &jobs[i].part, jobs[i].len))
+            goto err;
+
+    if (blen < len
+            && !hw->cipherupdate(ctx, in + blen, len - blen, out + blen))
+        goto err;
+    ret = 1;
+err:
+    OPENSSL_clear_free(jobs, parts * sizeof(*jobs));
+    return ret;
+}
+
 static int gcm_cipher_internal(PROV_GCM_CTX *ctx, unsigned char *out,
                                size_t *padlen, const unsigned char *in,
                                size_t len)
 {
-    size_t olen = 0;
+    size_t olen = 0, parts = 1;
     int rv = 0;
     const PROV_GCM_HW *hw = ctx->hw;
 
@@ -441,8 +531,15 @@ static int gcm_cipher_internal(PROV_GCM_CTX *ctx, unsigned char *out,
                 goto err;
         } else {
             /* The input is ciphertext OR plaintext */
-            if (!hw->cipherupdate(ctx, in, len, out))
+            if (hw->split != NULL && hw->join != NULL)
+                parts = ossl_cipher_thread_parts(ctx->libctx, ctx->threads,
+                                                 ctx->thread_threshold, len);
+            if (parts > 1) {
+                if (!gcm_cipher_parallel(ctx, in, len, out, parts))
+                    goto err;
+            } else if (!hw->cipherupdate(ctx, in, len, out)) {
                 goto err;
+            }
         }
     } else {
         /* The tag must be set before actually decrypting data */
@@ -584,3 +681,38 @@ err:
     *padlen = plen;
     return rv;
 }
+
+static int gcm_tls13_seal(void *vctx, const unsigned char *nonce,
+                          const unsigned char *hdr, const unsigned char *in,
+                          size_t len, unsigned char type, unsigned char *out)
+{
+    PROV_GCM_CTX *ctx = (PROV_GCM_CTX *)vctx;
+    const PROV_GCM_HW *hw = ctx->hw;
+
+    return hw->setiv(ctx, nonce, TLS13_NONCE_LEN)
+           && hw->aadupdate(ctx, hdr, TLS13_RECORD_HEADER_LEN)
+           && hw->cipherupdate(ctx, in, len, out)
+           && hw->cipherupdate(ctx, &type, 1, out + len)
+           && hw->cipherfinal(ctx, out + len + 1);
+}
+
+/*
+ * Encrypt several TLS 1.3 records in one call, each with its own nonce,
+ * record header as AAD, and tag.  The plaintext is read straight from the
+ * caller's buffer rather than from a copy in the record.
+ */
+static int gcm_tls13_multirec(PROV_GCM_CTX *ctx, const OSSL_PARAM params[])
+{
+    int ret;
+
+    if (!ossl_prov_is_running() || !ctx->key_set || !ctx->enc
+        || ctx->ivlen != TLS13_NONCE_LEN) {
+        ERR_raise(ERR_LIB_PROV, PROV_R_CIPHER_OPERATION_FAILED);
+        return 0;
+    }
+    ret = ossl_cipher_tls13_multirec(ctx, params, EVP_GCM_TLS_TAG_LEN,
+                                     gcm_tls13_seal);
+    /* Each record had a nonce of its own, none may be used again */
+    ctx->iv_state = IV_STATE_FINISHED;
+    return ret;
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Helpers for splitting large cipher updates over the threads of the library
+ * context thread pool.  These are kept apart from the other generic cipher
+ * code because the thread pool is internal to libcrypto and the FIPS module,
+ * so only providers built with one of those may reference them.
+ */
+
+#include <openssl/err.h>
+#include <openssl/proverr.h>
+#include "prov/ciphercommon.h"
+#include "prov/providercommon.h"
+#if defined(OPENSSL_THREADS) && !defined(OPENSSL_NO_THREAD_POOL)
+# include "internal/thread.h"
+# define CIPHER_THREADS
+#endif
+
+size_t ossl_cipher_thread_parts(OSSL_LIB_CTX *libctx, unsigned int threads,
+                                size_t threshold, size_t len)
+{
+#ifdef CIPHER_THREADS
+    uint64_t avail;
+    size_t parts = threads;
+
+    if (threshold == 0)
+        threshold = PROV_CIPHER_THREAD_THRESHOLD;
+    if (threads <= 1 || len < threshold)
+        return 1;
+
+    /* The caller is one of the threads */
+    avail = ossl_get_avail_threads(libctx);
+    if (avail < parts - 1)
+        parts = (size_t)avail + 1;
+    if (parts > len / GENERIC_BLOCK_SIZE)
+        parts = len / GENERIC_BLOCK_SIZE;
+    return parts > 0 ? parts : 1;
+#else
+    return 1;
+#endif
+}
+
+/*
+ * Run |fn| on each of the |njobs| elements of |jobs|.  The first one runs on
+ * the calling thread, the others on threads from the pool of |libctx|, or on
+ * the calling thread as well if no pool thread can be started.
+ */
+int ossl_cipher_thread_run(OSSL_LIB_CTX *libctx, PROV_CIPHER_JOB_FN *fn,
+                           void *jobs, size_t jobsize, size_t njobs)
+{
+    unsigned char *job = jobs;
+    void **t = NULL;
+    size_t i;
+    int ret = 1;
+
+#ifdef CIPHER_THREADS
+    if (njobs > 1)
+        t = OPENSSL_zalloc(njobs * sizeof(*t));
+    for (i = 1; t != NULL && i < njobs; i++)
+        t[i] = ossl_crypto_thread_start(libctx, fn, job + i * jobsize);
+#endif
+
+    for (i = 0; i < njobs; i++)
+        if ((t == NULL || t[i] == NULL) && fn(job + i * jobsize) == 0)
+            ret = 0;
+
+#ifdef CIPHER_THREADS
+    for (i = 1; t != NULL && i < njobs; i++) {
+        CRYPTO_THREAD_RETVAL retval = 0;
+
+        if (t[i] == NULL)
+            continue;
+        if (!ossl_crypto_thread_join(t[i], &retval) || retval == 0)
+            ret = 0;
+        ossl_crypto_thread_clean(t[i]);
+    }
+    OPENSSL_free(t);
+#endif
+    return ret;
+}
+
+typedef struct {
+    PROV_CIPHER_CTX *ctx;
+    PROV_CIPHER_CTX copy;
+    unsigned char *out;
+    const unsigned char *in;
+    size_t len;
+} CIPHER_CTR_JOB;
+
+/* Add |blocks| to the 128 bit big endian counter |ctr| */
+static void cipher_ctr_add(unsigned char ctr[GENERIC_BLOCK_SIZE], size_t blocks)
+{
+    size_t n = GENERIC_BLOCK_SIZE;
+    uint64_t c = blocks;
+
+    while (n > 0 && c != 0) {
+        --n;
+        c += ctr[n];
+        ctr[n] = (unsigned char)c;
+        c >>= 8;
+    }
+}
+
+static uint32_t cipher_ctr_job(void *vjob)
+{
+    CIPHER_CTR_JOB *job = vjob;
+
+    return ossl_cipher_hw_generic_ctr(job->ctx, job->out, job->in, job->len);
+}
+
+/*
+ * Split a CTR mode update into |parts| pieces that are processed by pool
+ * threads.  All but the last piece are whole blocks and run on copies of the
+ * context with the counter moved to their offset; the last piece runs on
+ * |ctx| itself so that it ends up with the counter and partial block state
+ * of the whole input.
+ */
+static int cipher_ctr_parallel(PROV_CIPHER_CTX *ctx, unsigned char *out,
+                               const unsigned char *in, size_t len,
+                               size_t parts)
+{
+    CIPHER_CTR_JOB *jobs;
+    size_t i, plen, pre;
+    int ret;
+
+    /* Use up the keystream left over from the previous call first */
+    pre = (GENERIC_BLOCK_SIZE - ctx->num) % GENERIC_BLOCK_SIZE;
+    if (pre > 0) {
+        if (!ossl_cipher_hw_generic_ctr(ctx, out, in, pre))
+            return 0;
+        out += pre;
+        in += pre;
+        len -= pre;
+    }
+
+    jobs = OPENSSL_malloc(parts * sizeof(*jobs));
+    if (jobs == NULL)
+        return ossl_cipher_hw_generic_ctr(ctx, out, in, len);
+
+    plen = (len / parts) & ~(size_t)(GENERIC_BLOCK_SIZE - 1);
+    for (i = 1; i < parts; i++) {
+        jobs[i].copy = *ctx;
+        jobs[i].ctx = &jobs[i].copy;
+        cipher_ctr_add(jobs[i].copy.iv, (i - 1) * plen / GENERIC_BLOCK_SIZE);
+        jobs[i].out = out + (i - 1) * plen;
+        jobs[i].in = in + (i - 1) * plen;
+        jobs[i].len = plen;
+    }
+    cipher_ctr_add(ctx->iv, (parts - 1) * plen / GENERIC_BLOCK_SIZE);
+    jobs[0].ctx = ctx;
+    jobs[0].out = out + (parts - 1) * plen;
+    jobs[0].in = in + (parts - 1) * plen;
+    jobs[0].len = len - (parts - 1) * plen;
+
+    ret = ossl_cipher_thread_run(ctx->libctx, cipher_ctr_job, jobs,
+                                 sizeof(*jobs), parts);
+    OPENSSL_clear_free(jobs, parts * sizeof(*jobs));
+    return ret;
+}
+
+int ossl_cipher_generic_ctr_update(void *vctx, unsigned char *out,
+                                   size_t *outl, size_t outsize,
+                                   const unsigned char *in, size_t inl)
+{
+    PROV_CIPHER_CTX *ctx = (PROV_CIPHER_CTX *)vctx;
+    size_t parts = 1;
+
+    /*
+     * CTR mode implementations that only use the generic context state can
+     * be run on several copies of it at once.
+     */
+    if (ctx->hw->cipher == ossl_cipher_hw_generic_ctr && outsize >= inl)
+        parts = ossl_cipher_thread_parts(ctx->libctx, ctx->threads,
+                                         ctx->thread_threshold, inl);
+    if (parts <= 1)
+        return ossl_cipher_generic_stream_update(vctx, out, outl, outsize,
+                                                 in, inl);
+
+    if (!ossl_prov_is_running())
+        return 0;
+    if (!cipher_ctr_parallel(ctx, out, in, inl, parts)) {
+        ERR_raise(ERR_LIB_PROV, PROV_R_CIPHER_OPERATION_FAILED);
+        return 0;
+    }
+    *outl = inl;
+    return 1;
+}
@@ -56,43 +56,66 @@ static int sha1_set_ctx_params(void *vctx, const OSSL_PARAM params[])
     return 1;
 }
 
+static OSSL_FUNC_digest_init_fn sha1_internal_init;
+static int sha1_internal_init(void *ctx, const OSSL_PARAM params[])
+{
+    return ossl_prov_is_running()
+           && SHA1_Init(ctx)
+           && sha1_set_ctx_params(ctx, params);
+}
+
+PROV_FUNC_DIGEST_BATCH(sha1, SHA_CTX, SHA_DIGEST_LENGTH, SHA1_Init,
+                       ossl_sha1_batch)
+
 /* ossl_sha1_functions */
-IMPLEMENT_digest_functions_with_settable_ctx(
-    sha1, SHA_CTX, SHA_CBLOCK, SHA_DIGEST_LENGTH, SHA2_FLAGS,
-    SHA1_Init, SHA1_Update, SHA1_Final,
-    sha1_settable_ctx_params, sha1_set_ctx_params)
+PROV_DISPATCH_FUNC_DIGEST_CONSTRUCT_START(sha1, SHA_CTX, SHA_CBLOCK,
+                                          SHA_DIGEST_LENGTH, SHA2_FLAGS,
+                                          SHA1_Update, SHA1_Final),
+    { OSSL_FUNC_DIGEST_INIT, (void (*)(void))sha1_internal_init },
+    { OSSL_FUNC_DIGEST_SETTABLE_CTX_PARAMS,
+      (void (*)(void))sha1_settable_ctx_params },
+    { OSSL_FUNC_DIGEST_SET_CTX_PARAMS, (void (*)(void))sha1_set_ctx_params },
+    PROV_DISPATCH_FUNC_DIGEST_BATCH(sha1),
+PROV_DISPATCH_FUNC_DIGEST_CONSTRUCT_END
 
 /* ossl_sha224_functions */
-IMPLEMENT_digest_functions(sha224, SHA256_CTX,
+IMPLEMENT_digest_functions_with_batch(sha224, SHA256_CTX,
                            SHA256_CBLOCK, SHA224_DIGEST_LENGTH, SHA2_FLAGS,
-                           SHA224_Init, SHA224_Update, SHA224_Final)
+                           SHA224_Init, SHA224_Update, SHA224_Final,
+                           ossl_sha256_batch)
 
 /* ossl_sha256_functions */
-IMPLEMENT_digest_functions(sha256, SHA256_CTX,
+IMPLEMENT_digest_functions_with_batch(sha256, SHA256_CTX,
                            SHA256_CBLOCK, SHA256_DIGEST_LENGTH, SHA2_FLAGS,
-                           SHA256_Init, SHA256_Update, SHA256_Final)
+                           SHA256_Init, SHA256_Update, SHA256_Final,
+                           ossl_sha256_batch)
 #ifndef FIPS_MODULE
 /* ossl_sha256_192_functions */
-IMPLEMENT_digest_functions(sha256_192, SHA256_CTX,
+IMPLEMENT_digest_functions_with_batch(sha256_192, SHA256_CTX,
                            SHA256_CBLOCK, SHA256_192_DIGEST_LENGTH, SHA2_FLAGS,
-                           ossl_sha256_192_init, SHA256_Update, SHA256_Final)
+                           ossl_sha256_192_init, SHA256_Update, SHA256_Final,
+                           ossl_sha256_batch)
 #endif
 /* ossl_sha384_functions */
-IMPLEMENT_digest_functions(sha384, SHA512_CTX,
+IMPLEMENT_digest_functions_with_batch(sha384, SHA512_CTX,
                            SHA512_CBLOCK, SHA384_DIGEST_LENGTH, SHA2_FLAGS,
-                           SHA384_Init, SHA384_Update, SHA384_Final)
+                           SHA384_Init, SHA384_Update, SHA384_Final,
+                           ossl_sha512_batch)
 
 /* ossl_sha512_functions */
-IMPLEMENT_digest_functions(sha512, SHA512_CTX,
+IMPLEMENT_digest_functions_with_batch(sha512, SHA512_CTX,
                            SHA512_CBLOCK, SHA512_DIGEST_LENGTH, SHA2_FLAGS,
-                           SHA512_Init, SHA512_Update, SHA512_Final)
+                           SHA512_Init, SHA512_Update, SHA512_Final,
+                           ossl_sha512_batch)
 
 /* ossl_sha512_224_functions */
-IMPLEMENT_digest_functions(sha512_224, SHA512_CTX,
+IMPLEMENT_digest_functions_with_batch(sha512_224, SHA512_CTX,
                            SHA512_CBLOCK, SHA224_DIGEST_LENGTH, SHA2_FLAGS,
-                           sha512_224_init, SHA512_Update, SHA512_Final)
+                           sha512_224_init, SHA512_Update, SHA512_Final,
+                           ossl_sha512_batch)
 
 /* ossl_sha512_256_functions */
-IMPLEMENT_digest_functions(sha512_256, SHA512_CTX,
+IMPLEMENT_digest_functions_with_batch(sha512_256, SHA512_CTX,
                            SHA512_CBLOCK, SHA256_DIGEST_LENGTH, SHA2_FLAGS,
-                           sha512_256_init, SHA512_Update, SHA512_Final)
+                           sha512_256_init, SHA512_Update, SHA512_Final,
+                           ossl_sha512_batch)
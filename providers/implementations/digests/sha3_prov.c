@@ -316,6 +316,27 @@ static void *uname##_newctx(void *provctx)                                     \
     return ctx;                                                                \
 }
 
+/* Several messages at once, with the default output length */
+#define SHA3_batch(name, init, bitlen, pad, dgstsize)                          \
+static OSSL_FUNC_digest_batch_fn name##_batch;                                 \
+static int name##_batch(void *provctx, const unsigned char *const in[],        \
+                        const size_t inl[], unsigned char *const out[],        \
+                        size_t num, size_t *outl, size_t outsz)                \
+{                                                                              \
+    KECCAK1600_CTX ctx;                                                        \
+    int ret;                                                                   \
+                                                                               \
+    if (!ossl_prov_is_running() || outsz < dgstsize                            \
+            || !init(&ctx, pad, bitlen))                                       \
+        return 0;                                                              \
+    ctx.md_size = dgstsize;                                                    \
+    ret = ossl_sha3_batch(&ctx, in, inl, out, num);                            \
+    OPENSSL_cleanse(&ctx, sizeof(ctx));                                        \
+    if (ret)                                                                   \
+        *outl = dgstsize;                                                      \
+    return ret;                                                                \
+}
+
 #define PROV_FUNC_SHA3_DIGEST_COMMON(name, bitlen, blksize, dgstsize, flags)   \
 PROV_FUNC_DIGEST_GET_PARAM(name, blksize, dgstsize, flags)                     \
 const OSSL_DISPATCH ossl_##name##_functions[] = {                              \
@@ -324,6 +345,7 @@ const OSSL_DISPATCH ossl_##name##_functions[] = {                              \
     { OSSL_FUNC_DIGEST_FINAL, (void (*)(void))keccak_final },                  \
     { OSSL_FUNC_DIGEST_FREECTX, (void (*)(void))keccak_freectx },              \
     { OSSL_FUNC_DIGEST_DUPCTX, (void (*)(void))keccak_dupctx },                \
+    PROV_DISPATCH_FUNC_DIGEST_BATCH(name),                                     \
     PROV_DISPATCH_FUNC_DIGEST_GET_PARAMS(name)
 
 #define PROV_FUNC_SHA3_DIGEST(name, bitlen, blksize, dgstsize, flags)          \
@@ -387,23 +409,31 @@ static int shake_set_ctx_params(void *vctx, const OSSL_PARAM params[])
 
 #define IMPLEMENT_SHA3_functions(bitlen)                                       \
     SHA3_newctx(sha3, SHA3_##bitlen, sha3_##bitlen, bitlen, '\x06')            \
+    SHA3_batch(sha3_##bitlen, ossl_sha3_init, bitlen, '\x06',                  \
+               SHA3_MDSIZE(bitlen))                                            \
     PROV_FUNC_SHA3_DIGEST(sha3_##bitlen, bitlen,                               \
                           SHA3_BLOCKSIZE(bitlen), SHA3_MDSIZE(bitlen),         \
                           SHA3_FLAGS)
 
 #define IMPLEMENT_KECCAK_functions(bitlen)                                     \
     SHA3_newctx(keccak, KECCAK_##bitlen, keccak_##bitlen, bitlen, '\x01')      \
+    SHA3_batch(keccak_##bitlen, ossl_sha3_init, bitlen, '\x01',                \
+               SHA3_MDSIZE(bitlen))                                            \
     PROV_FUNC_SHA3_DIGEST(keccak_##bitlen, bitlen,                             \
                           SHA3_BLOCKSIZE(bitlen), SHA3_MDSIZE(bitlen),         \
                           SHA3_FLAGS)
 
 #define IMPLEMENT_SHAKE_functions(bitlen)                                      \
     SHA3_newctx(shake, SHAKE_##bitlen, shake_##bitlen, bitlen, '\x1f')         \
+    SHA3_batch(shake_##bitlen, ossl_sha3_init, bitlen, '\x1f',                 \
+               SHA3_MDSIZE(bitlen))                                            \
     PROV_FUNC_SHAKE_DIGEST(shake_##bitlen, bitlen,                             \
                           SHA3_BLOCKSIZE(bitlen), SHA3_MDSIZE(bitlen),         \
                           SHAKE_FLAGS)
 #define IMPLEMENT_KMAC_functions(bitlen)                                       \
     KMAC_newctx(keccak_kmac_##bitlen, bitlen, '\x04')                          \
+    SHA3_batch(keccak_kmac_##bitlen, ossl_keccak_kmac_init, bitlen, '\x04',    \
+               KMAC_MDSIZE(bitlen))                                            \
     PROV_FUNC_SHAKE_DIGEST(keccak_kmac_##bitlen, bitlen,                       \
                            SHA3_BLOCKSIZE(bitlen), KMAC_MDSIZE(bitlen),        \
                            KMAC_FLAGS)
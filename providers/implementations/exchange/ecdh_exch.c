@@ -1,5 +1,5 @@
 /*
- * Copyright 2020-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2020-2023 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -32,6 +32,7 @@ static OSSL_FUNC_keyexch_newctx_fn ecdh_newctx;
 static OSSL_FUNC_keyexch_init_fn ecdh_init;
 static OSSL_FUNC_keyexch_set_peer_fn ecdh_set_peer;
 static OSSL_FUNC_keyexch_derive_fn ecdh_derive;
+static OSSL_FUNC_keyexch_derive_batch_fn ecdh_derive_batch;
 static OSSL_FUNC_keyexch_freectx_fn ecdh_freectx;
 static OSSL_FUNC_keyexch_dupctx_fn ecdh_dupctx;
 static OSSL_FUNC_keyexch_set_ctx_params_fn ecdh_set_ctx_params;
@@ -426,39 +427,20 @@ size_t ecdh_size(const EC_KEY *k)
     return (degree + 7) / 8;
 }
 
-static ossl_inline
-int ecdh_plain_derive(void *vpecdhctx, unsigned char *secret,
-                      size_t *psecretlen, size_t outlen)
+/*
+ * Get the private key to compute with, which is |k| itself unless the
+ * cofactor mode of the context calls for a duplicate with another one.
+ */
+static EC_KEY *ecdh_cofactor_key(PROV_ECDH_CTX *pecdhctx, EC_KEY *k)
 {
-    PROV_ECDH_CTX *pecdhctx = (PROV_ECDH_CTX *)vpecdhctx;
-    int retlen, ret = 0;
-    size_t ecdhsize, size;
-    const EC_POINT *ppubkey = NULL;
-    EC_KEY *privk = NULL;
+    EC_KEY *privk;
     const EC_GROUP *group;
     const BIGNUM *cofactor;
     int key_cofactor_mode;
 
-    if (pecdhctx->k == NULL || pecdhctx->peerk == NULL) {
-        ERR_raise(ERR_LIB_PROV, PROV_R_MISSING_KEY);
-        return 0;
-    }
-
-    ecdhsize = ecdh_size(pecdhctx->k);
-    if (secret == NULL) {
-        *psecretlen = ecdhsize;
-        return 1;
-    }
-
-    if ((group = EC_KEY_get0_group(pecdhctx->k)) == NULL
+    if ((group = EC_KEY_get0_group(k)) == NULL
             || (cofactor = EC_GROUP_get0_cofactor(group)) == NULL)
-        return 0;
-
-    /*
-     * NB: unlike PKCS#3 DH, if outlen is less than maximum size this is not
-     * an error, the result is truncated.
-     */
-    size = outlen < ecdhsize ? outlen : ecdhsize;
+        return NULL;
 
     /*
      * The ctx->cofactor_mode flag has precedence over the
@@ -473,21 +455,53 @@ int ecdh_plain_derive(void *vpecdhctx, unsigned char *secret,
      *          set to ctx->cofactor_mode
      */
     key_cofactor_mode =
-        (EC_KEY_get_flags(pecdhctx->k) & EC_FLAG_COFACTOR_ECDH) ? 1 : 0;
+        (EC_KEY_get_flags(k) & EC_FLAG_COFACTOR_ECDH) ? 1 : 0;
     if (pecdhctx->cofactor_mode != -1
             && pecdhctx->cofactor_mode != key_cofactor_mode
             && !BN_is_one(cofactor)) {
-        if ((privk = EC_KEY_dup(pecdhctx->k)) == NULL)
-            return 0;
+        if ((privk = EC_KEY_dup(k)) == NULL)
+            return NULL;
 
         if (pecdhctx->cofactor_mode == 1)
             EC_KEY_set_flags(privk, EC_FLAG_COFACTOR_ECDH);
         else
             EC_KEY_clear_flags(privk, EC_FLAG_COFACTOR_ECDH);
     } else {
-        privk = pecdhctx->k;
+        privk = k;
+    }
+    return privk;
+}
+
+static ossl_inline
+int ecdh_plain_derive(void *vpecdhctx, unsigned char *secret,
+                      size_t *psecretlen, size_t outlen)
+{
+    PROV_ECDH_CTX *pecdhctx = (PROV_ECDH_CTX *)vpecdhctx;
+    int retlen, ret = 0;
+    size_t ecdhsize, size;
+    const EC_POINT *ppubkey = NULL;
+    EC_KEY *privk = NULL;
+
+    if (pecdhctx->k == NULL || pecdhctx->peerk == NULL) {
+        ERR_raise(ERR_LIB_PROV, PROV_R_MISSING_KEY);
+        return 0;
     }
 
+    ecdhsize = ecdh_size(pecdhctx->k);
+    if (secret == NULL) {
+        *psecretlen = ecdhsize;
+        return 1;
+    }
+
+    /*
+     * NB: unlike PKCS#3 DH, if outlen is less than maximum size this is not
+     * an error, the result is truncated.
+     */
+    size = outlen < ecdhsize ? outlen : ecdhsize;
+
+    if ((privk = ecdh_cofactor_key(pecdhctx, pecdhctx->k)) == NULL)
+        return 0;
+
     ppubkey = EC_KEY_get0_public_key(pecdhctx->peerk);
 
     retlen = ECDH_compute_key(secret, size, ppubkey, privk, NULL);
@@ -562,10 +576,107 @@ int ecdh_derive(void *vpecdhctx, unsigned char *secret,
     return 0;
 }
 
+/*
+ * The shared secrets of each run of keys on the same curve are computed
+ * together by ossl_ecdh_compute_key_batch(), which shares the conversion
+ * of the resulting points to affine coordinates.  The parameters of the
+ * context, including its KDF, apply to all the items.
+ */
+static
+int ecdh_derive_batch(void *vpecdhctx, void *const provkeys[],
+                      void *const provpeers[], unsigned char *const secret[],
+                      size_t secretlen[], const size_t outlen[], size_t num)
+{
+    PROV_ECDH_CTX *pecdhctx = (PROV_ECDH_CTX *)vpecdhctx;
+    EC_KEY **privk = NULL;
+    const EC_POINT **pub = NULL;
+    unsigned char **out = NULL;
+    size_t *len = NULL;
+    size_t i, n, ecdhsize;
+    int kdf = pecdhctx->kdf_type == PROV_ECDH_KDF_X9_63, ret = 0;
+
+    if (!ossl_prov_is_running())
+        return 0;
+    if (pecdhctx->kdf_type != PROV_ECDH_KDF_NONE && !kdf)
+        return 0;
+
+    if ((privk = OPENSSL_zalloc(num * sizeof(*privk))) == NULL
+            || (pub = OPENSSL_malloc(num * sizeof(*pub))) == NULL
+            || (out = OPENSSL_zalloc(num * sizeof(*out))) == NULL
+            || (len = OPENSSL_zalloc(num * sizeof(*len))) == NULL)
+        goto end;
+
+    for (i = 0; i < num; i++) {
+        if (!ecdh_match_params(provkeys[i], provpeers[i])
+                || !ossl_ec_check_key(pecdhctx->libctx, provkeys[i], 1)
+                || !ossl_ec_check_key(pecdhctx->libctx, provpeers[i], 1)
+                || (privk[i] = ecdh_cofactor_key(pecdhctx,
+                                                 provkeys[i])) == NULL)
+            goto end;
+        pub[i] = EC_KEY_get0_public_key(provpeers[i]);
+
+        ecdhsize = ecdh_size(provkeys[i]);
+        if (kdf) {
+            if (pecdhctx->kdf_outlen > outlen[i]) {
+                ERR_raise(ERR_LIB_PROV, PROV_R_OUTPUT_BUFFER_TOO_SMALL);
+                goto end;
+            }
+            if ((out[i] = OPENSSL_secure_malloc(ecdhsize)) == NULL)
+                goto end;
+            len[i] = ecdhsize;
+        } else {
+            /* Truncated as by ecdh_plain_derive() */
+            out[i] = secret[i];
+            len[i] = outlen[i] < ecdhsize ? outlen[i] : ecdhsize;
+        }
+    }
+
+    for (i = 0; i < num; i += n) {
+        for (n = 1; i + n < num; n++)
+            if (EC_GROUP_cmp(EC_KEY_get0_group(privk[i]),
+                             EC_KEY_get0_group(privk[i + n]), NULL) != 0)
+                break;
+        if (!ossl_ecdh_compute_key_batch(out + i, len + i, pub + i,
+                                         privk + i, n))
+            goto end;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (!kdf) {
+            secretlen[i] = len[i];
+            continue;
+        }
+        if (!ossl_ecdh_kdf_X9_63(secret[i], pecdhctx->kdf_outlen,
+                                 out[i], len[i],
+                                 pecdhctx->kdf_ukm,
+                                 pecdhctx->kdf_ukmlen,
+                                 pecdhctx->kdf_md,
+                                 pecdhctx->libctx, NULL))
+            goto end;
+        secretlen[i] = pecdhctx->kdf_outlen;
+    }
+    ret = 1;
+
+ end:
+    if (privk != NULL)
+        for (i = 0; i < num; i++)
+            if (privk[i] != provkeys[i])
+                EC_KEY_free(privk[i]);
+    if (kdf && out != NULL)
+        for (i = 0; i < num; i++)
+            OPENSSL_secure_clear_free(out[i], len[i]);
+    OPENSSL_free(privk);
+    OPENSSL_free(pub);
+    OPENSSL_free(out);
+    OPENSSL_free(len);
+    return ret;
+}
+
 const OSSL_DISPATCH ossl_ecdh_keyexch_functions[] = {
     { OSSL_FUNC_KEYEXCH_NEWCTX, (void (*)(void))ecdh_newctx },
     { OSSL_FUNC_KEYEXCH_INIT, (void (*)(void))ecdh_init },
     { OSSL_FUNC_KEYEXCH_DERIVE, (void (*)(void))ecdh_derive },
+    { OSSL_FUNC_KEYEXCH_DERIVE_BATCH, (void (*)(void))ecdh_derive_batch },
     { OSSL_FUNC_KEYEXCH_SET_PEER, (void (*)(void))ecdh_set_peer },
     { OSSL_FUNC_KEYEXCH_FREECTX, (void (*)(void))ecdh_freectx },
     { OSSL_FUNC_KEYEXCH_DUPCTX, (void (*)(void))ecdh_dupctx },
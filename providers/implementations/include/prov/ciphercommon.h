@@ -34,6 +34,7 @@ typedef struct prov_cipher_ctx_st PROV_CIPHER_CTX;
 
 typedef int (PROV_CIPHER_HW_FN)(PROV_CIPHER_CTX *dat, unsigned char *out,
                                 const unsigned char *in, size_t len);
+typedef uint32_t (PROV_CIPHER_JOB_FN)(void *job);
 
 /* Internal flags that can be queried */
 # define PROV_CIPHER_FLAG_AEAD             0x0001
@@ -41,6 +42,7 @@ typedef int (PROV_CIPHER_HW_FN)(PROV_CIPHER_CTX *dat, unsigned char *out,
 # define PROV_CIPHER_FLAG_CTS              0x0004
 # define PROV_CIPHER_FLAG_TLS1_MULTIBLOCK  0x0008
 # define PROV_CIPHER_FLAG_RAND_KEY         0x0010
+# define PROV_CIPHER_FLAG_TLS13_MULTIREC   0x0020
 /* Internal flags that are only used within the provider */
 # define PROV_CIPHER_FLAG_VARIABLE_LENGTH  0x0100
 # define PROV_CIPHER_FLAG_INVERSE_CIPHER   0x0200
@@ -96,6 +98,8 @@ struct prov_cipher_ctx_st {
     const PROV_CIPHER_HW *hw; /* hardware specific functions */
     const void *ks; /* Pointer to algorithm specific key data */
     OSSL_LIB_CTX *libctx;
+    unsigned int threads;    /* Most threads a single update may use */
+    size_t thread_threshold; /* Smallest update that is split over threads */
 };
 
 struct prov_cipher_hw_st {
@@ -111,6 +115,9 @@ OSSL_FUNC_cipher_update_fn ossl_cipher_generic_block_update;
 OSSL_FUNC_cipher_final_fn ossl_cipher_generic_block_final;
 OSSL_FUNC_cipher_update_fn ossl_cipher_generic_stream_update;
 OSSL_FUNC_cipher_final_fn ossl_cipher_generic_stream_final;
+/* Stream update that may split large CTR mode inputs over pool threads */
+OSSL_FUNC_cipher_update_fn ossl_cipher_generic_ctr_update;
+# define ossl_cipher_generic_ctr_final ossl_cipher_generic_stream_final
 OSSL_FUNC_cipher_cipher_fn ossl_cipher_generic_cipher;
 OSSL_FUNC_cipher_get_ctx_params_fn ossl_cipher_generic_get_ctx_params;
 OSSL_FUNC_cipher_set_ctx_params_fn ossl_cipher_generic_set_ctx_params;
@@ -122,6 +129,14 @@ OSSL_FUNC_cipher_settable_ctx_params_fn ossl_cipher_var_keylen_settable_ctx_para
 OSSL_FUNC_cipher_gettable_ctx_params_fn ossl_cipher_aead_gettable_ctx_params;
 OSSL_FUNC_cipher_settable_ctx_params_fn ossl_cipher_aead_settable_ctx_params;
 
+/* Default for OSSL_CIPHER_PARAM_THREAD_THRESHOLD */
+# define PROV_CIPHER_THREAD_THRESHOLD (1024 * 1024)
+
+size_t ossl_cipher_thread_parts(OSSL_LIB_CTX *libctx, unsigned int threads,
+                                size_t threshold, size_t len);
+int ossl_cipher_thread_run(OSSL_LIB_CTX *libctx, PROV_CIPHER_JOB_FN *fn,
+                           void *jobs, size_t jobsize, size_t njobs);
+
 int ossl_cipher_generic_get_params(OSSL_PARAM params[], unsigned int md,
                                    uint64_t flags,
                                    size_t kbits, size_t blkbits, size_t ivbits);
@@ -365,4 +380,20 @@ int ossl_cipher_trailingdata(unsigned char *buf, size_t *buflen,
                              size_t blocksize,
                              const unsigned char **in, size_t *inlen);
 
+# define TLS13_RECORD_HEADER_LEN 5
+# define TLS13_NONCE_LEN         12
+# define TLS13_SEQ_LEN           8
+
+/*
+ * Seals one TLS 1.3 record: |len| bytes of |in| followed by the inner content
+ * |type| are encrypted to |out| under |nonce| with |hdr| as the AAD, and the
+ * tag is written after them.
+ */
+PROV_CIPHER_FUNC(int, tls13_seal, (void *vctx, const unsigned char *nonce,
+                                   const unsigned char *hdr,
+                                   const unsigned char *in, size_t len,
+                                   unsigned char type, unsigned char *out));
+int ossl_cipher_tls13_multirec(void *vctx, const OSSL_PARAM params[],
+                               size_t taglen, OSSL_tls13_seal_fn seal);
+
 #endif
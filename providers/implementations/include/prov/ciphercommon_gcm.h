@@ -80,6 +80,8 @@ typedef struct prov_gcm_ctx_st {
     GCM128_CONTEXT gcm;
     ctr128_f ctr;
     const void *ks;
+    unsigned int threads;    /* Most threads a single update may use */
+    size_t thread_threshold; /* Smallest update that is split over threads */
 } PROV_GCM_CTX;
 
 PROV_CIPHER_FUNC(int, GCM_setkey, (PROV_GCM_CTX *ctx, const unsigned char *key,
@@ -96,6 +98,14 @@ PROV_CIPHER_FUNC(int, GCM_oneshot, (PROV_GCM_CTX *ctx, unsigned char *aad,
                                     size_t aad_len, const unsigned char *in,
                                     size_t in_len, unsigned char *out,
                                     unsigned char *tag, size_t taglen));
+/*
+ * Optional, for splitting an update over threads: split() prepares a copy of
+ * the context to process data |offset| bytes further on with an empty hash,
+ * join() folds such a copy that processed |len| bytes back into the context.
+ */
+PROV_CIPHER_FUNC(int, GCM_split, (PROV_GCM_CTX *part, size_t offset));
+PROV_CIPHER_FUNC(int, GCM_join, (PROV_GCM_CTX *ctx, PROV_GCM_CTX *part,
+                                 size_t len));
 struct prov_gcm_hw_st {
   OSSL_GCM_setkey_fn setkey;
   OSSL_GCM_setiv_fn setiv;
@@ -103,6 +113,8 @@ struct prov_gcm_hw_st {
   OSSL_GCM_cipherupdate_fn cipherupdate;
   OSSL_GCM_cipherfinal_fn cipherfinal;
   OSSL_GCM_oneshot_fn oneshot;
+  OSSL_GCM_split_fn split;
+  OSSL_GCM_join_fn join;
 };
 
 OSSL_FUNC_cipher_encrypt_init_fn ossl_gcm_einit;
@@ -124,6 +136,8 @@ int ossl_gcm_one_shot(PROV_GCM_CTX *ctx, unsigned char *aad, size_t aad_len,
                       unsigned char *out, unsigned char *tag, size_t tag_len);
 int ossl_gcm_cipher_update(PROV_GCM_CTX *ctx, const unsigned char *in,
                            size_t len, unsigned char *out);
+int ossl_gcm_split(PROV_GCM_CTX *part, size_t offset);
+int ossl_gcm_join(PROV_GCM_CTX *ctx, PROV_GCM_CTX *part, size_t len);
 
 # define GCM_HW_SET_KEY_CTR_FN(ks, fn_set_enc_key, fn_block, fn_ctr)            \
     ctx->ks = ks;                                                              \
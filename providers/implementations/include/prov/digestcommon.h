@@ -47,6 +47,32 @@ static int name##_internal_final(void *ctx, unsigned char *out, size_t *outl,  \
     return 0;                                                                  \
 }
 
+/*
+ * One-shot digests of several messages, each hashed from a state set up by
+ * |init|.  |batch| is free to process several of them at a time.
+ */
+# define PROV_FUNC_DIGEST_BATCH(name, CTX, dgstsize, init, batch)              \
+static OSSL_FUNC_digest_batch_fn name##_batch;                                 \
+static int name##_batch(ossl_unused void *provctx,                             \
+                        const unsigned char *const in[], const size_t inl[],   \
+                        unsigned char *const out[], size_t num,                \
+                        size_t *outl, size_t outsz)                            \
+{                                                                              \
+    CTX ctx;                                                                   \
+    int ret;                                                                   \
+                                                                               \
+    if (!ossl_prov_is_running() || outsz < dgstsize || !init(&ctx))            \
+        return 0;                                                              \
+    ret = batch(&ctx, in, inl, out, num);                                      \
+    OPENSSL_cleanse(&ctx, sizeof(ctx));                                        \
+    if (ret)                                                                   \
+        *outl = dgstsize;                                                      \
+    return ret;                                                                \
+}
+
+# define PROV_DISPATCH_FUNC_DIGEST_BATCH(name)                                 \
+    { OSSL_FUNC_DIGEST_BATCH, (void (*)(void))name##_batch }
+
 # define PROV_DISPATCH_FUNC_DIGEST_CONSTRUCT_START(                            \
     name, CTX, blksize, dgstsize, flags, upd, fin)                             \
 static OSSL_FUNC_digest_newctx_fn name##_newctx;                               \
@@ -114,6 +140,20 @@ PROV_DISPATCH_FUNC_DIGEST_CONSTRUCT_START(name, CTX, blksize, dgstsize, flags, \
     { OSSL_FUNC_DIGEST_SET_CTX_PARAMS, (void (*)(void))set_ctx_params },       \
 PROV_DISPATCH_FUNC_DIGEST_CONSTRUCT_END
 
+# define IMPLEMENT_digest_functions_with_batch(                                \
+    name, CTX, blksize, dgstsize, flags, init, upd, fin, batch)                \
+static OSSL_FUNC_digest_init_fn name##_internal_init;                          \
+static int name##_internal_init(void *ctx,                                     \
+                                ossl_unused const OSSL_PARAM params[])         \
+{                                                                              \
+    return ossl_prov_is_running() && init(ctx);                                \
+}                                                                              \
+PROV_FUNC_DIGEST_BATCH(name, CTX, dgstsize, init, batch)                       \
+PROV_DISPATCH_FUNC_DIGEST_CONSTRUCT_START(name, CTX, blksize, dgstsize, flags, \
+                                          upd, fin),                           \
+    { OSSL_FUNC_DIGEST_INIT, (void (*)(void))name##_internal_init },           \
+    PROV_DISPATCH_FUNC_DIGEST_BATCH(name),                                     \
+PROV_DISPATCH_FUNC_DIGEST_CONSTRUCT_END
 
 const OSSL_PARAM *ossl_digest_default_gettable_params(void *provctx);
 int ossl_digest_default_get_params(OSSL_PARAM params[], size_t blksz,
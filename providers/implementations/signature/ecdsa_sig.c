@@ -1,5 +1,5 @@
 /*
- * Copyright 2020-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2020-2023 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -14,6 +14,7 @@
 #include "internal/deprecated.h"
 
 #include <string.h> /* memcpy */
+#include <limits.h>
 #include <openssl/crypto.h>
 #include <openssl/core_dispatch.h>
 #include <openssl/core_names.h>
@@ -37,6 +38,7 @@ static OSSL_FUNC_signature_newctx_fn ecdsa_newctx;
 static OSSL_FUNC_signature_sign_init_fn ecdsa_sign_init;
 static OSSL_FUNC_signature_verify_init_fn ecdsa_verify_init;
 static OSSL_FUNC_signature_sign_fn ecdsa_sign;
+static OSSL_FUNC_signature_sign_batch_fn ecdsa_sign_batch;
 static OSSL_FUNC_signature_verify_fn ecdsa_verify;
 static OSSL_FUNC_signature_digest_sign_init_fn ecdsa_digest_sign_init;
 static OSSL_FUNC_signature_digest_sign_update_fn ecdsa_digest_signverify_update;
@@ -211,6 +213,117 @@ static int ecdsa_sign(void *vctx, unsigned char *sig, size_t *siglen,
     return 1;
 }
 
+/*
+ * Sign with each key in turn, for the cases that the batch doesn't handle.
+ * ecdsa_sign() only looks at the key of the context, so that is swapped.
+ */
+static int ecdsa_sign_one_by_one(PROV_ECDSA_CTX *ctx, void *const provkeys[],
+                                 unsigned char *const sig[], size_t siglen[],
+                                 const size_t sigsize[],
+                                 const unsigned char *const tbs[],
+                                 const size_t tbslen[], size_t num)
+{
+    EC_KEY *ec = ctx->ec;
+    size_t i;
+    int ret = 1;
+
+    for (i = 0; i < num && ret; i++) {
+        ctx->ec = provkeys[i];
+        ret = ecdsa_sign(ctx, sig[i], &siglen[i], sigsize[i], tbs[i],
+                         tbslen[i]);
+    }
+    ctx->ec = ec;
+    return ret;
+}
+
+/*
+ * The nonces of each run of keys on the same curve are set up together by
+ * ossl_ecdsa_sign_setup_batch(), which shares the inversions among them,
+ * and each signature is then finished with its own pair.
+ */
+static int ecdsa_sign_batch(void *vctx, void *const provkeys[],
+                            unsigned char *const sig[], size_t siglen[],
+                            const size_t sigsize[],
+                            const unsigned char *const tbs[],
+                            const size_t tbslen[], size_t num)
+{
+    PROV_ECDSA_CTX *ctx = (PROV_ECDSA_CTX *)vctx;
+    EC_KEY **ec = NULL;
+    BIGNUM **kinv = NULL, **r = NULL;
+    int *dlen = NULL;
+    unsigned int sltmp;
+    size_t i, j, n, ecsize;
+    int ret = 0;
+
+    if (!ossl_prov_is_running())
+        return 0;
+
+    /* Deterministic and KAT nonces are not for batches */
+    if (ctx->nonce_type != 0 || ctx->kinv != NULL || ctx->r != NULL
+#if !defined(OPENSSL_NO_ACVP_TESTS)
+        || ctx->kattest
+#endif
+        )
+        return ecdsa_sign_one_by_one(ctx, provkeys, sig, siglen, sigsize,
+                                     tbs, tbslen, num);
+
+    if ((ec = OPENSSL_malloc(num * sizeof(*ec))) == NULL
+            || (dlen = OPENSSL_malloc(num * sizeof(*dlen))) == NULL
+            || (kinv = OPENSSL_zalloc(num * sizeof(*kinv))) == NULL
+            || (r = OPENSSL_zalloc(num * sizeof(*r))) == NULL)
+        goto end;
+
+    for (i = 0; i < num; i++) {
+        ec[i] = provkeys[i];
+        if (!ossl_ec_check_key(ctx->libctx, ec[i], 1))
+            goto end;
+        ecsize = ECDSA_size(ec[i]);
+        if (sigsize[i] < ecsize) {
+            ERR_raise_data(ERR_LIB_PROV, PROV_R_INVALID_SIGNATURE_SIZE,
+                           "is %zu, should be at least %zu", sigsize[i],
+                           ecsize);
+            goto end;
+        }
+        if ((ctx->mdsize != 0 && tbslen[i] != ctx->mdsize)
+            || tbslen[i] > INT_MAX) {
+            ERR_raise(ERR_LIB_PROV, PROV_R_INVALID_DIGEST_LENGTH);
+            goto end;
+        }
+        dlen[i] = (int)tbslen[i];
+    }
+
+    for (i = 0; i < num; i += n) {
+        for (n = 1; i + n < num; n++)
+            if (EC_GROUP_cmp(EC_KEY_get0_group(ec[i]),
+                             EC_KEY_get0_group(ec[i + n]), NULL) != 0)
+                break;
+        if (!ossl_ecdsa_sign_setup_batch(ec + i, tbs + i, dlen + i, kinv + i,
+                                         r + i, n)) {
+            ERR_raise(ERR_LIB_PROV, ERR_R_EC_LIB);
+            goto end;
+        }
+        for (j = i; j < i + n; j++) {
+            if (ECDSA_sign_ex(0, tbs[j], dlen[j], sig[j], &sltmp, kinv[j],
+                              r[j], ec[j]) <= 0)
+                goto end;
+            siglen[j] = sltmp;
+        }
+    }
+    ret = 1;
+
+ end:
+    if (kinv != NULL && r != NULL)
+        for (i = 0; i < num; i++) {
+            BN_clear_free(kinv[i]);
+            BN_clear_free(r[i]);
+        }
+    OPENSSL_free(ec);
+    OPENSSL_free(dlen);
+    OPENSSL_free(kinv);
+    OPENSSL_free(r);
+    return ret;
+}
+
 static int ecdsa_verify(void *vctx, const unsigned char *sig, size_t siglen,
                         const unsigned char *tbs, size_t tbslen)
 {
@@ -605,6 +718,7 @@ const OSSL_DISPATCH ossl_ecdsa_signature_functions[] = {
     { OSSL_FUNC_SIGNATURE_NEWCTX, (void (*)(void))ecdsa_newctx },
     { OSSL_FUNC_SIGNATURE_SIGN_INIT, (void (*)(void))ecdsa_sign_init },
     { OSSL_FUNC_SIGNATURE_SIGN, (void (*)(void))ecdsa_sign },
+    { OSSL_FUNC_SIGNATURE_SIGN_BATCH, (void (*)(void))ecdsa_sign_batch },
     { OSSL_FUNC_SIGNATURE_VERIFY_INIT, (void (*)(void))ecdsa_verify_init },
     { OSSL_FUNC_SIGNATURE_VERIFY, (void (*)(void))ecdsa_verify },
     { OSSL_FUNC_SIGNATURE_DIGEST_SIGN_INIT,
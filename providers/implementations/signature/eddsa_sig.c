@@ -1,5 +1,5 @@
 /*
- * Copyright 2020-2021 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2020-2023 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -66,7 +66,9 @@ static OSSL_FUNC_signature_digest_sign_init_fn eddsa_digest_signverify_init;
 static OSSL_FUNC_signature_digest_sign_fn ed25519_digest_sign;
 static OSSL_FUNC_signature_digest_sign_fn ed448_digest_sign;
 static OSSL_FUNC_signature_digest_verify_fn ed25519_digest_verify;
+static OSSL_FUNC_signature_verify_init_fn eddsa_verify_init;
 static OSSL_FUNC_signature_digest_verify_fn ed448_digest_verify;
+static OSSL_FUNC_signature_verify_batch_fn ed25519_verify_batch;
 static OSSL_FUNC_signature_freectx_fn eddsa_freectx;
 static OSSL_FUNC_signature_dupctx_fn eddsa_dupctx;
 static OSSL_FUNC_signature_get_ctx_params_fn eddsa_get_ctx_params;
@@ -232,6 +234,13 @@ static int eddsa_digest_signverify_init(void *vpeddsactx, const char *mdname,
     return 1;
 }
 
+/* Pure EdDSA through EVP_PKEY_verify() and EVP_PKEY_verify_batch() */
+static int eddsa_verify_init(void *vpeddsactx, void *vedkey,
+                             const OSSL_PARAM params[])
+{
+    return eddsa_digest_signverify_init(vpeddsactx, NULL, vedkey, params);
+}
+
 int ed25519_digest_sign(void *vpeddsactx, unsigned char *sigret,
                         size_t *siglen, size_t sigsize,
                         const unsigned char *tbs, size_t tbslen)
@@ -446,6 +455,78 @@ int ed448_digest_verify(void *vpeddsactx, const unsigned char *sig,
                              peddsactx->prehash_flag, edkey->propq);
 }
 
+/*
+ * All the signatures are checked at once, see ossl_ed25519_verify_batch()
+ * for how that differs from checking them one by one.
+ */
+static int ed25519_verify_batch(void *vpeddsactx, void *const vedkeys[],
+                                const unsigned char *const sig[],
+                                const size_t siglen[],
+                                const unsigned char *const tbs[],
+                                const size_t tbslen[], size_t num)
+{
+    PROV_EDDSA_CTX *peddsactx = (PROV_EDDSA_CTX *)vpeddsactx;
+    const ECX_KEY *edkey;
+    const uint8_t **pub = NULL, **ph = NULL;
+    size_t *phlen = NULL;
+    uint8_t *md = NULL;
+    size_t i, mdlen;
+    int ret = 0;
+
+    if (!ossl_prov_is_running())
+        return 0;
+
+    if (num == 0)
+        return 1;
+
+    pub = OPENSSL_malloc(num * sizeof(*pub));
+    if (pub == NULL)
+        return 0;
+    for (i = 0; i < num; i++) {
+        edkey = (const ECX_KEY *)vedkeys[i];
+        if (edkey->type != ECX_KEY_TYPE_ED25519) {
+            ERR_raise(ERR_LIB_PROV, PROV_R_INVALID_KEY);
+            goto err;
+        }
+        if (siglen[i] != ED25519_SIGSIZE)
+            goto err;
+        pub[i] = edkey->pubkey;
+    }
+
+    if (peddsactx->prehash_flag) {
+        ph = OPENSSL_malloc(num * sizeof(*ph));
+        phlen = OPENSSL_malloc(num * sizeof(*phlen));
+        md = OPENSSL_malloc(num * EDDSA_PREHASH_OUTPUT_LEN);
+        if (ph == NULL || phlen == NULL || md == NULL)
+            goto err;
+        for (i = 0; i < num; i++) {
+            if (!EVP_Q_digest(peddsactx->libctx, SN_sha512, NULL, tbs[i],
+                              tbslen[i], md + i * EDDSA_PREHASH_OUTPUT_LEN,
+                              &mdlen)
+                    || mdlen != EDDSA_PREHASH_OUTPUT_LEN)
+                goto err;
+            ph[i] = md + i * EDDSA_PREHASH_OUTPUT_LEN;
+            phlen[i] = mdlen;
+        }
+        tbs = ph;
+        tbslen = phlen;
+    }
+
+    ret = ossl_ed25519_verify_batch(tbs, tbslen, sig, pub, num,
+                                    peddsactx->dom2_flag,
+                                    peddsactx->prehash_flag,
+                                    peddsactx->context_string_flag,
+                                    peddsactx->context_string,
+                                    peddsactx->context_string_len,
+                                    peddsactx->libctx, peddsactx->key->propq);
+ err:
+    OPENSSL_free(pub);
+    OPENSSL_free(ph);
+    OPENSSL_free(phlen);
+    OPENSSL_free(md);
+    return ret;
+}
+
 static void eddsa_freectx(void *vpeddsactx)
 {
     PROV_EDDSA_CTX *peddsactx = (PROV_EDDSA_CTX *)vpeddsactx;
@@ -599,6 +680,10 @@ const OSSL_DISPATCH ossl_ed25519_signature_functions[] = {
       (void (*)(void))eddsa_digest_signverify_init },
     { OSSL_FUNC_SIGNATURE_DIGEST_VERIFY,
       (void (*)(void))ed25519_digest_verify },
+    { OSSL_FUNC_SIGNATURE_VERIFY_INIT, (void (*)(void))eddsa_verify_init },
+    { OSSL_FUNC_SIGNATURE_VERIFY, (void (*)(void))ed25519_digest_verify },
+    { OSSL_FUNC_SIGNATURE_VERIFY_BATCH,
+      (void (*)(void))ed25519_verify_batch },
     { OSSL_FUNC_SIGNATURE_FREECTX, (void (*)(void))eddsa_freectx },
     { OSSL_FUNC_SIGNATURE_DUPCTX, (void (*)(void))eddsa_dupctx },
     { OSSL_FUNC_SIGNATURE_GET_CTX_PARAMS, (void (*)(void))eddsa_get_ctx_params },
@@ -620,6 +705,8 @@ const OSSL_DISPATCH ossl_ed448_signature_functions[] = {
       (void (*)(void))eddsa_digest_signverify_init },
     { OSSL_FUNC_SIGNATURE_DIGEST_VERIFY,
       (void (*)(void))ed448_digest_verify },
+    { OSSL_FUNC_SIGNATURE_VERIFY_INIT, (void (*)(void))eddsa_verify_init },
+    { OSSL_FUNC_SIGNATURE_VERIFY, (void (*)(void))ed448_digest_verify },
     { OSSL_FUNC_SIGNATURE_FREECTX, (void (*)(void))eddsa_freectx },
     { OSSL_FUNC_SIGNATURE_DUPCTX, (void (*)(void))eddsa_dupctx },
     { OSSL_FUNC_SIGNATURE_GET_CTX_PARAMS, (void (*)(void))eddsa_get_ctx_params },
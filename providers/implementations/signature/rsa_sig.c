@@ -1,5 +1,5 @@
 /*
- * Copyright 2019-2022 The OpenSSL Project Authors. All Rights Reserved.
+ * Copyright 2019-2023 The OpenSSL Project Authors. All Rights Reserved.
  *
  * Licensed under the Apache License 2.0 (the "License").  You may not use
  * this file except in compliance with the License.  You can obtain a copy
@@ -39,6 +39,7 @@ static OSSL_FUNC_signature_sign_init_fn rsa_sign_init;
 static OSSL_FUNC_signature_verify_init_fn rsa_verify_init;
 static OSSL_FUNC_signature_verify_recover_init_fn rsa_verify_recover_init;
 static OSSL_FUNC_signature_sign_fn rsa_sign;
+static OSSL_FUNC_signature_sign_batch_fn rsa_sign_batch;
 static OSSL_FUNC_signature_verify_fn rsa_verify;
 static OSSL_FUNC_signature_verify_recover_fn rsa_verify_recover;
 static OSSL_FUNC_signature_digest_sign_init_fn rsa_digest_sign_init;
@@ -522,6 +523,39 @@ static int rsa_sign_init(void *vprsactx, void *vrsa, const OSSL_PARAM params[])
     return rsa_signverify_init(vprsactx, vrsa, params, EVP_PKEY_OP_SIGN);
 }
 
+/* Check PSS restrictions */
+static int rsa_pss_check_saltlen(const PROV_RSA_CTX *prsactx)
+{
+    if (rsa_pss_restricted(prsactx)) {
+        switch (prsactx->saltlen) {
+        case RSA_PSS_SALTLEN_DIGEST:
+            if (prsactx->min_saltlen > EVP_MD_get_size(prsactx->md)) {
+                ERR_raise_data(ERR_LIB_PROV,
+                               PROV_R_PSS_SALTLEN_TOO_SMALL,
+                               "minimum salt length set to %d, "
+                               "but the digest only gives %d",
+                               prsactx->min_saltlen,
+                               EVP_MD_get_size(prsactx->md));
+                return 0;
+            }
+            /* FALLTHRU */
+        default:
+            if (prsactx->saltlen >= 0
+                && prsactx->saltlen < prsactx->min_saltlen) {
+                ERR_raise_data(ERR_LIB_PROV,
+                               PROV_R_PSS_SALTLEN_TOO_SMALL,
+                               "minimum salt length set to %d, but the"
+                               "actual salt length is only set to %d",
+                               prsactx->min_saltlen,
+                               prsactx->saltlen);
+                return 0;
+            }
+            break;
+        }
+    }
+    return 1;
+}
+
 static int rsa_sign(void *vprsactx, unsigned char *sig, size_t *siglen,
                     size_t sigsize, const unsigned char *tbs, size_t tbslen)
 {
@@ -604,34 +638,8 @@ static int rsa_sign(void *vprsactx, unsigned char *sig, size_t *siglen,
             break;
 
         case RSA_PKCS1_PSS_PADDING:
-            /* Check PSS restrictions */
-            if (rsa_pss_restricted(prsactx)) {
-                switch (prsactx->saltlen) {
-                case RSA_PSS_SALTLEN_DIGEST:
-                    if (prsactx->min_saltlen > EVP_MD_get_size(prsactx->md)) {
-                        ERR_raise_data(ERR_LIB_PROV,
-                                       PROV_R_PSS_SALTLEN_TOO_SMALL,
-                                       "minimum salt length set to %d, "
-                                       "but the digest only gives %d",
-                                       prsactx->min_saltlen,
-                                       EVP_MD_get_size(prsactx->md));
-                        return 0;
-                    }
-                    /* FALLTHRU */
-                default:
-                    if (prsactx->saltlen >= 0
-                        && prsactx->saltlen < prsactx->min_saltlen) {
-                        ERR_raise_data(ERR_LIB_PROV,
-                                       PROV_R_PSS_SALTLEN_TOO_SMALL,
-                                       "minimum salt length set to %d, but the"
-                                       "actual salt length is only set to %d",
-                                       prsactx->min_saltlen,
-                                       prsactx->saltlen);
-                        return 0;
-                    }
-                    break;
-                }
-            }
+            if (!rsa_pss_check_saltlen(prsactx))
+                return 0;
             if (!setup_tbuf(prsactx))
                 return 0;
             if (!RSA_padding_add_PKCS1_PSS_mgf1(prsactx->rsa,
@@ -668,6 +676,157 @@ static int rsa_sign(void *vprsactx, unsigned char *sig, size_t *siglen,
     return 1;
 }
 
+/*
+ * Sign with each key in turn, for the cases that the batch doesn't handle.
+ * rsa_sign() only looks at the key of the context, so that is swapped.
+ */
+static int rsa_sign_one_by_one(PROV_RSA_CTX *prsactx, void *const provkeys[],
+                               unsigned char *const sig[], size_t siglen[],
+                               const size_t sigsize[],
+                               const unsigned char *const tbs[],
+                               const size_t tbslen[], size_t num)
+{
+    RSA *rsa = prsactx->rsa;
+    size_t i;
+    int ret = 1;
+
+    for (i = 0; i < num && ret; i++) {
+        prsactx->rsa = provkeys[i];
+        ret = rsa_sign(prsactx, sig[i], &siglen[i], sigsize[i], tbs[i],
+                       tbslen[i]);
+    }
+    prsactx->rsa = rsa;
+    return ret;
+}
+
+/*
+ * Each input is padded here as rsa_sign() would do it, and the private key
+ * operations are done by ossl_rsa_private_encrypt_batch(), which does the
+ * exponentiations of two of them at a time.  The parameters of the context
+ * apply to all the keys.
+ */
+static int rsa_sign_batch(void *vprsactx, void *const provkeys[],
+                          unsigned char *const sig[], size_t siglen[],
+                          const size_t sigsize[],
+                          const unsigned char *const tbs[],
+                          const size_t tbslen[], size_t num)
+{
+    PROV_RSA_CTX *prsactx = (PROV_RSA_CTX *)vprsactx;
+    RSA **rsa = NULL;
+    unsigned char **buf = NULL;
+    const unsigned char **from = NULL;
+    const unsigned char *di = NULL;
+    int *flen = NULL, *res = NULL;
+    size_t mdsize = rsa_get_md_size(prsactx);
+    size_t i, di_len = 0, rsasize;
+    int padding = prsactx->pad_mode, ret = 0;
+
+    if (!ossl_prov_is_running())
+        return 0;
+
+    if (mdsize != 0) {
+        switch (prsactx->pad_mode) {
+        case RSA_PKCS1_PADDING:
+#ifndef FIPS_MODULE
+            if (EVP_MD_is_a(prsactx->md, OSSL_DIGEST_NAME_MDC2))
+                return rsa_sign_one_by_one(prsactx, provkeys, sig, siglen,
+                                           sigsize, tbs, tbslen, num);
+# ifndef OPENSSL_NO_DEPRECATED_3_0
+            /* RSA_sign() gives way to the method of the key */
+            for (i = 0; i < num; i++)
+                if (RSA_meth_get_sign(RSA_get_method(provkeys[i])) != NULL)
+                    return rsa_sign_one_by_one(prsactx, provkeys, sig, siglen,
+                                               sigsize, tbs, tbslen, num);
+# endif
+#endif
+            /* The MD5/SHA1 combination of TLS 1.1 has no DigestInfo */
+            if (prsactx->mdnid != NID_md5_sha1) {
+                di = ossl_rsa_digestinfo_encoding(prsactx->mdnid, &di_len);
+                if (di == NULL) {
+                    ERR_raise(ERR_LIB_PROV, PROV_R_INVALID_DIGEST);
+                    return 0;
+                }
+            }
+            break;
+        case RSA_PKCS1_PSS_PADDING:
+            if (!rsa_pss_check_saltlen(prsactx))
+                return 0;
+            padding = RSA_NO_PADDING;
+            break;
+        default:
+            return rsa_sign_one_by_one(prsactx, provkeys, sig, siglen,
+                                       sigsize, tbs, tbslen, num);
+        }
+    }
+
+    if ((rsa = OPENSSL_malloc(num * sizeof(*rsa))) == NULL
+            || (flen = OPENSSL_malloc(num * sizeof(*flen))) == NULL
+            || (buf = OPENSSL_zalloc(num * sizeof(*buf))) == NULL
+            || (from = OPENSSL_malloc(num * sizeof(*from))) == NULL
+            || (res = OPENSSL_malloc(num * sizeof(*res))) == NULL)
+        goto end;
+
+    for (i = 0; i < num; i++) {
+        rsa[i] = provkeys[i];
+        rsasize = RSA_size(rsa[i]);
+        if (sigsize[i] < rsasize) {
+            ERR_raise_data(ERR_LIB_PROV, PROV_R_INVALID_SIGNATURE_SIZE,
+                           "is %zu, should be at least %zu", sigsize[i],
+                           rsasize);
+            goto end;
+        }
+        if (mdsize != 0 && tbslen[i] != mdsize) {
+            ERR_raise(ERR_LIB_PROV, PROV_R_INVALID_DIGEST_LENGTH);
+            goto end;
+        }
+        from[i] = tbs[i];
+        flen[i] = (int)tbslen[i];
+
+        if (mdsize == 0)
+            continue;
+        if (prsactx->pad_mode == RSA_PKCS1_PSS_PADDING) {
+            if ((buf[i] = OPENSSL_malloc(rsasize)) == NULL)
+                goto end;
+            flen[i] = (int)rsasize;
+            if (!RSA_padding_add_PKCS1_PSS_mgf1(rsa[i], buf[i], tbs[i],
+                                                prsactx->md, prsactx->mgf1_md,
+                                                prsactx->saltlen)) {
+                ERR_raise(ERR_LIB_PROV, ERR_R_RSA_LIB);
+                goto end;
+            }
+        } else if (di != NULL) {
+            if ((buf[i] = OPENSSL_malloc(di_len + mdsize)) == NULL)
+                goto end;
+            flen[i] = (int)(di_len + mdsize);
+            memcpy(buf[i], di, di_len);
+            memcpy(buf[i] + di_len, tbs[i], mdsize);
+        } else {
+            continue;
+        }
+        from[i] = buf[i];
+    }
+
+    if (!ossl_rsa_private_encrypt_batch(num, flen, from, sig, rsa, padding,
+                                        res)) {
+        ERR_raise(ERR_LIB_PROV, ERR_R_RSA_LIB);
+        goto end;
+    }
+    for (i = 0; i < num; i++)
+        siglen[i] = res[i];
+    ret = 1;
+
+ end:
+    if (buf != NULL)
+        for (i = 0; i < num; i++)
+            OPENSSL_clear_free(buf[i], flen[i]);
+    OPENSSL_free(rsa);
+    OPENSSL_free(buf);
+    OPENSSL_free(from);
+    OPENSSL_free(flen);
+    OPENSSL_free(res);
+    return ret;
+}
+
 static int rsa_verify_recover_init(void *vprsactx, void *vrsa,
                                    const OSSL_PARAM params[])
 {
@@ -1454,6 +1613,7 @@ const OSSL_DISPATCH ossl_rsa_signature_functions[] = {
     { OSSL_FUNC_SIGNATURE_NEWCTX, (void (*)(void))rsa_newctx },
     { OSSL_FUNC_SIGNATURE_SIGN_INIT, (void (*)(void))rsa_sign_init },
     { OSSL_FUNC_SIGNATURE_SIGN, (void (*)(void))rsa_sign },
+    { OSSL_FUNC_SIGNATURE_SIGN_BATCH, (void (*)(void))rsa_sign_batch },
     { OSSL_FUNC_SIGNATURE_VERIFY_INIT, (void (*)(void))rsa_verify_init },
     { OSSL_FUNC_SIGNATURE_VERIFY, (void (*)(void))rsa_verify },
     { OSSL_FUNC_SIGNATURE_VERIFY_RECOVER_INIT,
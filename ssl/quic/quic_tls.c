@@ -552,6 +552,7 @@ static const OSSL_RECORD_METHOD quic_tls_record_method = {
     quic_get_max_records,
     quic_write_records,
     quic_retry_write_records,
+    NULL,
     quic_read_record,
     quic_release_record,
     quic_get_alert_code,
@@ -591,6 +591,7 @@ const OSSL_RECORD_METHOD ossl_ktls_record_method = {
     tls_get_max_records,
     tls_write_records,
     tls_retry_write_records,
+    NULL,
     tls_read_record,
     tls_release_record,
     tls_get_alert_code,
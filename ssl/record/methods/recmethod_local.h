@@ -38,6 +38,8 @@ typedef struct tls_buffer_st {
     size_t left;
     /* 'buf' is from application for KTLS */
     int app_buffer;
+    /* 'buf' is borrowed from the buffer pool of the SSL_CTX */
+    int pooled;
     /* The type of data stored in this buffer. Only used for writing */
     int type;
 } TLS_BUFFER;
@@ -365,6 +367,8 @@ struct ossl_record_layer_st
     OSSL_FUNC_rlayer_msg_callback_fn *msg_callback;
     OSSL_FUNC_rlayer_security_fn *security;
     OSSL_FUNC_rlayer_padding_fn *padding;
+    OSSL_FUNC_rlayer_alloc_buffer_fn *alloc_buffer;
+    OSSL_FUNC_rlayer_free_buffer_fn *free_buffer;
 
     size_t max_pipelines;
 
@@ -456,6 +460,10 @@ size_t tls_get_max_records(OSSL_RECORD_LAYER *rl, int type, size_t len,
 int tls_write_records(OSSL_RECORD_LAYER *rl, OSSL_RECORD_TEMPLATE *templates,
                       size_t numtempl);
 int tls_retry_write_records(OSSL_RECORD_LAYER *rl);
+int tls_write_records_iov(OSSL_RECORD_LAYER *rl, int type,
+                          unsigned int version, const SSL_IOVEC *iov,
+                          size_t iovcnt, size_t off, size_t len,
+                          size_t fraglen);
 int tls_get_alert_code(OSSL_RECORD_LAYER *rl);
 int tls_set1_bio(OSSL_RECORD_LAYER *rl, BIO *bio);
 int tls_read_record(OSSL_RECORD_LAYER *rl, void **rechandle, int *rversion,
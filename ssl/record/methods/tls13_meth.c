@@ -13,6 +13,9 @@
 #include "../record_local.h"
 #include "recmethod_local.h"
 
+/* The most records sealed in one multi-record operation */
+#define TLS13_MULTIREC_MAX  8
+
 static int tls13_set_crypto_state(OSSL_RECORD_LAYER *rl, int level,
                                   unsigned char *key, size_t keylen,
                                   unsigned char *iv, size_t ivlen,
@@ -55,9 +58,8 @@ static int tls13_set_crypto_state(OSSL_RECORD_LAYER *rl, int level,
     return OSSL_RECORD_RETURN_SUCCESS;
 }
 
-static int tls13_cipher(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
-                        size_t n_recs, int sending, SSL_MAC_BUF *mac,
-                        size_t macsize)
+static int tls13_cipher_record(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *rec,
+                               int sending)
 {
     EVP_CIPHER_CTX *ctx;
     unsigned char iv[EVP_MAX_IV_LENGTH], recheader[SSL3_RT_HEADER_LENGTH];
@@ -65,17 +67,10 @@ static int tls13_cipher(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
     unsigned char *staticiv;
     unsigned char *seq = rl->sequence;
     int lenu, lenf;
-    TLS_RL_RECORD *rec = &recs[0];
     WPACKET wpkt;
     const EVP_CIPHER *cipher;
     int mode;
 
-    if (n_recs != 1) {
-        /* Should not happen */
-        RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
-        return 0;
-    }
-
     ctx = rl->enc_ctx;
     staticiv = rl->iv;
 
@@ -175,6 +170,24 @@ static int tls13_cipher(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
     return 1;
 }
 
+static int tls13_cipher(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
+                        size_t n_recs, int sending, SSL_MAC_BUF *mac,
+                        size_t macsize)
+{
+    size_t i;
+
+    /*
+     * Several records only come from a write the multi-record method turned
+     * down, each of them is sealed on its own.
+     */
+    for (i = 0; i < n_recs; i++) {
+        if (!tls13_cipher_record(rl, &recs[i], sending))
+            return 0;
+    }
+
+    return 1;
+}
+
 static int tls13_validate_record_header(OSSL_RECORD_LAYER *rl,
                                         TLS_RL_RECORD *rec)
 {
@@ -303,6 +316,147 @@ static int tls13_add_record_padding(OSSL_RECORD_LAYER *rl,
     return 1;
 }
 
+/*
+ * Whether a write of |len| bytes of type |type| split into fragments of
+ * |fraglen| bytes can be handed to the cipher as a whole, which then builds,
+ * encrypts and authenticates the records itself.  Anything that needs to see
+ * or change individual records rules that out.
+ */
+static int tls13_is_multirec_capable(OSSL_RECORD_LAYER *rl, int type,
+                                     size_t len, size_t fraglen)
+{
+    return type == SSL3_RT_APPLICATION_DATA
+           && fraglen > 0
+           && len >= 2 * fraglen
+           && rl->enc_ctx != NULL
+           && rl->padding == NULL
+           && rl->block_padding == 0
+           && rl->msg_callback == NULL
+           && (EVP_CIPHER_get_flags(EVP_CIPHER_CTX_get0_cipher(rl->enc_ctx))
+               & EVP_CIPH_FLAG_TLS13_MULTIREC) != 0;
+}
+
+static size_t tls13_get_max_records(OSSL_RECORD_LAYER *rl, int type,
+                                    size_t len, size_t maxfrag,
+                                    size_t *preffrag)
+{
+    if (tls13_is_multirec_capable(rl, type, len, *preffrag)) {
+        size_t n = len / *preffrag;
+
+        return n < TLS13_MULTIREC_MAX ? n : TLS13_MULTIREC_MAX;
+    }
+
+    return tls_get_max_records_default(rl, type, len, maxfrag, preffrag);
+}
+
+/*
+ * Write records using the multi-record method.
+ *
+ * Returns 1 on success, 0 if multi-record isn't suitable (non-fatal error), or
+ * -1 on fatal error.
+ */
+static int tls13_write_records_multirec_int(OSSL_RECORD_LAYER *rl,
+                                            OSSL_RECORD_TEMPLATE *templates,
+                                            size_t numtempl)
+{
+    size_t i, totlen, packlen, fraglen, ivlen;
+    unsigned int type;
+    unsigned char seq[SEQ_NUM_SIZE];
+    TLS_BUFFER *wb;
+    OSSL_PARAM params[7], *p = params;
+
+    if (numtempl < 2)
+        return 0;
+
+    /*
+     * Check templates have contiguous buffers and are all the same type and
+     * length
+     */
+    for (i = 1; i < numtempl; i++) {
+        if (templates[i - 1].type != templates[i].type
+                || templates[i - 1].buflen != templates[i].buflen
+                || templates[i - 1].buf + templates[i - 1].buflen
+                   != templates[i].buf)
+            return 0;
+    }
+
+    fraglen = templates[0].buflen;
+    totlen = fraglen * numtempl;
+    if (templates[0].version != TLS1_2_VERSION
+            || !tls13_is_multirec_capable(rl, templates[0].type, totlen,
+                                          fraglen))
+        return 0;
+
+    /*
+     * Each record grows by its header, the inner content type and the tag.
+     * The write buffer is sized for all of them together and goes back to
+     * the default size on the next ordinary write.
+     */
+    packlen = totlen + numtempl * (SSL3_RT_HEADER_LENGTH + 1 + rl->taglen);
+    if (!tls_setup_write_buffer(rl, 1, packlen, packlen)) {
+        /* RLAYERfatal() already called */
+        return -1;
+    }
+    wb = &rl->wbuf[0];
+
+    memcpy(seq, rl->sequence, SEQ_NUM_SIZE);
+    for (i = 0; i < numtempl; i++) {
+        if (!tls_increment_sequence_ctr(rl)) {
+            /* RLAYERfatal already called */
+            return -1;
+        }
+    }
+
+    ivlen = EVP_CIPHER_CTX_get_iv_length(rl->enc_ctx);
+    type = templates[0].type;
+    *p++ = OSSL_PARAM_construct_octet_string(OSSL_CIPHER_PARAM_TLS13_MULTIREC_IV,
+                                             rl->iv, ivlen);
+    *p++ = OSSL_PARAM_construct_octet_string(OSSL_CIPHER_PARAM_TLS13_MULTIREC_SEQ,
+                                             seq, SEQ_NUM_SIZE);
+    *p++ = OSSL_PARAM_construct_size_t(OSSL_CIPHER_PARAM_TLS13_MULTIREC_FRAGLEN,
+                                       &fraglen);
+    *p++ = OSSL_PARAM_construct_uint(OSSL_CIPHER_PARAM_TLS13_MULTIREC_TYPE,
+                                     &type);
+    *p++ = OSSL_PARAM_construct_octet_string(OSSL_CIPHER_PARAM_TLS13_MULTIREC_ENC_IN,
+                                             (void *)templates[0].buf, totlen);
+    *p++ = OSSL_PARAM_construct_octet_string(OSSL_CIPHER_PARAM_TLS13_MULTIREC_ENC,
+                                             wb->buf, wb->len);
+    *p = OSSL_PARAM_construct_end();
+
+    if (EVP_CIPHER_CTX_set_params(rl->enc_ctx, params) <= 0) {
+        RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return -1;
+    }
+
+    wb->type = templates[0].type;
+    wb->offset = 0;
+    wb->left = packlen;
+
+    return 1;
+}
+
+static int tls13_write_records(OSSL_RECORD_LAYER *rl,
+                               OSSL_RECORD_TEMPLATE *templates,
+                               size_t numtempl)
+{
+    int ret;
+
+    ret = tls13_write_records_multirec_int(rl, templates, numtempl);
+    if (ret < 0) {
+        /* RLAYERfatal already called */
+        return 0;
+    }
+    if (ret == 0) {
+        /* Multi-record wasn't suitable so just do a standard write */
+        if (!tls_write_records_default(rl, templates, numtempl)) {
+            /* RLAYERfatal already called */
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 struct record_functions_st tls_1_3_funcs = {
     tls13_set_crypto_state,
     tls13_cipher,
@@ -312,8 +466,8 @@ struct record_functions_st tls_1_3_funcs = {
     tls_get_more_records,
     tls13_validate_record_header,
     tls13_post_process_record,
-    tls_get_max_records_default,
-    tls_write_records_default,
+    tls13_get_max_records,
+    tls13_write_records,
     tls_allocate_write_buffers_default,
     tls_initialise_write_packets_default,
     tls13_get_record_type,
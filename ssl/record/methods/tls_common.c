@@ -120,6 +120,46 @@ static int tls_allow_compression(OSSL_RECORD_LAYER *rl)
 }
 #endif
 
+/*
+ * If the SSL_CTX has a buffer pool, buffers are borrowed from it and given
+ * back as soon as they are empty.  DTLS keeps read buffers queued along with
+ * their records, so it always uses buffers of its own.
+ */
+static int tls_use_buffer_pool(OSSL_RECORD_LAYER *rl)
+{
+    return rl->alloc_buffer != NULL && rl->free_buffer != NULL && !rl->isdtls;
+}
+
+static int tls_release_buffers(OSSL_RECORD_LAYER *rl)
+{
+    return (rl->mode & SSL_MODE_RELEASE_BUFFERS) != 0
+           || tls_use_buffer_pool(rl);
+}
+
+static unsigned char *tls_buffer_alloc(OSSL_RECORD_LAYER *rl, TLS_BUFFER *b,
+                                       size_t len)
+{
+    unsigned char *p;
+
+    b->pooled = 0;
+    if (tls_use_buffer_pool(rl)
+            && (p = rl->alloc_buffer(rl->cbarg, len)) != NULL) {
+        b->pooled = 1;
+        return p;
+    }
+    return OPENSSL_malloc(len);
+}
+
+static void tls_buffer_free(OSSL_RECORD_LAYER *rl, TLS_BUFFER *b)
+{
+    if (b->pooled)
+        rl->free_buffer(rl->cbarg, b->buf);
+    else
+        OPENSSL_free(b->buf);
+    b->buf = NULL;
+    b->pooled = 0;
+}
+
 static void tls_release_write_buffer_int(OSSL_RECORD_LAYER *rl, size_t start)
 {
     TLS_BUFFER *wb;
@@ -133,7 +173,7 @@ static void tls_release_write_buffer_int(OSSL_RECORD_LAYER *rl, size_t start)
         if (TLS_BUFFER_is_app_buffer(wb))
             TLS_BUFFER_set_app_buffer(wb, 0);
         else
-            OPENSSL_free(wb->buf);
+            tls_buffer_free(rl, wb);
         wb->buf = NULL;
         pipes--;
     }
@@ -147,6 +187,7 @@ int tls_setup_write_buffer(OSSL_RECORD_LAYER *rl, size_t numwpipes,
     TLS_BUFFER *wb;
     size_t currpipe;
     size_t defltlen = 0;
+    int pooled;
 
     if (firstlen == 0 || (numwpipes > 1 && nextlen == 0)) {
         if (rl->isdtls)
@@ -180,14 +221,14 @@ int tls_setup_write_buffer(OSSL_RECORD_LAYER *rl, size_t numwpipes,
         if (len == 0)
             len = defltlen;
 
-        if (thiswb->len != len) {
-            OPENSSL_free(thiswb->buf);
-            thiswb->buf = NULL;         /* force reallocation */
-        }
+        if (thiswb->len != len)
+            tls_buffer_free(rl, thiswb);    /* force reallocation */
 
         p = thiswb->buf;
+        pooled = thiswb->pooled;
         if (p == NULL) {
-            p = OPENSSL_malloc(len);
+            p = tls_buffer_alloc(rl, thiswb, len);
+            pooled = thiswb->pooled;
             if (p == NULL) {
                 if (rl->numwpipes < currpipe)
                     rl->numwpipes = currpipe;
@@ -203,6 +244,7 @@ int tls_setup_write_buffer(OSSL_RECORD_LAYER *rl, size_t numwpipes,
         memset(thiswb, 0, sizeof(TLS_BUFFER));
         thiswb->buf = p;
         thiswb->len = len;
+        thiswb->pooled = pooled;
     }
 
     /* Free any previously allocated buffers that we are no longer using */
@@ -252,7 +294,7 @@ int tls_setup_read_buffer(OSSL_RECORD_LAYER *rl)
         if (b->default_len > len)
             len = b->default_len;
 
-        if ((p = OPENSSL_malloc(len)) == NULL) {
+        if ((p = tls_buffer_alloc(rl, b, len)) == NULL) {
             /*
              * We've got a malloc failure, and we're still initialising buffers.
              * We assume we're so doomed that we won't even be able to send an
@@ -275,8 +317,7 @@ static int tls_release_read_buffer(OSSL_RECORD_LAYER *rl)
     b = &rl->rbuf;
     if ((rl->options & SSL_OP_CLEANSE_PLAINTEXT) != 0)
         OPENSSL_cleanse(b->buf, b->len);
-    OPENSSL_free(b->buf);
-    b->buf = NULL;
+    tls_buffer_free(rl, b);
     return 1;
 }
 
@@ -416,7 +457,7 @@ int tls_default_read_n(OSSL_RECORD_LAYER *rl, size_t n, size_t max, int extend,
 
         if (ret <= OSSL_RECORD_RETURN_RETRY) {
             rb->left = left;
-            if ((rl->mode & SSL_MODE_RELEASE_BUFFERS) != 0 && !rl->isdtls)
+            if (tls_release_buffers(rl) && !rl->isdtls)
                 if (len + left == 0)
                     tls_release_read_buffer(rl);
             return ret;
@@ -1160,8 +1201,7 @@ int tls_release_record(OSSL_RECORD_LAYER *rl, void *rechandle, size_t length)
 
     rl->num_released++;
 
-    if (rl->curr_rec == rl->num_released
-            && (rl->mode & SSL_MODE_RELEASE_BUFFERS) != 0
+    if (rl->curr_rec == rl->num_released && tls_release_buffers(rl)
             && TLS_BUFFER_get_left(&rl->rbuf) == 0)
         tls_release_read_buffer(rl);
 
@@ -1327,6 +1367,13 @@ tls_int_new_record_layer(OSSL_LIB_CTX *libctx, const char *propq, int vers,
                 break;
             case OSSL_FUNC_RLAYER_PADDING:
                 rl->padding = OSSL_FUNC_rlayer_padding(fns);
+                break;
+            case OSSL_FUNC_RLAYER_ALLOC_BUFFER:
+                rl->alloc_buffer = OSSL_FUNC_rlayer_alloc_buffer(fns);
+                break;
+            case OSSL_FUNC_RLAYER_FREE_BUFFER:
+                rl->free_buffer = OSSL_FUNC_rlayer_free_buffer(fns);
+                break;
             default:
                 /* Just ignore anything we don't understand */
                 break;
@@ -1422,7 +1469,7 @@ static void tls_int_free(OSSL_RECORD_LAYER *rl)
     BIO_free(rl->prev);
     BIO_free(rl->bio);
     BIO_free(rl->next);
-    ossl_tls_buffer_release(&rl->rbuf);
+    tls_buffer_free(rl, &rl->rbuf);
 
     tls_release_write_buffer(rl);
 
@@ -1876,6 +1923,173 @@ int tls_write_records(OSSL_RECORD_LAYER *rl, OSSL_RECORD_TEMPLATE *templates,
     return tls_retry_write_records(rl);
 }
 
+/*
+ * Build the records of a scatter/gather write back to back in a single write
+ * buffer, filling each record from as many of the caller's buffers as it
+ * needs, so that all of them go to the BIO in one write.  Each record is
+ * built with the protocol specific functions in the same way as in
+ * tls_write_records_default(), but one after the other.
+ */
+int tls_write_records_iov(OSSL_RECORD_LAYER *rl, int type,
+                          unsigned int version, const SSL_IOVEC *iov,
+                          size_t iovcnt, size_t off, size_t len,
+                          size_t fraglen)
+{
+    OSSL_RECORD_TEMPLATE templ;
+    TLS_RL_RECORD wr;
+    WPACKET pkt;
+    TLS_BUFFER *wb;
+    unsigned char *recdata;
+    unsigned int rectype;
+    size_t numrecs, packlen, reclen, left, n, chunk, pos, align = 0;
+    int mac_size = 0;
+
+    /* Only the simple cases, anything else is written a record at a time */
+    if (rl->isdtls
+            || rl->compctx != NULL
+            || rl->need_empty_fragments
+            || rl->funcs == &tls_any_funcs
+            || len == 0
+            || fraglen == 0
+            || fraglen > rl->max_frag_len
+            || (len - 1) / fraglen >= OSSL_RECORD_IOV_MAX_RECORDS)
+        return OSSL_RECORD_RETURN_NON_FATAL_ERR;
+
+    /* Check we don't have pending data waiting to write */
+    if (!ossl_assert(rl->nextwbuf >= rl->numwpipes
+                     || TLS_BUFFER_get_left(&rl->wbuf[rl->nextwbuf]) == 0)) {
+        RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_SHOULD_NOT_HAVE_BEEN_CALLED);
+        return OSSL_RECORD_RETURN_FATAL;
+    }
+
+    if (rl->md_ctx != NULL && EVP_MD_CTX_get0_md(rl->md_ctx) != NULL) {
+        mac_size = EVP_MD_CTX_get_size(rl->md_ctx);
+        if (mac_size < 0) {
+            RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return OSSL_RECORD_RETURN_FATAL;
+        }
+    }
+
+    /*
+     * Every record gets as much room as one in a default sized write buffer.
+     * The write buffer goes back to the default size on the next ordinary
+     * write.
+     */
+    numrecs = (len - 1) / fraglen + 1;
+    packlen = numrecs * (rl->max_frag_len + SSL3_RT_SEND_MAX_ENCRYPTED_OVERHEAD
+                         + SSL3_RT_HEADER_LENGTH + rl->eivlen);
+#if defined(SSL3_ALIGN_PAYLOAD) && SSL3_ALIGN_PAYLOAD != 0
+    packlen += SSL3_ALIGN_PAYLOAD - 1;
+#endif
+    if (!tls_setup_write_buffer(rl, 1, packlen, packlen)) {
+        /* RLAYERfatal() already called */
+        return OSSL_RECORD_RETURN_FATAL;
+    }
+    wb = &rl->wbuf[0];
+    wb->type = type;
+
+#if defined(SSL3_ALIGN_PAYLOAD) && SSL3_ALIGN_PAYLOAD != 0
+    align = (size_t)TLS_BUFFER_get_buf(wb) + SSL3_RT_HEADER_LENGTH;
+    align = SSL3_ALIGN_PAYLOAD - 1 - ((align - 1) % SSL3_ALIGN_PAYLOAD);
+#endif
+
+    /* Find the buffer the data starts in */
+    while (iovcnt > 0 && off >= iov->data_len) {
+        off -= iov->data_len;
+        iov++;
+        iovcnt--;
+    }
+
+    templ.type = type;
+    templ.version = version;
+    templ.buf = NULL;
+    for (pos = align, left = len; left > 0; left -= reclen) {
+        reclen = left < fraglen ? left : fraglen;
+        templ.buflen = reclen;
+        if (rl->funcs->get_record_type != NULL)
+            rectype = rl->funcs->get_record_type(rl, &templ);
+        else
+            rectype = type;
+
+        memset(&wr, 0, sizeof(wr));
+        TLS_RL_RECORD_set_type(&wr, rectype);
+        TLS_RL_RECORD_set_rec_version(&wr, version);
+
+        if (!WPACKET_init_static_len(&pkt, TLS_BUFFER_get_buf(wb) + pos,
+                                     TLS_BUFFER_get_len(wb) - pos, 0)) {
+            RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return OSSL_RECORD_RETURN_FATAL;
+        }
+        if (!rl->funcs->prepare_record_header(rl, &pkt, &templ, rectype,
+                                              &recdata)) {
+            /* RLAYERfatal() already called */
+            goto err;
+        }
+
+        /* Gather the data of this record */
+        for (n = 0; n < reclen; n += chunk) {
+            if (!ossl_assert(iovcnt > 0)) {
+                RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+                goto err;
+            }
+            chunk = iov->data_len - off;
+            if (chunk > reclen - n)
+                chunk = reclen - n;
+            if (!WPACKET_memcpy(&pkt, (const unsigned char *)iov->data + off,
+                                chunk)) {
+                RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+                goto err;
+            }
+            off += chunk;
+            if (off == iov->data_len) {
+                off = 0;
+                iov++;
+                iovcnt--;
+            }
+        }
+
+        TLS_RL_RECORD_set_data(&wr, recdata);
+        TLS_RL_RECORD_set_length(&wr, reclen);
+        TLS_RL_RECORD_reset_input(&wr);
+
+        if (rl->funcs->add_record_padding != NULL
+                && !rl->funcs->add_record_padding(rl, &templ, &pkt, &wr)) {
+            /* RLAYERfatal() already called */
+            goto err;
+        }
+
+        if (!rl->funcs->prepare_for_encryption(rl, mac_size, &pkt, &wr)) {
+            /* RLAYERfatal() already called */
+            goto err;
+        }
+
+        if (rl->funcs->cipher(rl, &wr, 1, 1, NULL, mac_size) < 1) {
+            if (rl->alert == SSL_AD_NO_ALERT) {
+                RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            }
+            goto err;
+        }
+
+        if (!rl->funcs->post_encryption_processing(rl, mac_size, &templ, &pkt,
+                                                   &wr)) {
+            /* RLAYERfatal() already called */
+            goto err;
+        }
+        WPACKET_cleanup(&pkt);
+
+        pos += TLS_RL_RECORD_get_length(&wr);
+    }
+
+    TLS_BUFFER_set_offset(wb, align);
+    TLS_BUFFER_set_left(wb, pos - align);
+
+    rl->nextwbuf = 0;
+    return tls_retry_write_records(rl);
+ err:
+    WPACKET_cleanup(&pkt);
+    return OSSL_RECORD_RETURN_FATAL;
+}
+
 int tls_retry_write_records(OSSL_RECORD_LAYER *rl)
 {
     int i, ret;
@@ -1930,8 +2144,7 @@ int tls_retry_write_records(OSSL_RECORD_LAYER *rl)
             if (++(rl->nextwbuf) < rl->numwpipes)
                 continue;
 
-            if (rl->nextwbuf == rl->numwpipes
-                    && (rl->mode & SSL_MODE_RELEASE_BUFFERS) != 0)
+            if (rl->nextwbuf == rl->numwpipes && tls_release_buffers(rl))
                 tls_release_write_buffer(rl);
             return OSSL_RECORD_RETURN_SUCCESS;
         } else if (i <= 0) {
@@ -1942,7 +2155,7 @@ int tls_retry_write_records(OSSL_RECORD_LAYER *rl)
                  */
                 TLS_BUFFER_set_left(thiswb, 0);
                 if (++(rl->nextwbuf) == rl->numwpipes
-                        && (rl->mode & SSL_MODE_RELEASE_BUFFERS) != 0)
+                        && tls_release_buffers(rl))
                     tls_release_write_buffer(rl);
 
             }
@@ -2131,6 +2344,7 @@ const OSSL_RECORD_METHOD ossl_tls_record_method = {
     tls_get_max_records,
     tls_write_records,
     tls_retry_write_records,
+    tls_write_records_iov,
     tls_read_record,
     tls_release_record,
     tls_get_alert_code,
@@ -218,13 +218,16 @@ static int tls_write_check_pending(SSL_CONNECTION *s, int type,
 }
 
 /*
- * Call this to write data in records of type 'type' It will return <= 0 if
- * not all data has been sent or non-blocking IO.
+ * Write |len| bytes of data, gathered from the |iovcnt| buffers in |iov|, in
+ * records of type |type|.  |id| identifies the data for the checks on write
+ * retries, in place of the buffer pointer of a plain write.  It will return
+ * <= 0 if not all data has been sent or non-blocking IO.
  */
-int ssl3_write_bytes(SSL *ssl, int type, const void *buf_, size_t len,
-                     size_t *written)
+static int ssl3_write_iov_int(SSL *ssl, int type, const void *id,
+                              const SSL_IOVEC *iov, size_t iovcnt, size_t len,
+                              size_t *written)
 {
-    const unsigned char *buf = buf_;
+    const unsigned char *buf;
     size_t tot;
     size_t n, max_send_fragment, split_send_fragment, maxpipes;
     int i;
@@ -286,7 +289,7 @@ int ssl3_write_bytes(SSL *ssl, int type, const void *buf_, size_t len,
         }
     }
 
-    i = tls_write_check_pending(s, type, buf, len);
+    i = tls_write_check_pending(s, type, id, len);
     if (i < 0) {
         /* SSLfatal() already called */
         return i;
@@ -307,7 +310,7 @@ int ssl3_write_bytes(SSL *ssl, int type, const void *buf_, size_t len,
          */
         s->rlayer.wpend_tot = 0;
         s->rlayer.wpend_type = type;
-        s->rlayer.wpend_buf = buf;
+        s->rlayer.wpend_buf = id;
         s->rlayer.wpend_ret = len;
     }
 
@@ -355,14 +358,47 @@ int ssl3_write_bytes(SSL *ssl, int type, const void *buf_, size_t len,
 
     for (;;) {
         size_t tmppipelen, remain;
-        size_t j, lensofar = 0;
+        size_t j, lensofar = 0, run, off = tot;
+        const SSL_IOVEC *v = iov;
+
+        /* Find the buffer holding the next byte to send */
+        while (off >= v->data_len) {
+            off -= v->data_len;
+            v++;
+        }
+        buf = (const unsigned char *)v->data + off;
+        run = v->data_len - off;
+
+        /*
+         * If the data goes on in other buffers, the record layer may be able
+         * to fill records from several of them and send them all in one go.
+         * Otherwise this write is limited to what is left in this buffer.
+         */
+        if (run < n) {
+            if (s->rlayer.wrlmethod->write_records_iov != NULL) {
+                s->rlayer.wpend_tot = n;
+                if (s->rlayer.wpend_tot
+                        > OSSL_RECORD_IOV_MAX_RECORDS * split_send_fragment)
+                    s->rlayer.wpend_tot = OSSL_RECORD_IOV_MAX_RECORDS
+                                          * split_send_fragment;
+                i = s->rlayer.wrlmethod->write_records_iov(s->rlayer.wrl, type,
+                                                           recversion, iov,
+                                                           iovcnt, tot,
+                                                           s->rlayer.wpend_tot,
+                                                           split_send_fragment);
+                if (i != OSSL_RECORD_RETURN_NON_FATAL_ERR)
+                    goto written;
+            }
+        } else {
+            run = n;
+        }
 
         /*
         * Ask the record layer how it would like to split the amount of data
         * that we have, and how many of those records it would like in one go.
         */
-        maxpipes = s->rlayer.wrlmethod->get_max_records(s->rlayer.wrl, type, n,
-                                                        max_send_fragment,
+        maxpipes = s->rlayer.wrlmethod->get_max_records(s->rlayer.wrl, type,
+                                                        run, max_send_fragment,
                                                         &split_send_fragment);
         /*
         * If max_pipelines is 0 then this means "undefined" and we default to
@@ -381,7 +417,7 @@ int ssl3_write_bytes(SSL *ssl, int type, const void *buf_, size_t len,
             return -1;
         }
 
-        if (n / maxpipes >= split_send_fragment) {
+        if (run / maxpipes >= split_send_fragment) {
             /*
              * We have enough data to completely fill all available
              * pipelines
@@ -389,15 +425,15 @@ int ssl3_write_bytes(SSL *ssl, int type, const void *buf_, size_t len,
             for (j = 0; j < maxpipes; j++) {
                 tmpls[j].type = type;
                 tmpls[j].version = recversion;
-                tmpls[j].buf = &(buf[tot]) + (j * split_send_fragment);
+                tmpls[j].buf = buf + (j * split_send_fragment);
                 tmpls[j].buflen = split_send_fragment;
             }
             /* Remember how much data we are going to be sending */
             s->rlayer.wpend_tot = maxpipes * split_send_fragment;
         } else {
             /* We can partially fill all available pipelines */
-            tmppipelen = n / maxpipes;
-            remain = n % maxpipes;
+            tmppipelen = run / maxpipes;
+            remain = run % maxpipes;
             /*
              * If there is a remainder we add an extra byte to the first few
              * pipelines
@@ -407,18 +443,19 @@ int ssl3_write_bytes(SSL *ssl, int type, const void *buf_, size_t len,
             for (j = 0; j < maxpipes; j++) {
                 tmpls[j].type = type;
                 tmpls[j].version = recversion;
-                tmpls[j].buf = &(buf[tot]) + lensofar;
+                tmpls[j].buf = buf + lensofar;
                 tmpls[j].buflen = tmppipelen;
                 lensofar += tmppipelen;
                 if (j + 1 == remain)
                     tmppipelen--;
             }
             /* Remember how much data we are going to be sending */
-            s->rlayer.wpend_tot = n;
+            s->rlayer.wpend_tot = run;
         }
 
-        i = HANDLE_RLAYER_WRITE_RETURN(s,
-            s->rlayer.wrlmethod->write_records(s->rlayer.wrl, tmpls, maxpipes));
+        i = s->rlayer.wrlmethod->write_records(s->rlayer.wrl, tmpls, maxpipes);
+ written:
+        i = HANDLE_RLAYER_WRITE_RETURN(s, i);
         if (i <= 0) {
             /* SSLfatal() already called if appropriate */
             s->rlayer.wnum = tot;
@@ -438,6 +475,45 @@ int ssl3_write_bytes(SSL *ssl, int type, const void *buf_, size_t len,
     }
 }
 
+/*
+ * Call this to write data in records of type 'type' It will return <= 0 if
+ * not all data has been sent or non-blocking IO.
+ */
+int ssl3_write_bytes(SSL *ssl, int type, const void *buf, size_t len,
+                     size_t *written)
+{
+    SSL_IOVEC iov;
+
+    iov.data = buf;
+    iov.data_len = len;
+    return ssl3_write_iov_int(ssl, type, buf, &iov, 1, len, written);
+}
+
+/*
+ * Write the data in the |iovcnt| buffers of |iov| as application data, filling
+ * records from several buffers where the record layer supports it.
+ */
+int ssl3_writev_bytes(SSL *ssl, const SSL_IOVEC *iov, size_t iovcnt,
+                      size_t *written)
+{
+    SSL_CONNECTION *s = SSL_CONNECTION_FROM_SSL_ONLY(ssl);
+    size_t i, len = 0;
+
+    if (s == NULL)
+        return -1;
+
+    for (i = 0; i < iovcnt; i++) {
+        if (iov[i].data_len > SIZE_MAX - len) {
+            ERR_raise(ERR_LIB_SSL, SSL_R_BAD_LENGTH);
+            return -1;
+        }
+        len += iov[i].data_len;
+    }
+
+    return ssl3_write_iov_int(ssl, SSL3_RT_APPLICATION_DATA, iov, iov, iovcnt,
+                              len, written);
+}
+
 int ossl_tls_handle_rlayer_return(SSL_CONNECTION *s, int writing, int ret,
                                   char *file, int line)
 {
@@ -529,6 +605,41 @@ int ssl_release_record(SSL_CONNECTION *s, TLS_RECORD *rr, size_t length)
     return 1;
 }
 
+/*
+ * Point |*data| at the unread plaintext of the current record if it holds
+ * application data, without copying it out of the read buffer.
+ */
+int RECORD_LAYER_get_app_data(RECORD_LAYER *rl, const unsigned char **data,
+                              size_t *len)
+{
+    TLS_RECORD *rr;
+
+    if (rl->curr_rec >= rl->num_recs)
+        return 0;
+    rr = &rl->tlsrecs[rl->curr_rec];
+    if (rr->type != SSL3_RT_APPLICATION_DATA || rr->length == 0)
+        return 0;
+    *data = rr->data + rr->off;
+    *len = rr->length;
+    return 1;
+}
+
+/* Mark |len| bytes returned by RECORD_LAYER_get_app_data() as read */
+int RECORD_LAYER_release_app_data(RECORD_LAYER *rl, size_t len)
+{
+    const unsigned char *data;
+    size_t avail;
+
+    /* ssl_release_record() would take a length of 0 to mean all of it */
+    if (len == 0)
+        return 1;
+    if (!RECORD_LAYER_get_app_data(rl, &data, &avail) || len > avail) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_BAD_LENGTH);
+        return 0;
+    }
+    return ssl_release_record(rl->s, &rl->tlsrecs[rl->curr_rec], len);
+}
+
 /*-
  * Return up to 'len' payload bytes received in 'type' records.
  * 'type' is one of the following:
@@ -1103,11 +1214,29 @@ static size_t rlayer_padding_wrapper(void *cbarg, int type, size_t len)
                                        s->rlayer.record_padding_arg);
 }
 
+static OSSL_FUNC_rlayer_alloc_buffer_fn rlayer_alloc_buffer_wrapper;
+static unsigned char *rlayer_alloc_buffer_wrapper(void *cbarg, size_t len)
+{
+    SSL_CONNECTION *s = cbarg;
+
+    return ossl_ssl_buffer_pool_alloc(s->bufpool, len);
+}
+
+static OSSL_FUNC_rlayer_free_buffer_fn rlayer_free_buffer_wrapper;
+static void rlayer_free_buffer_wrapper(void *cbarg, unsigned char *buf)
+{
+    SSL_CONNECTION *s = cbarg;
+
+    ossl_ssl_buffer_pool_release(s->bufpool, buf);
+}
+
 static const OSSL_DISPATCH rlayer_dispatch[] = {
     { OSSL_FUNC_RLAYER_SKIP_EARLY_DATA, (void (*)(void))ossl_statem_skip_early_data },
     { OSSL_FUNC_RLAYER_MSG_CALLBACK, (void (*)(void))rlayer_msg_callback_wrapper },
     { OSSL_FUNC_RLAYER_SECURITY, (void (*)(void))rlayer_security_wrapper },
     { OSSL_FUNC_RLAYER_PADDING, (void (*)(void))rlayer_padding_wrapper },
+    { OSSL_FUNC_RLAYER_ALLOC_BUFFER, (void (*)(void))rlayer_alloc_buffer_wrapper },
+    { OSSL_FUNC_RLAYER_FREE_BUFFER, (void (*)(void))rlayer_free_buffer_wrapper },
     OSSL_DISPATCH_END
 };
 
@@ -1350,6 +1479,11 @@ int ssl_set_new_record_layer(SSL_CONNECTION *s, int version,
                 if (s->rlayer.record_padding_cb == NULL)
                     continue;
                 break;
+            case OSSL_FUNC_RLAYER_ALLOC_BUFFER:
+            case OSSL_FUNC_RLAYER_FREE_BUFFER:
+                if (s->bufpool == NULL)
+                    continue;
+                break;
             default:
                 break;
             }
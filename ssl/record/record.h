@@ -146,10 +146,15 @@ void RECORD_LAYER_clear(RECORD_LAYER *rl);
 int RECORD_LAYER_read_pending(const RECORD_LAYER *rl);
 int RECORD_LAYER_processed_read_pending(const RECORD_LAYER *rl);
 int RECORD_LAYER_write_pending(const RECORD_LAYER *rl);
+int RECORD_LAYER_get_app_data(RECORD_LAYER *rl, const unsigned char **data,
+                              size_t *len);
+int RECORD_LAYER_release_app_data(RECORD_LAYER *rl, size_t len);
 int RECORD_LAYER_is_sslv2_record(RECORD_LAYER *rl);
 __owur size_t ssl3_pending(const SSL *s);
 __owur int ssl3_write_bytes(SSL *s, int type, const void *buf, size_t len,
                             size_t *written);
+__owur int ssl3_writev_bytes(SSL *s, const SSL_IOVEC *iov, size_t iovcnt,
+                             size_t *written);
 __owur int ssl3_read_bytes(SSL *s, int type, int *recvd_type,
                            unsigned char *buf, size_t len, int peek,
                            size_t *readbytes);
@@ -199,3 +204,9 @@ OSSL_CORE_MAKE_FUNC(int, rlayer_security, (void *cbarg, int op, int bits,
                                            int nid, void *other))
 # define OSSL_FUNC_RLAYER_PADDING                4
 OSSL_CORE_MAKE_FUNC(size_t, rlayer_padding, (void *cbarg, int type, size_t len))
+# define OSSL_FUNC_RLAYER_ALLOC_BUFFER           5
+OSSL_CORE_MAKE_FUNC(unsigned char *, rlayer_alloc_buffer, (void *cbarg,
+                                                           size_t len))
+# define OSSL_FUNC_RLAYER_FREE_BUFFER            6
+OSSL_CORE_MAKE_FUNC(void, rlayer_free_buffer, (void *cbarg,
+                                               unsigned char *buf))
@@ -4168,12 +4168,31 @@ int ssl3_put_cipher_by_char(const SSL_CIPHER *c, WPACKET *pkt, size_t *len)
  *
  * Returns the selected cipher or NULL when no common ciphers.
  */
+#define SSL3_ALL_NUM_CIPHERS \
+    (TLS13_NUM_CIPHERS + SSL3_NUM_CIPHERS + SSL3_NUM_SCSVS)
+
+/*
+ * Return the position of |c| in the cipher tables, counting TLSv1.3 ciphers,
+ * other ciphers and SCSVs in that order, or -1 if |c| is not from them.
+ */
+static int ssl3_cipher_index(const SSL_CIPHER *c)
+{
+    if (c >= tls13_ciphers && c < tls13_ciphers + TLS13_NUM_CIPHERS)
+        return (int)(c - tls13_ciphers);
+    if (c >= ssl3_ciphers && c < ssl3_ciphers + SSL3_NUM_CIPHERS)
+        return (int)(TLS13_NUM_CIPHERS + (c - ssl3_ciphers));
+    if (c >= ssl3_scsvs && c < ssl3_scsvs + SSL3_NUM_SCSVS)
+        return (int)(TLS13_NUM_CIPHERS + SSL3_NUM_CIPHERS + (c - ssl3_scsvs));
+    return -1;
+}
+
 const SSL_CIPHER *ssl3_choose_cipher(SSL_CONNECTION *s, STACK_OF(SSL_CIPHER) *clnt,
                                      STACK_OF(SSL_CIPHER) *srvr)
 {
-    const SSL_CIPHER *c, *ret = NULL;
+    const SSL_CIPHER *c, *shared, *ret = NULL;
     STACK_OF(SSL_CIPHER) *prio, *allow;
-    int i, ii, ok, prefer_sha256 = 0;
+    int i, ii, ok, prefer_sha256 = 0, allow_search = 0;
+    unsigned char allowed[(SSL3_ALL_NUM_CIPHERS + 7) / 8];
     unsigned long alg_k = 0, alg_a = 0, mask_k = 0, mask_a = 0;
     STACK_OF(SSL_CIPHER) *prio_chacha = NULL;
 
@@ -4276,6 +4295,21 @@ const SSL_CIPHER *ssl3_choose_cipher(SSL_CONNECTION *s, STACK_OF(SSL_CIPHER) *cl
         ssl_set_masks(s);
     }
 
+    /*
+     * Every candidate from |prio| is looked up in |allow|, so note which
+     * ciphers |allow| has in a bitset instead of searching the stack each
+     * time.  Stacks with ciphers from elsewhere are still searched.
+     */
+    memset(allowed, 0, sizeof(allowed));
+    for (i = 0; i < sk_SSL_CIPHER_num(allow); i++) {
+        ii = ssl3_cipher_index(sk_SSL_CIPHER_value(allow, i));
+        if (ii < 0) {
+            allow_search = 1;
+            break;
+        }
+        allowed[ii / 8] |= 1 << (ii % 8);
+    }
+
     for (i = 0; i < sk_SSL_CIPHER_num(prio); i++) {
         c = sk_SSL_CIPHER_value(prio, i);
 
@@ -4326,8 +4360,15 @@ const SSL_CIPHER *ssl3_choose_cipher(SSL_CONNECTION *s, STACK_OF(SSL_CIPHER) *cl
             if (!ok)
                 continue;
         }
-        ii = sk_SSL_CIPHER_find(allow, c);
-        if (ii >= 0) {
+        if (allow_search) {
+            ii = sk_SSL_CIPHER_find(allow, c);
+            shared = ii >= 0 ? sk_SSL_CIPHER_value(allow, ii) : NULL;
+        } else {
+            ii = ssl3_cipher_index(c);
+            shared = ii >= 0 && (allowed[ii / 8] & (1 << (ii % 8))) != 0
+                     ? c : NULL;
+        }
+        if (shared != NULL) {
             /* Check security callback permits this cipher */
             if (!ssl_security(s, SSL_SECOP_CIPHER_SHARED,
                               c->strength_bits, 0, (void *)c))
@@ -4336,25 +4377,24 @@ const SSL_CIPHER *ssl3_choose_cipher(SSL_CONNECTION *s, STACK_OF(SSL_CIPHER) *cl
             if ((alg_k & SSL_kECDHE) && (alg_a & SSL_aECDSA)
                 && s->s3.is_probably_safari) {
                 if (!ret)
-                    ret = sk_SSL_CIPHER_value(allow, ii);
+                    ret = shared;
                 continue;
             }
 
             if (prefer_sha256) {
-                const SSL_CIPHER *tmp = sk_SSL_CIPHER_value(allow, ii);
                 const EVP_MD *md = ssl_md(SSL_CONNECTION_GET_CTX(s),
-                                          tmp->algorithm2);
+                                          shared->algorithm2);
 
                 if (md != NULL
                         && EVP_MD_is_a(md, OSSL_DIGEST_NAME_SHA2_256)) {
-                    ret = tmp;
+                    ret = shared;
                     break;
                 }
                 if (ret == NULL)
-                    ret = tmp;
+                    ret = shared;
                 continue;
             }
-            ret = sk_SSL_CIPHER_value(allow, ii);
+            ret = shared;
             break;
         }
     }
@@ -4501,6 +4541,20 @@ int ssl3_write(SSL *s, const void *buf, size_t len, size_t *written)
                                       written);
 }
 
+int ssl3_writev(SSL *s, const SSL_IOVEC *iov, size_t iovcnt, size_t *written)
+{
+    SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL_ONLY(s);
+
+    if (sc == NULL)
+        return 0;
+
+    clear_sys_error();
+    if (sc->s3.renegotiate)
+        ssl3_renegotiate_check(s, 0);
+
+    return ssl3_writev_bytes(s, iov, iovcnt, written);
+}
+
 static int ssl3_read_internal(SSL *s, void *buf, size_t len, int peek,
                               size_t *readbytes)
 {
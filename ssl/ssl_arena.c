@@ -0,0 +1,151 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include <openssl/crypto.h>
+#include "ssl_local.h"
+
+/*
+ * Much of what the handshake allocates, such as the parsed ClientHello,
+ * the raw extension tables and signature or ticket scratch buffers, is
+ * freed again shortly after.  With SSL_MODE_HANDSHAKE_ARENA set these
+ * allocations are carved out of blocks owned by the connection instead.
+ * Freeing an arena allocation only drops the count of live ones; the
+ * blocks themselves are released when the handshake finishes.
+ *
+ * The blocks may hold key material, so they are cleansed on release.
+ */
+
+#define HS_ARENA_BLOCK_SIZE     8192
+#define HS_ARENA_ALIGN          16
+#define HS_ARENA_ROUND(n)       (((n) + HS_ARENA_ALIGN - 1) \
+                                 & ~(size_t)(HS_ARENA_ALIGN - 1))
+#define HS_ARENA_HDR_SIZE       HS_ARENA_ROUND(sizeof(SSL_HS_ARENA_BLOCK))
+#define HS_ARENA_DATA_SIZE      (HS_ARENA_BLOCK_SIZE - HS_ARENA_HDR_SIZE)
+/* Larger requests come from the heap so as not to waste most of a block */
+#define HS_ARENA_MAX_ALLOC      (HS_ARENA_DATA_SIZE / 4)
+
+struct ssl_hs_arena_block_st {
+    SSL_HS_ARENA_BLOCK *next;
+    size_t used;
+};
+
+static ossl_inline unsigned char *hs_arena_data(SSL_HS_ARENA_BLOCK *blk)
+{
+    return (unsigned char *)blk + HS_ARENA_HDR_SIZE;
+}
+
+static void *hs_arena_alloc(SSL_HS_ARENA *arena, size_t num)
+{
+    SSL_HS_ARENA_BLOCK *blk = arena->blocks;
+    size_t n = HS_ARENA_ROUND(num);
+    void *ret;
+
+    if (blk == NULL || HS_ARENA_DATA_SIZE - blk->used < n) {
+        if ((blk = OPENSSL_malloc(HS_ARENA_BLOCK_SIZE)) == NULL)
+            return NULL;
+        arena->heap_allocs++;
+        blk->next = arena->blocks;
+        blk->used = 0;
+        arena->blocks = blk;
+    }
+    ret = hs_arena_data(blk) + blk->used;
+    blk->used += n;
+    arena->live++;
+    arena->arena_allocs++;
+    return ret;
+}
+
+static int hs_arena_owns(SSL_HS_ARENA *arena, const void *ptr)
+{
+    SSL_HS_ARENA_BLOCK *blk;
+    const unsigned char *p = ptr;
+
+    for (blk = arena->blocks; blk != NULL; blk = blk->next)
+        if (p >= hs_arena_data(blk) && p < hs_arena_data(blk) + blk->used)
+            return 1;
+    return 0;
+}
+
+static void hs_arena_release(SSL_HS_ARENA *arena)
+{
+    SSL_HS_ARENA_BLOCK *blk, *next;
+
+    for (blk = arena->blocks; blk != NULL; blk = next) {
+        next = blk->next;
+        OPENSSL_clear_free(blk, HS_ARENA_HDR_SIZE + blk->used);
+    }
+    arena->blocks = NULL;
+    arena->live = 0;
+}
+
+void *ossl_ssl_hs_malloc(SSL_CONNECTION *s, size_t num)
+{
+    void *ret;
+
+    if ((s->mode & SSL_MODE_HANDSHAKE_ARENA) != 0
+            && num > 0 && num <= HS_ARENA_MAX_ALLOC
+            && (ret = hs_arena_alloc(&s->hs_arena, num)) != NULL)
+        return ret;
+
+    s->hs_arena.heap_allocs++;
+    return OPENSSL_malloc(num);
+}
+
+void *ossl_ssl_hs_zalloc(SSL_CONNECTION *s, size_t num)
+{
+    void *ret = ossl_ssl_hs_malloc(s, num);
+
+    if (ret != NULL)
+        memset(ret, 0, num);
+    return ret;
+}
+
+void ossl_ssl_hs_free(SSL_CONNECTION *s, void *ptr)
+{
+    if (ptr == NULL)
+        return;
+
+    if (s->hs_arena.blocks != NULL && hs_arena_owns(&s->hs_arena, ptr)) {
+        s->hs_arena.live--;
+        return;
+    }
+    OPENSSL_free(ptr);
+}
+
+/*
+ * Called at the end of each handshake.  Should anything still point into
+ * the arena, the blocks are kept until the next reset or until the
+ * connection is freed.
+ */
+void ossl_ssl_hs_arena_reset(SSL_CONNECTION *s)
+{
+    if (s->hs_arena.live == 0)
+        hs_arena_release(&s->hs_arena);
+}
+
+void ossl_ssl_hs_arena_free(SSL_CONNECTION *s)
+{
+    hs_arena_release(&s->hs_arena);
+}
+
+int SSL_get_handshake_arena_stats(const SSL *s, uint64_t *arena_allocs,
+                                  uint64_t *heap_allocs)
+{
+    const SSL_CONNECTION *sc = SSL_CONNECTION_FROM_CONST_SSL(s);
+
+    if (sc == NULL)
+        return 0;
+
+    if (arena_allocs != NULL)
+        *arena_allocs = sc->hs_arena.arena_allocs;
+    if (heap_allocs != NULL)
+        *heap_allocs = sc->hs_arena.heap_allocs;
+    return 1;
+}
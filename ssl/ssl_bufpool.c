@@ -0,0 +1,180 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <openssl/err.h>
+#include "ssl_local.h"
+
+/*
+ * A pool of record layer buffers shared by the connections of an SSL_CTX.
+ * Connections borrow a buffer while a record is being read or written and
+ * return it afterwards, so that idle connections hold no buffers at all.
+ * All buffers have the same size, large enough for the default read and
+ * write buffers of a TLS record layer; larger requests are not served from
+ * the pool.
+ *
+ * Buffers are cleansed when they are given back, so no data of one
+ * connection is ever visible to the next one borrowing the buffer.
+ *
+ * Connections keep a reference to the pool they were created with, so the
+ * pool stays around until the last of them is freed.
+ */
+
+#define SSL_BUFFER_POOL_LEN    (SSL3_RT_MAX_PACKET_SIZE + SSL3_ALIGN_PAYLOAD)
+
+/* An idle buffer, the link is kept in the buffer itself */
+typedef struct ssl_pool_buf_st {
+    struct ssl_pool_buf_st *next;
+} SSL_POOL_BUF;
+
+struct ssl_buffer_pool_st {
+    CRYPTO_REF_COUNT references;
+    CRYPTO_RWLOCK *lock;
+    SSL_POOL_BUF *idle;
+    size_t num_idle;
+    size_t max_idle;
+    size_t in_use;
+    size_t peak_in_use;
+};
+
+static void buffer_pool_free(SSL_BUFFER_POOL *pool)
+{
+    SSL_POOL_BUF *b;
+    int i;
+
+    if (pool == NULL)
+        return;
+    CRYPTO_DOWN_REF(&pool->references, &i);
+    if (i > 0)
+        return;
+    REF_ASSERT_ISNT(i < 0);
+
+    while ((b = pool->idle) != NULL) {
+        pool->idle = b->next;
+        OPENSSL_free(b);
+    }
+    CRYPTO_THREAD_lock_free(pool->lock);
+    CRYPTO_FREE_REF(&pool->references);
+    OPENSSL_free(pool);
+}
+
+int SSL_CTX_set_buffer_pool(SSL_CTX *ctx, size_t max_idle)
+{
+    SSL_BUFFER_POOL *pool = NULL;
+
+    if (max_idle > 0) {
+        if ((pool = OPENSSL_zalloc(sizeof(*pool))) == NULL)
+            return 0;
+        if (!CRYPTO_NEW_REF(&pool->references, 1)) {
+            OPENSSL_free(pool);
+            return 0;
+        }
+        if ((pool->lock = CRYPTO_THREAD_lock_new()) == NULL) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_CRYPTO_LIB);
+            buffer_pool_free(pool);
+            return 0;
+        }
+        pool->max_idle = max_idle;
+    }
+
+    buffer_pool_free(ctx->bufpool);
+    ctx->bufpool = pool;
+    return 1;
+}
+
+int SSL_CTX_get_buffer_pool_stats(const SSL_CTX *ctx, size_t *in_use,
+                                  size_t *idle, size_t *peak_in_use)
+{
+    SSL_BUFFER_POOL *pool = ctx->bufpool;
+
+    if (pool == NULL || !CRYPTO_THREAD_read_lock(pool->lock))
+        return 0;
+    if (in_use != NULL)
+        *in_use = pool->in_use;
+    if (idle != NULL)
+        *idle = pool->num_idle;
+    if (peak_in_use != NULL)
+        *peak_in_use = pool->peak_in_use;
+    CRYPTO_THREAD_unlock(pool->lock);
+    return 1;
+}
+
+void ossl_ssl_buffer_pool_free(SSL_CTX *ctx)
+{
+    buffer_pool_free(ctx->bufpool);
+    ctx->bufpool = NULL;
+}
+
+SSL_BUFFER_POOL *ossl_ssl_buffer_pool_get(SSL_CTX *ctx)
+{
+    int i;
+
+    if (ctx->bufpool == NULL
+            || !CRYPTO_UP_REF(&ctx->bufpool->references, &i))
+        return NULL;
+    return ctx->bufpool;
+}
+
+void ossl_ssl_buffer_pool_put(SSL_BUFFER_POOL *pool)
+{
+    buffer_pool_free(pool);
+}
+
+/*
+ * Borrow a buffer of at least |len| bytes, or return NULL if the pool does
+ * not serve buffers that large or one could not be allocated.
+ */
+unsigned char *ossl_ssl_buffer_pool_alloc(SSL_BUFFER_POOL *pool, size_t len)
+{
+    SSL_POOL_BUF *b;
+
+    if (len > SSL_BUFFER_POOL_LEN || !CRYPTO_THREAD_write_lock(pool->lock))
+        return NULL;
+    if ((b = pool->idle) != NULL) {
+        pool->idle = b->next;
+        pool->num_idle--;
+    }
+    if (++pool->in_use > pool->peak_in_use)
+        pool->peak_in_use = pool->in_use;
+    CRYPTO_THREAD_unlock(pool->lock);
+
+    if (b == NULL && (b = OPENSSL_malloc(SSL_BUFFER_POOL_LEN)) == NULL) {
+        if (CRYPTO_THREAD_write_lock(pool->lock)) {
+            pool->in_use--;
+            CRYPTO_THREAD_unlock(pool->lock);
+        }
+        return NULL;
+    }
+    return (unsigned char *)b;
+}
+
+/*
+ * Give back a buffer from ossl_ssl_buffer_pool_alloc().  The buffer is
+ * cleansed first, it may hold another connection's plaintext or keys.
+ */
+void ossl_ssl_buffer_pool_release(SSL_BUFFER_POOL *pool, unsigned char *buf)
+{
+    SSL_POOL_BUF *b = (SSL_POOL_BUF *)buf;
+
+    if (b == NULL)
+        return;
+    OPENSSL_cleanse(b, SSL_BUFFER_POOL_LEN);
+    if (!CRYPTO_THREAD_write_lock(pool->lock)) {
+        OPENSSL_free(b);
+        return;
+    }
+    pool->in_use--;
+    if (pool->num_idle < pool->max_idle) {
+        b->next = pool->idle;
+        pool->idle = b;
+        pool->num_idle++;
+        b = NULL;
+    }
+    CRYPTO_THREAD_unlock(pool->lock);
+    OPENSSL_free(b);
+}
@@ -1454,39 +1454,178 @@ int SSL_set_ciphersuites(SSL *s, const char *str)
     return ret;
 }
 
-STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
-                                             STACK_OF(SSL_CIPHER) *tls13_ciphersuites,
-                                             STACK_OF(SSL_CIPHER) **cipher_list,
-                                             STACK_OF(SSL_CIPHER) **cipher_list_by_id,
-                                             const char *rule_str,
-                                             CERT *c)
-{
-    int ok, num_of_ciphers, num_of_alias_max, num_of_group_aliases, i;
+/*
+ * Compiled cipher strings.  Compiling a cipher string only depends on the
+ * ciphers the method offers, the ciphers the providers of the SSL_CTX make
+ * available, which is what the disabled masks record, and the string itself.
+ * The result is kept in a process wide cache so that setting the same string
+ * again, typically on every new SSL_CTX or SSL, only has to copy it.  Entries
+ * stay until the library is stopped, and are never changed once added.
+ */
+typedef struct {
+    const SSL_CIPHER *(*get_cipher)(unsigned int u);
+    int num_ciphers;
+    int dtls;
     uint32_t disabled_mkey, disabled_auth, disabled_enc, disabled_mac;
-    STACK_OF(SSL_CIPHER) *cipherstack;
-    const char *rule_p;
-    CIPHER_ORDER *co_list = NULL, *head = NULL, *tail = NULL, *curr;
-    const SSL_CIPHER **ca_list = NULL;
-    const SSL_METHOD *ssl_method = ctx->method;
+    char *rule_str;
+    /* The level set by "@SECLEVEL=", or -1 */
+    int sec_level;
+    /* Without the TLSv1.3 ciphersuites */
+    STACK_OF(SSL_CIPHER) *ciphers;
+} SSL_CIPHER_CACHE_ENTRY;
 
-    /*
-     * Return with error if nothing to do.
-     */
-    if (rule_str == NULL || cipher_list == NULL || cipher_list_by_id == NULL)
-        return NULL;
+DEFINE_LHASH_OF_EX(SSL_CIPHER_CACHE_ENTRY);
 
-    if (!check_suiteb_cipher_list(ssl_method, c, &rule_str))
+/* Cipher strings are rarely generated, so this is not expected to fill up */
+#define SSL_CIPHER_CACHE_MAX    256
+
+static CRYPTO_ONCE ssl_cipher_cache_once = CRYPTO_ONCE_STATIC_INIT;
+static CRYPTO_RWLOCK *ssl_cipher_cache_lock = NULL;
+static LHASH_OF(SSL_CIPHER_CACHE_ENTRY) *ssl_cipher_cache = NULL;
+
+static unsigned long ssl_cipher_cache_hash(const SSL_CIPHER_CACHE_ENTRY *e)
+{
+    return OPENSSL_LH_strhash(e->rule_str) ^ e->disabled_mkey
+        ^ ((unsigned long)e->disabled_auth << 3)
+        ^ ((unsigned long)e->disabled_enc << 7)
+        ^ ((unsigned long)e->disabled_mac << 11)
+        ^ ((unsigned long)e->num_ciphers << 1) ^ e->dtls;
+}
+
+static int ssl_cipher_cache_cmp(const SSL_CIPHER_CACHE_ENTRY *a,
+                                const SSL_CIPHER_CACHE_ENTRY *b)
+{
+    if (a->get_cipher != b->get_cipher
+            || a->num_ciphers != b->num_ciphers
+            || a->dtls != b->dtls
+            || a->disabled_mkey != b->disabled_mkey
+            || a->disabled_auth != b->disabled_auth
+            || a->disabled_enc != b->disabled_enc
+            || a->disabled_mac != b->disabled_mac)
+        return 1;
+    return strcmp(a->rule_str, b->rule_str);
+}
+
+DEFINE_RUN_ONCE_STATIC(do_ssl_cipher_cache_init)
+{
+    ssl_cipher_cache_lock = CRYPTO_THREAD_lock_new();
+    if (ssl_cipher_cache_lock == NULL)
+        return 0;
+    ssl_cipher_cache = lh_SSL_CIPHER_CACHE_ENTRY_new(ssl_cipher_cache_hash,
+                                                     ssl_cipher_cache_cmp);
+    if (ssl_cipher_cache == NULL) {
+        CRYPTO_THREAD_lock_free(ssl_cipher_cache_lock);
+        ssl_cipher_cache_lock = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+static void ssl_cipher_cache_entry_free(SSL_CIPHER_CACHE_ENTRY *e)
+{
+    sk_SSL_CIPHER_free(e->ciphers);
+    OPENSSL_free(e->rule_str);
+    OPENSSL_free(e);
+}
+
+void ssl_cipher_cache_free_int(void)
+{
+    if (ssl_cipher_cache != NULL) {
+        lh_SSL_CIPHER_CACHE_ENTRY_doall(ssl_cipher_cache,
+                                        ssl_cipher_cache_entry_free);
+        lh_SSL_CIPHER_CACHE_ENTRY_free(ssl_cipher_cache);
+        ssl_cipher_cache = NULL;
+    }
+    CRYPTO_THREAD_lock_free(ssl_cipher_cache_lock);
+    ssl_cipher_cache_lock = NULL;
+}
+
+static int ssl_cipher_cache_ready(void)
+{
+    return RUN_ONCE(&ssl_cipher_cache_once, do_ssl_cipher_cache_init)
+        && ssl_cipher_cache != NULL;
+}
+
+/*
+ * Look up the compiled form of |key| and return a copy of it, or NULL if it
+ * is not cached.  If the cipher string sets the security level, that is
+ * stored in |*sec_level|, otherwise it is set to -1.
+ */
+static STACK_OF(SSL_CIPHER) *
+ssl_cipher_cache_get(const SSL_CIPHER_CACHE_ENTRY *key, int *sec_level)
+{
+    SSL_CIPHER_CACHE_ENTRY *e;
+    STACK_OF(SSL_CIPHER) *ret = NULL;
+
+    if (!ssl_cipher_cache_ready() || !CRYPTO_THREAD_read_lock(ssl_cipher_cache_lock))
         return NULL;
+    e = lh_SSL_CIPHER_CACHE_ENTRY_retrieve(ssl_cipher_cache, key);
+    if (e != NULL && (ret = sk_SSL_CIPHER_dup(e->ciphers)) != NULL)
+        *sec_level = e->sec_level;
+    CRYPTO_THREAD_unlock(ssl_cipher_cache_lock);
+    return ret;
+}
 
-    /*
-     * To reduce the work to do we only want to process the compiled
-     * in algorithms, so we first get the mask of disabled ciphers.
-     */
+/*
+ * Add |ciphers| as the compiled form of |key|.  The cache takes ownership of
+ * |ciphers| if it returns 1.
+ */
+static int ssl_cipher_cache_add(const SSL_CIPHER_CACHE_ENTRY *key,
+                                STACK_OF(SSL_CIPHER) *ciphers, int sec_level)
+{
+    SSL_CIPHER_CACHE_ENTRY *e;
+    int ret = 0;
+
+    if (!ssl_cipher_cache_ready())
+        return 0;
+    if ((e = OPENSSL_malloc(sizeof(*e))) == NULL)
+        return 0;
+    *e = *key;
+    e->sec_level = sec_level;
+    e->ciphers = ciphers;
+    if ((e->rule_str = OPENSSL_strdup(key->rule_str)) == NULL) {
+        OPENSSL_free(e);
+        return 0;
+    }
 
-    disabled_mkey = ctx->disabled_mkey_mask;
-    disabled_auth = ctx->disabled_auth_mask;
-    disabled_enc = ctx->disabled_enc_mask;
-    disabled_mac = ctx->disabled_mac_mask;
+    if (!CRYPTO_THREAD_write_lock(ssl_cipher_cache_lock)) {
+        OPENSSL_free(e->rule_str);
+        OPENSSL_free(e);
+        return 0;
+    }
+    /* Another thread may have added the same string in the meantime */
+    if (lh_SSL_CIPHER_CACHE_ENTRY_num_items(ssl_cipher_cache)
+            < SSL_CIPHER_CACHE_MAX
+            && lh_SSL_CIPHER_CACHE_ENTRY_retrieve(ssl_cipher_cache, e) == NULL) {
+        (void)lh_SSL_CIPHER_CACHE_ENTRY_insert(ssl_cipher_cache, e);
+        ret = lh_SSL_CIPHER_CACHE_ENTRY_error(ssl_cipher_cache) == 0;
+    }
+    CRYPTO_THREAD_unlock(ssl_cipher_cache_lock);
+
+    if (!ret) {
+        OPENSSL_free(e->rule_str);
+        OPENSSL_free(e);
+    }
+    return ret;
+}
+
+/*
+ * Compile |rule_str| into the list of ciphers of |ssl_method| it selects, in
+ * order of preference and leaving out the disabled ones.
+ */
+static STACK_OF(SSL_CIPHER) *ssl_compile_cipher_list(const SSL_METHOD *ssl_method,
+                                                     uint32_t disabled_mkey,
+                                                     uint32_t disabled_auth,
+                                                     uint32_t disabled_enc,
+                                                     uint32_t disabled_mac,
+                                                     const char *rule_str,
+                                                     CERT *c)
+{
+    int ok, num_of_ciphers, num_of_alias_max, num_of_group_aliases;
+    STACK_OF(SSL_CIPHER) *cipherstack;
+    const char *rule_p;
+    CIPHER_ORDER *co_list = NULL, *head = NULL, *tail = NULL, *curr;
+    const SSL_CIPHER **ca_list = NULL;
 
     /*
      * Now we have to collect the available ciphers from the compiled
@@ -1649,6 +1788,96 @@ STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
         return NULL;
     }
 
+    /*
+     * The cipher selection for the list is done. The ciphers are added
+     * to the resulting precedence to the STACK_OF(SSL_CIPHER).
+     */
+    for (curr = head; curr != NULL; curr = curr->next) {
+        if (curr->active) {
+            if (!sk_SSL_CIPHER_push(cipherstack, curr->cipher)) {
+                OPENSSL_free(co_list);
+                sk_SSL_CIPHER_free(cipherstack);
+                return NULL;
+            }
+        }
+    }
+    OPENSSL_free(co_list);      /* Not needed any longer */
+
+    return cipherstack;
+}
+
+STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
+                                             STACK_OF(SSL_CIPHER) *tls13_ciphersuites,
+                                             STACK_OF(SSL_CIPHER) **cipher_list,
+                                             STACK_OF(SSL_CIPHER) **cipher_list_by_id,
+                                             const char *rule_str,
+                                             CERT *c)
+{
+    int i, sec_level = -1;
+    uint32_t disabled_enc;
+    STACK_OF(SSL_CIPHER) *cipherstack, *compiled;
+    const SSL_METHOD *ssl_method = ctx->method;
+    SSL_CIPHER_CACHE_ENTRY key;
+
+    /*
+     * Return with error if nothing to do.
+     */
+    if (rule_str == NULL || cipher_list == NULL || cipher_list_by_id == NULL)
+        return NULL;
+
+    if (!check_suiteb_cipher_list(ssl_method, c, &rule_str))
+        return NULL;
+
+    /*
+     * To reduce the work to do we only want to process the compiled
+     * in algorithms, so we first get the mask of disabled ciphers.
+     */
+    memset(&key, 0, sizeof(key));
+    key.get_cipher = ssl_method->get_cipher;
+    key.num_ciphers = ssl_method->num_ciphers();
+    key.dtls = (ssl_method->ssl3_enc->enc_flags & SSL_ENC_FLAG_DTLS) != 0;
+    key.disabled_mkey = ctx->disabled_mkey_mask;
+    key.disabled_auth = ctx->disabled_auth_mask;
+    key.disabled_enc = disabled_enc = ctx->disabled_enc_mask;
+    key.disabled_mac = ctx->disabled_mac_mask;
+    key.rule_str = (char *)rule_str;
+
+    compiled = ssl_cipher_cache_get(&key, &sec_level);
+    if (compiled != NULL) {
+        if (sec_level >= 0 && c != NULL)
+            c->sec_level = sec_level;
+    } else {
+        int old_level = 0;
+
+        /* Find out whether the string sets the security level */
+        if (c != NULL) {
+            old_level = c->sec_level;
+            c->sec_level = -1;
+        }
+        compiled = ssl_compile_cipher_list(ssl_method, key.disabled_mkey,
+                                           key.disabled_auth, key.disabled_enc,
+                                           key.disabled_mac, rule_str, c);
+        if (c != NULL) {
+            sec_level = c->sec_level;
+            if (sec_level < 0)
+                c->sec_level = old_level;
+        }
+        if (compiled == NULL)
+            return NULL;
+        if (ssl_cipher_cache_add(&key, compiled, sec_level))
+            compiled = sk_SSL_CIPHER_dup(compiled);
+        if (compiled == NULL)
+            return NULL;
+    }
+
+    cipherstack = sk_SSL_CIPHER_new_reserve(NULL,
+                                            sk_SSL_CIPHER_num(tls13_ciphersuites)
+                                            + sk_SSL_CIPHER_num(compiled));
+    if (cipherstack == NULL) {
+        sk_SSL_CIPHER_free(compiled);
+        return NULL;
+    }
+
     /* Add TLSv1.3 ciphers first - we always prefer those if possible */
     for (i = 0; i < sk_SSL_CIPHER_num(tls13_ciphersuites); i++) {
         const SSL_CIPHER *sslc = sk_SSL_CIPHER_value(tls13_ciphersuites, i);
@@ -1664,7 +1893,7 @@ STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
         }
 
         if (!sk_SSL_CIPHER_push(cipherstack, sslc)) {
-            OPENSSL_free(co_list);
+            sk_SSL_CIPHER_free(compiled);
             sk_SSL_CIPHER_free(cipherstack);
             return NULL;
         }
@@ -1673,23 +1902,19 @@ STACK_OF(SSL_CIPHER) *ssl_create_cipher_list(SSL_CTX *ctx,
     OSSL_TRACE_BEGIN(TLS_CIPHER) {
         BIO_printf(trc_out, "cipher selection:\n");
     }
-    /*
-     * The cipher selection for the list is done. The ciphers are added
-     * to the resulting precedence to the STACK_OF(SSL_CIPHER).
-     */
-    for (curr = head; curr != NULL; curr = curr->next) {
-        if (curr->active) {
-            if (!sk_SSL_CIPHER_push(cipherstack, curr->cipher)) {
-                OPENSSL_free(co_list);
-                sk_SSL_CIPHER_free(cipherstack);
-                OSSL_TRACE_CANCEL(TLS_CIPHER);
-                return NULL;
-            }
-            if (trc_out != NULL)
-                BIO_printf(trc_out, "<%s>\n", curr->cipher->name);
+    for (i = 0; i < sk_SSL_CIPHER_num(compiled); i++) {
+        const SSL_CIPHER *sslc = sk_SSL_CIPHER_value(compiled, i);
+
+        if (!sk_SSL_CIPHER_push(cipherstack, sslc)) {
+            sk_SSL_CIPHER_free(compiled);
+            sk_SSL_CIPHER_free(cipherstack);
+            OSSL_TRACE_CANCEL(TLS_CIPHER);
+            return NULL;
         }
+        if (trc_out != NULL)
+            BIO_printf(trc_out, "<%s>\n", sslc->name);
     }
-    OPENSSL_free(co_list);      /* Not needed any longer */
+    sk_SSL_CIPHER_free(compiled);
     OSSL_TRACE_END(TLS_CIPHER);
 
     if (!update_cipher_list_by_id(cipher_list_by_id, cipherstack)) {
@@ -80,6 +80,8 @@ static void ssl_library_stop(void)
                    "ssl_comp_free_compression_methods_int()\n");
         ssl_comp_free_compression_methods_int();
 #endif
+        OSSL_TRACE(INIT, "ssl_library_stop: ssl_cipher_cache_free_int()\n");
+        ssl_cipher_cache_free_int();
     }
 }
 
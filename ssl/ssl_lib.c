@@ -829,6 +829,7 @@ SSL *ossl_ssl_connection_new_int(SSL_CTX *ctx, const SSL_METHOD *method)
     s->ext.ocsp.resp_len = 0;
     SSL_CTX_up_ref(ctx);
     s->session_ctx = ctx;
+    s->bufpool = ossl_ssl_buffer_pool_get(ctx);
     if (ctx->ext.ecpointformats) {
         s->ext.ecpointformats =
             OPENSSL_memdup(ctx->ext.ecpointformats,
@@ -1055,7 +1056,7 @@ int SSL_has_matching_session_id(const SSL *ssl, const unsigned char *id,
      * any new session built out of this id/id_len and the ssl_version in use
      * by this SSL.
      */
-    SSL_SESSION r, *p;
+    SSL_SESSION r;
     const SSL_CONNECTION *sc = SSL_CONNECTION_FROM_CONST_SSL(ssl);
 
     if (sc == NULL || id_len > sizeof(r.session_id))
@@ -1065,11 +1066,7 @@ int SSL_has_matching_session_id(const SSL *ssl, const unsigned char *id,
     r.session_id_length = id_len;
     memcpy(r.session_id, id, id_len);
 
-    if (!CRYPTO_THREAD_read_lock(sc->session_ctx->lock))
-        return 0;
-    p = lh_SSL_SESSION_retrieve(sc->session_ctx->sessions, &r);
-    CRYPTO_THREAD_unlock(sc->session_ctx->lock);
-    return (p != NULL);
+    return ssl_sess_cache_has(sc->session_ctx, &r);
 }
 
 int SSL_CTX_set_purpose(SSL_CTX *s, int purpose)
@@ -1463,8 +1460,9 @@ void ossl_ssl_connection_free(SSL *ssl)
     OPENSSL_free(s->ext.alpn);
     OPENSSL_free(s->ext.tls13_cookie);
     if (s->clienthello != NULL)
-        OPENSSL_free(s->clienthello->pre_proc_exts);
-    OPENSSL_free(s->clienthello);
+        ossl_ssl_hs_free(s, s->clienthello->pre_proc_exts);
+    ossl_ssl_hs_free(s, s->clienthello);
+    ossl_ssl_hs_arena_free(s);
     OPENSSL_free(s->pha_context);
     EVP_MD_CTX_free(s->pha_dgst);
 
@@ -1500,6 +1498,9 @@ void ossl_ssl_connection_free(SSL *ssl)
     BIO_free_all(s->rbio);
     s->rbio = NULL;
     OPENSSL_free(s->s3.tmp.valid_flags);
+
+    /* After the record layers have given back their buffers */
+    ossl_ssl_buffer_pool_put(s->bufpool);
 }
 
 void SSL_set0_rbio(SSL *s, BIO *rbio)
@@ -2498,6 +2499,47 @@ int SSL_peek_ex(SSL *s, void *buf, size_t num, size_t *readbytes)
     return ret;
 }
 
+/*
+ * Return the unread plaintext of the next application data record where it
+ * was decrypted, in the read buffer of the record layer.  It is consumed
+ * with SSL_read_release().
+ */
+int SSL_read_peek_record(SSL *s, const unsigned char **data, size_t *len)
+{
+    SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL_ONLY(s);
+    size_t readbytes;
+
+    if (sc == NULL || SSL_CONNECTION_IS_DTLS(sc)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_UNSUPPORTED);
+        return 0;
+    }
+
+    /*
+     * Peeking at a single byte lets the usual read path deal with the
+     * handshake, alerts and anything else that precedes application data.
+     * With SSL_MODE_ASYNC the job keeps the buffer until it finishes, so the
+     * byte must not live on our stack.
+     */
+    if (ssl_peek_internal(s, &sc->peek_byte, 1, &readbytes) <= 0)
+        return 0;
+    if (!RECORD_LAYER_get_app_data(&sc->rlayer, data, len)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+    return 1;
+}
+
+int SSL_read_release(SSL *s, size_t len)
+{
+    SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL_ONLY(s);
+
+    if (sc == NULL || SSL_CONNECTION_IS_DTLS(sc)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_UNSUPPORTED);
+        return 0;
+    }
+    return RECORD_LAYER_release_app_data(&sc->rlayer, len);
+}
+
 int ssl_write_internal(SSL *s, const void *buf, size_t num, size_t *written)
 {
     SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL(s);
@@ -2647,6 +2689,63 @@ int SSL_write_ex(SSL *s, const void *buf, size_t num, size_t *written)
     return ret;
 }
 
+/* Adapts ssl3_writev() to the function type used for async jobs */
+static int ssl_writev_intern(SSL *s, const void *iov, size_t iovcnt,
+                             size_t *written)
+{
+    return ssl3_writev(s, iov, iovcnt, written);
+}
+
+int SSL_writev(SSL *s, const SSL_IOVEC *iov, size_t iovcnt, size_t *written)
+{
+    SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL_ONLY(s);
+    int ret;
+
+    if (sc == NULL || SSL_CONNECTION_IS_DTLS(sc)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_UNSUPPORTED);
+        return 0;
+    }
+
+    if (sc->handshake_func == NULL) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_UNINITIALIZED);
+        return 0;
+    }
+
+    if (sc->shutdown & SSL_SENT_SHUTDOWN) {
+        sc->rwstate = SSL_NOTHING;
+        ERR_raise(ERR_LIB_SSL, SSL_R_PROTOCOL_IS_SHUTDOWN);
+        return 0;
+    }
+
+    if (sc->early_data_state == SSL_EARLY_DATA_CONNECT_RETRY
+                || sc->early_data_state == SSL_EARLY_DATA_ACCEPT_RETRY
+                || sc->early_data_state == SSL_EARLY_DATA_READ_RETRY) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_SHOULD_NOT_HAVE_BEEN_CALLED);
+        return 0;
+    }
+    /* If we are a client and haven't sent the Finished we better do that */
+    ossl_statem_check_finish_init(sc, 1);
+
+    if ((sc->mode & SSL_MODE_ASYNC) && ASYNC_get_current_job() == NULL) {
+        struct ssl_async_args args;
+
+        args.s = s;
+        args.buf = (void *)iov;
+        args.num = iovcnt;
+        args.type = WRITEFUNC;
+        args.f.func_write = ssl_writev_intern;
+
+        ret = ssl_start_async_job(s, &args, ssl_io_intern);
+        *written = sc->asyncrw;
+    } else {
+        ret = ssl3_writev(s, iov, iovcnt, written);
+    }
+
+    if (ret < 0)
+        ret = 0;
+    return ret;
+}
+
 int SSL_write_early_data(SSL *s, const void *buf, size_t num, size_t *written)
 {
     int ret, early_data_state;
@@ -3019,7 +3118,10 @@ long SSL_callback_ctrl(SSL *s, int cmd, void (*fp) (void))
 
 LHASH_OF(SSL_SESSION) *SSL_CTX_sessions(SSL_CTX *ctx)
 {
-    return ctx->sessions;
+    /* There's no single table to return once the cache is sharded */
+    if (ctx->sess_num_shards != 1)
+        return NULL;
+    return ctx->sess_shards[0].sessions;
 }
 
 static int ssl_tsan_load(SSL_CTX *ctx, TSAN_QUALIFIER int *stat)
@@ -3078,6 +3180,12 @@ long SSL_CTX_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
         return l;
     case SSL_CTRL_GET_SESS_CACHE_SIZE:
         return (long)ctx->session_cache_size;
+    case SSL_CTRL_SET_SESS_CACHE_SHARDS:
+        if (larg <= 0)
+            return 0;
+        return ssl_sess_cache_init(ctx, (size_t)larg);
+    case SSL_CTRL_GET_SESS_CACHE_SHARDS:
+        return (long)ctx->sess_num_shards;
     case SSL_CTRL_SET_SESS_CACHE_MODE:
         l = ctx->session_cache_mode;
         ctx->session_cache_mode = larg;
@@ -3086,7 +3194,7 @@ long SSL_CTX_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
         return ctx->session_cache_mode;
 
     case SSL_CTRL_SESS_NUMBER:
-        return lh_SSL_SESSION_num_items(ctx->sessions);
+        return (long)ssl_sess_cache_num(ctx);
     case SSL_CTRL_SESS_CONNECT:
         return ssl_tsan_load(ctx, &ctx->stats.sess_connect);
     case SSL_CTRL_SESS_CONNECT_GOOD:
@@ -3770,7 +3878,7 @@ int SSL_export_keying_material_early(SSL *s, unsigned char *out, size_t olen,
                                               context, contextlen);
 }
 
-static unsigned long ssl_session_hash(const SSL_SESSION *a)
+unsigned long ssl_session_hash(const SSL_SESSION *a)
 {
     const unsigned char *session_id = a->session_id;
     unsigned long l;
@@ -3797,7 +3905,7 @@ static unsigned long ssl_session_hash(const SSL_SESSION *a)
  * being able to construct an SSL_SESSION that will collide with any existing
  * session with a matching session ID.
  */
-static int ssl_session_cmp(const SSL_SESSION *a, const SSL_SESSION *b)
+int ssl_session_cmp(const SSL_SESSION *a, const SSL_SESSION *b)
 {
     if (a->ssl_version != b->ssl_version)
         return 1;
@@ -3813,8 +3921,106 @@ static int ssl_session_cmp(const SSL_SESSION *a, const SSL_SESSION *b)
  * via ssl.h.
  */
 
-SSL_CTX *SSL_CTX_new_ex(OSSL_LIB_CTX *libctx, const char *propq,
-                        const SSL_METHOD *meth)
+/*
+ * Give |ctx| the cipher and digest methods, groups and signature algorithms
+ * of |tmpl|.  These are never changed once loaded, so rather than copying
+ * them both contexts refer to the same tables, which are freed along with
+ * the last context that uses them.
+ */
+static int ssl_ctx_share_algs(SSL_CTX *ctx, SSL_CTX *tmpl)
+{
+    int i;
+
+    if (CRYPTO_UP_REF(tmpl->algs_references, &i) <= 0)
+        return 0;
+    ctx->algs_references = tmpl->algs_references;
+
+    memcpy(ctx->ssl_mac_pkey_id, tmpl->ssl_mac_pkey_id,
+           sizeof(ctx->ssl_mac_pkey_id));
+    memcpy(ctx->ssl_cipher_methods, tmpl->ssl_cipher_methods,
+           sizeof(ctx->ssl_cipher_methods));
+    memcpy(ctx->ssl_digest_methods, tmpl->ssl_digest_methods,
+           sizeof(ctx->ssl_digest_methods));
+    memcpy(ctx->ssl_mac_secret_size, tmpl->ssl_mac_secret_size,
+           sizeof(ctx->ssl_mac_secret_size));
+    ctx->md5 = tmpl->md5;
+    ctx->sha1 = tmpl->sha1;
+
+    ctx->tls12_sigalgs_len = tmpl->tls12_sigalgs_len;
+    ctx->sigalg_lookup_cache = tmpl->sigalg_lookup_cache;
+    ctx->tls12_sigalgs = tmpl->tls12_sigalgs;
+    ctx->group_list = tmpl->group_list;
+    ctx->group_list_len = tmpl->group_list_len;
+    ctx->group_list_max_len = tmpl->group_list_max_len;
+    ctx->sigalg_list = tmpl->sigalg_list;
+    ctx->sigalg_list_len = tmpl->sigalg_list_len;
+    ctx->sigalg_list_max_len = tmpl->sigalg_list_max_len;
+    ctx->ssl_cert_info = tmpl->ssl_cert_info;
+
+    if (tmpl->ext.supported_groups_default != NULL) {
+        ctx->ext.supported_groups_default =
+            OPENSSL_memdup(tmpl->ext.supported_groups_default,
+                           tmpl->ext.supported_groups_default_len
+                           * sizeof(*tmpl->ext.supported_groups_default));
+        if (ctx->ext.supported_groups_default == NULL)
+            return 0;
+        ctx->ext.supported_groups_default_len =
+            tmpl->ext.supported_groups_default_len;
+    }
+
+    ctx->disabled_enc_mask = tmpl->disabled_enc_mask;
+    ctx->disabled_mac_mask = tmpl->disabled_mac_mask;
+    ctx->disabled_mkey_mask = tmpl->disabled_mkey_mask;
+    ctx->disabled_auth_mask = tmpl->disabled_auth_mask;
+    return 1;
+}
+
+/* Fetch the algorithm tables of a new |ctx| from its providers */
+static int ssl_ctx_load_algs(SSL_CTX *ctx)
+{
+    ctx->algs_references = OPENSSL_malloc(sizeof(*ctx->algs_references));
+    if (ctx->algs_references == NULL)
+        return 0;
+    if (!CRYPTO_NEW_REF(ctx->algs_references, 1)) {
+        OPENSSL_free(ctx->algs_references);
+        ctx->algs_references = NULL;
+        return 0;
+    }
+
+    /* initialize cipher/digest methods table */
+    if (!ssl_load_ciphers(ctx)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_SSL_LIB);
+        return 0;
+    }
+
+    if (!ssl_load_groups(ctx)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_SSL_LIB);
+        return 0;
+    }
+
+    /* load provider sigalgs */
+    if (!ssl_load_sigalgs(ctx)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_SSL_LIB);
+        return 0;
+    }
+
+    /* initialise sig algs */
+    if (!ssl_setup_sigalgs(ctx)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_SSL_LIB);
+        return 0;
+    }
+
+    /*
+     * If these aren't available from the provider we'll get NULL returns.
+     * That's fine but will cause errors later if SSLv3 is negotiated
+     */
+    ctx->md5 = ssl_evp_md_fetch(ctx->libctx, NID_md5, ctx->propq);
+    ctx->sha1 = ssl_evp_md_fetch(ctx->libctx, NID_sha1, ctx->propq);
+    return 1;
+}
+
+static SSL_CTX *ssl_ctx_new_intern(OSSL_LIB_CTX *libctx, const char *propq,
+                                   const SSL_METHOD *meth, SSL_CTX *tmpl)
 {
     SSL_CTX *ret = NULL;
 #ifndef OPENSSL_NO_COMP_ALG
@@ -3877,11 +4083,8 @@ SSL_CTX *SSL_CTX_new_ex(OSSL_LIB_CTX *libctx, const char *propq,
     ret->max_cert_list = SSL_MAX_CERT_LIST_DEFAULT;
     ret->verify_mode = SSL_VERIFY_NONE;
 
-    ret->sessions = lh_SSL_SESSION_new(ssl_session_hash, ssl_session_cmp);
-    if (ret->sessions == NULL) {
-        ERR_raise(ERR_LIB_SSL, ERR_R_CRYPTO_LIB);
+    if (!ssl_sess_cache_init(ret, 1))
         goto err;
-    }
     ret->cert_store = X509_STORE_new();
     if (ret->cert_store == NULL) {
         ERR_raise(ERR_LIB_SSL, ERR_R_X509_LIB);
@@ -3895,25 +4098,8 @@ SSL_CTX *SSL_CTX_new_ex(OSSL_LIB_CTX *libctx, const char *propq,
     }
 #endif
 
-    /* initialize cipher/digest methods table */
-    if (!ssl_load_ciphers(ret)) {
-        ERR_raise(ERR_LIB_SSL, ERR_R_SSL_LIB);
-        goto err;
-    }
-
-    if (!ssl_load_groups(ret)) {
-        ERR_raise(ERR_LIB_SSL, ERR_R_SSL_LIB);
-        goto err;
-    }
-
-    /* load provider sigalgs */
-    if (!ssl_load_sigalgs(ret)) {
-        ERR_raise(ERR_LIB_SSL, ERR_R_SSL_LIB);
-        goto err;
-    }
-
-    /* initialise sig algs */
-    if (!ssl_setup_sigalgs(ret)) {
+    if (tmpl != NULL ? !ssl_ctx_share_algs(ret, tmpl)
+                     : !ssl_ctx_load_algs(ret)) {
         ERR_raise(ERR_LIB_SSL, ERR_R_SSL_LIB);
         goto err;
     }
@@ -3943,13 +4129,6 @@ SSL_CTX *SSL_CTX_new_ex(OSSL_LIB_CTX *libctx, const char *propq,
         goto err;
     }
 
-    /*
-     * If these aren't available from the provider we'll get NULL returns.
-     * That's fine but will cause errors later if SSLv3 is negotiated
-     */
-    ret->md5 = ssl_evp_md_fetch(libctx, NID_md5, propq);
-    ret->sha1 = ssl_evp_md_fetch(libctx, NID_sha1, propq);
-
     if ((ret->ca_names = sk_X509_NAME_new_null()) == NULL) {
         ERR_raise(ERR_LIB_SSL, ERR_R_CRYPTO_LIB);
         goto err;
@@ -4080,6 +4259,21 @@ SSL_CTX *SSL_CTX_new_ex(OSSL_LIB_CTX *libctx, const char *propq,
     return NULL;
 }
 
+SSL_CTX *SSL_CTX_new_ex(OSSL_LIB_CTX *libctx, const char *propq,
+                        const SSL_METHOD *meth)
+{
+    return ssl_ctx_new_intern(libctx, propq, meth, NULL);
+}
+
+SSL_CTX *SSL_CTX_new_from_template(SSL_CTX *tmpl, const SSL_METHOD *meth)
+{
+    if (tmpl == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_NULL_PARAMETER);
+        return NULL;
+    }
+    return ssl_ctx_new_intern(tmpl->libctx, tmpl->propq, meth, tmpl);
+}
+
 SSL_CTX *SSL_CTX_new(const SSL_METHOD *meth)
 {
     return SSL_CTX_new_ex(NULL, NULL, meth);
@@ -4123,11 +4317,11 @@ void SSL_CTX_free(SSL_CTX *a)
      * free ex_data, then finally free the cache.
      * (See ticket [openssl.org #212].)
      */
-    if (a->sessions != NULL)
-        SSL_CTX_flush_sessions(a, 0);
+    SSL_CTX_flush_sessions(a, 0);
 
     CRYPTO_free_ex_data(CRYPTO_EX_INDEX_SSL_CTX, a, &a->ex_data);
-    lh_SSL_SESSION_free(a->sessions);
+    ssl_sess_cache_free(a);
+    ossl_ssl_sess_shm_free(a);
     X509_STORE_free(a->cert_store);
 #ifndef OPENSSL_NO_CT
     CTLOG_STORE_free(a->ctlog_store);
@@ -4155,36 +4349,49 @@ void SSL_CTX_free(SSL_CTX *a)
     OPENSSL_free(a->ext.supported_groups_default);
     OPENSSL_free(a->ext.alpn);
     OPENSSL_secure_free(a->ext.secure);
+    ossl_ssl_ticket_key_ring_free(a);
+    ossl_ssl_buffer_pool_free(a);
+
+    /* The algorithm tables may be shared, see ssl_ctx_share_algs() */
+    i = 0;
+    if (a->algs_references != NULL)
+        CRYPTO_DOWN_REF(a->algs_references, &i);
+    if (i <= 0) {
+        ssl_evp_md_free(a->md5);
+        ssl_evp_md_free(a->sha1);
+
+        for (j = 0; j < SSL_ENC_NUM_IDX; j++)
+            ssl_evp_cipher_free(a->ssl_cipher_methods[j]);
+        for (j = 0; j < SSL_MD_NUM_IDX; j++)
+            ssl_evp_md_free(a->ssl_digest_methods[j]);
+        for (j = 0; j < a->group_list_len; j++) {
+            OPENSSL_free(a->group_list[j].tlsname);
+            OPENSSL_free(a->group_list[j].realname);
+            OPENSSL_free(a->group_list[j].algorithm);
+        }
+        OPENSSL_free(a->group_list);
+        for (j = 0; j < a->sigalg_list_len; j++) {
+            OPENSSL_free(a->sigalg_list[j].name);
+            OPENSSL_free(a->sigalg_list[j].sigalg_name);
+            OPENSSL_free(a->sigalg_list[j].sigalg_oid);
+            OPENSSL_free(a->sigalg_list[j].sig_name);
+            OPENSSL_free(a->sigalg_list[j].sig_oid);
+            OPENSSL_free(a->sigalg_list[j].hash_name);
+            OPENSSL_free(a->sigalg_list[j].hash_oid);
+            OPENSSL_free(a->sigalg_list[j].keytype);
+            OPENSSL_free(a->sigalg_list[j].keytype_oid);
+        }
+        OPENSSL_free(a->sigalg_list);
+        OPENSSL_free(a->ssl_cert_info);
 
-    ssl_evp_md_free(a->md5);
-    ssl_evp_md_free(a->sha1);
-
-    for (j = 0; j < SSL_ENC_NUM_IDX; j++)
-        ssl_evp_cipher_free(a->ssl_cipher_methods[j]);
-    for (j = 0; j < SSL_MD_NUM_IDX; j++)
-        ssl_evp_md_free(a->ssl_digest_methods[j]);
-    for (j = 0; j < a->group_list_len; j++) {
-        OPENSSL_free(a->group_list[j].tlsname);
-        OPENSSL_free(a->group_list[j].realname);
-        OPENSSL_free(a->group_list[j].algorithm);
-    }
-    OPENSSL_free(a->group_list);
-    for (j = 0; j < a->sigalg_list_len; j++) {
-        OPENSSL_free(a->sigalg_list[j].name);
-        OPENSSL_free(a->sigalg_list[j].sigalg_name);
-        OPENSSL_free(a->sigalg_list[j].sigalg_oid);
-        OPENSSL_free(a->sigalg_list[j].sig_name);
-        OPENSSL_free(a->sigalg_list[j].sig_oid);
-        OPENSSL_free(a->sigalg_list[j].hash_name);
-        OPENSSL_free(a->sigalg_list[j].hash_oid);
-        OPENSSL_free(a->sigalg_list[j].keytype);
-        OPENSSL_free(a->sigalg_list[j].keytype_oid);
-    }
-    OPENSSL_free(a->sigalg_list);
-    OPENSSL_free(a->ssl_cert_info);
-
-    OPENSSL_free(a->sigalg_lookup_cache);
-    OPENSSL_free(a->tls12_sigalgs);
+        OPENSSL_free(a->sigalg_lookup_cache);
+        OPENSSL_free(a->tls12_sigalgs);
+
+        if (a->algs_references != NULL) {
+            CRYPTO_FREE_REF(a->algs_references);
+            OPENSSL_free(a->algs_references);
+        }
+    }
 
     OPENSSL_free(a->client_cert_type);
     OPENSSL_free(a->server_cert_type);
@@ -4491,6 +4698,15 @@ void ssl_update_cache(SSL_CONNECTION *s, int mode)
                     || (s->options & SSL_OP_NO_TICKET) != 0))
             SSL_CTX_add_session(s->session_ctx, s->session);
 
+        /*
+         * Add the session to the cache in shared memory, if there is one,
+         * whenever it can be resumed by session ID.
+         */
+        if (s->server
+                && (!SSL_CONNECTION_IS_TLS13(s)
+                    || (s->options & SSL_OP_NO_TICKET) != 0))
+            (void)ossl_ssl_sess_shm_add(s->session_ctx, s->session);
+
         /*
          * Add the session to the external cache. We do this even in server side
          * TLSv1.3 without early data because some applications just want to
@@ -4504,7 +4720,10 @@ void ssl_update_cache(SSL_CONNECTION *s, int mode)
         }
     }
 
-    /* auto flush every 255 connections */
+    /*
+     * Expire a few sessions on every connection, going round the shards of
+     * the cache in turn, rather than flushing all of it every so often
+     */
     if ((!(i & SSL_SESS_CACHE_NO_AUTO_CLEAR)) && ((i & mode) == mode)) {
         TSAN_QUALIFIER int *stat;
 
@@ -4512,8 +4731,8 @@ void ssl_update_cache(SSL_CONNECTION *s, int mode)
             stat = &s->session_ctx->stats.sess_connect_good;
         else
             stat = &s->session_ctx->stats.sess_accept_good;
-        if ((ssl_tsan_load(s->session_ctx, stat) & 0xff) == 0xff)
-            SSL_CTX_flush_sessions(s->session_ctx, (unsigned long)time(NULL));
+        ssl_sess_cache_expire(s->session_ctx,
+                              (size_t)ssl_tsan_load(s->session_ctx, stat));
     }
 }
 
@@ -801,6 +801,27 @@ typedef struct {
 
 # define TLS_GROUP_FFDHE_FOR_TLS1_3 (TLS_GROUP_FFDHE|TLS_GROUP_ONLY_FOR_TLS1_3)
 
+/* Session ticket keys for AEAD sealed tickets, see ssl_ticket_keys.c */
+typedef struct ssl_ticket_key_ring_st SSL_TICKET_KEY_RING;
+/* Layout of a sealed ticket: key name, nonce, ciphertext, tag */
+# define SSL_TICKET_NONCE_LEN    12
+# define SSL_TICKET_TAG_LEN      16
+
+/* A session cache shared between processes, see ssl_sess_shm.c */
+typedef struct ssl_sess_shm_st SSL_SESS_SHM;
+
+/* Record layer buffers shared between connections, see ssl_bufpool.c */
+typedef struct ssl_buffer_pool_st SSL_BUFFER_POOL;
+
+/* A shard of the internal session cache, see ssl_sess.c */
+typedef struct ssl_sess_shard_st {
+    CRYPTO_RWLOCK *lock;
+    LHASH_OF(SSL_SESSION) *sessions;
+    /* Sessions ordered by expiry time, the next one to expire is the tail */
+    struct ssl_session_st *head;
+    struct ssl_session_st *tail;
+} SSL_SESS_SHARD;
+
 struct ssl_ctx_st {
     OSSL_LIB_CTX *libctx;
 
@@ -811,14 +832,21 @@ struct ssl_ctx_st {
     /* TLSv1.3 specific ciphersuites */
     STACK_OF(SSL_CIPHER) *tls13_ciphersuites;
     struct x509_store_st /* X509_STORE */ *cert_store;
-    LHASH_OF(SSL_SESSION) *sessions;
+    /*
+     * The internal session cache, split into a power of two number of
+     * shards that are each guarded by their own lock.
+     */
+    SSL_SESS_SHARD *sess_shards;
+    size_t sess_num_shards;
+    /* The session cache in shared memory, if any */
+    SSL_SESS_SHM *sess_shm;
+    /* The pool that new connections borrow record layer buffers from */
+    SSL_BUFFER_POOL *bufpool;
     /*
      * Most session-ids that will be cached, default is
      * SSL_SESSION_CACHE_MAX_SIZE_DEFAULT. 0 is unlimited.
      */
     size_t session_cache_size;
-    struct ssl_session_st *session_cache_head;
-    struct ssl_session_st *session_cache_tail;
     /*
      * This can have one of 2 values, ored together, SSL_SESS_CACHE_CLIENT,
      * SSL_SESS_CACHE_SERVER, Default is SSL_SESSION_CACHE_SERVER, which
@@ -1003,6 +1031,8 @@ struct ssl_ctx_st {
         /* RFC 4507 session ticket keys */
         unsigned char tick_key_name[TLSEXT_KEYNAME_LENGTH];
         SSL_CTX_EXT_SECURE *secure;
+        /* Keys that take over from the ones above when set */
+        SSL_TICKET_KEY_RING *ticket_keys;
 # ifndef OPENSSL_NO_DEPRECATED_3_0
         /* Callback to support customisation of ticket key setting */
         int (*ticket_key_cb) (SSL *ssl,
@@ -1151,6 +1181,14 @@ struct ssl_ctx_st {
 
     char *propq;
 
+    /*
+     * The algorithm tables from here to the disabled masks, along with md5
+     * and sha1, are filled in from the providers when the SSL_CTX is
+     * created and never changed.  SSL_CTX_new_from_template() shares them
+     * between contexts, and this counts the contexts using them.
+     */
+    CRYPTO_REF_COUNT *algs_references;
+
     int ssl_mac_pkey_id[SSL_MD_NUM_IDX];
     const EVP_CIPHER *ssl_cipher_methods[SSL_ENC_NUM_IDX];
     const EVP_MD *ssl_digest_methods[SSL_MD_NUM_IDX];
@@ -1205,6 +1243,20 @@ struct ssl_st {
     CRYPTO_EX_DATA ex_data;
 };
 
+/*
+ * Bump allocator for short-lived handshake data, used when
+ * SSL_MODE_HANDSHAKE_ARENA is set.
+ */
+typedef struct ssl_hs_arena_block_st SSL_HS_ARENA_BLOCK;
+
+typedef struct {
+    SSL_HS_ARENA_BLOCK *blocks;
+    /* Number of arena allocations not yet freed */
+    size_t live;
+    uint64_t arena_allocs;
+    uint64_t heap_allocs;
+} SSL_HS_ARENA;
+
 struct ssl_connection_st {
     /* type identifier and common data */
     struct ssl_st ssl;
@@ -1683,6 +1735,12 @@ struct ssl_connection_st {
      */
     CLIENTHELLO_MSG *clienthello;
 
+    /* Handshake scoped allocations, see ossl_ssl_hs_malloc() */
+    SSL_HS_ARENA hs_arena;
+
+    /* Where the record layers borrow their buffers from, if anywhere */
+    SSL_BUFFER_POOL *bufpool;
+
     /*-
      * no further mod of servername
      * 0 : call the servername extension callback.
@@ -1750,6 +1808,11 @@ struct ssl_connection_st {
     ASYNC_JOB *job;
     ASYNC_WAIT_CTX *waitctx;
     size_t asyncrw;
+    /*
+     * The byte SSL_read_peek_record() peeks into, which has to outlive an
+     * async job that pauses
+     */
+    unsigned char peek_byte;
 
     /*
      * The maximum number of bytes advertised in session tickets that can be
@@ -2482,6 +2545,35 @@ __owur int ssl_get_new_session(SSL_CONNECTION *s, int session);
 __owur SSL_SESSION *lookup_sess_in_cache(SSL_CONNECTION *s,
                                          const unsigned char *sess_id,
                                          size_t sess_id_len);
+unsigned long ssl_session_hash(const SSL_SESSION *a);
+int ssl_session_cmp(const SSL_SESSION *a, const SSL_SESSION *b);
+__owur int ssl_sess_cache_init(SSL_CTX *ctx, size_t num);
+void ssl_sess_cache_free(SSL_CTX *ctx);
+size_t ssl_sess_cache_num(const SSL_CTX *ctx);
+int ssl_sess_cache_has(SSL_CTX *ctx, const SSL_SESSION *key);
+void ssl_sess_cache_expire(SSL_CTX *ctx, size_t n);
+void ossl_ssl_sess_shm_free(SSL_CTX *ctx);
+int ossl_ssl_sess_shm_add(SSL_CTX *ctx, SSL_SESSION *sess);
+SSL_SESSION *ossl_ssl_sess_shm_get(SSL_CTX *ctx, int version,
+                                   const unsigned char *id, size_t id_len);
+void ossl_ssl_sess_shm_remove(SSL_CTX *ctx, const SSL_SESSION *sess);
+#  ifndef OPENSSL_NO_UNIT_TEST
+/* For tests only: take the lock of the bucket for |id| and keep it */
+int ossl_ssl_sess_shm_lock_id(SSL_CTX *ctx, const unsigned char *id,
+                              size_t id_len);
+#  endif
+void ossl_ssl_ticket_key_ring_free(SSL_CTX *ctx);
+void ossl_ssl_buffer_pool_free(SSL_CTX *ctx);
+SSL_BUFFER_POOL *ossl_ssl_buffer_pool_get(SSL_CTX *ctx);
+void ossl_ssl_buffer_pool_put(SSL_BUFFER_POOL *pool);
+unsigned char *ossl_ssl_buffer_pool_alloc(SSL_BUFFER_POOL *pool, size_t len);
+void ossl_ssl_buffer_pool_release(SSL_BUFFER_POOL *pool, unsigned char *buf);
+int ossl_ssl_ticket_key_ring_in_use(const SSL_CTX *ctx);
+EVP_CIPHER_CTX *ossl_ssl_ticket_key_get_enc(SSL_CTX *ctx, unsigned char *name);
+EVP_CIPHER_CTX *ossl_ssl_ticket_key_get_dec(SSL_CTX *ctx,
+                                            const unsigned char *name,
+                                            int *renew);
+void ossl_ssl_ticket_key_release(SSL_CTX *ctx);
 __owur int ssl_get_prev_session(SSL_CONNECTION *s, CLIENTHELLO_MSG *hello);
 __owur SSL_SESSION *ssl_session_dup(const SSL_SESSION *src, int ticket);
 __owur int ssl_cipher_id_cmp(const SSL_CIPHER *a, const SSL_CIPHER *b);
@@ -2616,6 +2708,8 @@ void ssl3_free(SSL *s);
 __owur int ssl3_read(SSL *s, void *buf, size_t len, size_t *readbytes);
 __owur int ssl3_peek(SSL *s, void *buf, size_t len, size_t *readbytes);
 __owur int ssl3_write(SSL *s, const void *buf, size_t len, size_t *written);
+__owur int ssl3_writev(SSL *s, const SSL_IOVEC *iov, size_t iovcnt,
+                       size_t *written);
 __owur int ssl3_shutdown(SSL *s);
 int ssl3_clear(SSL *s);
 __owur long ssl3_ctrl(SSL *s, int cmd, long larg, void *parg);
@@ -2697,6 +2791,12 @@ __owur int dtls1_dispatch_alert(SSL *s);
 __owur int ssl_init_wbio_buffer(SSL_CONNECTION *s);
 int ssl_free_wbio_buffer(SSL_CONNECTION *s);
 
+__owur void *ossl_ssl_hs_malloc(SSL_CONNECTION *s, size_t num);
+__owur void *ossl_ssl_hs_zalloc(SSL_CONNECTION *s, size_t num);
+void ossl_ssl_hs_free(SSL_CONNECTION *s, void *ptr);
+void ossl_ssl_hs_arena_reset(SSL_CONNECTION *s);
+void ossl_ssl_hs_arena_free(SSL_CONNECTION *s);
+
 __owur int tls1_change_cipher_state(SSL_CONNECTION *s, int which);
 __owur int tls1_setup_key_block(SSL_CONNECTION *s);
 __owur size_t tls1_final_finish_mac(SSL_CONNECTION *s, const char *str,
@@ -2919,6 +3019,7 @@ __owur int custom_exts_copy_flags(custom_ext_methods *dst,
 void custom_exts_free(custom_ext_methods *exts);
 
 void ssl_comp_free_compression_methods_int(void);
+void ssl_cipher_cache_free_int(void);
 
 /* ssl_mcnf.c */
 void ssl_ctx_system_config(SSL_CTX *ctx);
@@ -20,12 +20,22 @@
 #include "ssl_local.h"
 #include "statem/statem_local.h"
 
-static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s);
-static void SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESSION *s);
+static void SSL_SESSION_list_remove(SSL_SESS_SHARD *shard, SSL_SESSION *s);
+static void SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESS_SHARD *shard,
+                                 SSL_SESSION *s);
 static int remove_session_lock(SSL_CTX *ctx, SSL_SESSION *c, int lck);
 
 DEFINE_STACK_OF(SSL_SESSION)
 
+/*
+ * More shards than this don't reduce lock contention any further.  The
+ * shard is picked from the top SSL_SESS_SHARD_BITS of the mixed hash.
+ */
+#define SSL_SESS_SHARD_BITS     8
+#define SSL_SESS_MAX_SHARDS     (1 << SSL_SESS_SHARD_BITS)
+/* Most expired sessions removed from a shard by ssl_sess_cache_expire() */
+#define SSL_SESS_EXPIRE_BATCH   4
+
 __owur static ossl_inline int sess_timedout(OSSL_TIME t, SSL_SESSION *ss)
 {
     return ossl_time_compare(t, ss->calc_timeout) > 0;
@@ -49,6 +59,106 @@ void ssl_session_calculate_timeout(SSL_SESSION *ss)
     ss->calc_timeout = ossl_time_add(ss->time, ss->timeout);
 }
 
+/*
+ * Pick the cache shard for a session, using the same hash as the hash table
+ * in each shard.  That hash is just the first four bytes of the session ID,
+ * and the hash table picks buckets using its low bits.  So the hash is
+ * mixed by a multiplication first, which makes its top bits depend on all
+ * of the bytes, and the shard is picked from those.  Session IDs of which
+ * some byte never changes are then still spread over all shards.
+ */
+static SSL_SESS_SHARD *sess_shard(const SSL_CTX *ctx, const SSL_SESSION *s)
+{
+    uint32_t h;
+
+    if (ctx->sess_num_shards == 1)
+        return ctx->sess_shards;
+    h = (uint32_t)ssl_session_hash(s) * 0x9e3779b1U;
+    h >>= 32 - SSL_SESS_SHARD_BITS;
+    return &ctx->sess_shards[h & (ctx->sess_num_shards - 1)];
+}
+
+static void sess_shards_free(SSL_SESS_SHARD *shards, size_t num)
+{
+    size_t i;
+
+    if (shards == NULL)
+        return;
+    for (i = 0; i < num; i++) {
+        lh_SSL_SESSION_free(shards[i].sessions);
+        CRYPTO_THREAD_lock_free(shards[i].lock);
+    }
+    OPENSSL_free(shards);
+}
+
+/*
+ * Set up the internal session cache of |ctx| with |num| shards, rounded up
+ * to a power of two.  This replaces the existing shards, which must be
+ * empty.
+ */
+int ssl_sess_cache_init(SSL_CTX *ctx, size_t num)
+{
+    SSL_SESS_SHARD *shards;
+    size_t i, n = 1;
+
+    if (num == 0 || num > SSL_SESS_MAX_SHARDS) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+    if (ctx->sess_shards != NULL && ssl_sess_cache_num(ctx) != 0) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_SHOULD_NOT_HAVE_BEEN_CALLED);
+        return 0;
+    }
+    while (n < num)
+        n <<= 1;
+
+    if ((shards = OPENSSL_zalloc(n * sizeof(*shards))) == NULL)
+        return 0;
+    for (i = 0; i < n; i++) {
+        shards[i].lock = CRYPTO_THREAD_lock_new();
+        shards[i].sessions = lh_SSL_SESSION_new(ssl_session_hash,
+                                                ssl_session_cmp);
+        if (shards[i].lock == NULL || shards[i].sessions == NULL) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_CRYPTO_LIB);
+            sess_shards_free(shards, n);
+            return 0;
+        }
+    }
+
+    sess_shards_free(ctx->sess_shards, ctx->sess_num_shards);
+    ctx->sess_shards = shards;
+    ctx->sess_num_shards = n;
+    return 1;
+}
+
+void ssl_sess_cache_free(SSL_CTX *ctx)
+{
+    sess_shards_free(ctx->sess_shards, ctx->sess_num_shards);
+    ctx->sess_shards = NULL;
+    ctx->sess_num_shards = 0;
+}
+
+size_t ssl_sess_cache_num(const SSL_CTX *ctx)
+{
+    size_t i, n = 0;
+
+    for (i = 0; i < ctx->sess_num_shards; i++)
+        n += lh_SSL_SESSION_num_items(ctx->sess_shards[i].sessions);
+    return n;
+}
+
+int ssl_sess_cache_has(SSL_CTX *ctx, const SSL_SESSION *key)
+{
+    SSL_SESS_SHARD *shard = sess_shard(ctx, key);
+    int ret;
+
+    if (!CRYPTO_THREAD_read_lock(shard->lock))
+        return 0;
+    ret = lh_SSL_SESSION_retrieve(shard->sessions, key) != NULL;
+    CRYPTO_THREAD_unlock(shard->lock);
+    return ret;
+}
+
 /*
  * SSL_get_session() and SSL_get1_session() are problematic in TLS1.3 because,
  * unlike in earlier protocol versions, the session ticket may not have been
@@ -467,6 +577,26 @@ int ssl_get_new_session(SSL_CONNECTION *s, int session)
     return 1;
 }
 
+/*
+ * Account for a session found in the shared memory cache or by the
+ * get_session_cb, and add it to the internal cache as well if and only if
+ * we are supposed to.
+ */
+static void sess_found_externally(SSL_CONNECTION *s, SSL_SESSION *sess)
+{
+    ssl_tsan_counter(s->session_ctx, &s->session_ctx->stats.sess_cb_hit);
+
+    if ((s->session_ctx->session_cache_mode &
+         SSL_SESS_CACHE_NO_INTERNAL_STORE) == 0) {
+        /*
+         * Either return value of SSL_CTX_add_session should not
+         * interrupt the session resumption process. The return
+         * value is intentionally ignored.
+         */
+        (void)SSL_CTX_add_session(s->session_ctx, sess);
+    }
+}
+
 SSL_SESSION *lookup_sess_in_cache(SSL_CONNECTION *s,
                                   const unsigned char *sess_id,
                                   size_t sess_id_len)
@@ -476,6 +606,7 @@ SSL_SESSION *lookup_sess_in_cache(SSL_CONNECTION *s,
     if ((s->session_ctx->session_cache_mode
          & SSL_SESS_CACHE_NO_INTERNAL_LOOKUP) == 0) {
         SSL_SESSION data;
+        SSL_SESS_SHARD *shard;
 
         data.ssl_version = s->version;
         if (!ossl_assert(sess_id_len <= SSL_MAX_SSL_SESSION_ID_LENGTH))
@@ -483,19 +614,25 @@ SSL_SESSION *lookup_sess_in_cache(SSL_CONNECTION *s,
 
         memcpy(data.session_id, sess_id, sess_id_len);
         data.session_id_length = sess_id_len;
+        shard = sess_shard(s->session_ctx, &data);
 
-        if (!CRYPTO_THREAD_read_lock(s->session_ctx->lock))
+        if (!CRYPTO_THREAD_read_lock(shard->lock))
             return NULL;
-        ret = lh_SSL_SESSION_retrieve(s->session_ctx->sessions, &data);
+        ret = lh_SSL_SESSION_retrieve(shard->sessions, &data);
         if (ret != NULL) {
             /* don't allow other threads to steal it: */
             SSL_SESSION_up_ref(ret);
         }
-        CRYPTO_THREAD_unlock(s->session_ctx->lock);
+        CRYPTO_THREAD_unlock(shard->lock);
         if (ret == NULL)
             ssl_tsan_counter(s->session_ctx, &s->session_ctx->stats.sess_miss);
     }
 
+    if (ret == NULL
+            && (ret = ossl_ssl_sess_shm_get(s->session_ctx, s->version,
+                                            sess_id, sess_id_len)) != NULL)
+        sess_found_externally(s, ret);
+
     if (ret == NULL && s->session_ctx->get_session_cb != NULL) {
         int copy = 1;
 
@@ -503,9 +640,6 @@ SSL_SESSION *lookup_sess_in_cache(SSL_CONNECTION *s,
                                              sess_id, sess_id_len, &copy);
 
         if (ret != NULL) {
-            ssl_tsan_counter(s->session_ctx,
-                             &s->session_ctx->stats.sess_cb_hit);
-
             /*
              * Increment reference count now if the session callback asks us
              * to do so (note that if the session structures returned by the
@@ -516,19 +650,7 @@ SSL_SESSION *lookup_sess_in_cache(SSL_CONNECTION *s,
             if (copy)
                 SSL_SESSION_up_ref(ret);
 
-            /*
-             * Add the externally cached session to the internal cache as
-             * well if and only if we are supposed to.
-             */
-            if ((s->session_ctx->session_cache_mode &
-                 SSL_SESS_CACHE_NO_INTERNAL_STORE) == 0) {
-                /*
-                 * Either return value of SSL_CTX_add_session should not
-                 * interrupt the session resumption process. The return
-                 * value is intentionally ignored.
-                 */
-                (void)SSL_CTX_add_session(s->session_ctx, ret);
-            }
+            sess_found_externally(s, ret);
         }
     }
 
@@ -691,6 +813,8 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 {
     int ret = 0;
     SSL_SESSION *s;
+    SSL_SESS_SHARD *shard = sess_shard(ctx, c);
+    size_t limit;
 
     /*
      * add just 1 reference count for the SSL_CTX's session cache even though
@@ -702,20 +826,20 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
      * if session c is in already in cache, we take back the increment later
      */
 
-    if (!CRYPTO_THREAD_write_lock(ctx->lock)) {
+    if (!CRYPTO_THREAD_write_lock(shard->lock)) {
         SSL_SESSION_free(c);
         return 0;
     }
-    s = lh_SSL_SESSION_insert(ctx->sessions, c);
+    s = lh_SSL_SESSION_insert(shard->sessions, c);
 
     /*
      * s != NULL iff we already had a session with the given PID. In this
      * case, s == c should hold (then we did not really modify
-     * ctx->sessions), or we're in trouble.
+     * shard->sessions), or we're in trouble.
      */
     if (s != NULL && s != c) {
         /* We *are* in trouble ... */
-        SSL_SESSION_list_remove(ctx, s);
+        SSL_SESSION_list_remove(shard, s);
         SSL_SESSION_free(s);
         /*
          * ... so pretend the other session did not exist in cache (we cannot
@@ -725,7 +849,7 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
          */
         s = NULL;
     } else if (s == NULL &&
-               lh_SSL_SESSION_retrieve(ctx->sessions, c) == NULL) {
+               lh_SSL_SESSION_retrieve(shard->sessions, c) == NULL) {
         /* s == NULL can also mean OOM error in lh_SSL_SESSION_insert ... */
 
         /*
@@ -749,9 +873,12 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 
         ret = 1;
 
-        if (SSL_CTX_sess_get_cache_size(ctx) > 0) {
-            while (SSL_CTX_sess_number(ctx) >= SSL_CTX_sess_get_cache_size(ctx)) {
-                if (!remove_session_lock(ctx, ctx->session_cache_tail, 0))
+        /* Each shard holds an equal part of the cache */
+        limit = (size_t)SSL_CTX_sess_get_cache_size(ctx);
+        if (limit > 0) {
+            limit = (limit + ctx->sess_num_shards - 1) / ctx->sess_num_shards;
+            while (lh_SSL_SESSION_num_items(shard->sessions) >= limit) {
+                if (!remove_session_lock(ctx, shard->tail, 0))
                     break;
                 else
                     ssl_tsan_counter(ctx, &ctx->stats.sess_cache_full);
@@ -759,7 +886,7 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
         }
     }
 
-    SSL_SESSION_list_add(ctx, c);
+    SSL_SESSION_list_add(ctx, shard, c);
 
     if (s != NULL) {
         /*
@@ -770,34 +897,38 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
         SSL_SESSION_free(s);    /* s == c */
         ret = 0;
     }
-    CRYPTO_THREAD_unlock(ctx->lock);
+    CRYPTO_THREAD_unlock(shard->lock);
     return ret;
 }
 
 int SSL_CTX_remove_session(SSL_CTX *ctx, SSL_SESSION *c)
 {
+    if (c != NULL)
+        ossl_ssl_sess_shm_remove(ctx, c);
     return remove_session_lock(ctx, c, 1);
 }
 
 static int remove_session_lock(SSL_CTX *ctx, SSL_SESSION *c, int lck)
 {
     SSL_SESSION *r;
+    SSL_SESS_SHARD *shard;
     int ret = 0;
 
     if ((c != NULL) && (c->session_id_length != 0)) {
+        shard = sess_shard(ctx, c);
         if (lck) {
-            if (!CRYPTO_THREAD_write_lock(ctx->lock))
+            if (!CRYPTO_THREAD_write_lock(shard->lock))
                 return 0;
         }
-        if ((r = lh_SSL_SESSION_retrieve(ctx->sessions, c)) != NULL) {
+        if ((r = lh_SSL_SESSION_retrieve(shard->sessions, c)) != NULL) {
             ret = 1;
-            r = lh_SSL_SESSION_delete(ctx->sessions, r);
-            SSL_SESSION_list_remove(ctx, r);
+            r = lh_SSL_SESSION_delete(shard->sessions, r);
+            SSL_SESSION_list_remove(shard, r);
         }
         c->not_resumable = 1;
 
         if (lck)
-            CRYPTO_THREAD_unlock(ctx->lock);
+            CRYPTO_THREAD_unlock(shard->lock);
 
         if (ctx->remove_session_cb != NULL)
             ctx->remove_session_cb(ctx, c);
@@ -897,12 +1028,15 @@ long SSL_SESSION_set_timeout(SSL_SESSION *s, long t)
     if (s == NULL || t < 0)
         return 0;
     if (s->owner != NULL) {
-        if (!CRYPTO_THREAD_write_lock(s->owner->lock))
+        SSL_CTX *owner = s->owner;
+        SSL_SESS_SHARD *shard = sess_shard(owner, s);
+
+        if (!CRYPTO_THREAD_write_lock(shard->lock))
             return 0;
         s->timeout = new_timeout;
         ssl_session_calculate_timeout(s);
-        SSL_SESSION_list_add(s->owner, s);
-        CRYPTO_THREAD_unlock(s->owner->lock);
+        SSL_SESSION_list_add(owner, shard, s);
+        CRYPTO_THREAD_unlock(shard->lock);
     } else {
         s->timeout = new_timeout;
         ssl_session_calculate_timeout(s);
@@ -931,12 +1065,15 @@ long SSL_SESSION_set_time(SSL_SESSION *s, long t)
     if (s == NULL)
         return 0;
     if (s->owner != NULL) {
-        if (!CRYPTO_THREAD_write_lock(s->owner->lock))
+        SSL_CTX *owner = s->owner;
+        SSL_SESS_SHARD *shard = sess_shard(owner, s);
+
+        if (!CRYPTO_THREAD_write_lock(shard->lock))
             return 0;
         s->time = new_time;
         ssl_session_calculate_timeout(s);
-        SSL_SESSION_list_add(s->owner, s);
-        CRYPTO_THREAD_unlock(s->owner->lock);
+        SSL_SESSION_list_add(owner, shard, s);
+        CRYPTO_THREAD_unlock(shard->lock);
     } else {
         s->time = new_time;
         ssl_session_calculate_timeout(s);
@@ -1149,55 +1286,98 @@ int SSL_set_session_ticket_ext(SSL *s, void *ext_data, int ext_len)
     return 0;
 }
 
-void SSL_CTX_flush_sessions(SSL_CTX *s, long t)
+/*
+ * Remove sessions that have timed out at |t| from |shard|, or all of them if
+ * |all| is set, but no more than |max| of them unless that is 0.  The list
+ * of sessions is ordered by expiry time, so only the sessions removed and
+ * one more are visited.
+ */
+static void sess_shard_flush(SSL_CTX *ctx, SSL_SESS_SHARD *shard,
+                             OSSL_TIME t, int all, size_t max)
 {
-    STACK_OF(SSL_SESSION) *sk;
+    STACK_OF(SSL_SESSION) *sk = NULL;
     SSL_SESSION *current;
     unsigned long i;
-    const OSSL_TIME timeout = ossl_time_from_time_t(t);
+    size_t n;
 
-    if (!CRYPTO_THREAD_write_lock(s->lock))
+    if (!CRYPTO_THREAD_write_lock(shard->lock))
         return;
 
-    sk = sk_SSL_SESSION_new_null();
-    i = lh_SSL_SESSION_get_down_load(s->sessions);
-    lh_SSL_SESSION_set_down_load(s->sessions, 0);
+    i = lh_SSL_SESSION_get_down_load(shard->sessions);
+    lh_SSL_SESSION_set_down_load(shard->sessions, 0);
 
     /*
      * Iterate over the list from the back (oldest), and stop
      * when a session can no longer be removed.
      * Add the session to a temporary list to be freed outside
-     * the SSL_CTX lock.
+     * the shard lock.
      * But still do the remove_session_cb() within the lock.
      */
-    while (s->session_cache_tail != NULL) {
-        current = s->session_cache_tail;
-        if (t == 0 || sess_timedout(timeout, current)) {
-            lh_SSL_SESSION_delete(s->sessions, current);
-            SSL_SESSION_list_remove(s, current);
-            current->not_resumable = 1;
-            if (s->remove_session_cb != NULL)
-                s->remove_session_cb(s, current);
-            /*
-             * Throw the session on a stack, it's entirely plausible
-             * that while freeing outside the critical section, the
-             * session could be re-added, so avoid using the next/prev
-             * pointers. If the stack failed to create, or the session
-             * couldn't be put on the stack, just free it here
-             */
-            if (sk == NULL || !sk_SSL_SESSION_push(sk, current))
-                SSL_SESSION_free(current);
-        } else {
+    for (n = 0; (max == 0 || n < max) && shard->tail != NULL; n++) {
+        current = shard->tail;
+        if (!all && !sess_timedout(t, current))
             break;
-        }
+        lh_SSL_SESSION_delete(shard->sessions, current);
+        SSL_SESSION_list_remove(shard, current);
+        current->not_resumable = 1;
+        if (ctx->remove_session_cb != NULL)
+            ctx->remove_session_cb(ctx, current);
+        /*
+         * Throw the session on a stack, it's entirely plausible
+         * that while freeing outside the critical section, the
+         * session could be re-added, so avoid using the next/prev
+         * pointers. If the stack failed to create, or the session
+         * couldn't be put on the stack, just free it here
+         */
+        if (sk == NULL)
+            sk = sk_SSL_SESSION_new_null();
+        if (sk == NULL || !sk_SSL_SESSION_push(sk, current))
+            SSL_SESSION_free(current);
     }
 
-    lh_SSL_SESSION_set_down_load(s->sessions, i);
-    CRYPTO_THREAD_unlock(s->lock);
+    lh_SSL_SESSION_set_down_load(shard->sessions, i);
+    CRYPTO_THREAD_unlock(shard->lock);
 
     sk_SSL_SESSION_pop_free(sk, SSL_SESSION_free);
 }
 
+void SSL_CTX_flush_sessions(SSL_CTX *s, long t)
+{
+    const OSSL_TIME timeout = ossl_time_from_time_t(t);
+    size_t i;
+
+    /* The shards are locked one at a time, never all together */
+    for (i = 0; i < s->sess_num_shards; i++)
+        sess_shard_flush(s, &s->sess_shards[i], timeout, t == 0, 0);
+}
+
+/*
+ * Remove a few expired sessions from one shard of the cache.  Called for
+ * every new connection with an increasing |n|, which keeps expiry in step
+ * with the rate sessions are added without ever flushing the whole cache.
+ * The shard's write lock is only taken when its oldest session has expired,
+ * so connections that find nothing to expire don't block each other.
+ */
+void ssl_sess_cache_expire(SSL_CTX *ctx, size_t n)
+{
+    SSL_SESS_SHARD *shard;
+    OSSL_TIME now;
+    int expired;
+
+    if (ctx->sess_num_shards == 0)
+        return;
+    shard = &ctx->sess_shards[n & (ctx->sess_num_shards - 1)];
+    now = ossl_time_now();
+
+    if (!CRYPTO_THREAD_read_lock(shard->lock))
+        return;
+    expired = shard->tail != NULL && sess_timedout(now, shard->tail);
+    CRYPTO_THREAD_unlock(shard->lock);
+
+    if (expired)
+        sess_shard_flush(ctx, shard, now, 0, SSL_SESS_EXPIRE_BATCH);
+}
+
 int ssl_clear_bad_session(SSL_CONNECTION *s)
 {
     if ((s->session != NULL) &&
@@ -1210,27 +1390,27 @@ int ssl_clear_bad_session(SSL_CONNECTION *s)
         return 0;
 }
 
-/* locked by SSL_CTX in the calling function */
-static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s)
+/* locked by the shard lock in the calling function */
+static void SSL_SESSION_list_remove(SSL_SESS_SHARD *shard, SSL_SESSION *s)
 {
     if ((s->next == NULL) || (s->prev == NULL))
         return;
 
-    if (s->next == (SSL_SESSION *)&(ctx->session_cache_tail)) {
+    if (s->next == (SSL_SESSION *)&(shard->tail)) {
         /* last element in list */
-        if (s->prev == (SSL_SESSION *)&(ctx->session_cache_head)) {
+        if (s->prev == (SSL_SESSION *)&(shard->head)) {
             /* only one element in list */
-            ctx->session_cache_head = NULL;
-            ctx->session_cache_tail = NULL;
+            shard->head = NULL;
+            shard->tail = NULL;
         } else {
-            ctx->session_cache_tail = s->prev;
-            s->prev->next = (SSL_SESSION *)&(ctx->session_cache_tail);
+            shard->tail = s->prev;
+            s->prev->next = (SSL_SESSION *)&(shard->tail);
         }
     } else {
-        if (s->prev == (SSL_SESSION *)&(ctx->session_cache_head)) {
+        if (s->prev == (SSL_SESSION *)&(shard->head)) {
             /* first element in list */
-            ctx->session_cache_head = s->next;
-            s->next->prev = (SSL_SESSION *)&(ctx->session_cache_head);
+            shard->head = s->next;
+            s->next->prev = (SSL_SESSION *)&(shard->head);
         } else {
             /* middle of list */
             s->next->prev = s->prev;
@@ -1241,41 +1421,42 @@ static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s)
     s->owner = NULL;
 }
 
-static void SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESSION *s)
+static void SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESS_SHARD *shard,
+                                 SSL_SESSION *s)
 {
     SSL_SESSION *next;
 
     if ((s->next != NULL) && (s->prev != NULL))
-        SSL_SESSION_list_remove(ctx, s);
+        SSL_SESSION_list_remove(shard, s);
 
-    if (ctx->session_cache_head == NULL) {
-        ctx->session_cache_head = s;
-        ctx->session_cache_tail = s;
-        s->prev = (SSL_SESSION *)&(ctx->session_cache_head);
-        s->next = (SSL_SESSION *)&(ctx->session_cache_tail);
+    if (shard->head == NULL) {
+        shard->head = s;
+        shard->tail = s;
+        s->prev = (SSL_SESSION *)&(shard->head);
+        s->next = (SSL_SESSION *)&(shard->tail);
     } else {
-        if (timeoutcmp(s, ctx->session_cache_head) >= 0) {
+        if (timeoutcmp(s, shard->head) >= 0) {
             /*
              * if we timeout after (or the same time as) the first
              * session, put us first - usual case
              */
-            s->next = ctx->session_cache_head;
+            s->next = shard->head;
             s->next->prev = s;
-            s->prev = (SSL_SESSION *)&(ctx->session_cache_head);
-            ctx->session_cache_head = s;
-        } else if (timeoutcmp(s, ctx->session_cache_tail) < 0) {
+            s->prev = (SSL_SESSION *)&(shard->head);
+            shard->head = s;
+        } else if (timeoutcmp(s, shard->tail) < 0) {
             /* if we timeout before the last session, put us last */
-            s->prev = ctx->session_cache_tail;
+            s->prev = shard->tail;
             s->prev->next = s;
-            s->next = (SSL_SESSION *)&(ctx->session_cache_tail);
-            ctx->session_cache_tail = s;
+            s->next = (SSL_SESSION *)&(shard->tail);
+            shard->tail = s;
         } else {
             /*
              * we timeout somewhere in-between - if there is only
              * one session in the cache it will be caught above
              */
-            next = ctx->session_cache_head->next;
-            while (next != (SSL_SESSION*)&(ctx->session_cache_tail)) {
+            next = shard->head->next;
+            while (next != (SSL_SESSION*)&(shard->tail)) {
                 if (timeoutcmp(s, next) >= 0) {
                     s->next = next;
                     s->prev = next->prev;
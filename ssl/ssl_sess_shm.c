@@ -0,0 +1,362 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/err.h>
+#include "internal/time.h"
+#include "ssl_local.h"
+
+/*
+ * A session cache in shared memory, so that processes forked from the one
+ * that set it up can resume each other's sessions.  Sessions are stored in
+ * serialised form in a fixed size table of buckets, each holding a few
+ * sessions and guarded by its own process shared mutex.  Nothing in the
+ * table is a pointer, so the mapping can be at a different address in each
+ * process.
+ *
+ * The mutexes are robust: if a process dies while holding one, the next
+ * process to take it empties the bucket, which may have been left half
+ * written, and carries on.
+ *
+ * When a bucket is full the session closest to expiry is replaced.
+ */
+
+#if defined(OPENSSL_THREADS) && defined(OPENSSL_SYS_UNIX) \
+    && !defined(OPENSSL_SYS_VMS) && !defined(__APPLE__)
+# include <unistd.h>
+# include <pthread.h>
+/*
+ * Process shared mutexes are optional in POSIX, robust ones are only part
+ * of the base standard since POSIX.1-2008
+ */
+# if defined(_POSIX_THREAD_PROCESS_SHARED) && _POSIX_THREAD_PROCESS_SHARED > 0 \
+    && (defined(PTHREAD_MUTEX_ROBUST) \
+        || (defined(_POSIX_THREADS) && _POSIX_THREADS >= 200809L))
+#  define SESS_SHM_SUPPORTED
+# endif
+#endif
+
+#ifdef SESS_SHM_SUPPORTED
+# include <sys/mman.h>
+# if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#  define MAP_ANONYMOUS MAP_ANON
+# endif
+# ifndef MAP_ANONYMOUS
+#  undef SESS_SHM_SUPPORTED
+# endif
+#endif
+
+#ifdef SESS_SHM_SUPPORTED
+
+# define SHM_BUCKET_SLOTS   4
+/* Sessions that don't serialise into this many bytes aren't stored */
+# define SHM_SLOT_DATA      1024
+# define SHM_MAX_SESSIONS   (1 << 24)
+
+typedef struct {
+    /* Expiry time of the session, 0 when the slot is unused */
+    uint64_t expires;
+    uint32_t der_len;
+    /* The protocol version and ID the session is looked up by */
+    uint32_t version;
+    uint32_t id_len;
+    unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+    unsigned char der[SHM_SLOT_DATA];
+} SHM_SLOT;
+
+typedef struct {
+    pthread_mutex_t lock;
+    SHM_SLOT slots[SHM_BUCKET_SLOTS];
+} SHM_BUCKET;
+
+struct ssl_sess_shm_st {
+    SHM_BUCKET *buckets;
+    size_t mask;
+    size_t map_len;
+};
+
+static void shm_clear(SHM_SLOT *slot);
+
+/*
+ * Returns 0 if the bucket can't be used any more, which only happens if a
+ * process died holding its lock and making it consistent again failed.
+ */
+static int shm_lock(SHM_BUCKET *b)
+{
+    size_t i;
+
+    switch (pthread_mutex_lock(&b->lock)) {
+    case 0:
+        return 1;
+    case EOWNERDEAD:
+        for (i = 0; i < SHM_BUCKET_SLOTS; i++)
+            shm_clear(&b->slots[i]);
+        if (pthread_mutex_consistent(&b->lock) == 0)
+            return 1;
+        pthread_mutex_unlock(&b->lock);
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+static void shm_unlock(SHM_BUCKET *b)
+{
+    pthread_mutex_unlock(&b->lock);
+}
+
+/* FNV-1a, which gives the same bucket in every process */
+static SHM_BUCKET *shm_bucket(const SSL_SESS_SHM *shm,
+                              const unsigned char *id, size_t id_len)
+{
+    uint32_t h = 0x811c9dc5;
+    size_t i;
+
+    for (i = 0; i < id_len; i++)
+        h = (h ^ id[i]) * 0x01000193;
+    return &shm->buckets[h & shm->mask];
+}
+
+/* Sessions match on version and ID, like in the internal cache */
+static SHM_SLOT *shm_find(SHM_BUCKET *b, int version, const unsigned char *id,
+                          size_t id_len)
+{
+    size_t i;
+
+    for (i = 0; i < SHM_BUCKET_SLOTS; i++)
+        if (b->slots[i].expires != 0
+                && b->slots[i].version == (uint32_t)version
+                && b->slots[i].id_len == id_len
+                && memcmp(b->slots[i].id, id, id_len) == 0)
+            return &b->slots[i];
+    return NULL;
+}
+
+static void shm_clear(SHM_SLOT *slot)
+{
+    /* A process that died while writing may have left any length here */
+    if (slot->der_len > SHM_SLOT_DATA)
+        slot->der_len = SHM_SLOT_DATA;
+    OPENSSL_cleanse(slot->der, slot->der_len);
+    slot->expires = 0;
+    slot->der_len = 0;
+}
+
+static void sess_shm_free(SSL_SESS_SHM *shm)
+{
+    if (shm == NULL)
+        return;
+    if (shm->buckets != NULL)
+        munmap((void *)shm->buckets, shm->map_len);
+    OPENSSL_free(shm);
+}
+
+int SSL_CTX_set_session_cache_shm(SSL_CTX *ctx, size_t num_sessions)
+{
+    SSL_SESS_SHM *shm = NULL;
+    pthread_mutexattr_t attr;
+    size_t i, n = 1;
+    void *map;
+    int err;
+
+    if (num_sessions > SHM_MAX_SESSIONS) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+    if (num_sessions > 0) {
+        while (n * SHM_BUCKET_SLOTS < num_sessions)
+            n <<= 1;
+        if ((shm = OPENSSL_zalloc(sizeof(*shm))) == NULL)
+            return 0;
+        shm->mask = n - 1;
+        shm->map_len = n * sizeof(SHM_BUCKET);
+        map = mmap(NULL, shm->map_len, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) {
+            ERR_raise_data(ERR_LIB_SYS, errno, "calling mmap()");
+            OPENSSL_free(shm);
+            return 0;
+        }
+        /* Anonymous mappings start out zeroed, so all the slots are unused */
+        shm->buckets = map;
+
+        if ((err = pthread_mutexattr_init(&attr)) == 0) {
+            err = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+            if (err == 0)
+                err = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+            for (i = 0; err == 0 && i < n; i++)
+                err = pthread_mutex_init(&shm->buckets[i].lock, &attr);
+            pthread_mutexattr_destroy(&attr);
+        }
+        if (err != 0) {
+            ERR_raise_data(ERR_LIB_SYS, err, "initialising bucket locks");
+            sess_shm_free(shm);
+            return 0;
+        }
+    }
+
+    sess_shm_free(ctx->sess_shm);
+    ctx->sess_shm = shm;
+    return 1;
+}
+
+void ossl_ssl_sess_shm_free(SSL_CTX *ctx)
+{
+    sess_shm_free(ctx->sess_shm);
+    ctx->sess_shm = NULL;
+}
+
+int ossl_ssl_sess_shm_add(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+    SSL_SESS_SHM *shm = ctx->sess_shm;
+    unsigned char der[SHM_SLOT_DATA], *p = der;
+    SHM_BUCKET *b;
+    SHM_SLOT *slot;
+    uint64_t expires;
+    size_t i;
+    int len;
+
+    if (shm == NULL || sess->session_id_length == 0)
+        return 0;
+    len = i2d_SSL_SESSION(sess, NULL);
+    if (len <= 0 || len > SHM_SLOT_DATA || i2d_SSL_SESSION(sess, &p) != len)
+        return 0;
+    expires = ossl_time2ticks(sess->calc_timeout);
+    if (expires == 0)
+        expires = 1;
+
+    b = shm_bucket(shm, sess->session_id, sess->session_id_length);
+    if (!shm_lock(b)) {
+        OPENSSL_cleanse(der, len);
+        return 0;
+    }
+    if ((slot = shm_find(b, sess->ssl_version, sess->session_id,
+                         sess->session_id_length)) == NULL) {
+        /* Use a free slot, or else the one that expires first */
+        slot = &b->slots[0];
+        for (i = 1; i < SHM_BUCKET_SLOTS && slot->expires != 0; i++)
+            if (b->slots[i].expires < slot->expires)
+                slot = &b->slots[i];
+    }
+    shm_clear(slot);
+    slot->version = (uint32_t)sess->ssl_version;
+    memcpy(slot->id, sess->session_id, sess->session_id_length);
+    slot->id_len = (uint32_t)sess->session_id_length;
+    memcpy(slot->der, der, len);
+    slot->der_len = (uint32_t)len;
+    slot->expires = expires;
+    shm_unlock(b);
+
+    OPENSSL_cleanse(der, len);
+    return 1;
+}
+
+SSL_SESSION *ossl_ssl_sess_shm_get(SSL_CTX *ctx, int version,
+                                   const unsigned char *id, size_t id_len)
+{
+    SSL_SESS_SHM *shm = ctx->sess_shm;
+    unsigned char der[SHM_SLOT_DATA];
+    const unsigned char *p = der;
+    SSL_SESSION *ret = NULL;
+    SHM_BUCKET *b;
+    SHM_SLOT *slot;
+    size_t len = 0;
+
+    if (shm == NULL || id_len == 0)
+        return NULL;
+
+    b = shm_bucket(shm, id, id_len);
+    if (!shm_lock(b))
+        return NULL;
+    if ((slot = shm_find(b, version, id, id_len)) != NULL) {
+        if (slot->expires < ossl_time2ticks(ossl_time_now())) {
+            shm_clear(slot);
+        } else {
+            len = slot->der_len;
+            memcpy(der, slot->der, len);
+        }
+    }
+    shm_unlock(b);
+
+    if (len > 0) {
+        ret = d2i_SSL_SESSION_ex(NULL, &p, (long)len, ctx->libctx,
+                                 ctx->propq);
+        OPENSSL_cleanse(der, len);
+    }
+    return ret;
+}
+
+void ossl_ssl_sess_shm_remove(SSL_CTX *ctx, const SSL_SESSION *sess)
+{
+    SSL_SESS_SHM *shm = ctx->sess_shm;
+    SHM_BUCKET *b;
+    SHM_SLOT *slot;
+
+    if (shm == NULL || sess->session_id_length == 0)
+        return;
+
+    b = shm_bucket(shm, sess->session_id, sess->session_id_length);
+    if (!shm_lock(b))
+        return;
+    if ((slot = shm_find(b, sess->ssl_version, sess->session_id,
+                         sess->session_id_length)) != NULL)
+        shm_clear(slot);
+    shm_unlock(b);
+}
+
+# ifndef OPENSSL_NO_UNIT_TEST
+int ossl_ssl_sess_shm_lock_id(SSL_CTX *ctx, const unsigned char *id,
+                              size_t id_len)
+{
+    if (ctx->sess_shm == NULL)
+        return 0;
+    return shm_lock(shm_bucket(ctx->sess_shm, id, id_len));
+}
+# endif
+
+#else
+
+int SSL_CTX_set_session_cache_shm(SSL_CTX *ctx, size_t num_sessions)
+{
+    if (num_sessions == 0)
+        return 1;
+    ERR_raise(ERR_LIB_SSL, ERR_R_UNSUPPORTED);
+    return 0;
+}
+
+void ossl_ssl_sess_shm_free(SSL_CTX *ctx)
+{
+}
+
+int ossl_ssl_sess_shm_add(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+    return 0;
+}
+
+SSL_SESSION *ossl_ssl_sess_shm_get(SSL_CTX *ctx, int version,
+                                   const unsigned char *id, size_t id_len)
+{
+    return NULL;
+}
+
+void ossl_ssl_sess_shm_remove(SSL_CTX *ctx, const SSL_SESSION *sess)
+{
+}
+
+# ifndef OPENSSL_NO_UNIT_TEST
+int ossl_ssl_sess_shm_lock_id(SSL_CTX *ctx, const unsigned char *id,
+                              size_t id_len)
+{
+    return 0;
+}
+# endif
+
+#endif
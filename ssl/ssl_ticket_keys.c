@@ -0,0 +1,230 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include "internal/time.h"
+#include "ssl_local.h"
+
+/*
+ * A ring of session ticket keys for sealing tickets with an AEAD.  The
+ * newest key seals new tickets and is replaced once it is older than the
+ * rotation interval.  Older keys are kept to open tickets sealed earlier
+ * until they drop off the end of the ring.
+ *
+ * Each key keeps a cipher context for sealing and one for opening, both
+ * with the key already set, so that a ticket only needs to set its nonce.
+ * The contexts are shared, so a ticket is sealed or opened with the ring
+ * lock held for writing, see ossl_ssl_ticket_key_release().
+ */
+
+#define TICKET_KEY_LEN      32
+#define TICKET_MAX_KEYS     16
+
+typedef struct {
+    unsigned char name[TLSEXT_KEYNAME_LENGTH];
+    unsigned char secret[TICKET_KEY_LEN];
+    OSSL_TIME created;
+    EVP_CIPHER_CTX *enc, *dec;
+} SSL_TICKET_KEY;
+
+struct ssl_ticket_key_ring_st {
+    CRYPTO_RWLOCK *lock;
+    EVP_CIPHER *cipher;
+    OSSL_TIME rotation;
+    /* The newest key comes first */
+    SSL_TICKET_KEY keys[TICKET_MAX_KEYS];
+    size_t num_keys;
+    size_t max_keys;
+};
+
+static void ticket_key_clear(SSL_TICKET_KEY *key)
+{
+    EVP_CIPHER_CTX_free(key->enc);
+    EVP_CIPHER_CTX_free(key->dec);
+    OPENSSL_cleanse(key, sizeof(*key));
+}
+
+/* A cipher context set up with |key| for sealing or for opening */
+static EVP_CIPHER_CTX *ticket_key_ctx(const SSL_TICKET_KEY_RING *ring,
+                                      const SSL_TICKET_KEY *key, int enc)
+{
+    EVP_CIPHER_CTX *ret;
+
+    if ((ret = EVP_CIPHER_CTX_new()) == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_EVP_LIB);
+        return NULL;
+    }
+    if (!EVP_CipherInit_ex(ret, ring->cipher, NULL, key->secret, NULL, enc)) {
+        EVP_CIPHER_CTX_free(ret);
+        return NULL;
+    }
+    return ret;
+}
+
+static int ticket_key_init(SSL_CTX *ctx, const SSL_TICKET_KEY_RING *ring,
+                           SSL_TICKET_KEY *key)
+{
+    if (RAND_bytes_ex(ctx->libctx, key->name, sizeof(key->name), 0) <= 0
+            || RAND_priv_bytes_ex(ctx->libctx, key->secret,
+                                  sizeof(key->secret), 0) <= 0
+            || (key->enc = ticket_key_ctx(ring, key, 1)) == NULL
+            || (key->dec = ticket_key_ctx(ring, key, 0)) == NULL) {
+        ticket_key_clear(key);
+        return 0;
+    }
+    key->created = ossl_time_now();
+    return 1;
+}
+
+static void ticket_key_ring_free(SSL_TICKET_KEY_RING *ring)
+{
+    size_t i;
+
+    if (ring == NULL)
+        return;
+    for (i = 0; i < ring->num_keys; i++)
+        ticket_key_clear(&ring->keys[i]);
+    EVP_CIPHER_free(ring->cipher);
+    CRYPTO_THREAD_lock_free(ring->lock);
+    OPENSSL_free(ring);
+}
+
+int SSL_CTX_set_ticket_key_ring(SSL_CTX *ctx, const char *cipher,
+                                uint64_t rotation, size_t num_keys)
+{
+    SSL_TICKET_KEY_RING *ring = NULL;
+
+    if (num_keys > TICKET_MAX_KEYS) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+    if (num_keys > 0) {
+        if (cipher == NULL)
+            cipher = "AES-256-GCM";
+        if ((ring = OPENSSL_zalloc(sizeof(*ring))) == NULL)
+            return 0;
+        if ((ring->lock = CRYPTO_THREAD_lock_new()) == NULL) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_CRYPTO_LIB);
+            goto err;
+        }
+        ring->cipher = EVP_CIPHER_fetch(ctx->libctx, cipher, ctx->propq);
+        if (ring->cipher == NULL)
+            goto err;
+        if ((EVP_CIPHER_get_flags(ring->cipher) & EVP_CIPH_FLAG_AEAD_CIPHER) == 0
+                || EVP_CIPHER_get_key_length(ring->cipher) != TICKET_KEY_LEN
+                || EVP_CIPHER_get_iv_length(ring->cipher) != SSL_TICKET_NONCE_LEN) {
+            ERR_raise(ERR_LIB_SSL, SSL_R_BAD_CIPHER);
+            goto err;
+        }
+        ring->rotation = ossl_seconds2time(rotation);
+        ring->max_keys = num_keys;
+        if (!ticket_key_init(ctx, ring, &ring->keys[0]))
+            goto err;
+        ring->num_keys = 1;
+    }
+
+    ticket_key_ring_free(ctx->ext.ticket_keys);
+    ctx->ext.ticket_keys = ring;
+    return 1;
+ err:
+    ticket_key_ring_free(ring);
+    return 0;
+}
+
+void ossl_ssl_ticket_key_ring_free(SSL_CTX *ctx)
+{
+    ticket_key_ring_free(ctx->ext.ticket_keys);
+    ctx->ext.ticket_keys = NULL;
+}
+
+/*
+ * The key ring is used unless the application supplies the ticket keys
+ * through a callback.
+ */
+int ossl_ssl_ticket_key_ring_in_use(const SSL_CTX *ctx)
+{
+    if (ctx->ext.ticket_keys == NULL || ctx->ext.ticket_key_evp_cb != NULL)
+        return 0;
+#ifndef OPENSSL_NO_DEPRECATED_3_0
+    if (ctx->ext.ticket_key_cb != NULL)
+        return 0;
+#endif
+    return 1;
+}
+
+static int ticket_key_due(const SSL_TICKET_KEY_RING *ring, OSSL_TIME now)
+{
+    return !ossl_time_is_zero(ring->rotation)
+           && ossl_time_compare(ossl_time_subtract(now, ring->keys[0].created),
+                                ring->rotation) >= 0;
+}
+
+/* Put a new key at the front of the ring, dropping the oldest if full */
+static void ticket_key_rotate(SSL_CTX *ctx, SSL_TICKET_KEY_RING *ring)
+{
+    SSL_TICKET_KEY key;
+
+    memset(&key, 0, sizeof(key));
+    if (!ticket_key_init(ctx, ring, &key))
+        return;     /* Keep using the current key */
+    if (ring->num_keys == ring->max_keys)
+        ticket_key_clear(&ring->keys[--ring->num_keys]);
+    memmove(&ring->keys[1], &ring->keys[0],
+            ring->num_keys * sizeof(ring->keys[0]));
+    ring->keys[0] = key;
+    ring->num_keys++;
+    /* The ring owns the cipher contexts now */
+    OPENSSL_cleanse(&key, sizeof(key));
+}
+
+/*
+ * Returns the sealing context of the current key with the ring locked.  The
+ * caller sets the nonce and must call ossl_ssl_ticket_key_release() when
+ * done with the context.
+ */
+EVP_CIPHER_CTX *ossl_ssl_ticket_key_get_enc(SSL_CTX *ctx, unsigned char *name)
+{
+    SSL_TICKET_KEY_RING *ring = ctx->ext.ticket_keys;
+
+    if (!CRYPTO_THREAD_write_lock(ring->lock))
+        return NULL;
+    if (ticket_key_due(ring, ossl_time_now()))
+        ticket_key_rotate(ctx, ring);
+    memcpy(name, ring->keys[0].name, TLSEXT_KEYNAME_LENGTH);
+    return ring->keys[0].enc;
+}
+
+/* Likewise for the opening context of the key called |name|, if still known */
+EVP_CIPHER_CTX *ossl_ssl_ticket_key_get_dec(SSL_CTX *ctx,
+                                            const unsigned char *name,
+                                            int *renew)
+{
+    SSL_TICKET_KEY_RING *ring = ctx->ext.ticket_keys;
+    size_t i;
+
+    if (!CRYPTO_THREAD_write_lock(ring->lock))
+        return NULL;
+    for (i = 0; i < ring->num_keys; i++) {
+        if (memcmp(name, ring->keys[i].name, TLSEXT_KEYNAME_LENGTH) != 0)
+            continue;
+        /* Replace tickets sealed with an older key */
+        *renew = i > 0 || ticket_key_due(ring, ossl_time_now());
+        return ring->keys[i].dec;
+    }
+    CRYPTO_THREAD_unlock(ring->lock);
+    return NULL;
+}
+
+void ossl_ssl_ticket_key_release(SSL_CTX *ctx)
+{
+    CRYPTO_THREAD_unlock(ctx->ext.ticket_keys->lock);
+}
@@ -623,7 +623,8 @@ int tls_collect_extensions(SSL_CONNECTION *s, PACKET *packet,
         custom_ext_init(&s->cert->custext);
 
     num_exts = OSSL_NELEM(ext_defs) + (exts != NULL ? exts->meths_count : 0);
-    raw_extensions = OPENSSL_zalloc(num_exts * sizeof(*raw_extensions));
+    raw_extensions = ossl_ssl_hs_zalloc(s,
+                                        num_exts * sizeof(*raw_extensions));
     if (raw_extensions == NULL) {
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_CRYPTO_LIB);
         return 0;
@@ -720,7 +721,7 @@ int tls_collect_extensions(SSL_CONNECTION *s, PACKET *packet,
     return 1;
 
  err:
-    OPENSSL_free(raw_extensions);
+    ossl_ssl_hs_free(s, raw_extensions);
     return 0;
 }
 
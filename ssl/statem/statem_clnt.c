@@ -1790,10 +1790,10 @@ MSG_PROCESS_RETURN tls_process_server_hello(SSL_CONNECTION *s, PACKET *pkt)
         goto err;
     }
 
-    OPENSSL_free(extensions);
+    ossl_ssl_hs_free(s, extensions);
     return MSG_PROCESS_CONTINUE_READING;
  err:
-    OPENSSL_free(extensions);
+    ossl_ssl_hs_free(s, extensions);
     return MSG_PROCESS_ERROR;
 }
 
@@ -1827,7 +1827,7 @@ static MSG_PROCESS_RETURN tls_process_as_hello_retry_request(SSL_CONNECTION *s,
         goto err;
     }
 
-    OPENSSL_free(extensions);
+    ossl_ssl_hs_free(s, extensions);
     extensions = NULL;
 
     if (s->ext.tls13_cookie_len == 0 && s->s3.tmp.pkey != NULL) {
@@ -1862,7 +1862,7 @@ static MSG_PROCESS_RETURN tls_process_as_hello_retry_request(SSL_CONNECTION *s,
 
     return MSG_PROCESS_FINISHED_READING;
  err:
-    OPENSSL_free(extensions);
+    ossl_ssl_hs_free(s, extensions);
     return MSG_PROCESS_ERROR;
 }
 
@@ -2011,11 +2011,11 @@ MSG_PROCESS_RETURN tls_process_server_certificate(SSL_CONNECTION *s,
                 || !tls_parse_all_extensions(s, SSL_EXT_TLS1_3_CERTIFICATE,
                                              rawexts, x, chainidx,
                                              PACKET_remaining(pkt) == 0)) {
-                OPENSSL_free(rawexts);
+                ossl_ssl_hs_free(s, rawexts);
                 /* SSLfatal already called */
                 goto err;
             }
-            OPENSSL_free(rawexts);
+            ossl_ssl_hs_free(s, rawexts);
         }
 
         if (!sk_X509_push(s->session->peer_chain, x)) {
@@ -2507,7 +2507,7 @@ MSG_PROCESS_RETURN tls_process_key_exchange(SSL_CONNECTION *s, PACKET *pkt)
 
         rv = EVP_DigestVerify(md_ctx, PACKET_data(&signature),
                               PACKET_remaining(&signature), tbs, tbslen);
-        OPENSSL_free(tbs);
+        ossl_ssl_hs_free(s, tbs);
         if (rv <= 0) {
             SSLfatal(s, SSL_AD_DECRYPT_ERROR, SSL_R_BAD_SIGNATURE);
             goto err;
@@ -2588,10 +2588,10 @@ MSG_PROCESS_RETURN tls_process_certificate_request(SSL_CONNECTION *s,
             || !tls_parse_all_extensions(s, SSL_EXT_TLS1_3_CERTIFICATE_REQUEST,
                                          rawexts, NULL, 0, 1)) {
             /* SSLfatal() already called */
-            OPENSSL_free(rawexts);
+            ossl_ssl_hs_free(s, rawexts);
             return MSG_PROCESS_ERROR;
         }
-        OPENSSL_free(rawexts);
+        ossl_ssl_hs_free(s, rawexts);
         if (!tls1_process_sigalgs(s)) {
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, SSL_R_BAD_LENGTH);
             return MSG_PROCESS_ERROR;
@@ -2829,7 +2829,7 @@ MSG_PROCESS_RETURN tls_process_new_session_ticket(SSL_CONNECTION *s,
         }
         s->session->master_key_length = hashlen;
 
-        OPENSSL_free(exts);
+        ossl_ssl_hs_free(s, exts);
         ssl_update_cache(s, SSL_SESS_CACHE_CLIENT);
         return MSG_PROCESS_FINISHED_READING;
     }
@@ -2837,7 +2837,7 @@ MSG_PROCESS_RETURN tls_process_new_session_ticket(SSL_CONNECTION *s,
     return MSG_PROCESS_CONTINUE_READING;
  err:
     EVP_MD_free(sha256);
-    OPENSSL_free(exts);
+    ossl_ssl_hs_free(s, exts);
     return MSG_PROCESS_ERROR;
 }
 
@@ -4002,11 +4002,11 @@ static MSG_PROCESS_RETURN tls_process_encrypted_extensions(SSL_CONNECTION *s,
         goto err;
     }
 
-    OPENSSL_free(rawexts);
+    ossl_ssl_hs_free(s, rawexts);
     return MSG_PROCESS_CONTINUE_READING;
 
  err:
-    OPENSSL_free(rawexts);
+    ossl_ssl_hs_free(s, rawexts);
     return MSG_PROCESS_ERROR;
 }
 
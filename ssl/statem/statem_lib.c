@@ -384,7 +384,7 @@ CON_FUNC_RETURN tls_construct_cert_verify(SSL_CONNECTION *s, WPACKET *pkt)
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_EVP_LIB);
             goto err;
         }
-        sig = OPENSSL_malloc(siglen);
+        sig = ossl_ssl_hs_malloc(s, siglen);
         if (sig == NULL
                 || EVP_DigestSignFinal(mctx, sig, &siglen) <= 0) {
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_EVP_LIB);
@@ -399,7 +399,7 @@ CON_FUNC_RETURN tls_construct_cert_verify(SSL_CONNECTION *s, WPACKET *pkt)
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_EVP_LIB);
             goto err;
         }
-        sig = OPENSSL_malloc(siglen);
+        sig = ossl_ssl_hs_malloc(s, siglen);
         if (sig == NULL
                 || EVP_DigestSign(mctx, sig, &siglen, hdata, hdatalen) <= 0) {
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_EVP_LIB);
@@ -429,11 +429,11 @@ CON_FUNC_RETURN tls_construct_cert_verify(SSL_CONNECTION *s, WPACKET *pkt)
         goto err;
     }
 
-    OPENSSL_free(sig);
+    ossl_ssl_hs_free(s, sig);
     EVP_MD_CTX_free(mctx);
     return CON_FUNC_SUCCESS;
  err:
-    OPENSSL_free(sig);
+    ossl_ssl_hs_free(s, sig);
     EVP_MD_CTX_free(mctx);
     return CON_FUNC_ERROR;
 }
@@ -1293,7 +1293,7 @@ int tls_process_rpk(SSL_CONNECTION *sc, PACKET *pkt, EVP_PKEY **peer_rpk)
     }
 
  err:
-    OPENSSL_free(rawexts);
+    ossl_ssl_hs_free(sc, rawexts);
     EVP_PKEY_free(pkey);
     return ret;
 }
@@ -1437,6 +1437,9 @@ WORK_STATE tls_finish_handshake(SSL_CONNECTION *s, ossl_unused WORK_STATE wst,
         s->init_num = 0;
     }
 
+    /* Nothing allocated for this handshake is needed any more */
+    ossl_ssl_hs_arena_reset(s);
+
     if (SSL_CONNECTION_IS_TLS13(s) && !s->server
             && s->post_handshake_auth == SSL_PHA_REQUESTED)
         s->post_handshake_auth = SSL_PHA_EXT_SENT;
@@ -2759,7 +2762,7 @@ size_t construct_key_exchange_tbs(SSL_CONNECTION *s, unsigned char **ptbs,
                                   const void *param, size_t paramlen)
 {
     size_t tbslen = 2 * SSL3_RANDOM_SIZE + paramlen;
-    unsigned char *tbs = OPENSSL_malloc(tbslen);
+    unsigned char *tbs = ossl_ssl_hs_malloc(s, tbslen);
 
     if (tbs == NULL) {
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_CRYPTO_LIB);
@@ -1492,7 +1492,7 @@ MSG_PROCESS_RETURN tls_process_client_hello(SSL_CONNECTION *s, PACKET *pkt)
         s->new_session = 1;
     }
 
-    clienthello = OPENSSL_zalloc(sizeof(*clienthello));
+    clienthello = ossl_ssl_hs_zalloc(s, sizeof(*clienthello));
     if (clienthello == NULL) {
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
         goto err;
@@ -1625,7 +1625,7 @@ MSG_PROCESS_RETURN tls_process_client_hello(SSL_CONNECTION *s, PACKET *pkt)
              */
             if (SSL_get_options(SSL_CONNECTION_GET_SSL(s)) & SSL_OP_COOKIE_EXCHANGE) {
                 if (clienthello->dtls_cookie_len == 0) {
-                    OPENSSL_free(clienthello);
+                    ossl_ssl_hs_free(s, clienthello);
                     return MSG_PROCESS_FINISHED_READING;
                 }
             }
@@ -1674,8 +1674,8 @@ MSG_PROCESS_RETURN tls_process_client_hello(SSL_CONNECTION *s, PACKET *pkt)
 
  err:
     if (clienthello != NULL)
-        OPENSSL_free(clienthello->pre_proc_exts);
-    OPENSSL_free(clienthello);
+        ossl_ssl_hs_free(s, clienthello->pre_proc_exts);
+    ossl_ssl_hs_free(s, clienthello);
 
     return MSG_PROCESS_ERROR;
 }
@@ -2138,15 +2138,15 @@ static int tls_early_post_process_client_hello(SSL_CONNECTION *s)
 
     sk_SSL_CIPHER_free(ciphers);
     sk_SSL_CIPHER_free(scsvs);
-    OPENSSL_free(clienthello->pre_proc_exts);
-    OPENSSL_free(s->clienthello);
+    ossl_ssl_hs_free(s, clienthello->pre_proc_exts);
+    ossl_ssl_hs_free(s, s->clienthello);
     s->clienthello = NULL;
     return 1;
  err:
     sk_SSL_CIPHER_free(ciphers);
     sk_SSL_CIPHER_free(scsvs);
-    OPENSSL_free(clienthello->pre_proc_exts);
-    OPENSSL_free(s->clienthello);
+    ossl_ssl_hs_free(s, clienthello->pre_proc_exts);
+    ossl_ssl_hs_free(s, s->clienthello);
     s->clienthello = NULL;
 
     return 0;
@@ -2816,11 +2816,11 @@ CON_FUNC_RETURN tls_construct_server_key_exchange(SSL_CONNECTION *s,
                 || EVP_DigestSign(md_ctx, sigbytes1, &siglen, tbs, tbslen) <= 0
                 || !WPACKET_sub_allocate_bytes_u16(pkt, siglen, &sigbytes2)
                 || sigbytes1 != sigbytes2) {
-            OPENSSL_free(tbs);
+            ossl_ssl_hs_free(s, tbs);
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
             goto err;
         }
-        OPENSSL_free(tbs);
+        ossl_ssl_hs_free(s, tbs);
     }
 
     ret = CON_FUNC_SUCCESS;
@@ -2998,7 +2998,7 @@ static int tls_process_cke_rsa(SSL_CONNECTION *s, PACKET *pkt)
     }
 
     outlen = SSL_MAX_MASTER_KEY_LENGTH;
-    rsa_decrypt = OPENSSL_malloc(outlen);
+    rsa_decrypt = ossl_ssl_hs_malloc(s, outlen);
     if (rsa_decrypt == NULL) {
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_CRYPTO_LIB);
         return 0;
@@ -3061,7 +3061,7 @@ static int tls_process_cke_rsa(SSL_CONNECTION *s, PACKET *pkt)
 
     ret = 1;
  err:
-    OPENSSL_free(rsa_decrypt);
+    ossl_ssl_hs_free(s, rsa_decrypt);
     EVP_PKEY_CTX_free(ctx);
     return ret;
 }
@@ -3699,10 +3699,10 @@ MSG_PROCESS_RETURN tls_process_client_certificate(SSL_CONNECTION *s,
                 || !tls_parse_all_extensions(s, SSL_EXT_TLS1_3_CERTIFICATE,
                                              rawexts, x, chainidx,
                                              PACKET_remaining(&spkt) == 0)) {
-                OPENSSL_free(rawexts);
+                ossl_ssl_hs_free(s, rawexts);
                 goto err;
             }
-            OPENSSL_free(rawexts);
+            ossl_ssl_hs_free(s, rawexts);
         }
 
         if (!sk_X509_push(sk, x)) {
@@ -3933,6 +3933,42 @@ static int create_ticket_prequel(SSL_CONNECTION *s, WPACKET *pkt,
     return 1;
 }
 
+/*
+ * Seal the session in |senc| with the current key of the ticket key ring.
+ * The ticket is made up of the key name, the nonce, the ciphertext and the
+ * tag, with the key name authenticated as additional data.
+ */
+static int seal_ticket(SSL_CTX *tctx, WPACKET *pkt, const unsigned char *senc,
+                       int slen)
+{
+    EVP_CIPHER_CTX *ctx;
+    unsigned char key_name[TLSEXT_KEYNAME_LENGTH];
+    unsigned char nonce[SSL_TICKET_NONCE_LEN];
+    unsigned char *out, *tag;
+    int len, lenfinal, ret = 0;
+
+    if (RAND_bytes_ex(tctx->libctx, nonce, sizeof(nonce), 0) <= 0
+            || (ctx = ossl_ssl_ticket_key_get_enc(tctx, key_name)) == NULL)
+        return 0;
+
+    if (EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, nonce)
+            && EVP_EncryptUpdate(ctx, NULL, &len, key_name, sizeof(key_name))
+            && WPACKET_memcpy(pkt, key_name, sizeof(key_name))
+            && WPACKET_memcpy(pkt, nonce, sizeof(nonce))
+            && WPACKET_allocate_bytes(pkt, slen, &out)
+            && EVP_EncryptUpdate(ctx, out, &len, senc, slen)
+            && len == slen
+            && EVP_EncryptFinal_ex(ctx, out + len, &lenfinal)
+            && lenfinal == 0
+            && WPACKET_allocate_bytes(pkt, SSL_TICKET_TAG_LEN, &tag)
+            && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG,
+                                   SSL_TICKET_TAG_LEN, tag) > 0)
+        ret = 1;
+
+    ossl_ssl_ticket_key_release(tctx);
+    return ret;
+}
+
 static CON_FUNC_RETURN construct_stateless_ticket(SSL_CONNECTION *s,
                                                   WPACKET *pkt,
                                                   uint32_t age_add,
@@ -3965,23 +4001,12 @@ static CON_FUNC_RETURN construct_stateless_ticket(SSL_CONNECTION *s,
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
         goto err;
     }
-    senc = OPENSSL_malloc(slen_full);
+    senc = ossl_ssl_hs_malloc(s, slen_full);
     if (senc == NULL) {
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_CRYPTO_LIB);
         goto err;
     }
 
-    ctx = EVP_CIPHER_CTX_new();
-    if (ctx == NULL) {
-        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_EVP_LIB);
-        goto err;
-    }
-    hctx = ssl_hmac_new(tctx);
-    if (hctx == NULL) {
-        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_SSL_LIB);
-        goto err;
-    }
-
     p = senc;
     if (!i2d_SSL_SESSION(s->session, &p)) {
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
@@ -4014,6 +4039,31 @@ static CON_FUNC_RETURN construct_stateless_ticket(SSL_CONNECTION *s,
     }
     SSL_SESSION_free(sess);
 
+    if (ossl_ssl_ticket_key_ring_in_use(tctx)) {
+        if (!create_ticket_prequel(s, pkt, age_add, tick_nonce)) {
+            /* SSLfatal() already called */
+            goto err;
+        }
+        if (!seal_ticket(tctx, pkt, senc, slen)
+                || !WPACKET_close(pkt)) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            goto err;
+        }
+        ok = CON_FUNC_SUCCESS;
+        goto err;
+    }
+
+    ctx = EVP_CIPHER_CTX_new();
+    if (ctx == NULL) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_EVP_LIB);
+        goto err;
+    }
+    hctx = ssl_hmac_new(tctx);
+    if (hctx == NULL) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_SSL_LIB);
+        goto err;
+    }
+
     /*
      * Initialize HMAC and cipher contexts. If callback present it does
      * all the work otherwise use generated values from parent ctx.
@@ -4053,7 +4103,7 @@ static CON_FUNC_RETURN construct_stateless_ticket(SSL_CONNECTION *s,
                 SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
                 goto err;
             }
-            OPENSSL_free(senc);
+            ossl_ssl_hs_free(s, senc);
             EVP_CIPHER_CTX_free(ctx);
             ssl_hmac_free(hctx);
             return CON_FUNC_SUCCESS;
@@ -4135,7 +4185,7 @@ static CON_FUNC_RETURN construct_stateless_ticket(SSL_CONNECTION *s,
 
     ok = CON_FUNC_SUCCESS;
  err:
-    OPENSSL_free(senc);
+    ossl_ssl_hs_free(s, senc);
     EVP_CIPHER_CTX_free(ctx);
     ssl_hmac_free(hctx);
     return ok;
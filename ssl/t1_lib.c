@@ -2196,6 +2196,108 @@ SSL_TICKET_STATUS tls_get_ticket_from_client(SSL_CONNECTION *s,
                               hello->session_id, hello->session_id_len, ret);
 }
 
+/*
+ * Parse the session in the decrypted ticket |sdec| of length |slen|, which
+ * is freed.
+ */
+static SSL_TICKET_STATUS tls_ticket_to_session(SSL_CONNECTION *s,
+                                               unsigned char *sdec, int slen,
+                                               const unsigned char *sess_id,
+                                               size_t sesslen,
+                                               int renew_ticket,
+                                               SSL_SESSION **psess)
+{
+    SSL_CTX *sctx = SSL_CONNECTION_GET_CTX(s);
+    SSL_SESSION *sess;
+    const unsigned char *p = sdec;
+
+    sess = d2i_SSL_SESSION_ex(NULL, &p, slen, sctx->libctx, sctx->propq);
+    slen -= p - sdec;
+    OPENSSL_clear_free(sdec, p - sdec + slen);
+    if (sess == NULL) {
+        ERR_clear_error();
+        /*
+         * For session parse failure, indicate that we need to send a new
+         * ticket.
+         */
+        return SSL_TICKET_NO_DECRYPT;
+    }
+
+    /* Some additional consistency checks */
+    if (slen != 0) {
+        SSL_SESSION_free(sess);
+        return SSL_TICKET_NO_DECRYPT;
+    }
+    /*
+     * The session ID, if non-empty, is used by some clients to detect
+     * that the ticket has been accepted. So we copy it to the session
+     * structure. If it is empty set length to zero as required by
+     * standard.
+     */
+    if (sesslen) {
+        memcpy(sess->session_id, sess_id, sesslen);
+        sess->session_id_length = sesslen;
+    }
+    *psess = sess;
+    return renew_ticket ? SSL_TICKET_SUCCESS_RENEW : SSL_TICKET_SUCCESS;
+}
+
+/*
+ * Open a ticket sealed with the key ring, see seal_ticket() in
+ * statem_srvr.c.  |ctx| has been set up with the key named in the ticket
+ * and is lent to us by the ring until ossl_ssl_ticket_key_release().
+ */
+static SSL_TICKET_STATUS tls_open_ticket(SSL_CONNECTION *s,
+                                         EVP_CIPHER_CTX *ctx,
+                                         const unsigned char *etick,
+                                         size_t eticklen,
+                                         const unsigned char *sess_id,
+                                         size_t sesslen, int renew_ticket,
+                                         SSL_SESSION **psess)
+{
+    const size_t hdrlen = TLSEXT_KEYNAME_LENGTH + SSL_TICKET_NONCE_LEN;
+    unsigned char *sdec;
+    size_t clen;
+    int len, lenfinal;
+    SSL_TICKET_STATUS ret = SSL_TICKET_FATAL_ERR_OTHER;
+
+    if (eticklen <= hdrlen + SSL_TICKET_TAG_LEN || eticklen > INT_MAX) {
+        ret = SSL_TICKET_NO_DECRYPT;
+        goto err;
+    }
+    clen = eticklen - hdrlen - SSL_TICKET_TAG_LEN;
+
+    if (!EVP_DecryptInit_ex(ctx, NULL, NULL, NULL,
+                            etick + TLSEXT_KEYNAME_LENGTH)
+            || !EVP_DecryptUpdate(ctx, NULL, &len, etick,
+                                  TLSEXT_KEYNAME_LENGTH)
+            || EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG,
+                                   SSL_TICKET_TAG_LEN,
+                                   (void *)(etick + eticklen
+                                            - SSL_TICKET_TAG_LEN)) <= 0)
+        goto err;
+
+    if ((sdec = OPENSSL_malloc(clen)) == NULL) {
+        ret = SSL_TICKET_FATAL_ERR_MALLOC;
+        goto err;
+    }
+    if (!EVP_DecryptUpdate(ctx, sdec, &len, etick + hdrlen, (int)clen)
+            || EVP_DecryptFinal_ex(ctx, sdec + len, &lenfinal) <= 0) {
+        OPENSSL_clear_free(sdec, clen);
+        ERR_clear_error();
+        ret = SSL_TICKET_NO_DECRYPT;
+        goto err;
+    }
+    ossl_ssl_ticket_key_release(s->session_ctx);
+
+    return tls_ticket_to_session(s, sdec, len + lenfinal, sess_id, sesslen,
+                                 renew_ticket, psess);
+
+ err:
+    ossl_ssl_ticket_key_release(s->session_ctx);
+    return ret;
+}
+
 /*-
  * tls_decrypt_ticket attempts to decrypt a session ticket.
  *
@@ -2262,6 +2364,16 @@ SSL_TICKET_STATUS tls_decrypt_ticket(SSL_CONNECTION *s,
         goto end;
     }
 
+    if (ossl_ssl_ticket_key_ring_in_use(tctx)
+            && (ctx = ossl_ssl_ticket_key_get_dec(tctx, etick,
+                                                  &renew_ticket)) != NULL) {
+        ret = tls_open_ticket(s, ctx, etick, eticklen, sess_id, sesslen,
+                              renew_ticket, &sess);
+        /* The context belongs to the ring */
+        ctx = NULL;
+        goto end;
+    }
+
     /* Initialize session ticket encryption and HMAC contexts */
     hctx = ssl_hmac_new(tctx);
     if (hctx == NULL) {
@@ -2329,7 +2441,8 @@ SSL_TICKET_STATUS tls_decrypt_ticket(SSL_CONNECTION *s,
             goto end;
         }
         EVP_CIPHER_free(aes256cbc);
-        if (SSL_CONNECTION_IS_TLS13(s))
+        /* Replace the ticket with one sealed by the key ring if there is one */
+        if (SSL_CONNECTION_IS_TLS13(s) || tctx->ext.ticket_keys != NULL)
             renew_ticket = 1;
     }
     /*
@@ -2382,40 +2495,8 @@ SSL_TICKET_STATUS tls_decrypt_ticket(SSL_CONNECTION *s,
         goto end;
     }
     slen += declen;
-    p = sdec;
-
-    sess = d2i_SSL_SESSION_ex(NULL, &p, slen, sctx->libctx, sctx->propq);
-    slen -= p - sdec;
-    OPENSSL_free(sdec);
-    if (sess) {
-        /* Some additional consistency checks */
-        if (slen != 0) {
-            SSL_SESSION_free(sess);
-            sess = NULL;
-            ret = SSL_TICKET_NO_DECRYPT;
-            goto end;
-        }
-        /*
-         * The session ID, if non-empty, is used by some clients to detect
-         * that the ticket has been accepted. So we copy it to the session
-         * structure. If it is empty set length to zero as required by
-         * standard.
-         */
-        if (sesslen) {
-            memcpy(sess->session_id, sess_id, sesslen);
-            sess->session_id_length = sesslen;
-        }
-        if (renew_ticket)
-            ret = SSL_TICKET_SUCCESS_RENEW;
-        else
-            ret = SSL_TICKET_SUCCESS;
-        goto end;
-    }
-    ERR_clear_error();
-    /*
-     * For session parse failure, indicate that we need to send a new ticket.
-     */
-    ret = SSL_TICKET_NO_DECRYPT;
+    ret = tls_ticket_to_session(s, sdec, slen, sess_id, sesslen, renew_ticket,
+                                &sess);
 
  end:
     EVP_CIPHER_CTX_free(ctx);
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Internal tests for the AES bulk functions selected at run-time.  The
+ * AVX512 VAES functions only get short known answer tests through
+ * evp_test, here they are compared with the AES-NI ones over lengths that
+ * exercise all of their loops and ciphertext stealing.
+ */
+
+#include <string.h>
+#include <openssl/evp.h>
+#include "internal/cryptlib.h"
+#include "testutil.h"
+
+#define AES_TEST_MAXLEN     (4096 + 64)
+
+static unsigned char key[64], iv[16], data[AES_TEST_MAXLEN];
+
+#if defined(__x86_64) || defined(__x86_64__) \
+    || defined(_M_AMD64) || defined(_M_X64)
+# define AES_TEST_IA32CAP
+/* VAES is bit 41 of OPENSSL_ia32cap_P[2] and [3] taken as one word */
+# define CAP_VAES       (1U << (41 - 32))
+
+static unsigned int saved_cap;
+
+static void cap_select(int vaes)
+{
+    OPENSSL_ia32cap_P[3] = vaes ? saved_cap : saved_cap & ~CAP_VAES;
+}
+
+static void cap_restore(void)
+{
+    OPENSSL_ia32cap_P[3] = saved_cap;
+}
+#else
+static void cap_select(ossl_unused int vaes)
+{
+}
+
+static void cap_restore(void)
+{
+}
+#endif
+
+static const char *ciphers[] = {
+    "AES-128-CTR", "AES-256-CTR", "AES-128-CBC", "AES-192-CBC",
+    "AES-256-CBC", "AES-128-XTS", "AES-256-XTS"
+};
+static const size_t lens[] = {
+    16, 17, 31, 48, 63, 64, 65, 127, 240, 255, 256, 257, 272, 300,
+    1024 + 15, 4096, AES_TEST_MAXLEN - 1
+};
+
+static int aes_crypt(const char *name, int enc, unsigned char *out,
+                     const unsigned char *in, size_t len)
+{
+    EVP_CIPHER *cipher = NULL;
+    EVP_CIPHER_CTX *ctx = NULL;
+    int outl = 0, tmpl = 0, ret = 0;
+
+    if (TEST_ptr(cipher = EVP_CIPHER_fetch(NULL, name, NULL))
+            && TEST_ptr(ctx = EVP_CIPHER_CTX_new())
+            && TEST_true(EVP_CipherInit_ex2(ctx, cipher, key, iv, enc, NULL))
+            && TEST_true(EVP_CIPHER_CTX_set_padding(ctx, 0))
+            && TEST_true(EVP_CipherUpdate(ctx, out, &outl, in, (int)len))
+            && TEST_true(EVP_CipherFinal_ex(ctx, out + outl, &tmpl))
+            && TEST_size_t_eq((size_t)(outl + tmpl), len))
+        ret = 1;
+    EVP_CIPHER_CTX_free(ctx);
+    EVP_CIPHER_free(cipher);
+    return ret;
+}
+
+/*
+ * Encryption with and without VAES must agree, and decryption in place
+ * with VAES must give the plaintext back.
+ */
+static int test_aes_vaes(int idx)
+{
+    const char *name = ciphers[idx];
+    int cbc = strstr(name, "CBC") != NULL;
+    unsigned char *ref = NULL, *buf = NULL;
+    size_t i, len;
+    int testresult = 0;
+
+    if (!TEST_ptr(ref = OPENSSL_malloc(AES_TEST_MAXLEN))
+            || !TEST_ptr(buf = OPENSSL_malloc(AES_TEST_MAXLEN)))
+        goto end;
+
+    for (i = 0; i < OSSL_NELEM(lens); i++) {
+        /* CBC is used without padding */
+        len = cbc ? lens[i] & ~(size_t)15 : lens[i];
+        cap_select(0);
+        if (!aes_crypt(name, 1, ref, data, len))
+            goto err;
+        cap_select(1);
+        if (!aes_crypt(name, 1, buf, data, len)
+                || !TEST_mem_eq(ref, len, buf, len)
+                || !aes_crypt(name, 0, buf, buf, len)
+                || !TEST_mem_eq(data, len, buf, len))
+            goto err;
+    }
+    testresult = 1;
+    goto end;
+ err:
+    TEST_info("%s, length %zu", name, len);
+ end:
+    cap_restore();
+    OPENSSL_free(ref);
+    OPENSSL_free(buf);
+    return testresult;
+}
+
+int setup_tests(void)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(key); i++)
+        key[i] = (unsigned char)(i * 7 + 1);
+    for (i = 0; i < sizeof(iv); i++)
+        iv[i] = (unsigned char)(i * 13 + 5);
+    /* The CTR counter wraps inside the first buffers */
+    memset(iv + 12, 0xff, 3);
+    for (i = 0; i < AES_TEST_MAXLEN; i++)
+        data[i] = (unsigned char)(i * 131 + (i >> 8));
+
+#ifdef AES_TEST_IA32CAP
+    OPENSSL_cpuid_setup();
+    saved_cap = OPENSSL_ia32cap_P[3];
+#endif
+    ADD_ALL_TESTS(test_aes_vaes, OSSL_NELEM(ciphers));
+    return 1;
+}
@@ -7,6 +7,9 @@
  * https://www.openssl.org/source/license.html
  */
 
+/* ERR_get_state() is deprecated, but still has to work */
+#define OPENSSL_SUPPRESS_DEPRECATED
+
 #include <string.h>
 #include <openssl/opensslconf.h>
 #include <openssl/err.h>
@@ -111,6 +114,42 @@ err:
     BIO_free(bio);
     return ret;
 }
+
+/* Test that ERR_get_state() hands out the documented ERR_STATE layout */
+static int test_get_state(void)
+{
+    ERR_STATE *es;
+    int res = 0;
+
+    ERR_clear_error();
+    ERR_raise_data(ERR_LIB_CRYPTO, ERR_R_PASSED_NULL_PARAMETER, "first");
+    ERR_raise(ERR_LIB_CRYPTO, ERR_R_INTERNAL_ERROR);
+    ERR_set_mark();
+
+    if (!TEST_ptr(es = ERR_get_state())
+        || !TEST_int_eq((es->bottom + 2) % ERR_NUM_ERRORS, es->top)
+        || !TEST_ulong_eq(es->err_buffer[es->top],
+                          ERR_PACK(ERR_LIB_CRYPTO, 0, ERR_R_INTERNAL_ERROR))
+        || !TEST_int_eq(es->err_marks[es->top], 1)
+        || !TEST_ptr(es->err_func[es->top])
+        || !TEST_ulong_eq(es->err_buffer[(es->bottom + 1) % ERR_NUM_ERRORS],
+                          ERR_PACK(ERR_LIB_CRYPTO, 0,
+                                   ERR_R_PASSED_NULL_PARAMETER))
+        || !TEST_str_eq(es->err_data[(es->bottom + 1) % ERR_NUM_ERRORS],
+                        "first"))
+        goto err;
+
+    /* The copy follows the queue on the next call */
+    ERR_clear_error();
+    if (!TEST_ptr(es = ERR_get_state())
+        || !TEST_int_eq(es->bottom, es->top))
+        goto err;
+
+    res = 1;
+ err:
+    ERR_clear_error();
+    return res;
+}
 #endif
 
 /* Test that querying the error queue preserves the OS error. */
@@ -406,6 +445,118 @@ static int test_save_restore(void)
     return res;
 }
 
+static int test_data_growth(void)
+{
+    static const char long_data[] =
+        "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+        "0123456789abcdef";
+    const char *data = NULL;
+    int flags = -1, res = 0;
+
+    /* Short data that grows beyond what can be held in the error record */
+    ERR_raise_data(ERR_LIB_CRYPTO, ERR_R_INTERNAL_ERROR, "%s", "short");
+    ERR_add_error_data(2, ":", long_data);
+    ERR_peek_last_error_data(&data, &flags);
+    if (!TEST_strn_eq(data, "short:", 6)
+            || !TEST_str_eq(data + 6, long_data)
+            || !TEST_int_eq(flags, ERR_TXT_STRING | ERR_TXT_MALLOCED))
+        goto err;
+
+    /* Reusing the record for short and long data in turn */
+    ERR_clear_error();
+    ERR_raise_data(ERR_LIB_CRYPTO, ERR_R_INTERNAL_ERROR, "%s", long_data);
+    ERR_peek_last_error_data(&data, &flags);
+    if (!TEST_str_eq(data, long_data))
+        goto err;
+    ERR_clear_error();
+    ERR_raise_data(ERR_LIB_CRYPTO, ERR_R_INTERNAL_ERROR, "%s", "short");
+    ERR_peek_last_error_data(&data, &flags);
+    if (!TEST_str_eq(data, "short")
+            || !TEST_int_eq(flags, ERR_TXT_STRING | ERR_TXT_MALLOCED))
+        goto err;
+
+    res = 1;
+ err:
+    ERR_clear_error();
+    return res;
+}
+
+static int test_pop_to_mark_reuse(void)
+{
+    const char *data = NULL, *func = NULL;
+    int flags = -1, res = 0;
+
+    ERR_raise(ERR_LIB_CRYPTO, ERR_R_MALLOC_FAILURE);
+    if (!TEST_true(ERR_set_mark()))
+        goto err;
+    ERR_raise_data(ERR_LIB_CRYPTO, ERR_R_INTERNAL_ERROR, "popped");
+    if (!TEST_true(ERR_set_mark()))
+        goto err;
+    ERR_raise_data(ERR_LIB_CRYPTO, ERR_R_INTERNAL_ERROR, "popped too");
+    if (!TEST_true(ERR_pop_to_mark())
+            || !TEST_true(ERR_pop_to_mark()))
+        goto err;
+
+    /* The popped records must not leak into the ones that replace them */
+    ERR_new();
+    ERR_set_debug(NULL, 0, NULL);
+    ERR_set_error(ERR_LIB_CRYPTO, ERR_R_PASSED_NULL_PARAMETER, NULL);
+    ERR_peek_last_error_all(NULL, NULL, &func, &data, &flags);
+    if (!TEST_str_eq(func, "")
+            || !TEST_str_eq(data, "")
+            || !TEST_int_eq(flags & ERR_TXT_STRING, 0))
+        goto err;
+
+    if (!TEST_ulong_eq(ERR_GET_REASON(ERR_get_error()), ERR_R_MALLOC_FAILURE)
+            || !TEST_ulong_eq(ERR_GET_REASON(ERR_get_error()),
+                              ERR_R_PASSED_NULL_PARAMETER)
+            || !TEST_ulong_eq(ERR_get_error(), 0))
+        goto err;
+
+    res = 1;
+ err:
+    ERR_clear_error();
+    return res;
+}
+
+/*
+ * File and function names must be copied into the error record, they may
+ * belong to a provider or engine that is unloaded before they're looked at.
+ */
+static int test_debug_copied(void)
+{
+    char file[32], func[32];
+    const char *efile = NULL, *efunc = NULL;
+    int line = 0, res = 0;
+
+    strcpy(file, "unloaded.c");
+    strcpy(func, "unloaded_func");
+    ERR_new();
+    ERR_set_debug(file, 42, func);
+    ERR_set_error(ERR_LIB_CRYPTO, ERR_R_INTERNAL_ERROR, NULL);
+    memset(file, 'x', sizeof(file) - 1);
+    memset(func, 'x', sizeof(func) - 1);
+
+    ERR_peek_last_error_all(&efile, &line, &efunc, NULL, NULL);
+    if (!TEST_str_eq(efile, "unloaded.c")
+            || !TEST_int_eq(line, 42)
+            || !TEST_str_eq(efunc, "unloaded_func"))
+        goto err;
+
+    /* Setting the names the record already has keeps them */
+    ERR_set_debug(efile, 43, efunc);
+    ERR_peek_last_error_all(&efile, &line, &efunc, NULL, NULL);
+    if (!TEST_str_eq(efile, "unloaded.c")
+            || !TEST_int_eq(line, 43)
+            || !TEST_str_eq(efunc, "unloaded_func"))
+        goto err;
+
+    res = 1;
+ err:
+    ERR_clear_error();
+    return res;
+}
+
 int setup_tests(void)
 {
     ADD_TEST(preserves_system_error);
@@ -413,9 +564,13 @@ int setup_tests(void)
     ADD_TEST(raised_error);
 #ifndef OPENSSL_NO_DEPRECATED_3_0
     ADD_TEST(test_print_error_format);
+    ADD_TEST(test_get_state);
 #endif
     ADD_TEST(test_marks);
     ADD_TEST(test_save_restore);
     ADD_TEST(test_clear_error);
+    ADD_TEST(test_data_growth);
+    ADD_TEST(test_pop_to_mark_reuse);
+    ADD_TEST(test_debug_copied);
     return 1;
 }
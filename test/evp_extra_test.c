@@ -32,6 +32,7 @@
 #include <openssl/rsa.h>
 #include <openssl/engine.h>
 #include <openssl/proverr.h>
+#include <openssl/thread.h>
 #include "testutil.h"
 #include "internal/nelem.h"
 #include "internal/sizes.h"
@@ -4878,8 +4879,757 @@ static int test_ecx_not_private_key(int tst)
 
     return testresult;
 }
+
+#endif /* OPENSSL_NO_ECX */
+
+/*-
+ * Keys for the batch tests.  |ctx| is set up with the first key, which the
+ * items refer to as NULL, and |kctx| is for checking items one by one.
+ */
+#define BATCH_MAX_KEYS      14
+
+typedef struct {
+    EVP_PKEY *keys[BATCH_MAX_KEYS];
+    size_t num_keys;
+    EVP_PKEY_CTX *ctx, *kctx;
+} BATCH_FIXTURE;
+
+/* Add a key of |type|, with |bits| bits or on |curve| if either is set */
+static int batch_add_key(BATCH_FIXTURE *f, const char *type, size_t bits,
+                         const char *curve)
+{
+    EVP_PKEY *pkey;
+
+    if (!TEST_size_t_lt(f->num_keys, BATCH_MAX_KEYS))
+        return 0;
+    if (bits != 0)
+        pkey = EVP_PKEY_Q_keygen(testctx, testpropq, type, bits);
+    else if (curve != NULL)
+        pkey = EVP_PKEY_Q_keygen(testctx, testpropq, type, curve);
+    else
+        pkey = EVP_PKEY_Q_keygen(testctx, testpropq, type);
+    if (!TEST_ptr(pkey))
+        return 0;
+    f->keys[f->num_keys++] = pkey;
+    return 1;
+}
+
+/* The key of an item signed or checked with |f->keys[k]| */
+static EVP_PKEY *batch_item_key(const BATCH_FIXTURE *f, size_t k)
+{
+    return k == 0 ? NULL : f->keys[k];
+}
+
+static int batch_ctx_new(BATCH_FIXTURE *f)
+{
+    return TEST_ptr(f->ctx = EVP_PKEY_CTX_new_from_pkey(testctx, f->keys[0],
+                                                        testpropq));
+}
+
+static int batch_kctx_new(BATCH_FIXTURE *f, size_t k)
+{
+    EVP_PKEY_CTX_free(f->kctx);
+    return TEST_ptr(f->kctx = EVP_PKEY_CTX_new_from_pkey(testctx, f->keys[k],
+                                                         testpropq));
+}
+
+static void batch_fixture_free(BATCH_FIXTURE *f)
+{
+    size_t i;
+
+    EVP_PKEY_CTX_free(f->ctx);
+    EVP_PKEY_CTX_free(f->kctx);
+    for (i = 0; i < f->num_keys; i++)
+        EVP_PKEY_free(f->keys[i]);
+}
+
+#ifndef OPENSSL_NO_ECX
+/*
+ * EVP_PKEY_verify_batch() with Ed25519 signatures by several keys, more of
+ * them than the provider gets at a time.
+ * Test 0: Ed25519
+ * Test 1: Ed25519ctx
+ * Test 2: Ed25519ph
+ */
+# define ED25519_BATCH_KEYS     3
+# define ED25519_BATCH_NUM      70
+
+static int test_ed25519_verify_batch(int tst)
+{
+    static const char *instances[] = { "Ed25519", "Ed25519ctx", "Ed25519ph" };
+    static unsigned char context[] = "batch";
+    BATCH_FIXTURE f = { { NULL } };
+    EVP_MD_CTX *mctx = NULL;
+    EVP_PKEY_VERIFY_BATCH_ITEM *items = NULL;
+    unsigned char (*sigs)[64] = NULL, msgs[ED25519_BATCH_NUM][16];
+    OSSL_PARAM params[3], *p = params;
+    size_t i, siglen;
+    int testresult = 0;
+
+    *p++ = OSSL_PARAM_construct_utf8_string(OSSL_SIGNATURE_PARAM_INSTANCE,
+                                            (char *)instances[tst], 0);
+    if (tst == 1)
+        *p++ = OSSL_PARAM_construct_octet_string(OSSL_SIGNATURE_PARAM_CONTEXT_STRING,
+                                                 context, sizeof(context) - 1);
+    *p = OSSL_PARAM_construct_end();
+
+    if (!TEST_ptr(items = OPENSSL_malloc(ED25519_BATCH_NUM * sizeof(*items)))
+            || !TEST_ptr(sigs = OPENSSL_malloc(ED25519_BATCH_NUM * sizeof(*sigs)))
+            || !TEST_ptr(mctx = EVP_MD_CTX_new()))
+        goto err;
+    for (i = 0; i < ED25519_BATCH_KEYS; i++)
+        if (!batch_add_key(&f, "ED25519", 0, NULL))
+            goto err;
+
+    for (i = 0; i < ED25519_BATCH_NUM; i++) {
+        memset(msgs[i], (int)i, sizeof(msgs[i]));
+        siglen = sizeof(sigs[i]);
+        EVP_MD_CTX_reset(mctx);
+        if (!TEST_true(EVP_DigestSignInit_ex(mctx, NULL, NULL, testctx,
+                                             testpropq,
+                                             f.keys[i % ED25519_BATCH_KEYS],
+                                             params))
+                || !TEST_true(EVP_DigestSign(mctx, sigs[i], &siglen, msgs[i],
+                                             i % sizeof(msgs[i]))))
+            goto err;
+        items[i].pkey = batch_item_key(&f, i % ED25519_BATCH_KEYS);
+        items[i].sig = sigs[i];
+        items[i].siglen = siglen;
+        items[i].tbs = msgs[i];
+        items[i].tbslen = i % sizeof(msgs[i]);
+    }
+
+    if (!batch_ctx_new(&f)
+            || !TEST_int_gt(EVP_PKEY_verify_init_ex(f.ctx, params), 0)
+            || !TEST_int_eq(EVP_PKEY_verify_batch(f.ctx, items,
+                                                  ED25519_BATCH_NUM), 1)
+            || !TEST_int_eq(EVP_PKEY_verify_batch(f.ctx, items + 1, 1), 1)
+            || !TEST_int_eq(EVP_PKEY_verify_batch(f.ctx, items, 0), 1))
+        goto err;
+
+    /* Any bad signature fails the whole batch */
+    msgs[66][0] ^= 1;
+    if (!TEST_int_eq(EVP_PKEY_verify_batch(f.ctx, items, ED25519_BATCH_NUM), 0))
+        goto err;
+    msgs[66][0] ^= 1;
+    sigs[5][0] ^= 0x80;
+    if (!TEST_int_eq(EVP_PKEY_verify_batch(f.ctx, items, ED25519_BATCH_NUM), 0))
+        goto err;
+    sigs[5][0] ^= 0x80;
+    items[7].pkey = f.keys[(7 + 1) % ED25519_BATCH_KEYS];
+    if (!TEST_int_eq(EVP_PKEY_verify_batch(f.ctx, items, ED25519_BATCH_NUM), 0))
+        goto err;
+    items[7].pkey = f.keys[7 % ED25519_BATCH_KEYS];
+    items[9].siglen--;
+    if (!TEST_int_eq(EVP_PKEY_verify_batch(f.ctx, items, ED25519_BATCH_NUM), 0))
+        goto err;
+    items[9].siglen++;
+
+    if (!TEST_int_eq(EVP_PKEY_verify_batch(f.ctx, items, ED25519_BATCH_NUM), 1))
+        goto err;
+    testresult = 1;
+ err:
+    batch_fixture_free(&f);
+    EVP_MD_CTX_free(mctx);
+    OPENSSL_free(items);
+    OPENSSL_free(sigs);
+    return testresult;
+}
+
+/*
+ * A signature by a key of small order, with R of small order and s = 0,
+ * passes the cofactored verification equation for every message but
+ * EVP_PKEY_verify() only for some.  The batch must not accept it for those.
+ */
+static int test_ed25519_verify_batch_small_order(void)
+{
+    /* A point of order 4, and the neutral element */
+    static const unsigned char small_pub[32] = { 0 };
+    static const unsigned char small_sig[64] = { 1 };
+    EVP_PKEY *key = NULL, *small = NULL;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_MD_CTX *mctx = NULL;
+    EVP_PKEY_VERIFY_BATCH_ITEM items[2];
+    unsigned char sig[64], msg[1];
+    size_t siglen = sizeof(sig);
+    int i, rejected = 0, testresult = 0;
+
+    if (!TEST_ptr(key = EVP_PKEY_Q_keygen(testctx, testpropq, "ED25519"))
+            || !TEST_ptr(small = EVP_PKEY_new_raw_public_key_ex(testctx,
+                                                                "ED25519",
+                                                                testpropq,
+                                                                small_pub,
+                                                                sizeof(small_pub)))
+            || !TEST_ptr(mctx = EVP_MD_CTX_new())
+            || !TEST_true(EVP_DigestSignInit_ex(mctx, NULL, NULL, testctx,
+                                                testpropq, key, NULL))
+            || !TEST_true(EVP_DigestSign(mctx, sig, &siglen,
+                                         (unsigned char *)"batch", 5))
+            || !TEST_ptr(ctx = EVP_PKEY_CTX_new_from_pkey(testctx, key,
+                                                          testpropq))
+            || !TEST_int_gt(EVP_PKEY_verify_init(ctx), 0))
+        goto err;
+
+    items[0].pkey = NULL;
+    items[0].sig = sig;
+    items[0].siglen = siglen;
+    items[0].tbs = (unsigned char *)"batch";
+    items[0].tbslen = 5;
+    items[1].pkey = small;
+    items[1].sig = small_sig;
+    items[1].siglen = sizeof(small_sig);
+    items[1].tbs = msg;
+    items[1].tbslen = sizeof(msg);
+
+    for (i = 0; i < 16; i++) {
+        msg[0] = (unsigned char)i;
+        EVP_MD_CTX_reset(mctx);
+        if (!TEST_true(EVP_DigestVerifyInit_ex(mctx, NULL, NULL, testctx,
+                                               testpropq, small, NULL)))
+            goto err;
+        if (EVP_DigestVerify(mctx, small_sig, sizeof(small_sig), msg,
+                             sizeof(msg)) == 1)
+            continue;
+        rejected++;
+        if (!TEST_int_eq(EVP_PKEY_verify_batch(ctx, items, 2), 0))
+            goto err;
+    }
+    ERR_clear_error();
+    if (!TEST_int_gt(rejected, 0)
+            || !TEST_int_eq(EVP_PKEY_verify_batch(ctx, items, 1), 1))
+        goto err;
+    testresult = 1;
+ err:
+    EVP_PKEY_CTX_free(ctx);
+    EVP_MD_CTX_free(mctx);
+    EVP_PKEY_free(key);
+    EVP_PKEY_free(small);
+    return testresult;
+}
+
+/*
+ * Encodings of points of small order, as used by the Wycheproof EdDSA tests
+ * and "Taming the many EdDSAs", including encodings with y >= p and with
+ * the sign bit set for x = 0.
+ */
+static const unsigned char ed25519_small_order[][32] = {
+    /* The neutral element, order 1 */
+    { 0x01 },
+    /* Order 2 */
+    { 0xec, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f },
+    /* Order 4 */
+    { 0x00 },
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80 },
+    /* Order 8 */
+    { 0xc7, 0x17, 0x6a, 0x70, 0x3d, 0x4d, 0xd8, 0x4f,
+      0xba, 0x3c, 0x0b, 0x76, 0x0d, 0x10, 0x67, 0x0f,
+      0x2a, 0x20, 0x53, 0xfa, 0x2c, 0x39, 0xcc, 0xc6,
+      0x4e, 0xc7, 0xfd, 0x77, 0x92, 0xac, 0x03, 0x7a },
+    { 0xc7, 0x17, 0x6a, 0x70, 0x3d, 0x4d, 0xd8, 0x4f,
+      0xba, 0x3c, 0x0b, 0x76, 0x0d, 0x10, 0x67, 0x0f,
+      0x2a, 0x20, 0x53, 0xfa, 0x2c, 0x39, 0xcc, 0xc6,
+      0x4e, 0xc7, 0xfd, 0x77, 0x92, 0xac, 0x03, 0xfa },
+    { 0x26, 0xe8, 0x95, 0x8f, 0xc2, 0xb2, 0x27, 0xb0,
+      0x45, 0xc3, 0xf4, 0x89, 0xf2, 0xef, 0x98, 0xf0,
+      0xd5, 0xdf, 0xac, 0x05, 0xd3, 0xc6, 0x33, 0x39,
+      0xb1, 0x38, 0x02, 0x88, 0x6d, 0x53, 0xfc, 0x05 },
+    /* Non-canonical: y = p, order 4 */
+    { 0xed, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f },
+    /* Non-canonical: y = p + 1, the neutral element */
+    { 0xee, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f },
+    /* Non-canonical: the neutral element with the sign bit set */
+    { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80 },
+};
+
+/* The order of the base point, little endian */
+static const unsigned char ed25519_order[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+    0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+/*
+ * Wycheproof style edge cases for EVP_PKEY_verify_batch(): a signature
+ * made invalid in one of the ways below is batched with a valid one, and
+ * the batch must fail.  Where EVP_PKEY_verify() must reject the signature
+ * too, that is checked as well.
+ * Test 0: S + L, a non-canonical S for the same signature
+ * Test 1: S with the top bit set
+ * Test 2 onwards: R replaced by each point of small order, then a key and
+ *                 R both of small order with S = 0, for several messages
+ */
+static int test_ed25519_verify_batch_edge(int tst)
+{
+    static const unsigned char msg[] = "batch";
+    EVP_PKEY *key = NULL, *small = NULL;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_MD_CTX *mctx = NULL;
+    EVP_PKEY_VERIFY_BATCH_ITEM items[2];
+    unsigned char sig[64], bad[64];
+    const unsigned char *point = NULL;
+    size_t siglen = sizeof(sig);
+    unsigned int carry;
+    int i, testresult = 0;
+
+    if (!TEST_ptr(key = EVP_PKEY_Q_keygen(testctx, testpropq, "ED25519"))
+            || !TEST_ptr(mctx = EVP_MD_CTX_new())
+            || !TEST_true(EVP_DigestSignInit_ex(mctx, NULL, NULL, testctx,
+                                                testpropq, key, NULL))
+            || !TEST_true(EVP_DigestSign(mctx, sig, &siglen, msg,
+                                         sizeof(msg)))
+            || !TEST_ptr(ctx = EVP_PKEY_CTX_new_from_pkey(testctx, key,
+                                                          testpropq))
+            || !TEST_int_gt(EVP_PKEY_verify_init(ctx), 0))
+        goto err;
+
+    memcpy(bad, sig, sizeof(bad));
+    switch (tst) {
+    case 0:
+        for (i = 0, carry = 0; i < 32; i++) {
+            carry += bad[32 + i] + ed25519_order[i];
+            bad[32 + i] = (unsigned char)carry;
+            carry >>= 8;
+        }
+        break;
+    case 1:
+        bad[63] |= 0x80;
+        break;
+    default:
+        point = ed25519_small_order[tst - 2];
+        memcpy(bad, point, 32);
+        break;
+    }
+
+    for (i = 0; i < 2; i++) {
+        items[i].pkey = NULL;
+        items[i].sig = i == 0 ? sig : bad;
+        items[i].siglen = siglen;
+        items[i].tbs = msg;
+        items[i].tbslen = sizeof(msg);
+    }
+    EVP_MD_CTX_reset(mctx);
+    if (!TEST_true(EVP_DigestVerifyInit_ex(mctx, NULL, NULL, testctx,
+                                           testpropq, key, NULL))
+            || !TEST_int_le(EVP_DigestVerify(mctx, bad, sizeof(bad), msg,
+                                             sizeof(msg)), 0)
+            || !TEST_int_eq(EVP_PKEY_verify_batch(ctx, items, 2), 0)
+            || !TEST_int_eq(EVP_PKEY_verify_batch(ctx, items, 1), 1))
+        goto err;
+    if (point == NULL) {
+        testresult = 1;
+        goto err;
+    }
+
+    /* A key of small order, R of small order and S = 0 */
+    memset(bad + 32, 0, 32);
+    if (!TEST_ptr(small = EVP_PKEY_new_raw_public_key_ex(testctx, "ED25519",
+                                                         testpropq, point,
+                                                         32)))
+        goto err;
+    items[1].pkey = small;
+    for (i = 0; i < 8; i++) {
+        unsigned char m = (unsigned char)i;
+
+        items[1].tbs = &m;
+        items[1].tbslen = 1;
+        if (!TEST_int_eq(EVP_PKEY_verify_batch(ctx, items, 2), 0))
+            goto err;
+    }
+    testresult = 1;
+ err:
+    ERR_clear_error();
+    EVP_PKEY_CTX_free(ctx);
+    EVP_MD_CTX_free(mctx);
+    EVP_PKEY_free(key);
+    EVP_PKEY_free(small);
+    return testresult;
+}
 #endif /* OPENSSL_NO_ECX */
 
+/*
+ * EVP_PKEY_sign_batch() with RSA signatures by several keys, checked against
+ * EVP_PKEY_sign() for the deterministic paddings and with EVP_PKEY_verify().
+ * The odd number of items leaves one to be signed on its own, and the
+ * 1024-bit key cannot use the same exponentiation code as the others.
+ * Test 0: PKCS#1 v1.5 with SHA-256
+ * Test 1: PSS with SHA-256
+ * Test 2: PKCS#1 v1.5 without a digest
+ */
+#define RSA_BATCH_KEYS      3
+#define RSA_BATCH_NUM       9
+
+static int rsa_batch_ctx_init(EVP_PKEY_CTX *ctx, int sign, int tst)
+{
+    int ret = sign ? EVP_PKEY_sign_init(ctx) : EVP_PKEY_verify_init(ctx);
+
+    if (!TEST_int_gt(ret, 0)
+            || !TEST_int_gt(EVP_PKEY_CTX_set_rsa_padding(ctx,
+                                tst == 1 ? RSA_PKCS1_PSS_PADDING
+                                         : RSA_PKCS1_PADDING), 0))
+        return 0;
+    if (tst != 2
+            && !TEST_int_gt(EVP_PKEY_CTX_set_signature_md(ctx, EVP_sha256()),
+                            0))
+        return 0;
+    return 1;
+}
+
+static int test_rsa_sign_batch(int tst)
+{
+    static const unsigned int bits[RSA_BATCH_KEYS] = { 2048, 2048, 1024 };
+    BATCH_FIXTURE f = { { NULL } };
+    EVP_PKEY_SIGN_BATCH_ITEM items[RSA_BATCH_NUM];
+    unsigned char sigs[RSA_BATCH_NUM][256], ref[256];
+    unsigned char tbs[RSA_BATCH_NUM][32];
+    size_t i, k, reflen;
+    int testresult = 0;
+
+    for (i = 0; i < RSA_BATCH_KEYS; i++)
+        if (!batch_add_key(&f, "RSA", bits[i], NULL))
+            goto err;
+
+    for (i = 0; i < RSA_BATCH_NUM; i++) {
+        memset(tbs[i], (int)i + 1, sizeof(tbs[i]));
+        items[i].pkey = batch_item_key(&f, i % RSA_BATCH_KEYS);
+        items[i].sig = sigs[i];
+        items[i].siglen = sizeof(sigs[i]);
+        items[i].tbs = tbs[i];
+        items[i].tbslen = sizeof(tbs[i]);
+    }
+
+    if (!batch_ctx_new(&f)
+            || !rsa_batch_ctx_init(f.ctx, 1, tst)
+            || !TEST_int_eq(EVP_PKEY_sign_batch(f.ctx, items, RSA_BATCH_NUM), 1)
+            || !TEST_int_eq(EVP_PKEY_sign_batch(f.ctx, items, 0), 1))
+        goto err;
+
+    for (i = 0; i < RSA_BATCH_NUM; i++) {
+        k = i % RSA_BATCH_KEYS;
+        if (!TEST_size_t_eq(items[i].siglen, bits[k] / 8))
+            goto err;
+        if (!batch_kctx_new(&f, k)
+                || !rsa_batch_ctx_init(f.kctx, 0, tst)
+                || !TEST_int_eq(EVP_PKEY_verify(f.kctx, sigs[i],
+                                                items[i].siglen, tbs[i],
+                                                sizeof(tbs[i])), 1))
+            goto err;
+        if (tst == 1)
+            continue;
+        reflen = sizeof(ref);
+        if (!rsa_batch_ctx_init(f.kctx, 1, tst)
+                || !TEST_int_gt(EVP_PKEY_sign(f.kctx, ref, &reflen, tbs[i],
+                                              sizeof(tbs[i])), 0)
+                || !TEST_mem_eq(ref, reflen, sigs[i], items[i].siglen))
+            goto err;
+    }
+
+    /* A buffer that is too small fails the batch */
+    items[4].siglen = 255;
+    if (!TEST_int_le(EVP_PKEY_sign_batch(f.ctx, items, RSA_BATCH_NUM), 0))
+        goto err;
+    testresult = 1;
+ err:
+    batch_fixture_free(&f);
+    return testresult;
+}
+
+#ifndef OPENSSL_NO_EC
+/*
+ * EVP_PKEY_sign_batch() with ECDSA signatures by keys on two curves, which
+ * split the batch into runs that share their nonce setup, checked with
+ * EVP_PKEY_verify().
+ * Test 0: random nonces
+ * Test 1: deterministic nonces, also checked against EVP_PKEY_sign()
+ */
+# define ECDSA_BATCH_KEYS    3
+# define ECDSA_BATCH_NUM     11
+
+static int ecdsa_batch_ctx_init(EVP_PKEY_CTX *ctx, int sign, int tst)
+{
+    OSSL_PARAM params[2] = { OSSL_PARAM_END, OSSL_PARAM_END };
+    unsigned int nonce_type = 1;
+    int ret;
+
+    if (tst == 1)
+        params[0] = OSSL_PARAM_construct_uint(OSSL_SIGNATURE_PARAM_NONCE_TYPE,
+                                              &nonce_type);
+    ret = sign ? EVP_PKEY_sign_init_ex(ctx, params)
+               : EVP_PKEY_verify_init(ctx);
+    return TEST_int_gt(ret, 0)
+        && TEST_int_gt(EVP_PKEY_CTX_set_signature_md(ctx, EVP_sha256()), 0);
+}
+
+static int test_ecdsa_sign_batch(int tst)
+{
+    static const char *curves[ECDSA_BATCH_KEYS] = {
+        "P-256", "P-256", "P-384"
+    };
+    BATCH_FIXTURE f = { { NULL } };
+    EVP_PKEY_SIGN_BATCH_ITEM items[ECDSA_BATCH_NUM];
+    unsigned char sigs[ECDSA_BATCH_NUM][128], ref[128];
+    unsigned char tbs[ECDSA_BATCH_NUM][32];
+    size_t i, k, reflen;
+    int testresult = 0;
+
+    for (i = 0; i < ECDSA_BATCH_KEYS; i++)
+        if (!batch_add_key(&f, "EC", 0, curves[i]))
+            goto err;
+
+    for (i = 0; i < ECDSA_BATCH_NUM; i++) {
+        memset(tbs[i], (int)i + 1, sizeof(tbs[i]));
+        /* Two items signed with P-256 keys, then two with P-384, and so on */
+        k = (i / 2) % 2 == 0 ? i % 2 : 2;
+        items[i].pkey = batch_item_key(&f, k);
+        items[i].sig = sigs[i];
+        items[i].siglen = sizeof(sigs[i]);
+        items[i].tbs = tbs[i];
+        items[i].tbslen = sizeof(tbs[i]);
+    }
+
+    if (!batch_ctx_new(&f)
+            || !ecdsa_batch_ctx_init(f.ctx, 1, tst)
+            || !TEST_int_eq(EVP_PKEY_sign_batch(f.ctx, items, ECDSA_BATCH_NUM),
+                            1))
+        goto err;
+
+    for (i = 0; i < ECDSA_BATCH_NUM; i++) {
+        k = (i / 2) % 2 == 0 ? i % 2 : 2;
+        if (!batch_kctx_new(&f, k)
+                || !ecdsa_batch_ctx_init(f.kctx, 0, tst)
+                || !TEST_int_eq(EVP_PKEY_verify(f.kctx, sigs[i],
+                                                items[i].siglen, tbs[i],
+                                                sizeof(tbs[i])), 1))
+            goto err;
+        /* The same nonce is used twice only by mistake */
+        if (i > 0 && !TEST_mem_ne(sigs[i], items[i].siglen,
+                                  sigs[i - 1], items[i - 1].siglen))
+            goto err;
+        if (tst == 0)
+            continue;
+        reflen = sizeof(ref);
+        if (!ecdsa_batch_ctx_init(f.kctx, 1, tst)
+                || !TEST_int_gt(EVP_PKEY_sign(f.kctx, ref, &reflen, tbs[i],
+                                              sizeof(tbs[i])), 0)
+                || !TEST_mem_eq(ref, reflen, sigs[i], items[i].siglen))
+            goto err;
+    }
+
+    /* A buffer that is too small fails the batch */
+    for (i = 0; i < ECDSA_BATCH_NUM; i++)
+        items[i].siglen = sizeof(sigs[i]);
+    items[4].siglen = 8;
+    if (!TEST_int_le(EVP_PKEY_sign_batch(f.ctx, items, ECDSA_BATCH_NUM), 0))
+        goto err;
+    testresult = 1;
+ err:
+    batch_fixture_free(&f);
+    return testresult;
+}
+
+/*
+ * EVP_PKEY_derive_batch() with ECDH keys on two curves, each item with a
+ * private key and a peer of its own, checked against EVP_PKEY_derive().
+ * Test 0: plain shared secrets, the last one truncated
+ * Test 1: X9.63 KDF with SHA-256
+ */
+# define ECDH_BATCH_NUM      7
+
+static int ecdh_batch_ctx_init(EVP_PKEY_CTX *ctx, int tst)
+{
+    if (!TEST_int_gt(EVP_PKEY_derive_init(ctx), 0))
+        return 0;
+    if (tst == 1
+            && (!TEST_int_gt(EVP_PKEY_CTX_set_ecdh_kdf_type(ctx,
+                                 EVP_PKEY_ECDH_KDF_X9_63), 0)
+                || !TEST_int_gt(EVP_PKEY_CTX_set_ecdh_kdf_md(ctx,
+                                                             EVP_sha256()), 0)
+                || !TEST_int_gt(EVP_PKEY_CTX_set_ecdh_kdf_outlen(ctx, 40), 0)))
+        return 0;
+    return 1;
+}
+
+static int test_ecdh_derive_batch(int tst)
+{
+    BATCH_FIXTURE f = { { NULL } };
+    EVP_PKEY **peers = f.keys + ECDH_BATCH_NUM;
+    EVP_PKEY_DERIVE_BATCH_ITEM items[ECDH_BATCH_NUM];
+    unsigned char secrets[ECDH_BATCH_NUM][64], ref[64];
+    const char *curve;
+    size_t i, reflen;
+    int testresult = 0;
+
+    /* The keys of the items, then their peers */
+    for (i = 0; i < 2 * ECDH_BATCH_NUM; i++) {
+        /* Three items on P-256, then one on P-384, and so on */
+        curve = i % ECDH_BATCH_NUM % 4 == 3 ? "P-384" : "P-256";
+        if (!batch_add_key(&f, "EC", 0, curve))
+            goto err;
+    }
+    for (i = 0; i < ECDH_BATCH_NUM; i++) {
+        items[i].pkey = batch_item_key(&f, i);
+        items[i].peer = peers[i];
+        items[i].key = secrets[i];
+        items[i].keylen = sizeof(secrets[i]);
+    }
+    if (tst == 0)
+        items[ECDH_BATCH_NUM - 1].keylen = 20;
+
+    if (!batch_ctx_new(&f)
+            || !ecdh_batch_ctx_init(f.ctx, tst)
+            || !TEST_int_eq(EVP_PKEY_derive_batch(f.ctx, items,
+                                                  ECDH_BATCH_NUM), 1))
+        goto err;
+
+    for (i = 0; i < ECDH_BATCH_NUM; i++) {
+        reflen = i == ECDH_BATCH_NUM - 1 && tst == 0 ? 20 : sizeof(ref);
+        if (!batch_kctx_new(&f, i)
+                || !ecdh_batch_ctx_init(f.kctx, tst)
+                || !TEST_int_gt(EVP_PKEY_derive_set_peer(f.kctx, peers[i]), 0)
+                || !TEST_int_gt(EVP_PKEY_derive(f.kctx, ref, &reflen), 0)
+                || !TEST_mem_eq(ref, reflen, secrets[i], items[i].keylen))
+            goto err;
+    }
+
+    /* A peer on another curve fails the batch */
+    items[1].peer = peers[3];
+    if (!TEST_int_le(EVP_PKEY_derive_batch(f.ctx, items, ECDH_BATCH_NUM), 0))
+        goto err;
+    testresult = 1;
+ err:
+    batch_fixture_free(&f);
+    return testresult;
+}
+#endif /* OPENSSL_NO_EC */
+
+static const char *cipher_threads_names[] = {
+    "AES-128-CTR", "AES-256-XTS", "AES-256-GCM"
+};
+
+/*
+ * Run |name| over |in| in a few uneven updates, letting a single update use
+ * up to |threads| threads once it is at least 64KB long.
+ */
+static int cipher_threads_run(const char *name, int enc, unsigned int threads,
+                              const unsigned char *in, size_t len,
+                              unsigned char *out, unsigned char *tag)
+{
+    EVP_CIPHER *cipher = NULL;
+    EVP_CIPHER_CTX *ctx = NULL;
+    OSSL_PARAM params[3];
+    unsigned char key[64], iv[16], aad[20];
+    size_t threshold = 64 * 1024, done = 0, chunk, i;
+    int outl, aead, testresult = 0;
+
+    for (i = 0; i < sizeof(key); i++)
+        key[i] = (unsigned char)(i * 7 + 1);
+    memset(iv, 0xa5, sizeof(iv));
+    memset(aad, 0x5a, sizeof(aad));
+    params[0] = OSSL_PARAM_construct_uint(OSSL_CIPHER_PARAM_THREADS, &threads);
+    params[1] = OSSL_PARAM_construct_size_t(OSSL_CIPHER_PARAM_THREAD_THRESHOLD,
+                                            &threshold);
+    params[2] = OSSL_PARAM_construct_end();
+
+    if (!TEST_ptr(cipher = EVP_CIPHER_fetch(testctx, name, testpropq))
+            || !TEST_ptr(ctx = EVP_CIPHER_CTX_new())
+            || !TEST_true(EVP_CipherInit_ex2(ctx, cipher, key, iv, enc,
+                                             params)))
+        goto err;
+
+    aead = (EVP_CIPHER_get_flags(cipher) & EVP_CIPH_FLAG_AEAD_CIPHER) != 0;
+    if (aead) {
+        if (!TEST_true(EVP_CipherUpdate(ctx, NULL, &outl, aad, sizeof(aad))))
+            goto err;
+        if (!enc && !TEST_int_gt(EVP_CIPHER_CTX_ctrl(ctx,
+                                                     EVP_CTRL_AEAD_SET_TAG,
+                                                     16, tag), 0))
+            goto err;
+    }
+
+    while (done < len) {
+        /* XTS needs the whole data unit in one update */
+        if (EVP_CIPHER_get_mode(cipher) == EVP_CIPH_XTS_MODE)
+            chunk = len;
+        else
+            chunk = done == 0 ? 7 : (len - done) / 2 + 3;
+        if (chunk > len - done)
+            chunk = len - done;
+        if (!TEST_true(EVP_CipherUpdate(ctx, out + done, &outl, in + done,
+                                        (int)chunk))
+                || !TEST_size_t_eq(outl, chunk))
+            goto err;
+        done += chunk;
+    }
+    if (!TEST_true(EVP_CipherFinal_ex(ctx, out + done, &outl))
+            || !TEST_int_eq(outl, 0))
+        goto err;
+    if (aead && enc
+            && !TEST_int_gt(EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG,
+                                                16, tag), 0))
+        goto err;
+    testresult = 1;
+ err:
+    EVP_CIPHER_CTX_free(ctx);
+    EVP_CIPHER_free(cipher);
+    return testresult;
+}
+
+/*
+ * Splitting a large update over pool threads must give the same result as
+ * processing it on one thread.
+ */
+static int test_cipher_threads(int idx)
+{
+    const char *name = cipher_threads_names[idx];
+    const size_t len = 4 * 1024 * 1024 + 13;
+    unsigned char *pt = NULL, *ct = NULL, *ref = NULL, *dec = NULL;
+    unsigned char tag[16] = { 0 }, reftag[16] = { 0 };
+    size_t i;
+    int testresult = 0;
+
+    if (!OSSL_set_max_threads(testctx, 3))
+        TEST_info("Thread pool not available, using the calling thread");
+
+    if (!TEST_ptr(pt = OPENSSL_malloc(len))
+            || !TEST_ptr(ct = OPENSSL_malloc(len))
+            || !TEST_ptr(ref = OPENSSL_malloc(len))
+            || !TEST_ptr(dec = OPENSSL_malloc(len)))
+        goto err;
+    for (i = 0; i < len; i++)
+        pt[i] = (unsigned char)(i % 251);
+
+    if (!TEST_true(cipher_threads_run(name, 1, 1, pt, len, ref, reftag))
+            || !TEST_true(cipher_threads_run(name, 1, 4, pt, len, ct, tag))
+            || !TEST_mem_eq(ct, len, ref, len)
+            || !TEST_mem_eq(tag, sizeof(tag), reftag, sizeof(reftag))
+            || !TEST_true(cipher_threads_run(name, 0, 4, ct, len, dec, tag))
+            || !TEST_mem_eq(dec, len, pt, len))
+        goto err;
+    testresult = 1;
+ err:
+    OPENSSL_free(pt);
+    OPENSSL_free(ct);
+    OPENSSL_free(ref);
+    OPENSSL_free(dec);
+    OSSL_set_max_threads(testctx, 0);
+    return testresult;
+}
+
 static int test_sign_continuation(void)
 {
     OSSL_PROVIDER *fake_rsa = NULL;
@@ -5079,9 +5829,19 @@ int setup_tests(void)
 #ifndef OPENSSL_NO_ECX
     ADD_ALL_TESTS(test_ecx_short_keys, OSSL_NELEM(ecxnids));
     ADD_ALL_TESTS(test_ecx_not_private_key, OSSL_NELEM(keys));
+    ADD_ALL_TESTS(test_ed25519_verify_batch, 3);
+    ADD_TEST(test_ed25519_verify_batch_small_order);
+    ADD_ALL_TESTS(test_ed25519_verify_batch_edge,
+                  2 + OSSL_NELEM(ed25519_small_order));
 #endif
 
+    ADD_ALL_TESTS(test_rsa_sign_batch, 3);
+#ifndef OPENSSL_NO_EC
+    ADD_ALL_TESTS(test_ecdsa_sign_batch, 2);
+    ADD_ALL_TESTS(test_ecdh_derive_batch, 2);
+#endif
     ADD_TEST(test_sign_continuation);
+    ADD_ALL_TESTS(test_cipher_threads, OSSL_NELEM(cipher_threads_names));
 
     return 1;
 }
@@ -695,6 +695,69 @@ static int test_provider_unload_effective(int testid)
     return ok;
 }
 
+/*
+ * Fetches from a frozen library context give the same methods as before,
+ * and the frozen table doesn't outlive changes to the available methods.
+ */
+static int test_lib_ctx_freeze(void)
+{
+    OSSL_LIB_CTX *ctx = NULL;
+    OSSL_PROVIDER *deflt = NULL;
+    EVP_MD *md1 = NULL, *md2 = NULL;
+    EVP_CIPHER *cipher = NULL;
+    int ok = 0;
+
+    if (!TEST_ptr(ctx = OSSL_LIB_CTX_new())
+            || !TEST_ptr(deflt = OSSL_PROVIDER_load(ctx, "default"))
+            || !TEST_ptr(md1 = EVP_MD_fetch(ctx, "SHA2-256", NULL))
+            || !TEST_true(OSSL_LIB_CTX_freeze(ctx, NULL)))
+        goto err;
+
+    if (!TEST_ptr(md2 = EVP_MD_fetch(ctx, "SHA256", NULL))
+            || !TEST_ptr_eq(md1, md2)
+            || !TEST_ptr(cipher = EVP_CIPHER_fetch(ctx, "AES-128-GCM", NULL)))
+        goto err;
+    EVP_MD_free(md2);
+    EVP_CIPHER_free(cipher);
+    cipher = NULL;
+
+    /* Other queries still work the usual way */
+    if (!TEST_ptr(md2 = EVP_MD_fetch(ctx, "SHA2-256", "provider=default"))
+            || !TEST_ptr_eq(md1, md2)
+            || !TEST_ptr_null(cipher = EVP_CIPHER_fetch(ctx, "AES-128-GCM",
+                                                        "provider=fips")))
+        goto err;
+    EVP_MD_free(md2);
+    md2 = NULL;
+
+    /* Changing the default properties must take effect */
+    if (!TEST_true(EVP_set_default_properties(ctx, "provider=fips"))
+            || !TEST_ptr_null(md2 = EVP_MD_fetch(ctx, "SHA2-256", NULL))
+            || !TEST_true(EVP_set_default_properties(ctx, NULL))
+            || !TEST_true(OSSL_LIB_CTX_freeze(ctx, NULL)))
+        goto err;
+
+    /* And so must unloading the provider */
+    EVP_MD_free(md1);
+    md1 = NULL;
+    OSSL_PROVIDER_unload(deflt);
+    deflt = NULL;
+    ERR_set_mark();
+    md1 = EVP_MD_fetch(ctx, "SHA2-256", NULL);
+    ERR_pop_to_mark();
+    if (!TEST_ptr_null(md1))
+        goto err;
+
+    ok = 1;
+ err:
+    EVP_MD_free(md1);
+    EVP_MD_free(md2);
+    EVP_CIPHER_free(cipher);
+    OSSL_PROVIDER_unload(deflt);
+    OSSL_LIB_CTX_free(ctx);
+    return ok;
+}
+
 static int test_d2i_PrivateKey_ex(int testid)
 {
     int ok = 0;
@@ -1373,6 +1436,7 @@ int setup_tests(void)
     ADD_TEST(test_evp_md_ctx_dup);
     ADD_TEST(test_evp_md_ctx_copy);
     ADD_ALL_TESTS(test_provider_unload_effective, 2);
+    ADD_TEST(test_lib_ctx_freeze);
 #if !defined OPENSSL_NO_DES && !defined OPENSSL_NO_MD5
     ADD_TEST(test_evp_pbe_alg_add);
 #endif
@@ -421,6 +421,63 @@ static int test_duplicate_md_ctx(EVP_TEST *t, EVP_MD_CTX *mctx)
     return 1;
 }
 
+/*
+ * EVP_DigestBatch() over enough copies of the input to fill all lanes of the
+ * multi-buffer implementations, with some left over, and then over prefixes
+ * of different lengths of it.
+ */
+#define DIGEST_BATCH_NUM    9
+
+static int digest_batch_test(EVP_TEST *t, const DIGEST_DATA *expected,
+                             const EVP_TEST_BUFFER *inbuf)
+{
+    EVP_DIGEST_BATCH_ITEM items[DIGEST_BATCH_NUM];
+    unsigned char (*mds)[EVP_MAX_MD_SIZE];
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int md_len = 0, len;
+    size_t i;
+    int ret = 0;
+
+    if (!TEST_ptr(mds = OPENSSL_malloc(DIGEST_BATCH_NUM * sizeof(*mds))))
+        return 0;
+    for (i = 0; i < DIGEST_BATCH_NUM; i++) {
+        items[i].data = inbuf->buf;
+        items[i].datalen = inbuf->buflen;
+        items[i].md = mds[i];
+    }
+    if (!TEST_true(EVP_DigestBatch(items, DIGEST_BATCH_NUM, &md_len,
+                                   expected->digest, NULL))
+            || !TEST_int_eq(md_len, expected->output_len)) {
+        t->err = "DIGESTBATCH_ERROR";
+        goto err;
+    }
+    for (i = 0; i < DIGEST_BATCH_NUM; i++)
+        if (!memory_err_compare(t, "DIGESTBATCH_MISMATCH",
+                                expected->output, expected->output_len,
+                                mds[i], md_len))
+            goto err;
+
+    for (i = 0; i < DIGEST_BATCH_NUM; i++)
+        items[i].datalen = inbuf->buflen * (DIGEST_BATCH_NUM - i)
+                           / DIGEST_BATCH_NUM;
+    if (!TEST_true(EVP_DigestBatch(items, DIGEST_BATCH_NUM, NULL,
+                                   expected->digest, NULL))) {
+        t->err = "DIGESTBATCH_ERROR";
+        goto err;
+    }
+    for (i = 0; i < DIGEST_BATCH_NUM; i++) {
+        if (!TEST_true(EVP_Digest(items[i].data, items[i].datalen, md, &len,
+                                  expected->digest, NULL))
+                || !memory_err_compare(t, "DIGESTBATCH_MISMATCH",
+                                       md, len, mds[i], md_len))
+            goto err;
+    }
+    ret = 1;
+ err:
+    OPENSSL_free(mds);
+    return ret;
+}
+
 static int digest_test_run(EVP_TEST *t)
 {
     DIGEST_DATA *expected = t->data;
@@ -518,6 +575,14 @@ static int digest_test_run(EVP_TEST *t)
         }
     }
 
+    if (sk_EVP_TEST_BUFFER_num(expected->input) == 1
+            && !xof
+            && expected->pad_type <= 0
+            && (inbuf = sk_EVP_TEST_BUFFER_value(expected->input, 0)) != NULL
+            && !inbuf->count_set
+            && !digest_batch_test(t, expected, inbuf))
+        goto err;
+
  err:
     OPENSSL_free(got);
     EVP_MD_CTX_free(mctx);
@@ -1714,6 +1779,8 @@ typedef struct pkey_data_st {
     /* Expected output */
     unsigned char *output;
     size_t output_len;
+    /* Peer key of a derivation, owned by the key list */
+    EVP_PKEY *peer;
 } PKEY_DATA;
 
 /*
@@ -1910,13 +1977,33 @@ static int verify_test_init(EVP_TEST *t, const char *name)
     return pkey_test_init(t, name, 1, EVP_PKEY_verify_init, 0);
 }
 
+/*
+ * EVP_PKEY_verify_batch() over copies of the signature must agree with
+ * EVP_PKEY_verify()
+ */
+#define VERIFY_BATCH_NUM    3
+
 static int verify_test_run(EVP_TEST *t)
 {
     PKEY_DATA *kdata = t->data;
+    EVP_PKEY_VERIFY_BATCH_ITEM items[VERIFY_BATCH_NUM];
+    int ret, bret;
+    size_t i;
 
-    if (EVP_PKEY_verify(kdata->ctx, kdata->output, kdata->output_len,
-                        kdata->input, kdata->input_len) <= 0)
+    ret = EVP_PKEY_verify(kdata->ctx, kdata->output, kdata->output_len,
+                          kdata->input, kdata->input_len) > 0;
+    for (i = 0; i < VERIFY_BATCH_NUM; i++) {
+        items[i].pkey = NULL;
+        items[i].sig = kdata->output;
+        items[i].siglen = kdata->output_len;
+        items[i].tbs = kdata->input;
+        items[i].tbslen = kdata->input_len;
+    }
+    bret = EVP_PKEY_verify_batch(kdata->ctx, items, VERIFY_BATCH_NUM) > 0;
+    if (!ret)
         t->err = "VERIFY_ERROR";
+    else if (!bret)
+        t->err = "VERIFY_BATCH_ERROR";
     return 1;
 }
 
@@ -1950,6 +2037,7 @@ static int pderive_test_parse(EVP_TEST *t,
             t->err = "DERIVE_SET_PEER_ERROR";
             return 1;
         }
+        kdata->peer = peer;
         t->err = NULL;
         return 1;
     }
@@ -2005,12 +2093,19 @@ static int pderive_test_parse(EVP_TEST *t,
     return 0;
 }
 
+/*
+ * EVP_PKEY_derive_batch() over copies of the peer must agree with
+ * EVP_PKEY_derive()
+ */
+#define DERIVE_BATCH_NUM    3
+
 static int pderive_test_run(EVP_TEST *t)
 {
     EVP_PKEY_CTX *dctx = NULL;
     PKEY_DATA *expected = t->data;
-    unsigned char *got = NULL;
-    size_t got_len;
+    EVP_PKEY_DERIVE_BATCH_ITEM items[DERIVE_BATCH_NUM];
+    unsigned char *got = NULL, *bgot = NULL;
+    size_t got_len, max_len, i;
 
     if (!TEST_ptr(dctx = EVP_PKEY_CTX_dup(expected->ctx))) {
         t->err = "DERIVE_ERROR";
@@ -2022,6 +2117,7 @@ static int pderive_test_run(EVP_TEST *t)
         t->err = "DERIVE_ERROR";
         goto err;
     }
+    max_len = got_len;
     if (!TEST_ptr(got = OPENSSL_malloc(got_len))) {
         t->err = "DERIVE_ERROR";
         goto err;
@@ -2035,9 +2131,32 @@ static int pderive_test_run(EVP_TEST *t)
                             got, got_len))
         goto err;
 
+    if (expected->peer != NULL) {
+        if (!TEST_ptr(bgot = OPENSSL_malloc(max_len * DERIVE_BATCH_NUM))) {
+            t->err = "DERIVE_ERROR";
+            goto err;
+        }
+        for (i = 0; i < DERIVE_BATCH_NUM; i++) {
+            items[i].pkey = NULL;
+            items[i].peer = expected->peer;
+            items[i].key = bgot + i * max_len;
+            items[i].keylen = max_len;
+        }
+        if (EVP_PKEY_derive_batch(dctx, items, DERIVE_BATCH_NUM) <= 0) {
+            t->err = "DERIVE_BATCH_ERROR";
+            goto err;
+        }
+        for (i = 0; i < DERIVE_BATCH_NUM; i++)
+            if (!memory_err_compare(t, "SHARED_SECRET_BATCH_MISMATCH",
+                                    expected->output, expected->output_len,
+                                    items[i].key, items[i].keylen))
+                goto err;
+    }
+
     t->err = NULL;
  err:
     OPENSSL_free(got);
+    OPENSSL_free(bgot);
     EVP_PKEY_CTX_free(dctx);
     return 1;
 }
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Internal tests for the SM4, ARIA and Camellia GFNI functions selected at
+ * run-time.  Their output is compared with the generic code over lengths
+ * on both sides of the block count below which they are not used, and
+ * through the tails of their sixteen block loops.
+ */
+
+#include <string.h>
+#include <openssl/evp.h>
+#include <openssl/core_names.h>
+#include "internal/cryptlib.h"
+#include "testutil.h"
+
+#define GFNI_TEST_MAXLEN    (4096 + 64)
+#define GFNI_TEST_TAGLEN    16
+
+static unsigned char key[32], iv[16], data[GFNI_TEST_MAXLEN];
+
+#if defined(__x86_64) || defined(__x86_64__) \
+    || defined(_M_AMD64) || defined(_M_X64)
+# define GFNI_TEST_IA32CAP
+/* GFNI is bit 40 of OPENSSL_ia32cap_P[2] and [3] taken as one word */
+# define CAP_GFNI       (1U << (40 - 32))
+
+static unsigned int saved_cap;
+
+static void cap_select(int gfni)
+{
+    OPENSSL_ia32cap_P[3] = gfni ? saved_cap : saved_cap & ~CAP_GFNI;
+}
+
+static void cap_restore(void)
+{
+    OPENSSL_ia32cap_P[3] = saved_cap;
+}
+#else
+static void cap_select(ossl_unused int gfni)
+{
+}
+
+static void cap_restore(void)
+{
+}
+#endif
+
+static const char *ciphers[] = {
+#ifndef OPENSSL_NO_SM4
+    "SM4-ECB", "SM4-CTR", "SM4-GCM",
+#endif
+#ifndef OPENSSL_NO_ARIA
+    "ARIA-128-ECB", "ARIA-256-ECB", "ARIA-128-CTR", "ARIA-192-CTR",
+    "ARIA-128-GCM", "ARIA-256-GCM",
+#endif
+#ifndef OPENSSL_NO_CAMELLIA
+    "CAMELLIA-128-ECB", "CAMELLIA-192-ECB", "CAMELLIA-256-ECB",
+    "CAMELLIA-128-CTR", "CAMELLIA-256-CTR",
+#endif
+    NULL
+};
+static const size_t lens[] = {
+    16, 17, 48, 63, 64, 65, 127, 240, 255, 256, 257, 272, 300, 512,
+    528, 1024 + 15, 4096, GFNI_TEST_MAXLEN - 1
+};
+
+/* For GCM the tag follows the |len| bytes of output */
+static int gfni_crypt(const char *name, int enc, int gcm, unsigned char *out,
+                      const unsigned char *in, size_t len)
+{
+    EVP_CIPHER *cipher = NULL;
+    EVP_CIPHER_CTX *ctx = NULL;
+    int outl = 0, tmpl = 0, ret = 0;
+
+    if (!TEST_ptr(cipher = EVP_CIPHER_fetch(NULL, name, NULL))
+            || !TEST_ptr(ctx = EVP_CIPHER_CTX_new())
+            || !TEST_true(EVP_CipherInit_ex2(ctx, cipher, key, iv, enc, NULL))
+            || !TEST_true(EVP_CIPHER_CTX_set_padding(ctx, 0))
+            || !TEST_true(EVP_CipherUpdate(ctx, out, &outl, in, (int)len)))
+        goto end;
+    if (gcm && !enc
+            && !TEST_int_gt(EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG,
+                                                GFNI_TEST_TAGLEN,
+                                                (void *)(in + len)), 0))
+        goto end;
+    if (!TEST_true(EVP_CipherFinal_ex(ctx, out + outl, &tmpl))
+            || !TEST_size_t_eq((size_t)(outl + tmpl), len))
+        goto end;
+    if (gcm && enc
+            && !TEST_int_gt(EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG,
+                                                GFNI_TEST_TAGLEN, out + len),
+                            0))
+        goto end;
+    ret = 1;
+ end:
+    EVP_CIPHER_CTX_free(ctx);
+    EVP_CIPHER_free(cipher);
+    return ret;
+}
+
+/*
+ * Encryption with and without GFNI must agree, and decryption in place
+ * with GFNI must give the plaintext back.
+ */
+static int test_gfni(int idx)
+{
+    const char *name = ciphers[idx];
+    int ecb = strstr(name, "ECB") != NULL;
+    int gcm = strstr(name, "GCM") != NULL;
+    unsigned char *ref = NULL, *buf = NULL;
+    size_t i, len, outlen;
+    int testresult = 0;
+
+    if (!TEST_ptr(ref = OPENSSL_malloc(GFNI_TEST_MAXLEN + GFNI_TEST_TAGLEN))
+            || !TEST_ptr(buf = OPENSSL_malloc(GFNI_TEST_MAXLEN
+                                              + GFNI_TEST_TAGLEN)))
+        goto end;
+
+    for (i = 0; i < OSSL_NELEM(lens); i++) {
+        /* ECB is used without padding */
+        len = ecb ? lens[i] & ~(size_t)15 : lens[i];
+        outlen = gcm ? len + GFNI_TEST_TAGLEN : len;
+        cap_select(0);
+        if (!gfni_crypt(name, 1, gcm, ref, data, len))
+            goto err;
+        cap_select(1);
+        if (!gfni_crypt(name, 1, gcm, buf, data, len)
+                || !TEST_mem_eq(ref, outlen, buf, outlen)
+                || !gfni_crypt(name, 0, gcm, buf, buf, len)
+                || !TEST_mem_eq(data, len, buf, len))
+            goto err;
+    }
+    testresult = 1;
+    goto end;
+ err:
+    TEST_info("%s, length %zu", name, len);
+ end:
+    cap_restore();
+    OPENSSL_free(ref);
+    OPENSSL_free(buf);
+    return testresult;
+}
+
+int setup_tests(void)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(key); i++)
+        key[i] = (unsigned char)(i * 7 + 1);
+    for (i = 0; i < sizeof(iv); i++)
+        iv[i] = (unsigned char)(i * 13 + 5);
+    /* The CTR counter wraps inside the first buffers */
+    memset(iv + 12, 0xff, 3);
+    for (i = 0; i < GFNI_TEST_MAXLEN; i++)
+        data[i] = (unsigned char)(i * 131 + (i >> 8));
+
+#ifdef GFNI_TEST_IA32CAP
+    OPENSSL_cpuid_setup();
+    saved_cap = OPENSSL_ia32cap_P[3];
+#endif
+    /* The list ends with NULL so that it is never empty */
+    if (OSSL_NELEM(ciphers) > 1)
+        ADD_ALL_TESTS(test_gfni, OSSL_NELEM(ciphers) - 1);
+    return 1;
+}
@@ -17,6 +17,7 @@
 #include <openssl/crypto.h>
 
 #include "internal/nelem.h"
+#include "internal/hashtable.h"
 #include "testutil.h"
 
 /*
@@ -28,6 +29,7 @@
 #endif
 
 DEFINE_LHASH_OF_EX(int);
+DEFINE_HASHTABLE_OF(int);
 
 static int int_tests[] = { 65537, 13, 1, 3, -5, 6, 7, 4, -10, -12, -14, 22, 9,
                            -17, 16, 17, -23, 35, 37, 173, 11 };
@@ -231,9 +233,236 @@ end:
     return testresult;
 }
 
+static void int_ht_doall(int *p, void *arg)
+{
+    int_doall_arg(p, arg);
+}
+
+static int int_ht_keep_positive(int *p, void *arg)
+{
+    return *p > 0;
+}
+
+static int test_int_hashtable(void)
+{
+    HASHTABLE_OF(int) *h = ossl_ht_int_new(&int_hash, &int_cmp, NULL, 0);
+    unsigned int i;
+    int testresult = 0, j, r, n_neg = 0;
+
+    if (!TEST_ptr(h))
+        goto end;
+
+    /* insert */
+    for (i = 0; i < n_int_tests; i++)
+        if (!TEST_true(ossl_ht_int_insert(h, int_tests + i))) {
+            TEST_info("hashtable int insert %d", i);
+            goto end;
+        }
+
+    /* num_items */
+    if (!TEST_size_t_eq(ossl_ht_int_num(h), n_int_tests))
+        goto end;
+
+    /* retrieve */
+    for (i = 0; i < n_int_tests; i++)
+        if (!TEST_ptr_eq(ossl_ht_int_retrieve(h, int_tests + i),
+                         int_tests + i)) {
+            TEST_info("hashtable int retrieve %d", i);
+            goto end;
+        }
+    j = 1;
+    if (!TEST_ptr_eq(ossl_ht_int_retrieve(h, &j), int_tests + 2))
+        goto end;
+    j = 999;
+    if (!TEST_ptr_null(ossl_ht_int_retrieve(h, &j)))
+        goto end;
+
+    /* replace */
+    r = 13;
+    if (!TEST_true(ossl_ht_int_insert(h, &r))
+            || !TEST_ptr_eq(ossl_ht_int_retrieve(h, int_tests + 1), &r)
+            || !TEST_size_t_eq(ossl_ht_int_num(h), n_int_tests))
+        goto end;
+
+    /* do_all */
+    memset(int_found, 0, sizeof(int_found));
+    int_not_found = 0;
+    ossl_ht_int_doall_arg(h, &int_ht_doall, int_found);
+    if (!TEST_int_eq(int_not_found, 0))
+        goto end;
+    for (i = 0; i < n_int_tests; i++)
+        if (!TEST_int_eq(int_found[i], 1)) {
+            TEST_info("hashtable int doall %d", i);
+            goto end;
+        }
+
+    /* delete */
+    j = 173;
+    if (!TEST_true(ossl_ht_int_delete(h, &j))
+            || !TEST_false(ossl_ht_int_delete(h, &j))
+            || !TEST_ptr_null(ossl_ht_int_retrieve(h, &j)))
+        goto end;
+    j = 37;
+    if (!TEST_ptr_eq(ossl_ht_int_retrieve(h, &j), int_tests + 18))
+        goto end;
+
+    /* filter */
+    for (i = 0; i < n_int_tests; i++)
+        if (int_tests[i] <= 0)
+            n_neg++;
+    if (!TEST_size_t_eq(ossl_ht_int_filter(h, &int_ht_keep_positive, NULL),
+                        n_neg)
+            || !TEST_size_t_eq(ossl_ht_int_num(h), n_int_tests - n_neg - 1))
+        goto end;
+    for (i = 0; i < n_int_tests; i++) {
+        int *p = ossl_ht_int_retrieve(h, int_tests + i);
+
+        if (int_tests[i] == 173 || int_tests[i] <= 0 ? !TEST_ptr_null(p)
+                                                      : !TEST_ptr(p)) {
+            TEST_info("hashtable int filter %d", i);
+            goto end;
+        }
+    }
+
+    /* flush */
+    ossl_ht_int_flush(h);
+    if (!TEST_size_t_eq(ossl_ht_int_num(h), 0)
+            || !TEST_ptr_null(ossl_ht_int_retrieve(h, int_tests)))
+        goto end;
+
+    testresult = 1;
+end:
+    ossl_ht_int_free(h);
+    return testresult;
+}
+
+static void int_free(int *p)
+{
+    OPENSSL_free(p);
+}
+
+static int test_hashtable_stress(void)
+{
+    HASHTABLE_OF(int) *h = ossl_ht_int_new(&stress_hash, &int_cmp, &int_free,
+                                           OSSL_HT_LOCKLESS_READS);
+    const unsigned int n = 2500000;
+    unsigned int i;
+    int testresult = 0, *p;
+
+    if (!TEST_ptr(h))
+        goto end;
+
+    /* insert */
+    for (i = 0; i < n; i++) {
+        p = OPENSSL_malloc(sizeof(i));
+        if (!TEST_ptr(p)) {
+            TEST_info("hashtable stress out of memory %d", i);
+            goto end;
+        }
+        *p = 3 * i + 1;
+        if (!TEST_true(ossl_ht_int_insert(h, p))) {
+            OPENSSL_free(p);
+            goto end;
+        }
+    }
+
+    /* num_items */
+    if (!TEST_size_t_eq(ossl_ht_int_num(h), n))
+        goto end;
+
+    /* delete in a different order */
+    for (i = 0; i < n; i++) {
+        const int j = (7 * i + 4) % n * 3 + 1;
+
+        if (!TEST_ptr(p = ossl_ht_int_retrieve(h, &j))
+                || !TEST_int_eq(*p, j)) {
+            TEST_info("hashtable stress bad value %d", i);
+            goto end;
+        }
+        if (!TEST_true(ossl_ht_int_delete(h, &j))) {
+            TEST_info("hashtable stress delete %d", i);
+            goto end;
+        }
+    }
+    if (!TEST_size_t_eq(ossl_ht_int_num(h), 0))
+        goto end;
+
+    testresult = 1;
+end:
+    ossl_ht_int_free(h);
+    return testresult;
+}
+
+static int num_freed;
+
+static void int_count_free(int *p)
+{
+    num_freed++;
+}
+
+/*
+ * With lockless reads, deleted and replaced items are released in batches
+ * instead of waiting for the readers each time, and none of them are lost.
+ * Removed items are left to the caller.
+ */
+static int test_hashtable_lockless_free(void)
+{
+    HASHTABLE_OF(int) *h = ossl_ht_int_new(&int_hash, &int_cmp,
+                                           &int_count_free,
+                                           OSSL_HT_LOCKLESS_READS);
+    static int vals[200], repl;
+    const int n = OSSL_NELEM(vals);
+    int testresult = 0, i;
+
+    num_freed = 0;
+    if (!TEST_ptr(h))
+        goto end;
+    for (i = 0; i < n; i++) {
+        vals[i] = i + 1;
+        if (!TEST_true(ossl_ht_int_insert(h, vals + i)))
+            goto end;
+    }
+
+    /* A single delete or replace doesn't release anything yet */
+    repl = vals[1];
+    if (!TEST_true(ossl_ht_int_delete(h, vals))
+            || !TEST_ptr_null(ossl_ht_int_retrieve(h, vals))
+            || !TEST_true(ossl_ht_int_insert(h, &repl))
+            || !TEST_ptr_eq(ossl_ht_int_retrieve(h, vals + 1), &repl)
+            || !TEST_int_eq(num_freed, 0))
+        goto end;
+
+    /* Many of them do */
+    for (i = 2; i < n; i++)
+        if (!TEST_true(ossl_ht_int_delete(h, vals + i)))
+            goto end;
+    if (!TEST_int_gt(num_freed, 0)
+            || !TEST_size_t_eq(ossl_ht_int_num(h), 1))
+        goto end;
+
+    /* A removed item is handed back instead of being released */
+    if (!TEST_ptr_eq(ossl_ht_int_remove(h, &repl), &repl)
+            || !TEST_ptr_null(ossl_ht_int_remove(h, &repl))
+            || !TEST_size_t_eq(ossl_ht_int_num(h), 0))
+        goto end;
+
+    ossl_ht_int_free(h);
+    h = NULL;
+    if (!TEST_int_eq(num_freed, n))
+        goto end;
+
+    testresult = 1;
+end:
+    ossl_ht_int_free(h);
+    return testresult;
+}
+
 int setup_tests(void)
 {
     ADD_TEST(test_int_lhash);
     ADD_TEST(test_stress);
+    ADD_TEST(test_int_hashtable);
+    ADD_TEST(test_hashtable_stress);
+    ADD_TEST(test_hashtable_lockless_free);
     return 1;
 }
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include "helpers/ssltestlib.h"
+#include "testutil.h"
+#include "threadstest.h"
+
+static char *cert = NULL;
+static char *privkey = NULL;
+
+#define SLAB_TEST_SIZES 8
+static const size_t test_sizes[SLAB_TEST_SIZES] = {
+    1, 16, 17, 100, 1000, 1024, 1025, 70000
+};
+
+static int slab_totals(uint64_t *allocs, uint64_t *frees, uint64_t *slabs,
+                       uint64_t *large)
+{
+    unsigned int i;
+    size_t size;
+    uint64_t a, f, s;
+
+    *allocs = *frees = *slabs = *large = 0;
+    for (i = 0; CRYPTO_slab_get_stats(i, &size, &a, &f, &s); i++) {
+        if (size == 0) {
+            *large += a;
+        } else {
+            *allocs += a;
+            *slabs += s;
+        }
+        *frees += f;
+    }
+    return i > 0;
+}
+
+static int test_slab_alloc(void)
+{
+    unsigned char *p[SLAB_TEST_SIZES];
+    uint64_t allocs, frees, slabs, large, allocs2, frees2, slabs2, large2;
+    size_t i, j;
+    int res = 0;
+
+    memset(p, 0, sizeof(p));
+    if (!TEST_true(slab_totals(&allocs, &frees, &slabs, &large))
+            || !TEST_ptr_null(CRYPTO_slab_malloc(0, OPENSSL_FILE, OPENSSL_LINE)))
+        goto err;
+
+    for (i = 0; i < SLAB_TEST_SIZES; i++) {
+        if (!TEST_ptr(p[i] = CRYPTO_slab_malloc(test_sizes[i], OPENSSL_FILE,
+                                                OPENSSL_LINE))
+                || !TEST_size_t_eq((size_t)p[i] % sizeof(void *), 0))
+            goto err;
+        memset(p[i], (int)i, test_sizes[i]);
+    }
+    for (i = 0; i < SLAB_TEST_SIZES; i++)
+        for (j = 0; j < test_sizes[i]; j++)
+            if (!TEST_uchar_eq(p[i][j], (unsigned char)i))
+                goto err;
+
+    if (!TEST_true(slab_totals(&allocs2, &frees2, &slabs2, &large2))
+            || !TEST_uint64_t_eq(allocs2 - allocs, SLAB_TEST_SIZES - 2)
+            || !TEST_uint64_t_eq(large2 - large, 2)
+            || !TEST_uint64_t_ge(slabs2, 1))
+        goto err;
+
+    /* Grow and shrink across size classes and into big blocks */
+    for (i = 0; i < SLAB_TEST_SIZES; i++) {
+        size_t n = test_sizes[i];
+        unsigned char *q;
+
+        if (!TEST_ptr(q = CRYPTO_slab_realloc(p[i], n * 3, OPENSSL_FILE,
+                                              OPENSSL_LINE)))
+            goto err;
+        p[i] = q;
+        for (j = 0; j < n; j++)
+            if (!TEST_uchar_eq(q[j], (unsigned char)i))
+                goto err;
+        memset(q, (int)i, n * 3);
+        if (!TEST_ptr(q = CRYPTO_slab_realloc(q, (n + 1) / 2, OPENSSL_FILE,
+                                              OPENSSL_LINE)))
+            goto err;
+        p[i] = q;
+        for (j = 0; j < (n + 1) / 2; j++)
+            if (!TEST_uchar_eq(q[j], (unsigned char)i))
+                goto err;
+    }
+
+    res = 1;
+ err:
+    for (i = 0; i < SLAB_TEST_SIZES; i++)
+        CRYPTO_slab_free(p[i], OPENSSL_FILE, OPENSSL_LINE);
+    if (res && (!TEST_true(slab_totals(&allocs2, &frees2, &slabs2, &large2))
+                || !TEST_uint64_t_eq(allocs2 + large2 - frees2,
+                                     allocs + large - frees)))
+        res = 0;
+    return res;
+}
+
+/*
+ * Threads pass blocks to each other through a shared array, so that blocks
+ * are regularly freed by another thread than the one that allocated them.
+ */
+#define SLAB_THREADS        4
+#define SLAB_THREAD_ROUNDS  20000
+#define SLAB_SHARED         256
+
+static CRYPTO_RWLOCK *shared_lock;
+static void *shared[SLAB_SHARED];
+static int slab_thread_ok;
+
+static void slab_thread(void)
+{
+    unsigned int seed = (unsigned int)(size_t)&seed;
+    int i;
+
+    for (i = 0; i < SLAB_THREAD_ROUNDS; i++) {
+        size_t n = 1 + (seed >> 8) % 1500, slot = (seed >> 4) % SLAB_SHARED;
+        unsigned char *p, *old;
+
+        seed = seed * 1103515245 + 12345;
+        if ((p = CRYPTO_slab_malloc(n, OPENSSL_FILE, OPENSSL_LINE)) == NULL) {
+            slab_thread_ok = 0;
+            return;
+        }
+        memset(p, 0x5a, n);
+        if (!CRYPTO_THREAD_write_lock(shared_lock)) {
+            slab_thread_ok = 0;
+            return;
+        }
+        old = shared[slot];
+        shared[slot] = p;
+        CRYPTO_THREAD_unlock(shared_lock);
+        if (old != NULL && old[0] != 0x5a)
+            slab_thread_ok = 0;
+        CRYPTO_slab_free(old, OPENSSL_FILE, OPENSSL_LINE);
+    }
+}
+
+static int test_slab_threads(void)
+{
+    thread_t t[SLAB_THREADS];
+    int i, res = 1;
+
+    if (!TEST_ptr(shared_lock = CRYPTO_THREAD_lock_new()))
+        return 0;
+    slab_thread_ok = 1;
+    for (i = 0; i < SLAB_THREADS; i++)
+        if (!TEST_true(run_thread(&t[i], slab_thread)))
+            res = 0;
+    for (i = 0; i < SLAB_THREADS; i++)
+        if (!TEST_true(wait_for_thread(t[i])))
+            res = 0;
+    for (i = 0; i < SLAB_SHARED; i++) {
+        CRYPTO_slab_free(shared[i], OPENSSL_FILE, OPENSSL_LINE);
+        shared[i] = NULL;
+    }
+    CRYPTO_THREAD_lock_free(shared_lock);
+    return res && TEST_true(slab_thread_ok);
+}
+
+/*
+ * A thread that stops with blocks in its magazine hands them back, and can
+ * go on allocating with a fresh magazine afterwards.
+ */
+static int slab_stop_ok;
+
+static void slab_stop_thread(void)
+{
+    void *p[SLAB_TEST_SIZES];
+    int round;
+    size_t i;
+
+    for (round = 0; round < 2; round++) {
+        for (i = 0; i < SLAB_TEST_SIZES; i++)
+            if ((p[i] = CRYPTO_slab_malloc(test_sizes[i], OPENSSL_FILE,
+                                           OPENSSL_LINE)) == NULL)
+                slab_stop_ok = 0;
+        for (i = 0; i < SLAB_TEST_SIZES; i++)
+            CRYPTO_slab_free(p[i], OPENSSL_FILE, OPENSSL_LINE);
+        OPENSSL_thread_stop();
+    }
+}
+
+static int test_slab_thread_stop(void)
+{
+    uint64_t allocs, frees, slabs, large, allocs2, frees2, slabs2, large2;
+    thread_t t;
+
+    slab_stop_ok = 1;
+    if (!TEST_true(slab_totals(&allocs, &frees, &slabs, &large))
+            || !TEST_true(run_thread(&t, slab_stop_thread))
+            || !TEST_true(wait_for_thread(t))
+            || !TEST_true(slab_stop_ok)
+            || !TEST_true(slab_totals(&allocs2, &frees2, &slabs2, &large2)))
+        return 0;
+
+    /* Everything the thread allocated was counted and given back */
+    return TEST_uint64_t_eq(allocs2 - allocs, 2 * (SLAB_TEST_SIZES - 2))
+        && TEST_uint64_t_eq(large2 - large, 4)
+        && TEST_uint64_t_eq(allocs2 + large2 - frees2,
+                            allocs + large - frees);
+}
+
+/*
+ * Run a number of handshakes.  The recipe runs this with and without
+ * OPENSSL_MALLOC_SLAB set, in the latter case the handshakes have to be
+ * served from slabs.
+ */
+#define SLAB_HANDSHAKES 100
+
+static int test_slab_handshakes(void)
+{
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    CRYPTO_malloc_fn malloc_fn;
+    uint64_t allocs, frees, slabs, large, allocs2, frees2, slabs2, large2;
+    int i, res = 0;
+
+    CRYPTO_get_mem_functions(&malloc_fn, NULL, NULL);
+    if (!TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                       TLS_client_method(), 0, 0,
+                                       &sctx, &cctx, cert, privkey))
+            || !TEST_true(slab_totals(&allocs, &frees, &slabs, &large)))
+        goto end;
+
+    for (i = 0; i < SLAB_HANDSHAKES; i++) {
+        if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                          NULL, NULL))
+                || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                    SSL_ERROR_NONE)))
+            goto end;
+        SSL_shutdown(clientssl);
+        SSL_shutdown(serverssl);
+        SSL_free(serverssl);
+        SSL_free(clientssl);
+        serverssl = clientssl = NULL;
+    }
+
+    if (!TEST_true(slab_totals(&allocs2, &frees2, &slabs2, &large2)))
+        goto end;
+    if (malloc_fn == CRYPTO_slab_malloc
+            && (!TEST_uint64_t_gt(allocs2, allocs + SLAB_HANDSHAKES)
+                || !TEST_uint64_t_ge(slabs2, 1)))
+        goto end;
+    res = 1;
+ end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return res;
+}
+
+OPT_TEST_DECLARE_USAGE("certfile privkeyfile\n")
+
+int setup_tests(void)
+{
+    if (!test_skip_common_options()) {
+        TEST_error("Error parsing test options\n");
+        return 0;
+    }
+
+    if (!TEST_ptr(cert = test_get_argument(0))
+            || !TEST_ptr(privkey = test_get_argument(1)))
+        return 0;
+
+    ADD_TEST(test_slab_alloc);
+    ADD_TEST(test_slab_threads);
+    ADD_TEST(test_slab_thread_stop);
+    ADD_TEST(test_slab_handshakes);
+    return 1;
+}
@@ -0,0 +1,14 @@
+#! /usr/bin/env perl
+# Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+
+use OpenSSL::Test;              # get 'plan'
+use OpenSSL::Test::Simple;
+
+setup("test_internal_sha3");
+
+simple_test("test_internal_sha3", "sha3_internal_test");
@@ -0,0 +1,22 @@
+#! /usr/bin/env perl
+# Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+#
+# Licensed under the Apache License 2.0 (the "License").  You may not use
+# this file except in compliance with the License.  You can obtain a copy
+# in the file LICENSE in the source distribution or at
+# https://www.openssl.org/source/license.html
+
+
+use OpenSSL::Test::Utils;
+use OpenSSL::Test qw/:DEFAULT srctop_file/;
+
+setup("test_ssl_ctx_template");
+
+plan skip_all => "$test_name needs TLSv1.2 and TLSv1.3 enabled"
+    if disabled("tls1_2") || disabled("tls1_3");
+
+plan tests => 1;
+
+ok(run(test(["ssl_ctx_template_test", srctop_file("apps", "server.pem"),
+             srctop_file("apps", "server.pem")])),
+   "running ssl_ctx_template_test");
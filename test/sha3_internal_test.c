@@ -0,0 +1,228 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Internal tests for the Keccak-1600 implementations selected at run-time
+ * and for the functions that process four SHA-3 states at once.
+ */
+
+#include <string.h>
+#include "internal/cryptlib.h"
+#include "internal/sha3.h"
+#include "testutil.h"
+
+#define SHA3_TEST_MAXLEN    (3 * 168 + 17)
+
+static unsigned char data[4][SHA3_TEST_MAXLEN];
+
+#if defined(__x86_64) || defined(__x86_64__) \
+    || defined(_M_AMD64) || defined(_M_X64)
+# define SHA3_TEST_IA32CAP
+/*
+ * The capability bits that each configuration clears from
+ * OPENSSL_ia32cap_P[2]: everything, AVX-512F, AVX-512F and AVX512VL, and
+ * nothing.
+ */
+# define CAP_AVX2       (1U << 5)
+# define CAP_AVX512F    (1U << 16)
+# define CAP_AVX512VL   (1U << 31)
+
+static const unsigned int cap_masks[] = {
+    CAP_AVX2 | CAP_AVX512F | CAP_AVX512VL,
+    CAP_AVX512F | CAP_AVX512VL,
+    CAP_AVX512F,
+    0
+};
+static unsigned int saved_cap;
+
+static void cap_select(int idx)
+{
+    OPENSSL_ia32cap_P[2] = saved_cap & ~cap_masks[idx];
+}
+
+static void cap_restore(void)
+{
+    OPENSSL_ia32cap_P[2] = saved_cap;
+}
+#endif
+
+static const size_t rates[] = { 168, 136, 72 };
+static const size_t lens[] = { 0, 1, 71, 72, 135, 136, 137, 168, 300,
+                               SHA3_TEST_MAXLEN };
+
+/* Absorb |len| bytes of |inp| and squeeze |outlen| bytes with rate |r| */
+static void keccak(unsigned char *out, size_t outlen,
+                   const unsigned char *inp, size_t len, size_t r)
+{
+    uint64_t A[5][5];
+    unsigned char blk[168];
+    size_t rem;
+
+    memset(A, 0, sizeof(A));
+    rem = SHA3_absorb(A, inp, len, r);
+    memset(blk, 0, r);
+    memcpy(blk, inp + len - rem, rem);
+    blk[rem] = 0x1f;
+    blk[r - 1] |= 0x80;
+    (void)SHA3_absorb(A, blk, r, r);
+    SHA3_squeeze(A, out, outlen, r);
+}
+
+#ifdef SHA3_TEST_IA32CAP
+/*
+ * Each configuration of capability bits must give the same results as the
+ * scalar code.
+ */
+static int test_sha3_dispatch(int idx)
+{
+    unsigned char ref[400], out[400];
+    size_t i, j;
+    int testresult = 0;
+
+    for (i = 0; i < OSSL_NELEM(rates); i++) {
+        for (j = 0; j < OSSL_NELEM(lens); j++) {
+            cap_select(0);
+            keccak(ref, sizeof(ref), data[0], lens[j], rates[i]);
+            cap_select(idx);
+            keccak(out, sizeof(out), data[0], lens[j], rates[i]);
+            if (!TEST_mem_eq(ref, sizeof(ref), out, sizeof(out))) {
+                TEST_info("rate %zu, length %zu", rates[i], lens[j]);
+                goto end;
+            }
+        }
+    }
+    testresult = 1;
+ end:
+    cap_restore();
+    return testresult;
+}
+#endif
+
+/*
+ * Four states fed through the x4 functions, with the data split at |split|,
+ * must give the same result as each state on its own.  SHAKE128 and SHAKE256
+ * are squeezed for more than a block.
+ */
+static int sha3_x4_check(unsigned char pad, size_t bitlen, size_t mdlen,
+                         size_t len, size_t split)
+{
+    KECCAK1600_CTX ctx[4], *pctx[4];
+    unsigned char ref[400], md[4][400], *pmd[4];
+    const unsigned char *p[4];
+    size_t i;
+
+    for (i = 0; i < 4; i++) {
+        if (!TEST_true(ossl_sha3_init(&ctx[i], pad, bitlen)))
+            return 0;
+        ctx[i].md_size = mdlen;
+        pctx[i] = &ctx[i];
+        pmd[i] = md[i];
+        p[i] = data[i];
+    }
+    if (!TEST_true(ossl_sha3_update_x4(pctx, p, split)))
+        return 0;
+    for (i = 0; i < 4; i++)
+        p[i] = data[i] + split;
+    if (!TEST_true(ossl_sha3_update_x4(pctx, p, len - split))
+            || !TEST_true(ossl_sha3_final_x4(pmd, pctx)))
+        return 0;
+
+    for (i = 0; i < 4; i++) {
+        if (!TEST_true(ossl_sha3_init(&ctx[0], pad, bitlen)))
+            return 0;
+        ctx[0].md_size = mdlen;
+        if (!TEST_true(ossl_sha3_update(&ctx[0], data[i], len))
+                || !TEST_true(ossl_sha3_final(ref, &ctx[0]))
+                || !TEST_mem_eq(ref, mdlen, md[i], mdlen)) {
+            TEST_info("state %zu, length %zu, split at %zu", i, len, split);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Test 0: SHA3-256
+ * Test 1: SHA3-512
+ * Test 2: SHAKE128 with 400 bytes of output
+ * Test 3: SHAKE256 with 300 bytes of output
+ */
+static int test_sha3_x4(int idx)
+{
+    static const struct {
+        unsigned char pad;
+        size_t bitlen, mdlen;
+    } params[] = {
+        { '\x06', 256, 32 },
+        { '\x06', 512, 64 },
+        { '\x1f', 128, 400 },
+        { '\x1f', 256, 300 }
+    };
+    size_t j, splits[3];
+    int k;
+
+    for (j = 0; j < OSSL_NELEM(lens); j++) {
+        splits[0] = 0;
+        splits[1] = lens[j] / 3;
+        splits[2] = lens[j];
+        for (k = 0; k < 3; k++)
+            if (!sha3_x4_check(params[idx].pad, params[idx].bitlen,
+                               params[idx].mdlen, lens[j], splits[k]))
+                return 0;
+    }
+    return 1;
+}
+
+/* Contexts at different points are processed one by one */
+static int test_sha3_x4_mixed(void)
+{
+    KECCAK1600_CTX ctx[4], *pctx[4];
+    unsigned char ref[32], md[4][32], *pmd[4];
+    const unsigned char *p[4];
+    size_t i;
+
+    for (i = 0; i < 4; i++) {
+        if (!TEST_true(ossl_sha3_init(&ctx[i], '\x06', 256))
+                || !TEST_true(ossl_sha3_update(&ctx[i], data[i], i)))
+            return 0;
+        pctx[i] = &ctx[i];
+        pmd[i] = md[i];
+        p[i] = data[i] + i;
+    }
+    if (!TEST_true(ossl_sha3_update_x4(pctx, p, 200))
+            || !TEST_true(ossl_sha3_final_x4(pmd, pctx)))
+        return 0;
+
+    for (i = 0; i < 4; i++) {
+        if (!TEST_true(ossl_sha3_init(&ctx[0], '\x06', 256))
+                || !TEST_true(ossl_sha3_update(&ctx[0], data[i], i + 200))
+                || !TEST_true(ossl_sha3_final(ref, &ctx[0]))
+                || !TEST_mem_eq(ref, sizeof(ref), md[i], sizeof(md[i])))
+            return 0;
+    }
+    return 1;
+}
+
+int setup_tests(void)
+{
+    size_t i, j;
+
+    for (i = 0; i < 4; i++)
+        for (j = 0; j < SHA3_TEST_MAXLEN; j++)
+            data[i][j] = (unsigned char)(i * 131 + j * 7 + (j >> 8));
+
+#ifdef SHA3_TEST_IA32CAP
+    OPENSSL_cpuid_setup();
+    saved_cap = OPENSSL_ia32cap_P[2];
+    ADD_ALL_TESTS(test_sha3_dispatch, OSSL_NELEM(cap_masks));
+#endif
+    ADD_ALL_TESTS(test_sha3_x4, 4);
+    ADD_TEST(test_sha3_x4_mixed);
+    return 1;
+}
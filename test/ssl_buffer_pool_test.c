@@ -0,0 +1,197 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include "helpers/ssltestlib.h"
+#include "testutil.h"
+#include "../ssl/ssl_local.h"
+
+static char *cert = NULL;
+static char *privkey = NULL;
+
+#define MAX_IDLE    16
+
+/* Send a short message each way so that both sides read and write a record */
+static int exchange(SSL *clientssl, SSL *serverssl)
+{
+    static const char msg[] = "ping";
+    char buf[sizeof(msg)];
+    size_t n;
+
+    return TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &n))
+        && TEST_true(SSL_read_ex(serverssl, buf, sizeof(buf), &n))
+        && TEST_true(SSL_write_ex(serverssl, msg, sizeof(msg), &n))
+        && TEST_true(SSL_read_ex(clientssl, buf, sizeof(buf), &n))
+        && TEST_mem_eq(buf, n, msg, sizeof(msg));
+}
+
+static int check_idle_pool(SSL_CTX *ctx)
+{
+    size_t in_use, idle, peak;
+
+    if (!TEST_true(SSL_CTX_get_buffer_pool_stats(ctx, &in_use, &idle, &peak)))
+        return 0;
+    return TEST_size_t_eq(in_use, 0)
+        && TEST_size_t_gt(idle, 0)
+        && TEST_size_t_le(idle, MAX_IDLE)
+        && TEST_size_t_gt(peak, 0);
+}
+
+/*
+ * Connections only hold pool buffers while they read or write, and the pool
+ * keeps working for connections that outlive it in their SSL_CTX.
+ */
+static int test_buffer_pool_borrow(int idx)
+{
+    static const int versions[] = { TLS1_2_VERSION, TLS1_3_VERSION };
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    int testresult = 0;
+
+    if (!TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                       TLS_client_method(), versions[idx],
+                                       versions[idx], &sctx, &cctx, cert,
+                                       privkey))
+            || !TEST_false(SSL_CTX_get_buffer_pool_stats(sctx, NULL, NULL,
+                                                         NULL))
+            || !TEST_true(SSL_CTX_set_buffer_pool(sctx, MAX_IDLE))
+            || !TEST_true(SSL_CTX_set_buffer_pool(cctx, MAX_IDLE))
+            || !TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                             NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                SSL_ERROR_NONE))
+            || !exchange(clientssl, serverssl)
+            || !check_idle_pool(sctx)
+            || !check_idle_pool(cctx))
+        goto end;
+
+    /* Existing connections keep the pool they were created with */
+    if (!TEST_true(SSL_CTX_set_buffer_pool(sctx, 0))
+            || !TEST_false(SSL_CTX_get_buffer_pool_stats(sctx, NULL, NULL,
+                                                         NULL))
+            || !exchange(clientssl, serverssl))
+        goto end;
+
+    testresult = 1;
+ end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+/*
+ * A buffer given back to the pool is cleansed before the next borrower
+ * gets it, apart from the link to the next idle buffer.
+ */
+static int test_buffer_pool_cleanse(void)
+{
+    SSL_CTX *ctx = NULL;
+    SSL_BUFFER_POOL *pool = NULL;
+    unsigned char *buf = NULL, *again;
+    size_t i;
+    int testresult = 0;
+
+    if (!TEST_ptr(ctx = SSL_CTX_new(TLS_method()))
+            || !TEST_true(SSL_CTX_set_buffer_pool(ctx, MAX_IDLE))
+            || !TEST_ptr(pool = ossl_ssl_buffer_pool_get(ctx))
+            || !TEST_ptr(buf = ossl_ssl_buffer_pool_alloc(pool,
+                                                          SSL3_RT_MAX_PACKET_SIZE)))
+        goto end;
+    memset(buf, 0xaa, SSL3_RT_MAX_PACKET_SIZE);
+    ossl_ssl_buffer_pool_release(pool, buf);
+
+    /* The idle buffer is handed out again */
+    if (!TEST_ptr(again = ossl_ssl_buffer_pool_alloc(pool,
+                                                     SSL3_RT_MAX_PACKET_SIZE))
+            || !TEST_ptr_eq(again, buf))
+        goto end;
+    for (i = sizeof(void *); i < SSL3_RT_MAX_PACKET_SIZE; i++)
+        if (!TEST_uchar_eq(buf[i], 0)) {
+            TEST_note("at offset %zu", i);
+            goto end;
+        }
+
+    testresult = 1;
+ end:
+    if (buf != NULL)
+        ossl_ssl_buffer_pool_release(pool, buf);
+    ossl_ssl_buffer_pool_put(pool);
+    SSL_CTX_free(ctx);
+    return testresult;
+}
+
+/*
+ * No more than |max_idle| buffers are kept once given back, however many
+ * were borrowed at the same time, and requests the pool cannot serve are
+ * refused.
+ */
+static int test_buffer_pool_bounded(void)
+{
+    SSL_CTX *ctx = NULL;
+    SSL_BUFFER_POOL *pool = NULL;
+    unsigned char *bufs[2 * MAX_IDLE] = { NULL };
+    size_t in_use, idle, peak;
+    int i, testresult = 0;
+
+    if (!TEST_ptr(ctx = SSL_CTX_new(TLS_method()))
+            || !TEST_true(SSL_CTX_set_buffer_pool(ctx, MAX_IDLE))
+            || !TEST_ptr(pool = ossl_ssl_buffer_pool_get(ctx))
+            || !TEST_ptr_null(ossl_ssl_buffer_pool_alloc(pool,
+                                                         2 * SSL3_RT_MAX_PACKET_SIZE)))
+        goto end;
+    for (i = 0; i < 2 * MAX_IDLE; i++)
+        if (!TEST_ptr(bufs[i] = ossl_ssl_buffer_pool_alloc(pool, 1)))
+            goto end;
+    if (!TEST_true(SSL_CTX_get_buffer_pool_stats(ctx, &in_use, &idle, &peak))
+            || !TEST_size_t_eq(in_use, 2 * MAX_IDLE)
+            || !TEST_size_t_eq(idle, 0))
+        goto end;
+    for (i = 0; i < 2 * MAX_IDLE; i++) {
+        ossl_ssl_buffer_pool_release(pool, bufs[i]);
+        bufs[i] = NULL;
+    }
+    if (!TEST_true(SSL_CTX_get_buffer_pool_stats(ctx, &in_use, &idle, &peak))
+            || !TEST_size_t_eq(in_use, 0)
+            || !TEST_size_t_eq(idle, MAX_IDLE)
+            || !TEST_size_t_eq(peak, 2 * MAX_IDLE))
+        goto end;
+
+    testresult = 1;
+ end:
+    for (i = 0; i < 2 * MAX_IDLE; i++)
+        if (bufs[i] != NULL)
+            ossl_ssl_buffer_pool_release(pool, bufs[i]);
+    ossl_ssl_buffer_pool_put(pool);
+    SSL_CTX_free(ctx);
+    return testresult;
+}
+
+OPT_TEST_DECLARE_USAGE("certfile privkeyfile\n")
+
+int setup_tests(void)
+{
+    if (!test_skip_common_options()) {
+        TEST_error("Error parsing test options\n");
+        return 0;
+    }
+
+    if (!TEST_ptr(cert = test_get_argument(0))
+            || !TEST_ptr(privkey = test_get_argument(1)))
+        return 0;
+
+    ADD_ALL_TESTS(test_buffer_pool_borrow, 2);
+    ADD_TEST(test_buffer_pool_cleanse);
+    ADD_TEST(test_buffer_pool_bounded);
+    return 1;
+}
@@ -0,0 +1,302 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/provider.h>
+#include "internal/nelem.h"
+
+#include "helpers/ssltestlib.h"
+#include "testutil.h"
+
+static char *cert = NULL;
+static char *privkey = NULL;
+
+static const char *cipher_strings[] = {
+    "DEFAULT",
+    "HIGH:!aNULL:!MD5",
+    "ECDHE+AESGCM:ECDHE+CHACHA20:DHE+AESGCM",
+    "ALL:@STRENGTH",
+};
+
+static int cipher_lists_equal(STACK_OF(SSL_CIPHER) *a,
+                              STACK_OF(SSL_CIPHER) *b)
+{
+    int i;
+
+    if (!TEST_int_eq(sk_SSL_CIPHER_num(a), sk_SSL_CIPHER_num(b)))
+        return 0;
+    for (i = 0; i < sk_SSL_CIPHER_num(a); i++)
+        if (!TEST_ptr_eq(sk_SSL_CIPHER_value(a, i), sk_SSL_CIPHER_value(b, i)))
+            return 0;
+    return 1;
+}
+
+static int has_cipher(STACK_OF(SSL_CIPHER) *sk, const char *name)
+{
+    int i;
+
+    for (i = 0; i < sk_SSL_CIPHER_num(sk); i++)
+        if (strcmp(SSL_CIPHER_get_name(sk_SSL_CIPHER_value(sk, i)), name) == 0)
+            return 1;
+    return 0;
+}
+
+static int count_tls13(STACK_OF(SSL_CIPHER) *sk)
+{
+    int i, n = 0;
+
+    for (i = 0; i < sk_SSL_CIPHER_num(sk); i++)
+        if (strcmp(SSL_CIPHER_get_version(sk_SSL_CIPHER_value(sk, i)),
+                   "TLSv1.3") == 0)
+            n++;
+    return n;
+}
+
+/*
+ * Setting the same cipher string again gives the same list, for contexts
+ * and connections alike, independent of the TLSv1.3 ciphersuites.
+ */
+static int test_cipher_cache_repeat(int idx)
+{
+    SSL_CTX *ctx1 = NULL, *ctx2 = NULL;
+    SSL *s = NULL;
+    STACK_OF(SSL_CIPHER) *first = NULL;
+    int testresult = 0;
+
+    if (!TEST_ptr(ctx1 = SSL_CTX_new(TLS_server_method()))
+            || !TEST_ptr(ctx2 = SSL_CTX_new(TLS_client_method()))
+            || !TEST_true(SSL_CTX_set_cipher_list(ctx1, cipher_strings[idx]))
+            || !TEST_ptr(first = sk_SSL_CIPHER_dup(SSL_CTX_get_ciphers(ctx1)))
+            || !TEST_true(SSL_CTX_set_cipher_list(ctx1, cipher_strings[idx]))
+            || !cipher_lists_equal(first, SSL_CTX_get_ciphers(ctx1))
+            || !TEST_true(SSL_CTX_set_cipher_list(ctx2, cipher_strings[idx]))
+            || !cipher_lists_equal(first, SSL_CTX_get_ciphers(ctx2))
+            || !TEST_ptr(s = SSL_new(ctx2))
+            || !TEST_true(SSL_set_cipher_list(s, cipher_strings[idx]))
+            || !cipher_lists_equal(first, SSL_get_ciphers(s)))
+        goto end;
+
+    /* Only the TLSv1.3 part changes with the ciphersuites */
+    if (!TEST_true(SSL_CTX_set_ciphersuites(ctx2, "TLS_AES_128_GCM_SHA256"))
+            || !TEST_true(SSL_CTX_set_cipher_list(ctx2, cipher_strings[idx]))
+            || !TEST_int_eq(sk_SSL_CIPHER_num(SSL_CTX_get_ciphers(ctx2)) - 1,
+                            sk_SSL_CIPHER_num(first) - count_tls13(first)))
+        goto end;
+
+    testresult = 1;
+ end:
+    sk_SSL_CIPHER_free(first);
+    SSL_free(s);
+    SSL_CTX_free(ctx1);
+    SSL_CTX_free(ctx2);
+    return testresult;
+}
+
+/* A security level set by the cipher string is applied every time */
+static int test_cipher_cache_seclevel(void)
+{
+    SSL_CTX *ctx = NULL;
+    SSL *s = NULL;
+    int testresult = 0;
+
+    if (!TEST_ptr(ctx = SSL_CTX_new(TLS_method()))
+            || !TEST_true(SSL_CTX_set_cipher_list(ctx, "DEFAULT:@SECLEVEL=3"))
+            || !TEST_int_eq(SSL_CTX_get_security_level(ctx), 3)
+            || !TEST_ptr(s = SSL_new(ctx)))
+        goto end;
+
+    SSL_CTX_set_security_level(ctx, 1);
+    SSL_set_security_level(s, 1);
+    if (!TEST_true(SSL_CTX_set_cipher_list(ctx, "DEFAULT:@SECLEVEL=3"))
+            || !TEST_int_eq(SSL_CTX_get_security_level(ctx), 3)
+            || !TEST_true(SSL_set_cipher_list(s, "DEFAULT:@SECLEVEL=3"))
+            || !TEST_int_eq(SSL_get_security_level(s), 3)
+            || !TEST_false(SSL_CTX_set_cipher_list(ctx, "DEFAULT:@SECLEVEL=9"))
+            || !TEST_false(SSL_CTX_set_cipher_list(ctx, "DEFAULT:@SECLEVEL=9")))
+        goto end;
+    ERR_clear_error();
+
+    testresult = 1;
+ end:
+    SSL_free(s);
+    SSL_CTX_free(ctx);
+    return testresult;
+}
+
+/*
+ * The shared cipher is taken from the preference list of the client, or of
+ * the server if it asks for that.
+ */
+static int test_cipher_choose(int idx)
+{
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    const char *expected;
+    int testresult = 0;
+
+    if (!TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                       TLS_client_method(), TLS1_2_VERSION,
+                                       TLS1_2_VERSION, &sctx, &cctx, cert,
+                                       privkey))
+            || !TEST_true(SSL_CTX_set_cipher_list(cctx,
+                              "ECDHE-RSA-AES128-GCM-SHA256:"
+                              "ECDHE-RSA-AES256-GCM-SHA384:AES128-SHA"))
+            || !TEST_true(SSL_CTX_set_cipher_list(sctx,
+                              "AES256-SHA:ECDHE-RSA-AES256-GCM-SHA384:"
+                              "ECDHE-RSA-AES128-GCM-SHA256")))
+        goto end;
+    if (idx == 1) {
+        SSL_CTX_set_options(sctx, SSL_OP_CIPHER_SERVER_PREFERENCE);
+        expected = "ECDHE-RSA-AES256-GCM-SHA384";
+    } else {
+        expected = "ECDHE-RSA-AES128-GCM-SHA256";
+    }
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                      NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                SSL_ERROR_NONE))
+            || !TEST_str_eq(SSL_get_cipher_name(serverssl), expected))
+        goto end;
+
+    testresult = 1;
+ end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+/*
+ * The lists from the cache are the same as those compiled afresh, for TLS
+ * and DTLS.  A rule for a cipher that doesn't exist changes nothing in the
+ * list, but makes the string one that hasn't been compiled before.
+ * Test 0 to 3: the cipher strings with TLS
+ * Test 4 to 7: the cipher strings with DTLS
+ */
+static int test_cipher_cache_uncached(int idx)
+{
+    const SSL_METHOD *meth = TLS_method();
+    SSL_CTX *ctx = NULL, *ref = NULL;
+    const char *str = cipher_strings[idx % OSSL_NELEM(cipher_strings)];
+    char fresh[128];
+    int testresult = 0;
+
+    if (idx >= (int)OSSL_NELEM(cipher_strings)) {
+#ifdef OPENSSL_NO_DTLS
+        return TEST_skip("DTLS is disabled");
+#else
+        meth = DTLS_method();
+#endif
+    }
+    BIO_snprintf(fresh, sizeof(fresh), "%s:!NO-SUCH-CIPHER-%d", str, idx);
+
+    if (!TEST_ptr(ctx = SSL_CTX_new(meth))
+            || !TEST_ptr(ref = SSL_CTX_new(meth))
+            || !TEST_true(SSL_CTX_set_cipher_list(ctx, str))
+            || !TEST_true(SSL_CTX_set_cipher_list(ref, fresh))
+            || !cipher_lists_equal(SSL_CTX_get_ciphers(ref),
+                                   SSL_CTX_get_ciphers(ctx)))
+        goto end;
+
+    /* And with other ciphersuites */
+    if (!TEST_true(SSL_CTX_set_ciphersuites(ctx, "TLS_AES_256_GCM_SHA384"))
+            || !TEST_true(SSL_CTX_set_ciphersuites(ref,
+                                                   "TLS_AES_256_GCM_SHA384"))
+            || !TEST_true(SSL_CTX_set_cipher_list(ctx, str))
+            || !TEST_true(SSL_CTX_set_cipher_list(ref, fresh))
+            || !cipher_lists_equal(SSL_CTX_get_ciphers(ref),
+                                   SSL_CTX_get_ciphers(ctx)))
+        goto end;
+
+    testresult = 1;
+ end:
+    SSL_CTX_free(ctx);
+    SSL_CTX_free(ref);
+    return testresult;
+}
+
+/*
+ * A string compiled for one set of providers or method isn't reused for
+ * another: SEED is only there with the legacy provider, and RC4, if it is
+ * built at all, is never there for DTLS.
+ */
+static int test_cipher_cache_invalidation(void)
+{
+    static const char *str = "RC4-SHA:SEED-SHA:AES128-SHA";
+    OSSL_LIB_CTX *libctx = NULL;
+    OSSL_PROVIDER *deflt = NULL, *legacy = NULL;
+    SSL_CTX *tls = NULL, *dtls = NULL, *plain = NULL;
+    int testresult = 0;
+
+    if (!TEST_ptr(libctx = OSSL_LIB_CTX_new())
+            || !TEST_ptr(deflt = OSSL_PROVIDER_load(libctx, "default")))
+        goto end;
+    if ((legacy = OSSL_PROVIDER_load(libctx, "legacy")) == NULL) {
+        ERR_clear_error();
+        testresult = TEST_skip("no legacy provider");
+        goto end;
+    }
+
+    if (!TEST_ptr(tls = SSL_CTX_new_ex(libctx, NULL, TLS_method()))
+            || !TEST_true(SSL_CTX_set_cipher_list(tls, str)))
+        goto end;
+    if (!has_cipher(SSL_CTX_get_ciphers(tls), "SEED-SHA")) {
+        testresult = TEST_skip("SEED is not available");
+        goto end;
+    }
+    if (!TEST_ptr(plain = SSL_CTX_new(TLS_method()))
+            || !TEST_true(SSL_CTX_set_cipher_list(plain, str))
+            || !TEST_false(has_cipher(SSL_CTX_get_ciphers(plain), "SEED-SHA"))
+            || !TEST_true(has_cipher(SSL_CTX_get_ciphers(plain),
+                                     "AES128-SHA")))
+        goto end;
+#ifndef OPENSSL_NO_DTLS
+    if (!TEST_ptr(dtls = SSL_CTX_new_ex(libctx, NULL, DTLS_method()))
+            || !TEST_true(SSL_CTX_set_cipher_list(dtls, str))
+            || !TEST_false(has_cipher(SSL_CTX_get_ciphers(dtls), "RC4-SHA"))
+            || !TEST_true(has_cipher(SSL_CTX_get_ciphers(dtls), "SEED-SHA")))
+        goto end;
+#endif
+
+    testresult = 1;
+ end:
+    SSL_CTX_free(tls);
+    SSL_CTX_free(dtls);
+    SSL_CTX_free(plain);
+    OSSL_PROVIDER_unload(legacy);
+    OSSL_PROVIDER_unload(deflt);
+    OSSL_LIB_CTX_free(libctx);
+    return testresult;
+}
+
+OPT_TEST_DECLARE_USAGE("certfile privkeyfile\n")
+
+int setup_tests(void)
+{
+    if (!test_skip_common_options()) {
+        TEST_error("Error parsing test options\n");
+        return 0;
+    }
+
+    if (!TEST_ptr(cert = test_get_argument(0))
+            || !TEST_ptr(privkey = test_get_argument(1)))
+        return 0;
+
+    ADD_ALL_TESTS(test_cipher_cache_repeat, OSSL_NELEM(cipher_strings));
+    ADD_TEST(test_cipher_cache_seclevel);
+    ADD_ALL_TESTS(test_cipher_choose, 2);
+    ADD_ALL_TESTS(test_cipher_cache_uncached,
+                  2 * OSSL_NELEM(cipher_strings));
+    ADD_TEST(test_cipher_cache_invalidation);
+    return 1;
+}
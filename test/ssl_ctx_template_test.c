@@ -0,0 +1,139 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include "helpers/ssltestlib.h"
+#include "testutil.h"
+
+static char *cert = NULL;
+static char *privkey = NULL;
+
+/*
+ * Contexts created from a template work on their own, also after the
+ * template is gone, and their settings are independent of each other.
+ */
+static int test_ctx_template_handshake(int idx)
+{
+    static const int versions[] = { TLS1_2_VERSION, TLS1_3_VERSION };
+    SSL_CTX *tmpl = NULL, *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    int testresult = 0;
+
+    if (!TEST_ptr(tmpl = SSL_CTX_new_ex(NULL, NULL, TLS_method()))
+            || !TEST_ptr(sctx = SSL_CTX_new_from_template(tmpl,
+                                                          TLS_server_method()))
+            || !TEST_ptr(cctx = SSL_CTX_new_from_template(tmpl,
+                                                          TLS_client_method())))
+        goto end;
+
+    /* Restricting the template must not restrict the contexts made from it */
+    if (!TEST_true(SSL_CTX_set_cipher_list(tmpl, "AES128-SHA"))
+            || !TEST_true(SSL_CTX_set_ciphersuites(tmpl,
+                                                   "TLS_AES_128_GCM_SHA256"))
+            || !TEST_int_eq(sk_SSL_CIPHER_num(SSL_CTX_get_ciphers(tmpl)), 2)
+            || !TEST_int_gt(sk_SSL_CIPHER_num(SSL_CTX_get_ciphers(sctx)), 2))
+        goto end;
+    SSL_CTX_free(tmpl);
+    tmpl = NULL;
+
+    if (!TEST_int_eq(SSL_CTX_use_certificate_file(sctx, cert,
+                                                  SSL_FILETYPE_PEM), 1)
+            || !TEST_int_eq(SSL_CTX_use_PrivateKey_file(sctx, privkey,
+                                                        SSL_FILETYPE_PEM), 1)
+            || !TEST_true(SSL_CTX_set_min_proto_version(cctx, versions[idx]))
+            || !TEST_true(SSL_CTX_set_max_proto_version(cctx, versions[idx]))
+            || !TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                             NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                SSL_ERROR_NONE))
+            || !TEST_int_eq(SSL_version(clientssl), versions[idx]))
+        goto end;
+
+    testresult = 1;
+ end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(tmpl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+static int same_ciphers(SSL_CTX *a, SSL_CTX *b)
+{
+    STACK_OF(SSL_CIPHER) *ca = SSL_CTX_get_ciphers(a);
+    STACK_OF(SSL_CIPHER) *cb = SSL_CTX_get_ciphers(b);
+    int i;
+
+    if (!TEST_int_eq(sk_SSL_CIPHER_num(ca), sk_SSL_CIPHER_num(cb)))
+        return 0;
+    for (i = 0; i < sk_SSL_CIPHER_num(ca); i++)
+        if (!TEST_uint_eq(SSL_CIPHER_get_id(sk_SSL_CIPHER_value(ca, i)),
+                          SSL_CIPHER_get_id(sk_SSL_CIPHER_value(cb, i))))
+            return 0;
+    return 1;
+}
+
+/*
+ * Contexts created from a template, or from a context that was itself
+ * created from one, start out with the same settings as a context created
+ * with SSL_CTX_new_ex(), whatever has been changed in the template.
+ */
+static int test_ctx_template_defaults(void)
+{
+    SSL_CTX *ref = NULL, *tmpl = NULL, *ctx = NULL, *ctx2 = NULL;
+    int testresult = 0;
+
+    if (!TEST_ptr(ref = SSL_CTX_new_ex(NULL, NULL, TLS_server_method()))
+            || !TEST_ptr(tmpl = SSL_CTX_new_ex(NULL, NULL, TLS_method()))
+            || !TEST_true(SSL_CTX_set_cipher_list(tmpl, "AES128-SHA"))
+            || !TEST_true(SSL_CTX_set_min_proto_version(tmpl, TLS1_3_VERSION))
+            || !TEST_ptr(ctx = SSL_CTX_new_from_template(tmpl,
+                                                         TLS_server_method())))
+        goto end;
+    SSL_CTX_free(tmpl);
+    tmpl = NULL;
+
+    if (!TEST_ptr(ctx2 = SSL_CTX_new_from_template(ctx, TLS_server_method()))
+            || !same_ciphers(ref, ctx)
+            || !same_ciphers(ref, ctx2)
+            || !TEST_long_eq(SSL_CTX_get_min_proto_version(ctx),
+                             SSL_CTX_get_min_proto_version(ref))
+            || !TEST_uint64_t_eq(SSL_CTX_get_options(ctx),
+                                 SSL_CTX_get_options(ref)))
+        goto end;
+
+    testresult = 1;
+ end:
+    SSL_CTX_free(ref);
+    SSL_CTX_free(tmpl);
+    SSL_CTX_free(ctx);
+    SSL_CTX_free(ctx2);
+    return testresult;
+}
+
+OPT_TEST_DECLARE_USAGE("certfile privkeyfile\n")
+
+int setup_tests(void)
+{
+    if (!test_skip_common_options()) {
+        TEST_error("Error parsing test options\n");
+        return 0;
+    }
+
+    if (!TEST_ptr(cert = test_get_argument(0))
+            || !TEST_ptr(privkey = test_get_argument(1)))
+        return 0;
+
+    ADD_ALL_TESTS(test_ctx_template_handshake, 2);
+    ADD_TEST(test_ctx_template_defaults);
+    return 1;
+}
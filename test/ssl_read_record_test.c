@@ -0,0 +1,267 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/async.h>
+
+#include "helpers/ssltestlib.h"
+#include "testutil.h"
+
+static char *cert = NULL;
+static char *privkey = NULL;
+
+static unsigned char big[2 * SSL3_RT_MAX_PLAIN_LENGTH + 100];
+
+static int peek_expect(SSL *s, const unsigned char *exp, size_t explen)
+{
+    const unsigned char *data;
+    size_t len;
+
+    return TEST_true(SSL_read_peek_record(s, &data, &len))
+        && TEST_mem_eq(data, len, exp, explen);
+}
+
+/*
+ * Records are returned one at a time where they were decrypted, can be
+ * released in parts and are seen by SSL_read_ex() as well.
+ */
+static int test_read_peek_record(int idx)
+{
+    static const int versions[] = { TLS1_2_VERSION, TLS1_3_VERSION };
+    static const unsigned char first[] = "first", second[] = "second";
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    const unsigned char *data, *again;
+    unsigned char buf[sizeof(second)], *out = NULL;
+    size_t len, n, got = 0;
+    int testresult = 0;
+
+    if (!TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                       TLS_client_method(), versions[idx],
+                                       versions[idx], &sctx, &cctx, cert,
+                                       privkey))
+            || !TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                             NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                SSL_ERROR_NONE)))
+        goto end;
+
+    /* Nothing to read yet */
+    if (!TEST_false(SSL_read_peek_record(serverssl, &data, &len))
+            || !TEST_int_eq(SSL_get_error(serverssl, 0), SSL_ERROR_WANT_READ)
+            || !TEST_true(SSL_read_release(serverssl, 0)))
+        goto end;
+
+    if (!TEST_true(SSL_write_ex(clientssl, first, sizeof(first), &n))
+            || !TEST_true(SSL_write_ex(clientssl, second, sizeof(second), &n))
+            || !TEST_true(SSL_write_ex(clientssl, big, sizeof(big), &n)))
+        goto end;
+
+    /* The same data is returned until it is released, one record at a time */
+    if (!TEST_true(SSL_read_peek_record(serverssl, &data, &len))
+            || !TEST_mem_eq(data, len, first, sizeof(first))
+            || !TEST_true(SSL_read_peek_record(serverssl, &again, &n))
+            || !TEST_ptr_eq(again, data)
+            || !TEST_true(SSL_read_release(serverssl, 2))
+            || !peek_expect(serverssl, first + 2, sizeof(first) - 2)
+            || !TEST_false(SSL_read_release(serverssl, sizeof(first))))
+        goto end;
+    ERR_clear_error();
+    if (!TEST_true(SSL_read_release(serverssl, sizeof(first) - 2))
+            || !peek_expect(serverssl, second, sizeof(second)))
+        goto end;
+
+    /* SSL_read_ex() returns the same data */
+    if (!TEST_true(SSL_read_ex(serverssl, buf, 3, &n))
+            || !peek_expect(serverssl, second + 3, sizeof(second) - 3)
+            || !TEST_true(SSL_read_ex(serverssl, buf, sizeof(buf), &n))
+            || !TEST_mem_eq(buf, n, second + 3, sizeof(second) - 3))
+        goto end;
+
+    /* Records of the maximum length */
+    if (!TEST_ptr(out = OPENSSL_malloc(sizeof(big))))
+        goto end;
+    while (got < sizeof(big)) {
+        if (!TEST_true(SSL_read_peek_record(serverssl, &data, &len))
+                || !TEST_size_t_le(len, SSL3_RT_MAX_PLAIN_LENGTH)
+                || !TEST_size_t_le(len, sizeof(big) - got))
+            goto end;
+        memcpy(out + got, data, len);
+        got += len;
+        if (!TEST_true(SSL_read_release(serverssl, len)))
+            goto end;
+    }
+    if (!TEST_mem_eq(out, got, big, sizeof(big))
+            || !TEST_false(SSL_read_peek_record(serverssl, &data, &len))
+            || !TEST_int_eq(SSL_get_error(serverssl, 0), SSL_ERROR_WANT_READ))
+        goto end;
+
+    /* The client deals with session tickets before the data in TLSv1.3 */
+    if (!TEST_true(SSL_write_ex(serverssl, first, sizeof(first), &n))
+            || !peek_expect(clientssl, first, sizeof(first))
+            || !TEST_true(SSL_read_release(clientssl, sizeof(first))))
+        goto end;
+
+    /* A close_notify ends the data like it does for SSL_read_ex() */
+    if (!TEST_int_eq(SSL_shutdown(clientssl), 0)
+            || !TEST_false(SSL_read_peek_record(serverssl, &data, &len))
+            || !TEST_int_eq(SSL_get_error(serverssl, 0), SSL_ERROR_ZERO_RETURN))
+        goto end;
+
+    testresult = 1;
+ end:
+    OPENSSL_free(out);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+/*
+ * A filter that pauses the async job reading through it once |pause_read| is
+ * set
+ */
+#define BIO_TYPE_PAUSE_FILTER  (0x80 | BIO_TYPE_FILTER)
+
+static BIO_METHOD *meth_pause = NULL;
+static int pause_read = 0;
+
+static int pause_filter_read(BIO *bio, char *out, int outl)
+{
+    int ret;
+
+    if (pause_read && ASYNC_get_current_job() != NULL) {
+        pause_read = 0;
+        if (!ASYNC_pause_job())
+            return -1;
+    }
+    ret = BIO_read(BIO_next(bio), out, outl);
+    BIO_clear_retry_flags(bio);
+    BIO_copy_next_retry(bio);
+    return ret;
+}
+
+static int pause_filter_write(BIO *bio, const char *in, int inl)
+{
+    int ret = BIO_write(BIO_next(bio), in, inl);
+
+    BIO_clear_retry_flags(bio);
+    BIO_copy_next_retry(bio);
+    return ret;
+}
+
+static long pause_filter_ctrl(BIO *bio, int cmd, long num, void *ptr)
+{
+    BIO *next = BIO_next(bio);
+
+    if (next == NULL || cmd == BIO_CTRL_DUP)
+        return 0;
+    return BIO_ctrl(next, cmd, num, ptr);
+}
+
+static int pause_filter_new(BIO *bio)
+{
+    BIO_set_init(bio, 1);
+    return 1;
+}
+
+static const BIO_METHOD *bio_f_pause_filter(void)
+{
+    if (meth_pause == NULL
+            && (!TEST_ptr(meth_pause = BIO_meth_new(BIO_TYPE_PAUSE_FILTER,
+                                                    "Pause filter"))
+                || !TEST_true(BIO_meth_set_write(meth_pause,
+                                                 pause_filter_write))
+                || !TEST_true(BIO_meth_set_read(meth_pause, pause_filter_read))
+                || !TEST_true(BIO_meth_set_ctrl(meth_pause, pause_filter_ctrl))
+                || !TEST_true(BIO_meth_set_create(meth_pause,
+                                                  pause_filter_new))))
+        return NULL;
+    return meth_pause;
+}
+
+/*
+ * With SSL_MODE_ASYNC a job that pauses while reading the record is resumed
+ * by calling SSL_read_peek_record() again, after the first call returned.
+ */
+static int test_read_peek_record_async(void)
+{
+    static const unsigned char msg[] = "async";
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    BIO *filter = NULL;
+    const unsigned char *data;
+    size_t len, n;
+    int testresult = 0;
+
+    if (!ASYNC_is_capable()) {
+        TEST_skip("Async jobs are not supported on this platform");
+        return 1;
+    }
+
+    if (!TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                       TLS_client_method(), TLS1_2_VERSION,
+                                       0, &sctx, &cctx, cert, privkey))
+            || !TEST_ptr(bio_f_pause_filter())
+            || !TEST_ptr(filter = BIO_new(bio_f_pause_filter())))
+        goto end;
+    /* The filter is freed with the connection, or on failure */
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                      NULL, filter))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                SSL_ERROR_NONE)))
+        goto end;
+    SSL_set_mode(serverssl, SSL_MODE_ASYNC);
+
+    if (!TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &n)))
+        goto end;
+    pause_read = 1;
+    if (!TEST_false(SSL_read_peek_record(serverssl, &data, &len))
+            || !TEST_int_eq(SSL_get_error(serverssl, 0), SSL_ERROR_WANT_ASYNC)
+            || !TEST_true(SSL_read_peek_record(serverssl, &data, &len))
+            || !TEST_mem_eq(data, len, msg, sizeof(msg))
+            || !TEST_true(SSL_read_release(serverssl, len)))
+        goto end;
+
+    testresult = 1;
+ end:
+    pause_read = 0;
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+OPT_TEST_DECLARE_USAGE("certfile privkeyfile\n")
+
+int setup_tests(void)
+{
+    if (!test_skip_common_options()) {
+        TEST_error("Error parsing test options\n");
+        return 0;
+    }
+
+    if (!TEST_ptr(cert = test_get_argument(0))
+            || !TEST_ptr(privkey = test_get_argument(1)))
+        return 0;
+
+    memset(big, 'x', sizeof(big));
+    ADD_ALL_TESTS(test_read_peek_record, 2);
+    ADD_TEST(test_read_peek_record_async);
+    return 1;
+}
+
+void cleanup_tests(void)
+{
+    BIO_meth_free(meth_pause);
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include "helpers/ssltestlib.h"
+#include "testutil.h"
+#include "threadstest.h"
+
+static char *cert = NULL;
+static char *privkey = NULL;
+
+/*
+ * Several threads resume sessions from the internal cache of a shared
+ * server SSL_CTX, with the cache in a single shard and split into several.
+ * Every connection has to be resumed.
+ */
+#define SESS_THREADS    4
+#define SESS_SESSIONS   64
+#define SESS_RESUMES    100
+
+static SSL_CTX *sctx = NULL, *cctx = NULL;
+static SSL_SESSION *sessions[SESS_SESSIONS];
+static int resume_ok;
+
+/*
+ * Connect, resuming |sess| if it isn't NULL.  Otherwise a reference to
+ * the new session is stored in |*new_sess|.
+ */
+static int do_connection(SSL_SESSION *sess, SSL_SESSION **new_sess)
+{
+    SSL *serverssl = NULL, *clientssl = NULL;
+    int ret = 0;
+
+    if (!create_ssl_objects(sctx, cctx, &serverssl, &clientssl, NULL, NULL)
+            || (sess != NULL && !SSL_set_session(clientssl, sess))
+            || !create_ssl_connection(serverssl, clientssl, SSL_ERROR_NONE))
+        goto end;
+
+    if (sess != NULL)
+        ret = SSL_session_reused(clientssl);
+    else
+        ret = (*new_sess = SSL_get1_session(clientssl)) != NULL;
+    SSL_shutdown(clientssl);
+    SSL_shutdown(serverssl);
+ end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    return ret;
+}
+
+static void resume_thread(void)
+{
+    unsigned int seed = (unsigned int)(size_t)&seed;
+    int i;
+
+    for (i = 0; i < SESS_RESUMES; i++) {
+        seed = seed * 1103515245 + 12345;
+        if (!do_connection(sessions[(seed >> 8) % SESS_SESSIONS], NULL))
+            resume_ok = 0;
+    }
+}
+
+static int test_sess_cache_resumption(int idx)
+{
+    static const long shards[] = { 1, 16 };
+    thread_t t[SESS_THREADS];
+    int i, res = 0;
+
+    memset(sessions, 0, sizeof(sessions));
+    if (!TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                       TLS_client_method(), TLS1_2_VERSION,
+                                       TLS1_2_VERSION, &sctx, &cctx, cert,
+                                       privkey))
+            || !TEST_long_eq(SSL_CTX_sess_set_cache_shards(sctx, shards[idx]),
+                             1))
+        goto end;
+    /* Resume by session ID, so that the server cache is used */
+    SSL_CTX_set_options(sctx, SSL_OP_NO_TICKET);
+
+    for (i = 0; i < SESS_SESSIONS; i++)
+        if (!TEST_true(do_connection(NULL, &sessions[i])))
+            goto end;
+    if (!TEST_long_eq(SSL_CTX_sess_number(sctx), SESS_SESSIONS))
+        goto end;
+
+    resume_ok = 1;
+    for (i = 0; i < SESS_THREADS; i++)
+        if (!TEST_true(run_thread(&t[i], resume_thread)))
+            goto end;
+    for (i = 0; i < SESS_THREADS; i++)
+        if (!TEST_true(wait_for_thread(t[i])))
+            goto end;
+
+    if (!TEST_true(resume_ok)
+            || !TEST_long_eq(SSL_CTX_sess_hits(sctx),
+                             SESS_THREADS * SESS_RESUMES))
+        goto end;
+    res = 1;
+ end:
+    for (i = 0; i < SESS_SESSIONS; i++)
+        SSL_SESSION_free(sessions[i]);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    sctx = cctx = NULL;
+    return res;
+}
+
+OPT_TEST_DECLARE_USAGE("certfile privkeyfile\n")
+
+int setup_tests(void)
+{
+    if (!test_skip_common_options()) {
+        TEST_error("Error parsing test options\n");
+        return 0;
+    }
+
+    if (!TEST_ptr(cert = test_get_argument(0))
+            || !TEST_ptr(privkey = test_get_argument(1)))
+        return 0;
+
+    ADD_ALL_TESTS(test_sess_cache_resumption, 2);
+    return 1;
+}
@@ -0,0 +1,338 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include "../ssl/ssl_local.h"
+
+#include "helpers/ssltestlib.h"
+#include "testutil.h"
+
+#if defined(OPENSSL_SYS_UNIX) && !defined(OPENSSL_SYS_VMS)
+# include <sys/types.h>
+# include <sys/wait.h>
+# include <unistd.h>
+# define SHM_TEST_FORK
+#endif
+
+static char *cert = NULL;
+static char *privkey = NULL;
+
+#ifdef SHM_TEST_FORK
+
+/*
+ * One forked process does full handshakes and hands the client sessions
+ * back through a pipe.  Then several freshly forked processes, none of
+ * which has the sessions in its internal cache, all try to resume every one
+ * of them and report how many were resumed.
+ */
+# define SHM_WORKERS    4
+# define SHM_SESSIONS   32
+
+static SSL_CTX *sctx = NULL, *cctx = NULL;
+static SSL_SESSION *sessions[SHM_SESSIONS];
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+    const unsigned char *p = buf;
+    ssize_t n;
+
+    while (len > 0) {
+        if ((n = write(fd, p, len)) <= 0)
+            return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static int read_all(int fd, void *buf, size_t len)
+{
+    unsigned char *p = buf;
+    ssize_t n;
+
+    while (len > 0) {
+        if ((n = read(fd, p, len)) <= 0)
+            return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+/*
+ * Connect, resuming |sess| if it isn't NULL.  Returns the new session if
+ * |sess| is NULL, or else |sess| if it was resumed.
+ */
+static SSL_SESSION *do_connection(SSL_SESSION *sess)
+{
+    SSL *serverssl = NULL, *clientssl = NULL;
+    SSL_SESSION *ret = NULL;
+
+    if (!create_ssl_objects(sctx, cctx, &serverssl, &clientssl, NULL, NULL)
+            || (sess != NULL && !SSL_set_session(clientssl, sess))
+            || !create_ssl_connection(serverssl, clientssl, SSL_ERROR_NONE))
+        goto end;
+
+    if (sess == NULL)
+        ret = SSL_get1_session(clientssl);
+    else if (SSL_session_reused(clientssl))
+        ret = sess;
+    SSL_shutdown(clientssl);
+    SSL_shutdown(serverssl);
+ end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    return ret;
+}
+
+static void make_sessions(int fd)
+{
+    SSL_SESSION *sess;
+    unsigned char *der;
+    int i, len, ok = 1;
+
+    for (i = 0; ok && i < SHM_SESSIONS; i++) {
+        der = NULL;
+        ok = (sess = do_connection(NULL)) != NULL
+             && (len = i2d_SSL_SESSION(sess, &der)) > 0
+             && write_all(fd, &len, sizeof(len))
+             && write_all(fd, der, len);
+        OPENSSL_free(der);
+        SSL_SESSION_free(sess);
+    }
+    _exit(ok ? 0 : 1);
+}
+
+static void resume_sessions(int fd)
+{
+    unsigned int resumed = 0;
+    int i;
+
+    for (i = 0; i < SHM_SESSIONS; i++)
+        if (do_connection(sessions[i]) != NULL)
+            resumed++;
+    _exit(write_all(fd, &resumed, sizeof(resumed)) ? 0 : 1);
+}
+
+static int wait_ok(pid_t pid)
+{
+    int status;
+
+    return TEST_int_eq(waitpid(pid, &status, 0), pid)
+           && TEST_true(WIFEXITED(status))
+           && TEST_int_eq(WEXITSTATUS(status), 0);
+}
+
+/*
+ * Test 0: with the shared memory cache every session is resumed
+ * Test 1: without it none of them can be
+ */
+static int test_shm_resumption(int idx)
+{
+    unsigned int res[SHM_WORKERS];
+    const unsigned char *p;
+    unsigned char *der = NULL;
+    int i, len, fds[2] = { -1, -1 };
+    unsigned int resumed = 0;
+    pid_t pid, workers[SHM_WORKERS];
+    int testresult = 0;
+
+    memset(sessions, 0, sizeof(sessions));
+    if (!TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                       TLS_client_method(), TLS1_2_VERSION,
+                                       TLS1_2_VERSION, &sctx, &cctx, cert,
+                                       privkey)))
+        goto end;
+    /* Resume by session ID, so that the server cache is used */
+    SSL_CTX_set_options(sctx, SSL_OP_NO_TICKET);
+    if (idx == 0 && !SSL_CTX_set_session_cache_shm(sctx, 1024)) {
+        testresult = TEST_skip("no shared memory session cache");
+        goto end;
+    }
+
+    if (!TEST_int_eq(pipe(fds), 0)
+            || !TEST_int_ge(pid = fork(), 0))
+        goto end;
+    if (pid == 0)
+        make_sessions(fds[1]);
+    for (i = 0; i < SHM_SESSIONS; i++) {
+        if (!TEST_true(read_all(fds[0], &len, sizeof(len)))
+                || !TEST_int_gt(len, 0)
+                || !TEST_ptr(der = OPENSSL_malloc(len))
+                || !TEST_true(read_all(fds[0], der, len)))
+            goto end;
+        p = der;
+        if (!TEST_ptr(sessions[i] = d2i_SSL_SESSION(NULL, &p, len)))
+            goto end;
+        OPENSSL_free(der);
+        der = NULL;
+    }
+    if (!wait_ok(pid)
+            || !TEST_long_eq(SSL_CTX_sess_number(sctx), 0))
+        goto end;
+
+    for (i = 0; i < SHM_WORKERS; i++) {
+        if (!TEST_int_ge(workers[i] = fork(), 0))
+            goto end;
+        if (workers[i] == 0)
+            resume_sessions(fds[1]);
+    }
+    for (i = 0; i < SHM_WORKERS; i++)
+        if (!TEST_true(read_all(fds[0], &res[i], sizeof(res[i]))))
+            goto end;
+    for (i = 0; i < SHM_WORKERS; i++)
+        if (!wait_ok(workers[i]))
+            goto end;
+    for (i = 0; i < SHM_WORKERS; i++)
+        resumed += res[i];
+    if (!TEST_uint_eq(resumed, idx == 0 ? SHM_WORKERS * SHM_SESSIONS : 0))
+        goto end;
+
+    testresult = 1;
+ end:
+    if (fds[0] >= 0)
+        close(fds[0]);
+    if (fds[1] >= 0)
+        close(fds[1]);
+    OPENSSL_free(der);
+    for (i = 0; i < SHM_SESSIONS; i++)
+        SSL_SESSION_free(sessions[i]);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    sctx = cctx = NULL;
+    return testresult;
+}
+
+/* Sessions are only found for the protocol version they were made with */
+static int test_shm_version(void)
+{
+    SSL_SESSION *sess = NULL, *got = NULL;
+    const unsigned char *id;
+    unsigned int id_len;
+    int testresult = 0;
+
+    if (!TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                       TLS_client_method(), TLS1_2_VERSION,
+                                       TLS1_2_VERSION, &sctx, &cctx, cert,
+                                       privkey)))
+        goto end;
+    SSL_CTX_set_options(sctx, SSL_OP_NO_TICKET);
+    if (!SSL_CTX_set_session_cache_shm(sctx, 1024)) {
+        testresult = TEST_skip("no shared memory session cache");
+        goto end;
+    }
+    if (!TEST_ptr(sess = do_connection(NULL)))
+        goto end;
+    id = SSL_SESSION_get_id(sess, &id_len);
+    if (!TEST_ptr_null(ossl_ssl_sess_shm_get(sctx, TLS1_1_VERSION, id,
+                                             id_len))
+            || !TEST_ptr(got = ossl_ssl_sess_shm_get(sctx, TLS1_2_VERSION, id,
+                                                     id_len)))
+        goto end;
+
+    testresult = 1;
+ end:
+    SSL_SESSION_free(got);
+    SSL_SESSION_free(sess);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    sctx = cctx = NULL;
+    return testresult;
+}
+
+# ifndef OPENSSL_NO_UNIT_TEST
+/*
+ * A process that dies while holding a bucket lock must not wedge the cache:
+ * the next user of the bucket gets the lock, finds the bucket emptied and
+ * can use it again.  The lock is taken with a hook that is only there in
+ * builds with enable-unit-test.
+ */
+static int test_shm_owner_died(void)
+{
+    SSL_SESSION *sess = NULL, *got = NULL;
+    const unsigned char *id;
+    unsigned int id_len;
+    int version;
+    pid_t pid;
+    int testresult = 0;
+
+    if (!TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                       TLS_client_method(), TLS1_2_VERSION,
+                                       TLS1_2_VERSION, &sctx, &cctx, cert,
+                                       privkey)))
+        goto end;
+    SSL_CTX_set_options(sctx, SSL_OP_NO_TICKET);
+    if (!SSL_CTX_set_session_cache_shm(sctx, 1024)) {
+        testresult = TEST_skip("no shared memory session cache");
+        goto end;
+    }
+    if (!TEST_ptr(sess = do_connection(NULL)))
+        goto end;
+    id = SSL_SESSION_get_id(sess, &id_len);
+    version = SSL_SESSION_get_protocol_version(sess);
+    if (!TEST_ptr(got = ossl_ssl_sess_shm_get(sctx, version, id, id_len)))
+        goto end;
+    SSL_SESSION_free(got);
+    got = NULL;
+
+    if (!TEST_int_ge(pid = fork(), 0))
+        goto end;
+    if (pid == 0)
+        _exit(ossl_ssl_sess_shm_lock_id(sctx, id, id_len) ? 0 : 1);
+    if (!wait_ok(pid))
+        goto end;
+
+    /* Should the lock never be recovered, SIGALRM fails the test */
+    alarm(30);
+    got = ossl_ssl_sess_shm_get(sctx, version, id, id_len);
+    alarm(0);
+    if (!TEST_ptr_null(got)
+            || !TEST_true(ossl_ssl_sess_shm_add(sctx, sess))
+            || !TEST_ptr(got = ossl_ssl_sess_shm_get(sctx, version, id,
+                                                     id_len)))
+        goto end;
+
+    testresult = 1;
+ end:
+    SSL_SESSION_free(got);
+    SSL_SESSION_free(sess);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    sctx = cctx = NULL;
+    return testresult;
+}
+
+# endif
+
+#endif
+
+OPT_TEST_DECLARE_USAGE("certfile privkeyfile\n")
+
+int setup_tests(void)
+{
+    if (!test_skip_common_options()) {
+        TEST_error("Error parsing test options\n");
+        return 0;
+    }
+
+    if (!TEST_ptr(cert = test_get_argument(0))
+            || !TEST_ptr(privkey = test_get_argument(1)))
+        return 0;
+
+#ifdef SHM_TEST_FORK
+    ADD_ALL_TESTS(test_shm_resumption, 2);
+    ADD_TEST(test_shm_version);
+# ifndef OPENSSL_NO_UNIT_TEST
+    ADD_TEST(test_shm_owner_died);
+# endif
+#endif
+    return 1;
+}
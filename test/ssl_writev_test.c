@@ -0,0 +1,338 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include "helpers/ssltestlib.h"
+#include "testutil.h"
+
+static char *cert = NULL;
+static char *privkey = NULL;
+
+#define BODY_LEN    60000
+/*
+ * More than the records that the record layer fills from several buffers in
+ * two goes, which is what a retried write sends with partial writes enabled
+ */
+#define PARTIAL_LEN (5 * BODY_LEN)
+
+static const struct {
+    int version;
+    const char *ciphers;
+    int no_etm;
+} configs[] = {
+    { TLS1_3_VERSION, NULL, 0 },
+    { TLS1_2_VERSION, NULL, 0 },
+    { TLS1_2_VERSION, "AES128-SHA", 0 },
+    { TLS1_2_VERSION, "AES128-SHA", 1 },
+};
+
+static size_t records, bio_writes;
+static int fail_next_write;
+
+/* Count the records the server receives */
+static void count_records(int write_p, int version, int content_type,
+                          const void *buf, size_t len, SSL *ssl, void *arg)
+{
+    if (!write_p && content_type == SSL3_RT_HEADER)
+        records++;
+}
+
+/* Count the writes of the client to its BIO */
+static long count_writes(BIO *b, int oper, const char *argp, size_t len,
+                         int argi, long argl, int ret, size_t *processed)
+{
+    if (oper == BIO_CB_WRITE) {
+        if (fail_next_write) {
+            fail_next_write = 0;
+            BIO_set_retry_write(b);
+            return -1;
+        }
+        bio_writes++;
+    }
+    return ret;
+}
+
+static int make_connection(int idx, SSL_CTX **sctx, SSL_CTX **cctx,
+                           SSL **serverssl, SSL **clientssl)
+{
+    if (!TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                       TLS_client_method(),
+                                       configs[idx].version,
+                                       configs[idx].version, sctx, cctx, cert,
+                                       privkey))
+            || (configs[idx].ciphers != NULL
+                && !TEST_true(SSL_CTX_set_cipher_list(*cctx,
+                                                      configs[idx].ciphers)))
+            || (configs[idx].no_etm
+                && !SSL_CTX_set_options(*cctx, SSL_OP_NO_ENCRYPT_THEN_MAC))
+            || !TEST_true(create_ssl_objects(*sctx, *cctx, serverssl,
+                                             clientssl, NULL, NULL)))
+        return 0;
+
+    SSL_set_msg_callback(*serverssl, count_records);
+    if (!TEST_true(create_ssl_connection(*serverssl, *clientssl,
+                                         SSL_ERROR_NONE)))
+        return 0;
+    BIO_set_callback_ex(SSL_get_wbio(*clientssl), count_writes);
+    return 1;
+}
+
+static int read_all(SSL *s, unsigned char *buf, size_t len)
+{
+    size_t got, n;
+
+    for (got = 0; got < len; got += n)
+        if (!TEST_true(SSL_read_ex(s, buf + got, len - got, &n)))
+            return 0;
+    return 1;
+}
+
+/* Drop the first |n| bytes from the |*iovcnt| buffers at |*iov| */
+static void iov_consume(SSL_IOVEC **iov, size_t *iovcnt, size_t n)
+{
+    while (*iovcnt > 0 && n >= (*iov)->data_len) {
+        n -= (*iov)->data_len;
+        (*iov)++;
+        (*iovcnt)--;
+    }
+    if (n > 0) {
+        (*iov)->data = (const unsigned char *)(*iov)->data + n;
+        (*iov)->data_len -= n;
+    }
+}
+
+/*
+ * Records are filled across buffer boundaries, all of them are sent in a
+ * single write, and an interrupted write is completed on retry.
+ */
+static int test_writev(int idx)
+{
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    unsigned char *data = NULL, *out = NULL;
+    SSL_IOVEC iov[40];
+    size_t total = 0, written, i;
+    int testresult = 0;
+
+    if (!make_connection(idx, &sctx, &cctx, &serverssl, &clientssl)
+            || !TEST_ptr(data = OPENSSL_malloc(BODY_LEN))
+            || !TEST_ptr(out = OPENSSL_malloc(BODY_LEN)))
+        goto end;
+    for (i = 0; i < BODY_LEN; i++)
+        data[i] = (unsigned char)(i * 7 + i / 251);
+
+    /* A small header, an empty buffer and a large body */
+    iov[0].data = data;
+    iov[0].data_len = 100;
+    iov[1].data = NULL;
+    iov[1].data_len = 0;
+    iov[2].data = data + 100;
+    iov[2].data_len = 40000;
+    iov[3].data = data + 40100;
+    iov[3].data_len = 10;
+    total = 40110;
+    records = bio_writes = 0;
+    if (!TEST_true(SSL_writev(clientssl, iov, 4, &written))
+            || !TEST_size_t_eq(written, total)
+            || !TEST_size_t_eq(bio_writes, 1)
+            || !read_all(serverssl, out, total)
+            || !TEST_mem_eq(out, total, data, total)
+            || !TEST_size_t_eq(records, 3))
+        goto end;
+
+    /* Many small buffers */
+    for (i = 0; i < OSSL_NELEM(iov); i++) {
+        iov[i].data = data + i * 1000;
+        iov[i].data_len = 1000;
+    }
+    total = OSSL_NELEM(iov) * 1000;
+    records = bio_writes = 0;
+    if (!TEST_true(SSL_writev(clientssl, iov, OSSL_NELEM(iov), &written))
+            || !TEST_size_t_eq(written, total)
+            || !TEST_size_t_eq(bio_writes, 1)
+            || !read_all(serverssl, out, total)
+            || !TEST_mem_eq(out, total, data, total)
+            || !TEST_size_t_eq(records, 3))
+        goto end;
+
+    /* A write that has to be retried */
+    fail_next_write = 1;
+    if (!TEST_false(SSL_writev(clientssl, iov, OSSL_NELEM(iov), &written))
+            || !TEST_int_eq(SSL_get_error(clientssl, 0), SSL_ERROR_WANT_WRITE)
+            || !TEST_true(SSL_writev(clientssl, iov, OSSL_NELEM(iov),
+                                     &written))
+            || !TEST_size_t_eq(written, total)
+            || !read_all(serverssl, out, total)
+            || !TEST_mem_eq(out, total, data, total))
+        goto end;
+
+    testresult = 1;
+ end:
+    fail_next_write = 0;
+    OPENSSL_free(data);
+    OPENSSL_free(out);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+/*
+ * Writing no buffers, or only empty ones, succeeds without sending anything,
+ * and empty buffers around the data and on record boundaries are skipped.
+ */
+static int test_writev_empty(int idx)
+{
+    static const unsigned char zero[1] = { 0 };
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    unsigned char *data = NULL, *out = NULL;
+    SSL_IOVEC iov[7];
+    size_t total, written, i;
+    int testresult = 0;
+
+    if (!make_connection(idx, &sctx, &cctx, &serverssl, &clientssl)
+            || !TEST_ptr(data = OPENSSL_malloc(BODY_LEN))
+            || !TEST_ptr(out = OPENSSL_malloc(BODY_LEN)))
+        goto end;
+    for (i = 0; i < BODY_LEN; i++)
+        data[i] = (unsigned char)(i * 7 + i / 251);
+
+    records = bio_writes = 0;
+    written = 1;
+    if (!TEST_true(SSL_writev(clientssl, NULL, 0, &written))
+            || !TEST_size_t_eq(written, 0))
+        goto end;
+
+    iov[0].data = NULL;
+    iov[0].data_len = 0;
+    iov[1].data = zero;
+    iov[1].data_len = 0;
+    written = 1;
+    if (!TEST_true(SSL_writev(clientssl, iov, 2, &written))
+            || !TEST_size_t_eq(written, 0)
+            || !TEST_size_t_eq(bio_writes, 0)
+            || !TEST_false(SSL_read_ex(serverssl, out, BODY_LEN, &written))
+            || !TEST_int_eq(SSL_get_error(serverssl, 0), SSL_ERROR_WANT_READ)
+            || !TEST_size_t_eq(records, 0))
+        goto end;
+
+    /* Empty buffers first, last and right after a full record */
+    iov[0].data = NULL;
+    iov[0].data_len = 0;
+    iov[1].data = data;
+    iov[1].data_len = SSL3_RT_MAX_PLAIN_LENGTH;
+    iov[2].data = zero;
+    iov[2].data_len = 0;
+    iov[3].data = NULL;
+    iov[3].data_len = 0;
+    iov[4].data = data + SSL3_RT_MAX_PLAIN_LENGTH;
+    iov[4].data_len = 100;
+    iov[5].data = NULL;
+    iov[5].data_len = 0;
+    iov[6].data = zero;
+    iov[6].data_len = 0;
+    total = SSL3_RT_MAX_PLAIN_LENGTH + 100;
+    if (!TEST_true(SSL_writev(clientssl, iov, OSSL_NELEM(iov), &written))
+            || !TEST_size_t_eq(written, total)
+            || !read_all(serverssl, out, total)
+            || !TEST_mem_eq(out, total, data, total))
+        goto end;
+
+    testresult = 1;
+ end:
+    OPENSSL_free(data);
+    OPENSSL_free(out);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+/*
+ * With SSL_MODE_ENABLE_PARTIAL_WRITE an interrupted write is retried with
+ * the same |iov| and returns part of the data, and the rest is sent by
+ * writing the remaining buffers.
+ */
+static int test_writev_partial(int idx)
+{
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    unsigned char *data = NULL, *out = NULL;
+    SSL_IOVEC iov[PARTIAL_LEN / 10000], *v = iov;
+    size_t iovcnt = OSSL_NELEM(iov), written, sent, i;
+    int testresult = 0;
+
+    if (!make_connection(idx, &sctx, &cctx, &serverssl, &clientssl)
+            || !TEST_ptr(data = OPENSSL_malloc(PARTIAL_LEN))
+            || !TEST_ptr(out = OPENSSL_malloc(PARTIAL_LEN)))
+        goto end;
+    for (i = 0; i < PARTIAL_LEN; i++)
+        data[i] = (unsigned char)(i * 7 + i / 251);
+    for (i = 0; i < OSSL_NELEM(iov); i++) {
+        iov[i].data = data + i * 10000;
+        iov[i].data_len = 10000;
+    }
+    SSL_set_mode(clientssl, SSL_MODE_ENABLE_PARTIAL_WRITE);
+
+    fail_next_write = 1;
+    if (!TEST_false(SSL_writev(clientssl, iov, OSSL_NELEM(iov), &written))
+            || !TEST_int_eq(SSL_get_error(clientssl, 0), SSL_ERROR_WANT_WRITE)
+            || !TEST_true(SSL_writev(clientssl, iov, OSSL_NELEM(iov),
+                                     &written))
+            || !TEST_size_t_gt(written, 0)
+            || !TEST_size_t_lt(written, PARTIAL_LEN))
+        goto end;
+
+    for (sent = written; sent < PARTIAL_LEN; sent += written) {
+        iov_consume(&v, &iovcnt, written);
+        if (!TEST_true(SSL_writev(clientssl, v, iovcnt, &written))
+                || !TEST_size_t_gt(written, 0))
+            goto end;
+    }
+    if (!TEST_size_t_eq(sent, PARTIAL_LEN)
+            || !read_all(serverssl, out, PARTIAL_LEN)
+            || !TEST_mem_eq(out, PARTIAL_LEN, data, PARTIAL_LEN))
+        goto end;
+
+    testresult = 1;
+ end:
+    fail_next_write = 0;
+    OPENSSL_free(data);
+    OPENSSL_free(out);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+OPT_TEST_DECLARE_USAGE("certfile privkeyfile\n")
+
+int setup_tests(void)
+{
+    if (!test_skip_common_options()) {
+        TEST_error("Error parsing test options\n");
+        return 0;
+    }
+
+    if (!TEST_ptr(cert = test_get_argument(0))
+            || !TEST_ptr(privkey = test_get_argument(1)))
+        return 0;
+
+    ADD_ALL_TESTS(test_writev, OSSL_NELEM(configs));
+    ADD_ALL_TESTS(test_writev_empty, OSSL_NELEM(configs));
+    ADD_ALL_TESTS(test_writev_partial, OSSL_NELEM(configs));
+    return 1;
+}
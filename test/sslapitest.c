@@ -9044,6 +9044,90 @@ end:
 }
 #endif /* OPENSSL_NO_TLS1_2 */
 
+#ifndef OSSL_NO_USABLE_TLS1_3
+static const char *multirec_ciphersuites[] = {
+    "TLS_AES_128_GCM_SHA256",
+    "TLS_AES_256_GCM_SHA384",
+# if !defined(OPENSSL_NO_CHACHA) && !defined(OPENSSL_NO_POLY1305)
+    "TLS_CHACHA20_POLY1305_SHA256",
+# endif
+};
+
+/* Reduce the fragment size - so the multi-record test buffer can be small */
+# define MULTIREC_FRAGSIZE 512
+
+/*
+ * Test that TLSv1.3 writes of several records, which may be sealed by the
+ * cipher in one go, read back correctly.  The first half of the tests use
+ * plain writes, the second half block padding, which goes record by record.
+ */
+static int test_tls13_multirec_write(int tst)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    int testresult = 0;
+    size_t idx = tst % OSSL_NELEM(multirec_ciphersuites);
+    /*
+     * 9 * plus some leftover so that one write has a full batch of records
+     * followed by single ones.
+     */
+    unsigned char msg[MULTIREC_FRAGSIZE * 9 + 100];
+    unsigned char buf[sizeof(msg)], *p;
+    size_t readbytes, written, len;
+    int i;
+
+    if (is_fips && strstr(multirec_ciphersuites[idx], "CHACHA") != NULL) {
+        TEST_skip("ChaCha20-Poly1305 is not available in the FIPS provider");
+        return 1;
+    }
+
+    RAND_bytes(msg, sizeof(msg));
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+                                       TLS_client_method(), TLS1_3_VERSION,
+                                       TLS1_3_VERSION, &sctx, &cctx, cert,
+                                       privkey))
+            || !TEST_true(SSL_CTX_set_ciphersuites(cctx,
+                                                   multirec_ciphersuites[idx]))
+            || !TEST_true(SSL_CTX_set_max_send_fragment(sctx,
+                                                        MULTIREC_FRAGSIZE)))
+        goto end;
+
+    if (tst >= (int)OSSL_NELEM(multirec_ciphersuites)
+            && !TEST_true(SSL_CTX_set_block_padding(sctx, 64)))
+        goto end;
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                                      NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                SSL_ERROR_NONE)))
+        goto end;
+
+    /* Twice, so that the second write starts from a later sequence number */
+    for (i = 0; i < 2; i++) {
+        if (!TEST_true(SSL_write_ex(serverssl, msg, sizeof(msg), &written))
+                || !TEST_size_t_eq(written, sizeof(msg)))
+            goto end;
+
+        for (p = buf, len = written; len > 0; p += readbytes, len -= readbytes) {
+            if (!TEST_true(SSL_read_ex(clientssl, p, len, &readbytes)))
+                goto end;
+        }
+        if (!TEST_mem_eq(msg, sizeof(msg), buf, sizeof(buf)))
+            goto end;
+    }
+
+    testresult = 1;
+end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+
+    return testresult;
+}
+#endif /* OSSL_NO_USABLE_TLS1_3 */
+
 static int test_session_timeout(int test)
 {
     /*
@@ -9167,6 +9251,86 @@ static int test_session_timeout(int test)
     return testresult;
 }
 
+/*
+ * Test an internal session cache split into shards: sessions are found
+ * again whichever shard they went to, and flushing and the cache size
+ * limit apply to the cache as a whole.
+ */
+#define SHARD_TEST_SESSIONS 64
+static int test_session_cache_shards(void)
+{
+    SSL_SESSION *sess[SHARD_TEST_SESSIONS];
+    SSL_CTX *ctx;
+    long now = (long)time(NULL);
+    int i, testresult = 0;
+
+    memset(sess, 0, sizeof(sess));
+    if (!TEST_ptr(ctx = SSL_CTX_new_ex(libctx, NULL, TLS_method()))
+            || !TEST_long_eq(SSL_CTX_sess_get_cache_shards(ctx), 1)
+            || !TEST_ptr(SSL_CTX_sessions(ctx))
+            || !TEST_long_eq(SSL_CTX_sess_set_cache_shards(ctx, 0), 0)
+            || !TEST_long_eq(SSL_CTX_sess_set_cache_shards(ctx, 257), 0)
+            || !TEST_long_eq(SSL_CTX_sess_get_cache_shards(ctx), 1)
+            || !TEST_long_eq(SSL_CTX_sess_set_cache_shards(ctx, 6), 1)
+            || !TEST_long_eq(SSL_CTX_sess_get_cache_shards(ctx), 8)
+            || !TEST_ptr_null(SSL_CTX_sessions(ctx)))
+        goto end;
+
+    for (i = 0; i < SHARD_TEST_SESSIONS; i++) {
+        if (!TEST_ptr(sess[i] = SSL_SESSION_new()))
+            goto end;
+        sess[i]->session_id_length = SSL3_SSL_SESSION_ID_LENGTH;
+        memset(sess[i]->session_id, i, SSL3_SSL_SESSION_ID_LENGTH);
+        /* Every other session has expired */
+        if (!TEST_long_gt(SSL_SESSION_set_time(sess[i], i % 2 == 0 ? now - 100
+                                                                   : now), 0)
+                || !TEST_long_gt(SSL_SESSION_set_timeout(sess[i], 50), 0)
+                || !TEST_int_eq(SSL_CTX_add_session(ctx, sess[i]), 1))
+            goto end;
+    }
+
+    if (!TEST_long_eq(SSL_CTX_sess_number(ctx), SHARD_TEST_SESSIONS)
+            || !TEST_long_eq(SSL_CTX_sess_set_cache_shards(ctx, 2), 0)
+            || !TEST_long_eq(SSL_CTX_sess_get_cache_shards(ctx), 8))
+        goto end;
+    for (i = 0; i < SHARD_TEST_SESSIONS; i++)
+        if (!TEST_ptr(sess[i]->owner))
+            goto end;
+
+    SSL_CTX_flush_sessions(ctx, now);
+    if (!TEST_long_eq(SSL_CTX_sess_number(ctx), SHARD_TEST_SESSIONS / 2))
+        goto end;
+    for (i = 0; i < SHARD_TEST_SESSIONS; i++)
+        if (!TEST_int_eq(SSL_CTX_remove_session(ctx, sess[i]), i % 2))
+            goto end;
+    if (!TEST_long_eq(SSL_CTX_sess_number(ctx), 0))
+        goto end;
+
+    /* The size limit is shared out between the shards */
+    if (!TEST_long_ne(SSL_CTX_sess_set_cache_size(ctx, 16), 0))
+        goto end;
+    for (i = 0; i < SHARD_TEST_SESSIONS; i++)
+        if (!TEST_int_ne(SSL_SESSION_set_time(sess[i], now), 0)
+                || !TEST_int_eq(SSL_CTX_add_session(ctx, sess[i]), 1))
+            goto end;
+    if (!TEST_long_gt(SSL_CTX_sess_number(ctx), 0)
+            || !TEST_long_le(SSL_CTX_sess_number(ctx), 16))
+        goto end;
+
+    SSL_CTX_flush_sessions(ctx, 0);
+    if (!TEST_long_eq(SSL_CTX_sess_number(ctx), 0)
+            || !TEST_long_eq(SSL_CTX_sess_set_cache_shards(ctx, 1), 1)
+            || !TEST_ptr(SSL_CTX_sessions(ctx)))
+        goto end;
+
+    testresult = 1;
+ end:
+    SSL_CTX_free(ctx);
+    for (i = 0; i < SHARD_TEST_SESSIONS; i++)
+        SSL_SESSION_free(sess[i]);
+    return testresult;
+}
+
 /*
  * Test 0: Client sets servername and server acknowledges it (TLSv1.2)
  * Test 1: Client sets servername and server does not acknowledge it (TLSv1.2)
@@ -11172,6 +11336,82 @@ end:
     return testresult;
 }
 
+/*
+ * Run a handshake with and without SSL_MODE_HANDSHAKE_ARENA and check that
+ * the arena takes over handshake allocations from the heap.
+ *
+ * Test 0: TLSv1.3
+ * Test 1: TLSv1.2
+ */
+static int test_handshake_arena(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    uint64_t arena[2][2], heap[2][2];
+    unsigned char buf[20];
+    size_t written, readbytes;
+    int testresult = 0, maxversion = TLS1_3_VERSION, i;
+
+#ifndef OPENSSL_NO_TLS1_2
+    if (idx == 1)
+        maxversion = TLS1_2_VERSION;
+#else
+    if (idx == 1)
+        return TEST_skip("No TLSv1.2");
+#endif
+#ifdef OSSL_NO_USABLE_TLS1_3
+    if (idx == 0)
+        return TEST_skip("No TLSv1.3");
+#endif
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+                                       TLS_client_method(), 0, maxversion,
+                                       &sctx, &cctx, cert, privkey)))
+        goto end;
+
+    for (i = 0; i < 2; i++) {
+        if (i == 1) {
+            SSL_CTX_set_mode(sctx, SSL_MODE_HANDSHAKE_ARENA);
+            SSL_CTX_set_mode(cctx, SSL_MODE_HANDSHAKE_ARENA);
+        }
+        if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl,
+                                          &clientssl, NULL, NULL))
+                || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                                                    SSL_ERROR_NONE))
+                /* Make sure the client processes any session tickets */
+                || !TEST_true(SSL_write_ex(serverssl, "hello", 5, &written))
+                || !TEST_true(SSL_read_ex(clientssl, buf, sizeof(buf),
+                                          &readbytes))
+                || !TEST_mem_eq(buf, readbytes, "hello", 5)
+                || !TEST_true(SSL_get_handshake_arena_stats(serverssl,
+                                                            &arena[i][0],
+                                                            &heap[i][0]))
+                || !TEST_true(SSL_get_handshake_arena_stats(clientssl,
+                                                            &arena[i][1],
+                                                            &heap[i][1])))
+            goto end;
+        SSL_free(serverssl);
+        SSL_free(clientssl);
+        serverssl = clientssl = NULL;
+    }
+
+    for (i = 0; i < 2; i++) {
+        if (!TEST_uint64_t_eq(arena[0][i], 0)
+                || !TEST_uint64_t_gt(heap[0][i], 0)
+                || !TEST_uint64_t_gt(arena[1][i], 0)
+                || !TEST_uint64_t_lt(heap[1][i], heap[0][i]))
+            goto end;
+    }
+
+    testresult = 1;
+end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
 OPT_TEST_DECLARE_USAGE("certfile privkeyfile srpvfile tmpfile provider config dhfile\n")
 
 int setup_tests(void)
@@ -11438,6 +11678,10 @@ int setup_tests(void)
     ADD_ALL_TESTS(test_ca_names, 3);
 #ifndef OPENSSL_NO_TLS1_2
     ADD_ALL_TESTS(test_multiblock_write, OSSL_NELEM(multiblock_cipherlist_data));
+#endif
+#ifndef OSSL_NO_USABLE_TLS1_3
+    ADD_ALL_TESTS(test_tls13_multirec_write,
+                  2 * OSSL_NELEM(multirec_ciphersuites));
 #endif
     ADD_ALL_TESTS(test_servername, 10);
 #if !defined(OPENSSL_NO_EC) \
@@ -11464,6 +11708,7 @@ int setup_tests(void)
     ADD_TEST(test_set_verify_cert_store_ssl_ctx);
     ADD_TEST(test_set_verify_cert_store_ssl);
     ADD_ALL_TESTS(test_session_timeout, 1);
+    ADD_TEST(test_session_cache_shards);
     ADD_TEST(test_load_dhfile);
 #ifndef OSSL_NO_USABLE_TLS1_3
     ADD_TEST(test_read_ahead_key_change);
@@ -11478,6 +11723,7 @@ int setup_tests(void)
     ADD_ALL_TESTS(test_version, 6);
     ADD_TEST(test_rstate_string);
     ADD_ALL_TESTS(test_handshake_retry, 16);
+    ADD_ALL_TESTS(test_handshake_arena, 2);
     return 1;
 
  err:
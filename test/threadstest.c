@@ -29,6 +29,7 @@
 #include <openssl/evp.h>
 #include "internal/tsan_assist.h"
 #include "internal/nelem.h"
+#include "internal/rcu.h"
 #include "testutil.h"
 #include "threadstest.h"
 
@@ -256,6 +257,100 @@ static int test_atomic(void)
     return testresult;
 }
 
+typedef struct {
+    int a;
+    int b;
+} RCU_DATA;
+
+#define RCU_WRITER_ROUNDS   500
+#define RCU_READER_ROUNDS   100000
+
+static CRYPTO_RCU_LOCK *rcu_lock = NULL;
+static RCU_DATA *rcu_data = NULL;
+static TSAN_QUALIFIER int rcu_failures;
+static TSAN_QUALIFIER int rcu_writer_done;
+
+static void rcu_free_data(void *data)
+{
+    RCU_DATA *d = data;
+
+    /* Poison the data so that a reader still looking at it notices */
+    d->a = 1;
+    d->b = 2;
+    OPENSSL_free(d);
+}
+
+static void rcu_reader(void)
+{
+    RCU_DATA *d;
+    unsigned int token;
+    int i;
+
+    for (i = 0; i < RCU_READER_ROUNDS && !tsan_load(&rcu_writer_done); i++) {
+        token = ossl_rcu_read_lock(rcu_lock);
+        d = ossl_rcu_deref(&rcu_data);
+        if (d == NULL || d->a != d->b)
+            tsan_counter(&rcu_failures);
+        ossl_rcu_read_unlock(rcu_lock, token);
+    }
+}
+
+static void rcu_writer(void)
+{
+    RCU_DATA *new, *old;
+    int i;
+
+    for (i = 1; i <= RCU_WRITER_ROUNDS; i++) {
+        if ((new = OPENSSL_malloc(sizeof(*new))) == NULL) {
+            tsan_counter(&rcu_failures);
+            break;
+        }
+        new->a = new->b = i;
+
+        ossl_rcu_write_lock(rcu_lock);
+        old = rcu_data;
+        ossl_rcu_assign_ptr(&rcu_data, &new);
+        ossl_rcu_write_unlock(rcu_lock);
+        if (!ossl_rcu_call(rcu_lock, &rcu_free_data, old))
+            tsan_counter(&rcu_failures);
+        ossl_synchronize_rcu(rcu_lock);
+    }
+    tsan_store(&rcu_writer_done, 1);
+}
+
+static int test_rcu(void)
+{
+    thread_t readers[4], writer;
+    size_t i;
+    int testresult = 0;
+
+    rcu_failures = 0;
+    rcu_writer_done = 0;
+    if (!TEST_ptr(rcu_lock = ossl_rcu_lock_new())
+            || !TEST_ptr(rcu_data = OPENSSL_zalloc(sizeof(*rcu_data))))
+        goto err;
+
+    for (i = 0; i < OSSL_NELEM(readers); i++)
+        if (!TEST_true(run_thread(&readers[i], rcu_reader)))
+            goto err;
+    if (!TEST_true(run_thread(&writer, rcu_writer)))
+        goto err;
+    for (i = 0; i < OSSL_NELEM(readers); i++)
+        if (!TEST_true(wait_for_thread(readers[i])))
+            goto err;
+    if (!TEST_true(wait_for_thread(writer))
+            || !TEST_int_eq(tsan_load(&rcu_failures), 0)
+            || !TEST_int_eq(rcu_data->a, RCU_WRITER_ROUNDS))
+        goto err;
+    testresult = 1;
+ err:
+    ossl_rcu_lock_free(rcu_lock);
+    rcu_lock = NULL;
+    OPENSSL_free(rcu_data);
+    rcu_data = NULL;
+    return testresult;
+}
+
 static OSSL_LIB_CTX *multi_libctx = NULL;
 static int multi_success;
 static OSSL_PROVIDER *multi_provider[MAXIMUM_PROVIDERS + 1];
@@ -518,6 +613,89 @@ static int test_multi_fetch_worker(void)
                            2, &thread_multi_simple_fetch, 1, default_provider);
 }
 
+#define FETCH_CONCURRENT_ROUNDS 2000
+
+static void thread_fetch_loop(void)
+{
+    EVP_MD *md;
+    int i;
+
+    for (i = 0; i < FETCH_CONCURRENT_ROUNDS; i++) {
+        if ((md = EVP_MD_fetch(multi_libctx, "SHA2-256", NULL)) == NULL) {
+            multi_set_success(0);
+            return;
+        }
+        EVP_MD_free(md);
+    }
+}
+
+static EVP_MD *name_concurrent_md = NULL;
+
+/*
+ * Name lookups, as done by EVP_MD_is_a() and by fetching by name.  Both go
+ * through the namemap, which readers use without taking any lock.
+ */
+static void thread_name_loop(void)
+{
+    EVP_CIPHER *cipher;
+    int i;
+
+    for (i = 0; i < FETCH_CONCURRENT_ROUNDS; i++) {
+        if (!EVP_MD_is_a(name_concurrent_md, "SHA256")
+                || EVP_MD_is_a(name_concurrent_md, "SHA2-512")
+                || (cipher = EVP_CIPHER_fetch(multi_libctx, "aes-128-gcm",
+                                              NULL)) == NULL) {
+            multi_set_success(0);
+            return;
+        }
+        EVP_CIPHER_free(cipher);
+    }
+}
+
+/*
+ * Run |loop| from as many threads as we can at once, so that readers of the
+ * query cache and the namemap, neither of which takes a lock, race each
+ * other.
+ */
+static int run_concurrent_test(void (*loop)(void), int freeze)
+{
+    int testresult = 0;
+
+    multi_intialise();
+    if (!thread_setup_libctx(1, default_provider))
+        return 0;
+    /* Populate the query cache */
+    thread_multi_simple_fetch();
+    if (!TEST_ptr(name_concurrent_md = EVP_MD_fetch(multi_libctx, "SHA2-256",
+                                                    NULL))
+            || (freeze && !TEST_true(OSSL_LIB_CTX_freeze(multi_libctx, NULL)))
+            || !start_threads(MAXIMUM_THREADS, loop)
+            || !teardown_threads()
+            || !TEST_true(multi_success))
+        goto err;
+
+    testresult = 1;
+ err:
+    EVP_MD_free(name_concurrent_md);
+    name_concurrent_md = NULL;
+    thead_teardown_libctx();
+    return testresult;
+}
+
+/*
+ * Test 0: fetches through the query cache
+ * Test 1: fetches from a frozen library context
+ */
+static int test_multi_fetch_concurrent(int idx)
+{
+    return run_concurrent_test(&thread_fetch_loop, idx);
+}
+
+static int test_multi_name_concurrent(void)
+{
+    return run_concurrent_test(&thread_name_loop, 0);
+}
+
 static int test_multi_shared_pkey_common(void (*worker)(void))
 {
     int testresult = 0;
@@ -853,10 +1031,13 @@ int setup_tests(void)
     ADD_TEST(test_once);
     ADD_TEST(test_thread_local);
     ADD_TEST(test_atomic);
+    ADD_TEST(test_rcu);
     ADD_TEST(test_multi_load);
     ADD_TEST(test_multi_general_worker_default_provider);
     ADD_TEST(test_multi_general_worker_fips_provider);
     ADD_TEST(test_multi_fetch_worker);
+    ADD_ALL_TESTS(test_multi_fetch_concurrent, 2);
+    ADD_TEST(test_multi_name_concurrent);
     ADD_TEST(test_multi_shared_pkey);
 #ifndef OPENSSL_NO_DEPRECATED_3_0
     ADD_TEST(test_multi_downgrade_shared_pkey);
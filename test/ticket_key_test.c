@@ -0,0 +1,265 @@
+/*
+ * Copyright 2023 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include "helpers/ssltestlib.h"
+#include "testutil.h"
+
+static char *cert = NULL;
+static char *privkey = NULL;
+
+static SSL_CTX *sctx = NULL, *cctx = NULL;
+
+static int setup_ctxs(int version, long options)
+{
+    if (!TEST_true(create_ssl_ctx_pair(NULL, TLS_server_method(),
+                                       TLS_client_method(), version, version,
+                                       &sctx, &cctx, cert, privkey)))
+        return 0;
+    SSL_CTX_set_options(sctx, options);
+    SSL_CTX_set_options(cctx, options);
+    return 1;
+}
+
+static void free_ctxs(void)
+{
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    sctx = cctx = NULL;
+}
+
+/*
+ * Connect, resuming |sess| if it isn't NULL, and return the client's session
+ * afterwards.  |*reused| is set to whether |sess| was resumed.
+ */
+static SSL_SESSION *do_connection(SSL_SESSION *sess, int *reused)
+{
+    SSL *serverssl = NULL, *clientssl = NULL;
+    SSL_SESSION *ret = NULL;
+
+    if (!create_ssl_objects(sctx, cctx, &serverssl, &clientssl, NULL, NULL)
+            || (sess != NULL && !SSL_set_session(clientssl, sess))
+            || !create_ssl_connection(serverssl, clientssl, SSL_ERROR_NONE))
+        goto end;
+
+    if (reused != NULL)
+        *reused = SSL_session_reused(clientssl);
+    ret = SSL_get1_session(clientssl);
+    SSL_shutdown(clientssl);
+    SSL_shutdown(serverssl);
+ end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    return ret;
+}
+
+static int same_ticket(SSL_SESSION *a, SSL_SESSION *b)
+{
+    const unsigned char *ta, *tb;
+    size_t la, lb;
+
+    SSL_SESSION_get0_ticket(a, &ta, &la);
+    SSL_SESSION_get0_ticket(b, &tb, &lb);
+    return la == lb && memcmp(ta, tb, la) == 0;
+}
+
+/*
+ * Test 0: AES-256-GCM, TLSv1.2
+ * Test 1: AES-256-GCM, TLSv1.3
+ * Test 2: ChaCha20-Poly1305, TLSv1.2
+ * Test 3: ChaCha20-Poly1305, TLSv1.3
+ */
+static int test_ticket_key_ring(int idx)
+{
+    const char *cipher = idx < 2 ? "AES-256-GCM" : "ChaCha20-Poly1305";
+    int version = idx % 2 == 0 ? TLS1_2_VERSION : TLS1_3_VERSION;
+    SSL_SESSION *sess = NULL, *sess2 = NULL, *bad = NULL;
+    unsigned char *der = NULL;
+    const unsigned char *p, *tick;
+    size_t ticklen;
+    int len, reused = 0, testresult = 0;
+
+#ifdef OPENSSL_NO_TLS1_2
+    if (version == TLS1_2_VERSION)
+        return TEST_skip("TLSv1.2 is disabled");
+#endif
+#ifdef OSSL_NO_USABLE_TLS1_3
+    if (version == TLS1_3_VERSION)
+        return TEST_skip("TLSv1.3 is disabled");
+#endif
+#ifdef OPENSSL_NO_CHACHA
+    if (idx >= 2)
+        return TEST_skip("ChaCha20 is disabled");
+#endif
+
+    if (!setup_ctxs(version, 0)
+            || !TEST_false(SSL_CTX_set_ticket_key_ring(sctx, "AES-256-CBC",
+                                                       0, 2))
+            || !TEST_true(SSL_CTX_set_ticket_key_ring(sctx, cipher, 0, 2)))
+        goto end;
+    ERR_clear_error();
+
+    if (!TEST_ptr(sess = do_connection(NULL, NULL))
+            || !TEST_true(SSL_SESSION_has_ticket(sess)))
+        goto end;
+    /* Key name, nonce, at least some ciphertext and the tag */
+    SSL_SESSION_get0_ticket(sess, &tick, &ticklen);
+    if (!TEST_size_t_gt(ticklen, 16 + 12 + 16))
+        goto end;
+
+    if (!TEST_ptr(sess2 = do_connection(sess, &reused))
+            || !TEST_true(reused))
+        goto end;
+    /* A ticket sealed with the current key isn't replaced in TLSv1.2 */
+    if (version == TLS1_2_VERSION && !TEST_true(same_ticket(sess, sess2)))
+        goto end;
+    SSL_SESSION_free(sess2);
+    sess2 = NULL;
+
+    /* A ticket that was tampered with can't be used */
+    if (!TEST_int_gt(len = i2d_SSL_SESSION(sess, &der), 0))
+        goto end;
+    p = der;
+    if (!TEST_ptr(bad = d2i_SSL_SESSION(NULL, &p, len)))
+        goto end;
+    SSL_SESSION_get0_ticket(bad, &tick, &ticklen);
+    ((unsigned char *)tick)[ticklen - 1] ^= 1;
+    if (!TEST_ptr(sess2 = do_connection(bad, &reused))
+            || !TEST_false(reused))
+        goto end;
+
+    testresult = 1;
+ end:
+    OPENSSL_free(der);
+    SSL_SESSION_free(sess);
+    SSL_SESSION_free(sess2);
+    SSL_SESSION_free(bad);
+    free_ctxs();
+    return testresult;
+}
+
+/*
+ * With a rotation interval of a second and two keys, a ticket is replaced
+ * when it is used after a second, and can't be used any more after two
+ * rotations.  A ticket sealed with the built-in keys is accepted and
+ * replaced once the key ring is set.
+ */
+static int test_ticket_key_rotation(void)
+{
+    SSL_SESSION *legacy = NULL, *sess = NULL, *sess2 = NULL;
+    int reused = 0, testresult = 0;
+
+#ifdef OPENSSL_NO_TLS1_2
+    return TEST_skip("TLSv1.2 is disabled");
+#endif
+    if (!setup_ctxs(TLS1_2_VERSION, 0)
+            || !TEST_ptr(legacy = do_connection(NULL, NULL))
+            || !TEST_true(SSL_CTX_set_ticket_key_ring(sctx, NULL, 1, 2)))
+        goto end;
+
+    if (!TEST_ptr(sess = do_connection(legacy, &reused))
+            || !TEST_true(reused)
+            || !TEST_false(same_ticket(legacy, sess)))
+        goto end;
+
+    OSSL_sleep(1100);
+    if (!TEST_ptr(sess2 = do_connection(sess, &reused))
+            || !TEST_true(reused)
+            || !TEST_false(same_ticket(sess, sess2)))
+        goto end;
+    SSL_SESSION_free(sess2);
+
+    /* The key of |sess| is now the older one of the two */
+    OSSL_sleep(1100);
+    if (!TEST_ptr(sess2 = do_connection(sess, &reused))
+            || !TEST_true(reused))
+        goto end;
+    SSL_SESSION_free(sess2);
+
+    /* And now it's gone */
+    if (!TEST_ptr(sess2 = do_connection(sess, &reused))
+            || !TEST_false(reused))
+        goto end;
+
+    testresult = 1;
+ end:
+    SSL_SESSION_free(legacy);
+    SSL_SESSION_free(sess);
+    SSL_SESSION_free(sess2);
+    free_ctxs();
+    return testresult;
+}
+
+/*
+ * Resume TLSv1.3 sessions without a key exchange again and again, each time
+ * with the ticket issued on the previous resumption, with the built-in
+ * AES-256-CBC and HMAC-SHA256 tickets and with the key ring.
+ */
+#define TICKET_CHAIN_RESUMES 16
+
+static int test_ticket_chain(int idx)
+{
+    static const char *names[] = {
+        NULL, "AES-256-GCM", "ChaCha20-Poly1305"
+    };
+    SSL_SESSION *sess = NULL, *sess2;
+    int i, reused = 0, testresult = 0;
+
+#ifdef OSSL_NO_USABLE_TLS1_3
+    return TEST_skip("TLSv1.3 is disabled");
+#endif
+#ifdef OPENSSL_NO_CHACHA
+    if (idx == 2)
+        return TEST_skip("ChaCha20 is disabled");
+#endif
+    if (!setup_ctxs(TLS1_3_VERSION, SSL_OP_ALLOW_NO_DHE_KEX)
+            || (idx > 0
+                && !TEST_true(SSL_CTX_set_ticket_key_ring(sctx, names[idx],
+                                                          0, 2)))
+            || !TEST_ptr(sess = do_connection(NULL, NULL)))
+        goto end;
+
+    for (i = 0; i < TICKET_CHAIN_RESUMES; i++) {
+        if (!TEST_ptr(sess2 = do_connection(sess, &reused))
+                || !TEST_true(reused)) {
+            SSL_SESSION_free(sess2);
+            goto end;
+        }
+        SSL_SESSION_free(sess);
+        sess = sess2;
+    }
+
+    testresult = 1;
+ end:
+    SSL_SESSION_free(sess);
+    free_ctxs();
+    return testresult;
+}
+
+OPT_TEST_DECLARE_USAGE("certfile privkeyfile\n")
+
+int setup_tests(void)
+{
+    if (!test_skip_common_options()) {
+        TEST_error("Error parsing test options\n");
+        return 0;
+    }
+
+    if (!TEST_ptr(cert = test_get_argument(0))
+            || !TEST_ptr(privkey = test_get_argument(1)))
+        return 0;
+
+    ADD_ALL_TESTS(test_ticket_key_ring, 4);
+    ADD_TEST(test_ticket_key_rotation);
+    ADD_ALL_TESTS(test_ticket_chain, 3);
+    return 1;
+}
@@ -80,6 +80,7 @@ my %params = (
     'CIPHER_PARAM_CUSTOM_IV' =>            "custom-iv",   # int, 0 or 1
     'CIPHER_PARAM_CTS' =>                  "cts",         # int, 0 or 1
     'CIPHER_PARAM_TLS1_MULTIBLOCK' =>      "tls-multi",   # int, 0 or 1
+    'CIPHER_PARAM_TLS13_MULTIREC' =>       "tls13-multi", # int, 0 or 1
     'CIPHER_PARAM_HAS_RAND_KEY' =>         "has-randkey", # int, 0 or 1
     'CIPHER_PARAM_KEYLEN' =>               "keylen",      # size_t
     'CIPHER_PARAM_IVLEN' =>                "ivlen",       # size_t
@@ -103,6 +104,8 @@ my %params = (
 # For passing the AlgorithmIdentifier parameter in DER form
     'CIPHER_PARAM_ALGORITHM_ID_PARAMS' =>  "alg_id_param",# octet_string
     'CIPHER_PARAM_XTS_STANDARD' =>         "xts_standard",# utf8_string
+    'CIPHER_PARAM_THREADS' =>              "threads",     # uint
+    'CIPHER_PARAM_THREAD_THRESHOLD' =>     "thread-threshold", # size_t
 
     'CIPHER_PARAM_TLS1_MULTIBLOCK_MAX_SEND_FRAGMENT' =>  "tls1multi_maxsndfrag",# uint
     'CIPHER_PARAM_TLS1_MULTIBLOCK_MAX_BUFSIZE' =>        "tls1multi_maxbufsz",  # size_t
@@ -113,6 +116,13 @@ my %params = (
     'CIPHER_PARAM_TLS1_MULTIBLOCK_ENC_IN' =>             "tls1multi_encin",     # octet_string
     'CIPHER_PARAM_TLS1_MULTIBLOCK_ENC_LEN' =>            "tls1multi_enclen",    # size_t
 
+    'CIPHER_PARAM_TLS13_MULTIREC_IV' =>                  "tls13multi_iv",       # octet_string
+    'CIPHER_PARAM_TLS13_MULTIREC_SEQ' =>                 "tls13multi_seq",      # octet_string
+    'CIPHER_PARAM_TLS13_MULTIREC_FRAGLEN' =>             "tls13multi_fraglen",  # size_t
+    'CIPHER_PARAM_TLS13_MULTIREC_TYPE' =>                "tls13multi_type",     # uint
+    'CIPHER_PARAM_TLS13_MULTIREC_ENC' =>                 "tls13multi_enc",      # octet_string
+    'CIPHER_PARAM_TLS13_MULTIREC_ENC_IN' =>              "tls13multi_encin",    # octet_string
+
 # digest parameters
     'DIGEST_PARAM_XOFLEN' =>       "xoflen",       # size_t
     'DIGEST_PARAM_SSL3_MS' =>      "ssl3-ms",      # octet string